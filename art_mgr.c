@@ -0,0 +1,1195 @@
+#include "art_mgr.h"
+#include "storage_mgr.h"
+#include "norm_key.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Adaptive radix tree
+//
+// An inner node branches on the key byte at its depth. Node4 and Node16
+// keep sorted arrays of key bytes next to their children; Node16 compares
+// the byte against all 16 at once with SSE2 where the compiler has it.
+// Node48 maps every byte value to one of 48 child slots, and Node256 is
+// indexed by the byte directly. A node grows to the next layout when it is
+// full and shrinks back when a delete leaves it well under the smaller
+// layout's capacity, so the layouts do not flip on every update.
+//
+// The bytes that all keys below a node share are its prefix. Only the first
+// AR_MAX_PREFIX of them are kept in the node; a longer prefix is checked
+// against a leaf below the node when an insert has to split it, and lookups
+// skip it and let the leaf's full key decide.
+//
+// A leaf holds the full normalized key and its RID, and is stored in its
+// parent's child slot with the lowest pointer bit set. Normalized keys of
+// one index never are prefixes of each other (fixed-size values, and
+// strings end with a zero byte), so leaves only sit where a key ends.
+//
+// Snapshot file: page 0 is an AR_Header, then pages of packed entries
+// (an int count, then key length, key bytes and RID per entry) in key order.
+
+#define AR_MAX_PREFIX 8
+#define AR_MAX_KEY 256
+
+#define AR_NODE4 1
+#define AR_NODE16 2
+#define AR_NODE48 3
+#define AR_NODE256 4
+
+// Snapshot header, stored at the start of page 0
+typedef struct AR_Header {
+    int keyType;
+    int persistent;
+    int numEntries;
+} AR_Header;
+
+typedef struct AR_Leaf {
+    RID rid;
+    int keyLen;
+    unsigned char key[];
+} AR_Leaf;
+
+// Common part of the inner nodes
+typedef struct AR_Node {
+    unsigned char type;
+    short numChildren;
+    int prefixLen;  // bytes shared below this node, may exceed AR_MAX_PREFIX
+    unsigned char prefix[AR_MAX_PREFIX];
+} AR_Node;
+
+typedef struct AR_Node4 {
+    AR_Node n;
+    unsigned char keys[4];
+    void *children[4];
+} AR_Node4;
+
+typedef struct AR_Node16 {
+    AR_Node n;
+    unsigned char keys[16];
+    void *children[16];
+} AR_Node16;
+
+typedef struct AR_Node48 {
+    AR_Node n;
+    unsigned char childIndex[256];  // slot + 1 of the child for a byte, 0 if none
+    void *children[48];
+} AR_Node48;
+
+typedef struct AR_Node256 {
+    AR_Node n;
+    void *children[256];
+} AR_Node256;
+
+// Runtime state of an open index, kept in AR_TreeHandle.mgmtData
+typedef struct AR_TreeMgmt {
+    void *root;
+    int numEntries;
+    int numNodes;
+    bool persistent;
+} AR_TreeMgmt;
+
+// Scan state: the RIDs of the range, collected when the scan opens
+typedef struct AR_ScanMgmt {
+    RID *rids;
+    int count;
+    int capacity;
+    int pos;
+} AR_ScanMgmt;
+
+// Key range of a walk over the leaves; a bound of length 0 is open
+typedef struct AR_Range {
+    unsigned char low[AR_MAX_KEY];
+    int lowLen;
+    unsigned char high[AR_MAX_KEY];
+    int highLen;
+} AR_Range;
+
+typedef RC (*AR_Visitor)(AR_Leaf *leaf, void *ctx);
+
+#define TREE_MGMT(tree) ((AR_TreeMgmt *) (tree)->mgmtData)
+#define IS_LEAF(p) (((uintptr_t) (p)) & 1)
+#define AS_LEAF(p) ((AR_Leaf *) (((uintptr_t) (p)) & ~(uintptr_t) 1))
+#define TAG_LEAF(l) ((void *) (((uintptr_t) (l)) | 1))
+
+// toKey
+/**
+ * Converts a key value into its normalized bytes.
+ *
+ * @param tree The index.
+ * @param value The key; must be of the index's key type.
+ * @param key Receives the bytes, at most AR_MAX_KEY.
+ * @param len Receives their number.
+ * @return RC_OK, or an error code for a value of the wrong type or a
+ *         string that is too long.
+ */
+static RC toKey(AR_TreeHandle *tree, Value *value, unsigned char *key, int *len) {
+    if (value->dt != tree->keyType)
+        return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+    if (value->dt == DT_STRING) {
+        *len = strlen(value->v.stringV) + 1;
+        if (*len > AR_MAX_KEY)
+            return RC_IM_N_TO_LAGE;
+        memcpy(key, value->v.stringV, *len);
+        return RC_OK;
+    }
+    *len = normKeyAttrSize(value->dt, 0);
+    return normalizeValue(value, 0, (char *) key);
+}
+
+static int compareKeys(const unsigned char *a, int aLen, const unsigned char *b, int bLen) {
+    int c = memcmp(a, b, aLen < bLen ? aLen : bLen);
+
+    if (c != 0)
+        return c;
+    return aLen - bLen;
+}
+
+static bool leafMatches(AR_Leaf *leaf, const unsigned char *key, int len) {
+    return leaf->keyLen == len && memcmp(leaf->key, key, len) == 0;
+}
+
+static AR_Leaf *newLeaf(const unsigned char *key, int len, RID rid) {
+    AR_Leaf *leaf = (AR_Leaf *) malloc(sizeof(AR_Leaf) + len);
+
+    if (leaf != NULL) {
+        leaf->rid = rid;
+        leaf->keyLen = len;
+        memcpy(leaf->key, key, len);
+    }
+    return leaf;
+}
+
+static AR_Node *newNode(AR_TreeMgmt *t, int type) {
+    size_t size;
+    AR_Node *n;
+
+    switch (type) {
+    case AR_NODE4: size = sizeof(AR_Node4); break;
+    case AR_NODE16: size = sizeof(AR_Node16); break;
+    case AR_NODE48: size = sizeof(AR_Node48); break;
+    default: size = sizeof(AR_Node256); break;
+    }
+    n = (AR_Node *) calloc(1, size);
+    if (n != NULL) {
+        n->type = type;
+        t->numNodes++;
+    }
+    return n;
+}
+
+static void freeNode(AR_TreeMgmt *t, AR_Node *n) {
+    free(n);
+    t->numNodes--;
+}
+
+// Take over the prefix and child count of the node a new layout replaces
+static void copyHeader(AR_Node *to, const AR_Node *from) {
+    to->numChildren = from->numChildren;
+    to->prefixLen = from->prefixLen;
+    memcpy(to->prefix, from->prefix, AR_MAX_PREFIX);
+}
+
+// findChild
+/**
+ * Finds the child slot of a node for a key byte.
+ *
+ * @param n The node.
+ * @param byte The key byte.
+ * @return The slot, or NULL if the node has no child for the byte.
+ */
+static void **findChild(AR_Node *n, unsigned char byte) {
+    int i;
+
+    switch (n->type) {
+    case AR_NODE4: {
+        AR_Node4 *n4 = (AR_Node4 *) n;
+        for (i = 0; i < n->numChildren; i++) {
+            if (n4->keys[i] == byte)
+                return &n4->children[i];
+        }
+        return NULL;
+    }
+    case AR_NODE16: {
+        AR_Node16 *n16 = (AR_Node16 *) n;
+#ifdef __SSE2__
+        __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8((char) byte), _mm_loadu_si128((__m128i *) n16->keys));
+        int mask = _mm_movemask_epi8(cmp) & ((1 << n->numChildren) - 1);
+        return mask != 0 ? &n16->children[__builtin_ctz(mask)] : NULL;
+#else
+        for (i = 0; i < n->numChildren; i++) {
+            if (n16->keys[i] == byte)
+                return &n16->children[i];
+        }
+        return NULL;
+#endif
+    }
+    case AR_NODE48: {
+        AR_Node48 *n48 = (AR_Node48 *) n;
+        return n48->childIndex[byte] ? &n48->children[n48->childIndex[byte] - 1] : NULL;
+    }
+    default: {
+        AR_Node256 *n256 = (AR_Node256 *) n;
+        return n256->children[byte] != NULL ? &n256->children[byte] : NULL;
+    }
+    }
+}
+
+// Position of the first key byte of a Node4 or Node16 greater than byte
+static int insertPosition(const unsigned char *keys, int n, unsigned char byte) {
+#ifdef __SSE2__
+    if (n > 4) {
+        // signed compare of bytes with the top bit flipped is the unsigned order
+        __m128i flip = _mm_set1_epi8((char) 0x80);
+        __m128i cmp = _mm_cmplt_epi8(_mm_xor_si128(_mm_set1_epi8((char) byte), flip),
+                                     _mm_xor_si128(_mm_loadu_si128((const __m128i *) keys), flip));
+        int mask = _mm_movemask_epi8(cmp) & ((1 << n) - 1);
+        return mask != 0 ? __builtin_ctz(mask) : n;
+    }
+#endif
+    int i;
+
+    for (i = 0; i < n && keys[i] < byte; i++);
+    return i;
+}
+
+// Leftmost leaf below a node or leaf
+static AR_Leaf *minimumLeaf(void *p) {
+    int i;
+
+    while (!IS_LEAF(p)) {
+        AR_Node *n = (AR_Node *) p;
+
+        switch (n->type) {
+        case AR_NODE4: p = ((AR_Node4 *) n)->children[0]; break;
+        case AR_NODE16: p = ((AR_Node16 *) n)->children[0]; break;
+        case AR_NODE48:
+            for (i = 0; !((AR_Node48 *) n)->childIndex[i]; i++);
+            p = ((AR_Node48 *) n)->children[((AR_Node48 *) n)->childIndex[i] - 1];
+            break;
+        default:
+            for (i = 0; ((AR_Node256 *) n)->children[i] == NULL; i++);
+            p = ((AR_Node256 *) n)->children[i];
+            break;
+        }
+    }
+    return AS_LEAF(p);
+}
+
+// Number of stored prefix bytes of a node that match the key at depth
+static int checkPrefix(AR_Node *n, const unsigned char *key, int len, int depth) {
+    int max = n->prefixLen < AR_MAX_PREFIX ? n->prefixLen : AR_MAX_PREFIX;
+    int i;
+
+    if (max > len - depth)
+        max = len - depth;
+    for (i = 0; i < max && n->prefix[i] == key[depth + i]; i++);
+    return i;
+}
+
+// Number of bytes of the whole prefix of a node that match the key at
+// depth; bytes past the stored ones come from a leaf below the node
+static int prefixMismatch(AR_Node *n, const unsigned char *key, int len, int depth) {
+    int i = checkPrefix(n, key, len, depth);
+
+    if (i == AR_MAX_PREFIX && n->prefixLen > AR_MAX_PREFIX) {
+        AR_Leaf *leaf = minimumLeaf(n);
+        int max = (leaf->keyLen < len ? leaf->keyLen : len) - depth;
+
+        if (max > n->prefixLen)
+            max = n->prefixLen;
+        for (; i < max && leaf->key[depth + i] == key[depth + i]; i++);
+    }
+    return i;
+}
+
+// addChild
+/**
+ * Adds a child for a new key byte to a node, replacing the node with the
+ * next larger layout if it is full.
+ *
+ * @param t The tree.
+ * @param ref The slot that points to the node.
+ * @param byte The key byte.
+ * @param child The child.
+ * @return RC_OK, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC addChild(AR_TreeMgmt *t, void **ref, unsigned char byte, void *child) {
+    AR_Node *n = (AR_Node *) *ref;
+    int i, pos;
+
+    switch (n->type) {
+    case AR_NODE4: {
+        AR_Node4 *n4 = (AR_Node4 *) n;
+        AR_Node16 *n16;
+
+        if (n->numChildren < 4) {
+            pos = insertPosition(n4->keys, n->numChildren, byte);
+            memmove(n4->keys + pos + 1, n4->keys + pos, n->numChildren - pos);
+            memmove(n4->children + pos + 1, n4->children + pos, (n->numChildren - pos) * sizeof(void *));
+            n4->keys[pos] = byte;
+            n4->children[pos] = child;
+            n->numChildren++;
+            return RC_OK;
+        }
+        if ((n16 = (AR_Node16 *) newNode(t, AR_NODE16)) == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        copyHeader(&n16->n, n);
+        memcpy(n16->keys, n4->keys, 4);
+        memcpy(n16->children, n4->children, 4 * sizeof(void *));
+        freeNode(t, n);
+        *ref = n16;
+        return addChild(t, ref, byte, child);
+    }
+    case AR_NODE16: {
+        AR_Node16 *n16 = (AR_Node16 *) n;
+        AR_Node48 *n48;
+
+        if (n->numChildren < 16) {
+            pos = insertPosition(n16->keys, n->numChildren, byte);
+            memmove(n16->keys + pos + 1, n16->keys + pos, n->numChildren - pos);
+            memmove(n16->children + pos + 1, n16->children + pos, (n->numChildren - pos) * sizeof(void *));
+            n16->keys[pos] = byte;
+            n16->children[pos] = child;
+            n->numChildren++;
+            return RC_OK;
+        }
+        if ((n48 = (AR_Node48 *) newNode(t, AR_NODE48)) == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        copyHeader(&n48->n, n);
+        memcpy(n48->children, n16->children, 16 * sizeof(void *));
+        for (i = 0; i < 16; i++)
+            n48->childIndex[n16->keys[i]] = i + 1;
+        freeNode(t, n);
+        *ref = n48;
+        return addChild(t, ref, byte, child);
+    }
+    case AR_NODE48: {
+        AR_Node48 *n48 = (AR_Node48 *) n;
+        AR_Node256 *n256;
+
+        // slots stay packed: a delete moves the last child into the hole
+        if (n->numChildren < 48) {
+            n48->children[n->numChildren] = child;
+            n48->childIndex[byte] = n->numChildren + 1;
+            n->numChildren++;
+            return RC_OK;
+        }
+        if ((n256 = (AR_Node256 *) newNode(t, AR_NODE256)) == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        copyHeader(&n256->n, n);
+        for (i = 0; i < 256; i++) {
+            if (n48->childIndex[i])
+                n256->children[i] = n48->children[n48->childIndex[i] - 1];
+        }
+        freeNode(t, n);
+        *ref = n256;
+        return addChild(t, ref, byte, child);
+    }
+    default:
+        ((AR_Node256 *) n)->children[byte] = child;
+        n->numChildren++;
+        return RC_OK;
+    }
+}
+
+// removeChild
+/**
+ * Removes the child of a key byte from a node, replacing the node with the
+ * next smaller layout once it has few children left, or with its only
+ * child.
+ *
+ * @param t The tree.
+ * @param ref The slot that points to the node.
+ * @param slot The child slot of the byte, from findChild.
+ * @param byte The key byte.
+ */
+static void removeChild(AR_TreeMgmt *t, void **ref, void **slot, unsigned char byte) {
+    AR_Node *n = (AR_Node *) *ref;
+    int i, pos;
+
+    switch (n->type) {
+    case AR_NODE256: {
+        AR_Node256 *n256 = (AR_Node256 *) n;
+        AR_Node48 *n48;
+
+        n256->children[byte] = NULL;
+        n->numChildren--;
+        if (n->numChildren != 37 || (n48 = (AR_Node48 *) newNode(t, AR_NODE48)) == NULL)
+            return;
+        copyHeader(&n48->n, n);
+        for (i = 0, pos = 0; i < 256; i++) {
+            if (n256->children[i] != NULL) {
+                n48->children[pos] = n256->children[i];
+                n48->childIndex[i] = ++pos;
+            }
+        }
+        freeNode(t, n);
+        *ref = n48;
+        return;
+    }
+    case AR_NODE48: {
+        AR_Node48 *n48 = (AR_Node48 *) n;
+        AR_Node16 *n16;
+        int last = n->numChildren - 1;
+
+        pos = n48->childIndex[byte] - 1;
+        n48->childIndex[byte] = 0;
+        if (pos != last) {
+            n48->children[pos] = n48->children[last];
+            for (i = 0; n48->childIndex[i] != last + 1; i++);
+            n48->childIndex[i] = pos + 1;
+        }
+        n48->children[last] = NULL;
+        n->numChildren--;
+        if (n->numChildren != 12 || (n16 = (AR_Node16 *) newNode(t, AR_NODE16)) == NULL)
+            return;
+        copyHeader(&n16->n, n);
+        for (i = 0, pos = 0; i < 256; i++) {
+            if (n48->childIndex[i]) {
+                n16->keys[pos] = i;
+                n16->children[pos++] = n48->children[n48->childIndex[i] - 1];
+            }
+        }
+        freeNode(t, n);
+        *ref = n16;
+        return;
+    }
+    case AR_NODE16: {
+        AR_Node16 *n16 = (AR_Node16 *) n;
+        AR_Node4 *n4;
+
+        pos = slot - n16->children;
+        memmove(n16->keys + pos, n16->keys + pos + 1, n->numChildren - pos - 1);
+        memmove(n16->children + pos, n16->children + pos + 1, (n->numChildren - pos - 1) * sizeof(void *));
+        n->numChildren--;
+        if (n->numChildren != 3 || (n4 = (AR_Node4 *) newNode(t, AR_NODE4)) == NULL)
+            return;
+        copyHeader(&n4->n, n);
+        memcpy(n4->keys, n16->keys, 3);
+        memcpy(n4->children, n16->children, 3 * sizeof(void *));
+        freeNode(t, n);
+        *ref = n4;
+        return;
+    }
+    default: {
+        AR_Node4 *n4 = (AR_Node4 *) n;
+        void *child;
+
+        pos = slot - n4->children;
+        memmove(n4->keys + pos, n4->keys + pos + 1, n->numChildren - pos - 1);
+        memmove(n4->children + pos, n4->children + pos + 1, (n->numChildren - pos - 1) * sizeof(void *));
+        n->numChildren--;
+        if (n->numChildren != 1)
+            return;
+
+        // a node with one child is merged into it: the child's prefix
+        // becomes this prefix, the key byte, then its own prefix
+        child = n4->children[0];
+        if (!IS_LEAF(child)) {
+            AR_Node *c = (AR_Node *) child;
+            int len = n->prefixLen;
+
+            if (len < AR_MAX_PREFIX)
+                n->prefix[len++] = n4->keys[0];
+            if (len < AR_MAX_PREFIX) {
+                int more = c->prefixLen < AR_MAX_PREFIX - len ? c->prefixLen : AR_MAX_PREFIX - len;
+                memcpy(n->prefix + len, c->prefix, more);
+                len += more;
+            }
+            memcpy(c->prefix, n->prefix, len < AR_MAX_PREFIX ? len : AR_MAX_PREFIX);
+            c->prefixLen += n->prefixLen + 1;
+        }
+        freeNode(t, n);
+        *ref = child;
+        return;
+    }
+    }
+}
+
+// insertLeaf
+/**
+ * Inserts a leaf below a slot of the tree.
+ *
+ * @param t The tree.
+ * @param ref The slot.
+ * @param leaf The leaf; owned by the tree on success.
+ * @param depth Key bytes consumed above the slot.
+ * @return RC_OK, RC_IM_KEY_ALREADY_EXISTS, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC insertLeaf(AR_TreeMgmt *t, void **ref, AR_Leaf *leaf, int depth) {
+    const unsigned char *key = leaf->key;
+    int len = leaf->keyLen;
+    AR_Node *n, *split;
+    void **child;
+
+    for (;;) {
+        if (*ref == NULL) {
+            *ref = TAG_LEAF(leaf);
+            return RC_OK;
+        }
+
+        // two leaves: a Node4 over their common bytes takes the slot
+        if (IS_LEAF(*ref)) {
+            AR_Leaf *other = AS_LEAF(*ref);
+            int common = 0;
+
+            if (leafMatches(other, key, len))
+                return RC_IM_KEY_ALREADY_EXISTS;
+            while (other->key[depth + common] == key[depth + common])
+                common++;
+            if ((split = newNode(t, AR_NODE4)) == NULL)
+                return RC_MEM_ALLOCATION_FAIL;
+            split->prefixLen = common;
+            memcpy(split->prefix, key + depth, common < AR_MAX_PREFIX ? common : AR_MAX_PREFIX);
+            *ref = split;
+            addChild(t, ref, other->key[depth + common], TAG_LEAF(other));
+            return addChild(t, ref, key[depth + common], TAG_LEAF(leaf));
+        }
+
+        // a key that leaves the prefix splits it at the first differing byte
+        n = (AR_Node *) *ref;
+        if (n->prefixLen > 0) {
+            int diff = prefixMismatch(n, key, len, depth);
+
+            if (diff < n->prefixLen) {
+                if ((split = newNode(t, AR_NODE4)) == NULL)
+                    return RC_MEM_ALLOCATION_FAIL;
+                split->prefixLen = diff;
+                memcpy(split->prefix, n->prefix, diff < AR_MAX_PREFIX ? diff : AR_MAX_PREFIX);
+                *ref = split;
+                if (n->prefixLen <= AR_MAX_PREFIX) {
+                    addChild(t, ref, n->prefix[diff], n);
+                    n->prefixLen -= diff + 1;
+                    memmove(n->prefix, n->prefix + diff + 1, n->prefixLen);
+                } else {
+                    AR_Leaf *min = minimumLeaf(n);
+
+                    addChild(t, ref, min->key[depth + diff], n);
+                    n->prefixLen -= diff + 1;
+                    memcpy(n->prefix, min->key + depth + diff + 1,
+                           n->prefixLen < AR_MAX_PREFIX ? n->prefixLen : AR_MAX_PREFIX);
+                }
+                return addChild(t, ref, key[depth + diff], TAG_LEAF(leaf));
+            }
+            depth += n->prefixLen;
+        }
+
+        if ((child = findChild(n, key[depth])) == NULL)
+            return addChild(t, ref, key[depth], TAG_LEAF(leaf));
+        ref = child;
+        depth++;
+    }
+}
+
+// deleteFrom
+/**
+ * Removes a key from below a slot of the tree.
+ *
+ * @param t The tree.
+ * @param ref The slot.
+ * @param key The normalized key.
+ * @param len Its length.
+ * @param depth Key bytes consumed above the slot.
+ * @return RC_OK, or RC_IM_KEY_NOT_FOUND.
+ */
+static RC deleteFrom(AR_TreeMgmt *t, void **ref, const unsigned char *key, int len, int depth) {
+    AR_Node *n;
+    void **child;
+
+    if (*ref == NULL)
+        return RC_IM_KEY_NOT_FOUND;
+    if (IS_LEAF(*ref)) {
+        if (!leafMatches(AS_LEAF(*ref), key, len))
+            return RC_IM_KEY_NOT_FOUND;
+        free(AS_LEAF(*ref));
+        *ref = NULL;
+        return RC_OK;
+    }
+
+    for (;;) {
+        n = (AR_Node *) *ref;
+        if (checkPrefix(n, key, len, depth) != (n->prefixLen < AR_MAX_PREFIX ? n->prefixLen : AR_MAX_PREFIX))
+            return RC_IM_KEY_NOT_FOUND;
+        depth += n->prefixLen;
+        if (depth >= len || (child = findChild(n, key[depth])) == NULL)
+            return RC_IM_KEY_NOT_FOUND;
+
+        if (IS_LEAF(*child)) {
+            AR_Leaf *leaf = AS_LEAF(*child);
+
+            if (!leafMatches(leaf, key, len))
+                return RC_IM_KEY_NOT_FOUND;
+            removeChild(t, ref, child, key[depth]);
+            free(leaf);
+            return RC_OK;
+        }
+        ref = child;
+        depth++;
+    }
+}
+
+// visitLeaves
+/**
+ * Calls a visitor on the leaves below a slot of the tree in key order,
+ * from the first key >= the low bound of the range to the last key <= its
+ * high bound. Subtrees whose prefix is below the low bound are skipped.
+ *
+ * @param p Node or leaf.
+ * @param depth Key bytes consumed above p.
+ * @param range The key range.
+ * @param lowActive Whether keys below p can be under the low bound.
+ * @param visit The visitor.
+ * @param ctx Its context.
+ * @return RC_OK, RC_IM_NO_MORE_ENTRIES once past the high bound, or the
+ *         error of the visitor.
+ */
+static RC visitLeaves(void *p, int depth, AR_Range *range, bool lowActive, AR_Visitor visit, void *ctx) {
+    AR_Node *n;
+    int i;
+    RC rc;
+
+    if (IS_LEAF(p)) {
+        AR_Leaf *leaf = AS_LEAF(p);
+
+        if (lowActive && compareKeys(leaf->key, leaf->keyLen, range->low, range->lowLen) < 0)
+            return RC_OK;
+        if (range->highLen > 0 && compareKeys(leaf->key, leaf->keyLen, range->high, range->highLen) > 0)
+            return RC_IM_NO_MORE_ENTRIES;
+        return visit(leaf, ctx);
+    }
+
+    n = (AR_Node *) p;
+    if (lowActive && n->prefixLen > 0) {
+        const unsigned char *prefix = n->prefixLen <= AR_MAX_PREFIX ? n->prefix : minimumLeaf(n)->key + depth;
+
+        for (i = 0; i < n->prefixLen && lowActive; i++) {
+            if (depth + i >= range->lowLen || prefix[i] > range->low[depth + i])
+                lowActive = false;
+            else if (prefix[i] < range->low[depth + i])
+                return RC_OK;
+        }
+    }
+    depth += n->prefixLen;
+    if (depth >= range->lowLen)
+        lowActive = false;
+
+#define VISIT_CHILD(byte, child)                                                \
+    do {                                                                        \
+        if (lowActive && (byte) < range->low[depth])                            \
+            break;                                                              \
+        rc = visitLeaves((child), depth + 1, range,                             \
+                         lowActive && (byte) == range->low[depth], visit, ctx); \
+        if (rc != RC_OK)                                                        \
+            return rc;                                                          \
+    } while (0)
+
+    switch (n->type) {
+    case AR_NODE4:
+        for (i = 0; i < n->numChildren; i++)
+            VISIT_CHILD(((AR_Node4 *) n)->keys[i], ((AR_Node4 *) n)->children[i]);
+        break;
+    case AR_NODE16:
+        for (i = 0; i < n->numChildren; i++)
+            VISIT_CHILD(((AR_Node16 *) n)->keys[i], ((AR_Node16 *) n)->children[i]);
+        break;
+    case AR_NODE48:
+        for (i = 0; i < 256; i++) {
+            if (((AR_Node48 *) n)->childIndex[i])
+                VISIT_CHILD(i, ((AR_Node48 *) n)->children[((AR_Node48 *) n)->childIndex[i] - 1]);
+        }
+        break;
+    default:
+        for (i = 0; i < 256; i++) {
+            if (((AR_Node256 *) n)->children[i] != NULL)
+                VISIT_CHILD(i, ((AR_Node256 *) n)->children[i]);
+        }
+        break;
+    }
+#undef VISIT_CHILD
+    return RC_OK;
+}
+
+// Free a subtree and its leaves
+static void freeTree(AR_TreeMgmt *t, void *p) {
+    AR_Node *n;
+    int i;
+
+    if (p == NULL)
+        return;
+    if (IS_LEAF(p)) {
+        free(AS_LEAF(p));
+        return;
+    }
+    n = (AR_Node *) p;
+    switch (n->type) {
+    case AR_NODE4:
+        for (i = 0; i < n->numChildren; i++)
+            freeTree(t, ((AR_Node4 *) n)->children[i]);
+        break;
+    case AR_NODE16:
+        for (i = 0; i < n->numChildren; i++)
+            freeTree(t, ((AR_Node16 *) n)->children[i]);
+        break;
+    case AR_NODE48:
+        for (i = 0; i < n->numChildren; i++)
+            freeTree(t, ((AR_Node48 *) n)->children[i]);
+        break;
+    default:
+        for (i = 0; i < 256; i++)
+            freeTree(t, ((AR_Node256 *) n)->children[i]);
+        break;
+    }
+    freeNode(t, n);
+}
+
+// Snapshot writer: fills pages of entries and writes each one when full
+typedef struct AR_SnapshotWriter {
+    SM_FileHandle fh;
+    char *page;
+    int used;       // bytes of page in use, including the count
+    int count;      // entries in page
+    int pageNum;
+} AR_SnapshotWriter;
+
+static RC flushSnapshotPage(AR_SnapshotWriter *w) {
+    RC rc;
+
+    memcpy(w->page, &w->count, sizeof(int));
+    if ((rc = writeBlock(w->pageNum, &w->fh, w->page)) != RC_OK)
+        return rc;
+    w->pageNum++;
+    w->count = 0;
+    w->used = sizeof(int);
+    memset(w->page, 0, PAGE_SIZE);
+    return RC_OK;
+}
+
+static RC writeSnapshotEntry(AR_Leaf *leaf, void *ctx) {
+    AR_SnapshotWriter *w = (AR_SnapshotWriter *) ctx;
+    int size = sizeof(int) + leaf->keyLen + sizeof(RID);
+    RC rc;
+
+    if (w->used + size > PAGE_SIZE && (rc = flushSnapshotPage(w)) != RC_OK)
+        return rc;
+    memcpy(w->page + w->used, &leaf->keyLen, sizeof(int));
+    memcpy(w->page + w->used + sizeof(int), leaf->key, leaf->keyLen);
+    memcpy(w->page + w->used + sizeof(int) + leaf->keyLen, &leaf->rid, sizeof(RID));
+    w->used += size;
+    w->count++;
+    return RC_OK;
+}
+
+// writeSnapshot
+/**
+ * Writes the header and, for a persistent index or if withEntries is set,
+ * every entry to the index file.
+ *
+ * @return RC_OK, or the error of the storage manager.
+ */
+static RC writeSnapshot(AR_TreeHandle *tree, bool withEntries) {
+    AR_TreeMgmt *t = TREE_MGMT(tree);
+    AR_SnapshotWriter w;
+    AR_Header header;
+    AR_Range range;
+    RC rc;
+
+    memset(&w, 0, sizeof(w));
+    if ((rc = openPageFile(tree->idxId, &w.fh)) != RC_OK)
+        return rc;
+    if ((w.page = (char *) calloc(PAGE_SIZE, sizeof(char))) == NULL) {
+        closePageFile(&w.fh);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    w.used = sizeof(int);
+    w.pageNum = 1;
+
+    memset(&header, 0, sizeof(header));
+    header.keyType = tree->keyType;
+    header.persistent = t->persistent;
+    if (withEntries && t->root != NULL) {
+        range.lowLen = 0;
+        range.highLen = 0;
+        rc = visitLeaves(t->root, 0, &range, false, writeSnapshotEntry, &w);
+        if (rc == RC_OK && w.count > 0)
+            rc = flushSnapshotPage(&w);
+        header.numEntries = t->numEntries;
+    }
+
+    if (rc == RC_OK) {
+        memset(w.page, 0, PAGE_SIZE);
+        memcpy(w.page, &header, sizeof(header));
+        rc = writeBlock(0, &w.fh, w.page);
+    }
+    free(w.page);
+    closePageFile(&w.fh);
+    return rc;
+}
+
+// readSnapshot
+/**
+ * Inserts the entries of the snapshot into an empty tree.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC readSnapshot(AR_TreeMgmt *t, SM_FileHandle *fh, int numEntries) {
+    char *page = (char *) malloc(PAGE_SIZE);
+    int pageNum, read = 0;
+    RC rc = RC_OK;
+
+    if (page == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (pageNum = 1; read < numEntries && rc == RC_OK; pageNum++) {
+        int count, used = sizeof(int), i;
+
+        if ((rc = readBlock(pageNum, fh, page)) != RC_OK)
+            break;
+        memcpy(&count, page, sizeof(int));
+        for (i = 0; i < count && rc == RC_OK; i++, read++) {
+            AR_Leaf *leaf;
+            int len;
+            RID rid;
+
+            memcpy(&len, page + used, sizeof(int));
+            memcpy(&rid, page + used + sizeof(int) + len, sizeof(RID));
+            leaf = newLeaf((unsigned char *) page + used + sizeof(int), len, rid);
+            used += sizeof(int) + len + sizeof(RID);
+            if (leaf == NULL) {
+                rc = RC_MEM_ALLOCATION_FAIL;
+            } else if ((rc = insertLeaf(t, &t->root, leaf, 0)) != RC_OK) {
+                free(leaf);
+            } else {
+                t->numEntries++;
+            }
+        }
+    }
+    free(page);
+    return rc;
+}
+
+// createArt
+/**
+ * Creates the file of an empty index.
+ *
+ * @param idxId Name of the index file.
+ * @param keyType Type of the keys: INT, FLOAT, BOOL or STRING.
+ * @param persistent Whether closing the index writes its entries to the file.
+ * @return RC_OK, RC_RM_UNKNOWN_DATATYPE for another key type, or the error
+ *         of the storage manager.
+ */
+RC createArt(char *idxId, DataType keyType, bool persistent) {
+    SM_FileHandle fh;
+    AR_Header header;
+    char *page;
+    RC rc;
+
+    if (keyType != DT_INT && keyType != DT_FLOAT && keyType != DT_BOOL && keyType != DT_STRING)
+        return RC_RM_UNKNOWN_DATATYPE;
+
+    if ((rc = createPageFile(idxId)) != RC_OK)
+        return rc;
+    if ((rc = openPageFile(idxId, &fh)) != RC_OK)
+        return rc;
+
+    page = (char *) calloc(PAGE_SIZE, sizeof(char));
+    if (page == NULL) {
+        closePageFile(&fh);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    memset(&header, 0, sizeof(header));
+    header.keyType = keyType;
+    header.persistent = persistent;
+    memcpy(page, &header, sizeof(AR_Header));
+    rc = writeBlock(0, &fh, page);
+    free(page);
+    if (rc != RC_OK) {
+        closePageFile(&fh);
+        return rc;
+    }
+    return closePageFile(&fh);
+}
+
+// openArt
+/**
+ * Opens an index and loads its snapshot.
+ *
+ * @param tree Receives the handle; release it with closeArt.
+ * @param idxId Name of the index file.
+ * @return RC_OK, or an error code.
+ */
+RC openArt(AR_TreeHandle **tree, char *idxId) {
+    AR_TreeHandle *handle;
+    AR_TreeMgmt *t;
+    AR_Header header;
+    SM_FileHandle fh;
+    char *page;
+    RC rc;
+
+    *tree = NULL;
+    t = (AR_TreeMgmt *) calloc(1, sizeof(AR_TreeMgmt));
+    handle = (AR_TreeHandle *) malloc(sizeof(AR_TreeHandle));
+    page = (char *) malloc(PAGE_SIZE);
+    if (t == NULL || handle == NULL || page == NULL) {
+        free(t);
+        free(handle);
+        free(page);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+
+    if ((rc = openPageFile(idxId, &fh)) == RC_OK) {
+        rc = readBlock(0, &fh, page);
+        if (rc == RC_OK) {
+            memcpy(&header, page, sizeof(AR_Header));
+            t->persistent = header.persistent;
+            rc = readSnapshot(t, &fh, header.numEntries);
+        }
+        closePageFile(&fh);
+    }
+    free(page);
+    if (rc != RC_OK) {
+        freeTree(t, t->root);
+        free(t);
+        free(handle);
+        return rc;
+    }
+
+    handle->keyType = header.keyType;
+    handle->idxId = strdup(idxId);
+    handle->mgmtData = t;
+    *tree = handle;
+    return RC_OK;
+}
+
+// closeArt
+/**
+ * Closes an index, writing its snapshot if it is persistent.
+ *
+ * @param tree The index.
+ * @return RC_OK, or the error of the storage manager.
+ */
+RC closeArt(AR_TreeHandle *tree) {
+    AR_TreeMgmt *t = TREE_MGMT(tree);
+    RC rc = RC_OK;
+
+    if (t->persistent)
+        rc = writeSnapshot(tree, true);
+    freeTree(t, t->root);
+    free(tree->idxId);
+    free(t);
+    free(tree);
+    return rc;
+}
+
+// Remove the file of an index
+RC deleteArt(char *idxId) {
+    return destroyPageFile(idxId);
+}
+
+// Write every entry to the file of an index
+RC artSaveSnapshot(AR_TreeHandle *tree) {
+    return writeSnapshot(tree, true);
+}
+
+// Get the number of inner nodes
+RC getArtNumNodes(AR_TreeHandle *tree, int *result) {
+    *result = TREE_MGMT(tree)->numNodes;
+    return RC_OK;
+}
+
+// Get the number of keys
+RC getArtNumEntries(AR_TreeHandle *tree, int *result) {
+    *result = TREE_MGMT(tree)->numEntries;
+    return RC_OK;
+}
+
+// artFindKey
+/**
+ * Looks a key up. The prefixes on the way down are checked as far as the
+ * nodes store them; the leaf's full key settles the match.
+ *
+ * @param tree The index.
+ * @param key The key.
+ * @param result Receives its RID.
+ * @return RC_OK, RC_IM_KEY_NOT_FOUND, or an error code for a key of the
+ *         wrong type.
+ */
+RC artFindKey(AR_TreeHandle *tree, Value *key, RID *result) {
+    unsigned char k[AR_MAX_KEY];
+    void *p = TREE_MGMT(tree)->root;
+    int len, depth = 0;
+    RC rc;
+
+    if ((rc = toKey(tree, key, k, &len)) != RC_OK)
+        return rc;
+
+    while (p != NULL) {
+        AR_Node *n;
+        void **child;
+
+        if (IS_LEAF(p)) {
+            if (!leafMatches(AS_LEAF(p), k, len))
+                return RC_IM_KEY_NOT_FOUND;
+            *result = AS_LEAF(p)->rid;
+            return RC_OK;
+        }
+        n = (AR_Node *) p;
+        if (n->prefixLen > 0) {
+            if (checkPrefix(n, k, len, depth) != (n->prefixLen < AR_MAX_PREFIX ? n->prefixLen : AR_MAX_PREFIX))
+                return RC_IM_KEY_NOT_FOUND;
+            depth += n->prefixLen;
+        }
+        if (depth >= len || (child = findChild(n, k[depth])) == NULL)
+            return RC_IM_KEY_NOT_FOUND;
+        p = *child;
+        depth++;
+    }
+    return RC_IM_KEY_NOT_FOUND;
+}
+
+// artInsertKey
+/**
+ * Adds a key.
+ *
+ * @param tree The index.
+ * @param key The key.
+ * @param rid Its RID.
+ * @return RC_OK, RC_IM_KEY_ALREADY_EXISTS, or an error code.
+ */
+RC artInsertKey(AR_TreeHandle *tree, Value *key, RID rid) {
+    AR_TreeMgmt *t = TREE_MGMT(tree);
+    unsigned char k[AR_MAX_KEY];
+    AR_Leaf *leaf;
+    int len;
+    RC rc;
+
+    if ((rc = toKey(tree, key, k, &len)) != RC_OK)
+        return rc;
+    if ((leaf = newLeaf(k, len, rid)) == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    if ((rc = insertLeaf(t, &t->root, leaf, 0)) != RC_OK) {
+        free(leaf);
+        return rc;
+    }
+    t->numEntries++;
+    return RC_OK;
+}
+
+// artDeleteKey
+/**
+ * Removes a key.
+ *
+ * @param tree The index.
+ * @param key The key.
+ * @return RC_OK, RC_IM_KEY_NOT_FOUND, or an error code.
+ */
+RC artDeleteKey(AR_TreeHandle *tree, Value *key) {
+    AR_TreeMgmt *t = TREE_MGMT(tree);
+    unsigned char k[AR_MAX_KEY];
+    int len;
+    RC rc;
+
+    if ((rc = toKey(tree, key, k, &len)) != RC_OK)
+        return rc;
+    if ((rc = deleteFrom(t, &t->root, k, len, 0)) != RC_OK)
+        return rc;
+    t->numEntries--;
+    return RC_OK;
+}
+
+static RC collectRid(AR_Leaf *leaf, void *ctx) {
+    AR_ScanMgmt *sm = (AR_ScanMgmt *) ctx;
+
+    if (sm->count == sm->capacity) {
+        int capacity = sm->capacity > 0 ? 2 * sm->capacity : 64;
+        RID *rids = (RID *) realloc(sm->rids, capacity * sizeof(RID));
+
+        if (rids == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        sm->rids = rids;
+        sm->capacity = capacity;
+    }
+    sm->rids[sm->count++] = leaf->rid;
+    return RC_OK;
+}
+
+// openArtRangeScan
+/**
+ * Starts a scan over the keys from low to high. The RIDs are collected
+ * when the scan opens, so later updates of the index do not affect it.
+ *
+ * @param tree The index.
+ * @param low Smallest key returned, or NULL.
+ * @param high Largest key returned, or NULL.
+ * @param handle Receives the scan; release it with closeArtScan.
+ * @return RC_OK, or an error code.
+ */
+RC openArtRangeScan(AR_TreeHandle *tree, Value *low, Value *high, AR_ScanHandle **handle) {
+    AR_TreeMgmt *t = TREE_MGMT(tree);
+    AR_ScanHandle *h;
+    AR_ScanMgmt *sm;
+    AR_Range range;
+    RC rc = RC_OK;
+
+    *handle = NULL;
+    range.lowLen = 0;
+    range.highLen = 0;
+    if (low != NULL && (rc = toKey(tree, low, range.low, &range.lowLen)) != RC_OK)
+        return rc;
+    if (high != NULL && (rc = toKey(tree, high, range.high, &range.highLen)) != RC_OK)
+        return rc;
+
+    h = (AR_ScanHandle *) malloc(sizeof(AR_ScanHandle));
+    sm = (AR_ScanMgmt *) calloc(1, sizeof(AR_ScanMgmt));
+    if (h == NULL || sm == NULL) {
+        free(h);
+        free(sm);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    if (t->root != NULL)
+        rc = visitLeaves(t->root, 0, &range, range.lowLen > 0, collectRid, sm);
+    if (rc != RC_OK && rc != RC_IM_NO_MORE_ENTRIES) {
+        free(sm->rids);
+        free(sm);
+        free(h);
+        return rc;
+    }
+
+    h->tree = tree;
+    h->mgmtData = sm;
+    *handle = h;
+    return RC_OK;
+}
+
+// Start a scan over every key
+RC openArtScan(AR_TreeHandle *tree, AR_ScanHandle **handle) {
+    return openArtRangeScan(tree, NULL, NULL, handle);
+}
+
+// artNextEntry
+/**
+ * Returns the RID of the next key of a scan.
+ *
+ * @param handle The scan.
+ * @param result Receives the RID.
+ * @return RC_OK, or RC_IM_NO_MORE_ENTRIES at the end.
+ */
+RC artNextEntry(AR_ScanHandle *handle, RID *result) {
+    AR_ScanMgmt *sm = (AR_ScanMgmt *) handle->mgmtData;
+
+    if (sm->pos == sm->count)
+        return RC_IM_NO_MORE_ENTRIES;
+    *result = sm->rids[sm->pos++];
+    return RC_OK;
+}
+
+// Release a scan
+RC closeArtScan(AR_ScanHandle *handle) {
+    AR_ScanMgmt *sm = (AR_ScanMgmt *) handle->mgmtData;
+
+    free(sm->rids);
+    free(sm);
+    free(handle);
+    return RC_OK;
+}
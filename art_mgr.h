@@ -0,0 +1,57 @@
+#ifndef ART_MGR_H
+#define ART_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+
+// In-memory ordered index (adaptive radix tree)
+//
+// The tree lives in memory and branches on one byte of the normalized key
+// per level, with nodes of 4, 16, 48 or 256 children that grow and shrink
+// with their fan-out, and with runs of single-child levels collapsed into a
+// prefix. A lookup costs one node per key byte at most, without comparing
+// whole keys until the leaf. Keys are INT, FLOAT, BOOL or STRING values and
+// are unique, as in btree_mgr.h.
+//
+// The page file of the index holds a snapshot of its entries. A persistent
+// index writes the snapshot on close and reads it back on open; otherwise
+// the entries are lost on close and the owner rebuilds the index.
+
+// structure for accessing radix tree indexes
+typedef struct AR_TreeHandle {
+  DataType keyType;
+  char *idxId;
+  void *mgmtData;
+} AR_TreeHandle;
+
+typedef struct AR_ScanHandle {
+  AR_TreeHandle *tree;
+  void *mgmtData;
+} AR_ScanHandle;
+
+// create, destroy, open, and close an index
+extern RC createArt (char *idxId, DataType keyType, rm_bool persistent);
+extern RC openArt (AR_TreeHandle **tree, char *idxId);
+extern RC closeArt (AR_TreeHandle *tree);
+extern RC deleteArt (char *idxId);
+
+// write the snapshot now, whether or not the index is persistent
+extern RC artSaveSnapshot (AR_TreeHandle *tree);
+
+// access information about an index
+extern RC getArtNumNodes (AR_TreeHandle *tree, int *result);
+extern RC getArtNumEntries (AR_TreeHandle *tree, int *result);
+
+// index access
+extern RC artFindKey (AR_TreeHandle *tree, Value *key, RID *result);
+extern RC artInsertKey (AR_TreeHandle *tree, Value *key, RID rid);
+extern RC artDeleteKey (AR_TreeHandle *tree, Value *key);
+
+// scans return RIDs in key order; a range scan covers low <= key <= high,
+// where a NULL bound is open
+extern RC openArtScan (AR_TreeHandle *tree, AR_ScanHandle **handle);
+extern RC openArtRangeScan (AR_TreeHandle *tree, Value *low, Value *high, AR_ScanHandle **handle);
+extern RC artNextEntry (AR_ScanHandle *handle, RID *result);
+extern RC closeArtScan (AR_ScanHandle *handle);
+
+#endif // ART_MGR_H
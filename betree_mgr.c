@@ -0,0 +1,1039 @@
+#include "betree_mgr.h"
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+#include "norm_key.h"
+#include <stdlib.h>
+#include <string.h>
+
+// B-epsilon tree over the buffer pool
+//
+// Page 0 is the tree header, every other page one node. Leaves hold sorted
+// (key, RID) entries and are chained left to right. An inner node holds up
+// to fanout children and fanout - 1 pivots; the rest of its page is a
+// buffer of messages (insert or delete of a key), sorted by key, with at
+// most one message per key: a newer message replaces an older one.
+//
+// An update is added to the root's buffer. When that buffer overflows, the
+// messages of the child that has the most of them are pushed into the
+// child in one go: merged into its buffer, which may overflow in turn, or
+// applied to its entries if it is a leaf. Nodes that grow too large split,
+// and their new siblings are added to the parent the same way as in a
+// B+-tree. A lookup checks the buffers on its way down, as the newest
+// message for a key is the one nearest to the root. Nodes are never merged.
+//
+// Keys are single INT, FLOAT or BOOL values, stored as the unsigned int
+// read from their normalized form (see norm_key.h), so that comparing two
+// keys is an integer compare.
+
+#define BE_POOL_SIZE 64
+
+// message operations
+#define BE_INSERT 1
+#define BE_DELETE 2
+
+// Tree header, stored at the start of page 0
+typedef struct BE_Header {
+    int keyType;
+    int fanout;     // maximum number of children of an inner node
+    int root;
+    int height;     // levels including the leaves; 1 while the root is a leaf
+    int numNodes;
+    int numPages;   // pages in the file, header included
+} BE_Header;
+
+// Node page layout: this header, then BE_Entry entries[] in a leaf, or
+// unsigned int pivots[fanout - 1], int children[fanout] and BE_Message
+// msgs[] in an inner node
+typedef struct BE_Node {
+    int isLeaf;
+    int numKeys;    // entries of a leaf, pivots of an inner node
+    int numMsgs;
+    int next;       // right sibling of a leaf, -1 for the last leaf
+    unsigned int data[];
+} BE_Node;
+
+typedef struct BE_Entry {
+    unsigned int key;
+    RID rid;
+} BE_Entry;
+
+typedef struct BE_Message {
+    unsigned int key;
+    int op;
+    RID rid;        // for BE_INSERT
+} BE_Message;
+
+// Inner node while a flush works on it; it may hold more pivots and
+// messages than a page until it is written back
+typedef struct BE_Inner {
+    int numKeys;
+    int keyCap;
+    unsigned int *pivots;
+    int *children;
+    int numMsgs;
+    int msgCap;
+    BE_Message *msgs;
+} BE_Inner;
+
+// New right siblings of a node that was split, for its parent
+typedef struct BE_Splits {
+    int count;
+    int cap;
+    unsigned int *keys; // smallest key of each sibling
+    int *pages;
+} BE_Splits;
+
+// Per-tree state, kept in BE_TreeHandle.mgmtData
+typedef struct BE_TreeMgmt {
+    BM_BufferPool pool;
+    SM_FileHandle fh;
+    BE_Header header;   // cached copy of page 0, written back on close
+} BE_TreeMgmt;
+
+// Scan state, kept in BE_ScanHandle.mgmtData
+typedef struct BE_ScanMgmt {
+    BM_PageHandle page; // current leaf, pinned while pinned is set
+    bool pinned;
+    int pos;            // next entry in the leaf
+} BE_ScanMgmt;
+
+#define TREE_MGMT(tree) ((BE_TreeMgmt *) (tree)->mgmtData)
+#define NODE(data) ((BE_Node *) (data))
+
+#define BE_LEAF_CAPACITY ((int) ((PAGE_SIZE - sizeof(BE_Node)) / sizeof(BE_Entry)))
+
+// Messages an inner node of the given fanout has room for
+static int bufferCapacity(int fanout) {
+    return (PAGE_SIZE - sizeof(BE_Node) - (2 * fanout - 1) * sizeof(int)) / sizeof(BE_Message);
+}
+
+static BE_Entry *leafEntries(BE_Node *node) {
+    return (BE_Entry *) node->data;
+}
+
+static unsigned int *innerPivots(BE_Node *node) {
+    return node->data;
+}
+
+static int *innerChildren(BE_TreeMgmt *t, BE_Node *node) {
+    return (int *) (node->data + t->header.fanout - 1);
+}
+
+static BE_Message *innerMessages(BE_TreeMgmt *t, BE_Node *node) {
+    return (BE_Message *) (node->data + 2 * t->header.fanout - 1);
+}
+
+static BM_PageHint levelHint(BE_TreeMgmt *t, int level) {
+    return level < t->header.height - 1 ? BM_HINT_HOT : BM_HINT_NORMAL;
+}
+
+// Child of an inner node that covers key: the number of pivots <= key
+static int childFor(const unsigned int *pivots, int n, unsigned int key) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (pivots[mid] <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// First message whose key is >= key
+static int findMessage(const BE_Message *msgs, int n, unsigned int key) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (msgs[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// First entry whose key is >= key
+static int findEntry(const BE_Entry *entries, int n, unsigned int key) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (entries[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// toKey
+/**
+ * Converts a key value into the unsigned int compared in the nodes.
+ *
+ * @param t The tree.
+ * @param value The key; must be of the tree's key type.
+ * @param key Receives the stored key.
+ * @return RC_OK, or an error code for a value of the wrong type.
+ */
+static RC toKey(BE_TreeMgmt *t, Value *value, unsigned int *key) {
+    unsigned char bytes[4] = { 0, 0, 0, 0 };
+    RC rc;
+
+    if (value->dt != t->header.keyType)
+        return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+    if ((rc = normalizeValue(value, 0, (char *) bytes)) != RC_OK)
+        return rc;
+    *key = ((unsigned int) bytes[0] << 24) | ((unsigned int) bytes[1] << 16)
+           | ((unsigned int) bytes[2] << 8) | bytes[3];
+    return RC_OK;
+}
+
+// allocNode
+/**
+ * Appends an empty node to the index file and leaves it pinned.
+ *
+ * @param t The tree.
+ * @param isLeaf Whether the node is a leaf.
+ * @param page Receives the pinned page.
+ * @return RC_OK on success, or the error of the storage or buffer manager.
+ */
+static RC allocNode(BE_TreeMgmt *t, bool isLeaf, BM_PageHandle *page) {
+    int pageNum = t->header.numPages;
+    BE_Node *node;
+    RC rc;
+
+    if ((rc = ensureCapacity(pageNum + 1, &t->fh)) != RC_OK)
+        return rc;
+    if ((rc = pinPageWithHint(&t->pool, page, pageNum, isLeaf ? BM_HINT_NORMAL : BM_HINT_HOT)) != RC_OK)
+        return rc;
+
+    memset(page->data, 0, PAGE_SIZE);
+    node = NODE(page->data);
+    node->isLeaf = isLeaf;
+    node->next = -1;
+    markDirty(&t->pool, page);
+    t->header.numPages++;
+    t->header.numNodes++;
+    return RC_OK;
+}
+
+// Add a new sibling to a list of splits
+static RC addSplit(BE_Splits *splits, unsigned int key, int page) {
+    if (splits->count == splits->cap) {
+        int cap = splits->cap ? 2 * splits->cap : 4;
+        unsigned int *keys = (unsigned int *) realloc(splits->keys, cap * sizeof(unsigned int));
+        int *pages;
+
+        if (keys == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        splits->keys = keys;
+        if ((pages = (int *) realloc(splits->pages, cap * sizeof(int))) == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        splits->pages = pages;
+        splits->cap = cap;
+    }
+    splits->keys[splits->count] = key;
+    splits->pages[splits->count] = page;
+    splits->count++;
+    return RC_OK;
+}
+
+static void freeSplits(BE_Splits *splits) {
+    free(splits->keys);
+    free(splits->pages);
+    memset(splits, 0, sizeof(BE_Splits));
+}
+
+// Make room for numKeys pivots and numMsgs messages in a working node
+static RC growInner(BE_Inner *w, int numKeys, int numMsgs) {
+    if (numKeys > w->keyCap) {
+        int cap = 2 * numKeys;
+        unsigned int *pivots = (unsigned int *) realloc(w->pivots, cap * sizeof(unsigned int));
+        int *children;
+
+        if (pivots == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        w->pivots = pivots;
+        if ((children = (int *) realloc(w->children, (cap + 1) * sizeof(int))) == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        w->children = children;
+        w->keyCap = cap;
+    }
+    if (numMsgs > w->msgCap) {
+        int cap = 2 * numMsgs;
+        BE_Message *msgs = (BE_Message *) realloc(w->msgs, cap * sizeof(BE_Message));
+
+        if (msgs == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        w->msgs = msgs;
+        w->msgCap = cap;
+    }
+    return RC_OK;
+}
+
+static void freeInner(BE_Inner *w) {
+    free(w->pivots);
+    free(w->children);
+    free(w->msgs);
+}
+
+// Copy an inner node into a working node
+static RC loadInner(BE_TreeMgmt *t, BE_Node *node, BE_Inner *w) {
+    RC rc;
+
+    memset(w, 0, sizeof(BE_Inner));
+    if ((rc = growInner(w, t->header.fanout, bufferCapacity(t->header.fanout) + 1)) != RC_OK)
+        return rc;
+    w->numKeys = node->numKeys;
+    w->numMsgs = node->numMsgs;
+    memcpy(w->pivots, innerPivots(node), node->numKeys * sizeof(unsigned int));
+    memcpy(w->children, innerChildren(t, node), (node->numKeys + 1) * sizeof(int));
+    memcpy(w->msgs, innerMessages(t, node), node->numMsgs * sizeof(BE_Message));
+    return RC_OK;
+}
+
+// mergeMessages
+/**
+ * Merges sorted messages into the buffer of a working node. A message
+ * replaces a buffered one for the same key, as it is newer.
+ *
+ * @return RC_OK, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC mergeMessages(BE_Inner *w, const BE_Message *msgs, int count) {
+    BE_Message *merged;
+    int i = 0, j = 0, n = 0;
+
+    if (count == 0)
+        return RC_OK;
+    merged = (BE_Message *) malloc((w->numMsgs + count) * sizeof(BE_Message));
+    if (merged == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+
+    while (i < w->numMsgs || j < count) {
+        if (j == count || (i < w->numMsgs && w->msgs[i].key < msgs[j].key)) {
+            merged[n++] = w->msgs[i++];
+        } else {
+            if (i < w->numMsgs && w->msgs[i].key == msgs[j].key)
+                i++;
+            merged[n++] = msgs[j++];
+        }
+    }
+
+    free(w->msgs);
+    w->msgs = merged;
+    w->msgCap = w->numMsgs + count;
+    w->numMsgs = n;
+    return RC_OK;
+}
+
+// applyToLeaf
+/**
+ * Applies sorted messages to a pinned leaf, splitting it into as many
+ * leaves as its entries need.
+ *
+ * @param t The tree.
+ * @param page The leaf, pinned.
+ * @param msgs The messages, sorted by key.
+ * @param count Number of messages.
+ * @param splits Receives the new right siblings.
+ * @return RC_OK on success, or an error code.
+ */
+static RC applyToLeaf(BE_TreeMgmt *t, BM_PageHandle *page, const BE_Message *msgs, int count, BE_Splits *splits) {
+    BE_Node *node = NODE(page->data);
+    BE_Entry *old = leafEntries(node);
+    BE_Node *last = node;
+    BM_PageHandle lastPage;
+    bool lastPinned = false;
+    BE_Entry *entries;
+    int i = 0, j = 0, n = 0, pieces, p;
+    RC rc = RC_OK;
+
+    if (count == 0)
+        return RC_OK;
+    entries = (BE_Entry *) malloc((node->numKeys + count) * sizeof(BE_Entry));
+    if (entries == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+
+    while (i < node->numKeys || j < count) {
+        if (j == count || (i < node->numKeys && old[i].key < msgs[j].key)) {
+            entries[n++] = old[i++];
+            continue;
+        }
+        if (i < node->numKeys && old[i].key == msgs[j].key)
+            i++;
+        if (msgs[j].op == BE_INSERT) {
+            entries[n].key = msgs[j].key;
+            entries[n].rid = msgs[j].rid;
+            n++;
+        }
+        j++;
+    }
+
+    // Spread the entries evenly over as few leaves as hold them
+    pieces = (n + BE_LEAF_CAPACITY - 1) / BE_LEAF_CAPACITY;
+    if (pieces < 1)
+        pieces = 1;
+    node->numKeys = n / pieces;
+    memcpy(old, entries, node->numKeys * sizeof(BE_Entry));
+    markDirty(&t->pool, page);
+
+    for (p = 1; p < pieces && rc == RC_OK; p++) {
+        int start = (int) ((long) n * p / pieces);
+        int end = (int) ((long) n * (p + 1) / pieces);
+        BM_PageHandle sibling;
+        BE_Node *right;
+
+        if ((rc = allocNode(t, true, &sibling)) != RC_OK)
+            break;
+        right = NODE(sibling.data);
+        right->numKeys = end - start;
+        memcpy(leafEntries(right), entries + start, right->numKeys * sizeof(BE_Entry));
+
+        // chain the sibling after the last piece so far
+        right->next = last->next;
+        last->next = sibling.pageNum;
+        rc = addSplit(splits, entries[start].key, sibling.pageNum);
+        if (lastPinned)
+            unpinPage(&t->pool, &lastPage);
+        lastPage = sibling;
+        lastPinned = true;
+        last = right;
+    }
+    if (lastPinned)
+        unpinPage(&t->pool, &lastPage);
+
+    free(entries);
+    return rc;
+}
+
+// writeInner
+/**
+ * Writes a working node back to its page, splitting it into as many inner
+ * nodes as its children need. The buffer must fit one page.
+ *
+ * @param t The tree.
+ * @param page The node's page, pinned.
+ * @param w The working node.
+ * @param splits Receives the new right siblings.
+ * @return RC_OK on success, or an error code.
+ */
+static RC writeInner(BE_TreeMgmt *t, BM_PageHandle *page, BE_Inner *w, BE_Splits *splits) {
+    int numChildren = w->numKeys + 1;
+    int fanout = t->header.fanout;
+    int pieces = (numChildren + fanout - 1) / fanout;
+    int p, msg = 0;
+    RC rc;
+
+    for (p = 0; p < pieces; p++) {
+        int start = (int) ((long) numChildren * p / pieces);
+        int end = (int) ((long) numChildren * (p + 1) / pieces);
+        int firstMsg = msg;
+        BM_PageHandle sibling;
+        BE_Node *node;
+
+        // messages below the next piece's separator belong to this piece
+        while (msg < w->numMsgs && (end == numChildren || w->msgs[msg].key < w->pivots[end - 1]))
+            msg++;
+
+        if (p == 0) {
+            sibling = *page;
+        } else {
+            if ((rc = allocNode(t, false, &sibling)) != RC_OK)
+                return rc;
+            if ((rc = addSplit(splits, w->pivots[start - 1], sibling.pageNum)) != RC_OK) {
+                unpinPage(&t->pool, &sibling);
+                return rc;
+            }
+        }
+        node = NODE(sibling.data);
+        node->numKeys = end - start - 1;
+        node->numMsgs = msg - firstMsg;
+        memcpy(innerPivots(node), w->pivots + start, node->numKeys * sizeof(unsigned int));
+        memcpy(innerChildren(t, node), w->children + start, (end - start) * sizeof(int));
+        memcpy(innerMessages(t, node), w->msgs + firstMsg, node->numMsgs * sizeof(BE_Message));
+        markDirty(&t->pool, &sibling);
+        if (p > 0)
+            unpinPage(&t->pool, &sibling);
+    }
+    return RC_OK;
+}
+
+static RC pushMessages(BE_TreeMgmt *t, int pageNum, int level, const BE_Message *msgs, int count,
+                       bool drain, BE_Splits *splits);
+
+// flushChild
+/**
+ * Pushes the buffered messages of one child of a working node down into
+ * that child and adds the child's new siblings to the node.
+ *
+ * @param t The tree.
+ * @param w The working node.
+ * @param level Its level.
+ * @param child The child.
+ * @param drain Whether to empty the buffers of the whole subtree.
+ * @param added Receives the number of siblings added after child.
+ * @return RC_OK on success, or an error code.
+ */
+static RC flushChild(BE_TreeMgmt *t, BE_Inner *w, int level, int child, bool drain, int *added) {
+    BE_Splits childSplits = { 0, 0, NULL, NULL };
+    BE_Message *batch;
+    int first = 0, last = w->numMsgs, count;
+    RC rc;
+
+    if (child > 0)
+        first = findMessage(w->msgs, w->numMsgs, w->pivots[child - 1]);
+    if (child < w->numKeys)
+        last = findMessage(w->msgs, w->numMsgs, w->pivots[child]);
+    count = last - first;
+    *added = 0;
+
+    batch = (BE_Message *) malloc((count > 0 ? count : 1) * sizeof(BE_Message));
+    if (batch == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    memcpy(batch, w->msgs + first, count * sizeof(BE_Message));
+    memmove(w->msgs + first, w->msgs + last, (w->numMsgs - last) * sizeof(BE_Message));
+    w->numMsgs -= count;
+
+    rc = pushMessages(t, w->children[child], level + 1, batch, count, drain, &childSplits);
+    free(batch);
+    if (rc == RC_OK && childSplits.count > 0) {
+        int n = childSplits.count;
+
+        if ((rc = growInner(w, w->numKeys + n, 0)) == RC_OK) {
+            memmove(w->pivots + child + n, w->pivots + child, (w->numKeys - child) * sizeof(unsigned int));
+            memmove(w->children + child + 1 + n, w->children + child + 1, (w->numKeys - child) * sizeof(int));
+            memcpy(w->pivots + child, childSplits.keys, n * sizeof(unsigned int));
+            memcpy(w->children + child + 1, childSplits.pages, n * sizeof(int));
+            w->numKeys += n;
+            *added = n;
+        }
+    }
+    freeSplits(&childSplits);
+    return rc;
+}
+
+// Child of a working node with the most buffered messages
+static int fullestChild(BE_Inner *w) {
+    int best = 0, bestCount = 0, child = 0, count = 0, i;
+
+    for (i = 0; i < w->numMsgs; i++) {
+        if (child < w->numKeys && w->msgs[i].key >= w->pivots[child]) {
+            while (child < w->numKeys && w->msgs[i].key >= w->pivots[child])
+                child++;
+            count = 0;
+        }
+        if (++count > bestCount) {
+            best = child;
+            bestCount = count;
+        }
+    }
+    return best;
+}
+
+// pushMessages
+/**
+ * Delivers sorted messages to a node: a leaf applies them, an inner node
+ * merges them into its buffer and, while the buffer overflows, flushes its
+ * fullest child.
+ *
+ * @param t The tree.
+ * @param pageNum The node.
+ * @param level Its level, 0 for the root.
+ * @param msgs The messages, sorted by key.
+ * @param count Number of messages.
+ * @param drain Whether to empty every buffer of the subtree.
+ * @param splits Receives the new right siblings of the node.
+ * @return RC_OK on success, or an error code.
+ */
+static RC pushMessages(BE_TreeMgmt *t, int pageNum, int level, const BE_Message *msgs, int count,
+                       bool drain, BE_Splits *splits) {
+    int capacity = bufferCapacity(t->header.fanout);
+    BM_PageHandle page;
+    BE_Inner w;
+    int added, child;
+    RC rc;
+
+    if ((rc = pinPageWithHint(&t->pool, &page, pageNum, levelHint(t, level))) != RC_OK)
+        return rc;
+
+    if (NODE(page.data)->isLeaf) {
+        rc = applyToLeaf(t, &page, msgs, count, splits);
+        unpinPage(&t->pool, &page);
+        return rc;
+    }
+    if (!drain && count == 0) {
+        unpinPage(&t->pool, &page);
+        return RC_OK;
+    }
+
+    if ((rc = loadInner(t, NODE(page.data), &w)) == RC_OK)
+        rc = mergeMessages(&w, msgs, count);
+    if (drain) {
+        for (child = 0; rc == RC_OK && child <= w.numKeys; child += added + 1)
+            rc = flushChild(t, &w, level, child, true, &added);
+    } else {
+        while (rc == RC_OK && w.numMsgs > capacity)
+            rc = flushChild(t, &w, level, fullestChild(&w), false, &added);
+    }
+    if (rc == RC_OK)
+        rc = writeInner(t, &page, &w, splits);
+
+    freeInner(&w);
+    unpinPage(&t->pool, &page);
+    return rc;
+}
+
+// growRoot
+/**
+ * Puts new inner nodes above a root that was split, until one root is left.
+ *
+ * @param t The tree.
+ * @param splits The new right siblings of the root; freed.
+ * @return RC_OK on success, or an error code.
+ */
+static RC growRoot(BE_TreeMgmt *t, BE_Splits *splits) {
+    RC rc = RC_OK;
+
+    while (rc == RC_OK && splits->count > 0) {
+        BE_Splits above = { 0, 0, NULL, NULL };
+        BM_PageHandle page;
+        BE_Inner w;
+
+        memset(&w, 0, sizeof(BE_Inner));
+        if ((rc = growInner(&w, splits->count, 1)) != RC_OK)
+            break;
+        w.numKeys = splits->count;
+        memcpy(w.pivots, splits->keys, splits->count * sizeof(unsigned int));
+        w.children[0] = t->header.root;
+        memcpy(w.children + 1, splits->pages, splits->count * sizeof(int));
+
+        if ((rc = allocNode(t, false, &page)) == RC_OK) {
+            rc = writeInner(t, &page, &w, &above);
+            t->header.root = page.pageNum;
+            t->header.height++;
+            unpinPage(&t->pool, &page);
+        }
+        freeInner(&w);
+        freeSplits(splits);
+        *splits = above;
+    }
+    freeSplits(splits);
+    return rc;
+}
+
+// applyMessage
+/**
+ * Adds one insert or delete to the tree. While the root's buffer has room
+ * the message is only added there, else it is pushed down with a flush.
+ *
+ * @param t The tree.
+ * @param msg The message.
+ * @return RC_OK on success, or an error code.
+ */
+static RC applyMessage(BE_TreeMgmt *t, const BE_Message *msg) {
+    BE_Splits splits = { 0, 0, NULL, NULL };
+    BM_PageHandle page;
+    BE_Node *root;
+    RC rc;
+
+    if ((rc = pinPageWithHint(&t->pool, &page, t->header.root, levelHint(t, 0))) != RC_OK)
+        return rc;
+    root = NODE(page.data);
+
+    if (!root->isLeaf) {
+        BE_Message *msgs = innerMessages(t, root);
+        int pos = findMessage(msgs, root->numMsgs, msg->key);
+        bool replace = pos < root->numMsgs && msgs[pos].key == msg->key;
+
+        if (replace || root->numMsgs < bufferCapacity(t->header.fanout)) {
+            if (!replace) {
+                memmove(msgs + pos + 1, msgs + pos, (root->numMsgs - pos) * sizeof(BE_Message));
+                root->numMsgs++;
+            }
+            msgs[pos] = *msg;
+            markDirty(&t->pool, &page);
+            return unpinPage(&t->pool, &page);
+        }
+    }
+    unpinPage(&t->pool, &page);
+
+    if ((rc = pushMessages(t, t->header.root, 0, msg, 1, false, &splits)) != RC_OK) {
+        freeSplits(&splits);
+        return rc;
+    }
+    return growRoot(t, &splits);
+}
+
+// createBeTree
+/**
+ * Creates an empty index file: the header page and an empty root leaf.
+ *
+ * @param idxId Name of the index file.
+ * @param keyType DT_INT, DT_FLOAT or DT_BOOL.
+ * @param fanout Maximum number of children of an inner node.
+ * @return RC_OK on success, RC_IM_N_TO_LAGE if the buffer of an inner node
+ *         would not hold two messages per child, or an error code.
+ */
+RC createBeTree(char *idxId, DataType keyType, int fanout) {
+    SM_FileHandle fh;
+    BE_Header header;
+    char *page;
+    RC rc;
+
+    if (keyType != DT_INT && keyType != DT_FLOAT && keyType != DT_BOOL)
+        return RC_RM_UNKNOWN_DATATYPE;
+    if (fanout < 3)
+        return RC_INVALID_ARGS;
+    if (bufferCapacity(fanout) < 2 * fanout)
+        return RC_IM_N_TO_LAGE;
+
+    if ((rc = createPageFile(idxId)) != RC_OK)
+        return rc;
+    if ((rc = openPageFile(idxId, &fh)) != RC_OK)
+        return rc;
+
+    page = (char *) calloc(PAGE_SIZE, sizeof(char));
+    if (page == NULL) {
+        closePageFile(&fh);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+
+    header.keyType = keyType;
+    header.fanout = fanout;
+    header.root = 1;
+    header.height = 1;
+    header.numNodes = 1;
+    header.numPages = 2;
+    memcpy(page, &header, sizeof(BE_Header));
+    rc = writeBlock(0, &fh, page);
+
+    // page 1: the root, an empty leaf
+    if (rc == RC_OK) {
+        memset(page, 0, PAGE_SIZE);
+        NODE(page)->isLeaf = true;
+        NODE(page)->next = -1;
+        rc = writeBlock(1, &fh, page);
+    }
+
+    free(page);
+    if (rc != RC_OK) {
+        closePageFile(&fh);
+        return rc;
+    }
+    return closePageFile(&fh);
+}
+
+// openBeTree
+/**
+ * Opens an index and sets up its buffer pool.
+ *
+ * @param tree Receives the new handle; release it with closeBeTree.
+ * @param idxId Name of the index file.
+ * @return RC_OK on success, or an error code.
+ */
+RC openBeTree(BE_TreeHandle **tree, char *idxId) {
+    BE_TreeHandle *handle;
+    BE_TreeMgmt *t;
+    BM_PageHandle page;
+    RC rc;
+
+    *tree = NULL;
+    t = (BE_TreeMgmt *) calloc(1, sizeof(BE_TreeMgmt));
+    handle = (BE_TreeHandle *) malloc(sizeof(BE_TreeHandle));
+    if (t == NULL || handle == NULL) {
+        free(t);
+        free(handle);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+
+    if ((rc = openPageFile(idxId, &t->fh)) != RC_OK) {
+        free(t);
+        free(handle);
+        return rc;
+    }
+    if ((rc = initBufferPool(&t->pool, idxId, BE_POOL_SIZE, RS_LRU, NULL)) != RC_OK) {
+        closePageFile(&t->fh);
+        free(t);
+        free(handle);
+        return rc;
+    }
+
+    if ((rc = pinPageWithHint(&t->pool, &page, 0, BM_HINT_HOT)) != RC_OK) {
+        shutdownBufferPool(&t->pool);
+        closePageFile(&t->fh);
+        free(t);
+        free(handle);
+        return rc;
+    }
+    memcpy(&t->header, page.data, sizeof(BE_Header));
+    unpinPage(&t->pool, &page);
+
+    handle->keyType = t->header.keyType;
+    handle->idxId = strdup(idxId);
+    handle->mgmtData = t;
+    *tree = handle;
+    return RC_OK;
+}
+
+// closeBeTree
+/**
+ * Writes back the header and all dirty nodes and releases the handle.
+ * Buffered messages stay in their nodes.
+ *
+ * @param tree The index to close.
+ * @return RC_OK on success, or an error code.
+ */
+RC closeBeTree(BE_TreeHandle *tree) {
+    BE_TreeMgmt *t = TREE_MGMT(tree);
+    BM_PageHandle page;
+    RC rc;
+
+    if ((rc = pinPageWithHint(&t->pool, &page, 0, BM_HINT_HOT)) != RC_OK)
+        return rc;
+    memcpy(page.data, &t->header, sizeof(BE_Header));
+    markDirty(&t->pool, &page);
+    unpinPage(&t->pool, &page);
+
+    if ((rc = shutdownBufferPool(&t->pool)) != RC_OK)
+        return rc;
+    closePageFile(&t->fh);
+
+    free(tree->idxId);
+    free(t);
+    free(tree);
+    return RC_OK;
+}
+
+// Delete an index
+RC deleteBeTree(char *idxId) {
+    if (destroyPageFile(idxId) != RC_OK)
+        return RC_FILE_DESTROY_FAILED;
+    return RC_OK;
+}
+
+// Get the number of nodes of an index
+RC getBeNumNodes(BE_TreeHandle *tree, int *result) {
+    *result = TREE_MGMT(tree)->header.numNodes;
+    return RC_OK;
+}
+
+// Get the number of levels of an index, leaves included
+RC getBeHeight(BE_TreeHandle *tree, int *result) {
+    *result = TREE_MGMT(tree)->header.height;
+    return RC_OK;
+}
+
+// beFindKey
+/**
+ * Looks up the RID of a key. The first message for the key met on the way
+ * down decides; without one, the leaf does.
+ *
+ * @param tree The index.
+ * @param key The key to look for.
+ * @param result Receives the RID.
+ * @return RC_OK on success, RC_IM_KEY_NOT_FOUND if the key is not in the
+ *         index, or an error code.
+ */
+RC beFindKey(BE_TreeHandle *tree, Value *key, RID *result) {
+    BE_TreeMgmt *t = TREE_MGMT(tree);
+    int pageNum = t->header.root;
+    BM_PageHandle page;
+    unsigned int k;
+    int level;
+    RC rc;
+
+    if ((rc = toKey(t, key, &k)) != RC_OK)
+        return rc;
+
+    for (level = 0; ; level++) {
+        BE_Node *node;
+        int pos;
+
+        if ((rc = pinPageWithHint(&t->pool, &page, pageNum, levelHint(t, level))) != RC_OK)
+            return rc;
+        node = NODE(page.data);
+
+        if (node->isLeaf) {
+            BE_Entry *entries = leafEntries(node);
+
+            pos = findEntry(entries, node->numKeys, k);
+            rc = RC_IM_KEY_NOT_FOUND;
+            if (pos < node->numKeys && entries[pos].key == k) {
+                *result = entries[pos].rid;
+                rc = RC_OK;
+            }
+            unpinPage(&t->pool, &page);
+            return rc;
+        }
+
+        pos = findMessage(innerMessages(t, node), node->numMsgs, k);
+        if (pos < node->numMsgs && innerMessages(t, node)[pos].key == k) {
+            BE_Message *msg = &innerMessages(t, node)[pos];
+
+            rc = RC_IM_KEY_NOT_FOUND;
+            if (msg->op == BE_INSERT) {
+                *result = msg->rid;
+                rc = RC_OK;
+            }
+            unpinPage(&t->pool, &page);
+            return rc;
+        }
+        pageNum = innerChildren(t, node)[childFor(innerPivots(node), node->numKeys, k)];
+        unpinPage(&t->pool, &page);
+    }
+}
+
+// beInsertKey
+/**
+ * Inserts a key with its RID, replacing the RID of a key already there.
+ *
+ * @param tree The index.
+ * @param key The key.
+ * @param rid The RID to store with it.
+ * @return RC_OK on success, or an error code.
+ */
+RC beInsertKey(BE_TreeHandle *tree, Value *key, RID rid) {
+    BE_TreeMgmt *t = TREE_MGMT(tree);
+    BE_Message msg;
+    RC rc;
+
+    if ((rc = toKey(t, key, &msg.key)) != RC_OK)
+        return rc;
+    msg.op = BE_INSERT;
+    msg.rid = rid;
+    return applyMessage(t, &msg);
+}
+
+// beDeleteKey
+/**
+ * Deletes a key; a key that is not in the index is ignored.
+ *
+ * @param tree The index.
+ * @param key The key.
+ * @return RC_OK on success, or an error code.
+ */
+RC beDeleteKey(BE_TreeHandle *tree, Value *key) {
+    BE_TreeMgmt *t = TREE_MGMT(tree);
+    BE_Message msg;
+    RC rc;
+
+    if ((rc = toKey(t, key, &msg.key)) != RC_OK)
+        return rc;
+    msg.op = BE_DELETE;
+    msg.rid.page = -1;
+    msg.rid.slot = -1;
+    return applyMessage(t, &msg);
+}
+
+// beFlush
+/**
+ * Pushes every buffered message down to the leaves.
+ *
+ * @param tree The index.
+ * @return RC_OK on success, or an error code.
+ */
+RC beFlush(BE_TreeHandle *tree) {
+    BE_TreeMgmt *t = TREE_MGMT(tree);
+    BE_Splits splits = { 0, 0, NULL, NULL };
+    RC rc;
+
+    if ((rc = pushMessages(t, t->header.root, 0, NULL, 0, true, &splits)) != RC_OK) {
+        freeSplits(&splits);
+        return rc;
+    }
+    return growRoot(t, &splits);
+}
+
+// openBeTreeScan
+/**
+ * Starts a scan over all entries in key order. The buffers are flushed
+ * first, so that the leaves hold every entry.
+ *
+ * @param tree The index.
+ * @param handle Receives the new scan; release it with closeBeTreeScan.
+ * @return RC_OK on success, or an error code.
+ */
+RC openBeTreeScan(BE_TreeHandle *tree, BE_ScanHandle **handle) {
+    BE_TreeMgmt *t = TREE_MGMT(tree);
+    int pageNum, level;
+    BE_ScanMgmt *sm;
+    RC rc;
+
+    *handle = NULL;
+    if ((rc = beFlush(tree)) != RC_OK)
+        return rc;
+
+    sm = (BE_ScanMgmt *) calloc(1, sizeof(BE_ScanMgmt));
+    *handle = (BE_ScanHandle *) malloc(sizeof(BE_ScanHandle));
+    if (sm == NULL || *handle == NULL) {
+        free(sm);
+        free(*handle);
+        *handle = NULL;
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    (*handle)->tree = tree;
+    (*handle)->mgmtData = sm;
+
+    // Descend along the leftmost children to the first leaf
+    pageNum = t->header.root;
+    for (level = 0; ; level++) {
+        if ((rc = pinPageWithHint(&t->pool, &sm->page, pageNum, levelHint(t, level))) != RC_OK) {
+            closeBeTreeScan(*handle);
+            *handle = NULL;
+            return rc;
+        }
+        if (NODE(sm->page.data)->isLeaf)
+            break;
+        pageNum = innerChildren(t, NODE(sm->page.data))[0];
+        unpinPage(&t->pool, &sm->page);
+    }
+    sm->pinned = true;
+    sm->pos = 0;
+    return RC_OK;
+}
+
+// beNextEntry
+/**
+ * Returns the RID of the next entry of a scan.
+ *
+ * @param handle The scan.
+ * @param result Receives the RID.
+ * @return RC_OK, RC_IM_NO_MORE_ENTRIES at the end, or an error code.
+ */
+RC beNextEntry(BE_ScanHandle *handle, RID *result) {
+    BE_TreeMgmt *t = TREE_MGMT(handle->tree);
+    BE_ScanMgmt *sm = (BE_ScanMgmt *) handle->mgmtData;
+    RC rc;
+
+    while (sm->pinned) {
+        BE_Node *node = NODE(sm->page.data);
+        int next;
+
+        if (sm->pos < node->numKeys) {
+            *result = leafEntries(node)[sm->pos++].rid;
+            return RC_OK;
+        }
+
+        next = node->next;
+        unpinPage(&t->pool, &sm->page);
+        sm->pinned = false;
+        if (next < 0)
+            break;
+        if ((rc = pinPage(&t->pool, &sm->page, next)) != RC_OK)
+            return rc;
+        sm->pinned = true;
+        sm->pos = 0;
+    }
+    return RC_IM_NO_MORE_ENTRIES;
+}
+
+// Close a scan
+RC closeBeTreeScan(BE_ScanHandle *handle) {
+    BE_ScanMgmt *sm = (BE_ScanMgmt *) handle->mgmtData;
+
+    if (sm->pinned)
+        unpinPage(&TREE_MGMT(handle->tree)->pool, &sm->page);
+    free(sm);
+    free(handle);
+    return RC_OK;
+}
@@ -0,0 +1,52 @@
+#ifndef BETREE_MGR_H
+#define BETREE_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+
+// Write-optimized index (B-epsilon tree)
+//
+// Inner nodes keep a buffer of pending inserts and deletes next to their
+// pivots. Updates go to the root's buffer and move down a level in batches
+// when a buffer fills, so one page write carries many updates. A key is
+// stored with a single RID: inserting a key that is already in the tree
+// replaces its RID, and deleting a key that is not there does nothing,
+// since checking either would cost the descent the buffers avoid.
+
+// structure for accessing write-optimized indexes
+typedef struct BE_TreeHandle {
+  DataType keyType;
+  char *idxId;
+  void *mgmtData;
+} BE_TreeHandle;
+
+typedef struct BE_ScanHandle {
+  BE_TreeHandle *tree;
+  void *mgmtData;
+} BE_ScanHandle;
+
+// create, destroy, open, and close an index; fanout is the maximum number
+// of children of an inner node, the rest of its page is the buffer
+extern RC createBeTree (char *idxId, DataType keyType, int fanout);
+extern RC openBeTree (BE_TreeHandle **tree, char *idxId);
+extern RC closeBeTree (BE_TreeHandle *tree);
+extern RC deleteBeTree (char *idxId);
+
+// access information about an index
+extern RC getBeNumNodes (BE_TreeHandle *tree, int *result);
+extern RC getBeHeight (BE_TreeHandle *tree, int *result);
+
+// index access
+extern RC beFindKey (BE_TreeHandle *tree, Value *key, RID *result);
+extern RC beInsertKey (BE_TreeHandle *tree, Value *key, RID rid);
+extern RC beDeleteKey (BE_TreeHandle *tree, Value *key);
+
+// apply every buffered update to the leaves
+extern RC beFlush (BE_TreeHandle *tree);
+
+// scans run over the leaves in key order, after a beFlush
+extern RC openBeTreeScan (BE_TreeHandle *tree, BE_ScanHandle **handle);
+extern RC beNextEntry (BE_ScanHandle *handle, RID *result);
+extern RC closeBeTreeScan (BE_ScanHandle *handle);
+
+#endif // BETREE_MGR_H
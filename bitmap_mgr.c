@@ -0,0 +1,1190 @@
+#include "bitmap_mgr.h"
+#include "storage_mgr.h"
+#include "norm_key.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bitmap index
+//
+// The distinct values are kept as normalized keys (norm_key.h) in a sorted
+// array, each with its bitmap, so an equality is a binary search and a range
+// is a run of neighbouring values. A bitmap is a sorted array of containers,
+// one per 65536 positions that hold a record. A container is an array of
+// sorted 16-bit positions while it has at most BI_ARRAY_MAX of them and a
+// set of 65536 bits above that, which bounds both layouts to 8 KB. Adds and
+// removes move a container between the layouts at that size; the results
+// of AND, OR and AND NOT are put into the layout their size calls for.
+//
+// Besides the bitmaps of the values the index keeps the bitmap of every
+// record, the complement of NOT.
+//
+// Index file: page 0 is a BI_Header, the pages after it are a byte stream
+// of the values in key order. A value is its key, a container count and the
+// containers; a container is its key, its size and then either the array or
+// the 1024 words of the bit set, as its size says.
+
+#define BI_SLOTS_PER_PAGE (PAGE_SIZE / 256)
+#define BI_ARRAY_MAX 4096
+#define BI_BITSET_WORDS 1024
+
+#define BI_AND 0
+#define BI_OR 1
+#define BI_ANDNOT 2
+
+// Index header, stored at the start of page 0
+typedef struct BI_Header {
+    int attrNum;
+    int keyType;
+    int keySize;
+    int numValues;
+    int dataBytes;  // length of the stream starting at page 1
+} BI_Header;
+
+typedef struct BI_Container {
+    unsigned short key;     // high 16 bits of the positions
+    int cardinality;
+    int capacity;           // room in values, 0 for a bit set
+    unsigned short *values; // array layout: sorted low 16 bits
+    uint64_t *bits;         // bit set layout, NULL for an array
+} BI_Container;
+
+typedef struct BI_Bitmap {
+    int numContainers;
+    int capacity;
+    BI_Container *containers;   // sorted by key
+} BI_Bitmap;
+
+typedef struct BI_Value {
+    char *key;          // normalized value
+    BI_Bitmap bitmap;
+} BI_Value;
+
+typedef struct BI_IndexMgmt {
+    int keySize;
+    int numValues;
+    int capacity;
+    BI_Value *values;   // sorted by key
+    BI_Bitmap rows;     // every indexed record
+    bool dirty;
+    BI_IndexHandle *nextOpen;
+} BI_IndexMgmt;
+
+#define INDEX_MGMT(index) ((BI_IndexMgmt *) (index)->mgmtData)
+
+// Indexes open on any table, which answer a condition together
+static BI_IndexHandle *openIndexes = NULL;
+
+static RC biInsert(void *index, Record *record);
+static RC biRemove(void *index, Record *record);
+static RC biCandidates(void *index, Expr *cond, RID **rids, int *numRids, bool *exact);
+
+static RM_IndexHooks biHooks = { biInsert, biRemove, biCandidates };
+
+/* ---------------------------------------------------------------------- */
+/* Containers                                                              */
+/* ---------------------------------------------------------------------- */
+
+// Position of v in a sorted array, or -(insert position) - 1
+static int searchValues(unsigned short *values, int n, unsigned short v) {
+    int lo = 0, hi = n - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (values[mid] == v)
+            return mid;
+        if (values[mid] < v)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return -lo - 1;
+}
+
+static void freeContainer(BI_Container *c) {
+    free(c->values);
+    free(c->bits);
+    c->values = NULL;
+    c->bits = NULL;
+}
+
+// Switch a container to the bit set layout
+static RC toBitset(BI_Container *c) {
+    uint64_t *bits = (uint64_t *) calloc(BI_BITSET_WORDS, sizeof(uint64_t));
+    int i;
+
+    if (bits == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (i = 0; i < c->cardinality; i++)
+        bits[c->values[i] >> 6] |= 1ULL << (c->values[i] & 63);
+    free(c->values);
+    c->values = NULL;
+    c->capacity = 0;
+    c->bits = bits;
+    return RC_OK;
+}
+
+// Switch a container to the array layout
+static RC toArray(BI_Container *c) {
+    unsigned short *values = (unsigned short *) malloc((c->cardinality + 1) * sizeof(unsigned short));
+    int w, n = 0;
+
+    if (values == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (w = 0; w < BI_BITSET_WORDS; w++) {
+        uint64_t word = c->bits[w];
+        while (word != 0) {
+            values[n++] = (unsigned short) (w * 64 + __builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+    free(c->bits);
+    c->bits = NULL;
+    c->values = values;
+    c->capacity = c->cardinality + 1;
+    return RC_OK;
+}
+
+// Put a container whose cardinality was just computed into its layout
+static RC fitLayout(BI_Container *c) {
+    if (c->bits != NULL && c->cardinality <= BI_ARRAY_MAX)
+        return toArray(c);
+    if (c->bits == NULL && c->cardinality > BI_ARRAY_MAX)
+        return toBitset(c);
+    return RC_OK;
+}
+
+static RC containerAdd(BI_Container *c, unsigned short low) {
+    uint64_t bit = 1ULL << (low & 63);
+    int pos;
+    RC rc;
+
+    if (c->bits == NULL) {
+        pos = searchValues(c->values, c->cardinality, low);
+        if (pos >= 0)
+            return RC_OK;
+        if (c->cardinality == BI_ARRAY_MAX) {
+            if ((rc = toBitset(c)) != RC_OK)
+                return rc;
+        } else {
+            pos = -pos - 1;
+            if (c->cardinality == c->capacity) {
+                int capacity = c->capacity < 4 ? 4 : 2 * c->capacity;
+                unsigned short *values = (unsigned short *) realloc(c->values, capacity * sizeof(unsigned short));
+                if (values == NULL)
+                    return RC_MEM_ALLOCATION_FAIL;
+                c->values = values;
+                c->capacity = capacity;
+            }
+            memmove(c->values + pos + 1, c->values + pos, (c->cardinality - pos) * sizeof(unsigned short));
+            c->values[pos] = low;
+            c->cardinality++;
+            return RC_OK;
+        }
+    }
+    if ((c->bits[low >> 6] & bit) == 0) {
+        c->bits[low >> 6] |= bit;
+        c->cardinality++;
+    }
+    return RC_OK;
+}
+
+static RC containerRemove(BI_Container *c, unsigned short low) {
+    uint64_t bit = 1ULL << (low & 63);
+    int pos;
+
+    if (c->bits == NULL) {
+        pos = searchValues(c->values, c->cardinality, low);
+        if (pos < 0)
+            return RC_OK;
+        memmove(c->values + pos, c->values + pos + 1, (c->cardinality - pos - 1) * sizeof(unsigned short));
+        c->cardinality--;
+        return RC_OK;
+    }
+    if ((c->bits[low >> 6] & bit) == 0)
+        return RC_OK;
+    c->bits[low >> 6] &= ~bit;
+    c->cardinality--;
+    return fitLayout(c);
+}
+
+static RC copyContainer(BI_Container *c, BI_Container *out) {
+    *out = *c;
+    if (c->bits != NULL) {
+        out->bits = (uint64_t *) malloc(BI_BITSET_WORDS * sizeof(uint64_t));
+        if (out->bits == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        memcpy(out->bits, c->bits, BI_BITSET_WORDS * sizeof(uint64_t));
+    } else {
+        out->capacity = c->cardinality + 1;
+        out->values = (unsigned short *) malloc(out->capacity * sizeof(unsigned short));
+        if (out->values == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        memcpy(out->values, c->values, c->cardinality * sizeof(unsigned short));
+    }
+    return RC_OK;
+}
+
+static bool containerHas(BI_Container *c, unsigned short low) {
+    if (c->bits != NULL)
+        return (c->bits[low >> 6] >> (low & 63)) & 1;
+    return searchValues(c->values, c->cardinality, low) >= 0;
+}
+
+// mergeArrays
+/**
+ * Combines two array containers by merging their sorted values.
+ *
+ * @return RC_OK, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC mergeArrays(BI_Container *a, BI_Container *b, int op, BI_Container *out) {
+    int i = 0, j = 0, n = 0;
+
+    out->capacity = (op == BI_OR ? a->cardinality + b->cardinality : a->cardinality) + 1;
+    out->values = (unsigned short *) malloc(out->capacity * sizeof(unsigned short));
+    if (out->values == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    while (i < a->cardinality && j < b->cardinality) {
+        if (a->values[i] < b->values[j]) {
+            if (op != BI_AND)
+                out->values[n++] = a->values[i];
+            i++;
+        } else if (a->values[i] > b->values[j]) {
+            if (op == BI_OR)
+                out->values[n++] = b->values[j];
+            j++;
+        } else {
+            if (op != BI_ANDNOT)
+                out->values[n++] = a->values[i];
+            i++;
+            j++;
+        }
+    }
+    if (op != BI_AND)
+        for (; i < a->cardinality; i++)
+            out->values[n++] = a->values[i];
+    if (op == BI_OR)
+        for (; j < b->cardinality; j++)
+            out->values[n++] = b->values[j];
+    out->cardinality = n;
+    return fitLayout(out);
+}
+
+// containerOp
+/**
+ * Combines two containers of the same key into a new one: a AND b, a OR b
+ * or a AND NOT b. Arrays are merged, an array is filtered against a bit
+ * set, and bit sets are combined a word at a time.
+ *
+ * @param out Receives the result, possibly empty.
+ * @return RC_OK, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC containerOp(BI_Container *a, BI_Container *b, int op, BI_Container *out) {
+    uint64_t *wa, *wb, *tmp = NULL;
+    int i, n = 0;
+
+    memset(out, 0, sizeof(BI_Container));
+    out->key = a->key;
+    if (a->bits == NULL && b->bits == NULL)
+        return mergeArrays(a, b, op, out);
+
+    // the values of an array that are (or are not) in the bit set
+    if (a->bits == NULL && op != BI_OR) {
+        out->capacity = a->cardinality + 1;
+        out->values = (unsigned short *) malloc(out->capacity * sizeof(unsigned short));
+        if (out->values == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        for (i = 0; i < a->cardinality; i++)
+            if (containerHas(b, a->values[i]) == (op == BI_AND))
+                out->values[n++] = a->values[i];
+        out->cardinality = n;
+        return RC_OK;
+    }
+    if (b->bits == NULL && op == BI_AND)
+        return containerOp(b, a, op, out);
+
+    // word at a time, with the array side spread into a bit set
+    if (a->bits == NULL || b->bits == NULL) {
+        BI_Container spread = a->bits == NULL ? *a : *b;
+        tmp = (uint64_t *) calloc(BI_BITSET_WORDS, sizeof(uint64_t));
+        if (tmp == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        for (i = 0; i < spread.cardinality; i++)
+            tmp[spread.values[i] >> 6] |= 1ULL << (spread.values[i] & 63);
+    }
+    wa = a->bits != NULL ? a->bits : tmp;
+    wb = b->bits != NULL ? b->bits : tmp;
+    out->bits = (uint64_t *) malloc(BI_BITSET_WORDS * sizeof(uint64_t));
+    if (out->bits == NULL) {
+        free(tmp);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    for (i = 0; i < BI_BITSET_WORDS; i++) {
+        uint64_t w = op == BI_AND ? wa[i] & wb[i] : op == BI_OR ? wa[i] | wb[i] : wa[i] & ~wb[i];
+        out->bits[i] = w;
+        n += __builtin_popcountll(w);
+    }
+    free(tmp);
+    out->cardinality = n;
+    return fitLayout(out);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Bitmaps                                                                 */
+/* ---------------------------------------------------------------------- */
+
+static void freeBitmap(BI_Bitmap *b) {
+    int i;
+
+    for (i = 0; i < b->numContainers; i++)
+        freeContainer(&b->containers[i]);
+    free(b->containers);
+    memset(b, 0, sizeof(BI_Bitmap));
+}
+
+static void dropBitmap(BI_Bitmap *b) {
+    if (b != NULL) {
+        freeBitmap(b);
+        free(b);
+    }
+}
+
+// Position of the container with key, or -(insert position) - 1
+static int searchContainers(BI_Bitmap *b, unsigned short key) {
+    int lo = 0, hi = b->numContainers - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (b->containers[mid].key == key)
+            return mid;
+        if (b->containers[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return -lo - 1;
+}
+
+// Make room for one more container
+static RC reserveContainer(BI_Bitmap *b) {
+    if (b->numContainers == b->capacity) {
+        int capacity = b->capacity < 4 ? 4 : 2 * b->capacity;
+        BI_Container *containers = (BI_Container *) realloc(b->containers, capacity * sizeof(BI_Container));
+        if (containers == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        b->containers = containers;
+        b->capacity = capacity;
+    }
+    return RC_OK;
+}
+
+// Append a container that sorts after every container of b, taking it over
+static RC appendContainer(BI_Bitmap *b, BI_Container *c) {
+    RC rc;
+
+    if (c->cardinality == 0) {
+        freeContainer(c);
+        return RC_OK;
+    }
+    if ((rc = reserveContainer(b)) != RC_OK) {
+        freeContainer(c);
+        return rc;
+    }
+    b->containers[b->numContainers++] = *c;
+    return RC_OK;
+}
+
+static RC bitmapAdd(BI_Bitmap *b, unsigned int pos) {
+    unsigned short key = (unsigned short) (pos >> 16);
+    int i = searchContainers(b, key);
+    RC rc;
+
+    if (i < 0) {
+        i = -i - 1;
+        if ((rc = reserveContainer(b)) != RC_OK)
+            return rc;
+        memmove(b->containers + i + 1, b->containers + i, (b->numContainers - i) * sizeof(BI_Container));
+        memset(&b->containers[i], 0, sizeof(BI_Container));
+        b->containers[i].key = key;
+        b->numContainers++;
+    }
+    return containerAdd(&b->containers[i], (unsigned short) pos);
+}
+
+static RC bitmapRemove(BI_Bitmap *b, unsigned int pos) {
+    int i = searchContainers(b, (unsigned short) (pos >> 16));
+    RC rc;
+
+    if (i < 0)
+        return RC_OK;
+    if ((rc = containerRemove(&b->containers[i], (unsigned short) pos)) != RC_OK)
+        return rc;
+    if (b->containers[i].cardinality == 0) {
+        freeContainer(&b->containers[i]);
+        b->numContainers--;
+        memmove(b->containers + i, b->containers + i + 1, (b->numContainers - i) * sizeof(BI_Container));
+    }
+    return RC_OK;
+}
+
+// bitmapOp
+/**
+ * Combines two bitmaps container by container into a new bitmap: a AND b,
+ * a OR b, or a AND NOT b.
+ *
+ * @param out Receives the result; free it with dropBitmap.
+ * @return RC_OK, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC bitmapOp(BI_Bitmap *a, BI_Bitmap *b, int op, BI_Bitmap **out) {
+    BI_Bitmap *r = (BI_Bitmap *) calloc(1, sizeof(BI_Bitmap));
+    int i = 0, j = 0;
+    RC rc = RC_OK;
+
+    if (r == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    while (rc == RC_OK && (i < a->numContainers || j < b->numContainers)) {
+        BI_Container *ca = i < a->numContainers ? &a->containers[i] : NULL;
+        BI_Container *cb = j < b->numContainers ? &b->containers[j] : NULL;
+        BI_Container c;
+
+        if (ca != NULL && cb != NULL && ca->key == cb->key) {
+            if ((rc = containerOp(ca, cb, op, &c)) == RC_OK)
+                rc = appendContainer(r, &c);
+            else
+                freeContainer(&c);
+            i++;
+            j++;
+        } else if (cb == NULL || (ca != NULL && ca->key < cb->key)) {
+            if (op != BI_AND && (rc = copyContainer(ca, &c)) == RC_OK)
+                rc = appendContainer(r, &c);
+            i++;
+        } else {
+            if (op == BI_OR && (rc = copyContainer(cb, &c)) == RC_OK)
+                rc = appendContainer(r, &c);
+            j++;
+        }
+    }
+    if (rc != RC_OK) {
+        dropBitmap(r);
+        return rc;
+    }
+    *out = r;
+    return RC_OK;
+}
+
+static int bitmapCardinality(BI_Bitmap *b) {
+    int i, n = 0;
+
+    for (i = 0; i < b->numContainers; i++)
+        n += b->containers[i].cardinality;
+    return n;
+}
+
+// Bytes of a bitmap as stored in the index file
+static int bitmapBytes(BI_Bitmap *b) {
+    int i, n = sizeof(int);
+
+    for (i = 0; i < b->numContainers; i++) {
+        BI_Container *c = &b->containers[i];
+        n += sizeof(unsigned short) + sizeof(int);
+        n += c->bits != NULL ? BI_BITSET_WORDS * sizeof(uint64_t) : c->cardinality * sizeof(unsigned short);
+    }
+    return n;
+}
+
+static unsigned int ridPosition(RID rid) {
+    return (unsigned int) rid.page * BI_SLOTS_PER_PAGE + rid.slot;
+}
+
+// bitmapToRids
+/**
+ * Lists the records of a bitmap in RID order.
+ *
+ * @param rids Receives a malloc'ed array.
+ * @param numRids Receives its length.
+ * @return RC_OK, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC bitmapToRids(BI_Bitmap *b, RID **rids, int *numRids) {
+    RID *r = (RID *) malloc((bitmapCardinality(b) + 1) * sizeof(RID));
+    int i, k, n = 0;
+
+    if (r == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (i = 0; i < b->numContainers; i++) {
+        BI_Container *c = &b->containers[i];
+        unsigned int high = (unsigned int) c->key << 16;
+
+        if (c->bits == NULL) {
+            for (k = 0; k < c->cardinality; k++, n++) {
+                r[n].page = (high | c->values[k]) / BI_SLOTS_PER_PAGE;
+                r[n].slot = (high | c->values[k]) % BI_SLOTS_PER_PAGE;
+            }
+            continue;
+        }
+        for (k = 0; k < BI_BITSET_WORDS; k++) {
+            uint64_t word = c->bits[k];
+            while (word != 0) {
+                unsigned int pos = high | (k * 64 + __builtin_ctzll(word));
+                r[n].page = pos / BI_SLOTS_PER_PAGE;
+                r[n].slot = pos % BI_SLOTS_PER_PAGE;
+                n++;
+                word &= word - 1;
+            }
+        }
+    }
+    *rids = r;
+    *numRids = n;
+    return RC_OK;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Values                                                                  */
+/* ---------------------------------------------------------------------- */
+
+// Position of the value with key, or -(insert position) - 1
+static int searchKey(BI_IndexMgmt *m, const char *key) {
+    int lo = 0, hi = m->numValues - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = memcmp(m->values[mid].key, key, m->keySize);
+        if (cmp == 0)
+            return mid;
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return -lo - 1;
+}
+
+// Add a value with an empty bitmap at position pos
+static RC addValue(BI_IndexMgmt *m, int pos, const char *key) {
+    char *copy = (char *) malloc(m->keySize);
+
+    if (copy == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    if (m->numValues == m->capacity) {
+        int capacity = m->capacity < 8 ? 8 : 2 * m->capacity;
+        BI_Value *values = (BI_Value *) realloc(m->values, capacity * sizeof(BI_Value));
+        if (values == NULL) {
+            free(copy);
+            return RC_MEM_ALLOCATION_FAIL;
+        }
+        m->values = values;
+        m->capacity = capacity;
+    }
+    memcpy(copy, key, m->keySize);
+    memmove(m->values + pos + 1, m->values + pos, (m->numValues - pos) * sizeof(BI_Value));
+    memset(&m->values[pos], 0, sizeof(BI_Value));
+    m->values[pos].key = copy;
+    m->numValues++;
+    return RC_OK;
+}
+
+static void freeIndexMgmt(BI_IndexMgmt *m) {
+    int i;
+
+    for (i = 0; i < m->numValues; i++) {
+        free(m->values[i].key);
+        freeBitmap(&m->values[i].bitmap);
+    }
+    free(m->values);
+    freeBitmap(&m->rows);
+    free(m);
+}
+
+// biInsert
+/**
+ * Adds a record to the bitmap of its value, the hook called by the record
+ * manager after an insert or update.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC biInsert(void *idx, Record *record) {
+    BI_IndexHandle *index = (BI_IndexHandle *) idx;
+    BI_IndexMgmt *m = INDEX_MGMT(index);
+    unsigned int pos = ridPosition(record->id);
+    char key[m->keySize];
+    int i;
+    RC rc;
+
+    if ((rc = normalizeRecordKey(index->rel->schema, record, 1, &index->attrNum, key)) != RC_OK)
+        return rc;
+    i = searchKey(m, key);
+    if (i < 0) {
+        i = -i - 1;
+        if ((rc = addValue(m, i, key)) != RC_OK)
+            return rc;
+    }
+    if ((rc = bitmapAdd(&m->values[i].bitmap, pos)) != RC_OK)
+        return rc;
+    m->dirty = true;
+    return bitmapAdd(&m->rows, pos);
+}
+
+// biRemove
+/**
+ * Removes a record from the bitmap of its value, dropping the value when no
+ * record has it any more; the hook called before a delete or update.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC biRemove(void *idx, Record *record) {
+    BI_IndexHandle *index = (BI_IndexHandle *) idx;
+    BI_IndexMgmt *m = INDEX_MGMT(index);
+    unsigned int pos = ridPosition(record->id);
+    char key[m->keySize];
+    int i;
+    RC rc;
+
+    if ((rc = normalizeRecordKey(index->rel->schema, record, 1, &index->attrNum, key)) != RC_OK)
+        return rc;
+    if ((i = searchKey(m, key)) < 0)
+        return RC_OK;
+    if ((rc = bitmapRemove(&m->values[i].bitmap, pos)) != RC_OK)
+        return rc;
+    if (m->values[i].bitmap.numContainers == 0) {
+        free(m->values[i].key);
+        freeBitmap(&m->values[i].bitmap);
+        m->numValues--;
+        memmove(m->values + i, m->values + i + 1, (m->numValues - i) * sizeof(BI_Value));
+    }
+    m->dirty = true;
+    return bitmapRemove(&m->rows, pos);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Conditions                                                              */
+/* ---------------------------------------------------------------------- */
+
+// The index open on an attribute of a table, or NULL
+static BI_IndexHandle *indexOn(RM_TableData *rel, int attrNum) {
+    BI_IndexHandle *index;
+
+    for (index = openIndexes; index != NULL; index = INDEX_MGMT(index)->nextOpen)
+        if (index->rel == rel && index->attrNum == attrNum)
+            return index;
+    return NULL;
+}
+
+// evalComparison
+/**
+ * Turns attr = constant, attr < constant or constant < attr into the union
+ * of the bitmaps of the values that satisfy it. BOOL attributes only take
+ * equality, as the interpreter does not order them.
+ *
+ * @param out Receives the bitmap, or NULL if no index covers the comparison.
+ * @return RC_OK, or an error code.
+ */
+static RC evalComparison(BI_IndexHandle *self, Operator *op, BI_Bitmap **out) {
+    Expr *left = op->args[0], *right = op->args[1];
+    BI_IndexHandle *index;
+    BI_IndexMgmt *m;
+    Value *cons;
+    bool consFirst;
+    int attr, i, first, last;
+    RC rc;
+
+    *out = NULL;
+    if (left->type == EXPR_ATTRREF && right->type == EXPR_CONST) {
+        attr = left->expr.attrRef;
+        cons = right->expr.cons;
+        consFirst = false;
+    } else if (left->type == EXPR_CONST && right->type == EXPR_ATTRREF) {
+        attr = right->expr.attrRef;
+        cons = left->expr.cons;
+        consFirst = true;
+    } else {
+        return RC_OK;
+    }
+    index = indexOn(self->rel, attr);
+    if (index == NULL || cons->dt != index->keyType)
+        return RC_OK;
+    if (op->type == OP_COMP_SMALLER && index->keyType == DT_BOOL)
+        return RC_OK;
+    m = INDEX_MGMT(index);
+
+    char key[m->keySize];
+    if (index->keyType == DT_STRING
+            && strlen(cons->v.stringV) > (size_t) index->rel->schema->typeLength[attr]) {
+        // no stored string is that long: nothing equals it, and a cut key would misorder it
+        if (op->type != OP_COMP_EQUAL)
+            return RC_OK;
+        first = 0;
+        last = -1;
+    } else {
+        if ((rc = normalizeValue(cons, index->rel->schema->typeLength[attr], key)) != RC_OK)
+            return rc;
+        i = searchKey(m, key);
+        if (op->type == OP_COMP_EQUAL) {
+            first = i;
+            last = i >= 0 ? i : -1;
+        } else if (!consFirst) {
+            first = 0;                                  // attr < cons
+            last = (i >= 0 ? i : -i - 1) - 1;
+        } else {
+            first = i >= 0 ? i + 1 : -i - 1;            // cons < attr
+            last = m->numValues - 1;
+        }
+    }
+
+    *out = (BI_Bitmap *) calloc(1, sizeof(BI_Bitmap));
+    if (*out == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (i = first; i >= 0 && i <= last; i++) {
+        BI_Bitmap *merged;
+        if ((rc = bitmapOp(*out, &m->values[i].bitmap, BI_OR, &merged)) != RC_OK) {
+            dropBitmap(*out);
+            *out = NULL;
+            return rc;
+        }
+        dropBitmap(*out);
+        *out = merged;
+    }
+    return RC_OK;
+}
+
+// evalCondition
+/**
+ * Evaluates a condition over the bitmaps of the indexes open on the table.
+ * A comparison no index covers stands for every record, so the result
+ * holds every matching record, and it holds no others if exact is set.
+ *
+ * @param out Receives the records; NULL stands for every record and is
+ *        never exact.
+ * @param exact Receives whether out holds only matching records.
+ * @return RC_OK, or an error code.
+ */
+static RC evalCondition(BI_IndexHandle *self, Expr *cond, BI_Bitmap **out, bool *exact) {
+    BI_Bitmap *a = NULL, *b = NULL;
+    bool exactA, exactB;
+    Operator *op;
+    RC rc;
+
+    *out = NULL;
+    *exact = false;
+    if (cond->type != EXPR_OP)
+        return RC_OK;
+    op = cond->expr.op;
+
+    switch (op->type) {
+    case OP_COMP_EQUAL:
+    case OP_COMP_SMALLER:
+        rc = evalComparison(self, op, out);
+        *exact = *out != NULL;
+        return rc;
+    case OP_BOOL_NOT:
+        if ((rc = evalCondition(self, op->args[0], &a, &exactA)) != RC_OK || a == NULL)
+            return rc;
+        if (exactA && (rc = bitmapOp(&INDEX_MGMT(self)->rows, a, BI_ANDNOT, out)) == RC_OK)
+            *exact = true;
+        dropBitmap(a);
+        return rc;
+    case OP_BOOL_AND:
+    case OP_BOOL_OR:
+        if ((rc = evalCondition(self, op->args[0], &a, &exactA)) != RC_OK)
+            return rc;
+        if ((rc = evalCondition(self, op->args[1], &b, &exactB)) != RC_OK) {
+            dropBitmap(a);
+            return rc;
+        }
+        if (a != NULL && b != NULL) {
+            rc = bitmapOp(a, b, op->type == OP_BOOL_AND ? BI_AND : BI_OR, out);
+            *exact = rc == RC_OK && exactA && exactB;
+        } else if (op->type == OP_BOOL_AND) {
+            // the side no index covers only narrows the result further
+            *out = a != NULL ? a : b;
+            a = b = NULL;
+        }
+        dropBitmap(a);
+        dropBitmap(b);
+        return rc;
+    default:
+        return RC_OK;
+    }
+}
+
+// biCandidates
+/**
+ * Lists the records that can match a scan condition, the hook the record
+ * manager calls when a scan starts.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC biCandidates(void *idx, Expr *cond, RID **rids, int *numRids, bool *exact) {
+    BI_Bitmap *result;
+    RC rc;
+
+    *rids = NULL;
+    if ((rc = evalCondition((BI_IndexHandle *) idx, cond, &result, exact)) != RC_OK || result == NULL)
+        return rc;
+    rc = bitmapToRids(result, rids, numRids);
+    dropBitmap(result);
+    return rc;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Index file                                                              */
+/* ---------------------------------------------------------------------- */
+
+// Growing byte stream of the index file
+typedef struct BI_Stream {
+    char *data;
+    int size;
+    int capacity;
+} BI_Stream;
+
+static RC streamPut(BI_Stream *s, const void *src, int len) {
+    if (s->size + len > s->capacity) {
+        int capacity = s->capacity < PAGE_SIZE ? PAGE_SIZE : s->capacity;
+        char *data;
+        while (capacity < s->size + len)
+            capacity *= 2;
+        if ((data = (char *) realloc(s->data, capacity)) == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        s->data = data;
+        s->capacity = capacity;
+    }
+    memcpy(s->data + s->size, src, len);
+    s->size += len;
+    return RC_OK;
+}
+
+static RC streamPutBitmap(BI_Stream *s, BI_Bitmap *b) {
+    RC rc = streamPut(s, &b->numContainers, sizeof(int));
+    int i;
+
+    for (i = 0; i < b->numContainers && rc == RC_OK; i++) {
+        BI_Container *c = &b->containers[i];
+        if ((rc = streamPut(s, &c->key, sizeof(unsigned short))) == RC_OK
+                && (rc = streamPut(s, &c->cardinality, sizeof(int))) == RC_OK)
+            rc = c->bits != NULL ? streamPut(s, c->bits, BI_BITSET_WORDS * sizeof(uint64_t))
+                                 : streamPut(s, c->values, c->cardinality * sizeof(unsigned short));
+    }
+    return rc;
+}
+
+// Read a bitmap at *pos of the stream, advancing *pos
+static RC streamGetBitmap(char *data, int *pos, BI_Bitmap *b) {
+    int numContainers, i;
+    RC rc = RC_OK;
+
+    memcpy(&numContainers, data + *pos, sizeof(int));
+    *pos += sizeof(int);
+    for (i = 0; i < numContainers && rc == RC_OK; i++) {
+        BI_Container c;
+        int bytes;
+
+        memset(&c, 0, sizeof(c));
+        memcpy(&c.key, data + *pos, sizeof(unsigned short));
+        memcpy(&c.cardinality, data + *pos + sizeof(unsigned short), sizeof(int));
+        *pos += sizeof(unsigned short) + sizeof(int);
+        if (c.cardinality > BI_ARRAY_MAX) {
+            bytes = BI_BITSET_WORDS * sizeof(uint64_t);
+            c.bits = (uint64_t *) malloc(bytes);
+        } else {
+            bytes = c.cardinality * sizeof(unsigned short);
+            c.capacity = c.cardinality + 1;
+            c.values = (unsigned short *) malloc(c.capacity * sizeof(unsigned short));
+        }
+        if (c.bits == NULL && c.values == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        memcpy(c.bits != NULL ? (void *) c.bits : (void *) c.values, data + *pos, bytes);
+        *pos += bytes;
+        rc = appendContainer(b, &c);
+    }
+    return rc;
+}
+
+// writeIndex
+/**
+ * Writes the header and the values of an index to its file.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC writeIndex(BI_IndexHandle *index) {
+    BI_IndexMgmt *m = INDEX_MGMT(index);
+    BI_Stream s;
+    BI_Header header;
+    SM_FileHandle fh;
+    int i, pages;
+    RC rc = RC_OK;
+
+    memset(&s, 0, sizeof(s));
+    for (i = 0; i < m->numValues && rc == RC_OK; i++)
+        if ((rc = streamPut(&s, m->values[i].key, m->keySize)) == RC_OK)
+            rc = streamPutBitmap(&s, &m->values[i].bitmap);
+    memset(&header, 0, sizeof(header));
+    header.attrNum = index->attrNum;
+    header.keyType = index->keyType;
+    header.keySize = m->keySize;
+    header.numValues = m->numValues;
+    header.dataBytes = s.size;
+    pages = (s.size + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (rc == RC_OK && s.capacity < (pages + 1) * PAGE_SIZE) {
+        char *data = (char *) realloc(s.data, (pages + 1) * PAGE_SIZE);
+        if (data == NULL)
+            rc = RC_MEM_ALLOCATION_FAIL;
+        else
+            s.data = data;
+    }
+    if (rc != RC_OK) {
+        free(s.data);
+        return rc;
+    }
+    memset(s.data + s.size, 0, (pages + 1) * PAGE_SIZE - s.size);
+
+    if ((rc = openPageFile(index->idxId, &fh)) != RC_OK) {
+        free(s.data);
+        return rc;
+    }
+    for (i = 0; i < pages && rc == RC_OK; i++)
+        rc = writeBlock(i + 1, &fh, s.data + i * PAGE_SIZE);
+    if (rc == RC_OK) {
+        memset(s.data, 0, PAGE_SIZE);
+        memcpy(s.data, &header, sizeof(header));
+        rc = writeBlock(0, &fh, s.data);
+    }
+    free(s.data);
+    closePageFile(&fh);
+    if (rc == RC_OK)
+        m->dirty = false;
+    return rc;
+}
+
+// readIndex
+/**
+ * Reads the values of an index from its file.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC readIndex(SM_FileHandle *fh, BI_Header *header, BI_IndexMgmt *m) {
+    int pages = (header->dataBytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    char *data = (char *) malloc((pages + 1) * PAGE_SIZE);
+    int i, pos = 0;
+    RC rc = RC_OK;
+
+    if (data == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (i = 0; i < pages && rc == RC_OK; i++)
+        rc = readBlock(i + 1, fh, data + i * PAGE_SIZE);
+    for (i = 0; i < header->numValues && rc == RC_OK; i++) {
+        BI_Bitmap *rows;
+        if ((rc = addValue(m, i, data + pos)) != RC_OK)
+            break;
+        pos += m->keySize;
+        if ((rc = streamGetBitmap(data, &pos, &m->values[i].bitmap)) != RC_OK)
+            break;
+        if ((rc = bitmapOp(&m->rows, &m->values[i].bitmap, BI_OR, &rows)) == RC_OK) {
+            freeBitmap(&m->rows);
+            m->rows = *rows;
+            free(rows);
+        }
+    }
+    free(data);
+    return rc;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Interface                                                               */
+/* ---------------------------------------------------------------------- */
+
+// createBitmapIndex
+/**
+ * Creates an index over an attribute of a table from the records the table
+ * holds now. The index is not open afterwards.
+ *
+ * @param idxId Name of the index file.
+ * @param rel The open table.
+ * @param attrNum The attribute.
+ * @return RC_OK, RC_INVALID_ATTR_NUM, RC_RM_UNKNOWN_DATATYPE for a FLOAT
+ *         attribute, or an error code.
+ */
+RC createBitmapIndex(char *idxId, RM_TableData *rel, int attrNum) {
+    BI_IndexHandle index;
+    BI_IndexMgmt *m;
+    RM_ScanHandle scan;
+    Record record;
+    DataType dt;
+    RC rc;
+
+    if (idxId == NULL || rel == NULL || rel->schema == NULL)
+        return RC_NULL_POINTER;
+    if (attrNum < 0 || attrNum >= rel->schema->numAttr)
+        return RC_INVALID_ATTR_NUM;
+    dt = rel->schema->dataTypes[attrNum];
+    if (dt != DT_INT && dt != DT_STRING && dt != DT_BOOL)
+        return RC_RM_UNKNOWN_DATATYPE;
+
+    if ((m = (BI_IndexMgmt *) calloc(1, sizeof(BI_IndexMgmt))) == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    m->keySize = normKeyAttrSize(dt, rel->schema->typeLength[attrNum]);
+    index.idxId = idxId;
+    index.rel = rel;
+    index.attrNum = attrNum;
+    index.keyType = dt;
+    index.mgmtData = m;
+
+    record.data = NULL;
+    if ((rc = startScan(rel, &scan, NULL)) == RC_OK) {
+        while ((rc = next(&scan, &record)) == RC_OK)
+            if ((rc = biInsert(&index, &record)) != RC_OK)
+                break;
+        closeScan(&scan);
+        if (rc == RC_RM_NO_MORE_TUPLES)
+            rc = RC_OK;
+    }
+    free(record.data);
+
+    if (rc == RC_OK && (rc = createPageFile(idxId)) == RC_OK)
+        rc = writeIndex(&index);
+    freeIndexMgmt(m);
+    return rc;
+}
+
+// openBitmapIndex
+/**
+ * Opens an index and attaches it to its table, which maintains it from now
+ * on and uses it in scans.
+ *
+ * @param index Receives the handle; release it with closeBitmapIndex before
+ *        closing the table.
+ * @param idxId Name of the index file.
+ * @param rel The open table the index was created on.
+ * @return RC_OK, RC_INVALID_ARGS if the table does not fit the index, or an
+ *         error code.
+ */
+RC openBitmapIndex(BI_IndexHandle **index, char *idxId, RM_TableData *rel) {
+    BI_IndexHandle *handle;
+    BI_IndexMgmt *m;
+    BI_Header header;
+    SM_FileHandle fh;
+    char *page;
+    RC rc;
+
+    *index = NULL;
+    m = (BI_IndexMgmt *) calloc(1, sizeof(BI_IndexMgmt));
+    handle = (BI_IndexHandle *) malloc(sizeof(BI_IndexHandle));
+    page = (char *) malloc(PAGE_SIZE);
+    if (m == NULL || handle == NULL || page == NULL) {
+        free(m);
+        free(handle);
+        free(page);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+
+    memset(&header, 0, sizeof(header));
+    if ((rc = openPageFile(idxId, &fh)) == RC_OK) {
+        if ((rc = readBlock(0, &fh, page)) == RC_OK) {
+            memcpy(&header, page, sizeof(BI_Header));
+            m->keySize = header.keySize;
+            if (header.attrNum >= rel->schema->numAttr
+                    || rel->schema->dataTypes[header.attrNum] != (DataType) header.keyType
+                    || normKeyAttrSize(header.keyType, rel->schema->typeLength[header.attrNum]) != header.keySize)
+                rc = RC_INVALID_ARGS;
+            else
+                rc = readIndex(&fh, &header, m);
+        }
+        closePageFile(&fh);
+    }
+    free(page);
+
+    handle->idxId = strdup(idxId);
+    handle->rel = rel;
+    handle->attrNum = header.attrNum;
+    handle->keyType = header.keyType;
+    handle->mgmtData = m;
+    if (rc == RC_OK)
+        rc = attachIndex(rel, &biHooks, handle);
+    if (rc != RC_OK) {
+        freeIndexMgmt(m);
+        free(handle->idxId);
+        free(handle);
+        return rc;
+    }
+
+    m->nextOpen = openIndexes;
+    openIndexes = handle;
+    *index = handle;
+    return RC_OK;
+}
+
+// closeBitmapIndex
+/**
+ * Detaches an index from its table and writes it if it changed.
+ *
+ * @param index The index.
+ * @return RC_OK, or the error of the storage manager.
+ */
+RC closeBitmapIndex(BI_IndexHandle *index) {
+    BI_IndexMgmt *m = INDEX_MGMT(index);
+    BI_IndexHandle **link;
+    RC rc = RC_OK;
+
+    for (link = &openIndexes; *link != NULL; link = &INDEX_MGMT(*link)->nextOpen)
+        if (*link == index) {
+            *link = m->nextOpen;
+            break;
+        }
+    detachIndex(index->rel, index);
+    if (m->dirty)
+        rc = writeIndex(index);
+    freeIndexMgmt(m);
+    free(index->idxId);
+    free(index);
+    return rc;
+}
+
+// Remove the file of an index
+RC deleteBitmapIndex(char *idxId) {
+    return destroyPageFile(idxId);
+}
+
+// Get the number of distinct values
+RC getBINumValues(BI_IndexHandle *index, int *result) {
+    *result = INDEX_MGMT(index)->numValues;
+    return RC_OK;
+}
+
+// Get the bytes the bitmaps of the values take in the file
+RC getBISize(BI_IndexHandle *index, int *result) {
+    BI_IndexMgmt *m = INDEX_MGMT(index);
+    int i, n = 0;
+
+    for (i = 0; i < m->numValues; i++)
+        n += m->keySize + bitmapBytes(&m->values[i].bitmap);
+    *result = n;
+    return RC_OK;
+}
+
+// biCountMatches
+/**
+ * Counts the records matching a condition from the bitmaps alone, without
+ * reading the table.
+ *
+ * @param rel The open table.
+ * @param cond The condition.
+ * @param result Receives the number of records.
+ * @return RC_OK, RC_INVALID_ARGS if a part of cond is on an attribute
+ *         without an open bitmap index, or an error code.
+ */
+RC biCountMatches(RM_TableData *rel, Expr *cond, int *result) {
+    BI_IndexHandle *index;
+    BI_Bitmap *matches;
+    bool exact;
+    RC rc;
+
+    for (index = openIndexes; index != NULL && index->rel != rel; index = INDEX_MGMT(index)->nextOpen);
+    if (index == NULL || cond == NULL)
+        return RC_INVALID_ARGS;
+    if ((rc = evalCondition(index, cond, &matches, &exact)) != RC_OK)
+        return rc;
+    if (matches == NULL || !exact) {
+        dropBitmap(matches);
+        return RC_INVALID_ARGS;
+    }
+    *result = bitmapCardinality(matches);
+    dropBitmap(matches);
+    return RC_OK;
+}
@@ -0,0 +1,52 @@
+#ifndef BITMAP_MGR_H
+#define BITMAP_MGR_H
+
+#include "dberror.h"
+#include "expr.h"
+#include "record_mgr.h"
+#include "tables.h"
+
+// Bitmap index over a low-cardinality attribute of a table
+//
+// For every distinct value of the attribute the index keeps a compressed
+// bitmap of the positions of the records that have it; the position of a
+// record is page * (PAGE_SIZE / 256) + slot. The bitmaps are Roaring-style:
+// positions are split by their high 16 bits into containers, and a container
+// holds its low halves as a sorted array while it has at most 4096 of them
+// and as a 65536-bit set above that.
+//
+// An open index is attached to its table (see attachIndex), so the table
+// keeps it up to date and scans use it. The comparisons of a scan condition
+// between an indexed attribute and a constant become bitmaps, which AND, OR
+// and NOT combine; the bitmap indexes open on the same table answer the
+// condition together, and only the records in the result are read. Parts of
+// the condition that no index covers are checked on those records.
+//
+// Indexes hold INT, STRING and BOOL attributes. Closing the index writes the
+// bitmaps to its file.
+
+// structure for accessing bitmap indexes
+typedef struct BI_IndexHandle {
+  char *idxId;
+  RM_TableData *rel;
+  int attrNum;
+  DataType keyType;
+  void *mgmtData;
+} BI_IndexHandle;
+
+// create an index over attribute attrNum of every record of an open table,
+// destroy it, and open and close it on that table
+extern RC createBitmapIndex (char *idxId, RM_TableData *rel, int attrNum);
+extern RC openBitmapIndex (BI_IndexHandle **index, char *idxId, RM_TableData *rel);
+extern RC closeBitmapIndex (BI_IndexHandle *index);
+extern RC deleteBitmapIndex (char *idxId);
+
+// access information about an index; the size is the bytes of its bitmaps
+extern RC getBINumValues (BI_IndexHandle *index, int *result);
+extern RC getBISize (BI_IndexHandle *index, int *result);
+
+// count the records matching cond from the bitmap indexes open on the table
+// alone; RC_INVALID_ARGS if they cannot answer all of cond
+extern RC biCountMatches (RM_TableData *rel, Expr *cond, int *result);
+
+#endif // BITMAP_MGR_H
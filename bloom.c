@@ -0,0 +1,93 @@
+#include "bloom.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOOM_BLOCK_BITS (BLOOM_BLOCK_SIZE * 8)
+
+// bloomBlocksFor
+/**
+ * Returns the number of blocks a filter needs for a number of keys.
+ *
+ * @param numKeys Keys the filter will hold.
+ * @return The number of blocks, at least 1.
+ */
+int bloomBlocksFor(int numKeys) {
+    long long bits = (long long) numKeys * BLOOM_BITS_PER_KEY;
+    long long blocks = (bits + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS;
+
+    return blocks < 1 ? 1 : (int) blocks;
+}
+
+// bloomCreate
+/**
+ * Allocates an empty filter, each block in a cache line of its own.
+ *
+ * @param numBlocks Number of blocks.
+ * @return The filter, or NULL if out of memory.
+ */
+unsigned char *bloomCreate(int numBlocks) {
+    void *filter;
+
+    if (posix_memalign(&filter, BLOOM_BLOCK_SIZE, (size_t) numBlocks * BLOOM_BLOCK_SIZE) != 0)
+        return NULL;
+    memset(filter, 0, (size_t) numBlocks * BLOOM_BLOCK_SIZE);
+    return (unsigned char *) filter;
+}
+
+// bloomHash
+/**
+ * Hashes the bytes of a key: FNV-1a, then mixed so that every bit of the
+ * result depends on every byte.
+ *
+ * @param key The key.
+ * @param len Its length in bytes.
+ * @return The hash.
+ */
+unsigned long long bloomHash(const void *key, int len) {
+    const unsigned char *p = (const unsigned char *) key;
+    unsigned long long h = 14695981039346656037ULL;
+    int i;
+
+    for (i = 0; i < len; i++)
+        h = (h ^ p[i]) * 1099511628211ULL;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// The high half of the hash picks the block, the low half the bits in it
+static unsigned char *blockOf(const unsigned char *filter, int numBlocks, unsigned long long hash) {
+    unsigned long long block = ((hash >> 32) * (unsigned long long) numBlocks) >> 32;
+    return (unsigned char *) filter + block * BLOOM_BLOCK_SIZE;
+}
+
+// Add a key to a filter
+void bloomAdd(unsigned char *filter, int numBlocks, unsigned long long hash) {
+    unsigned char *block = blockOf(filter, numBlocks, hash);
+    unsigned int bit = hash % BLOOM_BLOCK_BITS;
+    unsigned int step = (hash / BLOOM_BLOCK_BITS) % BLOOM_BLOCK_BITS | 1;
+    int i;
+
+    for (i = 0; i < BLOOM_HASHES; i++) {
+        block[bit >> 3] |= 1 << (bit & 7);
+        bit = (bit + step) % BLOOM_BLOCK_BITS;
+    }
+}
+
+// Test a key against a filter; false only for keys never added
+bool bloomMayContain(const unsigned char *filter, int numBlocks, unsigned long long hash) {
+    const unsigned char *block = blockOf(filter, numBlocks, hash);
+    unsigned int bit = hash % BLOOM_BLOCK_BITS;
+    unsigned int step = (hash / BLOOM_BLOCK_BITS) % BLOOM_BLOCK_BITS | 1;
+    int i;
+
+    for (i = 0; i < BLOOM_HASHES; i++) {
+        if (!(block[bit >> 3] & (1 << (bit & 7))))
+            return false;
+        bit = (bit + step) % BLOOM_BLOCK_BITS;
+    }
+    return true;
+}
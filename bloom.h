@@ -0,0 +1,30 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include "dt.h"
+
+// Blocked bloom filters
+//
+// A filter is an array of blocks of BLOOM_BLOCK_SIZE bytes, one cache line.
+// A key sets and tests BLOOM_HASHES bits, all in the one block its hash
+// picks, so a lookup touches a single cache line whatever the size of the
+// filter. With BLOOM_BITS_PER_KEY bits per key about 1% of the keys that
+// were never added pass the test. Filters never forget a key; they are
+// rebuilt by their owner to drop deleted ones.
+
+#define BLOOM_BLOCK_SIZE 64
+#define BLOOM_BITS_PER_KEY 10
+#define BLOOM_HASHES 7
+
+// blocks for numKeys keys, at least one
+extern int bloomBlocksFor (int numKeys);
+
+// a zeroed filter of numBlocks blocks, aligned to a cache line; free() it
+extern unsigned char *bloomCreate (int numBlocks);
+
+// hash of a key; add or test the key by its hash
+extern unsigned long long bloomHash (const void *key, int len);
+extern void bloomAdd (unsigned char *filter, int numBlocks, unsigned long long hash);
+extern rm_bool bloomMayContain (const unsigned char *filter, int numBlocks, unsigned long long hash);
+
+#endif // BLOOM_H
@@ -1,29 +1,954 @@
 #include "btree_mgr.h"
-#include "tables.h"
+#include "buffer_mgr.h"
 #include "storage_mgr.h"
-#include "record_mgr.h"
+#include "norm_key.h"
+#include "bloom.h"
+#include "expr.h"
+#include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// Define a file handle for the B-Tree
-SM_FileHandle btree_fh;
+// B+-tree index over the buffer pool
+//
+// Every index lives in its own page file. Page 0 is the tree header, every
+// other page holds one node or part of a long posting list. A key is one
+// or more attributes (createBtreeOnAttrs), stored as a normalized key (see
+// norm_key.h) of fixed size, so node search is a memcmp and never looks at
+// the key types. Callers pass a key as one Value per key attribute. A node
+// holds up to n keys (the n of createBtree). Inner nodes follow the keys
+// with n + 1 child pages. Leaves are chained left to right for scans.
+// Deletes only remove entries from their leaf; nodes are never merged.
+//
+// Duplicate keys: a leaf stores every key once, with the sorted list of its
+// RIDs. Lists are delta and varint encoded (see encodeRid) in an area that
+// grows down from the end of the leaf page, so a leaf splits when it runs
+// out of either key slots or bytes. A list that outgrows a quarter of that
+// area moves to a chain of posting pages and the leaf keeps a reference to
+// it. Posting pages of deleted lists are not reused.
+//
+// Each open tree has a buffer pool of its own. The header and inner nodes
+// are pinned with BM_HINT_HOT so that descents stay in memory, leaves are
+// pinned normally.
+//
+// Appends: the tree remembers the path to its rightmost leaf. A key that
+// belongs there is inserted without a descent, and when a full node on that
+// path overflows at its right end it is split 90/10 instead of in half, so
+// ascending keys leave nearly full nodes behind.
+//
+// Negative lookups: every tree keeps a blocked bloom filter (see bloom.h) of
+// its keys in memory, so findKey, openKeyScan and the deletes answer most
+// lookups of absent keys without pinning a page. Deleted keys stay in the
+// filter. When more keys were added than it was sized for, the filter is
+// rebuilt, twice as large, from the leaves; the same happens when a tree
+// without one is opened. Closing the tree writes it to pages of the index
+// file, reusing its old pages if it still fits.
 
-// Maximum number of elements
-int maxEle;
+#define BT_POOL_SIZE 64
+#define BT_MAX_HEIGHT 32
 
-// Structure definition for a B-Tree node
-typedef struct BTREE {
-    int *key;                  // Array of keys in the node
-    struct BTREE **next;    // Array of pointers to child nodes
-    RID *id;             // Array of record IDs associated with keys
-} BTree;
+// lookups interleaved by findKeys; must stay well below BT_POOL_SIZE
+#define BT_GROUP_SIZE 16
 
-// Root and scan pointers for the B-Tree
-BTree *root;
-BTree *scan;
+// most RIDs in one encoded list part: every RID after the first takes at
+// least two bytes
+#define BT_MAX_LIST (PAGE_SIZE / 2 + 1)
 
-// Index number (potentially for tracking multiple indices)
-int indexNum = 0;
+// internal result of the leaf insert path: split the leaf and try again
+#define BT_LEAF_FULL (-1)
+
+#define BT_MAX_KEY_ATTRS 8
+#define BT_MAX_KEY 256
+
+// fewest keys a bloom filter is sized for
+#define BT_FILTER_MIN_KEYS 256
+
+// Tree header, stored at the start of page 0
+typedef struct BT_Header {
+    int keyType;    // type of the first key attribute
+    int numAttrs;
+    int attrTypes[BT_MAX_KEY_ATTRS];
+    int attrLengths[BT_MAX_KEY_ATTRS];
+    int keySize;    // bytes of a normalized key
+    int order;      // n: maximum number of keys in a node
+    int root;
+    int height;     // levels including the leaves; 1 while the root is a leaf
+    int numNodes;
+    int numEntries; // (key, RID) pairs
+    int numPages;   // pages in the file, header included
+    int filterPage; // first page of the bloom filter, 0 before it is written
+    int filterPages;    // pages reserved for the filter
+    int filterBlocks;   // blocks of the filter, 0 if the tree has none
+    int filterKeys;     // keys added to the filter since it was built
+} BT_Header;
+
+// Node page layout: this header and order keys of keySize bytes, padded to
+// a multiple of 4, then int children[order + 1] in an inner node. A leaf
+// has unsigned short offsets[order] and lengths[order] locating each key's
+// RID list in the list area between heapTop and the end of the page.
+typedef struct BT_Node {
+    int isLeaf;
+    int numKeys;
+    int next;       // right sibling of a leaf, -1 for the last leaf
+    int heapTop;    // leaves: start of the list area
+    unsigned char keys[];
+} BT_Node;
+
+// Page of a long RID list; lists are chained in RID order
+typedef struct BT_PostingPage {
+    int next;       // next page of the list, -1 at the end
+    int count;
+    int bytes;      // size of the encoded RIDs in data
+    unsigned char data[];
+} BT_PostingPage;
+
+#define BT_POSTING_CAPACITY ((int) (PAGE_SIZE - sizeof(BT_PostingPage)))
+
+// Largest n for keys of keySize bytes: a leaf needs the key, its offset
+// and length and at least 4 bytes of list area per key
+#define BT_ORDER_FOR(keySize) ((int) ((PAGE_SIZE - sizeof(BT_Node) - 3) / ((keySize) + 2 * sizeof(unsigned short) + 4)))
+#define BT_MAX_ORDER BT_ORDER_FOR(1)
+
+// RID list of a leaf entry, as read from the page
+typedef struct BT_List {
+    int count;
+    int overflow;               // first posting page, -1 for a list in the leaf
+    const unsigned char *body;  // encoded RIDs of a list in the leaf
+} BT_List;
+
+// Per-tree state, kept in BTreeHandle.mgmtData
+typedef struct BT_TreeMgmt {
+    BM_BufferPool pool;
+    SM_FileHandle fh;
+    BT_Header header;   // cached copy of page 0, written back on close
+    unsigned char *filter;  // bloom filter of the keys
+    bool filterDirty;
+
+    // path to the rightmost leaf, valid until the next split
+    bool rightValid;
+    bool rightBounded;  // if not set, every key belongs in the rightmost leaf
+    unsigned char rightLow[BT_MAX_KEY]; // else keys >= rightLow do
+    int rightPath[BT_MAX_HEIGHT];
+} BT_TreeMgmt;
+
+// Scan state, kept in BT_ScanHandle.mgmtData
+typedef struct BT_ScanMgmt {
+    BM_PageHandle page; // current leaf, pinned while pinned is set
+    bool pinned;
+    int pos;            // next key in the leaf
+    RID *rids;          // decoded part of the current key's list
+    int numRids;
+    int ridPos;
+    int nextPosting;    // next posting page of the current list, -1 if none
+} BT_ScanMgmt;
+
+#define TREE_MGMT(tree) ((BT_TreeMgmt *) (tree)->mgmtData)
+#define NODE(data) ((BT_Node *) (data))
+#define POSTING(data) ((BT_PostingPage *) (data))
+
+static unsigned char *keyAt(BT_TreeMgmt *t, BT_Node *node, int pos) {
+    return node->keys + pos * t->header.keySize;
+}
+
+// Bytes of the key array, padded so that what follows is aligned
+static int keysBytes(BT_TreeMgmt *t) {
+    return (t->header.order * t->header.keySize + 3) & ~3;
+}
+
+static int *innerChildren(BT_TreeMgmt *t, BT_Node *node) {
+    return (int *) (node->keys + keysBytes(t));
+}
+
+static unsigned short *leafOffsets(BT_TreeMgmt *t, BT_Node *node) {
+    return (unsigned short *) (node->keys + keysBytes(t));
+}
+
+static unsigned short *leafLengths(BT_TreeMgmt *t, BT_Node *node) {
+    return leafOffsets(t, node) + t->header.order;
+}
+
+// First byte of the list area of a leaf
+static int heapStart(BT_TreeMgmt *t) {
+    return sizeof(BT_Node) + keysBytes(t) + t->header.order * 2 * sizeof(unsigned short);
+}
+
+// Longest list kept in the leaf itself
+static int maxInlineList(BT_TreeMgmt *t) {
+    return (PAGE_SIZE - heapStart(t)) / 4;
+}
+
+// First position of a node whose key is >= key
+static int lowerBound(BT_TreeMgmt *t, BT_Node *node, const unsigned char *key) {
+    int size = t->header.keySize;
+    int lo = 0, hi = node->numKeys;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (memcmp(node->keys + mid * size, key, size) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// First position whose key is > key; in an inner node, the child to follow
+static int upperBound(BT_TreeMgmt *t, BT_Node *node, const unsigned char *key) {
+    int size = t->header.keySize;
+    int lo = 0, hi = node->numKeys;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (memcmp(node->keys + mid * size, key, size) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Whether the key at pos of a node equals key
+static bool keyEquals(BT_TreeMgmt *t, BT_Node *node, int pos, const unsigned char *key) {
+    return pos < node->numKeys && memcmp(keyAt(t, node, pos), key, t->header.keySize) == 0;
+}
+
+// Keys left in the lower node when total keys overflow a node. Appends
+// keep about 90% on the left; at least one key always moves right.
+static int splitPoint(int total, bool append) {
+    int right = total / 10 > 1 ? total / 10 : 1;
+    return append ? total - right : (total + 1) / 2;
+}
+
+static int compareRids(RID a, RID b) {
+    if (a.page != b.page)
+        return a.page < b.page ? -1 : 1;
+    if (a.slot != b.slot)
+        return a.slot < b.slot ? -1 : 1;
+    return 0;
+}
+
+static int putVarint(unsigned char *out, unsigned int v) {
+    int n = 0;
+    while (v >= 0x80) {
+        out[n++] = (unsigned char) (v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char) v;
+    return n;
+}
+
+static int getVarint(const unsigned char *in, unsigned int *v) {
+    int n = 0, shift = 0;
+    *v = 0;
+    do {
+        *v |= (unsigned int) (in[n] & 0x7f) << shift;
+        shift += 7;
+    } while (in[n++] & 0x80);
+    return n;
+}
+
+// encodeRid
+/**
+ * Encodes one RID of a sorted list relative to its predecessor: a page
+ * delta and the slot, or a zero page delta and the slot delta for a RID on
+ * the same page. The first RID of a list is stored as it is.
+ *
+ * @param prev The previous RID of the list, NULL for the first one.
+ * @param rid The RID to encode.
+ * @param out Receives at most 10 bytes.
+ * @return Number of bytes written.
+ */
+static int encodeRid(const RID *prev, RID rid, unsigned char *out) {
+    int n;
+
+    if (prev == NULL) {
+        n = putVarint(out, rid.page);
+        return n + putVarint(out + n, rid.slot);
+    }
+    if (rid.page == prev->page) {
+        n = putVarint(out, 0);
+        return n + putVarint(out + n, rid.slot - prev->slot);
+    }
+    n = putVarint(out, rid.page - prev->page);
+    return n + putVarint(out + n, rid.slot);
+}
+
+static int encodeRids(const RID *rids, int count, unsigned char *out) {
+    int len = 0, i;
+    for (i = 0; i < count; i++)
+        len += encodeRid(i > 0 ? &rids[i - 1] : NULL, rids[i], out + len);
+    return len;
+}
+
+static int decodeRids(const unsigned char *in, int count, RID *rids) {
+    unsigned int page, slot;
+    int len = 0, i;
+
+    for (i = 0; i < count; i++) {
+        len += getVarint(in + len, &page);
+        len += getVarint(in + len, &slot);
+        if (i == 0) {
+            rids[i].page = page;
+            rids[i].slot = slot;
+        } else if (page == 0) {
+            rids[i].page = rids[i - 1].page;
+            rids[i].slot = rids[i - 1].slot + slot;
+        } else {
+            rids[i].page = rids[i - 1].page + page;
+            rids[i].slot = slot;
+        }
+    }
+    return len;
+}
+
+// A list kept in the leaf: the count, then the encoded RIDs
+static int encodeInlineList(const RID *rids, int count, unsigned char *out) {
+    int n = putVarint(out, count);
+    return n + encodeRids(rids, count, out + n);
+}
+
+// A list moved to posting pages: a zero count, the first page and the count
+static int encodeListRef(int first, int count, unsigned char *out) {
+    int n = putVarint(out, 0);
+    n += putVarint(out + n, first);
+    return n + putVarint(out + n, count);
+}
+
+static void readList(BT_TreeMgmt *t, BT_Node *node, int pos, BT_List *list) {
+    const unsigned char *p = (const unsigned char *) node + leafOffsets(t, node)[pos];
+    unsigned int v;
+
+    p += getVarint(p, &v);
+    if (v > 0) {
+        list->count = v;
+        list->overflow = -1;
+        list->body = p;
+        return;
+    }
+    p += getVarint(p, &v);
+    list->overflow = v;
+    getVarint(p, &v);
+    list->count = v;
+    list->body = NULL;
+}
+
+// Whether a leaf has room for a list of len bytes, replacing the list at
+// replaced (or none if -1)
+static bool leafFits(BT_TreeMgmt *t, BT_Node *node, int replaced, int len) {
+    unsigned short *lengths = leafLengths(t, node);
+    int live = len, i;
+
+    for (i = 0; i < node->numKeys; i++)
+        if (i != replaced)
+            live += lengths[i];
+    return live <= PAGE_SIZE - heapStart(t);
+}
+
+// Pack the lists of a leaf at the end of the page, dropping dead space
+static void compactLeaf(BT_TreeMgmt *t, BT_Node *node) {
+    char buffer[PAGE_SIZE];
+    unsigned short *offsets = leafOffsets(t, node);
+    unsigned short *lengths = leafLengths(t, node);
+    int top = PAGE_SIZE, i;
+
+    for (i = 0; i < node->numKeys; i++) {
+        top -= lengths[i];
+        memcpy(buffer + top, (char *) node + offsets[i], lengths[i]);
+        offsets[i] = top;
+    }
+    memcpy((char *) node + top, buffer + top, PAGE_SIZE - top);
+    node->heapTop = top;
+}
+
+// Store the list of the entry at pos; leafFits must have said yes
+static void putList(BT_TreeMgmt *t, BT_Node *node, int pos, const unsigned char *list, int len) {
+    leafLengths(t, node)[pos] = 0;
+    if (node->heapTop - heapStart(t) < len)
+        compactLeaf(t, node);
+    node->heapTop -= len;
+    memcpy((char *) node + node->heapTop, list, len);
+    leafOffsets(t, node)[pos] = node->heapTop;
+    leafLengths(t, node)[pos] = len;
+}
+
+// Open a slot for a new key at pos
+static void insertLeafSlot(BT_TreeMgmt *t, BT_Node *node, int pos, const unsigned char *key) {
+    unsigned short *offsets = leafOffsets(t, node);
+    unsigned short *lengths = leafLengths(t, node);
+    int size = t->header.keySize;
+    int move = node->numKeys - pos;
+
+    memmove(keyAt(t, node, pos + 1), keyAt(t, node, pos), move * size);
+    memmove(offsets + pos + 1, offsets + pos, move * sizeof(unsigned short));
+    memmove(lengths + pos + 1, lengths + pos, move * sizeof(unsigned short));
+    memcpy(keyAt(t, node, pos), key, size);
+    lengths[pos] = 0;
+    node->numKeys++;
+}
+
+// Remove the key at pos and its list
+static void removeLeafSlot(BT_TreeMgmt *t, BT_Node *node, int pos) {
+    unsigned short *offsets = leafOffsets(t, node);
+    unsigned short *lengths = leafLengths(t, node);
+    int move = node->numKeys - pos - 1;
+
+    memmove(keyAt(t, node, pos), keyAt(t, node, pos + 1), move * t->header.keySize);
+    memmove(offsets + pos, offsets + pos + 1, move * sizeof(unsigned short));
+    memmove(lengths + pos, lengths + pos + 1, move * sizeof(unsigned short));
+    node->numKeys--;
+}
+
+// toKey
+/**
+ * Converts the values of a key into the normalized key stored in the nodes.
+ *
+ * @param t The tree.
+ * @param values One value per key attribute, of the attribute's type.
+ * @param key Receives keySize bytes.
+ * @return RC_OK, or an error code for a value of the wrong type.
+ */
+static RC toKey(BT_TreeMgmt *t, Value *values, unsigned char *key) {
+    int i;
+    RC rc;
+
+    for (i = 0; i < t->header.numAttrs; i++) {
+        if (values[i].dt != t->header.attrTypes[i])
+            return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+        if ((rc = normalizeValue(&values[i], t->header.attrLengths[i], (char *) key)) != RC_OK)
+            return rc;
+        key += normKeyAttrSize(values[i].dt, t->header.attrLengths[i]);
+    }
+    return RC_OK;
+}
+
+static BM_PageHint levelHint(BT_TreeMgmt *t, int level) {
+    return level < t->header.height - 1 ? BM_HINT_HOT : BM_HINT_NORMAL;
+}
+
+// allocPage
+/**
+ * Appends a zeroed page to the index file and leaves it pinned.
+ *
+ * @param t The tree.
+ * @param hint Hint to pin the page with.
+ * @param page Receives the pinned page.
+ * @return RC_OK on success, or the error of the storage or buffer manager.
+ */
+static RC allocPage(BT_TreeMgmt *t, BM_PageHint hint, BM_PageHandle *page) {
+    int pageNum = t->header.numPages;
+    RC rc;
+
+    if ((rc = ensureCapacity(pageNum + 1, &t->fh)) != RC_OK)
+        return rc;
+    if ((rc = pinPageWithHint(&t->pool, page, pageNum, hint)) != RC_OK)
+        return rc;
+
+    memset(page->data, 0, PAGE_SIZE);
+    markDirty(&t->pool, page);
+    t->header.numPages++;
+    return RC_OK;
+}
+
+// Append an empty node and leave it pinned
+static RC allocNode(BT_TreeMgmt *t, bool isLeaf, BM_PageHandle *page) {
+    BT_Node *node;
+    RC rc;
+
+    if ((rc = allocPage(t, isLeaf ? BM_HINT_NORMAL : BM_HINT_HOT, page)) != RC_OK)
+        return rc;
+    node = NODE(page->data);
+    node->isLeaf = isLeaf;
+    node->numKeys = 0;
+    node->next = -1;
+    node->heapTop = PAGE_SIZE;
+    t->header.numNodes++;
+    return RC_OK;
+}
+
+// buildPostingList
+/**
+ * Writes a sorted RID list to a new chain of posting pages.
+ *
+ * @param t The tree.
+ * @param rids The RIDs, sorted.
+ * @param count Number of RIDs.
+ * @param first Receives the first page of the chain.
+ * @return RC_OK on success, or the error of the storage or buffer manager.
+ */
+static RC buildPostingList(BT_TreeMgmt *t, const RID *rids, int count, int *first) {
+    BM_PageHandle page, prev;
+    bool havePrev = false;
+    unsigned char scratch[20];
+    int start = 0;
+    RC rc;
+
+    while (start < count) {
+        int end = start, bytes = 0;
+        BT_PostingPage *p;
+
+        while (end < count) {
+            int len = encodeRid(end > start ? &rids[end - 1] : NULL, rids[end], scratch);
+            if (bytes + len > BT_POSTING_CAPACITY)
+                break;
+            bytes += len;
+            end++;
+        }
+
+        if ((rc = allocPage(t, BM_HINT_NORMAL, &page)) != RC_OK) {
+            if (havePrev)
+                unpinPage(&t->pool, &prev);
+            return rc;
+        }
+        p = POSTING(page.data);
+        p->next = -1;
+        p->count = end - start;
+        p->bytes = encodeRids(rids + start, end - start, p->data);
+
+        if (havePrev) {
+            POSTING(prev.data)->next = page.pageNum;
+            unpinPage(&t->pool, &prev);
+        } else {
+            *first = page.pageNum;
+        }
+        prev = page;
+        havePrev = true;
+        start = end;
+    }
+    if (havePrev)
+        unpinPage(&t->pool, &prev);
+    return RC_OK;
+}
+
+// findPostingPage
+/**
+ * Walks a posting chain to the page that holds rid or would hold it.
+ *
+ * @param t The tree.
+ * @param first First page of the chain.
+ * @param rid The RID.
+ * @param page Receives the page, pinned.
+ * @param prev Receives its predecessor, pinned, unless it is the first page
+ *        (prev->pageNum is then NO_PAGE).
+ * @return RC_OK on success, or the error of the buffer manager.
+ */
+static RC findPostingPage(BT_TreeMgmt *t, int first, RID rid, BM_PageHandle *page, BM_PageHandle *prev) {
+    BM_PageHandle next;
+    RC rc;
+
+    prev->pageNum = NO_PAGE;
+    if ((rc = pinPage(&t->pool, page, first)) != RC_OK)
+        return rc;
+
+    while (POSTING(page->data)->next >= 0) {
+        RID nextFirst;
+
+        if ((rc = pinPage(&t->pool, &next, POSTING(page->data)->next)) != RC_OK)
+            break;
+        decodeRids(POSTING(next.data)->data, 1, &nextFirst);
+        if (compareRids(rid, nextFirst) < 0) {
+            unpinPage(&t->pool, &next);
+            return RC_OK;
+        }
+        if (prev->pageNum != NO_PAGE)
+            unpinPage(&t->pool, prev);
+        *prev = *page;
+        *page = next;
+    }
+
+    if (rc != RC_OK) {
+        unpinPage(&t->pool, page);
+        if (prev->pageNum != NO_PAGE)
+            unpinPage(&t->pool, prev);
+    }
+    return rc;
+}
+
+// Insert a RID into a posting chain, splitting the page it lands on if full
+static RC insertIntoPosting(BT_TreeMgmt *t, int first, RID rid) {
+    RID rids[BT_MAX_LIST + 1];
+    unsigned char encoded[PAGE_SIZE + 32];
+    BM_PageHandle page, prev, sibling;
+    BT_PostingPage *p;
+    int count, pos, len;
+    RC rc;
+
+    if ((rc = findPostingPage(t, first, rid, &page, &prev)) != RC_OK)
+        return rc;
+    if (prev.pageNum != NO_PAGE)
+        unpinPage(&t->pool, &prev);
+
+    p = POSTING(page.data);
+    count = p->count;
+    decodeRids(p->data, count, rids);
+    for (pos = 0; pos < count && compareRids(rids[pos], rid) < 0; pos++)
+        ;
+    if (pos < count && compareRids(rids[pos], rid) == 0) {
+        unpinPage(&t->pool, &page);
+        return RC_IM_KEY_ALREADY_EXISTS;
+    }
+    memmove(rids + pos + 1, rids + pos, (count - pos) * sizeof(RID));
+    rids[pos] = rid;
+    count++;
+
+    len = encodeRids(rids, count, encoded);
+    if (len <= BT_POSTING_CAPACITY) {
+        memcpy(p->data, encoded, len);
+        p->count = count;
+        p->bytes = len;
+    } else {
+        int half = count / 2;
+        BT_PostingPage *s;
+
+        if ((rc = allocPage(t, BM_HINT_NORMAL, &sibling)) != RC_OK) {
+            unpinPage(&t->pool, &page);
+            return rc;
+        }
+        s = POSTING(sibling.data);
+        s->count = count - half;
+        s->bytes = encodeRids(rids + half, count - half, s->data);
+        s->next = p->next;
+        p->count = half;
+        p->bytes = encodeRids(rids, half, p->data);
+        p->next = sibling.pageNum;
+        unpinPage(&t->pool, &sibling);
+    }
+    markDirty(&t->pool, &page);
+    return unpinPage(&t->pool, &page);
+}
+
+// Remove a RID from a posting chain; emptied pages are unlinked
+static RC deleteFromPosting(BT_TreeMgmt *t, int first, RID rid) {
+    RID rids[BT_MAX_LIST];
+    BM_PageHandle page, prev, next;
+    BT_PostingPage *p;
+    int count, pos;
+    RC rc;
+
+    if ((rc = findPostingPage(t, first, rid, &page, &prev)) != RC_OK)
+        return rc;
+
+    p = POSTING(page.data);
+    count = p->count;
+    decodeRids(p->data, count, rids);
+    for (pos = 0; pos < count && compareRids(rids[pos], rid) < 0; pos++)
+        ;
+    if (pos == count || compareRids(rids[pos], rid) != 0) {
+        rc = RC_IM_KEY_NOT_FOUND;
+    } else {
+        memmove(rids + pos, rids + pos + 1, (count - pos - 1) * sizeof(RID));
+        count--;
+        p->count = count;
+        p->bytes = encodeRids(rids, count, p->data);
+        markDirty(&t->pool, &page);
+
+        if (count == 0 && prev.pageNum != NO_PAGE) {
+            POSTING(prev.data)->next = p->next;
+            markDirty(&t->pool, &prev);
+        } else if (count == 0 && p->next >= 0 && (rc = pinPage(&t->pool, &next, p->next)) == RC_OK) {
+            // the first page is referenced by the leaf: pull the second one in
+            memcpy(page.data, next.data, PAGE_SIZE);
+            unpinPage(&t->pool, &next);
+        }
+    }
+
+    if (prev.pageNum != NO_PAGE)
+        unpinPage(&t->pool, &prev);
+    unpinPage(&t->pool, &page);
+    return rc;
+}
+
+// First RID of a list
+static RC firstRid(BT_TreeMgmt *t, const BT_List *list, RID *rid) {
+    BM_PageHandle page;
+    RC rc;
+
+    if (list->overflow < 0) {
+        decodeRids(list->body, 1, rid);
+        return RC_OK;
+    }
+    if ((rc = pinPage(&t->pool, &page, list->overflow)) != RC_OK)
+        return rc;
+    decodeRids(POSTING(page.data)->data, 1, rid);
+    return unpinPage(&t->pool, &page);
+}
+
+// findLeaf
+/**
+ * Descends from the root to the leaf that may hold key.
+ *
+ * @param t The tree.
+ * @param key The normalized key to look for.
+ * @param path If not NULL, receives the page of every level, root first.
+ * @param low If not NULL, receives the smallest key routed to the leaf,
+ *        and lowSet whether there is one.
+ * @param lowSet See low.
+ * @param leaf Receives the pinned leaf.
+ * @return RC_OK on success, or the error of the buffer manager.
+ */
+static RC findLeaf(BT_TreeMgmt *t, const unsigned char *key, int *path,
+                   unsigned char *low, bool *lowSet, BM_PageHandle *leaf) {
+    int pageNum = t->header.root;
+    int level;
+    RC rc;
+
+    if (low)
+        *lowSet = false;
+    for (level = 0; ; level++) {
+        BT_Node *node;
+        int child;
+
+        if ((rc = pinPageWithHint(&t->pool, leaf, pageNum, levelHint(t, level))) != RC_OK)
+            return rc;
+        if (path)
+            path[level] = pageNum;
+        node = NODE(leaf->data);
+        if (node->isLeaf)
+            return RC_OK;
+
+        child = upperBound(t, node, key);
+        if (low && child > 0) {
+            memcpy(low, keyAt(t, node, child - 1), t->header.keySize);
+            *lowSet = true;
+        }
+        pageNum = innerChildren(t, node)[child];
+        if ((rc = unpinPage(&t->pool, leaf)) != RC_OK)
+            return rc;
+    }
+}
+
+// insertIntoParent
+/**
+ * Adds the separator of a split node to the inner node above it, splitting
+ * inner nodes and growing a new root as needed.
+ *
+ * @param t The tree.
+ * @param path The pages from the root to the split node.
+ * @param level Level of the parent on path; -1 when the root was split.
+ * @param separator The smallest key reachable through child.
+ * @param child The new right node.
+ * @param append Whether the split came from an append to the rightmost leaf.
+ * @return RC_OK on success, or the error of the storage or buffer manager.
+ */
+static RC insertIntoParent(BT_TreeMgmt *t, int *path, int level, const unsigned char *separator,
+                           int child, bool append) {
+    // the keys of a node fit a page
+    unsigned char keys[PAGE_SIZE + BT_MAX_KEY];
+    unsigned char key[BT_MAX_KEY];
+    int children[BT_MAX_ORDER + 2];
+    int order = t->header.order;
+    int size = t->header.keySize;
+    BM_PageHandle page, sibling;
+    RC rc;
+
+    memcpy(key, separator, size);
+
+    for (; level >= 0; level--) {
+        BT_Node *node, *right;
+        int *nodeChildren;
+        int pos, total, leftKeys;
+
+        if ((rc = pinPageWithHint(&t->pool, &page, path[level], BM_HINT_HOT)) != RC_OK)
+            return rc;
+        node = NODE(page.data);
+        nodeChildren = innerChildren(t, node);
+        pos = upperBound(t, node, key);
+
+        if (node->numKeys < order) {
+            memmove(keyAt(t, node, pos + 1), keyAt(t, node, pos), (node->numKeys - pos) * size);
+            memmove(nodeChildren + pos + 2, nodeChildren + pos + 1, (node->numKeys - pos) * sizeof(int));
+            memcpy(keyAt(t, node, pos), key, size);
+            nodeChildren[pos + 1] = child;
+            node->numKeys++;
+            markDirty(&t->pool, &page);
+            return unpinPage(&t->pool, &page);
+        }
+
+        // Split: the left node keeps the lower keys, the next key moves up
+        total = order + 1;
+        memcpy(keys, node->keys, pos * size);
+        memcpy(keys + pos * size, key, size);
+        memcpy(keys + (pos + 1) * size, keyAt(t, node, pos), (order - pos) * size);
+        memcpy(children, nodeChildren, (pos + 1) * sizeof(int));
+        children[pos + 1] = child;
+        memcpy(children + pos + 2, nodeChildren + pos + 1, (order - pos) * sizeof(int));
+
+        if ((rc = allocNode(t, false, &sibling)) != RC_OK) {
+            unpinPage(&t->pool, &page);
+            return rc;
+        }
+        right = NODE(sibling.data);
+        leftKeys = splitPoint(total - 1, append && pos == order);
+
+        node->numKeys = leftKeys;
+        memcpy(node->keys, keys, leftKeys * size);
+        memcpy(nodeChildren, children, (leftKeys + 1) * sizeof(int));
+
+        right->numKeys = total - leftKeys - 1;
+        memcpy(right->keys, keys + (leftKeys + 1) * size, right->numKeys * size);
+        memcpy(innerChildren(t, right), children + leftKeys + 1, (right->numKeys + 1) * sizeof(int));
+
+        memcpy(key, keys + leftKeys * size, size);
+        child = sibling.pageNum;
+        markDirty(&t->pool, &page);
+        unpinPage(&t->pool, &sibling);
+        if ((rc = unpinPage(&t->pool, &page)) != RC_OK)
+            return rc;
+    }
+
+    // The root was split: grow the tree by one level
+    if ((rc = allocNode(t, false, &page)) != RC_OK)
+        return rc;
+    NODE(page.data)->numKeys = 1;
+    memcpy(NODE(page.data)->keys, key, size);
+    innerChildren(t, NODE(page.data))[0] = t->header.root;
+    innerChildren(t, NODE(page.data))[1] = child;
+    t->header.root = page.pageNum;
+    t->header.height++;
+    return unpinPage(&t->pool, &page);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Bloom filter                                                            */
+/* ---------------------------------------------------------------------- */
+
+static unsigned long long filterHash(BT_TreeMgmt *t, const unsigned char *key) {
+    return bloomHash(key, t->header.keySize);
+}
+
+// Whether a normalized key may be in the tree; false only if it is not
+static bool filterMayContain(BT_TreeMgmt *t, const unsigned char *key) {
+    return bloomMayContain(t->filter, t->header.filterBlocks, filterHash(t, key));
+}
+
+// buildFilter
+/**
+ * Replaces the bloom filter with one made from the keys in the leaves.
+ *
+ * @param t The tree.
+ * @param expectedKeys Keys the tree holds about; the filter is sized for
+ *        twice as many, so it can grow before the next rebuild.
+ * @return RC_OK on success, or an error code.
+ */
+static RC buildFilter(BT_TreeMgmt *t, int expectedKeys) {
+    int numBlocks = bloomBlocksFor(2 * (expectedKeys < BT_FILTER_MIN_KEYS ? BT_FILTER_MIN_KEYS : expectedKeys));
+    unsigned char *filter = bloomCreate(numBlocks);
+    BM_PageHandle page;
+    int pageNum = t->header.root, level, numKeys = 0, i;
+    RC rc;
+
+    if (filter == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+
+    // down the leftmost path, then along the leaves
+    for (level = 0; level < t->header.height - 1; level++) {
+        if ((rc = pinPageWithHint(&t->pool, &page, pageNum, BM_HINT_HOT)) != RC_OK) {
+            free(filter);
+            return rc;
+        }
+        pageNum = innerChildren(t, NODE(page.data))[0];
+        unpinPage(&t->pool, &page);
+    }
+    while (pageNum >= 0) {
+        BT_Node *node;
+
+        if ((rc = pinPage(&t->pool, &page, pageNum)) != RC_OK) {
+            free(filter);
+            return rc;
+        }
+        node = NODE(page.data);
+        for (i = 0; i < node->numKeys; i++)
+            bloomAdd(filter, numBlocks, filterHash(t, keyAt(t, node, i)));
+        numKeys += node->numKeys;
+        pageNum = node->next;
+        unpinPage(&t->pool, &page);
+    }
+
+    free(t->filter);
+    t->filter = filter;
+    t->header.filterBlocks = numBlocks;
+    t->header.filterKeys = numKeys;
+    t->filterDirty = true;
+    return RC_OK;
+}
+
+// Add a key new to the tree, rebuilding the filter once it holds too many
+static RC filterAdd(BT_TreeMgmt *t, const unsigned char *key) {
+    long long capacity = (long long) t->header.filterBlocks * BLOOM_BLOCK_SIZE * 8 / BLOOM_BITS_PER_KEY;
+
+    bloomAdd(t->filter, t->header.filterBlocks, filterHash(t, key));
+    t->header.filterKeys++;
+    t->filterDirty = true;
+    if (t->header.filterKeys > capacity)
+        return buildFilter(t, t->header.filterKeys);
+    return RC_OK;
+}
+
+// readFilter
+/**
+ * Reads the bloom filter from the index file, or builds it for a tree that
+ * has none.
+ *
+ * @param t The tree, with its header read.
+ * @return RC_OK on success, or an error code.
+ */
+static RC readFilter(BT_TreeMgmt *t) {
+    int bytes = t->header.filterBlocks * BLOOM_BLOCK_SIZE;
+    BM_PageHandle page;
+    int done, pageNum;
+    RC rc;
+
+    if (t->header.filterBlocks == 0 || t->header.filterPage == 0)
+        return buildFilter(t, t->header.numEntries);
+    if ((t->filter = bloomCreate(t->header.filterBlocks)) == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (done = 0, pageNum = t->header.filterPage; done < bytes; done += PAGE_SIZE, pageNum++) {
+        int n = bytes - done < PAGE_SIZE ? bytes - done : PAGE_SIZE;
+
+        if ((rc = pinPage(&t->pool, &page, pageNum)) != RC_OK)
+            return rc;
+        memcpy(t->filter + done, page.data, n);
+        unpinPage(&t->pool, &page);
+    }
+    return RC_OK;
+}
+
+// writeFilter
+/**
+ * Writes a changed bloom filter to the index file. A filter that outgrew
+ * its pages moves to new pages at the end of the file.
+ *
+ * @param t The tree.
+ * @return RC_OK on success, or the error of the storage or buffer manager.
+ */
+static RC writeFilter(BT_TreeMgmt *t) {
+    int bytes = t->header.filterBlocks * BLOOM_BLOCK_SIZE;
+    int pages = (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    bool grow = pages > t->header.filterPages;
+    BM_PageHandle page;
+    int i;
+    RC rc;
+
+    if (!t->filterDirty)
+        return RC_OK;
+    if (grow) {
+        t->header.filterPage = t->header.numPages;
+        t->header.filterPages = pages;
+    }
+    for (i = 0; i < pages; i++) {
+        int n = bytes - i * PAGE_SIZE < PAGE_SIZE ? bytes - i * PAGE_SIZE : PAGE_SIZE;
+
+        if (grow)
+            rc = allocPage(t, BM_HINT_NORMAL, &page);
+        else
+            rc = pinPage(&t->pool, &page, t->header.filterPage + i);
+        if (rc != RC_OK)
+            return rc;
+        memset(page.data, 0, PAGE_SIZE);
+        memcpy(page.data, t->filter + i * PAGE_SIZE, n);
+        markDirty(&t->pool, &page);
+        unpinPage(&t->pool, &page);
+    }
+    t->filterDirty = false;
+    return RC_OK;
+}
 
 // Initialize the index manager
 RC initIndexManager(void *mgmtData) {
@@ -35,342 +960,965 @@ RC shutdownIndexManager() {
     return RC_OK;
 }
 
+// createIndex
+/**
+ * Creates an empty index file: the header page and an empty root leaf.
+ *
+ * @param idxId Name of the index file.
+ * @param numAttrs Number of key attributes.
+ * @param types The type of every key attribute.
+ * @param lengths The length of every DT_STRING key attribute.
+ * @param n Maximum number of keys per node.
+ * @return RC_OK on success, RC_IM_N_TO_LAGE if n keys do not fit a node,
+ *         or an error code.
+ */
+static RC createIndex(char *idxId, int numAttrs, DataType *types, int *lengths, int n) {
+    SM_FileHandle fh;
+    BT_Header header;
+    char *page;
+    int i;
+    RC rc;
+
+    if (numAttrs < 1 || numAttrs > BT_MAX_KEY_ATTRS || n < 2)
+        return RC_INVALID_ARGS;
+    memset(&header, 0, sizeof(BT_Header));
+    for (i = 0; i < numAttrs; i++) {
+        int size = normKeyAttrSize(types[i], lengths[i]);
+
+        if (size < 0)
+            return RC_RM_UNKNOWN_DATATYPE;
+        if (types[i] == DT_STRING && lengths[i] < 0)
+            return RC_INVALID_ARGS;
+        header.attrTypes[i] = types[i];
+        header.attrLengths[i] = types[i] == DT_STRING ? lengths[i] : 0;
+        header.keySize += size;
+    }
+    if (header.keySize > BT_MAX_KEY || n > BT_ORDER_FOR(header.keySize))
+        return RC_IM_N_TO_LAGE;
 
-// Create a B-tree
-RC createBtree(char *indexID, DataType keyType, int maxElements) {
-    int index;
-    root = (BTree*) malloc(sizeof(BTree));
-    if (!root) return RC_MEM_ALLOCATION_FAIL;
+    if ((rc = createPageFile(idxId)) != RC_OK)
+        return rc;
+    if ((rc = openPageFile(idxId, &fh)) != RC_OK)
+        return rc;
 
-    root->key = malloc(sizeof(int) * maxElements);
-    root->id = malloc(sizeof(int) * maxElements);
-    root->next = malloc(sizeof(BTree*) * (maxElements + 1));
-    
-    if (!root->key || !root->id || !root->next) {
-        free(root->key);
-        free(root->id);
-        free(root->next);
-        free(root);
+    page = (char *) calloc(PAGE_SIZE, sizeof(char));
+    if (page == NULL) {
+        closePageFile(&fh);
         return RC_MEM_ALLOCATION_FAIL;
     }
 
-    for (index = 0; index <= maxElements; index++) {
-        root->next[index] = NULL;
+    header.keyType = types[0];
+    header.numAttrs = numAttrs;
+    header.order = n;
+    header.root = 1;
+    header.height = 1;
+    header.numNodes = 1;
+    header.numEntries = 0;
+    header.numPages = 2;
+    memcpy(page, &header, sizeof(BT_Header));
+    rc = writeBlock(0, &fh, page);
+
+    // page 1: the root, an empty leaf
+    if (rc == RC_OK) {
+        memset(page, 0, PAGE_SIZE);
+        NODE(page)->isLeaf = true;
+        NODE(page)->next = -1;
+        NODE(page)->heapTop = PAGE_SIZE;
+        rc = writeBlock(1, &fh, page);
     }
-    
-    maxEle = maxElements;
-    createPageFile(indexID);
-    
-    return RC_OK;
-}
 
-// Open a B-tree
-RC openBtree(BTreeHandle **treeHandle, char *indexID) {
-    // Attempt to open the page file using the provided index ID
-    RC status = openPageFile(indexID, &btree_fh);
-    
-    if (status == RC_OK) {
-        // Successfully opened the page file, assign to the tree handle
-        *treeHandle = &btree_fh;
-        return RC_OK;
-    } else {
-        // Failed to open the page file, log error or handle it accordingly
-        *treeHandle = NULL;
-        return RC_FILE_NOT_FOUND; // Provides more specific error information
+    free(page);
+    if (rc != RC_OK) {
+        closePageFile(&fh);
+        return rc;
     }
+    return closePageFile(&fh);
 }
 
+// createBtree
+/**
+ * Creates an empty index on a single key of type keyType.
+ *
+ * @param idxId Name of the index file.
+ * @param keyType DT_INT, DT_FLOAT or DT_BOOL; string keys need a length,
+ *        see createBtreeOnAttrs.
+ * @param n Maximum number of keys per node.
+ * @return RC_OK on success, RC_IM_N_TO_LAGE if n keys do not fit a node,
+ *         or an error code.
+ */
+RC createBtree(char *idxId, DataType keyType, int n) {
+    int length = 0;
 
-// close a B-tree
-RC closeBtree(BTreeHandle *tree) {
-    // Attempt to close the page file associated with the B-tree
-    if (closePageFile(&btree_fh) == 0) {
-        // If successful, free the memory allocated for the root
-        free(root);
-        return RC_OK;  // Return OK status
-    } else {
-        return RC_ERROR;  // Return ERROR status if page file closing failed
+    if (keyType != DT_INT && keyType != DT_FLOAT && keyType != DT_BOOL)
+        return RC_RM_UNKNOWN_DATATYPE;
+    return createIndex(idxId, 1, &keyType, &length, n);
+}
+
+// createBtreeOnAttrs
+/**
+ * Creates an empty index whose key is some attributes of a schema, compared
+ * in the order given. Keys are then passed as numAttrs consecutive Values.
+ *
+ * @param idxId Name of the index file.
+ * @param schema The schema the attributes come from.
+ * @param numAttrs Number of key attributes, at most 8.
+ * @param attrs Their positions in the schema.
+ * @param n Maximum number of keys per node.
+ * @return RC_OK on success, RC_IM_N_TO_LAGE if the key is longer than 256
+ *         bytes or n keys do not fit a node, or an error code.
+ */
+RC createBtreeOnAttrs(char *idxId, Schema *schema, int numAttrs, int *attrs, int n) {
+    DataType types[BT_MAX_KEY_ATTRS];
+    int lengths[BT_MAX_KEY_ATTRS];
+    int i;
+
+    if (numAttrs < 1 || numAttrs > BT_MAX_KEY_ATTRS)
+        return RC_INVALID_ARGS;
+    for (i = 0; i < numAttrs; i++) {
+        if (attrs[i] < 0 || attrs[i] >= schema->numAttr)
+            return RC_INVALID_ATTR_NUM;
+        types[i] = schema->dataTypes[attrs[i]];
+        lengths[i] = schema->typeLength[attrs[i]];
     }
+    return createIndex(idxId, numAttrs, types, lengths, n);
 }
 
+// openBtree
+/**
+ * Opens an index and sets up its buffer pool.
+ *
+ * @param tree Receives the new handle; release it with closeBtree.
+ * @param idxId Name of the index file.
+ * @return RC_OK on success, or an error code.
+ */
+RC openBtree(BTreeHandle **tree, char *idxId) {
+    BTreeHandle *handle;
+    BT_TreeMgmt *t;
+    BM_PageHandle page;
+    RC rc;
 
+    *tree = NULL;
+    t = (BT_TreeMgmt *) calloc(1, sizeof(BT_TreeMgmt));
+    handle = (BTreeHandle *) malloc(sizeof(BTreeHandle));
+    if (t == NULL || handle == NULL) {
+        free(t);
+        free(handle);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
 
-// Delete a B-tree
-RC deleteBtree(char *indexID) {
-    // Attempt to destroy the page file specified by indexID
-    RC status = destroyPageFile(indexID);
-    
-    if (status == RC_OK) {
-        // Successfully destroyed the page file
-        return RC_OK;
-    } else {
-        // Failed to destroy the page file, return a more specific error code
-        return RC_FILE_DESTROY_FAILED; // More descriptive than RC_ERROR
+    if ((rc = openPageFile(idxId, &t->fh)) != RC_OK) {
+        free(t);
+        free(handle);
+        return rc;
+    }
+    if ((rc = initBufferPool(&t->pool, idxId, BT_POOL_SIZE, RS_LRU, NULL)) != RC_OK) {
+        closePageFile(&t->fh);
+        free(t);
+        free(handle);
+        return rc;
     }
+
+    if ((rc = pinPageWithHint(&t->pool, &page, 0, BM_HINT_HOT)) != RC_OK) {
+        shutdownBufferPool(&t->pool);
+        closePageFile(&t->fh);
+        free(t);
+        free(handle);
+        return rc;
+    }
+    memcpy(&t->header, page.data, sizeof(BT_Header));
+    unpinPage(&t->pool, &page);
+
+    if ((rc = readFilter(t)) != RC_OK) {
+        free(t->filter);
+        shutdownBufferPool(&t->pool);
+        closePageFile(&t->fh);
+        free(t);
+        free(handle);
+        return rc;
+    }
+
+    handle->keyType = t->header.keyType;
+    handle->idxId = strdup(idxId);
+    handle->mgmtData = t;
+    *tree = handle;
+    return RC_OK;
 }
 
+// closeBtree
+/**
+ * Writes back the bloom filter, the header and all dirty nodes and releases
+ * the handle.
+ *
+ * @param tree The tree to close.
+ * @return RC_OK on success, or an error code.
+ */
+RC closeBtree(BTreeHandle *tree) {
+    BT_TreeMgmt *t = TREE_MGMT(tree);
+    BM_PageHandle page;
+    RC rc;
 
+    if ((rc = writeFilter(t)) != RC_OK)
+        return rc;
+    if ((rc = pinPageWithHint(&t->pool, &page, 0, BM_HINT_HOT)) != RC_OK)
+        return rc;
+    memcpy(page.data, &t->header, sizeof(BT_Header));
+    markDirty(&t->pool, &page);
+    unpinPage(&t->pool, &page);
 
+    if ((rc = shutdownBufferPool(&t->pool)) != RC_OK)
+        return rc;
+    closePageFile(&t->fh);
 
-// Get the number of nodes in a B-tree
-RC getNumNodes(BTreeHandle *tree, int *result)
-{
-    BTree *tempTree = (BTree*)malloc(sizeof(BTree));
-    
-    int numberOfNodes = 0;
-    int iterator=0;
-    
-    while(iterator < maxEle + 2){
-        numberOfNodes++;
-        iterator++;
-    }
-
-    *result = numberOfNodes;
-    
+    free(tree->idxId);
+    free(t->filter);
+    free(t);
+    free(tree);
     return RC_OK;
 }
 
+// Delete a B-tree
+RC deleteBtree(char *idxId) {
+    if (destroyPageFile(idxId) != RC_OK)
+        return RC_FILE_DESTROY_FAILED;
+    return RC_OK;
+}
 
+// Get the number of nodes in a B-tree
+RC getNumNodes(BTreeHandle *tree, int *result) {
+    *result = TREE_MGMT(tree)->header.numNodes;
+    return RC_OK;
+}
 
 // Get the number of entries in a B-tree
 RC getNumEntries(BTreeHandle *tree, int *result) {
-    int totalElements = 0;
-    BTree *currentNode = (BTree*)malloc(sizeof(BTree));
-    
-    currentNode = root;
-    while (currentNode != NULL) {
-        int i = 0;
-        while (i < maxEle) {
-            if (currentNode->key[i] != 0) {
-                totalElements++;
+    *result = TREE_MGMT(tree)->header.numEntries;
+    return RC_OK;
+}
+
+// Get the key type of a B-tree
+RC getKeyType(BTreeHandle *tree, DataType *result) {
+    *result = TREE_MGMT(tree)->header.keyType;
+    return RC_OK;
+}
+
+// Get the bytes of the bloom filter of a B-tree
+RC getFilterSize(BTreeHandle *tree, int *result) {
+    *result = TREE_MGMT(tree)->header.filterBlocks * BLOOM_BLOCK_SIZE;
+    return RC_OK;
+}
+
+
+// findKey
+/**
+ * Looks up the RID stored for a key; for a duplicate key, the smallest one.
+ *
+ * @param tree The tree.
+ * @param key The key to look for.
+ * @param result Receives the RID.
+ * @return RC_OK if found, RC_IM_KEY_NOT_FOUND otherwise, or an error code.
+ */
+RC findKey(BTreeHandle *tree, Value *key, RID *result) {
+    BT_TreeMgmt *t = TREE_MGMT(tree);
+    BM_PageHandle leaf;
+    BT_Node *node;
+    BT_List list;
+    unsigned char k[BT_MAX_KEY];
+    int pos;
+    RC rc;
+
+    if ((rc = toKey(t, key, k)) != RC_OK)
+        return rc;
+    if (!filterMayContain(t, k))
+        return RC_IM_KEY_NOT_FOUND;
+    if ((rc = findLeaf(t, k, NULL, NULL, NULL, &leaf)) != RC_OK)
+        return rc;
+
+    node = NODE(leaf.data);
+    pos = lowerBound(t, node, k);
+    if (keyEquals(t, node, pos, k)) {
+        readList(t, node, pos, &list);
+        rc = firstRid(t, &list, result);
+    } else {
+        rc = RC_IM_KEY_NOT_FOUND;
+    }
+    unpinPage(&t->pool, &leaf);
+    return rc;
+}
+
+// Start loading the parts of a node a binary search reads first
+static void prefetchNode(BT_TreeMgmt *t, const char *data) {
+    const BT_Node *node = (const BT_Node *) data;
+    int bytes = t->header.order * t->header.keySize;
+
+    __builtin_prefetch(data);
+    __builtin_prefetch(node->keys + bytes / 2);
+    if (bytes > 128) {
+        __builtin_prefetch(node->keys + bytes / 4);
+        __builtin_prefetch(node->keys + 3 * bytes / 4);
+    }
+}
+
+// findKeys
+/**
+ * Looks up many keys at once.
+ * The lookups run in groups of BT_GROUP_SIZE that descend the tree level by
+ * level together: first every node of the level is pinned and prefetched,
+ * then every node is searched. The cache misses of the group overlap
+ * instead of being paid one after the other. Keys the bloom filter rules
+ * out do not join a group.
+ *
+ * @param tree The tree.
+ * @param keys Array of n keys, each one value per key attribute.
+ * @param n Number of keys.
+ * @param results Array of n RIDs, as findKey would return them; a key that
+ *        is not in the tree gets page and slot -1.
+ * @return RC_OK when all lookups ran, whether or not they found their key,
+ *         or an error code.
+ */
+RC findKeys(BTreeHandle *tree, Value *keys, int n, RID *results) {
+    BT_TreeMgmt *t = TREE_MGMT(tree);
+    BM_PageHandle pages[BT_GROUP_SIZE];
+    unsigned char key[BT_GROUP_SIZE][BT_MAX_KEY];
+    int node[BT_GROUP_SIZE];
+    int which[BT_GROUP_SIZE];   // lookup of each member of the group
+    int next, size, level, i, j;
+    RC rc;
+
+    for (next = 0; next < n;) {
+        // the group takes the next keys the bloom filter does not rule out
+        for (size = 0; size < BT_GROUP_SIZE && next < n; next++) {
+            if ((rc = toKey(t, &keys[next * t->header.numAttrs], key[size])) != RC_OK)
+                return rc;
+            results[next].page = -1;
+            results[next].slot = -1;
+            if (filterMayContain(t, key[size])) {
+                which[size] = next;
+                node[size++] = t->header.root;
             }
-            i++;
         }
-        currentNode = currentNode->next[maxEle];
+
+        for (level = 0; level < t->header.height; level++) {
+            BM_PageHint hint = levelHint(t, level);
+
+            // Stage 1: pin the nodes of this level and start loading them
+            for (i = 0; i < size; i++) {
+                if ((rc = pinPageWithHint(&t->pool, &pages[i], node[i], hint)) != RC_OK) {
+                    for (j = 0; j < i; j++)
+                        unpinPage(&t->pool, &pages[j]);
+                    return rc;
+                }
+                prefetchNode(t, pages[i].data);
+            }
+
+            // Stage 2: search them, by now mostly from cache; a failed
+            // lookup still lets the rest of the group unpin its nodes
+            rc = RC_OK;
+            for (i = 0; i < size; i++) {
+                BT_Node *current = NODE(pages[i].data);
+
+                if (current->isLeaf) {
+                    int pos = lowerBound(t, current, key[i]);
+                    BT_List list;
+
+                    if (rc == RC_OK && keyEquals(t, current, pos, key[i])) {
+                        readList(t, current, pos, &list);
+                        rc = firstRid(t, &list, &results[which[i]]);
+                    }
+                } else {
+                    node[i] = innerChildren(t, current)[upperBound(t, current, key[i])];
+                }
+                unpinPage(&t->pool, &pages[i]);
+            }
+            if (rc != RC_OK)
+                return rc;
+        }
     }
-    
-    *result = totalElements;
-    //free(currentNode); // Uncomment if needed
     return RC_OK;
 }
 
+// insertIntoList
+/**
+ * Adds a RID to the list of the existing key at pos of a pinned leaf.
+ *
+ * @return RC_OK, RC_IM_KEY_ALREADY_EXISTS if the list has the RID,
+ *         BT_LEAF_FULL if the grown list does not fit, or an error code.
+ */
+static RC insertIntoList(BT_TreeMgmt *t, BT_Node *node, int pos, RID rid) {
+    RID rids[BT_MAX_LIST + 1];
+    unsigned char encoded[PAGE_SIZE];
+    BT_List list;
+    int i, len;
+    RC rc;
+
+    readList(t, node, pos, &list);
 
+    if (list.overflow >= 0) {
+        len = encodeListRef(list.overflow, list.count + 1, encoded);
+        if (!leafFits(t, node, pos, len))
+            return BT_LEAF_FULL;
+        if ((rc = insertIntoPosting(t, list.overflow, rid)) != RC_OK)
+            return rc;
+        putList(t, node, pos, encoded, len);
+        return RC_OK;
+    }
+
+    decodeRids(list.body, list.count, rids);
+    for (i = 0; i < list.count && compareRids(rids[i], rid) < 0; i++)
+        ;
+    if (i < list.count && compareRids(rids[i], rid) == 0)
+        return RC_IM_KEY_ALREADY_EXISTS;
+    memmove(rids + i + 1, rids + i, (list.count - i) * sizeof(RID));
+    rids[i] = rid;
 
-// Get the key type of a B-tree (dummy function)
-RC getKeyType (BTreeHandle *tree, DataType *result)
-{
+    len = encodeInlineList(rids, list.count + 1, encoded);
+    if (len > maxInlineList(t)) {
+        int first;
+        if ((rc = buildPostingList(t, rids, list.count + 1, &first)) != RC_OK)
+            return rc;
+        len = encodeListRef(first, list.count + 1, encoded);
+    } else if (!leafFits(t, node, pos, len)) {
+        return BT_LEAF_FULL;
+    }
+    putList(t, node, pos, encoded, len);
     return RC_OK;
 }
 
+// splitLeaf
+/**
+ * Splits a pinned leaf that has no room for key and unpins it.
+ * A full leaf is split by key count, one short of bytes by list size;
+ * appends to the rightmost leaf keep about 90% of the keys on the left,
+ * possibly all of them.
+ *
+ * @param t The tree.
+ * @param path The pages from the root to the leaf.
+ * @param leaf The leaf, pinned.
+ * @param key The key being inserted.
+ * @param append Whether key is beyond the last key of the rightmost leaf.
+ * @return RC_OK on success, or an error code.
+ */
+static RC splitLeaf(BT_TreeMgmt *t, int *path, BM_PageHandle *leaf, const unsigned char *key, bool append) {
+    BT_Node *node = NODE(leaf->data);
+    unsigned short *offsets = leafOffsets(t, node);
+    unsigned short *lengths = leafLengths(t, node);
+    unsigned char separator[BT_MAX_KEY];
+    int size = t->header.keySize;
+    BM_PageHandle sibling;
+    BT_Node *right;
+    int n = node->numKeys;
+    int split, i;
+    RC rc;
 
-// Find a key in the B-tree
-RC findKey(BTreeHandle *tree, Value *key, RID *result) {
-    BTree *currentNode = (BTree*)malloc(sizeof(BTree));
-    int found = 0;
-    
-    currentNode = root;
-    while (currentNode != NULL) {
-        int i = 0;
-        while (i < maxEle) {
-            if (currentNode->key[i] == key->v.intV) {
-                result->page = currentNode->id[i].page;
-                result->slot = currentNode->id[i].slot;
-                found = 1;
-                break;
+    if (append) {
+        split = n - n / 10;
+    } else if (n < 2) {
+        split = n == 1 && memcmp(key, node->keys, size) > 0 ? 1 : 0;
+    } else if (n < t->header.order) {
+        int live = 0, half = 0;
+        for (i = 0; i < n; i++)
+            live += lengths[i];
+        for (split = 0; split < n - 1 && half < live / 2; split++)
+            half += lengths[split];
+        if (split == 0)
+            split = 1;
+    } else {
+        split = splitPoint(n, false);
+    }
+
+    if ((rc = allocNode(t, true, &sibling)) != RC_OK) {
+        unpinPage(&t->pool, leaf);
+        return rc;
+    }
+    right = NODE(sibling.data);
+    for (i = split; i < n; i++) {
+        memcpy(keyAt(t, right, i - split), keyAt(t, node, i), size);
+        right->numKeys++;
+        putList(t, right, i - split, (unsigned char *) node + offsets[i], lengths[i]);
+    }
+    right->next = node->next;
+    node->next = sibling.pageNum;
+    node->numKeys = split;
+    compactLeaf(t, node);
+
+    // an empty right leaf takes keys from the new one on
+    memcpy(separator, right->numKeys > 0 ? right->keys : key, size);
+    t->rightValid = false;
+
+    markDirty(&t->pool, leaf);
+    unpinPage(&t->pool, &sibling);
+    if ((rc = unpinPage(&t->pool, leaf)) != RC_OK)
+        return rc;
+    return insertIntoParent(t, path, t->header.height - 2, separator, sibling.pageNum, append);
+}
+
+// insertKey
+/**
+ * Inserts a key and RID. A key that is already in the tree gets the RID
+ * added to its list. Full leaves are split and the insert is retried.
+ *
+ * @param tree The tree.
+ * @param key The key.
+ * @param rid The RID to store with it.
+ * @return RC_OK on success, RC_IM_KEY_ALREADY_EXISTS if the tree has this
+ *         key with this RID, or an error code.
+ */
+RC insertKey(BTreeHandle *tree, Value *key, RID rid) {
+    BT_TreeMgmt *t = TREE_MGMT(tree);
+    unsigned char encoded[24];
+    int path[BT_MAX_HEIGHT];
+    BM_PageHandle leaf;
+    BT_Node *node;
+    unsigned char k[BT_MAX_KEY];
+    unsigned char low[BT_MAX_KEY];
+    bool lowSet, newKey = false;
+    int pos, len;
+    RC rc;
+
+    if ((rc = toKey(t, key, k)) != RC_OK)
+        return rc;
+
+    for (;;) {
+        if (t->header.height >= BT_MAX_HEIGHT)
+            return RC_IM_N_TO_LAGE;
+
+        // Keys at the right end of the tree go straight to the rightmost leaf
+        if (t->rightValid && (!t->rightBounded || memcmp(k, t->rightLow, t->header.keySize) >= 0)) {
+            memcpy(path, t->rightPath, t->header.height * sizeof(int));
+            if ((rc = pinPage(&t->pool, &leaf, path[t->header.height - 1])) != RC_OK)
+                return rc;
+        } else {
+            if ((rc = findLeaf(t, k, path, low, &lowSet, &leaf)) != RC_OK)
+                return rc;
+            if (NODE(leaf.data)->next < 0) {
+                memcpy(t->rightPath, path, t->header.height * sizeof(int));
+                memcpy(t->rightLow, low, t->header.keySize);
+                t->rightBounded = lowSet;
+                t->rightValid = true;
+            }
+        }
+
+        node = NODE(leaf.data);
+        pos = lowerBound(t, node, k);
+        if (keyEquals(t, node, pos, k)) {
+            rc = insertIntoList(t, node, pos, rid);
+        } else {
+            len = encodeInlineList(&rid, 1, encoded);
+            if (node->numKeys < t->header.order && leafFits(t, node, -1, len)) {
+                insertLeafSlot(t, node, pos, k);
+                putList(t, node, pos, encoded, len);
+                newKey = true;
+                rc = RC_OK;
+            } else {
+                rc = BT_LEAF_FULL;
             }
-            i++;
         }
-        if (found == 1)
+
+        if (rc != BT_LEAF_FULL)
             break;
-        currentNode = currentNode->next[maxEle];
+        if ((rc = splitLeaf(t, path, &leaf, k, node->next < 0 && pos == node->numKeys)) != RC_OK)
+            return rc;
     }
-    //free(currentNode); // Uncomment if needed
-    
-    if (found == 1)
-        return RC_OK;
-    else
+
+    if (rc == RC_OK) {
+        t->header.numEntries++;
+        markDirty(&t->pool, &leaf);
+    }
+    unpinPage(&t->pool, &leaf);
+    if (newKey)
+        rc = filterAdd(t, k);
+    return rc;
+}
+
+// deleteKey
+/**
+ * Removes a key with all its RIDs. Underfull nodes are left as they are.
+ *
+ * @param tree The tree.
+ * @param key The key to remove.
+ * @return RC_OK on success, RC_IM_KEY_NOT_FOUND if the key is not in the
+ *         tree, or an error code.
+ */
+RC deleteKey(BTreeHandle *tree, Value *key) {
+    BT_TreeMgmt *t = TREE_MGMT(tree);
+    BM_PageHandle leaf;
+    BT_Node *node;
+    BT_List list;
+    unsigned char k[BT_MAX_KEY];
+    int pos;
+    RC rc;
+
+    if ((rc = toKey(t, key, k)) != RC_OK)
+        return rc;
+    if (!filterMayContain(t, k))
+        return RC_IM_KEY_NOT_FOUND;
+    if ((rc = findLeaf(t, k, NULL, NULL, NULL, &leaf)) != RC_OK)
+        return rc;
+
+    node = NODE(leaf.data);
+    pos = lowerBound(t, node, k);
+    if (!keyEquals(t, node, pos, k)) {
+        unpinPage(&t->pool, &leaf);
         return RC_IM_KEY_NOT_FOUND;
+    }
+
+    readList(t, node, pos, &list);
+    t->header.numEntries -= list.count;
+    removeLeafSlot(t, node, pos);
+    markDirty(&t->pool, &leaf);
+    return unpinPage(&t->pool, &leaf);
 }
 
+// deleteEntry
+/**
+ * Removes one RID from the list of a key; the key goes with its last RID.
+ *
+ * @param tree The tree.
+ * @param key The key.
+ * @param rid The RID to remove.
+ * @return RC_OK on success, RC_IM_KEY_NOT_FOUND if the tree does not have
+ *         this key with this RID, or an error code.
+ */
+RC deleteEntry(BTreeHandle *tree, Value *key, RID rid) {
+    BT_TreeMgmt *t = TREE_MGMT(tree);
+    RID rids[BT_MAX_LIST];
+    unsigned char encoded[PAGE_SIZE];
+    BM_PageHandle leaf;
+    BT_Node *node;
+    BT_List list;
+    unsigned char k[BT_MAX_KEY];
+    int pos, i, len;
+    RC rc;
 
-// Insert a key into the B-tree
-RC insertKey(BTreeHandle *tree, Value *key, RID rid) {
-    int i = 0;
-    BTree *currentNode = (BTree*)malloc(sizeof(BTree));
-    BTree *newNode = (BTree*)malloc(sizeof(BTree));
-    newNode->key = malloc(sizeof(int) * maxEle);
-    newNode->id = malloc(sizeof(int) * maxEle);
-    newNode->next = malloc(sizeof(BTree) * (maxEle + 1));
-    
-    for (i = 0; i < maxEle; i++) {
-        newNode->key[i] = 0;
-    }
-
-    int nodeFull = 0;
-    
-    currentNode = root;
-    while (currentNode != NULL) {
-        nodeFull = 0;
-        for (i = 0; i < maxEle; i++) {
-            if (currentNode->key[i] == 0) {
-                currentNode->id[i].page = rid.page;
-                currentNode->id[i].slot = rid.slot;
-                currentNode->key[i] = key->v.intV;
-                currentNode->next[i] = NULL;
-                nodeFull++;
-                break;
-            }
-        }
-        if ((nodeFull == 0) && (currentNode->next[maxEle] == NULL)) {
-            newNode->next[maxEle] = NULL;
-            currentNode->next[maxEle] = newNode;
+    if ((rc = toKey(t, key, k)) != RC_OK)
+        return rc;
+    if (!filterMayContain(t, k))
+        return RC_IM_KEY_NOT_FOUND;
+    if ((rc = findLeaf(t, k, NULL, NULL, NULL, &leaf)) != RC_OK)
+        return rc;
+
+    node = NODE(leaf.data);
+    pos = lowerBound(t, node, k);
+    if (!keyEquals(t, node, pos, k)) {
+        unpinPage(&t->pool, &leaf);
+        return RC_IM_KEY_NOT_FOUND;
+    }
+
+    readList(t, node, pos, &list);
+    if (list.overflow >= 0) {
+        if ((rc = deleteFromPosting(t, list.overflow, rid)) != RC_OK) {
+            unpinPage(&t->pool, &leaf);
+            return rc;
         }
-        currentNode = currentNode->next[maxEle];
-    }
-    
-    int totalElements = 0;
-    currentNode = root;
-    while (currentNode != NULL) {
-        for (i = 0; i < maxEle; i++) {
-            if (currentNode->key[i] != 0) {
-                totalElements++;
-            }
+        len = encodeListRef(list.overflow, list.count - 1, encoded);
+    } else {
+        decodeRids(list.body, list.count, rids);
+        for (i = 0; i < list.count && compareRids(rids[i], rid) != 0; i++)
+            ;
+        if (i == list.count) {
+            unpinPage(&t->pool, &leaf);
+            return RC_IM_KEY_NOT_FOUND;
         }
-        currentNode = currentNode->next[maxEle];
+        memmove(rids + i, rids + i + 1, (list.count - i - 1) * sizeof(RID));
+        len = encodeInlineList(rids, list.count - 1, encoded);
     }
 
-    if (totalElements == 6) {
-        newNode->key[0] = root->next[maxEle]->key[0];
-        newNode->key[1] = root->next[maxEle]->next[maxEle]->key[0];
-        newNode->next[0] = root;
-        newNode->next[1] = root->next[maxEle];
-        newNode->next[2] = root->next[maxEle]->next[maxEle];
+    // a list only shrinks here, so it always fits
+    if (list.count == 1)
+        removeLeafSlot(t, node, pos);
+    else
+        putList(t, node, pos, encoded, len);
+    t->header.numEntries--;
+    markDirty(&t->pool, &leaf);
+    return unpinPage(&t->pool, &leaf);
+}
+
+// Make the list of the key at pos the scan's current list
+static void loadList(BT_TreeMgmt *t, BT_ScanMgmt *sm, BT_Node *node, int pos) {
+    BT_List list;
+
+    readList(t, node, pos, &list);
+    sm->ridPos = 0;
+    if (list.overflow >= 0) {
+        sm->numRids = 0;
+        sm->nextPosting = list.overflow;
+    } else {
+        decodeRids(list.body, list.count, sm->rids);
+        sm->numRids = list.count;
+        sm->nextPosting = -1;
     }
-    
+}
+
+// Decode the next posting page of the scan's current list
+static RC loadPosting(BT_TreeMgmt *t, BT_ScanMgmt *sm) {
+    BM_PageHandle page;
+    RC rc;
+
+    if ((rc = pinPage(&t->pool, &page, sm->nextPosting)) != RC_OK)
+        return rc;
+    decodeRids(POSTING(page.data)->data, POSTING(page.data)->count, sm->rids);
+    sm->numRids = POSTING(page.data)->count;
+    sm->ridPos = 0;
+    sm->nextPosting = POSTING(page.data)->next;
+    return unpinPage(&t->pool, &page);
+}
+
+static RC newScan(BTreeHandle *tree, BT_ScanHandle **handle, BT_ScanMgmt **state) {
+    BT_ScanHandle *scan = (BT_ScanHandle *) malloc(sizeof(BT_ScanHandle));
+    BT_ScanMgmt *sm = (BT_ScanMgmt *) calloc(1, sizeof(BT_ScanMgmt));
+
+    if (scan == NULL || sm == NULL || (sm->rids = (RID *) malloc(BT_MAX_LIST * sizeof(RID))) == NULL) {
+        free(scan);
+        free(sm);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    sm->nextPosting = -1;
+    scan->tree = tree;
+    scan->mgmtData = sm;
+    *handle = scan;
+    *state = sm;
     return RC_OK;
 }
 
+// openTreeScan
+/**
+ * Starts a scan over all entries in key order; the RIDs of a duplicate key
+ * come in RID order.
+ *
+ * @param tree The tree.
+ * @param handle Receives the new scan; release it with closeTreeScan.
+ * @return RC_OK on success, or an error code.
+ */
+RC openTreeScan(BTreeHandle *tree, BT_ScanHandle **handle) {
+    BT_TreeMgmt *t = TREE_MGMT(tree);
+    BT_ScanMgmt *sm;
+    int pageNum = t->header.root;
+    int level;
+    RC rc;
 
-// Delete a key from the B-tree
-RC deleteKey(BTreeHandle *tree, Value *searchKey) {
-    BTree *currentNode = (BTree*)malloc(sizeof(BTree));
-    int isFound = 0;
-    
-    currentNode = root;
-    while (currentNode != NULL) {
-        int iterator = 0;
-        while (iterator < maxEle) {
-            if (currentNode->key[iterator] == searchKey->v.intV) {
-                currentNode->key[iterator] = 0;
-                currentNode->id[iterator].page = 0;
-                currentNode->id[iterator].slot = 0;
-                isFound = 1;
-                break;
-            }
-            iterator++;
+    if ((rc = newScan(tree, handle, &sm)) != RC_OK)
+        return rc;
+
+    // Descend along the leftmost children to the first leaf
+    for (level = 0; ; level++) {
+        if ((rc = pinPageWithHint(&t->pool, &sm->page, pageNum, levelHint(t, level))) != RC_OK) {
+            closeTreeScan(*handle);
+            return rc;
         }
-        if (isFound == 1)
+        if (NODE(sm->page.data)->isLeaf)
             break;
-        currentNode = currentNode->next[maxEle];
+        pageNum = innerChildren(t, NODE(sm->page.data))[0];
+        unpinPage(&t->pool, &sm->page);
     }
-    
+
+    sm->pinned = true;
+    sm->pos = 0;
     return RC_OK;
 }
 
+// openKeyScan
+/**
+ * Starts a scan over the RIDs of one key, in RID order. A key that is not
+ * in the tree gives an empty scan.
+ *
+ * @param tree The tree.
+ * @param key The key.
+ * @param handle Receives the new scan; release it with closeTreeScan.
+ * @return RC_OK on success, or an error code.
+ */
+RC openKeyScan(BTreeHandle *tree, Value *key, BT_ScanHandle **handle) {
+    BT_TreeMgmt *t = TREE_MGMT(tree);
+    BM_PageHandle leaf;
+    BT_ScanMgmt *sm;
+    BT_Node *node;
+    unsigned char k[BT_MAX_KEY];
+    int pos;
+    RC rc;
 
-// Open a tree scan
-RC openTreeScan(BTreeHandle *tree, BT_ScanHandle **handle) {
-    scan = root;
-    indexNum = 0;
-    
-    BTree *temp = (BTree*)malloc(sizeof(BTree));
-    int totalEle = 0, i;
-    for (temp = root; temp != NULL; temp = temp->next[maxEle])
-        for (i = 0; i < maxEle; i ++)
-            if (temp->key[i] != 0)
-                totalEle ++;
-
-    int *key = malloc(sizeof(int) * totalEle);
-    int **elements = malloc(sizeof(int*) * 2);
-    elements[0] = malloc(sizeof(int) * totalEle);
-    elements[1] = malloc(sizeof(int) * totalEle);
-    
-    int count = 0;
-    for (temp = root; temp != NULL; temp = temp->next[maxEle]) {
-        for (i = 0; i < maxEle; i ++) {
-            key[count] = temp->key[i];
-            elements[0][count] = temp->id[i].page;
-            elements[1][count] = temp->id[i].slot;
-            count ++;
-        }
+    if ((rc = toKey(t, key, k)) != RC_OK)
+        return rc;
+    if ((rc = newScan(tree, handle, &sm)) != RC_OK)
+        return rc;
+    if (!filterMayContain(t, k))
+        return RC_OK;
+    if ((rc = findLeaf(t, k, NULL, NULL, NULL, &leaf)) != RC_OK) {
+        closeTreeScan(*handle);
+        return rc;
     }
-    
-    int swap, pg, st, c, d;
-    for (c = 0 ; c < count - 1; c ++) {
-        for (d = 0 ; d < count - c - 1; d ++) {
-            if (key[d] > key[d+1]) {
-                swap = key[d];
-                pg = elements[0][d];
-                st = elements[1][d];
-                
-                key[d] = key[d + 1];
-                elements[0][d] = elements[0][d + 1];
-                elements[1][d] = elements[1][d + 1];
-                
-                key[d + 1] = swap;
-                elements[0][d + 1] = pg;
-                elements[1][d + 1] = st;
-            }
+
+    node = NODE(leaf.data);
+    pos = lowerBound(t, node, k);
+    if (keyEquals(t, node, pos, k))
+        loadList(t, sm, node, pos);
+    return unpinPage(&t->pool, &leaf);
+}
+
+// nextEntry
+/**
+ * Returns the RID of the next entry of a scan.
+ *
+ * @param handle The scan.
+ * @param result Receives the RID.
+ * @return RC_OK, RC_IM_NO_MORE_ENTRIES at the end, or an error code.
+ */
+RC nextEntry(BT_ScanHandle *handle, RID *result) {
+    BT_TreeMgmt *t = TREE_MGMT(handle->tree);
+    BT_ScanMgmt *sm = (BT_ScanMgmt *) handle->mgmtData;
+    RC rc;
+
+    for (;;) {
+        BT_Node *node;
+        int next;
+
+        if (sm->ridPos < sm->numRids) {
+            *result = sm->rids[sm->ridPos++];
+            return RC_OK;
         }
-    }
-    
-    count = 0;
-    for (temp = root; temp != NULL; temp = temp->next[maxEle]) {
-        for (i = 0; i < maxEle; i ++) {
-            temp->key[i] = key[count];
-            temp->id[i].page = elements[0][count];
-            temp->id[i].slot = elements[1][count];
-            count ++;
+        if (sm->nextPosting >= 0) {
+            if ((rc = loadPosting(t, sm)) != RC_OK)
+                return rc;
+            continue;
         }
+        if (!sm->pinned)
+            return RC_IM_NO_MORE_ENTRIES;
+
+        node = NODE(sm->page.data);
+        if (sm->pos < node->numKeys) {
+            loadList(t, sm, node, sm->pos++);
+            continue;
+        }
+
+        next = node->next;
+        unpinPage(&t->pool, &sm->page);
+        sm->pinned = false;
+        if (next < 0)
+            return RC_IM_NO_MORE_ENTRIES;
+        if ((rc = pinPage(&t->pool, &sm->page, next)) != RC_OK)
+            return rc;
+        sm->pinned = true;
+        sm->pos = 0;
     }
-    
-    free(key);
-    free(elements[0]);
-    free(elements[1]);
-    free(elements);
+}
 
+// Close a tree scan
+RC closeTreeScan(BT_ScanHandle *handle) {
+    BT_ScanMgmt *sm = (BT_ScanMgmt *) handle->mgmtData;
+
+    if (sm->pinned)
+        unpinPage(&TREE_MGMT(handle->tree)->pool, &sm->page);
+    free(sm->rids);
+    free(sm);
+    free(handle);
     return RC_OK;
 }
 
+// Append formatted text to a growing string
+static void appendText(char **buf, int *len, int *cap, const char *format, ...) {
+    va_list args;
+    int needed;
 
-// Get the next entry in the tree scan
-RC nextEntry(BT_ScanHandle *handle, RID *result) {
-    if (scan->next[maxEle] != NULL) {
-        if (maxEle == indexNum) {
-            indexNum = 0;
-            scan = scan->next[maxEle];
-        }
+    va_start(args, format);
+    needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (*len + needed + 1 > *cap) {
+        *cap = (*len + needed + 1) * 2;
+        *buf = (char *) realloc(*buf, *cap);
+    }
+    va_start(args, format);
+    *len += vsprintf(*buf + *len, format, args);
+    va_end(args);
+}
 
-        result->page = scan->id[indexNum].page;
-        result->slot = scan->id[indexNum].slot;
-        indexNum++;
-    } else {
-        return RC_IM_NO_MORE_ENTRIES;
+// Append a stored key, its attributes separated by '|'
+static void appendKey(BT_TreeMgmt *t, const unsigned char *key, char **buf, int *len, int *cap) {
+    Value *value;
+    char *text;
+    int i;
+
+    for (i = 0; i < t->header.numAttrs; i++) {
+        int length = t->header.attrLengths[i];
+
+        if (denormalizeValue((const char *) key, t->header.attrTypes[i], length, &value) != RC_OK)
+            return;
+        text = serializeValue(value);
+        appendText(buf, len, cap, i > 0 ? "|%s" : "%s", text);
+        free(text);
+        freeVal(value);
+        key += normKeyAttrSize(t->header.attrTypes[i], length);
     }
-    
-    return RC_OK;
 }
 
+// Print one node and, depth first, the nodes below it
+static RC printNode(BT_TreeMgmt *t, int pageNum, int level, char **buf, int *len, int *cap) {
+    BM_PageHandle page;
+    BT_Node *node;
+    int i, j;
+    RC rc;
 
-// Close a tree scan
-RC closeTreeScan(BT_ScanHandle *handle) {
-    indexNum = 0; // Reset the index number to indicate that the scan is closed
-    return RC_OK; // Return success code
+    if ((rc = pinPageWithHint(&t->pool, &page, pageNum, levelHint(t, level))) != RC_OK)
+        return rc;
+    node = NODE(page.data);
+
+    appendText(buf, len, cap, "(%d)[", pageNum);
+    if (node->isLeaf) {
+        RID rids[BT_MAX_LIST];
+        BT_List list;
+
+        for (i = 0; i < node->numKeys; i++) {
+            readList(t, node, i, &list);
+            if (list.overflow >= 0) {
+                appendText(buf, len, cap, "%d rids@%d,", list.count, list.overflow);
+            } else {
+                decodeRids(list.body, list.count, rids);
+                for (j = 0; j < list.count; j++)
+                    appendText(buf, len, cap, j + 1 < list.count ? "%d.%d/" : "%d.%d,", rids[j].page, rids[j].slot);
+            }
+            appendKey(t, keyAt(t, node, i), buf, len, cap);
+            appendText(buf, len, cap, ",");
+        }
+        appendText(buf, len, cap, "%d]\n", node->next);
+    } else {
+        int *children = innerChildren(t, node);
+        for (i = 0; i < node->numKeys; i++) {
+            appendText(buf, len, cap, "%d,", children[i]);
+            appendKey(t, keyAt(t, node, i), buf, len, cap);
+            appendText(buf, len, cap, ",");
+        }
+        appendText(buf, len, cap, "%d]\n", children[node->numKeys]);
+    }
+
+    if (!node->isLeaf) {
+        int numChildren = node->numKeys + 1;
+        int *children = (int *) malloc(numChildren * sizeof(int));
+        memcpy(children, innerChildren(t, node), numChildren * sizeof(int));
+        unpinPage(&t->pool, &page);
+        for (i = 0; i < numChildren && rc == RC_OK; i++)
+            rc = printNode(t, children[i], level + 1, buf, len, cap);
+        free(children);
+        return rc;
+    }
+    return unpinPage(&t->pool, &page);
 }
 
-// Debug and test function to print the tree (dummy function)
+// printTree
+/**
+ * Prints the tree depth first, one node per line: "(page)[child,key,...,child]"
+ * for inner nodes and "(page)[rids,key,...,next leaf]" for leaves, where
+ * rids is "page.slot/page.slot..." or, for a list on posting pages,
+ * "count rids@first page". Float and bool keys appear in their stored
+ * integer form.
+ *
+ * @param tree The tree.
+ * @return A string the caller must free, or NULL on error.
+ */
 char *printTree(BTreeHandle *tree) {
+    BT_TreeMgmt *t = TREE_MGMT(tree);
+    int len = 0, cap = 256;
+    char *buf = (char *) malloc(cap);
 
-    return RC_OK;;
+    buf[0] = '\0';
+    if (printNode(t, t->header.root, 0, &buf, &len, &cap) != RC_OK) {
+        free(buf);
+        return NULL;
+    }
+    return buf;
 }
-
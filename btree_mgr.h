@@ -22,6 +22,9 @@ extern RC shutdownIndexManager ();
 
 // create, destroy, open, and close an btree index
 extern RC createBtree (char *idxId, DataType keyType, int n);
+// composite keys: the key is attrs[0..numAttrs-1] of schema, and every Value
+// *key argument points to numAttrs values, one per key attribute
+extern RC createBtreeOnAttrs (char *idxId, Schema *schema, int numAttrs, int *attrs, int n);
 extern RC openBtree (BTreeHandle **tree, char *idxId);
 extern RC closeBtree (BTreeHandle *tree);
 extern RC deleteBtree (char *idxId);
@@ -30,15 +33,23 @@ extern RC deleteBtree (char *idxId);
 extern RC getNumNodes (BTreeHandle *tree, int *result);
 extern RC getNumEntries (BTreeHandle *tree, int *result);
 extern RC getKeyType (BTreeHandle *tree, DataType *result);
+// bytes of the bloom filter that answers lookups of absent keys
+extern RC getFilterSize (BTreeHandle *tree, int *result);
 
 // index access
 extern RC findKey (BTreeHandle *tree, Value *key, RID *result);
+extern RC findKeys (BTreeHandle *tree, Value *keys, int n, RID *results);
 extern RC insertKey (BTreeHandle *tree, Value *key, RID rid);
 extern RC deleteKey (BTreeHandle *tree, Value *key);
 extern RC openTreeScan (BTreeHandle *tree, BT_ScanHandle **handle);
 extern RC nextEntry (BT_ScanHandle *handle, RID *result);
 extern RC closeTreeScan (BT_ScanHandle *handle);
 
+// duplicate keys: a key maps to a list of RIDs; insertKey adds to the list,
+// deleteKey drops the key with the whole list, findKey returns its first RID
+extern RC deleteEntry (BTreeHandle *tree, Value *key, RID rid);
+extern RC openKeyScan (BTreeHandle *tree, Value *key, BT_ScanHandle **handle);
+
 // debug and test functions
 extern char *printTree (BTreeHandle *tree);
 
@@ -4,8 +4,153 @@
 #include "dberror.h"
 #include "storage_mgr.h"
 #include <string.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include"dt.h"
 
+// Frame descriptor layout
+//
+// Every frame is described by two records kept in separate arrays:
+//  - BM_FrameHot holds the fields written on every pin/unpin (latch, fix
+//    count, reference bit, dirty flag, priority hint). Each descriptor is
+//    aligned to its own cacheline so that threads pinning neighbouring frames
+//    do not keep invalidating each other's lines.
+//  - BM_FrameInfo holds the read-mostly fields (page number, data pointer).
+//    They only change when a frame is replaced, so the page lookup loop reads
+//    a compact array that stays shared in every core's cache.
+//
+// Compiling with -DBM_PACK_FRAMES drops the padding; bench_buffer_mgr uses it
+// to measure what the layout buys.
+
+#define BM_CACHELINE_SIZE 64
+
+#ifdef BM_PACK_FRAMES
+#define BM_FRAME_ALIGN
+#else
+#define BM_FRAME_ALIGN _Alignas(BM_CACHELINE_SIZE)
+#endif
+
+typedef struct BM_FrameHot {
+    BM_FRAME_ALIGN atomic_flag latch; // orders pins against eviction of this frame
+    atomic_int fixCounts;             // count how many clients are using this page
+    atomic_bool refBit;               // set on every access, for clock-style sweeps
+    atomic_bool dirty;                // mark whether this is a dirty page
+    atomic_int hint;                  // strongest BM_PageHint since the page was loaded
+} BM_FrameHot;
+
+typedef struct BM_FrameInfo {
+    atomic_int pageNum; // NO_PAGE while the frame is empty or being replaced
+    char *data;
+} BM_FrameInfo;
+
+typedef struct BM_PoolMgmt {
+    BM_FrameHot *hot;
+    BM_FrameInfo *frames;
+    pthread_mutex_t latch; // serializes misses, eviction and write-back
+    bool protectHot;       // victim search skips hot frames, under latch
+    const BM_ReplacementPolicy *policy;
+    void *policyState;
+} BM_PoolMgmt;
+
+#define POOL_MGMT(bm) ((BM_PoolMgmt *) (bm)->mgmtData)
+
+// Spin on the frame latch. It is only ever held for a handful of
+// instructions, so a sleeping lock would cost more than it saves.
+static void lockFrame(BM_FrameHot *frame) {
+    while (atomic_flag_test_and_set_explicit(&frame->latch, memory_order_acquire))
+        ;
+}
+
+static void unlockFrame(BM_FrameHot *frame) {
+    atomic_flag_clear_explicit(&frame->latch, memory_order_release);
+}
+
+// Return the frame currently holding pageNum, or -1.
+static int findFrame(BM_BufferPool *const bm, PageNumber pageNum) {
+    BM_FrameInfo *frames = POOL_MGMT(bm)->frames;
+    for (int i = 0; i < bm->numPages; i++) {
+        if (atomic_load_explicit(&frames[i].pageNum, memory_order_acquire) == pageNum)
+            return i;
+    }
+    return -1;
+}
+
+// Record an access to a frame for the replacement policy.
+static void touchFrame(BM_BufferPool *const bm, int frameIndex, bool loaded, BM_PageHint hint) {
+    BM_PoolMgmt *mgmt = POOL_MGMT(bm);
+    BM_FrameHot *frame = &mgmt->hot[frameIndex];
+
+    // A scan access neither counts as a reference nor downgrades the page;
+    // a normal access lifts a scan page, a hot access makes it sticky.
+    if (loaded) {
+        atomic_store_explicit(&frame->hint, hint, memory_order_relaxed);
+    } else if (hint != BM_HINT_SCAN) {
+        int current = atomic_load_explicit(&frame->hint, memory_order_relaxed);
+        if (current == BM_HINT_SCAN || (hint == BM_HINT_HOT && current != BM_HINT_HOT))
+            atomic_store_explicit(&frame->hint, hint, memory_order_relaxed);
+    }
+
+    // Only write the line when the bit actually changes
+    if (hint == BM_HINT_SCAN) {
+        if (loaded)
+            atomic_store_explicit(&frame->refBit, false, memory_order_relaxed);
+    } else if (!atomic_load_explicit(&frame->refBit, memory_order_relaxed)) {
+        atomic_store_explicit(&frame->refBit, true, memory_order_relaxed);
+    }
+
+    if (loaded) {
+        if (mgmt->policy->onMiss)
+            mgmt->policy->onMiss(mgmt->policyState, frameIndex, hint);
+    } else if (mgmt->policy->onHit) {
+        mgmt->policy->onHit(mgmt->policyState, frameIndex, hint);
+    }
+}
+
+// Ask the policy for a victim, sparing hot frames unless nothing else is
+// left. The caller holds the pool latch.
+static int pickVictim(BM_BufferPool *const bm) {
+    BM_PoolMgmt *mgmt = POOL_MGMT(bm);
+    int victim;
+
+    mgmt->protectHot = true;
+    victim = mgmt->policy->pickVictim(mgmt->policyState, bm);
+    mgmt->protectHot = false;
+    if (victim < 0) {
+        victim = mgmt->policy->pickVictim(mgmt->policyState, bm);
+    }
+    return victim;
+}
+
+// Write a frame back to the page file. The caller holds the pool latch.
+static RC writeFrame(BM_BufferPool *const bm, PageNumber pageNum, char *data) {
+    FILE *file = fopen(bm->pageFile, "rb+");
+    if (file == NULL) {
+        return RC_FILE_NOT_FOUND;
+    }
+
+    if (fseek(file, (long) pageNum * PAGE_SIZE, SEEK_SET) != 0) {
+        fclose(file);
+        return RC_SEEK_FAILED;
+    }
+    size_t written = fwrite(data, PAGE_SIZE, 1, file);
+    // fclose flushes the page, so its failure is a failed write too
+    if (fclose(file) != 0 || written != 1) {
+        return RC_WRITE_FAILED;
+    }
+    bm->numWriteIO++;
+    return RC_OK;
+}
+
+// Fill the client handle from a pinned frame.
+static void fillHandle(BM_BufferPool *const bm, int frameIndex, BM_PageHandle *const page) {
+    BM_PoolMgmt *mgmt = POOL_MGMT(bm);
+    page->pageNum = atomic_load_explicit(&mgmt->frames[frameIndex].pageNum, memory_order_relaxed);
+    page->data = mgmt->frames[frameIndex].data;
+    page->fixCounts = atomic_load_explicit(&mgmt->hot[frameIndex].fixCounts, memory_order_relaxed);
+    page->dirty = atomic_load_explicit(&mgmt->hot[frameIndex].dirty, memory_order_relaxed);
+}
+
 // Buffer Manager Interface Pool Handling
 
 // initBufferPool
@@ -14,8 +159,8 @@
  * @param bm Pointer to the buffer pool structure to be initialized.
  * @param pageFileName Name of the existing page file from which pages will be cached.
  * @param numPages Number of page frames in the buffer pool.
- * @param strategy Strategy for page replacement (e.g., FIFO, LRU).
- * @param stratData Additional parameters for the page replacement strategy, if applicable.
+ * @param strategy Strategy for page replacement (e.g., FIFO, LRU, CLOCK, LFU, or RS_CUSTOM).
+ * @param stratData Additional parameters for the page replacement strategy, if applicable. For RS_CUSTOM a BM_CustomStrategy naming the policy to use.
  * @return Return code indicating success or failure of the initialization process.
  */
 
@@ -32,31 +177,73 @@ RC initBufferPool(BM_BufferPool *const bufferPool, const char *const fileName,
     // Close the file as we just needed to check its existence
     fclose(filePointer);
 
+    // Resolve the replacement policy
+    const BM_ReplacementPolicy *policy;
+    void *policyData = stratData;
+    if (replStrategy == RS_CUSTOM) {
+        BM_CustomStrategy *custom = (BM_CustomStrategy *) stratData;
+        if (custom == NULL || custom->policy == NULL || custom->policy->pickVictim == NULL) {
+            return RC_STRATEGY_NOT_FOUND;
+        }
+        policy = custom->policy;
+        policyData = custom->policyData;
+    } else {
+        policy = getReplacementPolicy(replStrategy);
+        if (policy == NULL) {
+            return RC_STRATEGY_NOT_FOUND;
+        }
+    }
+
     // Assign the buffer pool attributes
     bufferPool->pageFile = (char *)fileName;
     bufferPool->numPages = totalPages;
     bufferPool->strategy = replStrategy;
 
-    // Allocate memory for the pages in the buffer pool
-    BM_PageHandle *pages = calloc(totalPages, sizeof(BM_PageHandle));
-    if (!pages) {
-        return RC_MEM_ALLOCATION_FAIL; // Ensure you have a return code for memory allocation failure
+    // Allocate the frame descriptor tables; hot descriptors must start on a cacheline
+    BM_PoolMgmt *mgmt = calloc(1, sizeof(BM_PoolMgmt));
+    if (!mgmt) {
+        return RC_MEM_ALLOCATION_FAIL;
     }
-    bufferPool->mgmtData = pages;
+    void *hot = NULL;
+    if (posix_memalign(&hot, BM_CACHELINE_SIZE, totalPages * sizeof(BM_FrameHot)) != 0) {
+        free(mgmt);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    mgmt->hot = hot;
+    mgmt->frames = calloc(totalPages, sizeof(BM_FrameInfo));
+    if (!mgmt->frames) {
+        free(mgmt->hot);
+        free(mgmt);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    mgmt->policy = policy;
+    if (policy->init) {
+        RC rc = policy->init(totalPages, policyData, &mgmt->policyState);
+        if (rc != RC_OK) {
+            free(mgmt->frames);
+            free(mgmt->hot);
+            free(mgmt);
+            return rc;
+        }
+    }
+    pthread_mutex_init(&mgmt->latch, NULL);
 
-    // Initialize each page in the buffer
+    // Initialize each frame as empty
     for (int idx = 0; idx < totalPages; idx++) {
-        BM_PageHandle *currentPage = &pages[idx];
-        currentPage->dirty = 0;
-        currentPage->fixCounts = 0;
-        currentPage->data = NULL;
-        currentPage->pageNum = NO_PAGE; // Assuming NO_PAGE is defined as -1 or an appropriate flag value
+        BM_FrameHot *frame = &mgmt->hot[idx];
+        atomic_flag_clear(&frame->latch);
+        atomic_init(&frame->fixCounts, 0);
+        atomic_init(&frame->refBit, false);
+        atomic_init(&frame->dirty, false);
+        atomic_init(&frame->hint, BM_HINT_NORMAL);
+        atomic_init(&mgmt->frames[idx].pageNum, NO_PAGE);
+        mgmt->frames[idx].data = NULL;
     }
+    bufferPool->mgmtData = mgmt;
 
-    // Initialize IO counters and timer to 0
+    // Initialize IO counters to 0
     bufferPool->numReadIO = 0;
     bufferPool->numWriteIO = 0;
-    bufferPool->timer = 0;
 
     // Successful initialization
     return RC_OK;
@@ -72,11 +259,11 @@ RC initBufferPool(BM_BufferPool *const bufferPool, const char *const fileName,
 
 RC shutdownBufferPool(BM_BufferPool *const bufferPool) {
     int pageIndex;
-
+    BM_PoolMgmt *mgmt = POOL_MGMT(bufferPool);
 
     // Check if any page is still fixed
     for (pageIndex = 0; pageIndex < bufferPool->numPages; ++pageIndex) {
-        if (getFixCounts(bufferPool)[pageIndex]) {
+        if (atomic_load(&mgmt->hot[pageIndex].fixCounts)) {
             return RC_SHUTDOWN_POOL_FAILED;
         }
     }
@@ -87,14 +274,20 @@ RC shutdownBufferPool(BM_BufferPool *const bufferPool) {
         return rc_flag;
     }
 
-    // Free allocated memory for each page's data and strategy attribute
+    // Free allocated memory for each page's data
     for (pageIndex = 0; pageIndex < bufferPool->numPages; ++pageIndex) {
-        free(bufferPool->mgmtData[pageIndex].data);
-        free(bufferPool->mgmtData[pageIndex].strategyAttribute);
+        free(mgmt->frames[pageIndex].data);
     }
 
     // Free allocated memory for buffer pool management data
-    free(bufferPool->mgmtData);
+    if (mgmt->policy->shutdown) {
+        mgmt->policy->shutdown(mgmt->policyState);
+    }
+    pthread_mutex_destroy(&mgmt->latch);
+    free(mgmt->frames);
+    free(mgmt->hot);
+    free(mgmt);
+    bufferPool->mgmtData = NULL;
 
     return RC_OK;
 }
@@ -107,39 +300,95 @@ RC shutdownBufferPool(BM_BufferPool *const bufferPool) {
  */
 
 RC forceFlushPool(BM_BufferPool *const bm) {
-    // Get dirty flags and fix counts
-    bool *dirtyFlags = getDirtyFlags(bm);
-    int *fixCounts = getFixCounts(bm);
-
-
-    // Check if retrieval of dirty flags or fix counts failed
-    if (dirtyFlags == NULL || fixCounts == NULL) {
-        free(dirtyFlags);
-        free(fixCounts);
+    BM_PoolMgmt *mgmt = POOL_MGMT(bm);
+    if (mgmt == NULL) {
         return RC_FORCE_FLUSH_FAILED;
     }
 
+    pthread_mutex_lock(&mgmt->latch);
+
     // Iterate through each page
     for (int i = 0; i < bm->numPages; ++i) {
-        if (dirtyFlags[i] && fixCounts[i] == 0) {
+        BM_FrameHot *frame = &mgmt->hot[i];
+        if (atomic_load(&frame->dirty) && atomic_load(&frame->fixCounts) == 0) {
             // Force the page to disk
-            RC rc_flag = forcePage(bm, &bm->mgmtData[i]);
+            RC rc_flag = writeFrame(bm, atomic_load(&mgmt->frames[i].pageNum), mgmt->frames[i].data);
             if (rc_flag != RC_OK) {
-                free(dirtyFlags);
-                free(fixCounts);
+                pthread_mutex_unlock(&mgmt->latch);
                 return rc_flag;
             }
             // Reset the dirty flag for the page
-            bm->mgmtData[i].dirty = 0;
+            atomic_store(&frame->dirty, false);
+        }
+    }
+
+    pthread_mutex_unlock(&mgmt->latch);
+    return RC_OK;
+}
+
+// Drops the pages firstPage .. lastPage from the pool without writing them back
+static RC discardRange(BM_BufferPool *const bm, const PageNumber firstPage, const PageNumber lastPage) {
+    BM_PoolMgmt *mgmt = POOL_MGMT(bm);
+    if (mgmt == NULL) {
+        return RC_FORCE_FLUSH_FAILED;
+    }
+
+    pthread_mutex_lock(&mgmt->latch);
+
+    // Refuse before dropping anything if a client still holds one of the pages
+    for (int i = 0; i < bm->numPages; ++i) {
+        PageNumber pageNum = atomic_load(&mgmt->frames[i].pageNum);
+        if (pageNum != NO_PAGE && pageNum >= firstPage && pageNum <= lastPage && atomic_load(&mgmt->hot[i].fixCounts) != 0) {
+            pthread_mutex_unlock(&mgmt->latch);
+            return RC_PAGE_PINNED;
+        }
+    }
+
+    // Empty the frames the same way eviction does, minus the write-back
+    for (int i = 0; i < bm->numPages; ++i) {
+        BM_FrameHot *frame = &mgmt->hot[i];
+        lockFrame(frame);
+        PageNumber pageNum = atomic_load(&mgmt->frames[i].pageNum);
+        if (pageNum == NO_PAGE || pageNum < firstPage || pageNum > lastPage || atomic_load(&frame->fixCounts) != 0) {
+            unlockFrame(frame); // pinned by a hit that raced the check above
+            continue;
         }
+        atomic_store_explicit(&mgmt->frames[i].pageNum, NO_PAGE, memory_order_release);
+        unlockFrame(frame);
+        if (mgmt->policy->onEvict) {
+            mgmt->policy->onEvict(mgmt->policyState, i);
+        }
+        atomic_store(&frame->dirty, false);
     }
 
-    // Free allocated memory
-    free(dirtyFlags);
-    free(fixCounts);
+    pthread_mutex_unlock(&mgmt->latch);
     return RC_OK;
 }
 
+// discardPages
+/**
+ * Drops every page from firstPage on from the buffer pool without writing it back, for a page file that is about to be cut short or removed. Changes to those pages are lost.
+ * @param bm Pointer to the buffer pool.
+ * @param firstPage Number of the first page to drop; 0 drops every page.
+ * @return RC_OK, or RC_PAGE_PINNED if one of the pages is still pinned.
+ */
+
+RC discardPages(BM_BufferPool *const bm, const PageNumber firstPage) {
+    return discardRange(bm, firstPage, INT_MAX);
+}
+
+// discardPage
+/**
+ * Drops one page from the buffer pool without writing it back, for a page whose contents are no longer needed. Changes to it are lost.
+ * @param bm Pointer to the buffer pool.
+ * @param pageNum Number of the page.
+ * @return RC_OK, or RC_PAGE_PINNED if the page is still pinned.
+ */
+
+RC discardPage(BM_BufferPool *const bm, const PageNumber pageNum) {
+    return discardRange(bm, pageNum, pageNum);
+}
+
 // Buffer Manager Interface Access Pages
 
 // markDirty
@@ -151,15 +400,13 @@ RC forceFlushPool(BM_BufferPool *const bm) {
  */
 
 RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page) {
-    for (int i = 0; i < bm->numPages; ++i) {
-        BM_PageHandle *currentPage = &bm->mgmtData[i];
-        if (currentPage->pageNum == page->pageNum) {
-            currentPage->dirty = 1;
-            page->dirty = 1;
-            return RC_OK;
-        }
+    int frameIndex = findFrame(bm, page->pageNum);
+    if (frameIndex < 0) {
+        return RC_PAGE_NOT_FOUND;
     }
-    return RC_PAGE_NOT_FOUND;
+    atomic_store_explicit(&POOL_MGMT(bm)->hot[frameIndex].dirty, true, memory_order_relaxed);
+    page->dirty = 1;
+    return RC_OK;
 }
 
 // unpinPage
@@ -172,15 +419,16 @@ RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page) {
 
 RC unpinPage (BM_BufferPool *const bufferPool, BM_PageHandle *const targetPage)
 {
-     // Loop through each page in the buffer pool to find the matching page
-    for (int pageIndex = 0; pageIndex < bufferPool->numPages; pageIndex++) {
-        // Check if current page's number matches the target page's number
-        if (bufferPool->mgmtData[pageIndex].pageNum == targetPage->pageNum) {
-            // Decrease the fix count for the page, indicating it's being unpinned
-            bufferPool->mgmtData[pageIndex].fixCounts--;
-            // No need to adjust the targetPage fixCounts here as it's managed within bufferPool
-            break; // Stop searching once the matching page is found
+    BM_PoolMgmt *mgmt = POOL_MGMT(bufferPool);
+
+    // The caller still holds a pin, so the frame cannot be replaced under us
+    int frameIndex = findFrame(bufferPool, targetPage->pageNum);
+    if (frameIndex >= 0) {
+        if (mgmt->policy->onUnpin) {
+            mgmt->policy->onUnpin(mgmt->policyState, frameIndex);
         }
+        // Decrease the fix count for the page, indicating it's being unpinned
+        atomic_fetch_sub_explicit(&mgmt->hot[frameIndex].fixCounts, 1, memory_order_release);
     }
     return RC_OK; // Indicate successful operation
 }
@@ -193,33 +441,23 @@ RC unpinPage (BM_BufferPool *const bufferPool, BM_PageHandle *const targetPage)
  */
 
 RC forcePage(BM_BufferPool *const bufferPool, BM_PageHandle *const page) {
-    FILE *file;
-
-    // Open the page file
-    file = fopen(bufferPool->pageFile, "rb+");
-    if (file == NULL) {
-        return RC_FILE_NOT_FOUND;
-    }
+    BM_PoolMgmt *mgmt = POOL_MGMT(bufferPool);
 
-    // Seek to the position of the page in the file
-    fseek(file, (page->pageNum) * PAGE_SIZE, SEEK_SET);
+    pthread_mutex_lock(&mgmt->latch);
 
     // Write the page data to the file
-    fwrite(page->data, PAGE_SIZE, 1, file);
-    bufferPool->numWriteIO++;
-    // Close the file
-    fclose(file);
+    RC rc = writeFrame(bufferPool, page->pageNum, page->data);
+    if (rc != RC_OK) {
+        pthread_mutex_unlock(&mgmt->latch);
+        return rc;
+    }
 
     // Reset the dirty flag for the page in the buffer pool
-    BM_PageHandle *currentPage = bufferPool->mgmtData;
-    BM_PageHandle *end = bufferPool->mgmtData + bufferPool->numPages;
-
-    for (; currentPage != end; ++currentPage) {
-        if (currentPage->pageNum == page->pageNum) {
-            currentPage->dirty = 0;
-            break;
-        }
+    int frameIndex = findFrame(bufferPool, page->pageNum);
+    if (frameIndex >= 0) {
+        atomic_store(&mgmt->hot[frameIndex].dirty, false);
     }
+    pthread_mutex_unlock(&mgmt->latch);
 
     // Reset the dirty flag for the page handle
     page->dirty = 0;
@@ -229,103 +467,125 @@ RC forcePage(BM_BufferPool *const bufferPool, BM_PageHandle *const page) {
 
 // pinPage
 /**
- * Pins a page in memory. If the page is not already in memory, it is read from the file.
+ * Pins a page in memory with normal priority. If the page is not already in memory, it is read from the file.
  * @param bm Pointer to the buffer pool.
  * @param page Pointer to the page handle structure representing the page to be pinned.
  * @param pageNum The page number of the page to be pinned.
  * @return Return code indicating success or failure of the operation.
  */
 
-
 RC pinPage(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageNum) {
-    int pageIndex;
-    int flag = 0;
-    int pnum = -1;
-
-    // Loop through the buffer pool pages
-    for (pageIndex = 0; pageIndex < bufferPool->numPages; pageIndex++) {
-        // Check for an empty slot
-        if (bufferPool->mgmtData[pageIndex].pageNum == NO_PAGE) {
-            // Allocate memory for the new page
-            bufferPool->mgmtData[pageIndex].data = (char*)calloc(PAGE_SIZE, sizeof(char));
-            pnum = pageIndex;
-            flag = 1;
-            break;
+    return pinPageWithHint(bufferPool, pageHandle, pageNum, BM_HINT_NORMAL);
+}
+
+// pinPageWithHint
+/**
+ * Pins a page in memory, telling the pool how the page will be used. Hot pages (index inner nodes, table metadata) are only replaced when every other frame is pinned or hot; scan pages are replaced before anything else.
+ * Hits only take the latch of the frame they pin; misses are serialized on the pool latch.
+ * @param bm Pointer to the buffer pool.
+ * @param page Pointer to the page handle structure representing the page to be pinned.
+ * @param pageNum The page number of the page to be pinned.
+ * @param hint Priority of the page (BM_HINT_NORMAL, BM_HINT_HOT or BM_HINT_SCAN).
+ * @return Return code indicating success or failure of the operation.
+ */
+
+RC pinPageWithHint(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageNum,
+                   BM_PageHint hint) {
+    BM_PoolMgmt *mgmt = POOL_MGMT(bufferPool);
+    int pnum;
+
+    // Fast path: the page is resident. Re-check under the frame latch in case
+    // the frame was replaced between the lookup and the latch.
+    while ((pnum = findFrame(bufferPool, pageNum)) >= 0) {
+        BM_FrameHot *frame = &mgmt->hot[pnum];
+        lockFrame(frame);
+        if (atomic_load_explicit(&mgmt->frames[pnum].pageNum, memory_order_relaxed) == pageNum) {
+            atomic_fetch_add_explicit(&frame->fixCounts, 1, memory_order_relaxed);
+            unlockFrame(frame);
+            touchFrame(bufferPool, pnum, false, hint);
+            fillHandle(bufferPool, pnum, pageHandle);
+            return RC_OK;
+        }
+        unlockFrame(frame);
+    }
+
+    // Slow path: load the page under the pool latch.
+    pthread_mutex_lock(&mgmt->latch);
+
+    // Another thread may have loaded the page while we waited for the latch
+    pnum = findFrame(bufferPool, pageNum);
+    if (pnum >= 0) {
+        atomic_fetch_add(&mgmt->hot[pnum].fixCounts, 1);
+        pthread_mutex_unlock(&mgmt->latch);
+        touchFrame(bufferPool, pnum, false, hint);
+        fillHandle(bufferPool, pnum, pageHandle);
+        return RC_OK;
+    }
+
+    // Use an empty frame if there is one, otherwise ask the policy for a victim
+    pnum = findFrame(bufferPool, NO_PAGE);
+    while (pnum < 0) {
+        int victim = pickVictim(bufferPool);
+        if (victim < 0) {
+            pthread_mutex_unlock(&mgmt->latch);
+            return RC_PIN_PAGE_FAILED; // every frame is pinned
         }
-        // Check if the requested page is already in the buffer
-        if (bufferPool->mgmtData[pageIndex].pageNum == pageNum) {
-            pnum = pageIndex;
-            flag = 2;
-            // Update page's strategy attribute if using LRU strategy
-            if (bufferPool->strategy == RS_LRU){
-				if (bufferPool->strategy != RS_FIFO && bufferPool->strategy != RS_LRU) {
-					return RC_STRATEGY_NOT_FOUND;
-				}
-				// Allocate memory for the strategy attribute if it has not been done yet.
-				if (!bufferPool->mgmtData[pageIndex].strategyAttribute) {
-					bufferPool->mgmtData[pageIndex].strategyAttribute = (int*)calloc(1, sizeof(int));
-					if (!bufferPool->mgmtData[pageIndex].strategyAttribute) {
-						return RC_MEM_ALLOCATION_FAIL; // Assuming this return code exists for memory allocation failures.
-					}
-				}
-				// Update the strategy attribute with the current timer value and increment the timer.
-				*((int*)bufferPool->mgmtData[pageIndex].strategyAttribute) = bufferPool->timer++;
-			}
-            break;
+
+        // Claim the victim: once pageNum is NO_PAGE no hit can pin it any more
+        BM_FrameHot *frame = &mgmt->hot[victim];
+        lockFrame(frame);
+        if (atomic_load(&frame->fixCounts) != 0) {
+            unlockFrame(frame); // pinned since the policy looked at it
+            continue;
         }
-		
-        // If no empty slot and requested page not found
-        if (pageIndex == bufferPool->numPages - 1) {
-            flag = 1;
-            // Determine page to replace based on buffer pool strategy
-            if (bufferPool->strategy == RS_FIFO || bufferPool->strategy == RS_LRU) {
-                pnum = strategyFIFOandLRU(bufferPool);
-                if (bufferPool->mgmtData[pnum].dirty)
-                    forcePage(bufferPool, &bufferPool->mgmtData[pnum]);
+        PageNumber oldPage = atomic_load(&mgmt->frames[victim].pageNum);
+        atomic_store_explicit(&mgmt->frames[victim].pageNum, NO_PAGE, memory_order_release);
+        unlockFrame(frame);
+
+        // A victim that cannot be written back stays resident and dirty, and the pin fails
+        if (atomic_load(&frame->dirty)) {
+            RC rc = writeFrame(bufferPool, oldPage, mgmt->frames[victim].data);
+            if (rc != RC_OK) {
+                lockFrame(frame);
+                atomic_store_explicit(&mgmt->frames[victim].pageNum, oldPage, memory_order_release);
+                unlockFrame(frame);
+                pthread_mutex_unlock(&mgmt->latch);
+                return rc;
             }
+            atomic_store(&frame->dirty, false);
         }
+        if (mgmt->policy->onEvict) {
+            mgmt->policy->onEvict(mgmt->policyState, victim);
+        }
+        pnum = victim;
     }
 
-    // Load page data from disk if needed
-    if (flag == 1) {
-        FILE* filePtr = fopen(bufferPool->pageFile, "r");
-        fseek(filePtr, pageNum * PAGE_SIZE, SEEK_SET);
-        fread(bufferPool->mgmtData[pnum].data, sizeof(char), PAGE_SIZE, filePtr);
-        fclose(filePtr);
-        bufferPool->numReadIO++;
-        bufferPool->mgmtData[pnum].fixCounts++;
-        bufferPool->mgmtData[pnum].pageNum = pageNum;
-        pageHandle->data = bufferPool->mgmtData[pnum].data;
-        pageHandle->fixCounts = bufferPool->mgmtData[pnum].fixCounts;
-        pageHandle->pageNum = pageNum;
-        pageHandle->dirty = bufferPool->mgmtData[pnum].dirty;
-        pageHandle->strategyAttribute = bufferPool->mgmtData[pnum].strategyAttribute;
-
-        if (bufferPool->strategy != RS_FIFO && bufferPool->strategy != RS_LRU) {
-			
-			return RC_STRATEGY_NOT_FOUND;
-		}
-		// Allocate memory for the strategy attribute if it has not been done yet.
-		if (!bufferPool->mgmtData[pnum].strategyAttribute) {
-			bufferPool->mgmtData[pnum].strategyAttribute = (int*)calloc(1, sizeof(int));
-			if (!bufferPool->mgmtData[pnum].strategyAttribute) {
-				
-				return RC_MEM_ALLOCATION_FAIL; // Assuming this return code exists for memory allocation failures.
-			}
-		}
-		// Update the strategy attribute with the current timer value and increment the timer.
-		*((int*)bufferPool->mgmtData[pnum].strategyAttribute) = bufferPool->timer++;
-    }
-    // Update page handle if page is already in buffer
-    else if (flag == 2) {
-        pageHandle->data = bufferPool->mgmtData[pnum].data;
-        bufferPool->mgmtData[pnum].fixCounts++;
-        pageHandle->fixCounts = bufferPool->mgmtData[pnum].fixCounts;
-        pageHandle->pageNum = pageNum;
-        pageHandle->dirty = bufferPool->mgmtData[pnum].dirty;
-        pageHandle->strategyAttribute = bufferPool->mgmtData[pnum].strategyAttribute;
+    // Load page data from disk
+    if (mgmt->frames[pnum].data == NULL) {
+        mgmt->frames[pnum].data = (char*)calloc(PAGE_SIZE, sizeof(char));
+        if (mgmt->frames[pnum].data == NULL) {
+            pthread_mutex_unlock(&mgmt->latch);
+            return RC_MEM_ALLOCATION_FAIL;
+        }
     }
-
+    FILE* filePtr = fopen(bufferPool->pageFile, "r");
+    if (filePtr == NULL) {
+        pthread_mutex_unlock(&mgmt->latch);
+        return RC_FILE_NOT_FOUND;
+    }
+    fseek(filePtr, (long) pageNum * PAGE_SIZE, SEEK_SET);
+    fread(mgmt->frames[pnum].data, sizeof(char), PAGE_SIZE, filePtr);
+    fclose(filePtr);
+    bufferPool->numReadIO++;
+
+    // Publish the frame: fix count first, page number last
+    atomic_store(&mgmt->hot[pnum].fixCounts, 1);
+    atomic_store(&mgmt->hot[pnum].dirty, false);
+    touchFrame(bufferPool, pnum, true, hint);
+    atomic_store_explicit(&mgmt->frames[pnum].pageNum, pageNum, memory_order_release);
+    pthread_mutex_unlock(&mgmt->latch);
+
+    fillHandle(bufferPool, pnum, pageHandle);
     return RC_OK;
 }
 
@@ -341,18 +601,11 @@ RC pinPage(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, con
 PageNumber *getFrameContents(BM_BufferPool *const bufferMgr) {
     // Allocate memory for an array to store the page numbers
     PageNumber *pageNumbers = (PageNumber*)malloc(bufferMgr->numPages * sizeof(PageNumber));
+    BM_FrameInfo *frames = POOL_MGMT(bufferMgr)->frames;
 
-    // Iterate through each page in the buffer pool
+    // Empty frames already hold NO_PAGE
     for (int i = 0; i < bufferMgr->numPages; i++) {
-        // Get the page handle of the current page
-        BM_PageHandle *pageHandle = &bufferMgr->mgmtData[i];
-
-        // Check if the page data is set (indicating a used frame)
-        if (pageHandle->data != NULL) {
-            pageNumbers[i] = pageHandle->pageNum; // Store the actual page number
-        } else {
-            pageNumbers[i] = NO_PAGE; // Mark as NO_PAGE indicating it's unused
-        }
+        pageNumbers[i] = atomic_load(&frames[i].pageNum);
     }
 
     // Return the array with the page numbers (or NO_PAGE for unused frames)
@@ -379,14 +632,9 @@ bool *getDirtyFlags(BM_BufferPool *const pool) {
         return NULL;
     }
 
+    BM_FrameHot *hot = POOL_MGMT(pool)->hot;
     for (int i = 0; i < pool->numPages; ++i) {
-        // Safely access each page's dirty flag
-        if (pool->mgmtData[i].data != NULL) {
-            dirtyFlags[i] = pool->mgmtData[i].dirty;
-        } else {
-            // If page data is not allocated, assume not dirty
-            dirtyFlags[i] = false;
-        }
+        dirtyFlags[i] = atomic_load(&hot[i].dirty);
     }
 
     return dirtyFlags;
@@ -402,18 +650,12 @@ bool *getDirtyFlags(BM_BufferPool *const pool) {
 
 int *getFixCounts(BM_BufferPool *const bufferPool) {
     int *fixCountsArray = (int*)malloc(bufferPool->numPages * sizeof(int));
-    int *currentFixCounts = fixCountsArray;
-    BM_PageHandle *currentPage = bufferPool->mgmtData;
-    int pageIndex = 0;
+    BM_FrameHot *hot = POOL_MGMT(bufferPool)->hot;
 
-    // Use a do-while loop to ensure at least one iteration
-    do {
+    for (int pageIndex = 0; pageIndex < bufferPool->numPages; pageIndex++) {
         // Retrieve the fix count of the current page
-        *currentFixCounts = currentPage->fixCounts;
-        pageIndex++;
-        currentPage++;
-        currentFixCounts++;
-    } while (pageIndex < bufferPool->numPages);
+        fixCountsArray[pageIndex] = atomic_load(&hot[pageIndex].fixCounts);
+    }
 
     return fixCountsArray;
 }
@@ -426,7 +668,7 @@ int *getFixCounts(BM_BufferPool *const bufferPool) {
 int getNumReadIO(BM_BufferPool *const bm) {
     if (!bm) {
         // Log error and return -1 if bm is NULL
-        return -1; 
+        return -1;
     }
     return bm->numReadIO; // Return number of read IO operations
 }
@@ -440,83 +682,33 @@ int getNumReadIO(BM_BufferPool *const bm) {
 int getNumWriteIO(BM_BufferPool *const bm) {
     if (!bm) {
         // Log error and return -1 if bm is NULL
-        return -1; 
+        return -1;
     }
     return bm->numWriteIO; // Return number of Write IO operations
 }
 
-// strategyFIFOandLRU
+// isFrameEvictable
 /**
- * Determines which frame to use to save data using the First-In-First-Out (FIFO) strategy.
+ * Tells a replacement policy whether a frame may be chosen as victim: it holds a page, nobody has it pinned, and it is not a hot page while the pool is still looking for a non-hot victim.
  * @param bm Pointer to the buffer pool.
- * @return The index of the frame chosen by the FIFO strategy.
+ * @param frame Index of the frame.
+ * @return TRUE if the frame can be replaced.
  */
-
-int strategyFIFOandLRU(BM_BufferPool *bufferPool) {
-    int *pageAttributes = getAttributionArray(bufferPool);
-    int *fixCounts = getFixCounts(bufferPool);
-    int lowestAttribute = bufferPool->timer;
-    int pageToEvict = -1;
-
-    // Enhanced logic for identifying the page to evict
-    for (int i = 0; i < bufferPool->numPages; ++i) {
-        // Only consider pages that are not pinned (fixCounts[i] == 0)
-        if (fixCounts[i] == 0) {
-            // For FIFO, we are looking for the oldest page (smallest timer value)
-            // For LRU, we are also looking for the least recently used page (smallest timer value)
-            // The logic for both strategies converges here as we use the timer to track recency of use
-            if (pageAttributes[i] < lowestAttribute) {
-                lowestAttribute = pageAttributes[i];
-                pageToEvict = i;
-            }
-        }
-    }
-
-    // Conditional adjustment of timer and attributes based on a threshold
-    if (bufferPool->timer > 32000 && pageToEvict != -1) {
-        int adjustmentValue = lowestAttribute;
-        // Normalize the strategy attributes to prevent overflow issues
-        for (int i = 0; i < bufferPool->numPages; ++i) {
-            if (bufferPool->mgmtData[i].strategyAttribute) {
-                *(int*)bufferPool->mgmtData[i].strategyAttribute -= adjustmentValue;
-            }
-        }
-        bufferPool->timer -= adjustmentValue; // Adjust the global timer accordingly
-    }
-
-    free(pageAttributes);
-    free(fixCounts);
-
-    return pageToEvict;
+bool isFrameEvictable(BM_BufferPool *const bm, int frame) {
+    BM_PoolMgmt *mgmt = POOL_MGMT(bm);
+    if (mgmt->protectHot && atomic_load_explicit(&mgmt->hot[frame].hint, memory_order_relaxed) == BM_HINT_HOT)
+        return false;
+    return atomic_load_explicit(&mgmt->frames[frame].pageNum, memory_order_relaxed) != NO_PAGE
+        && atomic_load_explicit(&mgmt->hot[frame].fixCounts, memory_order_relaxed) == 0;
 }
 
-
-// getAttributionArray
+// clearFrameRefBit
 /**
- * Returns an array that includes all page strategy attributes.
+ * Clears the reference bit the pool sets on every access to a frame, for clock-style policies.
  * @param bm Pointer to the buffer pool.
- * @return Pointer to an array containing the strategy attributes of all pages.
+ * @param frame Index of the frame.
+ * @return TRUE if the frame had been referenced since the bit was last cleared.
  */
-int *getAttributionArray(BM_BufferPool *bm) {
-    
-    
-    if (!bm || bm->numPages <= 0) {
-        // Invalid buffer pool pointer or no pages in the buffer pool
-        return NULL;
-    }
-    // Ensure memory allocation for the array of strategy attributes, using the size of int for clarity.
-    int *strategyAttributes = calloc(bm->numPages, sizeof(int));
-    if (strategyAttributes == NULL) {
-        // Handle memory allocation failure if needed
-        return NULL; // Indicate failure to allocate memory
-    }
-
-    // Populate the array with strategy attributes from each page
-    for (int i = 0; i < bm->numPages; ++i) {
-        // Direct assignment to the array element for readability
-        strategyAttributes[i] = *((int *)(bm->mgmtData + i)->strategyAttribute);
-    }
-
-    return strategyAttributes;
+bool clearFrameRefBit(BM_BufferPool *const bm, int frame) {
+    return atomic_exchange_explicit(&POOL_MGMT(bm)->hot[frame].refBit, false, memory_order_relaxed);
 }
-
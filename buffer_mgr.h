@@ -13,32 +13,73 @@ typedef enum ReplacementStrategy {
 	RS_LRU = 1,
 	RS_CLOCK = 2,
 	RS_LFU = 3,
-	RS_LRU_K = 4
+	RS_LRU_K = 4,
+	RS_CUSTOM = 5 // stratData points to a BM_CustomStrategy
 } ReplacementStrategy;
 
 // Data Types and Structures
 typedef int PageNumber;
 #define NO_PAGE -1
 
+// Priority hints passed when pinning a page
+typedef enum BM_PageHint {
+	BM_HINT_NORMAL = 0,
+	BM_HINT_HOT = 1,  // index root/inner nodes, table metadata: keep resident
+	BM_HINT_SCAN = 2  // read once by a scan: replace first
+} BM_PageHint;
+
+// Client-side handle for a pinned page. The pool keeps its own frame
+// descriptors (see buffer_mgr.c); this is only a snapshot taken at pin time.
 typedef struct BM_PageHandle {
   PageNumber pageNum;
   char *data;
-  bool dirty; // mark whether this is a dirty page.
+  rm_bool dirty; // mark whether this is a dirty page.
   int fixCounts; // count how many clients are using this page.
-  int *strategyAttribute; // record attribution for strategy, like midify time or create time.
 } BM_PageHandle;
 
 typedef struct BM_BufferPool {
   char *pageFile;
   int numPages;
   ReplacementStrategy strategy;
-  BM_PageHandle *mgmtData; // use this one to store the bookkeeping info your buffer 
-                  // manager needs for a buffer pool
+  void *mgmtData; // frame descriptor tables and pool latch, private to buffer_mgr.c
   int numReadIO; // the number of read from page file.                
   int numWriteIO; // the number of write from page file.                               
-  int timer; // initial is 0, use this timer to compare modify/create time.
 } BM_BufferPool;
 
+// Replacement policy interface
+//
+// A policy keeps its own per-frame bookkeeping, indexed by frame number,
+// and is told about every event on a frame. The pool only asks it for a
+// victim when a page has to be loaded and no frame is empty.
+//
+// Hints: onHit and onMiss receive the hint the page was pinned with. A
+// policy should queue BM_HINT_SCAN pages for early replacement and not
+// promote them on a hit. BM_HINT_HOT needs no policy support: while other
+// victims exist, isFrameEvictable() rejects frames pinned as hot.
+//
+// Contract: every hook runs in O(1); pickVictim runs in amortized O(1) plus
+// the frames it skips because isFrameEvictable() rejects them. onHit and
+// onUnpin run without the pool latch and may race with each other and with
+// the miss path, so a policy that links frames into shared structures must
+// latch them itself. init, shutdown, pickVictim, onMiss and onEvict run
+// with the pool latch held. Every hook except pickVictim may be NULL.
+typedef struct BM_ReplacementPolicy {
+  const char *name;
+  RC (*init)(int numFrames, void *stratData, void **state);
+  void (*shutdown)(void *state);
+  void (*onHit)(void *state, int frame, BM_PageHint hint);  // a resident page was pinned
+  void (*onMiss)(void *state, int frame, BM_PageHint hint); // a page was loaded into frame
+  void (*onUnpin)(void *state, int frame); // a client released one pin
+  int (*pickVictim)(void *state, BM_BufferPool *const bm); // frame to replace, or -1
+  void (*onEvict)(void *state, int frame); // the page in frame is being replaced
+} BM_ReplacementPolicy;
+
+// stratData for RS_CUSTOM: a user policy plus the argument for its init hook
+typedef struct BM_CustomStrategy {
+  const BM_ReplacementPolicy *policy;
+  void *policyData;
+} BM_CustomStrategy;
+
 // convenience macros
 #define MAKE_POOL()					\
 		((BM_BufferPool *) malloc (sizeof(BM_BufferPool)))
@@ -52,6 +93,8 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
 		void *stratData);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+RC discardPages(BM_BufferPool *const bm, const PageNumber firstPage);
+RC discardPage(BM_BufferPool *const bm, const PageNumber pageNum);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -59,19 +102,18 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
+RC pinPageWithHint (BM_BufferPool *const bm, BM_PageHandle *const page,
+		const PageNumber pageNum, BM_PageHint hint);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
-bool *getDirtyFlags (BM_BufferPool *const bm);
+rm_bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
 
-// Added by myself
-int strategyFIFOandLRU(BM_BufferPool *bm);
-//int strategyLRU(BM_BufferPool *bm);
-int strategyLRU_k(BM_BufferPool *bm);
-int *getAttributionArray(BM_BufferPool *bm);
-void freePagesBuffer(BM_BufferPool *bm);
-RC updataAttribute(BM_BufferPool *bm, BM_PageHandle *pageHandle);
+// Replacement policy support
+const BM_ReplacementPolicy *getReplacementPolicy (ReplacementStrategy strategy);
+rm_bool isFrameEvictable (BM_BufferPool *const bm, int frame);
+rm_bool clearFrameRefBit (BM_BufferPool *const bm, int frame);
 #endif
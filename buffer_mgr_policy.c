@@ -0,0 +1,425 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "buffer_mgr.h"
+#include "dberror.h"
+#include "dt.h"
+
+// Built-in replacement policies, implemented against BM_ReplacementPolicy.
+//
+// FIFO, LRU and LFU keep frames on intrusive doubly linked lists (prev/next
+// arrays indexed by frame number), so every event is a constant number of
+// link updates. CLOCK keeps only its hand and uses the reference bit the
+// pool sets in each frame's own descriptor, so hits never touch shared
+// policy state.
+//
+// Pages pinned with BM_HINT_SCAN enter at the eviction end of their list
+// and are not promoted by scan hits. The pool does not set the reference
+// bit for scan accesses, which gives CLOCK the same behaviour.
+
+/************************************************************
+ *                    frame lists                           *
+ ************************************************************/
+
+typedef struct FrameList {
+	int head; // eviction end
+	int tail;
+} FrameList;
+
+static void
+listInit (FrameList *list)
+{
+	list->head = -1;
+	list->tail = -1;
+}
+
+static void
+listAppend (FrameList *list, int *prev, int *next, int frame)
+{
+	prev[frame] = list->tail;
+	next[frame] = -1;
+	if (list->tail != -1)
+		next[list->tail] = frame;
+	else
+		list->head = frame;
+	list->tail = frame;
+}
+
+static void
+listPrepend (FrameList *list, int *prev, int *next, int frame)
+{
+	prev[frame] = -1;
+	next[frame] = list->head;
+	if (list->head != -1)
+		prev[list->head] = frame;
+	else
+		list->tail = frame;
+	list->head = frame;
+}
+
+static void
+listUnlink (FrameList *list, int *prev, int *next, int frame)
+{
+	if (prev[frame] != -1)
+		next[prev[frame]] = next[frame];
+	else
+		list->head = next[frame];
+	if (next[frame] != -1)
+		prev[next[frame]] = prev[frame];
+	else
+		list->tail = prev[frame];
+	prev[frame] = next[frame] = -1;
+}
+
+// First evictable frame walking from the head, or -1
+static int
+listFindVictim (FrameList *list, int *next, BM_BufferPool *const bm)
+{
+	int frame;
+
+	for (frame = list->head; frame != -1; frame = next[frame])
+		if (isFrameEvictable(bm, frame))
+			return frame;
+	return -1;
+}
+
+/************************************************************
+ *                    FIFO and LRU                          *
+ ************************************************************/
+
+// Both keep resident frames in one list ordered from the eviction end.
+// FIFO orders by load time; LRU also moves a frame to the tail on a hit.
+typedef struct ListPolicy {
+	FrameList order;
+	int *prev;
+	int *next;
+	bool *linked;
+	pthread_mutex_t latch; // onHit races with the miss path
+} ListPolicy;
+
+static RC
+listPolicyInit (int numFrames, void *stratData, void **state)
+{
+	ListPolicy *p = (ListPolicy *) calloc(1, sizeof(ListPolicy));
+	if (p == NULL)
+		return RC_MEM_ALLOCATION_FAIL;
+
+	p->prev = (int *) malloc(numFrames * sizeof(int));
+	p->next = (int *) malloc(numFrames * sizeof(int));
+	p->linked = (bool *) calloc(numFrames, sizeof(bool));
+	if (p->prev == NULL || p->next == NULL || p->linked == NULL)
+	{
+		free(p->prev);
+		free(p->next);
+		free(p->linked);
+		free(p);
+		return RC_MEM_ALLOCATION_FAIL;
+	}
+	listInit(&p->order);
+	pthread_mutex_init(&p->latch, NULL);
+
+	*state = p;
+	return RC_OK;
+}
+
+static void
+listPolicyShutdown (void *state)
+{
+	ListPolicy *p = (ListPolicy *) state;
+
+	pthread_mutex_destroy(&p->latch);
+	free(p->prev);
+	free(p->next);
+	free(p->linked);
+	free(p);
+}
+
+static void
+listPolicyOnMiss (void *state, int frame, BM_PageHint hint)
+{
+	ListPolicy *p = (ListPolicy *) state;
+
+	pthread_mutex_lock(&p->latch);
+	if (hint == BM_HINT_SCAN)
+		listPrepend(&p->order, p->prev, p->next, frame);
+	else
+		listAppend(&p->order, p->prev, p->next, frame);
+	p->linked[frame] = TRUE;
+	pthread_mutex_unlock(&p->latch);
+}
+
+static void
+listPolicyOnEvict (void *state, int frame)
+{
+	ListPolicy *p = (ListPolicy *) state;
+
+	pthread_mutex_lock(&p->latch);
+	if (p->linked[frame])
+		listUnlink(&p->order, p->prev, p->next, frame);
+	p->linked[frame] = FALSE;
+	pthread_mutex_unlock(&p->latch);
+}
+
+static int
+listPolicyPickVictim (void *state, BM_BufferPool *const bm)
+{
+	ListPolicy *p = (ListPolicy *) state;
+	int victim;
+
+	pthread_mutex_lock(&p->latch);
+	victim = listFindVictim(&p->order, p->next, bm);
+	pthread_mutex_unlock(&p->latch);
+	return victim;
+}
+
+static void
+lruOnHit (void *state, int frame, BM_PageHint hint)
+{
+	ListPolicy *p = (ListPolicy *) state;
+
+	if (hint == BM_HINT_SCAN)
+		return;
+
+	pthread_mutex_lock(&p->latch);
+	if (p->linked[frame] && p->order.tail != frame)
+	{
+		listUnlink(&p->order, p->prev, p->next, frame);
+		listAppend(&p->order, p->prev, p->next, frame);
+	}
+	pthread_mutex_unlock(&p->latch);
+}
+
+static const BM_ReplacementPolicy fifoPolicy = {
+	.name = "FIFO",
+	.init = listPolicyInit,
+	.shutdown = listPolicyShutdown,
+	.onHit = NULL,
+	.onMiss = listPolicyOnMiss,
+	.onUnpin = NULL,
+	.pickVictim = listPolicyPickVictim,
+	.onEvict = listPolicyOnEvict
+};
+
+static const BM_ReplacementPolicy lruPolicy = {
+	.name = "LRU",
+	.init = listPolicyInit,
+	.shutdown = listPolicyShutdown,
+	.onHit = lruOnHit,
+	.onMiss = listPolicyOnMiss,
+	.onUnpin = NULL,
+	.pickVictim = listPolicyPickVictim,
+	.onEvict = listPolicyOnEvict
+};
+
+/************************************************************
+ *                    CLOCK                                 *
+ ************************************************************/
+
+typedef struct ClockPolicy {
+	int numFrames;
+	int hand;
+} ClockPolicy;
+
+static RC
+clockInit (int numFrames, void *stratData, void **state)
+{
+	ClockPolicy *p = (ClockPolicy *) calloc(1, sizeof(ClockPolicy));
+	if (p == NULL)
+		return RC_MEM_ALLOCATION_FAIL;
+
+	p->numFrames = numFrames;
+	*state = p;
+	return RC_OK;
+}
+
+static void
+clockShutdown (void *state)
+{
+	free(state);
+}
+
+// Sweep the hand, giving every referenced frame a second chance. Two full
+// turns clear every reference bit, so a victim is found if one exists.
+static int
+clockPickVictim (void *state, BM_BufferPool *const bm)
+{
+	ClockPolicy *p = (ClockPolicy *) state;
+	int i;
+
+	for (i = 0; i < 2 * p->numFrames; i++)
+	{
+		int frame = p->hand;
+		p->hand = (p->hand + 1) % p->numFrames;
+
+		if (!isFrameEvictable(bm, frame))
+			continue;
+		if (clearFrameRefBit(bm, frame))
+			continue;
+		return frame;
+	}
+	return -1;
+}
+
+static const BM_ReplacementPolicy clockPolicy = {
+	.name = "CLOCK",
+	.init = clockInit,
+	.shutdown = clockShutdown,
+	.onHit = NULL, // the pool already set the frame's reference bit
+	.onMiss = NULL,
+	.onUnpin = NULL,
+	.pickVictim = clockPickVictim,
+	.onEvict = NULL
+};
+
+/************************************************************
+ *                    LFU                                   *
+ ************************************************************/
+
+// One list per access count, LRU order within a count. Counts saturate at
+// LFU_MAX_COUNT so that moving a frame and finding the lowest non-empty
+// bucket stay bounded.
+#define LFU_MAX_COUNT 255
+
+typedef struct LfuPolicy {
+	FrameList buckets[LFU_MAX_COUNT + 1];
+	int *prev;
+	int *next;
+	int *count; // 0 while the frame is not resident
+	pthread_mutex_t latch;
+} LfuPolicy;
+
+static RC
+lfuInit (int numFrames, void *stratData, void **state)
+{
+	LfuPolicy *p = (LfuPolicy *) calloc(1, sizeof(LfuPolicy));
+	int i;
+
+	if (p == NULL)
+		return RC_MEM_ALLOCATION_FAIL;
+
+	p->prev = (int *) malloc(numFrames * sizeof(int));
+	p->next = (int *) malloc(numFrames * sizeof(int));
+	p->count = (int *) calloc(numFrames, sizeof(int));
+	if (p->prev == NULL || p->next == NULL || p->count == NULL)
+	{
+		free(p->prev);
+		free(p->next);
+		free(p->count);
+		free(p);
+		return RC_MEM_ALLOCATION_FAIL;
+	}
+	for (i = 0; i <= LFU_MAX_COUNT; i++)
+		listInit(&p->buckets[i]);
+	pthread_mutex_init(&p->latch, NULL);
+
+	*state = p;
+	return RC_OK;
+}
+
+static void
+lfuShutdown (void *state)
+{
+	LfuPolicy *p = (LfuPolicy *) state;
+
+	pthread_mutex_destroy(&p->latch);
+	free(p->prev);
+	free(p->next);
+	free(p->count);
+	free(p);
+}
+
+static void
+lfuOnHit (void *state, int frame, BM_PageHint hint)
+{
+	LfuPolicy *p = (LfuPolicy *) state;
+	int c;
+
+	if (hint == BM_HINT_SCAN)
+		return;
+
+	pthread_mutex_lock(&p->latch);
+	c = p->count[frame];
+	if (c > 0)
+	{
+		listUnlink(&p->buckets[c], p->prev, p->next, frame);
+		if (c < LFU_MAX_COUNT)
+			c++;
+		p->count[frame] = c;
+		listAppend(&p->buckets[c], p->prev, p->next, frame);
+	}
+	pthread_mutex_unlock(&p->latch);
+}
+
+static void
+lfuOnMiss (void *state, int frame, BM_PageHint hint)
+{
+	LfuPolicy *p = (LfuPolicy *) state;
+
+	pthread_mutex_lock(&p->latch);
+	p->count[frame] = 1;
+	if (hint == BM_HINT_SCAN)
+		listPrepend(&p->buckets[1], p->prev, p->next, frame);
+	else
+		listAppend(&p->buckets[1], p->prev, p->next, frame);
+	pthread_mutex_unlock(&p->latch);
+}
+
+static void
+lfuOnEvict (void *state, int frame)
+{
+	LfuPolicy *p = (LfuPolicy *) state;
+
+	pthread_mutex_lock(&p->latch);
+	if (p->count[frame] > 0)
+		listUnlink(&p->buckets[p->count[frame]], p->prev, p->next, frame);
+	p->count[frame] = 0;
+	pthread_mutex_unlock(&p->latch);
+}
+
+static int
+lfuPickVictim (void *state, BM_BufferPool *const bm)
+{
+	LfuPolicy *p = (LfuPolicy *) state;
+	int c, victim = -1;
+
+	pthread_mutex_lock(&p->latch);
+	for (c = 1; c <= LFU_MAX_COUNT && victim == -1; c++)
+		victim = listFindVictim(&p->buckets[c], p->next, bm);
+	pthread_mutex_unlock(&p->latch);
+	return victim;
+}
+
+static const BM_ReplacementPolicy lfuPolicy = {
+	.name = "LFU",
+	.init = lfuInit,
+	.shutdown = lfuShutdown,
+	.onHit = lfuOnHit,
+	.onMiss = lfuOnMiss,
+	.onUnpin = NULL,
+	.pickVictim = lfuPickVictim,
+	.onEvict = lfuOnEvict
+};
+
+// getReplacementPolicy
+/**
+ * Returns the built-in policy implementing a replacement strategy.
+ * @param strategy The replacement strategy.
+ * @return The policy, or NULL if the strategy has no built-in implementation (RS_LRU_K, RS_CUSTOM).
+ */
+const BM_ReplacementPolicy *
+getReplacementPolicy (ReplacementStrategy strategy)
+{
+	switch (strategy)
+	{
+	case RS_FIFO:
+		return &fifoPolicy;
+	case RS_LRU:
+		return &lruPolicy;
+	case RS_CLOCK:
+		return &clockPolicy;
+	case RS_LFU:
+		return &lfuPolicy;
+	default:
+		return NULL;
+	}
+}
@@ -98,6 +98,9 @@ printStrat (BM_BufferPool *const bm)
 	case RS_LRU_K:
 		printf("LRU-K");
 		break;
+	case RS_CUSTOM:
+		printf("CUSTOM");
+		break;
 	default:
 		printf("%i", bm->strategy);
 		break;
@@ -0,0 +1,978 @@
+#include "cluster_mgr.h"
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+#include "norm_key.h"
+#include "record_mgr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Clustered storage of a table
+//
+// Keys are normalized keys (norm_key.h) over the key attributes, so nodes
+// compare them with memcmp. Page 0 is a CL_Header. Every other page is a
+// node that starts with a CL_Node. A leaf holds its entries sorted by key,
+// each entry the key, the row id and the record, and links to the next
+// leaf. An inner node with n keys holds n + 1 child pages followed by the
+// keys; child i holds the keys below key i and at or above key i - 1.
+//
+// A full node splits in half and pushes the first key of its right half up;
+// a split of the root adds a level. Deletes leave the leaves as they are,
+// so a leaf never goes away and a scan can always follow the links.
+//
+// The row map is written after the nodes when the table is closed, in
+// whole pages, and read back when it is opened. The pages are reused as
+// long as the map fits into them.
+
+#define CL_POOL_SIZE 64
+#define CL_MAX_HEIGHT 32
+
+// Storage header, stored at the start of page 0
+typedef struct CL_Header {
+    int recordSize;
+    int keySize;
+    int root;
+    int numPages;
+    int numTuples;
+    int nextRowId;
+    int mapPage;        // first page of the row map, -1 for none
+    int mapPages;
+} CL_Header;
+
+// Start of every node page
+typedef struct CL_Node {
+    int isLeaf;
+    int count;          // entries of a leaf, keys of an inner node
+    int next;           // next leaf, -1 for the last one and inner nodes
+} CL_Node;
+
+struct CL_Tree {
+    Schema *schema;
+    char *file;         // name of the page file, kept by the buffer pool
+    CL_Header header;
+    SM_FileHandle fh;
+    BM_BufferPool pool;
+    int entrySize;      // of a leaf entry
+    int leafOrder;      // entries per leaf
+    int innerOrder;     // keys per inner node
+    int mapCapacity;
+    int *leafOf;        // row id -> leaf holding the record, -1 for none
+};
+
+struct CL_Scan {
+    CL_Tree *tree;
+    BM_PageHandle page;     // current leaf, pinned while pinned is set
+    bool pinned;
+    bool done;
+    char *from;             // key to continue from, NULL at the start
+    bool fromIncluded;      // from itself is still to be returned
+    char *high;             // largest first key attribute to return, NULL for no bound
+    int boundSize;          // bytes of the first key attribute
+};
+
+#define NODE(data) ((CL_Node *) (data))
+
+/* ---------------------------------------------------------------------- */
+/* Nodes                                                                   */
+/* ---------------------------------------------------------------------- */
+
+static char *fileName(char *name) {
+    int len = strlen(name) + 8;
+    char *result = (char *) malloc(len);
+
+    if (result != NULL)
+        snprintf(result, len, "%s.clu", name);
+    return result;
+}
+
+static int keySizeOf(Schema *schema) {
+    int i, size = 0;
+
+    for (i = 0; i < schema->keySize; i++)
+        size += normKeyAttrSize(schema->dataTypes[schema->keyAttrs[i]], schema->typeLength[schema->keyAttrs[i]]);
+    return size;
+}
+
+static char *entryAt(CL_Tree *t, char *node, int i) {
+    return node + sizeof(CL_Node) + i * t->entrySize;
+}
+
+static int rowIdOf(CL_Tree *t, char *entry) {
+    int rowId;
+
+    memcpy(&rowId, entry + t->header.keySize, sizeof(int));
+    return rowId;
+}
+
+static int *childrenOf(char *node) {
+    return (int *) (node + sizeof(CL_Node));
+}
+
+static char *innerKey(CL_Tree *t, char *node, int i) {
+    return node + sizeof(CL_Node) + (t->innerOrder + 1) * sizeof(int) + i * t->header.keySize;
+}
+
+// Position of the first entry of a leaf at or above key (above it if after is set)
+static int searchLeaf(CL_Tree *t, char *node, const char *key, bool after) {
+    int lo = 0, hi = NODE(node)->count;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = memcmp(entryAt(t, node, mid), key, t->header.keySize);
+        if (cmp < 0 || (after && cmp == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Child of an inner node that holds key
+static int searchInner(CL_Tree *t, char *node, const char *key) {
+    int lo = 0, hi = NODE(node)->count;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (memcmp(innerKey(t, node, mid), key, t->header.keySize) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// findLeaf
+/**
+ * Descends from the root to the leaf that holds a key.
+ *
+ * @param t The tree.
+ * @param key The key, NULL for the leftmost leaf.
+ * @param path Receives the inner nodes passed, root first, or NULL.
+ * @param slots Receives the child taken in each of them, or NULL.
+ * @param depth Receives the number of inner nodes passed, or NULL.
+ * @param leaf Receives the page of the leaf.
+ * @return RC_OK, or the error of the buffer manager.
+ */
+static RC findLeaf(CL_Tree *t, const char *key, int *path, int *slots, int *depth, int *leaf) {
+    BM_PageHandle page;
+    int pageNum = t->header.root, level = 0;
+    RC rc;
+
+    while (true) {
+        if ((rc = pinPageWithHint(&t->pool, &page, pageNum, BM_HINT_HOT)) != RC_OK)
+            return rc;
+        if (NODE(page.data)->isLeaf) {
+            unpinPage(&t->pool, &page);
+            break;
+        }
+        int slot = key != NULL ? searchInner(t, page.data, key) : 0;
+        if (path != NULL) {
+            path[level] = pageNum;
+            slots[level] = slot;
+        }
+        level++;
+        pageNum = childrenOf(page.data)[slot];
+        unpinPage(&t->pool, &page);
+        if (level == CL_MAX_HEIGHT)
+            return RC_ERROR;
+    }
+    if (depth != NULL)
+        *depth = level;
+    *leaf = pageNum;
+    return RC_OK;
+}
+
+// Append an empty node and leave it pinned
+static RC allocNode(CL_Tree *t, bool isLeaf, BM_PageHandle *page) {
+    int pageNum = t->header.numPages;
+    RC rc;
+
+    if ((rc = ensureCapacity(pageNum + 1, &t->fh)) != RC_OK)
+        return rc;
+    if ((rc = pinPageWithHint(&t->pool, page, pageNum, isLeaf ? BM_HINT_NORMAL : BM_HINT_HOT)) != RC_OK)
+        return rc;
+    memset(page->data, 0, PAGE_SIZE);
+    NODE(page->data)->isLeaf = isLeaf;
+    NODE(page->data)->next = -1;
+    markDirty(&t->pool, page);
+    t->header.numPages++;
+    return RC_OK;
+}
+
+// Make the row map hold a row id
+static RC reserveRowId(CL_Tree *t, int rowId) {
+    int capacity = t->mapCapacity > 0 ? t->mapCapacity : 256;
+
+    if (rowId < t->mapCapacity)
+        return RC_OK;
+    while (capacity <= rowId)
+        capacity *= 2;
+    int *grown = (int *) realloc(t->leafOf, capacity * sizeof(int));
+    if (grown == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    memset(grown + t->mapCapacity, 0xff, (capacity - t->mapCapacity) * sizeof(int));
+    t->leafOf = grown;
+    t->mapCapacity = capacity;
+    return RC_OK;
+}
+
+// insertSeparator
+/**
+ * Adds the first key of a new right sibling to the parents of a split
+ * node, splitting them in turn while they are full.
+ *
+ * @param t The tree.
+ * @param path The inner nodes above the split node, root first.
+ * @param slots The child taken in each of them.
+ * @param depth The number of inner nodes in path.
+ * @param key The separator.
+ * @param right Page of the new sibling.
+ * @return RC_OK, or the error of the storage or buffer manager.
+ */
+static RC insertSeparator(CL_Tree *t, int *path, int *slots, int depth, const char *key, int right) {
+    int keySize = t->header.keySize;
+    char sep[keySize];
+    BM_PageHandle page, sibling;
+    int level;
+    RC rc;
+
+    memcpy(sep, key, keySize);
+    for (level = depth - 1; level >= 0; level--) {
+        int slot = slots[level];
+        if ((rc = pinPageWithHint(&t->pool, &page, path[level], BM_HINT_HOT)) != RC_OK)
+            return rc;
+        CL_Node *node = NODE(page.data);
+        int *children = childrenOf(page.data);
+
+        if (node->count < t->innerOrder) {
+            memmove(innerKey(t, page.data, slot + 1), innerKey(t, page.data, slot), (node->count - slot) * keySize);
+            memmove(children + slot + 2, children + slot + 1, (node->count - slot) * sizeof(int));
+            memcpy(innerKey(t, page.data, slot), sep, keySize);
+            children[slot + 1] = right;
+            node->count++;
+            markDirty(&t->pool, &page);
+            unpinPage(&t->pool, &page);
+            return RC_OK;
+        }
+
+        // split: gather the keys and children with the new ones in place
+        int n = node->count + 1, mid = n / 2;
+        char *keys = (char *) malloc(n * keySize);
+        int *kids = (int *) malloc((n + 1) * sizeof(int));
+        if (keys == NULL || kids == NULL) {
+            free(keys);
+            free(kids);
+            unpinPage(&t->pool, &page);
+            return RC_MEM_ALLOCATION_FAIL;
+        }
+        memcpy(keys, innerKey(t, page.data, 0), slot * keySize);
+        memcpy(keys + slot * keySize, sep, keySize);
+        memcpy(keys + (slot + 1) * keySize, innerKey(t, page.data, slot), (node->count - slot) * keySize);
+        memcpy(kids, children, (slot + 1) * sizeof(int));
+        kids[slot + 1] = right;
+        memcpy(kids + slot + 2, children + slot + 1, (node->count - slot) * sizeof(int));
+
+        if ((rc = allocNode(t, false, &sibling)) != RC_OK) {
+            free(keys);
+            free(kids);
+            unpinPage(&t->pool, &page);
+            return rc;
+        }
+        node->count = mid;
+        memcpy(innerKey(t, page.data, 0), keys, mid * keySize);
+        memcpy(children, kids, (mid + 1) * sizeof(int));
+        NODE(sibling.data)->count = n - mid - 1;
+        memcpy(innerKey(t, sibling.data, 0), keys + (mid + 1) * keySize, (n - mid - 1) * keySize);
+        memcpy(childrenOf(sibling.data), kids + mid + 1, (n - mid) * sizeof(int));
+        memcpy(sep, keys + mid * keySize, keySize);
+        right = sibling.pageNum;
+
+        markDirty(&t->pool, &page);
+        unpinPage(&t->pool, &page);
+        unpinPage(&t->pool, &sibling);
+        free(keys);
+        free(kids);
+    }
+
+    // the root split: a new root above it
+    if ((rc = allocNode(t, false, &page)) != RC_OK)
+        return rc;
+    NODE(page.data)->count = 1;
+    childrenOf(page.data)[0] = t->header.root;
+    childrenOf(page.data)[1] = right;
+    memcpy(innerKey(t, page.data, 0), sep, keySize);
+    t->header.root = page.pageNum;
+    unpinPage(&t->pool, &page);
+    return RC_OK;
+}
+
+// insertEntry
+/**
+ * Puts a record into the leaf its key belongs in, splitting the leaf if it
+ * is full.
+ *
+ * @param t The tree.
+ * @param key Key of the record.
+ * @param rowId Row id of the record.
+ * @param data The record.
+ * @return RC_OK, RC_IM_KEY_ALREADY_EXISTS, or an error code.
+ */
+static RC insertEntry(CL_Tree *t, const char *key, int rowId, const char *data) {
+    int path[CL_MAX_HEIGHT], slots[CL_MAX_HEIGHT];
+    int keySize = t->header.keySize, depth, leaf, pos, n, mid, i;
+    BM_PageHandle page, sibling;
+    char *entries;
+    RC rc;
+
+    if ((rc = reserveRowId(t, rowId)) != RC_OK)
+        return rc;
+    if ((rc = findLeaf(t, key, path, slots, &depth, &leaf)) != RC_OK)
+        return rc;
+    if ((rc = pinPage(&t->pool, &page, leaf)) != RC_OK)
+        return rc;
+    CL_Node *node = NODE(page.data);
+    pos = searchLeaf(t, page.data, key, false);
+    if (pos < node->count && memcmp(entryAt(t, page.data, pos), key, keySize) == 0) {
+        unpinPage(&t->pool, &page);
+        return RC_IM_KEY_ALREADY_EXISTS;
+    }
+
+    if (node->count < t->leafOrder) {
+        memmove(entryAt(t, page.data, pos + 1), entryAt(t, page.data, pos), (node->count - pos) * t->entrySize);
+        memcpy(entryAt(t, page.data, pos), key, keySize);
+        memcpy(entryAt(t, page.data, pos) + keySize, &rowId, sizeof(int));
+        memcpy(entryAt(t, page.data, pos) + keySize + sizeof(int), data, t->header.recordSize);
+        node->count++;
+        t->leafOf[rowId] = leaf;
+        markDirty(&t->pool, &page);
+        unpinPage(&t->pool, &page);
+        return RC_OK;
+    }
+
+    // split: gather the entries with the new one in place, the upper half moves right
+    n = node->count + 1;
+    mid = n / 2;
+    entries = (char *) malloc(n * t->entrySize);
+    if (entries == NULL) {
+        unpinPage(&t->pool, &page);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    memcpy(entries, entryAt(t, page.data, 0), pos * t->entrySize);
+    memcpy(entries + pos * t->entrySize, key, keySize);
+    memcpy(entries + pos * t->entrySize + keySize, &rowId, sizeof(int));
+    memcpy(entries + pos * t->entrySize + keySize + sizeof(int), data, t->header.recordSize);
+    memcpy(entries + (pos + 1) * t->entrySize, entryAt(t, page.data, pos), (node->count - pos) * t->entrySize);
+
+    if ((rc = allocNode(t, true, &sibling)) != RC_OK) {
+        free(entries);
+        unpinPage(&t->pool, &page);
+        return rc;
+    }
+    node->count = mid;
+    memcpy(entryAt(t, page.data, 0), entries, mid * t->entrySize);
+    NODE(sibling.data)->count = n - mid;
+    memcpy(entryAt(t, sibling.data, 0), entries + mid * t->entrySize, (n - mid) * t->entrySize);
+    NODE(sibling.data)->next = node->next;
+    node->next = sibling.pageNum;
+    for (i = 0; i < n; i++)
+        t->leafOf[rowIdOf(t, entries + i * t->entrySize)] = i < mid ? leaf : sibling.pageNum;
+
+    markDirty(&t->pool, &page);
+    unpinPage(&t->pool, &page);
+    unpinPage(&t->pool, &sibling);
+    rc = insertSeparator(t, path, slots, depth, entries + mid * t->entrySize, sibling.pageNum);
+    free(entries);
+    return rc;
+}
+
+// findRow
+/**
+ * Pins the leaf holding a record and finds its entry.
+ *
+ * @param t The tree.
+ * @param rid RID of the record.
+ * @param page Receives the pinned leaf.
+ * @param pos Receives the position of the entry.
+ * @return RC_OK, RC_RM_RECORD_NOT_EXIST, or the error of the buffer manager.
+ */
+static RC findRow(CL_Tree *t, RID rid, BM_PageHandle *page, int *pos) {
+    int i;
+    RC rc;
+
+    if (rid.page < 0 || rid.page >= t->header.nextRowId || rid.slot != 0 || t->leafOf[rid.page] < 0)
+        return RC_RM_RECORD_NOT_EXIST;
+    if ((rc = pinPage(&t->pool, page, t->leafOf[rid.page])) != RC_OK)
+        return rc;
+    for (i = 0; i < NODE(page->data)->count; i++)
+        if (rowIdOf(t, entryAt(t, page->data, i)) == rid.page) {
+            *pos = i;
+            return RC_OK;
+        }
+    unpinPage(&t->pool, page);
+    return RC_RM_RECORD_NOT_EXIST;
+}
+
+// Take an entry out of its pinned leaf and unpin it
+static void removeAt(CL_Tree *t, BM_PageHandle *page, int pos) {
+    CL_Node *node = NODE(page->data);
+
+    t->leafOf[rowIdOf(t, entryAt(t, page->data, pos))] = -1;
+    memmove(entryAt(t, page->data, pos), entryAt(t, page->data, pos + 1), (node->count - pos - 1) * t->entrySize);
+    node->count--;
+    markDirty(&t->pool, page);
+    unpinPage(&t->pool, page);
+}
+
+static RC recordKey(CL_Tree *t, char *data, char *key) {
+    Record record;
+
+    record.data = data;
+    return normalizeRecordKey(t->schema, &record, t->schema->keySize, t->schema->keyAttrs, key);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Row map                                                                 */
+/* ---------------------------------------------------------------------- */
+
+// Read the row map from its pages
+static RC readRowMap(CL_Tree *t) {
+    BM_PageHandle page;
+    int bytes = t->header.nextRowId * sizeof(int), done = 0, i;
+    RC rc;
+
+    if (t->header.nextRowId > 0 && (rc = reserveRowId(t, t->header.nextRowId - 1)) != RC_OK)
+        return rc;
+    for (i = 0; done < bytes; i++) {
+        int len = bytes - done < PAGE_SIZE ? bytes - done : PAGE_SIZE;
+        if ((rc = pinPage(&t->pool, &page, t->header.mapPage + i)) != RC_OK)
+            return rc;
+        memcpy((char *) t->leafOf + done, page.data, len);
+        unpinPage(&t->pool, &page);
+        done += len;
+    }
+    return RC_OK;
+}
+
+// Write the row map, to new pages at the end of the file if it outgrew its pages
+static RC writeRowMap(CL_Tree *t) {
+    BM_PageHandle page;
+    int bytes = t->header.nextRowId * sizeof(int), done = 0, i;
+    int pages = (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    RC rc;
+
+    if (pages > t->header.mapPages) {
+        t->header.mapPage = t->header.numPages;
+        t->header.mapPages = pages;
+        t->header.numPages += pages;
+        if ((rc = ensureCapacity(t->header.numPages, &t->fh)) != RC_OK)
+            return rc;
+    }
+    for (i = 0; done < bytes; i++) {
+        int len = bytes - done < PAGE_SIZE ? bytes - done : PAGE_SIZE;
+        if ((rc = pinPage(&t->pool, &page, t->header.mapPage + i)) != RC_OK)
+            return rc;
+        memcpy(page.data, (char *) t->leafOf + done, len);
+        markDirty(&t->pool, &page);
+        unpinPage(&t->pool, &page);
+        done += len;
+    }
+    return RC_OK;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Storage                                                                 */
+/* ---------------------------------------------------------------------- */
+
+// clCreate
+/**
+ * Creates the storage of a table: a tree with one empty leaf.
+ *
+ * @param name Name of the table.
+ * @param schema Its schema; the key attributes are the key of the tree.
+ * @return RC_OK, RC_INVALID_ARGS if the schema has no key attributes or a
+ *         leaf cannot hold two records, or an error code.
+ */
+RC clCreate(char *name, Schema *schema) {
+    char *file = fileName(name);
+    CL_Header header;
+    SM_FileHandle fh;
+    char *page;
+    RC rc;
+
+    if (file == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    memset(&header, 0, sizeof(header));
+    header.recordSize = getRecordSize(schema);
+    header.keySize = schema->keySize > 0 ? keySizeOf(schema) : 0;
+    if (schema->keySize < 1
+            || (int) sizeof(CL_Node) + 2 * (header.keySize + (int) sizeof(int) + header.recordSize) > PAGE_SIZE
+            || (int) sizeof(CL_Node) + 4 * (int) sizeof(int) + 3 * header.keySize > PAGE_SIZE) {
+        free(file);
+        return RC_INVALID_ARGS;
+    }
+    header.root = 1;
+    header.numPages = 2;
+    header.mapPage = -1;
+
+    page = (char *) calloc(PAGE_SIZE, sizeof(char));
+    if (page == NULL) {
+        free(file);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    rc = createPageFile(file);
+    if (rc == RC_OK)
+        rc = openPageFile(file, &fh);
+    free(file);
+    if (rc == RC_OK) {
+        if ((rc = ensureCapacity(2, &fh)) == RC_OK) {
+            memcpy(page, &header, sizeof(header));
+            rc = writeBlock(0, &fh, page);
+        }
+        if (rc == RC_OK) {
+            memset(page, 0, PAGE_SIZE);
+            NODE(page)->isLeaf = true;
+            NODE(page)->next = -1;
+            rc = writeBlock(1, &fh, page);
+        }
+        closePageFile(&fh);
+    }
+    free(page);
+    return rc;
+}
+
+// Check whether a table keeps its records in a tree
+bool clExists(char *name) {
+    char *file = fileName(name);
+    FILE *f;
+
+    if (file == NULL)
+        return false;
+    f = fopen(file, "rb");
+    free(file);
+    if (f == NULL)
+        return false;
+    fclose(f);
+    return true;
+}
+
+// clOpen
+/**
+ * Opens the storage of a table and reads its row map.
+ *
+ * @param name Name of the table.
+ * @param schema Its schema, which must outlive the open storage.
+ * @param tree Receives the open storage; release it with clClose.
+ * @return RC_OK, RC_INVALID_ARGS if the schema does not fit the file, or an
+ *         error code.
+ */
+RC clOpen(char *name, Schema *schema, CL_Tree **tree) {
+    char *file = fileName(name);
+    BM_PageHandle page;
+    CL_Tree *t;
+    RC rc;
+
+    *tree = NULL;
+    t = (CL_Tree *) calloc(1, sizeof(CL_Tree));
+    if (file == NULL || t == NULL) {
+        free(file);
+        free(t);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    if ((rc = openPageFile(file, &t->fh)) != RC_OK) {
+        free(file);
+        free(t);
+        return rc;
+    }
+    t->file = file;
+    if ((rc = initBufferPool(&t->pool, file, CL_POOL_SIZE, RS_LRU, NULL)) != RC_OK) {
+        closePageFile(&t->fh);
+        free(file);
+        free(t);
+        return rc;
+    }
+
+    if ((rc = pinPageWithHint(&t->pool, &page, 0, BM_HINT_HOT)) == RC_OK) {
+        memcpy(&t->header, page.data, sizeof(CL_Header));
+        unpinPage(&t->pool, &page);
+        if (t->header.recordSize != getRecordSize(schema) || schema->keySize < 1
+                || t->header.keySize != keySizeOf(schema))
+            rc = RC_INVALID_ARGS;
+    }
+    if (rc == RC_OK) {
+        t->schema = schema;
+        t->entrySize = t->header.keySize + sizeof(int) + t->header.recordSize;
+        t->leafOrder = (PAGE_SIZE - sizeof(CL_Node)) / t->entrySize;
+        t->innerOrder = (PAGE_SIZE - sizeof(CL_Node) - sizeof(int)) / (t->header.keySize + sizeof(int));
+        rc = readRowMap(t);
+    }
+    if (rc != RC_OK) {
+        shutdownBufferPool(&t->pool);
+        closePageFile(&t->fh);
+        free(t->leafOf);
+        free(t->file);
+        free(t);
+        return rc;
+    }
+    *tree = t;
+    return RC_OK;
+}
+
+// clClose
+/**
+ * Writes the row map, the header and the dirty nodes and releases the
+ * storage.
+ *
+ * @param tree The storage.
+ * @return RC_OK, or the error of the storage or buffer manager.
+ */
+RC clClose(CL_Tree *tree) {
+    BM_PageHandle page;
+    RC rc;
+
+    if ((rc = writeRowMap(tree)) != RC_OK)
+        return rc;
+    if ((rc = pinPageWithHint(&tree->pool, &page, 0, BM_HINT_HOT)) != RC_OK)
+        return rc;
+    memcpy(page.data, &tree->header, sizeof(CL_Header));
+    markDirty(&tree->pool, &page);
+    unpinPage(&tree->pool, &page);
+
+    if ((rc = shutdownBufferPool(&tree->pool)) != RC_OK)
+        return rc;
+    closePageFile(&tree->fh);
+    free(tree->leafOf);
+    free(tree->file);
+    free(tree);
+    return RC_OK;
+}
+
+// Remove the file of the storage of a table
+RC clDestroy(char *name) {
+    char *file = fileName(name);
+    RC rc;
+
+    if (file == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    rc = destroyPageFile(file);
+    free(file);
+    return rc;
+}
+
+// clTruncate
+/**
+ * Removes every record: the cached nodes are dropped without being written,
+ * the file is cut back to the header and one leaf, and that leaf is emptied.
+ *
+ * @param tree The storage.
+ * @return RC_OK, RC_PAGE_PINNED while a scan holds a leaf, or an error code.
+ */
+RC clTruncate(CL_Tree *tree) {
+    BM_PageHandle page;
+    RC rc;
+
+    if ((rc = discardPages(&tree->pool, 0)) != RC_OK)
+        return rc;
+    if ((rc = truncatePageFile(2, &tree->fh)) != RC_OK)
+        return rc;
+
+    tree->header.root = 1;
+    tree->header.numPages = 2;
+    tree->header.numTuples = 0;
+    tree->header.nextRowId = 0;
+    tree->header.mapPage = -1;
+    tree->header.mapPages = 0;
+    if (tree->leafOf != NULL)
+        memset(tree->leafOf, 0xff, tree->mapCapacity * sizeof(int));
+
+    if ((rc = pinPage(&tree->pool, &page, 1)) != RC_OK)
+        return rc;
+    memset(page.data, 0, PAGE_SIZE);
+    NODE(page.data)->isLeaf = true;
+    NODE(page.data)->next = -1;
+    markDirty(&tree->pool, &page);
+    unpinPage(&tree->pool, &page);
+
+    if ((rc = pinPageWithHint(&tree->pool, &page, 0, BM_HINT_HOT)) != RC_OK)
+        return rc;
+    memcpy(page.data, &tree->header, sizeof(CL_Header));
+    markDirty(&tree->pool, &page);
+    unpinPage(&tree->pool, &page);
+    return RC_OK;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Records                                                                 */
+/* ---------------------------------------------------------------------- */
+
+// clInsert
+/**
+ * Inserts a record under its key and hands out its row id.
+ *
+ * @param tree The storage.
+ * @param data The record.
+ * @param rid Receives its RID.
+ * @return RC_OK, RC_IM_KEY_ALREADY_EXISTS, or an error code.
+ */
+RC clInsert(CL_Tree *tree, char *data, RID *rid) {
+    char key[tree->header.keySize];
+    RC rc;
+
+    if ((rc = recordKey(tree, data, key)) != RC_OK)
+        return rc;
+    if ((rc = insertEntry(tree, key, tree->header.nextRowId, data)) != RC_OK)
+        return rc;
+    rid->page = tree->header.nextRowId++;
+    rid->slot = 0;
+    tree->header.numTuples++;
+    return RC_OK;
+}
+
+// clUpdate
+/**
+ * Replaces a record. A record whose key changes moves to the leaf of its
+ * new key and keeps its RID.
+ *
+ * @param tree The storage.
+ * @param rid RID of the record.
+ * @param data The new record.
+ * @return RC_OK, RC_RM_RECORD_NOT_EXIST, RC_IM_KEY_ALREADY_EXISTS if
+ *         another record has the new key, or an error code.
+ */
+RC clUpdate(CL_Tree *tree, RID rid, char *data) {
+    int keySize = tree->header.keySize, pos, leaf;
+    char key[keySize];
+    BM_PageHandle page;
+    RC rc;
+
+    if ((rc = recordKey(tree, data, key)) != RC_OK)
+        return rc;
+    if ((rc = findRow(tree, rid, &page, &pos)) != RC_OK)
+        return rc;
+    char *entry = entryAt(tree, page.data, pos);
+    if (memcmp(entry, key, keySize) == 0) {
+        memcpy(entry + keySize + sizeof(int), data, tree->header.recordSize);
+        markDirty(&tree->pool, &page);
+        unpinPage(&tree->pool, &page);
+        return RC_OK;
+    }
+    unpinPage(&tree->pool, &page);
+
+    // the new key must be free before the record leaves its place
+    if ((rc = findLeaf(tree, key, NULL, NULL, NULL, &leaf)) != RC_OK)
+        return rc;
+    if ((rc = pinPage(&tree->pool, &page, leaf)) != RC_OK)
+        return rc;
+    pos = searchLeaf(tree, page.data, key, false);
+    bool taken = pos < NODE(page.data)->count && memcmp(entryAt(tree, page.data, pos), key, keySize) == 0;
+    unpinPage(&tree->pool, &page);
+    if (taken)
+        return RC_IM_KEY_ALREADY_EXISTS;
+
+    if ((rc = findRow(tree, rid, &page, &pos)) != RC_OK)
+        return rc;
+    removeAt(tree, &page, pos);
+    return insertEntry(tree, key, rid.page, data);
+}
+
+// Delete a record
+RC clDelete(CL_Tree *tree, RID rid) {
+    BM_PageHandle page;
+    int pos;
+    RC rc;
+
+    if ((rc = findRow(tree, rid, &page, &pos)) != RC_OK)
+        return rc;
+    removeAt(tree, &page, pos);
+    tree->header.numTuples--;
+    return RC_OK;
+}
+
+// Copy the record with a RID into data
+RC clGet(CL_Tree *tree, RID rid, char *data) {
+    BM_PageHandle page;
+    int pos;
+    RC rc;
+
+    if ((rc = findRow(tree, rid, &page, &pos)) != RC_OK)
+        return rc;
+    memcpy(data, entryAt(tree, page.data, pos) + tree->header.keySize + sizeof(int), tree->header.recordSize);
+    unpinPage(&tree->pool, &page);
+    return RC_OK;
+}
+
+// clGetByKey
+/**
+ * Looks a record up by its key, reading only the nodes on the way to its
+ * leaf.
+ *
+ * @param tree The storage.
+ * @param keys One value per key attribute, in the order of Schema.keyAttrs.
+ * @param rid Receives the RID of the record.
+ * @param data Receives a copy of the record.
+ * @return RC_OK, RC_IM_KEY_NOT_FOUND, RC_INVALID_ARGS if a value has
+ *         another type than its attribute, or an error code.
+ */
+RC clGetByKey(CL_Tree *tree, Value **keys, RID *rid, char *data) {
+    Schema *schema = tree->schema;
+    int keySize = tree->header.keySize, offset = 0, leaf, pos, i;
+    char key[keySize];
+    BM_PageHandle page;
+    RC rc;
+
+    for (i = 0; i < schema->keySize; i++) {
+        int attr = schema->keyAttrs[i];
+        if (keys[i] == NULL || keys[i]->dt != schema->dataTypes[attr])
+            return RC_INVALID_ARGS;
+        // no stored string is longer than its attribute
+        if (keys[i]->dt == DT_STRING && strlen(keys[i]->v.stringV) > (size_t) schema->typeLength[attr])
+            return RC_IM_KEY_NOT_FOUND;
+        if ((rc = normalizeValue(keys[i], schema->typeLength[attr], key + offset)) != RC_OK)
+            return rc;
+        offset += normKeyAttrSize(schema->dataTypes[attr], schema->typeLength[attr]);
+    }
+
+    if ((rc = findLeaf(tree, key, NULL, NULL, NULL, &leaf)) != RC_OK)
+        return rc;
+    if ((rc = pinPage(&tree->pool, &page, leaf)) != RC_OK)
+        return rc;
+    pos = searchLeaf(tree, page.data, key, false);
+    if (pos == NODE(page.data)->count || memcmp(entryAt(tree, page.data, pos), key, keySize) != 0) {
+        unpinPage(&tree->pool, &page);
+        return RC_IM_KEY_NOT_FOUND;
+    }
+    rid->page = rowIdOf(tree, entryAt(tree, page.data, pos));
+    rid->slot = 0;
+    memcpy(data, entryAt(tree, page.data, pos) + keySize + sizeof(int), tree->header.recordSize);
+    unpinPage(&tree->pool, &page);
+    return RC_OK;
+}
+
+// Get the number of records
+int clNumTuples(CL_Tree *tree) {
+    return tree->header.numTuples;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Scans                                                                   */
+/* ---------------------------------------------------------------------- */
+
+// clOpenScan
+/**
+ * Starts a scan in key order at the first key the condition lets through.
+ *
+ * @param tree The storage.
+ * @param cond Condition of the scan, NULL for every record.
+ * @param scan Receives the scan; release it with clCloseScan.
+ * @return RC_OK, or an error code.
+ */
+RC clOpenScan(CL_Tree *tree, Expr *cond, CL_Scan **scan) {
+    Schema *schema = tree->schema;
+    int attr = schema->keyAttrs[0];
+    int size = normKeyAttrSize(schema->dataTypes[attr], schema->typeLength[attr]);
+    NK_Range range;
+    CL_Scan *s;
+    RC rc;
+
+    *scan = NULL;
+    s = (CL_Scan *) calloc(1, sizeof(CL_Scan));
+    if (s == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    s->tree = tree;
+    s->boundSize = size;
+    s->from = (char *) calloc(1, tree->header.keySize);
+    s->high = (char *) malloc(size);
+    if (s->from == NULL || s->high == NULL) {
+        clCloseScan(s);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    // a strict bound is kept as an inclusive one, the scan checks the rest
+    range.low = s->from;
+    range.high = s->high;
+    range.hasLow = range.hasHigh = false;
+    if (cond != NULL && (rc = normKeyRange(schema, attr, cond, &range)) != RC_OK) {
+        clCloseScan(s);
+        return rc;
+    }
+    // the lowest key with the low bound as its first attribute
+    s->fromIncluded = true;
+    if (!range.hasLow) {
+        free(s->from);
+        s->from = NULL;
+    }
+    if (!range.hasHigh) {
+        free(s->high);
+        s->high = NULL;
+    }
+    *scan = s;
+    return RC_OK;
+}
+
+// clNext
+/**
+ * Returns the next record of a scan. The scan finds its place again by the
+ * key it returned last, so records inserted, moved or deleted meanwhile do
+ * not throw it off.
+ *
+ * @param scan The scan.
+ * @param rid Receives the RID of the record.
+ * @param data Receives the record, valid until the next call.
+ * @return RC_OK, RC_RM_NO_MORE_TUPLES, or an error code.
+ */
+RC clNext(CL_Scan *scan, RID *rid, char **data) {
+    CL_Tree *t = scan->tree;
+    int keySize = t->header.keySize, leaf, pos;
+    RC rc;
+
+    if (scan->done)
+        return RC_RM_NO_MORE_TUPLES;
+    if (!scan->pinned) {
+        if ((rc = findLeaf(t, scan->from, NULL, NULL, NULL, &leaf)) != RC_OK)
+            return rc;
+        if ((rc = pinPageWithHint(&t->pool, &scan->page, leaf, BM_HINT_SCAN)) != RC_OK)
+            return rc;
+        scan->pinned = true;
+    }
+
+    while (true) {
+        CL_Node *node = NODE(scan->page.data);
+        pos = scan->from != NULL ? searchLeaf(t, scan->page.data, scan->from, !scan->fromIncluded) : 0;
+        if (pos < node->count)
+            break;
+        int next = node->next;
+        unpinPage(&t->pool, &scan->page);
+        scan->pinned = false;
+        if (next == -1) {
+            scan->done = true;
+            return RC_RM_NO_MORE_TUPLES;
+        }
+        if ((rc = pinPageWithHint(&t->pool, &scan->page, next, BM_HINT_SCAN)) != RC_OK)
+            return rc;
+        scan->pinned = true;
+    }
+
+    char *entry = entryAt(t, scan->page.data, pos);
+    if (scan->high != NULL && memcmp(entry, scan->high, scan->boundSize) > 0) {
+        unpinPage(&t->pool, &scan->page);
+        scan->pinned = false;
+        scan->done = true;
+        return RC_RM_NO_MORE_TUPLES;
+    }
+    if (scan->from == NULL && (scan->from = (char *) malloc(keySize)) == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    memcpy(scan->from, entry, keySize);
+    scan->fromIncluded = false;
+    rid->page = rowIdOf(t, entry);
+    rid->slot = 0;
+    *data = entry + keySize + sizeof(int);
+    return RC_OK;
+}
+
+// Release a scan
+RC clCloseScan(CL_Scan *scan) {
+    if (scan->pinned)
+        unpinPage(&scan->tree->pool, &scan->page);
+    free(scan->from);
+    free(scan->high);
+    free(scan);
+    return RC_OK;
+}
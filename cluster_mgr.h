@@ -0,0 +1,53 @@
+#ifndef CLUSTER_MGR_H
+#define CLUSTER_MGR_H
+
+#include "dberror.h"
+#include "expr.h"
+#include "tables.h"
+
+// Clustered storage of the records of an RM_ENGINE_CLUSTERED table
+//
+// The records live in the leaves of a B+-tree keyed on the key attributes
+// of the schema (Schema.keyAttrs), in key order, instead of in slotted pages
+// next to a separate index. A lookup by key descends the tree and reads the
+// record from the leaf it ends in, and a scan whose condition bounds the
+// first key attribute reads just the leaves in that range, one after the
+// other. Keys are unique.
+//
+// Records move between leaves when a leaf splits, so their RIDs are not
+// positions: every record gets a row id when it is inserted, kept by
+// updates, and its RID is (row id, 0). A row map from row id to the leaf
+// holding the record serves RID lookups.
+//
+// File of table <name>: <name>.clu.
+
+typedef struct CL_Tree CL_Tree;
+typedef struct CL_Scan CL_Scan;
+
+// create, open, close, and destroy the storage of a table
+extern RC clCreate (char *name, Schema *schema);
+extern rm_bool clExists (char *name);
+extern RC clOpen (char *name, Schema *schema, CL_Tree **tree);
+extern RC clClose (CL_Tree *tree);
+extern RC clDestroy (char *name);
+
+// remove every record at once, leaving one empty leaf; no scan may be open
+extern RC clTruncate (CL_Tree *tree);
+
+// records; clGet and clGetByKey copy the record into data, clGetByKey takes
+// one value per key attribute
+extern RC clInsert (CL_Tree *tree, char *data, RID *rid);
+extern RC clUpdate (CL_Tree *tree, RID rid, char *data);
+extern RC clDelete (CL_Tree *tree, RID rid);
+extern RC clGet (CL_Tree *tree, RID rid, char *data);
+extern RC clGetByKey (CL_Tree *tree, Value **keys, RID *rid, char *data);
+extern int clNumTuples (CL_Tree *tree);
+
+// scans return the records in key order, only reading the leaves in the
+// range cond puts on the first key attribute (NULL for every record); the
+// records returned may still fail cond. data stays valid until the next call
+extern RC clOpenScan (CL_Tree *tree, Expr *cond, CL_Scan **scan);
+extern RC clNext (CL_Scan *scan, RID *rid, char **data);
+extern RC clCloseScan (CL_Scan *scan);
+
+#endif // CLUSTER_MGR_H
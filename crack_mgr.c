@@ -0,0 +1,523 @@
+#include "crack_mgr.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cracker index
+//
+// The cracker array holds one (value, RID) entry per record, the value as
+// a double, which holds every INT and FLOAT exactly. A crack is a bound
+// and a position: the entries before the position are below the bound and
+// the others are not, where an entry is below (v, orEqual) if its value is
+// smaller than v, or equal to it with orEqual. The cracks are kept sorted
+// by bound, which also sorts them by position; the entries between two
+// neighbouring cracks are a piece, unordered inside.
+//
+// A query turns its range into a lower and an upper bound and looks up the
+// position of each. A bound that is no crack yet splits the piece it falls
+// into in one pass over the piece and becomes a crack; the answer is the
+// entries between the two positions.
+//
+// Inserts and deletes keep the pieces in place by rippling: an insert
+// makes room at the end of its piece by moving the first entry of every
+// later piece to the end of that piece, from the last piece down, and a
+// delete fills its hole the other way round. Both cost one move per later
+// piece, and none before the first query.
+
+// Bound of a crack or a range; see above for which values are below it
+typedef struct CK_Bound {
+    double value;
+    bool orEqual;
+} CK_Bound;
+
+typedef struct CK_Entry {
+    double value;
+    RID rid;
+} CK_Entry;
+
+typedef struct CK_Crack {
+    CK_Bound bound;
+    int pos;        // first entry not below the bound
+} CK_Crack;
+
+// Values a query selects: not below low, and below high
+typedef struct CK_Range {
+    CK_Bound low;
+    CK_Bound high;
+} CK_Range;
+
+typedef struct CK_IndexMgmt {
+    int offset;             // of the attribute in a stored record
+    bool loaded;            // the array holds the table
+    int numEntries;
+    int capacity;
+    CK_Entry *entries;
+    int numCracks;
+    int crackCapacity;
+    CK_Crack *cracks;       // sorted by bound
+    int numTouched;
+} CK_IndexMgmt;
+
+#define INDEX_MGMT(index) ((CK_IndexMgmt *) (index)->mgmtData)
+
+static RC ckInsert(void *index, Record *record);
+static RC ckRemove(void *index, Record *record);
+static RC ckCandidates(void *index, Expr *cond, RID **rids, int *numRids, bool *exact);
+
+static RM_IndexHooks ckHooks = { ckInsert, ckRemove, ckCandidates };
+
+/* ---------------------------------------------------------------------- */
+/* Cracker array                                                           */
+/* ---------------------------------------------------------------------- */
+
+static int compareBounds(CK_Bound a, CK_Bound b) {
+    if (a.value != b.value)
+        return a.value < b.value ? -1 : 1;
+    return a.orEqual - b.orEqual;
+}
+
+static bool isBelow(double value, CK_Bound b) {
+    return value < b.value || (b.orEqual && value == b.value);
+}
+
+// Read the attribute of a stored record
+static double valueOf(CK_IndexHandle *index, const char *data) {
+    CK_IndexMgmt *m = INDEX_MGMT(index);
+    float f;
+    int i;
+
+    if (index->keyType == DT_FLOAT) {
+        memcpy(&f, data + m->offset, sizeof(float));
+        return f;
+    }
+    memcpy(&i, data + m->offset, sizeof(int));
+    return i;
+}
+
+// The piece a value belongs to: the index of the first crack it is below
+static int pieceOf(CK_IndexMgmt *m, double value) {
+    int lo = 0, hi = m->numCracks;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (isBelow(value, m->cracks[mid].bound))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+static int pieceStart(CK_IndexMgmt *m, int piece) {
+    return piece > 0 ? m->cracks[piece - 1].pos : 0;
+}
+
+static int pieceEnd(CK_IndexMgmt *m, int piece) {
+    return piece < m->numCracks ? m->cracks[piece].pos : m->numEntries;
+}
+
+// Add an entry, rippling the later pieces up by one
+static RC addEntry(CK_IndexMgmt *m, double value, RID rid) {
+    int piece = pieceOf(m, value), hole, i;
+
+    if (m->numEntries == m->capacity) {
+        int capacity = m->capacity > 0 ? 2 * m->capacity : 64;
+        CK_Entry *grown = (CK_Entry *) realloc(m->entries, capacity * sizeof(CK_Entry));
+        if (grown == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        m->entries = grown;
+        m->capacity = capacity;
+    }
+    hole = m->numEntries++;
+    for (i = m->numCracks - 1; i >= piece; i--) {
+        m->entries[hole] = m->entries[m->cracks[i].pos];
+        hole = m->cracks[i].pos++;
+    }
+    m->entries[hole].value = value;
+    m->entries[hole].rid = rid;
+    return RC_OK;
+}
+
+// Remove the entry of a record, rippling the later pieces down by one
+static void removeEntry(CK_IndexMgmt *m, double value, RID rid) {
+    int piece = pieceOf(m, value);
+    int end = pieceEnd(m, piece), hole, i;
+
+    for (hole = pieceStart(m, piece); hole < end; hole++)
+        if (m->entries[hole].rid.page == rid.page && m->entries[hole].rid.slot == rid.slot)
+            break;
+    if (hole == end)
+        return;
+    m->entries[hole] = m->entries[end - 1];
+    hole = end - 1;
+    for (i = piece; i < m->numCracks; i++) {
+        m->cracks[i].pos--;
+        end = pieceEnd(m, i + 1);
+        m->entries[hole] = m->entries[end - 1];
+        hole = end - 1;
+    }
+    m->numEntries--;
+}
+
+// crackAt
+/**
+ * Finds the position of a bound in the array, splitting the piece it falls
+ * into if it is no crack yet.
+ *
+ * @param m The index.
+ * @param b The bound.
+ * @param pos Receives the position of the first entry not below b.
+ * @return RC_OK, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC crackAt(CK_IndexMgmt *m, CK_Bound b, int *pos) {
+    int lo = 0, hi = m->numCracks, i, j;
+
+    // the ends of the array need no crack
+    if (b.value == -INFINITY && !b.orEqual) {
+        *pos = 0;
+        return RC_OK;
+    }
+    if (b.value == INFINITY && b.orEqual) {
+        *pos = m->numEntries;
+        return RC_OK;
+    }
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (compareBounds(m->cracks[mid].bound, b) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < m->numCracks && compareBounds(m->cracks[lo].bound, b) == 0) {
+        *pos = m->cracks[lo].pos;
+        return RC_OK;
+    }
+    if (m->numCracks == m->crackCapacity) {
+        int capacity = m->crackCapacity > 0 ? 2 * m->crackCapacity : 16;
+        CK_Crack *grown = (CK_Crack *) realloc(m->cracks, capacity * sizeof(CK_Crack));
+        if (grown == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        m->cracks = grown;
+        m->crackCapacity = capacity;
+    }
+
+    // partition the piece: entries below b to the front
+    i = pieceStart(m, lo);
+    j = pieceEnd(m, lo) - 1;
+    m->numTouched += j - i + 1;
+    while (i <= j) {
+        if (isBelow(m->entries[i].value, b)) {
+            i++;
+        } else if (!isBelow(m->entries[j].value, b)) {
+            j--;
+        } else {
+            CK_Entry swap = m->entries[i];
+            m->entries[i++] = m->entries[j];
+            m->entries[j--] = swap;
+        }
+    }
+
+    memmove(m->cracks + lo + 1, m->cracks + lo, (m->numCracks - lo) * sizeof(CK_Crack));
+    m->cracks[lo].bound = b;
+    m->cracks[lo].pos = i;
+    m->numCracks++;
+    *pos = i;
+    return RC_OK;
+}
+
+// loadColumn
+/**
+ * Copies the attribute of every record of the table into the array, as
+ * the first query does.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC loadColumn(CK_IndexHandle *index) {
+    CK_IndexMgmt *m = INDEX_MGMT(index);
+    RM_ScanHandle scan;
+    Record record;
+    RC rc;
+
+    if ((rc = startScan(index->rel, &scan, NULL)) != RC_OK)
+        return rc;
+    record.data = NULL;
+    while ((rc = next(&scan, &record)) == RC_OK)
+        if ((rc = addEntry(m, valueOf(index, record.data), record.id)) != RC_OK)
+            break;
+    closeScan(&scan);
+    free(record.data);
+    if (rc != RC_RM_NO_MORE_TUPLES) {
+        m->numEntries = 0;
+        return rc;
+    }
+    m->loaded = true;
+    return RC_OK;
+}
+
+// ckInsert
+/**
+ * Adds a record to the array, the hook called by the record manager after
+ * an insert or update.
+ *
+ * @return RC_OK, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC ckInsert(void *idx, Record *record) {
+    CK_IndexHandle *index = (CK_IndexHandle *) idx;
+    CK_IndexMgmt *m = INDEX_MGMT(index);
+
+    if (!m->loaded)
+        return RC_OK;
+    return addEntry(m, valueOf(index, record->data), record->id);
+}
+
+// ckRemove
+/**
+ * Removes a record from the array, the hook called before a delete or
+ * update.
+ *
+ * @return RC_OK.
+ */
+static RC ckRemove(void *idx, Record *record) {
+    CK_IndexHandle *index = (CK_IndexHandle *) idx;
+    CK_IndexMgmt *m = INDEX_MGMT(index);
+
+    if (m->loaded)
+        removeEntry(m, valueOf(index, record->data), record->id);
+    return RC_OK;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Conditions                                                              */
+/* ---------------------------------------------------------------------- */
+
+// comparisonRange
+/**
+ * Turns attr = constant, attr < constant or constant < attr on the indexed
+ * attribute, or the negation of one of the two orderings, into a range.
+ *
+ * @param negated Whether the comparison is under a NOT.
+ * @param r Receives the range.
+ * @return Whether the comparison is a range on the attribute.
+ */
+static bool comparisonRange(CK_IndexHandle *index, Operator *op, bool negated, CK_Range *r) {
+    Expr *left = op->args[0], *right = op->args[1];
+    Value *cons;
+    bool consFirst;
+    double c;
+
+    if (left->type == EXPR_ATTRREF && right->type == EXPR_CONST) {
+        if (left->expr.attrRef != index->attrNum)
+            return false;
+        cons = right->expr.cons;
+        consFirst = false;
+    } else if (left->type == EXPR_CONST && right->type == EXPR_ATTRREF) {
+        if (right->expr.attrRef != index->attrNum)
+            return false;
+        cons = left->expr.cons;
+        consFirst = true;
+    } else {
+        return false;
+    }
+    if (cons->dt != index->keyType)
+        return false;
+    c = index->keyType == DT_FLOAT ? cons->v.floatV : cons->v.intV;
+
+    r->low.value = -INFINITY;
+    r->low.orEqual = false;
+    r->high.value = INFINITY;
+    r->high.orEqual = true;
+    if (op->type == OP_COMP_EQUAL) {
+        if (negated)
+            return false;
+        r->low.value = r->high.value = c;
+    } else if (consFirst == negated) {
+        r->high.value = c;                      // attr < c, or NOT (c < attr)
+        r->high.orEqual = negated;
+    } else {
+        r->low.value = c;                       // c < attr, or NOT (attr < c)
+        r->low.orEqual = !negated;
+    }
+
+    // over INT, below (c, orEqual) is below (c + 1): ranges written either way share their cracks
+    if (index->keyType == DT_INT) {
+        if (r->low.orEqual) {
+            r->low.value++;
+            r->low.orEqual = false;
+        }
+        if (r->high.orEqual && r->high.value != INFINITY) {
+            r->high.value++;
+            r->high.orEqual = false;
+        }
+    }
+    return true;
+}
+
+// conditionRange
+/**
+ * Finds a range on the indexed attribute that holds every record matching
+ * a condition: a comparison, a NOT, or an AND, read as an OR under a NOT.
+ *
+ * @param negated Whether the condition is under a NOT.
+ * @param r Receives the range.
+ * @param exact Receives whether the range holds only matching records.
+ * @return Whether the condition puts a range on the attribute.
+ */
+static bool conditionRange(CK_IndexHandle *index, Expr *cond, bool negated, CK_Range *r, bool *exact) {
+    CK_Range a, b;
+    bool exactA, exactB, hasA, hasB;
+    Operator *op;
+
+    *exact = false;
+    if (cond->type != EXPR_OP)
+        return false;
+    op = cond->expr.op;
+
+    switch (op->type) {
+    case OP_COMP_EQUAL:
+    case OP_COMP_SMALLER:
+        *exact = comparisonRange(index, op, negated, r);
+        return *exact;
+    case OP_BOOL_NOT:
+        return conditionRange(index, op->args[0], !negated, r, exact);
+    case OP_BOOL_AND:
+    case OP_BOOL_OR:
+        if ((op->type == OP_BOOL_AND) == negated)
+            return false;
+        hasA = conditionRange(index, op->args[0], negated, &a, &exactA);
+        hasB = conditionRange(index, op->args[1], negated, &b, &exactB);
+        if (hasA && hasB) {
+            r->low = compareBounds(a.low, b.low) > 0 ? a.low : b.low;
+            r->high = compareBounds(a.high, b.high) < 0 ? a.high : b.high;
+            *exact = exactA && exactB;
+        } else if (hasA || hasB) {
+            // the side off the attribute only narrows the result further
+            *r = hasA ? a : b;
+        }
+        return hasA || hasB;
+    default:
+        return false;
+    }
+}
+
+static int compareRids(const void *a, const void *b) {
+    const RID *x = (const RID *) a, *y = (const RID *) b;
+
+    if (x->page != y->page)
+        return x->page < y->page ? -1 : 1;
+    return x->slot < y->slot ? -1 : x->slot > y->slot;
+}
+
+// ckCandidates
+/**
+ * Lists the records in the range a scan condition puts on the attribute,
+ * cracking the array at its ends; the hook the record manager calls when
+ * a scan starts.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC ckCandidates(void *idx, Expr *cond, RID **rids, int *numRids, bool *exact) {
+    CK_IndexHandle *index = (CK_IndexHandle *) idx;
+    CK_IndexMgmt *m = INDEX_MGMT(index);
+    CK_Range r;
+    int first = 0, last = 0, i;
+    RC rc;
+
+    *rids = NULL;
+    if (!conditionRange(index, cond, false, &r, exact))
+        return RC_OK;
+    if (!m->loaded && (rc = loadColumn(index)) != RC_OK)
+        return rc;
+    if (compareBounds(r.low, r.high) < 0) {
+        if ((rc = crackAt(m, r.low, &first)) != RC_OK || (rc = crackAt(m, r.high, &last)) != RC_OK)
+            return rc;
+    }
+
+    *rids = (RID *) malloc((last - first + 1) * sizeof(RID));
+    if (*rids == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (i = first; i < last; i++)
+        (*rids)[i - first] = m->entries[i].rid;
+    *numRids = last - first;
+    qsort(*rids, *numRids, sizeof(RID), compareRids);
+    return RC_OK;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Interface                                                               */
+/* ---------------------------------------------------------------------- */
+
+// openCrackerIndex
+/**
+ * Opens a cracker index on an attribute and attaches it to its table; the
+ * array is built by the first scan that uses it.
+ *
+ * @param index Receives the handle; release it with closeCrackerIndex
+ *        before closing the table.
+ * @param rel The open table.
+ * @param attrNum The attribute.
+ * @return RC_OK, RC_INVALID_ATTR_NUM, RC_RM_UNKNOWN_DATATYPE for an
+ *         attribute other than INT and FLOAT, or an error code.
+ */
+RC openCrackerIndex(CK_IndexHandle **index, RM_TableData *rel, int attrNum) {
+    CK_IndexHandle *handle;
+    CK_IndexMgmt *m;
+    Schema *schema;
+    RC rc;
+
+    *index = NULL;
+    if (rel == NULL || rel->schema == NULL)
+        return RC_NULL_POINTER;
+    schema = rel->schema;
+    if (attrNum < 0 || attrNum >= schema->numAttr)
+        return RC_INVALID_ATTR_NUM;
+    if (schema->dataTypes[attrNum] != DT_INT && schema->dataTypes[attrNum] != DT_FLOAT)
+        return RC_RM_UNKNOWN_DATATYPE;
+
+    handle = (CK_IndexHandle *) malloc(sizeof(CK_IndexHandle));
+    m = (CK_IndexMgmt *) calloc(1, sizeof(CK_IndexMgmt));
+    if (handle == NULL || m == NULL) {
+        free(handle);
+        free(m);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    attrOffset(schema, attrNum, &m->offset);
+    handle->rel = rel;
+    handle->attrNum = attrNum;
+    handle->keyType = schema->dataTypes[attrNum];
+    handle->mgmtData = m;
+
+    if ((rc = attachIndex(rel, &ckHooks, handle)) != RC_OK) {
+        free(m);
+        free(handle);
+        return rc;
+    }
+    *index = handle;
+    return RC_OK;
+}
+
+// Detach an index from its table and drop its array
+RC closeCrackerIndex(CK_IndexHandle *index) {
+    CK_IndexMgmt *m = INDEX_MGMT(index);
+
+    detachIndex(index->rel, index);
+    free(m->entries);
+    free(m->cracks);
+    free(m);
+    free(index);
+    return RC_OK;
+}
+
+// Get the number of pieces of the array
+RC getCKNumPieces(CK_IndexHandle *index, int *result) {
+    CK_IndexMgmt *m = INDEX_MGMT(index);
+
+    *result = m->loaded ? m->numCracks + 1 : 0;
+    return RC_OK;
+}
+
+// Get the number of entries partitioned so far
+RC getCKNumTouched(CK_IndexHandle *index, int *result) {
+    *result = INDEX_MGMT(index)->numTouched;
+    return RC_OK;
+}
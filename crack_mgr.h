@@ -0,0 +1,46 @@
+#ifndef CRACK_MGR_H
+#define CRACK_MGR_H
+
+#include "dberror.h"
+#include "expr.h"
+#include "record_mgr.h"
+#include "tables.h"
+
+// Adaptive index (database cracking) over an INT or FLOAT attribute
+//
+// Opening a cracker index builds nothing. The first scan whose condition
+// puts a range on the attribute copies the attribute of every record into
+// a cracker array of (value, RID) pairs, and partitions the array around
+// the two ends of the range; the records in range are then one contiguous
+// run. Every later range query partitions only the pieces its ends fall
+// into, so the array gets more ordered with each query and queries touch
+// less and less of it. Over a series of ad-hoc ranges on an attribute
+// nobody indexed, scans approach the speed of a sorted index without an
+// upfront build.
+//
+// Conditions the index answers are comparisons between the attribute and a
+// constant of its type (=, <, and NOT of them) and ANDs of those; an AND
+// with other parts narrows the scan to the range, and the scan checks the
+// rest. An open index is attached to its table (see attachIndex), which
+// keeps the array up to date. The array lives in memory only and is gone
+// when the index is closed.
+
+// structure for accessing cracker indexes
+typedef struct CK_IndexHandle {
+  RM_TableData *rel;
+  int attrNum;
+  DataType keyType;
+  void *mgmtData;
+} CK_IndexHandle;
+
+// open a cracker index over attribute attrNum of an open table, and close it
+extern RC openCrackerIndex (CK_IndexHandle **index, RM_TableData *rel, int attrNum);
+extern RC closeCrackerIndex (CK_IndexHandle *index);
+
+// access information about an index; pieces are the runs of the array the
+// queries have split it into so far (0 before the first query), touched is
+// the number of array entries the queries have partitioned
+extern RC getCKNumPieces (CK_IndexHandle *index, int *result);
+extern RC getCKNumTouched (CK_IndexHandle *index, int *result);
+
+#endif // CRACK_MGR_H
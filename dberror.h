@@ -42,6 +42,7 @@ typedef int RC;
 #define RC_DELIMITER_NOT_FOUND 19
 #define RC_ERROR 20 
 #define RC_FILE_DESTROY_FAILED 21
+#define RC_PAGE_PINNED 22
 
 #define RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE 200
 #define RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN 201
@@ -51,6 +52,7 @@ typedef int RC;
 #define RC_RM_UNKOWN_DATATYPE 205
 #define RC_MEM_ALLOCATION_FAIL 206
 #define RC_RM_RECORD_NOT_EXIST 207
+#define RC_RM_CODEGEN_FAILED 208
 
 #define RC_IM_KEY_NOT_FOUND 300
 #define RC_IM_KEY_ALREADY_EXISTS 301
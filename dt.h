@@ -1,9 +1,13 @@
 #ifndef DT_H
 #define DT_H
 
-// define bool if not defined
-#ifndef bool
-    typedef short bool;
+// bool of the public headers: a short in C and in C++ alike, so structs,
+// arrays and callbacks holding one have the same layout on both sides
+typedef short rm_bool;
+
+// define bool if not defined; C++ keeps its own one-byte bool
+#if !defined(bool) && !defined(__cplusplus)
+    typedef rm_bool bool;
 #define true 1
 #define false 0
 #endif
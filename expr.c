@@ -74,6 +74,7 @@ boolAnd (Value *left, Value *right, Value *result)
 {
 	if (left->dt != DT_BOOL || right->dt != DT_BOOL)
 		THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean AND requires boolean inputs");
+	result->dt = DT_BOOL;
 	result->v.boolV = (left->v.boolV && right->v.boolV);
 
 	return RC_OK;
@@ -84,6 +85,7 @@ boolOr (Value *left, Value *right, Value *result)
 {
 	if (left->dt != DT_BOOL || right->dt != DT_BOOL)
 		THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean OR requires boolean inputs");
+	result->dt = DT_BOOL;
 	result->v.boolV = (left->v.boolV || right->v.boolV);
 
 	return RC_OK;
@@ -0,0 +1,446 @@
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dberror.h"
+#include "expr.h"
+#include "expr_codegen.h"
+#include "tables.h"
+
+// Code generation for scan predicates, see expr_codegen.h.
+//
+// The generated function is self-contained: it only includes <string.h>
+// and repeats the ExprParam union, so it builds without this source tree.
+// Attributes are read with memcpy at offsets fixed at generation time,
+// strings are compared within their typeLength the way getAttr and
+// valueEquals/valueSmaller see them.
+
+/************************************************************
+ *                    string builder                        *
+ ************************************************************/
+
+typedef struct StrBuf {
+	char *buf;
+	int len;
+	int cap;
+} StrBuf;
+
+static void
+sbInit (StrBuf *sb)
+{
+	sb->cap = 256;
+	sb->len = 0;
+	sb->buf = (char *) malloc(sb->cap);
+	sb->buf[0] = '\0';
+}
+
+static void
+sbAppend (StrBuf *sb, const char *format, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, format);
+	n = vsnprintf(sb->buf + sb->len, sb->cap - sb->len, format, args);
+	va_end(args);
+
+	if (sb->len + n >= sb->cap)
+	{
+		while (sb->len + n >= sb->cap)
+			sb->cap *= 2;
+		sb->buf = (char *) realloc(sb->buf, sb->cap);
+		va_start(args, format);
+		vsnprintf(sb->buf + sb->len, sb->cap - sb->len, format, args);
+		va_end(args);
+	}
+	sb->len += n;
+}
+
+/************************************************************
+ *                    code generation                       *
+ ************************************************************/
+
+static const char *filterPrelude =
+	"#include <string.h>\n"
+	"typedef union ExprParam { int intV; float floatV; short boolV; const char *stringV; } ExprParam;\n"
+	"static int ldI (const char *p) { int v; memcpy(&v, p, sizeof(v)); return v; }\n"
+	"static float ldF (const char *p) { float v; memcpy(&v, p, sizeof(v)); return v; }\n"
+	"static short ldB (const char *p) { short v; memcpy(&v, p, sizeof(v)); return v; }\n"
+	"static int cmpStr (const char *a, int na, const char *b, int nb)\n"
+	"{\n"
+	"\tint i;\n"
+	"\tfor (i = 0; ; i++) {\n"
+	"\t\tint ca = (i < na) ? (unsigned char) a[i] : 0;\n"
+	"\t\tint cb = (i < nb) ? (unsigned char) b[i] : 0;\n"
+	"\t\tif (ca != cb) return ca - cb;\n"
+	"\t\tif (ca == 0) return 0;\n"
+	"\t}\n"
+	"}\n"
+	"int exprFilter (const char *page, int numTuples, int tupleBytes, const ExprParam *p, char *matches)\n"
+	"{\n"
+	"\tint i, n = 0;\n"
+	"\tfor (i = 0; i < numTuples; i++) {\n"
+	"\t\tconst char *t = page + i * tupleBytes;\n"
+	"\t\tconst char *r = t + sizeof(short);\n"
+	"\t\tmatches[i] = ldB(t) && (%s);\n"
+	"\t\tn += matches[i];\n"
+	"\t}\n"
+	"\treturn n;\n"
+	"}\n";
+
+// Emit the C expression for expr into code and its shape into key. String
+// operands are emitted as a "pointer, length" pair for cmpStr.
+static RC
+emitExpr (Expr *expr, Schema *schema, StrBuf *code, StrBuf *key, int *nextParam, DataType *type)
+{
+	switch (expr->type)
+	{
+	case EXPR_ATTRREF:
+	{
+		int attr = expr->expr.attrRef;
+		int offset;
+
+		if (attr < 0 || attr >= schema->numAttr)
+			return RC_INVALID_ATTR_NUM;
+		attrOffset(schema, attr, &offset);
+		*type = schema->dataTypes[attr];
+		sbAppend(key, "a%i.%i.%i", *type, offset, schema->typeLength[attr]);
+		switch (*type)
+		{
+		case DT_INT:
+			sbAppend(code, "ldI(r + %i)", offset);
+			break;
+		case DT_FLOAT:
+			sbAppend(code, "ldF(r + %i)", offset);
+			break;
+		case DT_BOOL:
+			sbAppend(code, "ldB(r + %i)", offset);
+			break;
+		case DT_STRING:
+			sbAppend(code, "r + %i, %i", offset, schema->typeLength[attr]);
+			break;
+		}
+		return RC_OK;
+	}
+	case EXPR_CONST:
+	{
+		int param = (*nextParam)++;
+
+		if (param >= EXPR_MAX_PARAMS)
+			return RC_RM_CODEGEN_FAILED;
+		*type = expr->expr.cons->dt;
+		sbAppend(key, "c%i", *type);
+		switch (*type)
+		{
+		case DT_INT:
+			sbAppend(code, "p[%i].intV", param);
+			break;
+		case DT_FLOAT:
+			sbAppend(code, "p[%i].floatV", param);
+			break;
+		case DT_BOOL:
+			sbAppend(code, "p[%i].boolV", param);
+			break;
+		case DT_STRING:
+			sbAppend(code, "p[%i].stringV, 0x7fffffff", param);
+			break;
+		}
+		return RC_OK;
+	}
+	case EXPR_OP:
+	{
+		Operator *op = expr->expr.op;
+		DataType left, right;
+		RC rc;
+
+		*type = DT_BOOL;
+		sbAppend(key, "(%i ", op->type);
+		switch (op->type)
+		{
+		case OP_BOOL_NOT:
+			sbAppend(code, "!(");
+			if ((rc = emitExpr(op->args[0], schema, code, key, nextParam, &left)) != RC_OK)
+				return rc;
+			if (left != DT_BOOL)
+				return RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN;
+			sbAppend(code, ")");
+			break;
+		case OP_BOOL_AND:
+		case OP_BOOL_OR:
+			sbAppend(code, "((");
+			if ((rc = emitExpr(op->args[0], schema, code, key, nextParam, &left)) != RC_OK)
+				return rc;
+			sbAppend(code, (op->type == OP_BOOL_AND) ? ") && (" : ") || (");
+			if ((rc = emitExpr(op->args[1], schema, code, key, nextParam, &right)) != RC_OK)
+				return rc;
+			sbAppend(code, "))");
+			if (left != DT_BOOL || right != DT_BOOL)
+				return RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN;
+			break;
+		case OP_COMP_EQUAL:
+		case OP_COMP_SMALLER:
+		{
+			StrBuf l, r;
+			sbInit(&l);
+			sbInit(&r);
+			rc = emitExpr(op->args[0], schema, &l, key, nextParam, &left);
+			if (rc == RC_OK)
+				rc = emitExpr(op->args[1], schema, &r, key, nextParam, &right);
+			if (rc == RC_OK && left != right)
+				rc = RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+			if (rc == RC_OK)
+			{
+				const char *cmp = (op->type == OP_COMP_EQUAL) ? "==" : "<";
+				if (left == DT_STRING)
+					sbAppend(code, "(cmpStr(%s, %s) %s 0)", l.buf, r.buf, cmp);
+				else
+					sbAppend(code, "((%s) %s (%s))", l.buf, cmp, r.buf);
+			}
+			free(l.buf);
+			free(r.buf);
+			if (rc != RC_OK)
+				return rc;
+			break;
+		}
+		default:
+			return RC_RM_CODEGEN_FAILED;
+		}
+		sbAppend(key, ")");
+		return RC_OK;
+	}
+	}
+	return RC_RM_CODEGEN_FAILED;
+}
+
+// Build source into a shared object and load its exprFilter
+static RC
+buildFilter (const char *source, void **handle, ExprPageFilter *filter)
+{
+	char dir[] = "/tmp/rmexprXXXXXX";
+	char srcPath[64], soPath[64], *command;
+	const char *cc = getenv("CC");
+	FILE *f;
+	int status;
+
+	if (cc == NULL || *cc == '\0')
+		cc = "cc";
+	if (mkdtemp(dir) == NULL)
+		return RC_RM_CODEGEN_FAILED;
+	sprintf(srcPath, "%s/filter.c", dir);
+	sprintf(soPath, "%s/filter.so", dir);
+
+	f = fopen(srcPath, "w");
+	if (f == NULL)
+	{
+		rmdir(dir);
+		return RC_RM_CODEGEN_FAILED;
+	}
+	fputs(source, f);
+	fclose(f);
+
+	command = (char *) malloc(strlen(cc) + 2 * sizeof(soPath) + 64);
+	sprintf(command, "%s -O2 -shared -fPIC -o %s %s 2>/dev/null", cc, soPath, srcPath);
+	status = system(command);
+	free(command);
+
+	*handle = (status == 0) ? dlopen(soPath, RTLD_NOW | RTLD_LOCAL) : NULL;
+	*filter = (*handle != NULL) ? (ExprPageFilter) dlsym(*handle, "exprFilter") : NULL;
+
+	// the loaded object stays mapped after its file is gone
+	unlink(srcPath);
+	unlink(soPath);
+	rmdir(dir);
+
+	if (*filter == NULL)
+	{
+		if (*handle != NULL)
+			dlclose(*handle);
+		return RC_RM_CODEGEN_FAILED;
+	}
+	return RC_OK;
+}
+
+/************************************************************
+ *                    filter cache                          *
+ ************************************************************/
+
+typedef struct FilterCacheEntry {
+	char *key;
+	void *handle;
+	ExprPageFilter filter;	// NULL for a shape that failed to compile
+	struct FilterCacheEntry *next;
+} FilterCacheEntry;
+
+static FilterCacheEntry *filterCache = NULL;
+static pthread_mutex_t filterCacheLatch = PTHREAD_MUTEX_INITIALIZER;
+
+// Cache entry of a condition shape, or NULL; the caller holds filterCacheLatch
+static FilterCacheEntry *
+findFilter (const char *key)
+{
+	FilterCacheEntry *entry;
+
+	for (entry = filterCache; entry != NULL; entry = entry->next)
+		if (strcmp(entry->key, key) == 0)
+			break;
+	return entry;
+}
+
+// compileExprFilter
+/**
+ * Returns a native filter for a scan condition, generating and compiling it unless a filter for a condition of
+ * the same shape (same operators, attributes and constant types) was built before. The compiler runs outside the
+ * cache latch, and a shape it failed on is remembered, so it is not run again for that shape.
+ * @param expr The condition; must evaluate to a boolean.
+ * @param schema Schema of the records the condition is applied to.
+ * @param filter Set to the filter function.
+ * @return RC_OK, the type error evalExpr would report, or RC_RM_CODEGEN_FAILED if no compiler is available.
+ */
+RC
+compileExprFilter (Expr *expr, Schema *schema, ExprPageFilter *filter)
+{
+	FilterCacheEntry *entry;
+	StrBuf code, key;
+	DataType type;
+	int numParams = 0;
+	bool cached;
+	RC rc;
+
+	if (expr == NULL || schema == NULL || filter == NULL)
+		return RC_NULL_POINTER;
+
+	sbInit(&code);
+	sbInit(&key);
+	rc = emitExpr(expr, schema, &code, &key, &numParams, &type);
+	if (rc == RC_OK && type != DT_BOOL)
+		rc = RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN;
+	if (rc != RC_OK)
+	{
+		free(code.buf);
+		free(key.buf);
+		return rc;
+	}
+
+	pthread_mutex_lock(&filterCacheLatch);
+	entry = findFilter(key.buf);
+	if (entry != NULL)
+		*filter = entry->filter;
+	pthread_mutex_unlock(&filterCacheLatch);
+
+	if (entry == NULL)
+	{
+		StrBuf source;
+		void *handle = NULL;
+		ExprPageFilter built = NULL;
+
+		sbInit(&source);
+		sbAppend(&source, filterPrelude, code.buf);
+		if (buildFilter(source.buf, &handle, &built) != RC_OK)
+			handle = NULL;
+		free(source.buf);
+
+		// another scan may have built the same shape meanwhile
+		pthread_mutex_lock(&filterCacheLatch);
+		entry = findFilter(key.buf);
+		cached = entry == NULL;
+		if (cached)
+		{
+			entry = (FilterCacheEntry *) malloc(sizeof(FilterCacheEntry));
+			entry->key = key.buf;
+			key.buf = NULL;
+			entry->handle = handle;
+			entry->filter = built;
+			entry->next = filterCache;
+			filterCache = entry;
+		}
+		*filter = entry->filter;
+		pthread_mutex_unlock(&filterCacheLatch);
+
+		if (!cached && handle != NULL)
+			dlclose(handle);
+	}
+	rc = (*filter != NULL) ? RC_OK : RC_RM_CODEGEN_FAILED;
+
+	free(code.buf);
+	free(key.buf);
+	return rc;
+}
+
+// getExprParams
+/**
+ * Lists the constants of a condition in the order its compiled filter expects them.
+ * String parameters point into the condition, which must outlive their use.
+ * @param expr The condition.
+ * @param params Array receiving the constants.
+ * @param maxParams Size of params.
+ * @return The number of constants, or -1 if there are more than maxParams.
+ */
+int
+getExprParams (Expr *expr, ExprParam *params, int maxParams)
+{
+	int n = 0, i, sub;
+
+	switch (expr->type)
+	{
+	case EXPR_CONST:
+		if (maxParams < 1)
+			return -1;
+		switch (expr->expr.cons->dt)
+		{
+		case DT_INT:
+			params[0].intV = expr->expr.cons->v.intV;
+			break;
+		case DT_FLOAT:
+			params[0].floatV = expr->expr.cons->v.floatV;
+			break;
+		case DT_BOOL:
+			params[0].boolV = expr->expr.cons->v.boolV;
+			break;
+		case DT_STRING:
+			params[0].stringV = expr->expr.cons->v.stringV;
+			break;
+		}
+		return 1;
+	case EXPR_OP:
+		for (i = 0; i < ((expr->expr.op->type == OP_BOOL_NOT) ? 1 : 2); i++)
+		{
+			sub = getExprParams(expr->expr.op->args[i], params + n, maxParams - n);
+			if (sub < 0)
+				return -1;
+			n += sub;
+		}
+		return n;
+	default:
+		return 0;
+	}
+}
+
+// shutdownExprCodegen
+/**
+ * Unloads every compiled filter and forgets the shapes that failed to compile. Filters returned before must not
+ * be called afterwards.
+ * @return RC_OK.
+ */
+RC
+shutdownExprCodegen (void)
+{
+	FilterCacheEntry *entry, *next;
+
+	pthread_mutex_lock(&filterCacheLatch);
+	for (entry = filterCache; entry != NULL; entry = next)
+	{
+		next = entry->next;
+		if (entry->handle != NULL)
+			dlclose(entry->handle);
+		free(entry->key);
+		free(entry);
+	}
+	filterCache = NULL;
+	pthread_mutex_unlock(&filterCacheLatch);
+
+	return RC_OK;
+}
@@ -0,0 +1,39 @@
+#ifndef EXPR_CODEGEN_H
+#define EXPR_CODEGEN_H
+
+#include "dberror.h"
+#include "expr.h"
+#include "tables.h"
+
+// Native code for scan predicates.
+//
+// compileExprFilter() turns a condition over a schema into C source for a
+// function that filters all tuples of a record page at once, builds it
+// with the system C compiler into a shared object and loads it with
+// dlopen. Filters are cached by the shape of the predicate: constants are
+// not part of the generated code but passed in at call time (in the order
+// getExprParams() lists them), so "a < 5" and "a < 7" share one object.
+// Callers fall back to evalExpr when compilation fails.
+
+// a constant of the predicate, as seen by the generated code
+typedef union ExprParam {
+	int intV;
+	float floatV;
+	short boolV;
+	const char *stringV;
+} ExprParam;
+
+// Filter numTuples tuples stored tupleBytes apart from page; every tuple is
+// a delete flag (the C bool) followed by the record data. Sets matches[i]
+// to 1 for live tuples satisfying the predicate, 0 otherwise, and returns
+// the number of matches.
+typedef int (*ExprPageFilter) (const char *page, int numTuples, int tupleBytes,
+		const ExprParam *params, char *matches);
+
+#define EXPR_MAX_PARAMS 64
+
+extern RC compileExprFilter (Expr *expr, Schema *schema, ExprPageFilter *filter);
+extern int getExprParams (Expr *expr, ExprParam *params, int maxParams);
+extern RC shutdownExprCodegen (void);
+
+#endif // EXPR_CODEGEN_H
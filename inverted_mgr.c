@@ -0,0 +1,922 @@
+#include "inverted_mgr.h"
+#include "storage_mgr.h"
+#include "expr.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Inverted index
+//
+// The tokens are kept in a chained hash table that doubles when it holds
+// more tokens than buckets. A posting is the position of a record,
+// page * (PAGE_SIZE / 256) + slot, so posting order is RID order. A posting
+// list is an array of blocks sorted by their first posting; a block holds up
+// to II_BLOCK_MAX postings, the first in full and the others as gaps of 7
+// bits per byte with the high bit set on every byte but the last. Adding a
+// posting decodes one block, inserts it and encodes the block again,
+// splitting it in two halves when it is full; a block that loses its last
+// posting is dropped.
+//
+// Index file: page 0 is an II_Header, the pages after it are a byte stream
+// of the tokens. A token is its length and characters, its number of blocks
+// and the blocks; a block is its first posting, count, gap bytes and gaps.
+
+#define II_SLOTS_PER_PAGE (PAGE_SIZE / 256)
+#define II_BLOCK_MAX 128
+#define II_MIN_BUCKETS 64
+
+// Index header, stored at the start of page 0
+typedef struct II_Header {
+    int attrNum;
+    int numTokens;
+    int dataBytes;  // length of the stream starting at page 1
+} II_Header;
+
+typedef struct II_Block {
+    unsigned int first;
+    int count;
+    int size;               // bytes of gaps
+    unsigned char *gaps;
+} II_Block;
+
+typedef struct II_Token {
+    char *text;
+    int numPostings;
+    int numBlocks;
+    int capacity;
+    II_Block *blocks;       // sorted by first posting
+    struct II_Token *next;  // hash chain
+} II_Token;
+
+typedef struct II_IndexMgmt {
+    int numTokens;
+    int numBuckets;
+    II_Token **buckets;
+    bool dirty;
+} II_IndexMgmt;
+
+// Position in the posting list of one token of a query
+typedef struct II_Cursor {
+    II_Token *token;
+    int block;                  // decoded block, -1 before the first
+    int count;
+    int pos;                    // current posting in values
+    unsigned int values[II_BLOCK_MAX];
+} II_Cursor;
+
+typedef struct II_ScanMgmt {
+    RID *rids;
+    int numRids;
+    int next;
+} II_ScanMgmt;
+
+#define INDEX_MGMT(index) ((II_IndexMgmt *) (index)->mgmtData)
+
+static RC iiInsert(void *index, Record *record);
+static RC iiRemove(void *index, Record *record);
+
+static RM_IndexHooks iiHooks = { iiInsert, iiRemove, NULL };
+
+/* ---------------------------------------------------------------------- */
+/* Blocks                                                                  */
+/* ---------------------------------------------------------------------- */
+
+// Decode the postings of a block into values; returns their number
+static int decodeBlock(II_Block *b, unsigned int *values) {
+    unsigned char *p = b->gaps;
+    int i;
+
+    values[0] = b->first;
+    for (i = 1; i < b->count; i++) {
+        unsigned int gap = 0;
+        int shift = 0;
+        do {
+            gap |= (unsigned int) (*p & 0x7f) << shift;
+            shift += 7;
+        } while (*p++ & 0x80);
+        values[i] = values[i - 1] + gap;
+    }
+    return b->count;
+}
+
+// Replace the postings of a block with values[0 .. n-1]
+static RC encodeBlock(II_Block *b, unsigned int *values, int n) {
+    unsigned char buf[II_BLOCK_MAX * 5];
+    unsigned char *gaps;
+    int i, size = 0;
+
+    for (i = 1; i < n; i++) {
+        unsigned int gap = values[i] - values[i - 1];
+        while (gap >= 0x80) {
+            buf[size++] = (unsigned char) (gap | 0x80);
+            gap >>= 7;
+        }
+        buf[size++] = (unsigned char) gap;
+    }
+    gaps = (unsigned char *) realloc(b->gaps, size + 1);
+    if (gaps == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    memcpy(gaps, buf, size);
+    b->gaps = gaps;
+    b->size = size;
+    b->first = values[0];
+    b->count = n;
+    return RC_OK;
+}
+
+// Make room for a block at position i of a token
+static RC insertBlock(II_Token *t, int i) {
+    if (t->numBlocks == t->capacity) {
+        int capacity = t->capacity < 4 ? 4 : 2 * t->capacity;
+        II_Block *blocks = (II_Block *) realloc(t->blocks, capacity * sizeof(II_Block));
+        if (blocks == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        t->blocks = blocks;
+        t->capacity = capacity;
+    }
+    memmove(t->blocks + i + 1, t->blocks + i, (t->numBlocks - i) * sizeof(II_Block));
+    memset(&t->blocks[i], 0, sizeof(II_Block));
+    t->numBlocks++;
+    return RC_OK;
+}
+
+// The last block whose first posting is <= posting, or 0
+static int findBlock(II_Token *t, unsigned int posting) {
+    int lo = 0, hi = t->numBlocks - 1, found = 0;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (t->blocks[mid].first <= posting) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+// Position of the first value >= v in a sorted array of n
+static int lowerBound(unsigned int *values, int lo, int hi, unsigned int v) {
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (values[mid] < v)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static RC addPosting(II_Token *t, unsigned int posting) {
+    unsigned int values[II_BLOCK_MAX + 1];
+    int i, n, pos, half;
+    RC rc;
+
+    if (t->numBlocks == 0) {
+        if ((rc = insertBlock(t, 0)) != RC_OK)
+            return rc;
+        if ((rc = encodeBlock(&t->blocks[0], &posting, 1)) != RC_OK)
+            return rc;
+        t->numPostings++;
+        return RC_OK;
+    }
+
+    i = findBlock(t, posting);
+    n = decodeBlock(&t->blocks[i], values);
+    pos = lowerBound(values, 0, n, posting);
+    if (pos < n && values[pos] == posting)
+        return RC_OK;
+    memmove(values + pos + 1, values + pos, (n - pos) * sizeof(unsigned int));
+    values[pos] = posting;
+    n++;
+    t->numPostings++;
+    if (n <= II_BLOCK_MAX)
+        return encodeBlock(&t->blocks[i], values, n);
+
+    // a full block splits in two halves
+    half = n / 2;
+    if ((rc = insertBlock(t, i + 1)) != RC_OK)
+        return rc;
+    if ((rc = encodeBlock(&t->blocks[i], values, half)) != RC_OK)
+        return rc;
+    return encodeBlock(&t->blocks[i + 1], values + half, n - half);
+}
+
+static RC removePosting(II_Token *t, unsigned int posting) {
+    unsigned int values[II_BLOCK_MAX];
+    int i, n, pos;
+
+    if (t->numBlocks == 0)
+        return RC_OK;
+    i = findBlock(t, posting);
+    n = decodeBlock(&t->blocks[i], values);
+    pos = lowerBound(values, 0, n, posting);
+    if (pos == n || values[pos] != posting)
+        return RC_OK;
+    t->numPostings--;
+    if (n == 1) {
+        free(t->blocks[i].gaps);
+        t->numBlocks--;
+        memmove(t->blocks + i, t->blocks + i + 1, (t->numBlocks - i) * sizeof(II_Block));
+        return RC_OK;
+    }
+    memmove(values + pos, values + pos + 1, (n - pos - 1) * sizeof(unsigned int));
+    return encodeBlock(&t->blocks[i], values, n - 1);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Tokens                                                                  */
+/* ---------------------------------------------------------------------- */
+
+// nextToken
+/**
+ * Copies the next token of a text, in lower case, and moves past it.
+ *
+ * @param text The rest of the text; advanced past the token.
+ * @param token Receives the token; must hold strlen(*text) + 1 bytes.
+ * @return The length of the token, 0 at the end of the text.
+ */
+static int nextToken(const char **text, char *token) {
+    const unsigned char *p = (const unsigned char *) *text;
+    int len = 0;
+
+    while (*p != '\0' && !isalnum(*p))
+        p++;
+    while (*p != '\0' && isalnum(*p))
+        token[len++] = (char) tolower(*p++);
+    token[len] = '\0';
+    *text = (const char *) p;
+    return len;
+}
+
+static unsigned int hashToken(const char *text) {
+    unsigned int h = 2166136261u;
+
+    for (; *text != '\0'; text++)
+        h = (h ^ (unsigned char) *text) * 16777619u;
+    return h;
+}
+
+// Spread the tokens over twice as many buckets
+static RC growBuckets(II_IndexMgmt *m) {
+    int numBuckets = m->numBuckets < II_MIN_BUCKETS ? II_MIN_BUCKETS : 2 * m->numBuckets;
+    II_Token **buckets = (II_Token **) calloc(numBuckets, sizeof(II_Token *));
+    int i;
+
+    if (buckets == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (i = 0; i < m->numBuckets; i++) {
+        II_Token *t = m->buckets[i];
+        while (t != NULL) {
+            II_Token *next = t->next;
+            unsigned int b = hashToken(t->text) & (numBuckets - 1);
+            t->next = buckets[b];
+            buckets[b] = t;
+            t = next;
+        }
+    }
+    free(m->buckets);
+    m->buckets = buckets;
+    m->numBuckets = numBuckets;
+    return RC_OK;
+}
+
+// findToken
+/**
+ * Looks a token up, adding it without postings if create is set.
+ *
+ * @param result Receives the token, or NULL if it is not in the index.
+ * @return RC_OK, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC findToken(II_IndexMgmt *m, const char *text, bool create, II_Token **result) {
+    II_Token *t = NULL;
+    RC rc;
+
+    if (m->numBuckets > 0)
+        for (t = m->buckets[hashToken(text) & (m->numBuckets - 1)]; t != NULL; t = t->next)
+            if (strcmp(t->text, text) == 0)
+                break;
+    *result = t;
+    if (t != NULL || !create)
+        return RC_OK;
+
+    if (m->numTokens >= m->numBuckets && (rc = growBuckets(m)) != RC_OK)
+        return rc;
+    t = (II_Token *) calloc(1, sizeof(II_Token));
+    if (t == NULL || (t->text = strdup(text)) == NULL) {
+        free(t);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    unsigned int b = hashToken(text) & (m->numBuckets - 1);
+    t->next = m->buckets[b];
+    m->buckets[b] = t;
+    m->numTokens++;
+    *result = t;
+    return RC_OK;
+}
+
+static void freeToken(II_Token *t) {
+    int i;
+
+    for (i = 0; i < t->numBlocks; i++)
+        free(t->blocks[i].gaps);
+    free(t->blocks);
+    free(t->text);
+    free(t);
+}
+
+// Drop a token that has no postings left
+static void dropToken(II_IndexMgmt *m, II_Token *t) {
+    II_Token **link = &m->buckets[hashToken(t->text) & (m->numBuckets - 1)];
+
+    while (*link != t)
+        link = &(*link)->next;
+    *link = t->next;
+    freeToken(t);
+    m->numTokens--;
+}
+
+static void freeIndexMgmt(II_IndexMgmt *m) {
+    int i;
+
+    for (i = 0; i < m->numBuckets; i++) {
+        II_Token *t = m->buckets[i];
+        while (t != NULL) {
+            II_Token *next = t->next;
+            freeToken(t);
+            t = next;
+        }
+    }
+    free(m->buckets);
+    free(m);
+}
+
+// updatePostings
+/**
+ * Adds a record to, or removes it from, the posting lists of the tokens of
+ * its attribute.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC updatePostings(II_IndexHandle *index, Record *record, bool add) {
+    II_IndexMgmt *m = INDEX_MGMT(index);
+    unsigned int posting = (unsigned int) record->id.page * II_SLOTS_PER_PAGE + record->id.slot;
+    const char *text;
+    char *token;
+    Value *value;
+    II_Token *t;
+    RC rc;
+
+    if ((rc = getAttr(record, index->rel->schema, index->attrNum, &value)) != RC_OK)
+        return rc;
+    token = (char *) malloc(strlen(value->v.stringV) + 1);
+    if (token == NULL) {
+        freeVal(value);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    text = value->v.stringV;
+    while (rc == RC_OK && nextToken(&text, token) > 0) {
+        if ((rc = findToken(m, token, add, &t)) != RC_OK || t == NULL)
+            continue;
+        if (add) {
+            rc = addPosting(t, posting);
+        } else if ((rc = removePosting(t, posting)) == RC_OK && t->numPostings == 0) {
+            dropToken(m, t);
+        }
+    }
+    m->dirty = true;
+    free(token);
+    freeVal(value);
+    return rc;
+}
+
+// Hook called by the record manager after an insert or update
+static RC iiInsert(void *index, Record *record) {
+    return updatePostings((II_IndexHandle *) index, record, true);
+}
+
+// Hook called by the record manager before a delete or update
+static RC iiRemove(void *index, Record *record) {
+    return updatePostings((II_IndexHandle *) index, record, false);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Queries                                                                 */
+/* ---------------------------------------------------------------------- */
+
+static void loadBlock(II_Cursor *c, int block) {
+    c->block = block;
+    c->count = decodeBlock(&c->token->blocks[block], c->values);
+    c->pos = 0;
+}
+
+// seekPosting
+/**
+ * Moves a cursor forward to the first posting >= target. It gallops over
+ * the first postings of the blocks, taking steps of 1, 2, 4, ... blocks
+ * until it passes the target and then searching the last step, and finds
+ * the posting in the decoded block the same way.
+ *
+ * @return Whether the list has such a posting; it is values[pos].
+ */
+static bool seekPosting(II_Cursor *c, unsigned int target) {
+    II_Token *t = c->token;
+    int i, step, hi;
+
+    if (c->block < 0 || c->values[c->count - 1] < target) {
+        int b = c->block < 0 ? 0 : c->block;
+        int lo;
+
+        for (step = 1; b + step < t->numBlocks && t->blocks[b + step].first <= target; step *= 2)
+            b += step;
+        hi = b + step < t->numBlocks ? b + step - 1 : t->numBlocks - 1;
+        for (lo = b + 1; lo <= hi;) {
+            int mid = (lo + hi) / 2;
+            if (t->blocks[mid].first <= target) {
+                b = mid;
+                lo = mid + 1;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        if (b != c->block)
+            loadBlock(c, b);
+        if (c->values[c->count - 1] < target) {
+            if (b + 1 == t->numBlocks)
+                return false;
+            loadBlock(c, b + 1);
+        }
+    }
+
+    i = c->pos;
+    if (c->values[i] >= target)
+        return true;
+    for (step = 1; i + step < c->count && c->values[i + step] < target; step *= 2)
+        i += step;
+    hi = i + step < c->count ? i + step : c->count - 1;
+    c->pos = lowerBound(c->values, i + 1, hi, target);
+    return true;
+}
+
+static int compareTokenLength(const void *a, const void *b) {
+    return (*(II_Token **) a)->numPostings - (*(II_Token **) b)->numPostings;
+}
+
+// intersect
+/**
+ * Finds the postings that all tokens share: every posting of the shortest
+ * list that the cursors of the other lists find as well.
+ *
+ * @param rids Receives a malloc'ed array of the records, in RID order.
+ * @return RC_OK, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC intersect(II_Token **tokens, int numTokens, RID **rids, int *numRids) {
+    II_Cursor *cursor = (II_Cursor *) malloc(sizeof(II_Cursor));
+    unsigned int *postings;
+    int i, k, n = 0;
+
+    qsort(tokens, numTokens, sizeof(II_Token *), compareTokenLength);
+    postings = (unsigned int *) malloc((tokens[0]->numPostings + 1) * sizeof(unsigned int));
+    *rids = (RID *) malloc((tokens[0]->numPostings + 1) * sizeof(RID));
+    if (cursor == NULL || postings == NULL || *rids == NULL) {
+        free(cursor);
+        free(postings);
+        free(*rids);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    for (i = 0; i < tokens[0]->numBlocks; i++)
+        n += decodeBlock(&tokens[0]->blocks[i], postings + n);
+
+    for (k = 1; k < numTokens && n > 0; k++) {
+        int kept = 0;
+
+        cursor->token = tokens[k];
+        cursor->block = -1;
+        for (i = 0; i < n; i++) {
+            if (!seekPosting(cursor, postings[i]))
+                break;
+            if (cursor->values[cursor->pos] == postings[i])
+                postings[kept++] = postings[i];
+        }
+        n = kept;
+    }
+
+    for (i = 0; i < n; i++) {
+        (*rids)[i].page = postings[i] / II_SLOTS_PER_PAGE;
+        (*rids)[i].slot = postings[i] % II_SLOTS_PER_PAGE;
+    }
+    *numRids = n;
+    free(cursor);
+    free(postings);
+    return RC_OK;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Index file                                                              */
+/* ---------------------------------------------------------------------- */
+
+// Growing byte stream of the index file
+typedef struct II_Stream {
+    char *data;
+    int size;
+    int capacity;
+} II_Stream;
+
+static RC streamPut(II_Stream *s, const void *src, int len) {
+    if (s->size + len > s->capacity) {
+        int capacity = s->capacity < PAGE_SIZE ? PAGE_SIZE : s->capacity;
+        char *data;
+        while (capacity < s->size + len)
+            capacity *= 2;
+        if ((data = (char *) realloc(s->data, capacity)) == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        s->data = data;
+        s->capacity = capacity;
+    }
+    memcpy(s->data + s->size, src, len);
+    s->size += len;
+    return RC_OK;
+}
+
+static RC streamPutToken(II_Stream *s, II_Token *t) {
+    int len = strlen(t->text), i;
+    RC rc;
+
+    if ((rc = streamPut(s, &len, sizeof(int))) != RC_OK
+            || (rc = streamPut(s, t->text, len)) != RC_OK
+            || (rc = streamPut(s, &t->numBlocks, sizeof(int))) != RC_OK)
+        return rc;
+    for (i = 0; i < t->numBlocks && rc == RC_OK; i++) {
+        II_Block *b = &t->blocks[i];
+        if ((rc = streamPut(s, &b->first, sizeof(unsigned int))) == RC_OK
+                && (rc = streamPut(s, &b->count, sizeof(int))) == RC_OK
+                && (rc = streamPut(s, &b->size, sizeof(int))) == RC_OK)
+            rc = streamPut(s, b->gaps, b->size);
+    }
+    return rc;
+}
+
+// Read a token at *pos of the stream into the index, advancing *pos
+static RC streamGetToken(II_IndexMgmt *m, char *data, int *pos) {
+    II_Token *t;
+    char *text;
+    int len, numBlocks, i;
+    RC rc;
+
+    memcpy(&len, data + *pos, sizeof(int));
+    if ((text = (char *) malloc(len + 1)) == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    memcpy(text, data + *pos + sizeof(int), len);
+    text[len] = '\0';
+    *pos += sizeof(int) + len;
+    rc = findToken(m, text, true, &t);
+    free(text);
+    if (rc != RC_OK)
+        return rc;
+
+    memcpy(&numBlocks, data + *pos, sizeof(int));
+    *pos += sizeof(int);
+    for (i = 0; i < numBlocks; i++) {
+        II_Block *b;
+        if ((rc = insertBlock(t, i)) != RC_OK)
+            return rc;
+        b = &t->blocks[i];
+        memcpy(&b->first, data + *pos, sizeof(unsigned int));
+        memcpy(&b->count, data + *pos + sizeof(unsigned int), sizeof(int));
+        memcpy(&b->size, data + *pos + sizeof(unsigned int) + sizeof(int), sizeof(int));
+        *pos += sizeof(unsigned int) + 2 * sizeof(int);
+        if ((b->gaps = (unsigned char *) malloc(b->size + 1)) == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        memcpy(b->gaps, data + *pos, b->size);
+        *pos += b->size;
+        t->numPostings += b->count;
+    }
+    return RC_OK;
+}
+
+// writeIndex
+/**
+ * Writes the header and the tokens of an index to its file.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC writeIndex(II_IndexHandle *index) {
+    II_IndexMgmt *m = INDEX_MGMT(index);
+    II_Stream s;
+    II_Header header;
+    SM_FileHandle fh;
+    int i, pages;
+    RC rc = RC_OK;
+
+    memset(&s, 0, sizeof(s));
+    for (i = 0; i < m->numBuckets && rc == RC_OK; i++) {
+        II_Token *t;
+        for (t = m->buckets[i]; t != NULL && rc == RC_OK; t = t->next)
+            rc = streamPutToken(&s, t);
+    }
+    memset(&header, 0, sizeof(header));
+    header.attrNum = index->attrNum;
+    header.numTokens = m->numTokens;
+    header.dataBytes = s.size;
+    pages = (s.size + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (rc == RC_OK && s.capacity < (pages + 1) * PAGE_SIZE) {
+        char *data = (char *) realloc(s.data, (pages + 1) * PAGE_SIZE);
+        if (data == NULL)
+            rc = RC_MEM_ALLOCATION_FAIL;
+        else
+            s.data = data;
+    }
+    if (rc != RC_OK) {
+        free(s.data);
+        return rc;
+    }
+    memset(s.data + s.size, 0, (pages + 1) * PAGE_SIZE - s.size);
+
+    if ((rc = openPageFile(index->idxId, &fh)) != RC_OK) {
+        free(s.data);
+        return rc;
+    }
+    for (i = 0; i < pages && rc == RC_OK; i++)
+        rc = writeBlock(i + 1, &fh, s.data + i * PAGE_SIZE);
+    if (rc == RC_OK) {
+        memset(s.data, 0, PAGE_SIZE);
+        memcpy(s.data, &header, sizeof(header));
+        rc = writeBlock(0, &fh, s.data);
+    }
+    free(s.data);
+    closePageFile(&fh);
+    if (rc == RC_OK)
+        m->dirty = false;
+    return rc;
+}
+
+// readIndex
+/**
+ * Reads the tokens of an index from its file.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC readIndex(SM_FileHandle *fh, II_Header *header, II_IndexMgmt *m) {
+    int pages = (header->dataBytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    char *data = (char *) malloc((pages + 1) * PAGE_SIZE);
+    int i, pos = 0;
+    RC rc = RC_OK;
+
+    if (data == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (i = 0; i < pages && rc == RC_OK; i++)
+        rc = readBlock(i + 1, fh, data + i * PAGE_SIZE);
+    for (i = 0; i < header->numTokens && rc == RC_OK; i++)
+        rc = streamGetToken(m, data, &pos);
+    free(data);
+    return rc;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Interface                                                               */
+/* ---------------------------------------------------------------------- */
+
+// createInvertedIndex
+/**
+ * Creates an index over a STRING attribute of a table from the records the
+ * table holds now. The index is not open afterwards.
+ *
+ * @param idxId Name of the index file.
+ * @param rel The open table.
+ * @param attrNum The attribute.
+ * @return RC_OK, RC_INVALID_ATTR_NUM, RC_RM_UNKNOWN_DATATYPE for an
+ *         attribute that is not a STRING, or an error code.
+ */
+RC createInvertedIndex(char *idxId, RM_TableData *rel, int attrNum) {
+    II_IndexHandle index;
+    II_IndexMgmt *m;
+    RM_ScanHandle scan;
+    Record record;
+    RC rc;
+
+    if (idxId == NULL || rel == NULL || rel->schema == NULL)
+        return RC_NULL_POINTER;
+    if (attrNum < 0 || attrNum >= rel->schema->numAttr)
+        return RC_INVALID_ATTR_NUM;
+    if (rel->schema->dataTypes[attrNum] != DT_STRING)
+        return RC_RM_UNKNOWN_DATATYPE;
+
+    if ((m = (II_IndexMgmt *) calloc(1, sizeof(II_IndexMgmt))) == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    index.idxId = idxId;
+    index.rel = rel;
+    index.attrNum = attrNum;
+    index.mgmtData = m;
+
+    record.data = NULL;
+    if ((rc = startScan(rel, &scan, NULL)) == RC_OK) {
+        while ((rc = next(&scan, &record)) == RC_OK)
+            if ((rc = updatePostings(&index, &record, true)) != RC_OK)
+                break;
+        closeScan(&scan);
+        if (rc == RC_RM_NO_MORE_TUPLES)
+            rc = RC_OK;
+    }
+    free(record.data);
+
+    if (rc == RC_OK && (rc = createPageFile(idxId)) == RC_OK)
+        rc = writeIndex(&index);
+    freeIndexMgmt(m);
+    return rc;
+}
+
+// openInvertedIndex
+/**
+ * Opens an index and attaches it to its table, which maintains it from now
+ * on.
+ *
+ * @param index Receives the handle; release it with closeInvertedIndex
+ *        before closing the table.
+ * @param idxId Name of the index file.
+ * @param rel The open table the index was created on.
+ * @return RC_OK, RC_INVALID_ARGS if the table does not fit the index, or an
+ *         error code.
+ */
+RC openInvertedIndex(II_IndexHandle **index, char *idxId, RM_TableData *rel) {
+    II_IndexHandle *handle;
+    II_IndexMgmt *m;
+    II_Header header;
+    SM_FileHandle fh;
+    char *page;
+    RC rc;
+
+    *index = NULL;
+    m = (II_IndexMgmt *) calloc(1, sizeof(II_IndexMgmt));
+    handle = (II_IndexHandle *) malloc(sizeof(II_IndexHandle));
+    page = (char *) malloc(PAGE_SIZE);
+    if (m == NULL || handle == NULL || page == NULL) {
+        free(m);
+        free(handle);
+        free(page);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+
+    memset(&header, 0, sizeof(header));
+    if ((rc = openPageFile(idxId, &fh)) == RC_OK) {
+        if ((rc = readBlock(0, &fh, page)) == RC_OK) {
+            memcpy(&header, page, sizeof(II_Header));
+            if (header.attrNum >= rel->schema->numAttr || rel->schema->dataTypes[header.attrNum] != DT_STRING)
+                rc = RC_INVALID_ARGS;
+            else
+                rc = readIndex(&fh, &header, m);
+        }
+        closePageFile(&fh);
+    }
+    free(page);
+
+    handle->idxId = strdup(idxId);
+    handle->rel = rel;
+    handle->attrNum = header.attrNum;
+    handle->mgmtData = m;
+    if (rc == RC_OK)
+        rc = attachIndex(rel, &iiHooks, handle);
+    if (rc != RC_OK) {
+        freeIndexMgmt(m);
+        free(handle->idxId);
+        free(handle);
+        return rc;
+    }
+    *index = handle;
+    return RC_OK;
+}
+
+// closeInvertedIndex
+/**
+ * Detaches an index from its table and writes it if it changed.
+ *
+ * @param index The index.
+ * @return RC_OK, or the error of the storage manager.
+ */
+RC closeInvertedIndex(II_IndexHandle *index) {
+    II_IndexMgmt *m = INDEX_MGMT(index);
+    RC rc = RC_OK;
+
+    detachIndex(index->rel, index);
+    if (m->dirty)
+        rc = writeIndex(index);
+    freeIndexMgmt(m);
+    free(index->idxId);
+    free(index);
+    return rc;
+}
+
+// Remove the file of an index
+RC deleteInvertedIndex(char *idxId) {
+    return destroyPageFile(idxId);
+}
+
+// Get the number of distinct tokens
+RC getIINumTokens(II_IndexHandle *index, int *result) {
+    *result = INDEX_MGMT(index)->numTokens;
+    return RC_OK;
+}
+
+// Get the number of postings of all tokens
+RC getIINumPostings(II_IndexHandle *index, int *result) {
+    II_IndexMgmt *m = INDEX_MGMT(index);
+    II_Token *t;
+    int i, n = 0;
+
+    for (i = 0; i < m->numBuckets; i++)
+        for (t = m->buckets[i]; t != NULL; t = t->next)
+            n += t->numPostings;
+    *result = n;
+    return RC_OK;
+}
+
+// Get the bytes the blocks of all posting lists take
+RC getIIPostingSize(II_IndexHandle *index, int *result) {
+    II_IndexMgmt *m = INDEX_MGMT(index);
+    II_Token *t;
+    int i, k, n = 0;
+
+    for (i = 0; i < m->numBuckets; i++)
+        for (t = m->buckets[i]; t != NULL; t = t->next)
+            for (k = 0; k < t->numBlocks; k++)
+                n += sizeof(unsigned int) + 2 * sizeof(int) + t->blocks[k].size;
+    *result = n;
+    return RC_OK;
+}
+
+// openIIQuery
+/**
+ * Finds the records whose attribute contains every token of a query.
+ *
+ * @param index The index.
+ * @param query Text of one or more tokens, split like the attribute.
+ * @param handle Receives the scan over the records.
+ * @return RC_OK, RC_INVALID_ARGS for a query without tokens, or an error
+ *         code.
+ */
+RC openIIQuery(II_IndexHandle *index, char *query, II_ScanHandle **handle) {
+    II_IndexMgmt *m = INDEX_MGMT(index);
+    II_ScanMgmt *sm = (II_ScanMgmt *) calloc(1, sizeof(II_ScanMgmt));
+    II_ScanHandle *h = (II_ScanHandle *) malloc(sizeof(II_ScanHandle));
+    II_Token **tokens = (II_Token **) malloc((strlen(query) / 2 + 1) * sizeof(II_Token *));
+    char *token = (char *) malloc(strlen(query) + 1);
+    const char *text = query;
+    int numTokens = 0, words = 0;
+    bool missing = false;
+    RC rc = RC_OK;
+
+    if (sm == NULL || h == NULL || tokens == NULL || token == NULL) {
+        rc = RC_MEM_ALLOCATION_FAIL;
+    } else {
+        while (rc == RC_OK && nextToken(&text, token) > 0) {
+            II_Token *t;
+            int i;
+            words++;
+            if ((rc = findToken(m, token, false, &t)) != RC_OK)
+                break;
+            if (t == NULL) {
+                missing = true;
+                continue;
+            }
+            for (i = 0; i < numTokens && tokens[i] != t; i++);
+            if (i == numTokens)
+                tokens[numTokens++] = t;
+        }
+        if (rc == RC_OK && words == 0)
+            rc = RC_INVALID_ARGS;
+        if (rc == RC_OK && !missing)
+            rc = intersect(tokens, numTokens, &sm->rids, &sm->numRids);
+    }
+    free(tokens);
+    free(token);
+    if (rc != RC_OK) {
+        free(sm);
+        free(h);
+        return rc;
+    }
+
+    h->index = index;
+    h->mgmtData = sm;
+    *handle = h;
+    return RC_OK;
+}
+
+// Return the next record of a query
+RC iiNextEntry(II_ScanHandle *handle, RID *result) {
+    II_ScanMgmt *sm = (II_ScanMgmt *) handle->mgmtData;
+
+    if (sm->next == sm->numRids)
+        return RC_IM_NO_MORE_ENTRIES;
+    *result = sm->rids[sm->next++];
+    return RC_OK;
+}
+
+// Release a query
+RC closeIIQuery(II_ScanHandle *handle) {
+    II_ScanMgmt *sm = (II_ScanMgmt *) handle->mgmtData;
+
+    free(sm->rids);
+    free(sm);
+    free(handle);
+    return RC_OK;
+}
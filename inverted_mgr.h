@@ -0,0 +1,53 @@
+#ifndef INVERTED_MGR_H
+#define INVERTED_MGR_H
+
+#include "dberror.h"
+#include "record_mgr.h"
+#include "tables.h"
+
+// Inverted index over the words of a STRING attribute
+//
+// A word (token) is a maximal run of letters and digits, compared without
+// case. For every token the index keeps the posting list of the records
+// whose attribute contains it, in RID order and compressed: the list is cut
+// into blocks of up to 128 postings, and a block stores its first posting
+// and the variable-length gaps to the ones after it.
+//
+// An open index is attached to its table (see attachIndex), so insert,
+// update and delete keep it up to date. A query returns the records that
+// contain all of its tokens. It walks the shortest posting list and
+// gallops through the others: it skips whole blocks by their first
+// posting, and searches a decoded block the same way, so long lists cost
+// little more than the short one. Closing the index writes it to its file.
+
+// structure for accessing inverted indexes
+typedef struct II_IndexHandle {
+  char *idxId;
+  RM_TableData *rel;
+  int attrNum;
+  void *mgmtData;
+} II_IndexHandle;
+
+typedef struct II_ScanHandle {
+  II_IndexHandle *index;
+  void *mgmtData;
+} II_ScanHandle;
+
+// create an index over STRING attribute attrNum of every record of an open
+// table, destroy it, and open and close it on that table
+extern RC createInvertedIndex (char *idxId, RM_TableData *rel, int attrNum);
+extern RC openInvertedIndex (II_IndexHandle **index, char *idxId, RM_TableData *rel);
+extern RC closeInvertedIndex (II_IndexHandle *index);
+extern RC deleteInvertedIndex (char *idxId);
+
+// access information about an index; the size is the bytes of its postings
+extern RC getIINumTokens (II_IndexHandle *index, int *result);
+extern RC getIINumPostings (II_IndexHandle *index, int *result);
+extern RC getIIPostingSize (II_IndexHandle *index, int *result);
+
+// the records whose attribute contains every token of query, in RID order
+extern RC openIIQuery (II_IndexHandle *index, char *query, II_ScanHandle **handle);
+extern RC iiNextEntry (II_ScanHandle *handle, RID *result);
+extern RC closeIIQuery (II_ScanHandle *handle);
+
+#endif // INVERTED_MGR_H
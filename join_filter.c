@@ -0,0 +1,293 @@
+#include "join_filter.h"
+#include "bloom.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Join filter
+//
+// The key of a record is the bytes of its key attributes one after the
+// other, read straight from the stored record: INT and FLOAT as their 4
+// bytes (a FLOAT -0 as +0), BOOL as one byte 0 or 1, and STRING as its
+// characters and a 0 byte, so the attribute lengths of the two tables do
+// not matter. The filter holds the hashes of the build keys; every scan it
+// is pushed into gets a probe, which knows where the key attributes of the
+// probe table sit in its records.
+
+// Where the key attributes of one scan sit in its records
+typedef struct JF_Probe {
+    JF_FilterHandle *filter;
+    int *offsets;
+    int *lengths;           // typeLength of STRING attributes
+    unsigned char *key;     // key of the record being tested
+    struct JF_Probe *next;
+} JF_Probe;
+
+typedef struct JF_FilterMgmt {
+    unsigned char *bloom;
+    int numBlocks;
+    JF_Probe *probes;       // probes of the scans it was pushed into
+} JF_FilterMgmt;
+
+#define FILTER_MGMT(filter) ((JF_FilterMgmt *) (filter)->mgmtData)
+
+// keyOf
+/**
+ * Writes the key of a stored record.
+ *
+ * @param probe Where the key attributes are.
+ * @param types Their types.
+ * @param numAttrs Their number.
+ * @param data The stored record.
+ * @return The length of the key in probe->key.
+ */
+static int keyOf(JF_Probe *probe, DataType *types, int numAttrs, const char *data) {
+    unsigned char *out = probe->key;
+    int i, len = 0;
+
+    for (i = 0; i < numAttrs; i++) {
+        const char *p = data + probe->offsets[i];
+        float f;
+        int n;
+
+        switch (types[i]) {
+        case DT_INT:
+            memcpy(out + len, p, sizeof(int));
+            len += sizeof(int);
+            break;
+        case DT_FLOAT:
+            memcpy(&f, p, sizeof(float));
+            if (f == 0)
+                f = 0;
+            memcpy(out + len, &f, sizeof(float));
+            len += sizeof(float);
+            break;
+        case DT_BOOL:
+            out[len++] = *(const bool *) p != 0;
+            break;
+        case DT_STRING:
+            for (n = 0; n < probe->lengths[i] && p[n] != '\0'; n++)
+                out[len++] = p[n];
+            out[len++] = 0;
+            break;
+        }
+    }
+    return len;
+}
+
+// newProbe
+/**
+ * Locates key attributes in the records of a table.
+ *
+ * @param filter The filter the probe tests against.
+ * @param schema The schema of the table.
+ * @param attrs The key attributes, one per key attribute of the filter.
+ * @param result Receives the probe.
+ * @return RC_OK, RC_INVALID_ATTR_NUM, RC_INVALID_ARGS if an attribute has
+ *         another type than the key, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC newProbe(JF_FilterHandle *filter, Schema *schema, int *attrs, JF_Probe **result) {
+    JF_Probe *probe;
+    int i, keyBytes = 0;
+
+    for (i = 0; i < filter->numAttrs; i++) {
+        if (attrs[i] < 0 || attrs[i] >= schema->numAttr)
+            return RC_INVALID_ATTR_NUM;
+        if (schema->dataTypes[attrs[i]] != filter->keyTypes[i])
+            return RC_INVALID_ARGS;
+        keyBytes += schema->dataTypes[attrs[i]] == DT_STRING ? schema->typeLength[attrs[i]] + 1 : sizeof(float);
+    }
+
+    probe = (JF_Probe *) calloc(1, sizeof(JF_Probe));
+    if (probe == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    probe->filter = filter;
+    probe->offsets = (int *) malloc(filter->numAttrs * sizeof(int));
+    probe->lengths = (int *) malloc(filter->numAttrs * sizeof(int));
+    probe->key = (unsigned char *) malloc(keyBytes);
+    if (probe->offsets == NULL || probe->lengths == NULL || probe->key == NULL) {
+        free(probe->offsets);
+        free(probe->lengths);
+        free(probe->key);
+        free(probe);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    for (i = 0; i < filter->numAttrs; i++) {
+        attrOffset(schema, attrs[i], &probe->offsets[i]);
+        probe->lengths[i] = schema->typeLength[attrs[i]];
+    }
+    *result = probe;
+    return RC_OK;
+}
+
+static void freeProbe(JF_Probe *probe) {
+    free(probe->offsets);
+    free(probe->lengths);
+    free(probe->key);
+    free(probe);
+}
+
+// Row filter of a probe scan: keep the records whose key may be in the filter
+static bool testRecord(void *arg, char *data) {
+    JF_Probe *probe = (JF_Probe *) arg;
+    JF_FilterHandle *filter = probe->filter;
+    JF_FilterMgmt *m = FILTER_MGMT(filter);
+    int len = keyOf(probe, filter->keyTypes, filter->numAttrs, data);
+
+    filter->numTested++;
+    if (bloomMayContain(m->bloom, m->numBlocks, bloomHash(probe->key, len)))
+        return true;
+    filter->numDropped++;
+    return false;
+}
+
+// collectHashes
+/**
+ * Hashes the keys of the records of the build table that match a condition.
+ *
+ * @param probe Locates the key attributes in the build table.
+ * @param hashes Receives a malloc'ed array of the hashes.
+ * @param count Receives their number.
+ * @return RC_OK, or an error code.
+ */
+static RC collectHashes(JF_Probe *probe, RM_TableData *build, Expr *cond, unsigned long long **hashes, int *count) {
+    JF_FilterHandle *filter = probe->filter;
+    RM_ScanHandle scan;
+    Record record;
+    int capacity = 64, len;
+    RC rc;
+
+    *count = 0;
+    if ((*hashes = (unsigned long long *) malloc(capacity * sizeof(unsigned long long))) == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    if ((rc = startScan(build, &scan, cond)) != RC_OK)
+        return rc;
+    record.data = NULL;
+    while ((rc = next(&scan, &record)) == RC_OK) {
+        if (*count == capacity) {
+            unsigned long long *grown = (unsigned long long *) realloc(*hashes, 2 * capacity * sizeof(unsigned long long));
+            if (grown == NULL) {
+                rc = RC_MEM_ALLOCATION_FAIL;
+                break;
+            }
+            *hashes = grown;
+            capacity *= 2;
+        }
+        len = keyOf(probe, filter->keyTypes, filter->numAttrs, record.data);
+        (*hashes)[(*count)++] = bloomHash(probe->key, len);
+    }
+    closeScan(&scan);
+    free(record.data);
+    return rc == RC_RM_NO_MORE_TUPLES ? RC_OK : rc;
+}
+
+// createJoinFilter
+/**
+ * Builds the filter of the join keys of a table, sized for the records
+ * that match the condition.
+ *
+ * @param filter Receives the filter; release it with freeJoinFilter after
+ *        the scans it is pushed into are closed.
+ * @param build The open build table.
+ * @param cond Condition on the build table, NULL for every record.
+ * @param numAttrs Number of key attributes.
+ * @param attrs The key attributes.
+ * @return RC_OK, RC_INVALID_ARGS for no key attributes,
+ *         RC_INVALID_ATTR_NUM, or an error code.
+ */
+RC createJoinFilter(JF_FilterHandle **filter, RM_TableData *build, Expr *cond, int numAttrs, int *attrs) {
+    JF_FilterHandle *handle;
+    JF_FilterMgmt *m;
+    JF_Probe *probe = NULL;
+    unsigned long long *hashes = NULL;
+    int i, count = 0;
+    RC rc;
+
+    *filter = NULL;
+    if (build == NULL || build->schema == NULL || attrs == NULL)
+        return RC_NULL_POINTER;
+    if (numAttrs < 1)
+        return RC_INVALID_ARGS;
+    for (i = 0; i < numAttrs; i++)
+        if (attrs[i] < 0 || attrs[i] >= build->schema->numAttr)
+            return RC_INVALID_ATTR_NUM;
+
+    handle = (JF_FilterHandle *) calloc(1, sizeof(JF_FilterHandle));
+    m = (JF_FilterMgmt *) calloc(1, sizeof(JF_FilterMgmt));
+    if (handle == NULL || m == NULL || (handle->keyTypes = (DataType *) malloc(numAttrs * sizeof(DataType))) == NULL) {
+        free(handle);
+        free(m);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    handle->numAttrs = numAttrs;
+    handle->mgmtData = m;
+    for (i = 0; i < numAttrs; i++)
+        handle->keyTypes[i] = build->schema->dataTypes[attrs[i]];
+
+    if ((rc = newProbe(handle, build->schema, attrs, &probe)) == RC_OK)
+        rc = collectHashes(probe, build, cond, &hashes, &count);
+    if (rc == RC_OK) {
+        m->numBlocks = bloomBlocksFor(count);
+        if ((m->bloom = bloomCreate(m->numBlocks)) == NULL)
+            rc = RC_MEM_ALLOCATION_FAIL;
+    }
+    if (rc == RC_OK) {
+        for (i = 0; i < count; i++)
+            bloomAdd(m->bloom, m->numBlocks, hashes[i]);
+        handle->numKeys = count;
+    }
+    if (probe != NULL)
+        freeProbe(probe);
+    free(hashes);
+    if (rc != RC_OK) {
+        freeJoinFilter(handle);
+        return rc;
+    }
+    *filter = handle;
+    return RC_OK;
+}
+
+// Free a filter and the probes of the scans it was pushed into
+RC freeJoinFilter(JF_FilterHandle *filter) {
+    JF_FilterMgmt *m = FILTER_MGMT(filter);
+
+    while (m->probes != NULL) {
+        JF_Probe *next = m->probes->next;
+        freeProbe(m->probes);
+        m->probes = next;
+    }
+    free(m->bloom);
+    free(m);
+    free(filter->keyTypes);
+    free(filter);
+    return RC_OK;
+}
+
+// pushJoinFilter
+/**
+ * Makes a scan of the probe table drop the records whose join key the
+ * filter rules out.
+ *
+ * @param filter The filter.
+ * @param scan The scan, started and not yet advanced.
+ * @param attrs The attributes of the probe table that join with the key
+ *        attributes of the filter, of the same types.
+ * @return RC_OK, RC_INVALID_ATTR_NUM, RC_INVALID_ARGS if the types do not
+ *         match, or an error code.
+ */
+RC pushJoinFilter(JF_FilterHandle *filter, RM_ScanHandle *scan, int *attrs) {
+    JF_FilterMgmt *m = FILTER_MGMT(filter);
+    JF_Probe *probe;
+    RC rc;
+
+    if (scan == NULL || scan->rel == NULL || attrs == NULL)
+        return RC_NULL_POINTER;
+    if ((rc = newProbe(filter, scan->rel->schema, attrs, &probe)) != RC_OK)
+        return rc;
+    if ((rc = setScanRowFilter(scan, testRecord, probe)) != RC_OK) {
+        freeProbe(probe);
+        return rc;
+    }
+    probe->next = m->probes;
+    m->probes = probe;
+    return RC_OK;
+}
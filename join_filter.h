@@ -0,0 +1,43 @@
+#ifndef JOIN_FILTER_H
+#define JOIN_FILTER_H
+
+#include "dberror.h"
+#include "expr.h"
+#include "record_mgr.h"
+#include "tables.h"
+
+// Bloom filters for semi-joins
+//
+// A join filter holds the join keys of the records of a build table that
+// match a condition, in a blocked bloom filter (see bloom.h). Pushed into a
+// scan of the probe table, it tests the join key of every record on the
+// stored bytes, before the scan evaluates its condition or copies the
+// record out (see setScanRowFilter). Records whose key the build side does
+// not have are dropped there; about 1% of them pass anyway, so the join
+// still has to match the records the scan returns.
+//
+// It pays when the build side is small next to the probe side, such as a
+// selective dimension table against the fact table of a star join. A key is
+// one or more attributes; keys are equal when their attributes have the
+// same types and values, whatever the lengths of STRING attributes.
+
+// structure for accessing join filters
+typedef struct JF_FilterHandle {
+  int numAttrs;
+  DataType *keyTypes;
+  int numKeys;      // build records added
+  int numTested;    // probe records tested by the scans it was pushed into
+  int numDropped;   // of those, records dropped
+  void *mgmtData;
+} JF_FilterHandle;
+
+// build a filter on attributes attrs[0..numAttrs-1] of the records of an
+// open table that match cond (NULL for every record), and free it
+extern RC createJoinFilter (JF_FilterHandle **filter, RM_TableData *build, Expr *cond, int numAttrs, int *attrs);
+extern RC freeJoinFilter (JF_FilterHandle *filter);
+
+// make a started scan drop the records whose attributes attrs[0..numAttrs-1]
+// have no key in the filter; the filter must outlive the scan
+extern RC pushJoinFilter (JF_FilterHandle *filter, RM_ScanHandle *scan, int *attrs);
+
+#endif // JOIN_FILTER_H
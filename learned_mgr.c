@@ -0,0 +1,668 @@
+#include "learned_mgr.h"
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+#include "record_mgr.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Piecewise-linear learned index
+//
+// Page 0 is an LI_Header. The segments of all levels follow in whole pages,
+// level 0 (the segments over the entries) first, then the data pages with
+// the entries sorted by key.
+//
+// A segment starts at one key of the level below (an entry's key, or the
+// first key of a segment of the level below that) and predicts the position
+// of a key as start + slope * (key - firstKey), clamped to the positions the
+// segment covers. Segments are cut greedily: a segment takes the following
+// keys as long as one slope keeps every one of them within maxError of its
+// position. The slopes allowed by each key form a cone; the segment ends when
+// the cone becomes empty, and takes the middle slope of the last cone.
+//
+// Because a prediction is monotone in the key and within maxError at every
+// key of the segment, a key between two keys of the level below lands within
+// maxError + 1 of its position, and within maxError + 2 once the prediction
+// is rounded down; the search window is that wide on both sides.
+
+#define LI_POOL_SIZE 16
+#define LI_MAX_LEVELS 32
+#define LI_MAX_ERROR 1024
+
+// Index header, stored at the start of page 0
+typedef struct LI_Header {
+    int numEntries;
+    int maxError;
+    int numLevels;
+    int segmentPages;
+    int levelSizes[LI_MAX_LEVELS];
+} LI_Header;
+
+typedef struct LI_Segment {
+    int firstKey;
+    int start;      // position of firstKey in the level below
+    double slope;
+} LI_Segment;
+
+typedef struct LI_Entry {
+    int key;
+    RID rid;
+} LI_Entry;
+
+#define LI_SEGMENTS_PER_PAGE (PAGE_SIZE / (int) sizeof(LI_Segment))
+#define LI_ENTRIES_PER_PAGE (PAGE_SIZE / (int) sizeof(LI_Entry))
+
+// Runtime state of an open index, kept in LI_IndexHandle.mgmtData
+typedef struct LI_IndexMgmt {
+    BM_BufferPool pool;
+    LI_Header header;
+    LI_Segment *segments;                   // all levels, level 0 first
+    LI_Segment *levels[LI_MAX_LEVELS];      // start of each level in segments
+    int dataStart;                          // page of the first entry
+} LI_IndexMgmt;
+
+// Data page pinned while reading entries one after the other
+typedef struct LI_Cursor {
+    BM_PageHandle page;
+    int pageNum;
+    bool pinned;
+} LI_Cursor;
+
+typedef struct LI_ScanMgmt {
+    LI_Cursor cursor;
+    int pos;
+    bool bounded;   // whether high applies
+    int high;
+} LI_ScanMgmt;
+
+#define INDEX_MGMT(index) ((LI_IndexMgmt *) (index)->mgmtData)
+
+static int compareEntries(const void *a, const void *b) {
+    int x = ((const LI_Entry *) a)->key, y = ((const LI_Entry *) b)->key;
+
+    return (x > y) - (x < y);
+}
+
+// buildSegments
+/**
+ * Cuts sorted keys into segments that predict the position of every key
+ * to within maxError.
+ *
+ * @param keys The keys, strictly increasing.
+ * @param n Their number, at least 1.
+ * @param maxError The error bound.
+ * @param segments Receives the malloc'ed segments.
+ * @param count Receives their number.
+ * @return RC_OK, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC buildSegments(const int *keys, int n, int maxError, LI_Segment **segments, int *count) {
+    LI_Segment *result = (LI_Segment *) malloc(n * sizeof(LI_Segment));
+    double lo = 0, hi = -1;     // cone of slopes; hi < 0 while it is unbounded
+    int start = 0, c = 0, i;
+
+    if (result == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+
+    for (i = 1; i <= n; i++) {
+        if (i < n) {
+            double dx = (double) keys[i] - (double) keys[start];
+            double sLo = (i - start - maxError) / dx;
+            double sHi = (i - start + maxError) / dx;
+
+            if (sLo < lo)
+                sLo = lo;
+            if (hi >= 0 && sHi > hi)
+                sHi = hi;
+            if (sLo <= sHi) {
+                lo = sLo;
+                hi = sHi;
+                continue;
+            }
+        }
+
+        // keys[start .. i - 1] make one segment
+        result[c].firstKey = keys[start];
+        result[c].start = start;
+        result[c].slope = hi < 0 ? 0 : (lo + hi) / 2;
+        c++;
+        start = i;
+        lo = 0;
+        hi = -1;
+    }
+
+    *segments = result;
+    *count = c;
+    return RC_OK;
+}
+
+// Predicted position of a key in the level below a segment, between the
+// segment's start and end
+static int predict(const LI_Segment *s, int end, int key) {
+    double p = s->start + s->slope * ((double) key - (double) s->firstKey);
+
+    if (p < s->start)
+        return s->start;
+    if (p > end)
+        return end;
+    return (int) p;
+}
+
+// writePages
+/**
+ * Writes a buffer to whole pages from a page on.
+ *
+ * @return RC_OK, or the error of the storage manager.
+ */
+static RC writePages(SM_FileHandle *fh, int first, const void *buffer, int bytes) {
+    char *page = (char *) malloc(PAGE_SIZE);
+    int done, pageNum = first;
+    RC rc = RC_OK;
+
+    if (page == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (done = 0; done < bytes && rc == RC_OK; done += PAGE_SIZE, pageNum++) {
+        int n = bytes - done < PAGE_SIZE ? bytes - done : PAGE_SIZE;
+
+        memset(page, 0, PAGE_SIZE);
+        memcpy(page, (const char *) buffer + done, n);
+        rc = writeBlock(pageNum, fh, page);
+    }
+    free(page);
+    return rc;
+}
+
+// writeIndex
+/**
+ * Writes the header, the segments and the entries to a new index file.
+ *
+ * @return RC_OK, or the error of the storage manager.
+ */
+static RC writeIndex(char *idxId, LI_Header *header, LI_Segment *segments, int numSegments,
+                     LI_Entry *entries) {
+    int segmentBytes = numSegments * sizeof(LI_Segment);
+    SM_FileHandle fh;
+    RC rc;
+    int e;
+
+    if ((rc = createPageFile(idxId)) != RC_OK)
+        return rc;
+    if ((rc = openPageFile(idxId, &fh)) != RC_OK)
+        return rc;
+
+    header->segmentPages = (segmentBytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    rc = writePages(&fh, 0, header, sizeof(LI_Header));
+    if (rc == RC_OK)
+        rc = writePages(&fh, 1, segments, segmentBytes);
+
+    // entries never straddle pages
+    for (e = 0; e < header->numEntries && rc == RC_OK; e += LI_ENTRIES_PER_PAGE) {
+        int n = header->numEntries - e < LI_ENTRIES_PER_PAGE ? header->numEntries - e : LI_ENTRIES_PER_PAGE;
+
+        rc = writePages(&fh, 1 + header->segmentPages + e / LI_ENTRIES_PER_PAGE, entries + e, n * sizeof(LI_Entry));
+    }
+
+    closePageFile(&fh);
+    if (rc != RC_OK)
+        destroyPageFile(idxId);
+    return rc;
+}
+
+// createLearnedIndex
+/**
+ * Bulk loads an index: sorts the pairs, fits the model level by level and
+ * writes it with the sorted entries.
+ *
+ * @param idxId Name of the index file.
+ * @param keys The keys.
+ * @param rids The RID of each key.
+ * @param n Number of pairs.
+ * @param maxError Error bound of a prediction, 1 to LI_MAX_ERROR.
+ * @return RC_OK, RC_INVALID_ARGS, RC_IM_KEY_ALREADY_EXISTS for a repeated
+ *         key, or an error code.
+ */
+RC createLearnedIndex(char *idxId, int *keys, RID *rids, int n, int maxError) {
+    LI_Segment *levels[LI_MAX_LEVELS], *all = NULL;
+    LI_Entry *entries;
+    LI_Header header;
+    int *levelKeys = NULL;
+    int numSegments = 0, i, l;
+    RC rc = RC_OK;
+
+    if (n < 0 || maxError < 1 || maxError > LI_MAX_ERROR)
+        return RC_INVALID_ARGS;
+
+    entries = (LI_Entry *) malloc((n > 0 ? n : 1) * sizeof(LI_Entry));
+    if (entries == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (i = 0; i < n; i++) {
+        entries[i].key = keys[i];
+        entries[i].rid = rids[i];
+    }
+    qsort(entries, n, sizeof(LI_Entry), compareEntries);
+    for (i = 1; i < n; i++) {
+        if (entries[i].key == entries[i - 1].key) {
+            free(entries);
+            return RC_IM_KEY_ALREADY_EXISTS;
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.numEntries = n;
+    header.maxError = maxError;
+
+    // each level fits the first keys of the one below, up to one segment
+    if (n > 0 && (levelKeys = (int *) malloc(n * sizeof(int))) == NULL)
+        rc = RC_MEM_ALLOCATION_FAIL;
+    for (i = 0; i < n && rc == RC_OK; i++)
+        levelKeys[i] = entries[i].key;
+    for (l = 0; n > 0 && rc == RC_OK; l++) {
+        int count = l == 0 ? n : header.levelSizes[l - 1];
+
+        if ((rc = buildSegments(levelKeys, count, maxError, &levels[l], &header.levelSizes[l])) != RC_OK)
+            break;
+        header.numLevels++;
+        numSegments += header.levelSizes[l];
+        if (header.levelSizes[l] == 1)
+            break;
+        for (i = 0; i < header.levelSizes[l]; i++)
+            levelKeys[i] = levels[l][i].firstKey;
+    }
+
+    if (rc == RC_OK && numSegments > 0) {
+        if ((all = (LI_Segment *) malloc(numSegments * sizeof(LI_Segment))) == NULL) {
+            rc = RC_MEM_ALLOCATION_FAIL;
+        } else {
+            for (l = 0, i = 0; l < header.numLevels; i += header.levelSizes[l], l++)
+                memcpy(all + i, levels[l], header.levelSizes[l] * sizeof(LI_Segment));
+        }
+    }
+    if (rc == RC_OK)
+        rc = writeIndex(idxId, &header, all, numSegments, entries);
+
+    for (l = 0; l < header.numLevels; l++)
+        free(levels[l]);
+    free(all);
+    free(levelKeys);
+    free(entries);
+    return rc;
+}
+
+// buildLearnedIndex
+/**
+ * Bulk loads an index over an INT attribute of every record of a table.
+ *
+ * @param idxId Name of the index file.
+ * @param rel The table, open.
+ * @param attrNum The key attribute.
+ * @param maxError Error bound of a prediction.
+ * @return RC_OK, RC_INVALID_ATTR_NUM, RC_RM_UNKNOWN_DATATYPE for a key
+ *         attribute that is not an INT, or an error code.
+ */
+RC buildLearnedIndex(char *idxId, RM_TableData *rel, int attrNum, int maxError) {
+    RM_ScanHandle scan;
+    Record *record;
+    int *keys = NULL;
+    RID *rids = NULL;
+    int count = 0, capacity = 0;
+    RC rc;
+
+    if (attrNum < 0 || attrNum >= rel->schema->numAttr)
+        return RC_INVALID_ATTR_NUM;
+    if (rel->schema->dataTypes[attrNum] != DT_INT)
+        return RC_RM_UNKNOWN_DATATYPE;
+
+    if ((rc = createRecord(&record, rel->schema)) != RC_OK)
+        return rc;
+    if ((rc = startScan(rel, &scan, NULL)) != RC_OK) {
+        freeRecord(record);
+        return rc;
+    }
+    while ((rc = next(&scan, record)) == RC_OK) {
+        Value *value;
+
+        if (count == capacity) {
+            int *k;
+            RID *r;
+
+            capacity = capacity > 0 ? 2 * capacity : 256;
+            k = (int *) realloc(keys, capacity * sizeof(int));
+            if (k != NULL)
+                keys = k;
+            r = (RID *) realloc(rids, capacity * sizeof(RID));
+            if (r != NULL)
+                rids = r;
+            if (k == NULL || r == NULL) {
+                rc = RC_MEM_ALLOCATION_FAIL;
+                break;
+            }
+        }
+        if ((rc = getAttr(record, rel->schema, attrNum, &value)) != RC_OK)
+            break;
+        keys[count] = value->v.intV;
+        rids[count] = record->id;
+        count++;
+        freeVal(value);
+    }
+    closeScan(&scan);
+    freeRecord(record);
+
+    if (rc == RC_RM_NO_MORE_TUPLES)
+        rc = createLearnedIndex(idxId, keys, rids, count, maxError);
+    free(keys);
+    free(rids);
+    return rc;
+}
+
+// openLearnedIndex
+/**
+ * Opens an index and reads its model into memory.
+ *
+ * @param index Receives the handle; release it with closeLearnedIndex.
+ * @param idxId Name of the index file.
+ * @return RC_OK, or an error code.
+ */
+RC openLearnedIndex(LI_IndexHandle **index, char *idxId) {
+    LI_IndexHandle *handle;
+    LI_IndexMgmt *t;
+    BM_PageHandle page;
+    int numSegments = 0, i, l;
+    RC rc;
+
+    *index = NULL;
+    t = (LI_IndexMgmt *) calloc(1, sizeof(LI_IndexMgmt));
+    handle = (LI_IndexHandle *) malloc(sizeof(LI_IndexHandle));
+    if (t == NULL || handle == NULL) {
+        free(t);
+        free(handle);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    if ((rc = initBufferPool(&t->pool, idxId, LI_POOL_SIZE, RS_LRU, NULL)) != RC_OK) {
+        free(t);
+        free(handle);
+        return rc;
+    }
+
+    if ((rc = pinPageWithHint(&t->pool, &page, 0, BM_HINT_HOT)) == RC_OK) {
+        memcpy(&t->header, page.data, sizeof(LI_Header));
+        unpinPage(&t->pool, &page);
+        for (l = 0; l < t->header.numLevels; l++)
+            numSegments += t->header.levelSizes[l];
+        t->segments = (LI_Segment *) malloc((numSegments > 0 ? numSegments : 1) * sizeof(LI_Segment));
+        if (t->segments == NULL)
+            rc = RC_MEM_ALLOCATION_FAIL;
+    }
+
+    // the model is read once; its pages are not needed in the pool after that
+    for (i = 0; i < t->header.segmentPages && rc == RC_OK; i++) {
+        int n = numSegments - i * LI_SEGMENTS_PER_PAGE;
+
+        if (n > LI_SEGMENTS_PER_PAGE)
+            n = LI_SEGMENTS_PER_PAGE;
+        if ((rc = pinPageWithHint(&t->pool, &page, 1 + i, BM_HINT_SCAN)) != RC_OK)
+            break;
+        memcpy(t->segments + i * LI_SEGMENTS_PER_PAGE, page.data, n * sizeof(LI_Segment));
+        unpinPage(&t->pool, &page);
+    }
+    if (rc != RC_OK) {
+        shutdownBufferPool(&t->pool);
+        free(t->segments);
+        free(t);
+        free(handle);
+        return rc;
+    }
+
+    for (l = 0, i = 0; l < t->header.numLevels; i += t->header.levelSizes[l], l++)
+        t->levels[l] = t->segments + i;
+    t->dataStart = 1 + t->header.segmentPages;
+
+    handle->keyType = DT_INT;
+    handle->idxId = strdup(idxId);
+    handle->mgmtData = t;
+    *index = handle;
+    return RC_OK;
+}
+
+// Release an open index
+RC closeLearnedIndex(LI_IndexHandle *index) {
+    LI_IndexMgmt *t = INDEX_MGMT(index);
+    RC rc = shutdownBufferPool(&t->pool);
+
+    free(t->segments);
+    free(t);
+    free(index->idxId);
+    free(index);
+    return rc;
+}
+
+// Remove the file of an index
+RC deleteLearnedIndex(char *idxId) {
+    return destroyPageFile(idxId);
+}
+
+// Get the number of keys
+RC getLINumEntries(LI_IndexHandle *index, int *result) {
+    *result = INDEX_MGMT(index)->header.numEntries;
+    return RC_OK;
+}
+
+// Get the number of segments on all levels
+RC getLINumSegments(LI_IndexHandle *index, int *result) {
+    LI_IndexMgmt *t = INDEX_MGMT(index);
+    int l;
+
+    *result = 0;
+    for (l = 0; l < t->header.numLevels; l++)
+        *result += t->header.levelSizes[l];
+    return RC_OK;
+}
+
+// Get the bytes of the model, which is all an open index keeps in memory
+RC getLIModelSize(LI_IndexHandle *index, int *result) {
+    int segments;
+
+    getLINumSegments(index, &segments);
+    *result = sizeof(LI_Header) + segments * sizeof(LI_Segment);
+    return RC_OK;
+}
+
+// Read the entry at a position, keeping its page pinned in the cursor
+static RC entryAt(LI_IndexMgmt *t, LI_Cursor *cursor, int pos, BM_PageHint hint, LI_Entry *entry) {
+    int pageNum = t->dataStart + pos / LI_ENTRIES_PER_PAGE;
+    RC rc;
+
+    if (cursor->pinned && cursor->pageNum != pageNum) {
+        unpinPage(&t->pool, &cursor->page);
+        cursor->pinned = false;
+    }
+    if (!cursor->pinned) {
+        if ((rc = pinPageWithHint(&t->pool, &cursor->page, pageNum, hint)) != RC_OK)
+            return rc;
+        cursor->pageNum = pageNum;
+        cursor->pinned = true;
+    }
+    memcpy(entry, cursor->page.data + (pos % LI_ENTRIES_PER_PAGE) * sizeof(LI_Entry), sizeof(LI_Entry));
+    return RC_OK;
+}
+
+// Clamp a search window of a prediction to the positions 0 .. n - 1
+static void searchWindow(int p, int maxError, int n, int *lo, int *hi) {
+    *lo = p - maxError - 2 < 0 ? 0 : p - maxError - 2;
+    *hi = p + maxError + 2 > n - 1 ? n - 1 : p + maxError + 2;
+}
+
+// lowerBound
+/**
+ * Finds the position of the first entry whose key is >= key: one
+ * prediction and a bounded binary search per level.
+ *
+ * @param t The index.
+ * @param cursor Cursor the data page is pinned in.
+ * @param key The key.
+ * @param hint Replacement hint of the data pages.
+ * @param pos Receives the position, numEntries if every key is smaller.
+ * @return RC_OK, or the error of the buffer manager.
+ */
+static RC lowerBound(LI_IndexMgmt *t, LI_Cursor *cursor, int key, BM_PageHint hint, int *pos) {
+    int maxError = t->header.maxError;
+    int seg = 0, l, lo, hi;
+    LI_Entry entry;
+    RC rc;
+
+    if (t->header.numEntries == 0) {
+        *pos = 0;
+        return RC_OK;
+    }
+
+    // from the single top segment down to level 0: last segment with firstKey <= key
+    for (l = t->header.numLevels - 1; l > 0; l--) {
+        LI_Segment *below = t->levels[l - 1];
+        int n = t->header.levelSizes[l - 1];
+        int end = seg + 1 < t->header.levelSizes[l] ? t->levels[l][seg + 1].start : n;
+
+        searchWindow(predict(&t->levels[l][seg], end, key), maxError, n, &lo, &hi);
+        while (lo < hi) {
+            int mid = (lo + hi + 1) >> 1;
+            if (below[mid].firstKey <= key)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        seg = lo;
+    }
+
+    {
+        int n = t->header.numEntries;
+        int end = seg + 1 < t->header.levelSizes[0] ? t->levels[0][seg + 1].start : n;
+
+        searchWindow(predict(&t->levels[0][seg], end, key), maxError, n, &lo, &hi);
+    }
+    hi++;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if ((rc = entryAt(t, cursor, mid, hint, &entry)) != RC_OK)
+            return rc;
+        if (entry.key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *pos = lo;
+    return RC_OK;
+}
+
+// liFindKey
+/**
+ * Looks a key up.
+ *
+ * @param index The index.
+ * @param key The key, an INT.
+ * @param result Receives its RID.
+ * @return RC_OK, RC_IM_KEY_NOT_FOUND, or an error code.
+ */
+RC liFindKey(LI_IndexHandle *index, Value *key, RID *result) {
+    LI_IndexMgmt *t = INDEX_MGMT(index);
+    LI_Cursor cursor;
+    LI_Entry entry;
+    int pos;
+    RC rc;
+
+    if (key->dt != DT_INT)
+        return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+
+    cursor.pinned = false;
+    rc = lowerBound(t, &cursor, key->v.intV, BM_HINT_NORMAL, &pos);
+    if (rc == RC_OK) {
+        rc = RC_IM_KEY_NOT_FOUND;
+        if (pos < t->header.numEntries && entryAt(t, &cursor, pos, BM_HINT_NORMAL, &entry) == RC_OK
+                && entry.key == key->v.intV) {
+            *result = entry.rid;
+            rc = RC_OK;
+        }
+    }
+    if (cursor.pinned)
+        unpinPage(&t->pool, &cursor.page);
+    return rc;
+}
+
+// openLIScan
+/**
+ * Starts a scan over the keys from low to high in key order.
+ *
+ * @param index The index.
+ * @param low Smallest key returned, or NULL.
+ * @param high Largest key returned, or NULL.
+ * @param handle Receives the scan; release it with closeLIScan.
+ * @return RC_OK, or an error code.
+ */
+RC openLIScan(LI_IndexHandle *index, Value *low, Value *high, LI_ScanHandle **handle) {
+    LI_IndexMgmt *t = INDEX_MGMT(index);
+    LI_ScanHandle *h;
+    LI_ScanMgmt *sm;
+    RC rc = RC_OK;
+
+    *handle = NULL;
+    if ((low != NULL && low->dt != DT_INT) || (high != NULL && high->dt != DT_INT))
+        return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+
+    h = (LI_ScanHandle *) malloc(sizeof(LI_ScanHandle));
+    sm = (LI_ScanMgmt *) calloc(1, sizeof(LI_ScanMgmt));
+    if (h == NULL || sm == NULL) {
+        free(h);
+        free(sm);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    if (low != NULL)
+        rc = lowerBound(t, &sm->cursor, low->v.intV, BM_HINT_SCAN, &sm->pos);
+    if (rc != RC_OK) {
+        if (sm->cursor.pinned)
+            unpinPage(&t->pool, &sm->cursor.page);
+        free(sm);
+        free(h);
+        return rc;
+    }
+    sm->bounded = high != NULL;
+    if (high != NULL)
+        sm->high = high->v.intV;
+
+    h->index = index;
+    h->mgmtData = sm;
+    *handle = h;
+    return RC_OK;
+}
+
+// liNextEntry
+/**
+ * Returns the RID of the next key of a scan.
+ *
+ * @param handle The scan.
+ * @param result Receives the RID.
+ * @return RC_OK, RC_IM_NO_MORE_ENTRIES at the end, or an error code.
+ */
+RC liNextEntry(LI_ScanHandle *handle, RID *result) {
+    LI_IndexMgmt *t = INDEX_MGMT(handle->index);
+    LI_ScanMgmt *sm = (LI_ScanMgmt *) handle->mgmtData;
+    LI_Entry entry;
+    RC rc;
+
+    if (sm->pos >= t->header.numEntries)
+        return RC_IM_NO_MORE_ENTRIES;
+    if ((rc = entryAt(t, &sm->cursor, sm->pos, BM_HINT_SCAN, &entry)) != RC_OK)
+        return rc;
+    if (sm->bounded && entry.key > sm->high) {
+        sm->pos = t->header.numEntries;
+        return RC_IM_NO_MORE_ENTRIES;
+    }
+    sm->pos++;
+    *result = entry.rid;
+    return RC_OK;
+}
+
+// Release a scan
+RC closeLIScan(LI_ScanHandle *handle) {
+    LI_ScanMgmt *sm = (LI_ScanMgmt *) handle->mgmtData;
+
+    if (sm->cursor.pinned)
+        unpinPage(&INDEX_MGMT(handle->index)->pool, &sm->cursor.page);
+    free(sm);
+    free(handle);
+    return RC_OK;
+}
@@ -0,0 +1,54 @@
+#ifndef LEARNED_MGR_H
+#define LEARNED_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+
+// Learned index over read-only INT keys
+//
+// The index is bulk loaded once from all (key, RID) pairs, which it keeps
+// sorted by key in its data pages. Instead of a tree of separator keys it
+// stores a piecewise-linear model of the position of a key in that sorted
+// order: every segment predicts the position to within maxError entries.
+// Segments are found the same way, through a smaller model over their first
+// keys, up to a single segment. A lookup evaluates one segment per level
+// and searches at most 2 * maxError + 5 entries per level. Keys whose
+// positions grow steadily need few segments, so the model stays small
+// enough to be read into memory when the index opens.
+//
+// The index cannot be updated; rebuild it when the data changes.
+
+// structure for accessing learned indexes
+typedef struct LI_IndexHandle {
+  DataType keyType;
+  char *idxId;
+  void *mgmtData;
+} LI_IndexHandle;
+
+typedef struct LI_ScanHandle {
+  LI_IndexHandle *index;
+  void *mgmtData;
+} LI_ScanHandle;
+
+// bulk load an index from n pairs in any order, or from attribute attrNum
+// of every record of a table; keys must be unique
+extern RC createLearnedIndex (char *idxId, int *keys, RID *rids, int n, int maxError);
+extern RC buildLearnedIndex (char *idxId, RM_TableData *rel, int attrNum, int maxError);
+
+// destroy, open, and close an index
+extern RC openLearnedIndex (LI_IndexHandle **index, char *idxId);
+extern RC closeLearnedIndex (LI_IndexHandle *index);
+extern RC deleteLearnedIndex (char *idxId);
+
+// access information about an index; the model size is in bytes
+extern RC getLINumEntries (LI_IndexHandle *index, int *result);
+extern RC getLINumSegments (LI_IndexHandle *index, int *result);
+extern RC getLIModelSize (LI_IndexHandle *index, int *result);
+
+// index access; a scan covers low <= key <= high, where a NULL bound is open
+extern RC liFindKey (LI_IndexHandle *index, Value *key, RID *result);
+extern RC openLIScan (LI_IndexHandle *index, Value *low, Value *high, LI_ScanHandle **handle);
+extern RC liNextEntry (LI_ScanHandle *handle, RID *result);
+extern RC closeLIScan (LI_ScanHandle *handle);
+
+#endif // LEARNED_MGR_H
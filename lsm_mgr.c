@@ -0,0 +1,1194 @@
+#include "lsm_mgr.h"
+#include "storage_mgr.h"
+#include "bloom.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// LSM storage of a table
+//
+// Sorted file layout: page 0 is an LSM_FileHeader. Pages 1 to numDataPages
+// hold entries sorted by key, each page an int count followed by entries of
+// entrySize bytes: the 8-byte key, a deleted flag and the record. The
+// sparse index (the first key of every data page) and the blocked bloom
+// filter (see bloom.h) follow in whole pages. Both are read into memory when
+// the file is opened, so a lookup reads at most one data page per file, and
+// none for a file whose key range or bloom filter rules the key out.
+//
+// The manifest page lists the files, newest first. Every file of a tier is
+// newer than every file of the tiers above it, so the list is grouped by
+// tier and a merge of the files of one tier replaces them in place. Delete
+// markers are dropped by a merge that includes the oldest file.
+//
+// There is no log: the memtable is written out when the table is closed.
+
+#define LSM_MAX_LEVEL 16
+
+// Manifest, stored at the start of page 0 of <name>.lsm
+typedef struct LSM_Manifest {
+    int recordSize;
+    int memtableSize;   // bytes of records held in memory before a flush
+    int tierFanout;     // files of one tier that are merged together
+    int nextId;         // page of the next RID handed out
+    int nextFileId;
+    int numTuples;
+    int numFiles;
+    int files[][2];     // file id and tier of every file, newest first
+} LSM_Manifest;
+
+#define LSM_MAX_FILES ((int) ((PAGE_SIZE - sizeof(LSM_Manifest)) / (2 * sizeof(int))))
+
+// Header of a sorted file, stored at the start of its page 0
+typedef struct LSM_FileHeader {
+    int numEntries;
+    int numDataPages;
+    int bloomBlocks;
+    unsigned long long lastKey;
+} LSM_FileHeader;
+
+// Memtable entry; next has one pointer per level of the entry
+typedef struct LSM_MemNode {
+    unsigned long long key;
+    bool deleted;
+    char *data;
+    struct LSM_MemNode *next[];
+} LSM_MemNode;
+
+// A sorted file while the table is open
+typedef struct LSM_TableFile {
+    int fileId;
+    int tier;
+    SM_FileHandle fh;
+    int numEntries;
+    int numDataPages;
+    unsigned long long *firstKeys;  // sparse index: first key of every data page
+    unsigned long long lastKey;
+    unsigned char *bloom;
+    int bloomBlocks;
+} LSM_TableFile;
+
+struct LSM_Tree {
+    char *name;
+    SM_FileHandle manifestFh;
+    int recordSize;
+    int entrySize;      // bytes of an entry in a data page
+    int entriesPerPage;
+    int memtableSize;
+    int tierFanout;
+    int nextId;
+    int nextFileId;
+    int numTuples;
+
+    LSM_MemNode *head;  // memtable: skiplist with a sentinel head
+    int level;          // levels in use
+    int memCount;
+    int memBytes;
+    unsigned int random;
+
+    LSM_TableFile *files;   // newest first
+    int numFiles;
+    char *page;             // page buffer of lookups
+    int activeScans;        // flushes wait while scans are open
+};
+
+// Position in the memtable or in one sorted file
+typedef struct LSM_Cursor {
+    LSM_MemNode *node;      // memtable cursor if file is NULL
+    LSM_TableFile *file;
+    char *page;             // current data page of the file
+    int pageIndex;
+    int pos;
+    int count;
+    bool valid;
+    unsigned long long key;
+    bool deleted;
+    char *data;
+} LSM_Cursor;
+
+// Merge of cursors ordered newest first: the newest version of a key wins
+typedef struct LSM_Merge {
+    LSM_Cursor *cursors;
+    int numCursors;
+    int recordSize;
+    int entrySize;
+    char *record;           // copy of the record returned last
+} LSM_Merge;
+
+struct LSM_Scan {
+    LSM_Tree *tree;
+    LSM_Merge merge;
+};
+
+// Writer of a new sorted file
+typedef struct LSM_Writer {
+    SM_FileHandle fh;
+    char *page;
+    int count;              // entries in page
+    int numEntries;
+    int numDataPages;
+    int indexCap;
+    unsigned long long *firstKeys;
+    unsigned long long lastKey;
+    unsigned char *bloom;
+    int bloomBlocks;
+} LSM_Writer;
+
+static unsigned long long ridToKey(RID rid) {
+    return ((unsigned long long) (unsigned int) rid.page << 32) | (unsigned int) rid.slot;
+}
+
+static RID keyToRid(unsigned long long key) {
+    RID rid;
+
+    rid.page = (int) (key >> 32);
+    rid.slot = (int) (key & 0xffffffffu);
+    return rid;
+}
+
+// Name of a file of the table: <name><suffix>, or <name>.sst<id>
+static char *fileName(char *name, const char *suffix, int id) {
+    int len = strlen(name) + 16;
+    char *result = (char *) malloc(len);
+
+    if (result == NULL)
+        return NULL;
+    if (suffix != NULL)
+        snprintf(result, len, "%s%s", name, suffix);
+    else
+        snprintf(result, len, "%s.sst%d", name, id);
+    return result;
+}
+
+static int pagesFor(int bytes) {
+    return (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+}
+
+// Level of a new memtable entry: each level holds about a quarter of the one below
+static int randomLevel(LSM_Tree *tree) {
+    int level = 1;
+
+    for (;;) {
+        tree->random ^= tree->random << 13;
+        tree->random ^= tree->random >> 17;
+        tree->random ^= tree->random << 5;
+        if ((tree->random & 3) != 0 || level == LSM_MAX_LEVEL)
+            return level;
+        level++;
+    }
+}
+
+// First memtable entry whose key is >= key; preds receives the entry
+// before it on every level
+static LSM_MemNode *memSeek(LSM_Tree *tree, unsigned long long key, LSM_MemNode **preds) {
+    LSM_MemNode *node = tree->head;
+    int i;
+
+    for (i = tree->level - 1; i >= 0; i--) {
+        while (node->next[i] != NULL && node->next[i]->key < key)
+            node = node->next[i];
+        if (preds)
+            preds[i] = node;
+    }
+    return node->next[0];
+}
+
+// memPut
+/**
+ * Adds a version of a key to the memtable, replacing the version there.
+ *
+ * @param tree The table.
+ * @param key The key.
+ * @param data The record, or NULL for a delete.
+ * @return RC_OK, or RC_MEM_ALLOCATION_FAIL.
+ */
+static RC memPut(LSM_Tree *tree, unsigned long long key, char *data) {
+    LSM_MemNode *preds[LSM_MAX_LEVEL];
+    LSM_MemNode *node = memSeek(tree, key, preds);
+    int level, i;
+
+    if (node == NULL || node->key != key) {
+        level = randomLevel(tree);
+        node = (LSM_MemNode *) malloc(sizeof(LSM_MemNode) + level * sizeof(LSM_MemNode *));
+        if (node == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        if ((node->data = (char *) malloc(tree->recordSize)) == NULL) {
+            free(node);
+            return RC_MEM_ALLOCATION_FAIL;
+        }
+        node->key = key;
+        for (i = tree->level; i < level; i++)
+            preds[i] = tree->head;
+        if (level > tree->level)
+            tree->level = level;
+        for (i = 0; i < level; i++) {
+            node->next[i] = preds[i]->next[i];
+            preds[i]->next[i] = node;
+        }
+        tree->memCount++;
+        tree->memBytes += tree->recordSize;
+    }
+
+    // the record buffer is kept for a delete, so open scans never see it freed
+    node->deleted = data == NULL;
+    if (data != NULL)
+        memcpy(node->data, data, tree->recordSize);
+    return RC_OK;
+}
+
+static void memClear(LSM_Tree *tree) {
+    LSM_MemNode *node = tree->head->next[0];
+    int i;
+
+    while (node != NULL) {
+        LSM_MemNode *next = node->next[0];
+        free(node->data);
+        free(node);
+        node = next;
+    }
+    for (i = 0; i < LSM_MAX_LEVEL; i++)
+        tree->head->next[i] = NULL;
+    tree->level = 1;
+    tree->memCount = 0;
+    tree->memBytes = 0;
+}
+
+// writeManifest
+/**
+ * Writes the table state and the list of files to the manifest.
+ *
+ * @param tree The table.
+ * @return RC_OK, or the error of the storage manager.
+ */
+static RC writeManifest(LSM_Tree *tree) {
+    char *page = (char *) calloc(PAGE_SIZE, sizeof(char));
+    LSM_Manifest *m = (LSM_Manifest *) page;
+    RC rc;
+    int i;
+
+    if (page == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    m->recordSize = tree->recordSize;
+    m->memtableSize = tree->memtableSize;
+    m->tierFanout = tree->tierFanout;
+    m->nextId = tree->nextId;
+    m->nextFileId = tree->nextFileId;
+    m->numTuples = tree->numTuples;
+    m->numFiles = tree->numFiles;
+    for (i = 0; i < tree->numFiles; i++) {
+        m->files[i][0] = tree->files[i].fileId;
+        m->files[i][1] = tree->files[i].tier;
+    }
+    rc = writeBlock(0, &tree->manifestFh, page);
+    free(page);
+    return rc;
+}
+
+// Read the pages from first on into a buffer of bytes bytes
+static RC readPages(SM_FileHandle *fh, int first, void *buffer, int bytes, char *page) {
+    int done, pageNum = first;
+    RC rc;
+
+    for (done = 0; done < bytes; done += PAGE_SIZE, pageNum++) {
+        int n = bytes - done < PAGE_SIZE ? bytes - done : PAGE_SIZE;
+        if ((rc = readBlock(pageNum, fh, page)) != RC_OK)
+            return rc;
+        memcpy((char *) buffer + done, page, n);
+    }
+    return RC_OK;
+}
+
+// openFile
+/**
+ * Opens a sorted file and reads its sparse index and bloom filter.
+ *
+ * @param tree The table.
+ * @param fileId The file.
+ * @param tier Its tier.
+ * @param file Receives the open file.
+ * @return RC_OK, or an error code.
+ */
+static RC openFile(LSM_Tree *tree, int fileId, int tier, LSM_TableFile *file) {
+    char *name = fileName(tree->name, NULL, fileId);
+    LSM_FileHeader header;
+    RC rc;
+
+    memset(file, 0, sizeof(LSM_TableFile));
+    if (name == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    rc = openPageFile(name, &file->fh);
+    free(name);
+    if (rc != RC_OK)
+        return rc;
+    if ((rc = readBlock(0, &file->fh, tree->page)) != RC_OK) {
+        closePageFile(&file->fh);
+        return rc;
+    }
+    memcpy(&header, tree->page, sizeof(LSM_FileHeader));
+
+    file->fileId = fileId;
+    file->tier = tier;
+    file->numEntries = header.numEntries;
+    file->numDataPages = header.numDataPages;
+    file->lastKey = header.lastKey;
+    file->bloomBlocks = header.bloomBlocks;
+    file->firstKeys = (unsigned long long *) malloc((header.numDataPages + 1) * sizeof(unsigned long long));
+    file->bloom = bloomCreate(header.bloomBlocks);
+    if (file->firstKeys == NULL || file->bloom == NULL) {
+        rc = RC_MEM_ALLOCATION_FAIL;
+    } else {
+        int indexBytes = header.numDataPages * sizeof(unsigned long long);
+        int indexPage = 1 + header.numDataPages;
+
+        rc = readPages(&file->fh, indexPage, file->firstKeys, indexBytes, tree->page);
+        if (rc == RC_OK)
+            rc = readPages(&file->fh, indexPage + pagesFor(indexBytes), file->bloom, header.bloomBlocks * BLOOM_BLOCK_SIZE, tree->page);
+    }
+    if (rc != RC_OK) {
+        free(file->firstKeys);
+        free(file->bloom);
+        closePageFile(&file->fh);
+    }
+    return rc;
+}
+
+static void closeFile(LSM_TableFile *file) {
+    free(file->firstKeys);
+    free(file->bloom);
+    closePageFile(&file->fh);
+}
+
+// startWriter
+/**
+ * Creates a new sorted file.
+ *
+ * @param tree The table.
+ * @param fileId The id of the new file.
+ * @param maxEntries Most entries the file will get; sizes the bloom filter.
+ * @param w Receives the writer.
+ * @return RC_OK, or an error code.
+ */
+static RC startWriter(LSM_Tree *tree, int fileId, int maxEntries, LSM_Writer *w) {
+    char *name = fileName(tree->name, NULL, fileId);
+    RC rc;
+
+    memset(w, 0, sizeof(LSM_Writer));
+    if (name == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    rc = createPageFile(name);
+    if (rc == RC_OK)
+        rc = openPageFile(name, &w->fh);
+    free(name);
+    if (rc != RC_OK)
+        return rc;
+
+    w->bloomBlocks = bloomBlocksFor(maxEntries);
+    w->indexCap = 16;
+    w->page = (char *) calloc(PAGE_SIZE, sizeof(char));
+    w->bloom = bloomCreate(w->bloomBlocks);
+    w->firstKeys = (unsigned long long *) malloc(w->indexCap * sizeof(unsigned long long));
+    if (w->page == NULL || w->bloom == NULL || w->firstKeys == NULL) {
+        free(w->page);
+        free(w->bloom);
+        free(w->firstKeys);
+        closePageFile(&w->fh);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    return RC_OK;
+}
+
+// Write the data page being filled
+static RC writeDataPage(LSM_Writer *w) {
+    RC rc;
+
+    memcpy(w->page, &w->count, sizeof(int));
+    if ((rc = writeBlock(1 + w->numDataPages, &w->fh, w->page)) != RC_OK)
+        return rc;
+    w->numDataPages++;
+    w->count = 0;
+    memset(w->page, 0, PAGE_SIZE);
+    return RC_OK;
+}
+
+// Append an entry; keys must come in increasing order
+static RC writerAdd(LSM_Tree *tree, LSM_Writer *w, unsigned long long key, bool deleted, const char *data) {
+    char *entry;
+    RC rc;
+
+    if (w->count == tree->entriesPerPage && (rc = writeDataPage(w)) != RC_OK)
+        return rc;
+    if (w->count == 0) {
+        if (w->numDataPages == w->indexCap) {
+            unsigned long long *keys = (unsigned long long *) realloc(w->firstKeys, 2 * w->indexCap * sizeof(unsigned long long));
+            if (keys == NULL)
+                return RC_MEM_ALLOCATION_FAIL;
+            w->firstKeys = keys;
+            w->indexCap *= 2;
+        }
+        w->firstKeys[w->numDataPages] = key;
+    }
+
+    entry = w->page + sizeof(int) + w->count * tree->entrySize;
+    memcpy(entry, &key, sizeof(key));
+    entry[sizeof(key)] = deleted ? 1 : 0;
+    memcpy(entry + sizeof(key) + 1, data, tree->recordSize);
+    bloomAdd(w->bloom, w->bloomBlocks, bloomHash(&key, sizeof(key)));
+    w->lastKey = key;
+    w->count++;
+    w->numEntries++;
+    return RC_OK;
+}
+
+// Write the memory buffer of bytes bytes to whole pages from first on
+static RC writePages(SM_FileHandle *fh, int first, const void *buffer, int bytes, char *page) {
+    int done, pageNum = first;
+    RC rc;
+
+    for (done = 0; done < bytes; done += PAGE_SIZE, pageNum++) {
+        int n = bytes - done < PAGE_SIZE ? bytes - done : PAGE_SIZE;
+        memset(page, 0, PAGE_SIZE);
+        memcpy(page, (const char *) buffer + done, n);
+        if ((rc = writeBlock(pageNum, fh, page)) != RC_OK)
+            return rc;
+    }
+    return RC_OK;
+}
+
+// finishWriter
+/**
+ * Writes the last data page, the sparse index, the bloom filter and the
+ * header of a new file and closes it.
+ *
+ * @param w The writer; released.
+ * @return RC_OK, or an error code.
+ */
+static RC finishWriter(LSM_Writer *w) {
+    LSM_FileHeader header;
+    int indexBytes;
+    RC rc = RC_OK;
+
+    if (w->count > 0)
+        rc = writeDataPage(w);
+    indexBytes = w->numDataPages * sizeof(unsigned long long);
+    if (rc == RC_OK)
+        rc = writePages(&w->fh, 1 + w->numDataPages, w->firstKeys, indexBytes, w->page);
+    if (rc == RC_OK)
+        rc = writePages(&w->fh, 1 + w->numDataPages + pagesFor(indexBytes), w->bloom, w->bloomBlocks * BLOOM_BLOCK_SIZE, w->page);
+
+    if (rc == RC_OK) {
+        memset(&header, 0, sizeof(header));
+        header.numEntries = w->numEntries;
+        header.numDataPages = w->numDataPages;
+        header.bloomBlocks = w->bloomBlocks;
+        header.lastKey = w->lastKey;
+        memset(w->page, 0, PAGE_SIZE);
+        memcpy(w->page, &header, sizeof(header));
+        rc = writeBlock(0, &w->fh, w->page);
+    }
+
+    free(w->page);
+    free(w->bloom);
+    free(w->firstKeys);
+    closePageFile(&w->fh);
+    return rc;
+}
+
+// Make the current entry of a cursor its key, flag and record
+static void cursorRead(LSM_Tree *tree, LSM_Cursor *c) {
+    if (c->file == NULL) {
+        c->valid = c->node != NULL;
+        if (c->valid) {
+            c->key = c->node->key;
+            c->deleted = c->node->deleted;
+            c->data = c->node->data;
+        }
+    } else {
+        char *entry = c->page + sizeof(int) + c->pos * tree->entrySize;
+        memcpy(&c->key, entry, sizeof(c->key));
+        c->deleted = entry[sizeof(c->key)] != 0;
+        c->data = entry + sizeof(c->key) + 1;
+    }
+}
+
+// Move a file cursor to the first entry of a data page
+static RC cursorLoadPage(LSM_Tree *tree, LSM_Cursor *c, int pageIndex) {
+    RC rc;
+
+    c->pageIndex = pageIndex;
+    c->pos = 0;
+    c->valid = pageIndex < c->file->numDataPages;
+    if (!c->valid)
+        return RC_OK;
+    if ((rc = readBlock(1 + pageIndex, &c->file->fh, c->page)) != RC_OK)
+        return rc;
+    memcpy(&c->count, c->page, sizeof(int));
+    cursorRead(tree, c);
+    return RC_OK;
+}
+
+static RC cursorAdvance(LSM_Tree *tree, LSM_Cursor *c) {
+    if (c->file == NULL) {
+        c->node = c->node->next[0];
+        cursorRead(tree, c);
+        return RC_OK;
+    }
+    if (++c->pos < c->count) {
+        cursorRead(tree, c);
+        return RC_OK;
+    }
+    return cursorLoadPage(tree, c, c->pageIndex + 1);
+}
+
+// startMerge
+/**
+ * Sets up a merge over files first to first + count - 1, preceded by the
+ * memtable if withMemtable is set.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC startMerge(LSM_Tree *tree, bool withMemtable, int first, int count, LSM_Merge *m) {
+    int i, n = 0;
+    RC rc = RC_OK;
+
+    memset(m, 0, sizeof(LSM_Merge));
+    m->cursors = (LSM_Cursor *) calloc(count + 1, sizeof(LSM_Cursor));
+    m->record = (char *) malloc(tree->recordSize);
+    if (m->cursors == NULL || m->record == NULL) {
+        free(m->cursors);
+        free(m->record);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+
+    if (withMemtable) {
+        m->cursors[n].node = tree->head->next[0];
+        cursorRead(tree, &m->cursors[n]);
+        n++;
+    }
+    for (i = 0; i < count && rc == RC_OK; i++, n++) {
+        m->cursors[n].file = &tree->files[first + i];
+        if ((m->cursors[n].page = (char *) malloc(PAGE_SIZE)) == NULL)
+            rc = RC_MEM_ALLOCATION_FAIL;
+        else
+            rc = cursorLoadPage(tree, &m->cursors[n], 0);
+    }
+    m->numCursors = n;
+    return rc;
+}
+
+static void endMerge(LSM_Merge *m) {
+    int i;
+
+    for (i = 0; i < m->numCursors; i++)
+        free(m->cursors[i].page);
+    free(m->cursors);
+    free(m->record);
+}
+
+// mergeNext
+/**
+ * Returns the newest version of the next key of a merge.
+ *
+ * @param tree The table.
+ * @param m The merge.
+ * @param key Receives the key.
+ * @param deleted Receives whether the version is a delete.
+ * @return RC_OK with the record in m->record, RC_RM_NO_MORE_TUPLES at the
+ *         end, or an error code.
+ */
+static RC mergeNext(LSM_Tree *tree, LSM_Merge *m, unsigned long long *key, bool *deleted) {
+    int winner = -1, i;
+    RC rc;
+
+    for (i = 0; i < m->numCursors; i++) {
+        if (m->cursors[i].valid && (winner < 0 || m->cursors[i].key < m->cursors[winner].key))
+            winner = i;
+    }
+    if (winner < 0)
+        return RC_RM_NO_MORE_TUPLES;
+
+    *key = m->cursors[winner].key;
+    *deleted = m->cursors[winner].deleted;
+    memcpy(m->record, m->cursors[winner].data, tree->recordSize);
+
+    // older versions of the key are skipped
+    for (i = winner; i < m->numCursors; i++) {
+        if (m->cursors[i].valid && m->cursors[i].key == *key && (rc = cursorAdvance(tree, &m->cursors[i])) != RC_OK)
+            return rc;
+    }
+    return RC_OK;
+}
+
+// Remove a sorted file from disk
+static void destroyFile(LSM_Tree *tree, LSM_TableFile *file) {
+    char *name = fileName(tree->name, NULL, file->fileId);
+
+    closeFile(file);
+    if (name != NULL)
+        destroyPageFile(name);
+    free(name);
+}
+
+// compactTier
+/**
+ * Merges the count files from first on, all of one tier, into one file of
+ * the next tier that takes their place in the list.
+ *
+ * @return RC_OK, or an error code.
+ */
+static RC compactTier(LSM_Tree *tree, int first, int count) {
+    bool dropDeletes = first + count == tree->numFiles;
+    unsigned long long key;
+    LSM_TableFile merged;
+    LSM_Writer w;
+    LSM_Merge m;
+    bool deleted;
+    int fileId = tree->nextFileId++;
+    int maxEntries = 0, i;
+    RC rc;
+
+    for (i = first; i < first + count; i++)
+        maxEntries += tree->files[i].numEntries;
+    if ((rc = startWriter(tree, fileId, maxEntries, &w)) != RC_OK)
+        return rc;
+    if ((rc = startMerge(tree, false, first, count, &m)) != RC_OK) {
+        finishWriter(&w);
+        return rc;
+    }
+    while ((rc = mergeNext(tree, &m, &key, &deleted)) == RC_OK) {
+        if (deleted && dropDeletes)
+            continue;
+        if ((rc = writerAdd(tree, &w, key, deleted, m.record)) != RC_OK)
+            break;
+    }
+    endMerge(&m);
+    if (rc == RC_RM_NO_MORE_TUPLES)
+        rc = RC_OK;
+    if (rc == RC_OK)
+        rc = finishWriter(&w);
+    else
+        finishWriter(&w);
+    if (rc == RC_OK)
+        rc = openFile(tree, fileId, tree->files[first].tier + 1, &merged);
+    if (rc != RC_OK)
+        return rc;
+
+    for (i = first; i < first + count; i++)
+        destroyFile(tree, &tree->files[i]);
+    tree->files[first] = merged;
+    memmove(tree->files + first + 1, tree->files + first + count,
+            (tree->numFiles - first - count) * sizeof(LSM_TableFile));
+    tree->numFiles -= count - 1;
+    return RC_OK;
+}
+
+// Merge every tier that has tierFanout files, lowest tier first
+static RC compact(LSM_Tree *tree) {
+    int first = 0;
+    RC rc;
+
+    while (first < tree->numFiles) {
+        int tier = tree->files[first].tier, count = 0;
+
+        while (first + count < tree->numFiles && tree->files[first + count].tier == tier)
+            count++;
+        if (count >= tree->tierFanout) {
+            if ((rc = compactTier(tree, first, count)) != RC_OK)
+                return rc;
+            continue;   // the merged file may fill the next tier
+        }
+        first += count;
+    }
+    return RC_OK;
+}
+
+// lsmFlush
+/**
+ * Writes the memtable out as a new file of tier 0 and merges full tiers.
+ *
+ * @param tree The table.
+ * @return RC_OK, or an error code.
+ */
+RC lsmFlush(LSM_Tree *tree) {
+    LSM_MemNode *node;
+    LSM_TableFile file;
+    LSM_Writer w;
+    int fileId;
+    RC rc = RC_OK;
+
+    if (tree->memCount == 0)
+        return RC_OK;
+    if (tree->numFiles == LSM_MAX_FILES)
+        return RC_WRITE_FAILED;
+
+    fileId = tree->nextFileId++;
+    if ((rc = startWriter(tree, fileId, tree->memCount, &w)) != RC_OK)
+        return rc;
+    for (node = tree->head->next[0]; node != NULL && rc == RC_OK; node = node->next[0]) {
+        // with no older file a delete has nothing left to hide
+        if (node->deleted && tree->numFiles == 0)
+            continue;
+        rc = writerAdd(tree, &w, node->key, node->deleted, node->data);
+    }
+    if (rc == RC_OK)
+        rc = finishWriter(&w);
+    else
+        finishWriter(&w);
+    if (rc == RC_OK)
+        rc = openFile(tree, fileId, 0, &file);
+    if (rc != RC_OK)
+        return rc;
+
+    memmove(tree->files + 1, tree->files, tree->numFiles * sizeof(LSM_TableFile));
+    tree->files[0] = file;
+    tree->numFiles++;
+    memClear(tree);
+
+    if ((rc = compact(tree)) != RC_OK)
+        return rc;
+    return writeManifest(tree);
+}
+
+// Flush once the memtable is full, unless a scan is reading it
+static RC flushIfFull(LSM_Tree *tree) {
+    if (tree->memBytes < tree->memtableSize || tree->activeScans > 0)
+        return RC_OK;
+    return lsmFlush(tree);
+}
+
+// lsmCreate
+/**
+ * Creates the manifest of an empty table.
+ *
+ * @param name Name of the table.
+ * @param recordSize Bytes of a record.
+ * @param memtableSize Bytes of records held in memory before a flush.
+ * @param tierFanout Files of one tier that are merged into the next.
+ * @return RC_OK, RC_INVALID_ARGS for a record that does not fit a page or
+ *         a fanout below 2, or an error code.
+ */
+RC lsmCreate(char *name, int recordSize, int memtableSize, int tierFanout) {
+    char *manifest = fileName(name, ".lsm", 0);
+    SM_FileHandle fh;
+    LSM_Manifest *m;
+    char *page;
+    RC rc;
+
+    if (manifest == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    if (recordSize + (int) sizeof(unsigned long long) + 1 > PAGE_SIZE - (int) sizeof(int)
+            || memtableSize < 1 || tierFanout < 2) {
+        free(manifest);
+        return RC_INVALID_ARGS;
+    }
+
+    rc = createPageFile(manifest);
+    if (rc == RC_OK)
+        rc = openPageFile(manifest, &fh);
+    free(manifest);
+    if (rc != RC_OK)
+        return rc;
+
+    page = (char *) calloc(PAGE_SIZE, sizeof(char));
+    if (page == NULL) {
+        closePageFile(&fh);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    m = (LSM_Manifest *) page;
+    m->recordSize = recordSize;
+    m->memtableSize = memtableSize;
+    m->tierFanout = tierFanout;
+    rc = writeBlock(0, &fh, page);
+    free(page);
+    closePageFile(&fh);
+    return rc;
+}
+
+// Whether a table has LSM storage
+bool lsmExists(char *name) {
+    char *manifest = fileName(name, ".lsm", 0);
+    FILE *file;
+
+    if (manifest == NULL)
+        return false;
+    file = fopen(manifest, "rb");
+    free(manifest);
+    if (file == NULL)
+        return false;
+    fclose(file);
+    return true;
+}
+
+// lsmOpen
+/**
+ * Opens the storage of a table: reads the manifest and opens its files.
+ *
+ * @param name Name of the table.
+ * @param tree Receives the open storage; release it with lsmClose.
+ * @return RC_OK, or an error code.
+ */
+RC lsmOpen(char *name, LSM_Tree **tree) {
+    char *manifest = fileName(name, ".lsm", 0);
+    LSM_Manifest *m;
+    LSM_Tree *t;
+    RC rc;
+    int i;
+
+    *tree = NULL;
+    t = (LSM_Tree *) calloc(1, sizeof(LSM_Tree));
+    if (manifest == NULL || t == NULL) {
+        free(manifest);
+        free(t);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    rc = openPageFile(manifest, &t->manifestFh);
+    free(manifest);
+    if (rc != RC_OK) {
+        free(t);
+        return rc;
+    }
+
+    t->name = strdup(name);
+    t->page = (char *) malloc(PAGE_SIZE);
+    t->head = (LSM_MemNode *) calloc(1, sizeof(LSM_MemNode) + LSM_MAX_LEVEL * sizeof(LSM_MemNode *));
+    t->files = (LSM_TableFile *) calloc(LSM_MAX_FILES, sizeof(LSM_TableFile));
+    if (t->name == NULL || t->page == NULL || t->head == NULL || t->files == NULL) {
+        rc = RC_MEM_ALLOCATION_FAIL;
+    } else {
+        rc = readBlock(0, &t->manifestFh, t->page);
+    }
+    if (rc != RC_OK) {
+        closePageFile(&t->manifestFh);
+        free(t->name);
+        free(t->page);
+        free(t->head);
+        free(t->files);
+        free(t);
+        return rc;
+    }
+
+    m = (LSM_Manifest *) t->page;
+    t->recordSize = m->recordSize;
+    t->entrySize = sizeof(unsigned long long) + 1 + m->recordSize;
+    t->entriesPerPage = (PAGE_SIZE - sizeof(int)) / t->entrySize;
+    t->memtableSize = m->memtableSize;
+    t->tierFanout = m->tierFanout;
+    t->nextId = m->nextId;
+    t->nextFileId = m->nextFileId;
+    t->numTuples = m->numTuples;
+    t->level = 1;
+    t->random = 2463534242u;
+
+    // openFile reuses the page buffer, so take the list out of it first
+    t->numFiles = m->numFiles;
+    for (i = 0; i < t->numFiles; i++) {
+        t->files[i].fileId = m->files[i][0];
+        t->files[i].tier = m->files[i][1];
+    }
+    for (i = 0; i < t->numFiles; i++) {
+        if ((rc = openFile(t, t->files[i].fileId, t->files[i].tier, &t->files[i])) != RC_OK) {
+            t->numFiles = i;
+            lsmClose(t);
+            return rc;
+        }
+    }
+
+    *tree = t;
+    return RC_OK;
+}
+
+// lsmClose
+/**
+ * Writes the memtable out and releases the storage of a table.
+ *
+ * @param tree The table.
+ * @return RC_OK, or an error code.
+ */
+RC lsmClose(LSM_Tree *tree) {
+    RC rc = lsmFlush(tree);
+    int i;
+
+    if (rc == RC_OK)
+        rc = writeManifest(tree);
+    for (i = 0; i < tree->numFiles; i++)
+        closeFile(&tree->files[i]);
+    closePageFile(&tree->manifestFh);
+
+    memClear(tree);
+    free(tree->head);
+    free(tree->files);
+    free(tree->page);
+    free(tree->name);
+    free(tree);
+    return rc;
+}
+
+// lsmDestroy
+/**
+ * Removes the manifest and every sorted file of a table.
+ *
+ * @param name Name of the table.
+ * @return RC_OK, or an error code.
+ */
+RC lsmDestroy(char *name) {
+    char *manifest = fileName(name, ".lsm", 0);
+    SM_FileHandle fh;
+    LSM_Manifest *m;
+    char *page = (char *) malloc(PAGE_SIZE);
+    RC rc;
+    int i;
+
+    if (manifest == NULL || page == NULL) {
+        free(manifest);
+        free(page);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    rc = openPageFile(manifest, &fh);
+    if (rc == RC_OK) {
+        rc = readBlock(0, &fh, page);
+        closePageFile(&fh);
+    }
+    if (rc == RC_OK) {
+        m = (LSM_Manifest *) page;
+        for (i = 0; i < m->numFiles; i++) {
+            char *sst = fileName(name, NULL, m->files[i][0]);
+            if (sst != NULL)
+                destroyPageFile(sst);
+            free(sst);
+        }
+        rc = destroyPageFile(manifest);
+    }
+    free(manifest);
+    free(page);
+    return rc;
+}
+
+// lsmTruncate
+/**
+ * Removes every record of an open table: the memtable is dropped without
+ * being written and the sorted files are deleted. RIDs keep counting up
+ * from where they were.
+ *
+ * @param tree The table.
+ * @return RC_OK, RC_INVALID_ARGS while a scan is open, or an error code.
+ */
+RC lsmTruncate(LSM_Tree *tree) {
+    int numFiles = tree->numFiles;
+    RC rc;
+    int i;
+
+    if (tree->activeScans > 0)
+        return RC_INVALID_ARGS;
+    memClear(tree);
+    tree->numFiles = 0;
+    tree->numTuples = 0;
+
+    // Forget the files before removing them
+    rc = writeManifest(tree);
+    for (i = 0; i < numFiles; i++) {
+        char *sst = fileName(tree->name, NULL, tree->files[i].fileId);
+        closeFile(&tree->files[i]);
+        if (sst != NULL)
+            destroyPageFile(sst);
+        free(sst);
+    }
+    return rc;
+}
+
+// lsmInsert
+/**
+ * Inserts a record under a new RID.
+ *
+ * @param tree The table.
+ * @param data The record.
+ * @param rid Receives its RID.
+ * @return RC_OK, or an error code.
+ */
+RC lsmInsert(LSM_Tree *tree, char *data, RID *rid) {
+    RC rc;
+
+    rid->page = tree->nextId;
+    rid->slot = 0;
+    if ((rc = memPut(tree, ridToKey(*rid), data)) != RC_OK)
+        return rc;
+    tree->nextId++;
+    tree->numTuples++;
+    return flushIfFull(tree);
+}
+
+// Write a new version of the record of a RID
+RC lsmUpdate(LSM_Tree *tree, RID rid, char *data) {
+    RC rc;
+
+    if ((rc = memPut(tree, ridToKey(rid), data)) != RC_OK)
+        return rc;
+    return flushIfFull(tree);
+}
+
+// Write a delete of the record of a RID
+RC lsmDelete(LSM_Tree *tree, RID rid) {
+    RC rc;
+
+    if ((rc = memPut(tree, ridToKey(rid), NULL)) != RC_OK)
+        return rc;
+    tree->numTuples--;
+    return flushIfFull(tree);
+}
+
+// findInFile
+/**
+ * Looks a key up in one sorted file.
+ *
+ * @param tree The table.
+ * @param file The file.
+ * @param key The key.
+ * @param entry Receives the entry, in the table's page buffer.
+ * @return RC_OK if the file has the key, RC_RM_RECORD_NOT_EXIST if not, or
+ *         an error code.
+ */
+static RC findInFile(LSM_Tree *tree, LSM_TableFile *file, unsigned long long key, char **entry) {
+    int lo = 0, hi = file->numDataPages, count;
+    RC rc;
+
+    if (file->numDataPages == 0 || key < file->firstKeys[0] || key > file->lastKey)
+        return RC_RM_RECORD_NOT_EXIST;
+    if (!bloomMayContain(file->bloom, file->bloomBlocks, bloomHash(&key, sizeof(key))))
+        return RC_RM_RECORD_NOT_EXIST;
+
+    // last data page whose first key is <= key
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (file->firstKeys[mid] <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if ((rc = readBlock(lo, &file->fh, tree->page)) != RC_OK)
+        return rc;
+    memcpy(&count, tree->page, sizeof(int));
+
+    lo = 0;
+    hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        unsigned long long k;
+        memcpy(&k, tree->page + sizeof(int) + mid * tree->entrySize, sizeof(k));
+        if (k < key)
+            lo = mid + 1;
+        else if (k > key)
+            hi = mid;
+        else {
+            *entry = tree->page + sizeof(int) + mid * tree->entrySize;
+            return RC_OK;
+        }
+    }
+    return RC_RM_RECORD_NOT_EXIST;
+}
+
+// lsmGet
+/**
+ * Reads the newest version of the record of a RID: from the memtable, or
+ * from the newest file that has the key.
+ *
+ * @param tree The table.
+ * @param rid The RID.
+ * @param data Receives the record.
+ * @return RC_OK, RC_RM_RECORD_NOT_EXIST for a deleted or unknown RID, or
+ *         an error code.
+ */
+RC lsmGet(LSM_Tree *tree, RID rid, char *data) {
+    unsigned long long key = ridToKey(rid);
+    LSM_MemNode *node = memSeek(tree, key, NULL);
+    char *entry;
+    RC rc;
+    int i;
+
+    if (node != NULL && node->key == key) {
+        if (node->deleted)
+            return RC_RM_RECORD_NOT_EXIST;
+        memcpy(data, node->data, tree->recordSize);
+        return RC_OK;
+    }
+
+    for (i = 0; i < tree->numFiles; i++) {
+        rc = findInFile(tree, &tree->files[i], key, &entry);
+        if (rc == RC_RM_RECORD_NOT_EXIST)
+            continue;
+        if (rc != RC_OK)
+            return rc;
+        if (entry[sizeof(unsigned long long)])
+            return RC_RM_RECORD_NOT_EXIST;
+        memcpy(data, entry + sizeof(unsigned long long) + 1, tree->recordSize);
+        return RC_OK;
+    }
+    return RC_RM_RECORD_NOT_EXIST;
+}
+
+// Get the number of live records
+int lsmNumTuples(LSM_Tree *tree) {
+    return tree->numTuples;
+}
+
+// Get the number of sorted files
+int lsmNumFiles(LSM_Tree *tree) {
+    return tree->numFiles;
+}
+
+// lsmOpenScan
+/**
+ * Starts a scan over the memtable and every file. The memtable is not
+ * flushed while the scan is open.
+ *
+ * @param tree The table.
+ * @param scan Receives the scan; release it with lsmCloseScan.
+ * @return RC_OK, or an error code.
+ */
+RC lsmOpenScan(LSM_Tree *tree, LSM_Scan **scan) {
+    LSM_Scan *s = (LSM_Scan *) malloc(sizeof(LSM_Scan));
+    RC rc;
+
+    *scan = NULL;
+    if (s == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    if ((rc = startMerge(tree, true, 0, tree->numFiles, &s->merge)) != RC_OK) {
+        endMerge(&s->merge);
+        free(s);
+        return rc;
+    }
+    s->tree = tree;
+    tree->activeScans++;
+    *scan = s;
+    return RC_OK;
+}
+
+// lsmNext
+/**
+ * Returns the next live record of a scan.
+ *
+ * @param scan The scan.
+ * @param rid Receives the RID of the record.
+ * @param data Receives the record, valid until the next call.
+ * @return RC_OK, RC_RM_NO_MORE_TUPLES at the end, or an error code.
+ */
+RC lsmNext(LSM_Scan *scan, RID *rid, char **data) {
+    unsigned long long key;
+    bool deleted;
+    RC rc;
+
+    while ((rc = mergeNext(scan->tree, &scan->merge, &key, &deleted)) == RC_OK) {
+        if (deleted)
+            continue;
+        *rid = keyToRid(key);
+        *data = scan->merge.record;
+        return RC_OK;
+    }
+    return rc;
+}
+
+// Close a scan; a memtable that filled while it was open is written out
+RC lsmCloseScan(LSM_Scan *scan) {
+    LSM_Tree *tree = scan->tree;
+
+    endMerge(&scan->merge);
+    free(scan);
+    tree->activeScans--;
+    return flushIfFull(tree);
+}
@@ -0,0 +1,51 @@
+#ifndef LSM_MGR_H
+#define LSM_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+
+// Log-structured storage of the records of an RM_ENGINE_LSM table
+//
+// Writes go to a sorted in-memory table (a skiplist). When it holds
+// memtableSize bytes of records it is written out in one sequential pass as
+// an immutable sorted file, with a sparse index of the first key of every
+// page and a bloom filter over its keys. Files are grouped in tiers: when
+// tierFanout files share a tier they are merged into one file of the next
+// tier. Records are keyed by their RID, which insert hands out in
+// increasing order; an update or delete writes a new version of the key,
+// and the newest version wins.
+//
+// Files of table <name>: the manifest <name>.lsm and the sorted files
+// <name>.sst<n>.
+
+typedef struct LSM_Tree LSM_Tree;
+typedef struct LSM_Scan LSM_Scan;
+
+// create, open, close, and destroy the storage of a table
+extern RC lsmCreate (char *name, int recordSize, int memtableSize, int tierFanout);
+extern rm_bool lsmExists (char *name);
+extern RC lsmOpen (char *name, LSM_Tree **tree);
+extern RC lsmClose (LSM_Tree *tree);
+extern RC lsmDestroy (char *name);
+
+// remove every record at once, without writing the memtable out
+extern RC lsmTruncate (LSM_Tree *tree);
+
+// records; lsmGet copies the record into data
+extern RC lsmInsert (LSM_Tree *tree, char *data, RID *rid);
+extern RC lsmUpdate (LSM_Tree *tree, RID rid, char *data);
+extern RC lsmDelete (LSM_Tree *tree, RID rid);
+extern RC lsmGet (LSM_Tree *tree, RID rid, char *data);
+extern int lsmNumTuples (LSM_Tree *tree);
+
+// write the memtable out now; files currently on disk
+extern RC lsmFlush (LSM_Tree *tree);
+extern int lsmNumFiles (LSM_Tree *tree);
+
+// scans return the live records in RID order; data stays valid until the
+// next call
+extern RC lsmOpenScan (LSM_Tree *tree, LSM_Scan **scan);
+extern RC lsmNext (LSM_Scan *scan, RID *rid, char **data);
+extern RC lsmCloseScan (LSM_Scan *scan);
+
+#endif // LSM_MGR_H
@@ -0,0 +1,243 @@
+#include "norm_key.h"
+#include "record_mgr.h"
+#include "expr.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void putBigEndian(unsigned int v, char *out) {
+    out[0] = (char) (v >> 24);
+    out[1] = (char) (v >> 16);
+    out[2] = (char) (v >> 8);
+    out[3] = (char) v;
+}
+
+static unsigned int getBigEndian(const char *in) {
+    const unsigned char *p = (const unsigned char *) in;
+    return ((unsigned int) p[0] << 24) | ((unsigned int) p[1] << 16) | ((unsigned int) p[2] << 8) | p[3];
+}
+
+// normKeyAttrSize
+/**
+ * Returns the number of bytes an attribute takes in a normalized key.
+ *
+ * @param dt The data type of the attribute.
+ * @param typeLength The length of a DT_STRING attribute.
+ * @return The size in bytes, or -1 for an unknown type.
+ */
+int normKeyAttrSize(DataType dt, int typeLength) {
+    switch (dt) {
+    case DT_INT:
+    case DT_FLOAT:
+        return 4;
+    case DT_BOOL:
+        return 1;
+    case DT_STRING:
+        return typeLength + 1;
+    default:
+        return -1;
+    }
+}
+
+// normalizeValue
+/**
+ * Writes the normalized form of a value.
+ *
+ * @param value The value.
+ * @param typeLength The length of the attribute if value is a string;
+ *        longer strings are cut.
+ * @param out Receives normKeyAttrSize(value->dt, typeLength) bytes.
+ * @return RC_OK, or RC_RM_UNKNOWN_DATATYPE.
+ */
+RC normalizeValue(Value *value, int typeLength, char *out) {
+    unsigned int bits;
+    float f;
+    int len;
+
+    switch (value->dt) {
+    case DT_INT:
+        putBigEndian((unsigned int) value->v.intV ^ 0x80000000u, out);
+        return RC_OK;
+    case DT_FLOAT:
+        // -0.0 and 0.0 compare equal, so they must encode the same
+        f = value->v.floatV == 0.0f ? 0.0f : value->v.floatV;
+        memcpy(&bits, &f, sizeof(bits));
+        putBigEndian(bits & 0x80000000u ? ~bits : bits | 0x80000000u, out);
+        return RC_OK;
+    case DT_BOOL:
+        out[0] = value->v.boolV ? 1 : 0;
+        return RC_OK;
+    case DT_STRING:
+        len = strnlen(value->v.stringV, typeLength);
+        memcpy(out, value->v.stringV, len);
+        memset(out + len, 0, typeLength + 1 - len);
+        return RC_OK;
+    default:
+        return RC_RM_UNKNOWN_DATATYPE;
+    }
+}
+
+// denormalizeValue
+/**
+ * Reads a value back from its normalized form.
+ *
+ * @param in The normalized attribute.
+ * @param dt Its data type.
+ * @param typeLength Its length if it is a string.
+ * @param value Receives a new Value; free it with freeVal.
+ * @return RC_OK, or an error code.
+ */
+RC denormalizeValue(const char *in, DataType dt, int typeLength, Value **value) {
+    unsigned int bits;
+    Value *v = (Value *) malloc(sizeof(Value));
+
+    if (v == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    v->dt = dt;
+
+    switch (dt) {
+    case DT_INT:
+        v->v.intV = (int) (getBigEndian(in) ^ 0x80000000u);
+        break;
+    case DT_FLOAT:
+        bits = getBigEndian(in);
+        bits = bits & 0x80000000u ? bits & 0x7fffffffu : ~bits;
+        memcpy(&v->v.floatV, &bits, sizeof(bits));
+        break;
+    case DT_BOOL:
+        v->v.boolV = in[0] != 0;
+        break;
+    case DT_STRING:
+        v->v.stringV = (char *) malloc(typeLength + 1);
+        memcpy(v->v.stringV, in, typeLength + 1);
+        break;
+    default:
+        free(v);
+        return RC_RM_UNKNOWN_DATATYPE;
+    }
+    *value = v;
+    return RC_OK;
+}
+
+// normalizeRecordKey
+/**
+ * Writes the normalized key of some attributes of a record, in the order
+ * given. Sorting records by these keys with memcmp sorts them by the
+ * attributes.
+ *
+ * @param schema The schema of the record.
+ * @param record The record.
+ * @param numAttrs Number of key attributes.
+ * @param attrs Their positions in the schema.
+ * @param out Receives the key: the sum of normKeyAttrSize over the attributes.
+ * @return RC_OK, or an error code.
+ */
+RC normalizeRecordKey(Schema *schema, Record *record, int numAttrs, int *attrs, char *out) {
+    Value *value;
+    RC rc;
+    int i;
+
+    for (i = 0; i < numAttrs; i++) {
+        int attr = attrs[i];
+
+        if (attr < 0 || attr >= schema->numAttr)
+            return RC_INVALID_ATTR_NUM;
+        if ((rc = getAttr(record, schema, attr, &value)) != RC_OK)
+            return rc;
+        rc = normalizeValue(value, schema->typeLength[attr], out);
+        freeVal(value);
+        if (rc != RC_OK)
+            return rc;
+        out += normKeyAttrSize(schema->dataTypes[attr], schema->typeLength[attr]);
+    }
+    return RC_OK;
+}
+
+// Moves the high end of a range down to value, or the low end up
+static void narrow(char *bound, rm_bool *has, rm_bool *strict, const char *value, bool isStrict, int size,
+                   int sign) {
+    int cmp = *has ? memcmp(value, bound, size) * sign : -1;
+
+    if (cmp < 0) {
+        memcpy(bound, value, size);
+        *strict = isStrict;
+    } else if (cmp == 0) {
+        *strict = *strict || isStrict;
+    }
+    *has = true;
+}
+
+static RC rangeOf(Schema *schema, int attr, Expr *cond, bool negated, NK_Range *range) {
+    int size = normKeyAttrSize(schema->dataTypes[attr], schema->typeLength[attr]);
+    Operator *op;
+    Value *cons;
+    bool consFirst;
+    char value[size];
+    RC rc;
+
+    if (cond->type != EXPR_OP)
+        return RC_OK;
+    op = cond->expr.op;
+    if (op->type == OP_BOOL_NOT)
+        return rangeOf(schema, attr, op->args[0], !negated, range);
+    if (op->type == OP_BOOL_AND && !negated) {
+        if ((rc = rangeOf(schema, attr, op->args[0], false, range)) != RC_OK)
+            return rc;
+        return rangeOf(schema, attr, op->args[1], false, range);
+    }
+    if (op->type != OP_COMP_EQUAL && op->type != OP_COMP_SMALLER)
+        return RC_OK;
+
+    if (op->args[0]->type == EXPR_ATTRREF && op->args[1]->type == EXPR_CONST
+            && op->args[0]->expr.attrRef == attr) {
+        cons = op->args[1]->expr.cons;
+        consFirst = false;
+    } else if (op->args[0]->type == EXPR_CONST && op->args[1]->type == EXPR_ATTRREF
+            && op->args[1]->expr.attrRef == attr) {
+        cons = op->args[0]->expr.cons;
+        consFirst = true;
+    } else {
+        return RC_OK;
+    }
+    if (cons->dt != schema->dataTypes[attr] || (op->type == OP_COMP_SMALLER && cons->dt == DT_BOOL))
+        return RC_OK;
+    if (cons->dt == DT_STRING && strlen(cons->v.stringV) > (size_t) schema->typeLength[attr])
+        return RC_OK;   // a cut value would misorder it
+    if ((rc = normalizeValue(cons, schema->typeLength[attr], value)) != RC_OK)
+        return rc;
+
+    if (op->type == OP_COMP_EQUAL) {
+        if (negated)
+            return RC_OK;
+        narrow(range->high, &range->hasHigh, &range->highStrict, value, false, size, 1);
+        narrow(range->low, &range->hasLow, &range->lowStrict, value, false, size, -1);
+    } else if (consFirst == negated) {
+        // attr < c, or NOT (c < attr), that is attr <= c
+        narrow(range->high, &range->hasHigh, &range->highStrict, value, !negated, size, 1);
+    } else {
+        // c < attr, or NOT (attr < c), that is c <= attr
+        narrow(range->low, &range->hasLow, &range->lowStrict, value, !negated, size, -1);
+    }
+    return RC_OK;
+}
+
+// normKeyRange
+/**
+ * Works out the range of an attribute a condition lets through from its
+ * comparisons (= and <, in either order) with constants of the attribute's
+ * type, under ANDs and NOTs. Comparisons with other attributes, ORs and
+ * negated equalities leave the range as it is, so every record the
+ * condition accepts lies in the range, but not every record of the range
+ * passes the condition.
+ *
+ * @param schema The schema of the records.
+ * @param attr The attribute.
+ * @param cond The condition.
+ * @param range Its low and high point at normKeyAttrSize bytes each; the
+ *        rest is set.
+ * @return RC_OK, or an error code.
+ */
+RC normKeyRange(Schema *schema, int attr, Expr *cond, NK_Range *range) {
+    range->hasLow = range->hasHigh = false;
+    range->lowStrict = range->highStrict = false;
+    return rangeOf(schema, attr, cond, false, range);
+}
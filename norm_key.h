@@ -0,0 +1,45 @@
+#ifndef NORM_KEY_H
+#define NORM_KEY_H
+
+#include "dberror.h"
+#include "tables.h"
+#include "expr.h"
+
+// Normalized keys
+//
+// A normalized key is a byte string whose memcmp order is the order of the
+// values it was made from, attribute by attribute. Ints are stored as 4
+// big-endian bytes with the sign bit flipped. Floats are stored as 4
+// big-endian bytes with the sign bit flipped for positive values and all
+// bits flipped for negative ones. Bools take 1 byte. A string of typeLength
+// n takes its characters zero-padded to n + 1 bytes, so a prefix sorts
+// before the longer string. Every attribute has a fixed size, so all keys
+// over the same attributes have the same length and can be compared, sorted
+// and searched without looking at the types again.
+
+// size of one attribute in a normalized key
+extern int normKeyAttrSize (DataType dt, int typeLength);
+
+// encode or decode one attribute; typeLength is only used for strings
+extern RC normalizeValue (Value *value, int typeLength, char *out);
+extern RC denormalizeValue (const char *in, DataType dt, int typeLength, Value **value);
+
+// encode attributes attrs[0..numAttrs-1] of a record into one key
+extern RC normalizeRecordKey (Schema *schema, Record *record, int numAttrs, int *attrs, char *out);
+
+// range of one attribute a condition lets through, as normalized values;
+// the caller points low and high at normKeyAttrSize bytes each
+typedef struct NK_Range {
+  char *low;
+  char *high;
+  rm_bool hasLow;
+  rm_bool hasHigh;
+  rm_bool lowStrict;    // low itself is excluded
+  rm_bool highStrict;   // high itself is excluded
+} NK_Range;
+
+// narrow the range of attribute attr by the comparisons of cond between it
+// and a constant, under ANDs and NOTs; other parts of cond are ignored
+extern RC normKeyRange (Schema *schema, int attr, Expr *cond, NK_Range *range);
+
+#endif // NORM_KEY_H
@@ -0,0 +1,384 @@
+#include "part_mgr.h"
+#include "storage_mgr.h"
+#include "norm_key.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Partitioning of a table
+//
+// The partitioning is one page: a PT_Header followed by the bounds of a
+// range partitioning, numPartitions - 1 normalized values (norm_key.h) of
+// the partition attribute in ascending order. Normalized values compare
+// with memcmp, so routing a record is a binary search over the bounds, and
+// a hash partitioning hashes the normalized bytes, which equal values of
+// any type share.
+
+// Partitioning, stored at the start of page 0
+typedef struct PT_Header {
+    int partitioning;
+    int attrNum;
+    int numPartitions;
+    int boundSize;      // bytes of a normalized value of the attribute
+    int engine;         // options of the partitions
+    int memtableSize;
+    int tierFanout;
+    int timeAttr;
+    int ttl;
+} PT_Header;
+
+struct PT_Spec {
+    Schema *schema;
+    PT_Header header;
+    char *bounds;
+};
+
+/* ---------------------------------------------------------------------- */
+/* Helpers                                                                 */
+/* ---------------------------------------------------------------------- */
+
+static char *fileName(char *name) {
+    int len = strlen(name) + 8;
+    char *result = (char *) malloc(len);
+
+    if (result != NULL)
+        snprintf(result, len, "%s.part", name);
+    return result;
+}
+
+// FNV-1a over the normalized value
+static unsigned int hashOf(char *key, int size) {
+    unsigned int h = 2166136261u;
+    int i;
+
+    for (i = 0; i < size; i++) {
+        h ^= (unsigned char) key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Partition of a normalized value
+static int locate(PT_Spec *s, char *key) {
+    int size = s->header.boundSize, lo = 0, hi = s->header.numPartitions - 1;
+
+    if (s->header.partitioning == RM_PARTITION_HASH)
+        return hashOf(key, size) % s->header.numPartitions;
+    // the number of bounds at or below the value
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (memcmp(s->bounds + mid * size, key, size) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Partitioning                                                            */
+/* ---------------------------------------------------------------------- */
+
+// ptCreate
+/**
+ * Checks a partitioning and writes it to the file of the partitioning.
+ *
+ * @param name Name of the table.
+ * @param schema Its schema.
+ * @param options The partitioning, and the engine of the partitions.
+ * @return RC_OK, RC_INVALID_ARGS for an attribute out of the schema, a
+ *         number of partitions out of 1 .. RM_MAX_PARTITIONS, or bounds of
+ *         the wrong type, too long or out of order, or an error code.
+ */
+RC ptCreate(char *name, Schema *schema, RM_TableOptions *options) {
+    int attr = options->partitionAttr, n = options->numPartitions, i;
+    char *file, *page;
+    PT_Header header;
+    SM_FileHandle fh;
+    RC rc;
+
+    if ((options->partitioning != RM_PARTITION_RANGE && options->partitioning != RM_PARTITION_HASH)
+            || attr < 0 || attr >= schema->numAttr || n < 1 || n > RM_MAX_PARTITIONS)
+        return RC_INVALID_ARGS;
+    memset(&header, 0, sizeof(header));
+    header.partitioning = options->partitioning;
+    header.attrNum = attr;
+    header.numPartitions = n;
+    header.boundSize = normKeyAttrSize(schema->dataTypes[attr], schema->typeLength[attr]);
+    header.engine = options->engine;
+    header.memtableSize = options->memtableSize;
+    header.tierFanout = options->tierFanout;
+    header.timeAttr = options->timeAttr;
+    header.ttl = options->ttl;
+    if (header.partitioning == RM_PARTITION_RANGE
+            && (int) sizeof(header) + (n - 1) * header.boundSize > PAGE_SIZE)
+        return RC_INVALID_ARGS;
+    if (header.partitioning == RM_PARTITION_RANGE && n > 1 && options->partitionBounds == NULL)
+        return RC_INVALID_ARGS;
+
+    page = (char *) calloc(PAGE_SIZE, sizeof(char));
+    if (page == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    memcpy(page, &header, sizeof(header));
+    for (i = 0; header.partitioning == RM_PARTITION_RANGE && i < n - 1; i++) {
+        Value *bound = options->partitionBounds[i];
+        char *out = page + sizeof(header) + i * header.boundSize;
+
+        if (bound == NULL || bound->dt != schema->dataTypes[attr]
+                || (bound->dt == DT_STRING && strlen(bound->v.stringV) > (size_t) schema->typeLength[attr])) {
+            free(page);
+            return RC_INVALID_ARGS;
+        }
+        if ((rc = normalizeValue(bound, schema->typeLength[attr], out)) != RC_OK) {
+            free(page);
+            return rc;
+        }
+        if (i > 0 && memcmp(out - header.boundSize, out, header.boundSize) >= 0) {
+            free(page);
+            return RC_INVALID_ARGS;
+        }
+    }
+
+    if ((file = fileName(name)) == NULL) {
+        free(page);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    rc = createPageFile(file);
+    if (rc == RC_OK)
+        rc = openPageFile(file, &fh);
+    free(file);
+    if (rc == RC_OK) {
+        rc = writeBlock(0, &fh, page);
+        closePageFile(&fh);
+    }
+    free(page);
+    return rc;
+}
+
+// Whether a table is partitioned
+bool ptExists(char *name) {
+    char *file = fileName(name);
+    FILE *f;
+
+    if (file == NULL)
+        return false;
+    f = fopen(file, "rb");
+    free(file);
+    if (f == NULL)
+        return false;
+    fclose(f);
+    return true;
+}
+
+// ptOpen
+/**
+ * Reads the partitioning of a table.
+ *
+ * @param name Name of the table.
+ * @param schema Its schema, NULL if the partitions will not be chosen.
+ * @param spec Receives the partitioning; release it with ptClose.
+ * @return RC_OK, RC_INVALID_ARGS if the partitioning does not fit the
+ *         schema, or an error code.
+ */
+RC ptOpen(char *name, Schema *schema, PT_Spec **spec) {
+    char *file = fileName(name), *page;
+    SM_FileHandle fh;
+    PT_Spec *s;
+    RC rc;
+
+    *spec = NULL;
+    page = (char *) malloc(PAGE_SIZE);
+    s = (PT_Spec *) calloc(1, sizeof(PT_Spec));
+    if (file == NULL || page == NULL || s == NULL) {
+        free(file);
+        free(page);
+        free(s);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    rc = openPageFile(file, &fh);
+    free(file);
+    if (rc == RC_OK) {
+        rc = readBlock(0, &fh, page);
+        closePageFile(&fh);
+    }
+    if (rc == RC_OK) {
+        memcpy(&s->header, page, sizeof(PT_Header));
+        if (schema != NULL && (s->header.attrNum >= schema->numAttr
+                || s->header.boundSize != normKeyAttrSize(schema->dataTypes[s->header.attrNum],
+                                                          schema->typeLength[s->header.attrNum])))
+            rc = RC_INVALID_ARGS;
+    }
+    if (rc == RC_OK && s->header.partitioning == RM_PARTITION_RANGE && s->header.numPartitions > 1) {
+        int bytes = (s->header.numPartitions - 1) * s->header.boundSize;
+        if ((s->bounds = (char *) malloc(bytes)) == NULL)
+            rc = RC_MEM_ALLOCATION_FAIL;
+        else
+            memcpy(s->bounds, page + sizeof(PT_Header), bytes);
+    }
+    free(page);
+    if (rc != RC_OK) {
+        free(s->bounds);
+        free(s);
+        return rc;
+    }
+    s->schema = schema;
+    *spec = s;
+    return RC_OK;
+}
+
+// Release a partitioning
+RC ptClose(PT_Spec *spec) {
+    if (spec != NULL) {
+        free(spec->bounds);
+        free(spec);
+    }
+    return RC_OK;
+}
+
+// Remove the file of the partitioning of a table
+RC ptDestroy(char *name) {
+    char *file = fileName(name);
+    RC rc;
+
+    if (file == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    rc = destroyPageFile(file);
+    free(file);
+    return rc;
+}
+
+// Get the number of partitions
+int ptNumPartitions(PT_Spec *spec) {
+    return spec->header.numPartitions;
+}
+
+// Get the attribute the partitions are chosen by
+int ptPartitionAttr(PT_Spec *spec) {
+    return spec->header.attrNum;
+}
+
+// ptPartitionName
+/**
+ * Names the table holding a partition.
+ *
+ * @param name Name of the partitioned table.
+ * @param partition The partition.
+ * @return <name>.p<partition>, malloc'ed, or NULL if out of memory.
+ */
+char *ptPartitionName(char *name, int partition) {
+    int len = strlen(name) + 16;
+    char *result = (char *) malloc(len);
+
+    if (result != NULL)
+        snprintf(result, len, "%s.p%d", name, partition);
+    return result;
+}
+
+// Get the options to create a partition with: those of the table, without the partitioning
+void ptPartitionOptions(PT_Spec *spec, RM_TableOptions *options) {
+    memset(options, 0, sizeof(RM_TableOptions));
+    options->engine = (RM_Engine) spec->header.engine;
+    options->memtableSize = spec->header.memtableSize;
+    options->tierFanout = spec->header.tierFanout;
+    options->timeAttr = spec->header.timeAttr;
+    options->ttl = spec->header.ttl;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Routing                                                                 */
+/* ---------------------------------------------------------------------- */
+
+// ptPartitionOf
+/**
+ * Finds the partition a record belongs to.
+ *
+ * @param spec The partitioning.
+ * @param data The record.
+ * @param partition Receives the partition.
+ * @return RC_OK, or an error code.
+ */
+RC ptPartitionOf(PT_Spec *spec, char *data, int *partition) {
+    char key[spec->header.boundSize];
+    Record record;
+    RC rc;
+
+    record.data = data;
+    if ((rc = normalizeRecordKey(spec->schema, &record, 1, &spec->header.attrNum, key)) != RC_OK)
+        return rc;
+    *partition = locate(spec, key);
+    return RC_OK;
+}
+
+// ptPartitionOfValue
+/**
+ * Finds the partition the records with a value of the partition attribute
+ * belong to.
+ *
+ * @param spec The partitioning.
+ * @param value The value.
+ * @param partition Receives the partition.
+ * @return RC_OK, or RC_INVALID_ARGS for a value of the wrong type or a
+ *         string longer than the attribute.
+ */
+RC ptPartitionOfValue(PT_Spec *spec, Value *value, int *partition) {
+    Schema *schema = spec->schema;
+    int attr = spec->header.attrNum;
+    char key[spec->header.boundSize];
+    RC rc;
+
+    if (value->dt != schema->dataTypes[attr]
+            || (value->dt == DT_STRING && strlen(value->v.stringV) > (size_t) schema->typeLength[attr]))
+        return RC_INVALID_ARGS;
+    if ((rc = normalizeValue(value, schema->typeLength[attr], key)) != RC_OK)
+        return rc;
+    *partition = locate(spec, key);
+    return RC_OK;
+}
+
+// ptPrune
+/**
+ * Selects the partitions a scan has to read. A range partition is left out
+ * if the range the condition puts on the partition attribute misses it; a
+ * hash partitioning only selects a single partition for an equality.
+ *
+ * @param spec The partitioning.
+ * @param cond Condition of the scan, NULL for every record.
+ * @param selected Set for every partition, true if the scan has to read it.
+ * @return RC_OK, or an error code.
+ */
+RC ptPrune(PT_Spec *spec, Expr *cond, bool *selected) {
+    int size = spec->header.boundSize, n = spec->header.numPartitions, i;
+    char low[size], high[size];
+    NK_Range range = { .low = low, .high = high };
+    RC rc;
+
+    for (i = 0; i < n; i++)
+        selected[i] = true;
+    if (cond == NULL)
+        return RC_OK;
+    if ((rc = normKeyRange(spec->schema, spec->header.attrNum, cond, &range)) != RC_OK)
+        return rc;
+
+    if (spec->header.partitioning == RM_PARTITION_HASH) {
+        if (range.hasLow && range.hasHigh && !range.lowStrict && !range.highStrict && memcmp(low, high, size) == 0) {
+            for (i = 0; i < n; i++)
+                selected[i] = false;
+            selected[locate(spec, low)] = true;
+        }
+        return RC_OK;
+    }
+    // partition i holds [bound i - 1, bound i)
+    for (i = 0; i < n; i++) {
+        char *lower = i > 0 ? spec->bounds + (i - 1) * size : NULL;
+        char *upper = i < n - 1 ? spec->bounds + i * size : NULL;
+
+        if (range.hasLow && upper != NULL && memcmp(low, upper, size) >= 0)
+            selected[i] = false;
+        if (range.hasHigh && lower != NULL) {
+            int cmp = memcmp(lower, high, size);
+            if (cmp > 0 || (cmp == 0 && range.highStrict))
+                selected[i] = false;
+        }
+    }
+    return RC_OK;
+}
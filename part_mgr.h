@@ -0,0 +1,50 @@
+#ifndef PART_MGR_H
+#define PART_MGR_H
+
+#include "dberror.h"
+#include "expr.h"
+#include "record_mgr.h"
+#include "tables.h"
+
+// Partitioning of a table (RM_TableOptions.partitioning)
+//
+// The records of a partitioned table are split over partitions by one
+// attribute: by ranges between ascending bounds, or by a hash of the
+// value. Every partition is a table of its own, <name>.p<i>, with its own
+// page file and buffer pool, and the table file <name> only holds the
+// schema. A scan whose condition bounds the partition attribute opens only
+// the partitions that can hold matching records (a hash partitioning only
+// narrows for an equality), and dropping a partition removes its records
+// by removing its files, so data partitioned by time can be aged out a
+// partition at a time.
+//
+// This module keeps the partitioning, in <name>.part, and decides which
+// partition a value goes to; the record manager routes the records.
+
+typedef struct PT_Spec PT_Spec;
+
+// create, open, close and destroy the partitioning of a table; options
+// gives the partitioning and the engine of the partitions. The schema
+// given to ptOpen may be NULL when only the partitions are needed
+extern RC ptCreate (char *name, Schema *schema, RM_TableOptions *options);
+extern rm_bool ptExists (char *name);
+extern RC ptOpen (char *name, Schema *schema, PT_Spec **spec);
+extern RC ptClose (PT_Spec *spec);
+extern RC ptDestroy (char *name);
+
+// the partitions, the attribute choosing them, and the options they were
+// created with
+extern int ptNumPartitions (PT_Spec *spec);
+extern int ptPartitionAttr (PT_Spec *spec);
+extern char *ptPartitionName (char *name, int partition);
+extern void ptPartitionOptions (PT_Spec *spec, RM_TableOptions *options);
+
+// partition of a record, or of a value of the partition attribute
+extern RC ptPartitionOf (PT_Spec *spec, char *data, int *partition);
+extern RC ptPartitionOfValue (PT_Spec *spec, Value *value, int *partition);
+
+// sets selected[i] for every partition that can hold records matching
+// cond (NULL for every record)
+extern RC ptPrune (PT_Spec *spec, Expr *cond, rm_bool *selected);
+
+#endif // PART_MGR_H
@@ -1,12 +1,185 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+#include <errno.h>
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
 #include "dberror.h"
 #include "record_mgr.h"
 #include "tables.h"
 #include "expr.h"
+#include "expr_codegen.h"
+#include "lsm_mgr.h"
+#include "cluster_mgr.h"
+#include "part_mgr.h"
+#include "ts_mgr.h"
+#include <pthread.h>
+
+// Runtime state shared by every user of an open table, kept in RM_TableData.mgmtData
+typedef struct RM_TableMgmt {
+    pthread_mutex_t scanLatch;  // protects the scan fields below
+    int activeScans;            // scans started and not yet closed, of every kind
+    int sharedScans;            // of them, the heap scans that synchronize their pages
+    int syncPage;               // data page the running scans last moved to
+    unsigned int heapWrites;    // writes to the slotted pages, for compiled scans to notice
+    LSM_Tree *lsm;              // records of an RM_ENGINE_LSM table, NULL for a heap table
+    CL_Tree *clustered;         // records of an RM_ENGINE_CLUSTERED table, NULL for a heap table
+    TS_Table *timeseries;       // records of an RM_ENGINE_TIMESERIES table, NULL for a heap table
+    PT_Spec *partitioning;      // partitioning of a partitioned table, NULL for other tables
+    RM_TableData *partitions;   // its open partitions
+    char **partitionNames;      // their names, kept by their buffer pools
+    RM_IndexHooks *indexHooks[RM_MAX_INDEXES];  // attached secondary indexes
+    void *indexes[RM_MAX_INDEXES];
+    int numIndexes;
+    pthread_t expiryThread;     // reclaims expired records, see startExpiry
+    bool expiryRunning;         // set while it runs; cleared under scanLatch to stop it
+    int expiryInterval;         // milliseconds between its rounds
+    pthread_cond_t expiryWake;  // signalled with scanLatch to stop it
+} RM_TableMgmt;
+
+// Per-scan state, kept in RM_ScanHandle.mgmtData
+typedef struct RM_ScanMgmt {
+    int *pages;                 // data pages of the table when the scan started
+    int numPages;
+    int startPos;               // index in pages where the scan joined the running scans
+    int visited;                // pages finished so far
+    int slot;                   // next record index on the current page
+    int recordsPerPage;
+    BM_PageHandle page;         // current data page, pinned while pinned is set
+    bool pinned;
+    bool shared;                // takes part in the table's synchronized scans
+    ExprPageFilter filter;      // compiled condition, NULL to interpret it
+    ExprParam params[EXPR_MAX_PARAMS];
+    char matches[PAGE_SIZE / 256];  // filter result for the current page
+    unsigned int filterWrites;  // heapWrites of the table when filter last ran over the current page
+    LSM_Scan *lsmScan;          // scan of an RM_ENGINE_LSM table
+    CL_Scan *clScan;            // scan of an RM_ENGINE_CLUSTERED table
+    TS_Scan *tsScan;            // scan of an RM_ENGINE_TIMESERIES table
+    RID *rids;                  // records an index selected for the condition, NULL to read every page
+    int numRids;
+    int ridPos;                 // next entry of rids
+    bool exact;                 // every record in rids matches the condition
+    char *lsmRecord;            // record of a table without slotted pages read through rids
+    RM_RowFilter rowFilter;     // test on the stored bytes of a record, NULL for none
+    void *rowFilterArg;
+    int *parts;                 // partitions a scan of a partitioned table reads, NULL for other tables
+    int numParts;
+    int partPos;                // entry of parts being read
+    RM_ScanHandle *partScan;    // scan of that partition, NULL until it starts
+    bool compiled;              // start the scans of the partitions with startCompiledScan
+} RM_ScanMgmt;
+
+// RIDs of a partitioned table carry the partition in the top bits of the page number
+#define RM_PARTITION_SHIFT 24
+#define PARTITION_RID_PAGE(partition, page) (((partition) << RM_PARTITION_SHIFT) | (page))
+
+// Storage of the records of an open table, NULL for a heap table
+static LSM_Tree *tableLsm(RM_TableData *table) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)table->mgmtData;
+    return tableMgmt != NULL ? tableMgmt->lsm : NULL;
+}
+
+// Tree holding the records of an open clustered table, NULL for other tables
+static CL_Tree *tableClustered(RM_TableData *table) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)table->mgmtData;
+    return tableMgmt != NULL ? tableMgmt->clustered : NULL;
+}
+
+// Storage of an open time-series table, NULL for other tables
+static TS_Table *tableTimeseries(RM_TableData *table) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)table->mgmtData;
+    return tableMgmt != NULL ? tableMgmt->timeseries : NULL;
+}
+
+// Counts a write to the slotted pages of a heap table, so compiled scans evaluate their page again
+static void noteHeapWrite(RM_TableData *table) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)table->mgmtData;
+    if (tableMgmt != NULL) {
+        tableMgmt->heapWrites++;
+    }
+}
+
+// Clock records expire by, NULL for the seconds since the epoch
+static RM_Clock expiryClock = NULL;
+
+// Current time for the expiry of records
+static int expiryNow(void) {
+    return expiryClock != NULL ? expiryClock() : (int) time(NULL);
+}
+
+// Reads a record of an LSM, clustered or time-series table into data
+static RC getStoredRecord(RM_TableData *table, RID id, char *data) {
+    if (tableLsm(table) != NULL) {
+        return lsmGet(tableLsm(table), id, data);
+    }
+    if (tableClustered(table) != NULL) {
+        return clGet(tableClustered(table), id, data);
+    }
+    return tsGet(tableTimeseries(table), id, expiryNow(), data);
+}
+
+// Partitioning of an open partitioned table, NULL for other tables
+static PT_Spec *tablePartitioning(RM_TableData *table) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)table->mgmtData;
+    return tableMgmt != NULL ? tableMgmt->partitioning : NULL;
+}
+
+// Partition of a partitioned table holding the record of a RID, and the RID of the record in it; NULL if there is no such partition
+static RM_TableData *ridPartition(RM_TableData *table, RID id, RID *inner) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)table->mgmtData;
+    int partition = id.page >> RM_PARTITION_SHIFT;
+    if (id.page < 0 || partition >= ptNumPartitions(tableMgmt->partitioning)) {
+        return NULL;
+    }
+    inner->page = id.page & ((1 << RM_PARTITION_SHIFT) - 1);
+    inner->slot = id.slot;
+    return &tableMgmt->partitions[partition];
+}
+
+// Index hooks of an open table; the counts are 0 for a table without indexes
+static int tableIndexes(RM_TableData *table, RM_IndexHooks ***hooks, void ***indexes) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)table->mgmtData;
+    if (tableMgmt == NULL) {
+        return 0;
+    }
+    *hooks = tableMgmt->indexHooks;
+    *indexes = tableMgmt->indexes;
+    return tableMgmt->numIndexes;
+}
+
+// Tells the indexes of a table about a record inserted or about to be removed
+static RC notifyIndexes(RM_TableData *table, Record *record, bool inserted) {
+    RM_IndexHooks **hooks;
+    void **indexes;
+    int n = tableIndexes(table, &hooks, &indexes);
+
+    for (int i = 0; i < n; i++) {
+        RC rc = inserted ? hooks[i]->insert(indexes[i], record) : hooks[i]->remove(indexes[i], record);
+        if (rc != RC_OK) {
+            return rc;
+        }
+    }
+    return RC_OK;
+}
+
+// Reads the stored record id before it changes or goes away, for the indexes of the table to drop afterwards;
+// indexed is false, and old left empty, for a table without indexes or a RID without a record
+static RC readIndexedRecord(RM_TableData *table, RID id, Record *old, bool *indexed) {
+    RM_IndexHooks **hooks;
+    void **indexes;
+
+    *indexed = false;
+    if (tableIndexes(table, &hooks, &indexes) == 0) {
+        return RC_OK;
+    }
+    RC rc = getRecord(table, id, old);
+    if (rc == RC_RM_RECORD_NOT_EXIST) {
+        return RC_OK;  // nothing indexed under this RID
+    }
+    *indexed = rc == RC_OK;
+    return rc;
+}
 
 /**
  * Function to initialize the record manager.
@@ -30,6 +203,9 @@ RC initRecordManager (void *mgmtData) {
 RC shutdownRecordManager() {
     // Print a message to indicate the shutdown of the record manager
     printf("Shutting down the Record Manager...\n");
+
+    // Unload the compiled scan conditions
+    shutdownExprCodegen();
     
     // Return success code indicating successful shutdown
     return RC_OK;
@@ -128,6 +304,132 @@ RC createTable(char *name, Schema *schema) {
     return closePageFile(&fh);
 }
 
+/**
+ * Creates a partitioned table: the table file with the schema, the partitioning, and a table for every partition.
+ *
+ * @param name The name of the table.
+ * @param schema The schema of the table.
+ * @param options The partitioning, and the engine of the partitions.
+ * @return RC_OK on success, or an error code otherwise.
+ */
+static RC createPartitionedTable(char *name, Schema *schema, RM_TableOptions *options) {
+    RM_TableOptions partitionOptions = *options;
+    RC status;
+
+    partitionOptions.partitioning = RM_PARTITION_NONE;
+    if ((status = ptCreate(name, schema, options)) != RC_OK) {
+        return status;
+    }
+    if ((status = createTable(name, schema)) != RC_OK) {
+        ptDestroy(name);
+        return status;
+    }
+    for (int i = 0; i < options->numPartitions && status == RC_OK; i++) {
+        char *partitionName = ptPartitionName(name, i);
+        if (partitionName == NULL) {
+            status = RC_MEM_ALLOC_FAILED;
+            break;
+        }
+        status = createTableWithOptions(partitionName, schema, &partitionOptions);
+        free(partitionName);
+    }
+    if (status != RC_OK) {
+        deleteTable(name);  // and the partitions created so far
+    }
+    return status;
+}
+
+/**
+ * Creates a table with a choice of storage engine.
+ * The table file holds the schema either way. An RM_ENGINE_LSM table keeps its records in the LSM files of
+ * lsm_mgr.h instead of the slotted pages, which turns every insert, update and delete into an in-memory write.
+ * An RM_ENGINE_CLUSTERED table keeps them in the leaves of a B+-tree on the key attributes of the schema (see
+ * cluster_mgr.h), so lookups by key and scans of a key range read the records in key order.
+ * An RM_ENGINE_TIMESERIES table appends its records to a pinned tail page and compresses full pages into blocks
+ * that know their range of the time attribute (see ts_mgr.h); its records cannot be updated or deleted one by one.
+ * With a TTL its records expire once they are older than the TTL, and reclaimExpired or startExpiry free their
+ * pages; no other engine takes a TTL.
+ * A partitioned table splits its records by an attribute over tables of the chosen engine, one per partition (see
+ * part_mgr.h); scans skip the partitions their condition rules out, and dropPartition empties one at once.
+ *
+ * @param name The name of the table.
+ * @param schema The schema of the table.
+ * @param options The engine, its settings and the partitioning; NULL creates a heap table.
+ * @return RC_OK on success, or an error code otherwise.
+ */
+RC createTableWithOptions(char *name, Schema *schema, RM_TableOptions *options) {
+    RC status;
+
+    if (options != NULL && options->ttl != 0 && options->engine != RM_ENGINE_TIMESERIES) {
+        return RC_INVALID_ARGS;
+    }
+    if (options != NULL && options->partitioning != RM_PARTITION_NONE) {
+        return createPartitionedTable(name, schema, options);
+    }
+    if (options == NULL || options->engine == RM_ENGINE_HEAP) {
+        return createTable(name, schema);
+    }
+    if (options->engine != RM_ENGINE_LSM && options->engine != RM_ENGINE_CLUSTERED
+            && options->engine != RM_ENGINE_TIMESERIES) {
+        return RC_INVALID_ARGS;
+    }
+
+    if ((status = createTable(name, schema)) != RC_OK) {
+        return status;
+    }
+    if (options->engine == RM_ENGINE_CLUSTERED) {
+        status = clCreate(name, schema);
+        if (status != RC_OK) {
+            destroyPageFile(name);
+        }
+        return status;
+    }
+    if (options->engine == RM_ENGINE_TIMESERIES) {
+        status = tsCreate(name, schema, options->timeAttr, options->ttl);
+        if (status != RC_OK) {
+            destroyPageFile(name);
+        }
+        return status;
+    }
+    status = lsmCreate(name, getRecordSize(schema),
+                       options->memtableSize > 0 ? options->memtableSize : RM_LSM_DEFAULT_MEMTABLE,
+                       options->tierFanout > 0 ? options->tierFanout : RM_LSM_DEFAULT_FANOUT);
+    if (status != RC_OK) {
+        destroyPageFile(name);
+    }
+    return status;
+}
+
+/**
+ * Opens the partitions of a partitioned table.
+ *
+ * @param table The table, opened up to its partitions.
+ * @param name The name of the table.
+ * @return RC_OK on success, or an error code otherwise.
+ */
+static RC openPartitions(RM_TableData *table, char *name) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)table->mgmtData;
+    RC rc = ptOpen(name, table->schema, &tableMgmt->partitioning);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    int n = ptNumPartitions(tableMgmt->partitioning);
+    tableMgmt->partitions = (RM_TableData *)calloc(n, sizeof(RM_TableData));
+    tableMgmt->partitionNames = (char **)calloc(n, sizeof(char *));
+    if (tableMgmt->partitions == NULL || tableMgmt->partitionNames == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    for (int i = 0; i < n; i++) {
+        if ((tableMgmt->partitionNames[i] = ptPartitionName(name, i)) == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+        if ((rc = openTable(&tableMgmt->partitions[i], tableMgmt->partitionNames[i])) != RC_OK) {
+            return rc;
+        }
+    }
+    return RC_OK;
+}
+
 /**
  * Opens a table for manipulation.
  * This function is responsible for preparing the table for data operations by opening the associated page file and setting up necessary metadata.
@@ -224,7 +526,7 @@ RC openTable (RM_TableData *tableData, char *tableName) {
             j++;
         }
 
-        attributeNames[i] = (char *)calloc(j, sizeof(char));
+        attributeNames[i] = (char *)calloc(j + 1, sizeof(char));
         memcpy(attributeNames[i], cursor, j);
 
         if (*(cursor + j + 2) == 'I') {
@@ -270,9 +572,12 @@ RC openTable (RM_TableData *tableData, char *tableName) {
     }
     cursor++;
 
+    // One key attribute more than there are commas before the closing parenthesis
     keyCount = 0;
-    while (strchr(cursor, ',') != NULL) {
-        keyCount++;
+    for (char *c = cursor; *c != ')' && *c != '\0'; c++) {
+        if (keyCount == 0 || *c == ',') {
+            keyCount++;
+        }
     }
 
     keyAttributes = (int *)calloc(keyCount, sizeof(int));
@@ -339,6 +644,42 @@ tableData->schema = tableSchema;
 tableData->bm = bufferPool;
 tableData->fh = fileHandler;
 
+// Runtime state shared by the scans of this table
+RM_TableMgmt *tableMgmt = (RM_TableMgmt *)calloc(1, sizeof(RM_TableMgmt));
+if (tableMgmt == NULL) {
+    return RC_MEM_ALLOC_FAILED;
+}
+pthread_mutex_init(&tableMgmt->scanLatch, NULL);
+pthread_cond_init(&tableMgmt->expiryWake, NULL);
+tableMgmt->syncPage = -1;
+tableData->mgmtData = tableMgmt;
+
+// Records of an LSM table live in its own files
+if (lsmExists(tableName)) {
+    returnCode = lsmOpen(tableName, &tableMgmt->lsm);
+    if (returnCode != RC_OK) {
+        return returnCode;
+    }
+}
+if (clExists(tableName)) {
+    returnCode = clOpen(tableName, tableSchema, &tableMgmt->clustered);
+    if (returnCode != RC_OK) {
+        return returnCode;
+    }
+}
+if (tsExists(tableName)) {
+    returnCode = tsOpen(tableName, tableSchema, &tableMgmt->timeseries);
+    if (returnCode != RC_OK) {
+        return returnCode;
+    }
+}
+// Records of a partitioned table live in the tables of its partitions
+if (ptExists(tableName)) {
+    returnCode = openPartitions(tableData, tableName);
+    if (returnCode != RC_OK) {
+        return returnCode;
+    }
+}
 
     return RC_OK;
 }
@@ -359,6 +700,8 @@ RC closeTable(RM_TableData *tableData) {
     if (tableData == NULL) {
         return RC_NULL_POINTER;
     }
+    // Stop the background reclamation of expired records before anything it uses goes away
+    stopExpiry(tableData);
 
     // Free the schema memory if it exists
     if (tableData->schema != NULL) {
@@ -382,6 +725,55 @@ RC closeTable(RM_TableData *tableData) {
         tableData->fh = NULL;
     }
 
+    // Release the runtime state, writing out the records an LSM table holds in memory
+    if (tableData->mgmtData != NULL) {
+        RM_TableMgmt *tableMgmt = (RM_TableMgmt *)tableData->mgmtData;
+        if (tableMgmt->lsm != NULL) {
+            RC lsmStatus = lsmClose(tableMgmt->lsm);
+            tableMgmt->lsm = NULL;
+            if (lsmStatus != RC_OK) {
+                return lsmStatus;
+            }
+        }
+        if (tableMgmt->clustered != NULL) {
+            RC clStatus = clClose(tableMgmt->clustered);
+            tableMgmt->clustered = NULL;
+            if (clStatus != RC_OK) {
+                return clStatus;
+            }
+        }
+        if (tableMgmt->timeseries != NULL) {
+            RC tsStatus = tsClose(tableMgmt->timeseries);
+            tableMgmt->timeseries = NULL;
+            if (tsStatus != RC_OK) {
+                return tsStatus;
+            }
+        }
+        if (tableMgmt->partitioning != NULL) {
+            RC partitionStatus = RC_OK;
+            for (int i = 0; i < ptNumPartitions(tableMgmt->partitioning); i++) {
+                RC status = tableMgmt->partitions != NULL ? closeTable(&tableMgmt->partitions[i]) : RC_OK;
+                if (partitionStatus == RC_OK) {
+                    partitionStatus = status;
+                }
+                if (tableMgmt->partitionNames != NULL) {
+                    free(tableMgmt->partitionNames[i]);
+                }
+            }
+            free(tableMgmt->partitions);
+            free(tableMgmt->partitionNames);
+            ptClose(tableMgmt->partitioning);
+            tableMgmt->partitioning = NULL;
+            if (partitionStatus != RC_OK) {
+                return partitionStatus;
+            }
+        }
+        pthread_mutex_destroy(&tableMgmt->scanLatch);
+        pthread_cond_destroy(&tableMgmt->expiryWake);
+        free(tableMgmt);
+        tableData->mgmtData = NULL;
+    }
+
     return RC_OK;  // Return success
 }
 
@@ -391,6 +783,47 @@ RC closeTable(RM_TableData *tableData) {
  * @return RC_OK on success, or an error code otherwise.
  */
 RC deleteTable (char *name) {
+    if (lsmExists(name)) {
+        RC rc = lsmDestroy(name);
+        if (rc != RC_OK) {
+            return rc;
+        }
+    }
+    if (clExists(name)) {
+        RC rc = clDestroy(name);
+        if (rc != RC_OK) {
+            return rc;
+        }
+    }
+    if (tsExists(name)) {
+        RC rc = tsDestroy(name);
+        if (rc != RC_OK) {
+            return rc;
+        }
+    }
+    // A partitioned table goes with every partition, as far as they exist
+    if (ptExists(name)) {
+        PT_Spec *spec;
+        RC rc = ptOpen(name, NULL, &spec);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        for (int i = 0; i < ptNumPartitions(spec); i++) {
+            char *partitionName = ptPartitionName(name, i);
+            RC status = partitionName != NULL ? deleteTable(partitionName) : RC_MEM_ALLOC_FAILED;
+            if (rc == RC_OK) {
+                rc = status;
+            }
+            free(partitionName);
+        }
+        ptClose(spec);
+        RC status = ptDestroy(name);
+        if (rc == RC_OK) {
+            rc = status;
+        }
+        status = destroyPageFile(name);
+        return rc != RC_OK ? rc : status;
+    }
     return destroyPageFile(name);
 }
 
@@ -406,6 +839,27 @@ int getNumTuples(RM_TableData *table) {
         // Check if the table data or buffer manager pointer is NULL
         return -1;  // Use appropriate error code or handling as per your system's design
     }
+    if (tableLsm(table) != NULL) {
+        return lsmNumTuples(tableLsm(table));
+    }
+    if (tableClustered(table) != NULL) {
+        return clNumTuples(tableClustered(table));
+    }
+    if (tableTimeseries(table) != NULL) {
+        return tsNumTuples(tableTimeseries(table));
+    }
+    if (tablePartitioning(table) != NULL) {
+        RM_TableMgmt *tableMgmt = (RM_TableMgmt *)table->mgmtData;
+        int numTuples = 0;
+        for (int i = 0; i < ptNumPartitions(tableMgmt->partitioning); i++) {
+            int partitionTuples = getNumTuples(&tableMgmt->partitions[i]);
+            if (partitionTuples < 0) {
+                return -1;
+            }
+            numTuples += partitionTuples;
+        }
+        return numTuples;
+    }
 
     BM_PageHandle *pageHandle = MAKE_PAGE_HANDLE();
     if (!pageHandle) {
@@ -417,7 +871,7 @@ int getNumTuples(RM_TableData *table) {
     int numTuples = -1;  // Default value in case of failure
 
     // Attempt to pin the first page
-    RC pinStatus = pinPage(table->bm, pageHandle, 0);
+    RC pinStatus = pinPageWithHint(table->bm, pageHandle, 0, BM_HINT_HOT);
     if (pinStatus != RC_OK) {
         free(pageHandle);
         return -1;  // Return error code specific to pin failure
@@ -443,121 +897,647 @@ int getNumTuples(RM_TableData *table) {
 }
 
 /**
- * Inserts a record into the specified table.
- * This function adds a new record to the table, incorporating it into the existing data set.
+ * Attaches a secondary index to an open table.
+ * From now on every insert, update and delete of the table calls the hooks of the index, and scans ask the index
+ * for the records matching their condition before they read any data page.
  *
- * @param rel Pointer to the RM_TableData structure representing the table.
- * @param record Pointer to the Record structure containing the data to insert.
- * @return RC Result code indicating the success or failure of the insertion operation.
+ * @param rel The open table.
+ * @param hooks The functions that maintain and query the index; must stay valid while the index is attached.
+ * @param index The index, passed to the hooks.
+ * @return RC_OK, RC_INVALID_HANDLE for a table that is not open, or RC_INVALID_ARGS if it has RM_MAX_INDEXES indexes.
  */
+RC attachIndex(RM_TableData *rel, RM_IndexHooks *hooks, void *index) {
+    if (rel == NULL || rel->mgmtData == NULL || hooks == NULL) {
+        return RC_INVALID_HANDLE;
+    }
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+    if (tableMgmt->numIndexes == RM_MAX_INDEXES) {
+        return RC_INVALID_ARGS;
+    }
+    tableMgmt->indexHooks[tableMgmt->numIndexes] = hooks;
+    tableMgmt->indexes[tableMgmt->numIndexes] = index;
+    tableMgmt->numIndexes++;
+    return RC_OK;
+}
 
-RC insertRecord (RM_TableData *rel, Record *record) {
-   // Allocate memory for a page handle
-    BM_PageHandle *h = MAKE_PAGE_HANDLE();
-    if (h == NULL) {
-        return RC_INSUFFICIENT_MEMORY;  // Memory allocation failed
+/**
+ * Detaches an index from an open table; the table no longer maintains it.
+ *
+ * @param rel The open table.
+ * @param index The index given to attachIndex.
+ * @return RC_OK, or RC_INVALID_ARGS if the index is not attached to the table.
+ */
+RC detachIndex(RM_TableData *rel, void *index) {
+    if (rel == NULL || rel->mgmtData == NULL) {
+        return RC_INVALID_HANDLE;
     }
-    
-    // Get the size of a record based on the table's schema
-    int r_size = getRecordSize(rel->schema);
-    
-    // Get the size of metadata in a page
-    int p_meta_index = getFileMetaDataSize(rel->bm);
-    
-    // Calculate the number of slots needed for the record
-    int r_slotnum = (r_size + sizeof(bool)) / 256 + 1;
-    
-    // Initialize offset
-    int offset = 0;
-    
-    // Variables for record management
-    int r_current_num, numTuples;
-    bool r_stat = true;
-       
-    // Find out the target page and slot at the end.
-    bool continueLoop = true;
-while (continueLoop) {
-    pinPage(rel->bm, h, p_meta_index);
-    memcpy(&p_meta_index, h->data + PAGE_SIZE - sizeof(int), sizeof(int));
-    if (p_meta_index != -1) {
-        unpinPage(rel->bm, h);
-    } else {
-        continueLoop = false;
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+    for (int i = 0; i < tableMgmt->numIndexes; i++) {
+        if (tableMgmt->indexes[i] == index) {
+            tableMgmt->numIndexes--;
+            memmove(tableMgmt->indexHooks + i, tableMgmt->indexHooks + i + 1, (tableMgmt->numIndexes - i) * sizeof(RM_IndexHooks *));
+            memmove(tableMgmt->indexes + i, tableMgmt->indexes + i + 1, (tableMgmt->numIndexes - i) * sizeof(void *));
+            return RC_OK;
+        }
     }
+    return RC_INVALID_ARGS;
 }
 
+/**
+ * Returns the number of partitions of a table.
+ *
+ * @param rel The open table.
+ * @return The number of partitions, 0 for a table that is not partitioned.
+ */
+int getNumPartitions(RM_TableData *rel) {
+    if (rel == NULL || tablePartitioning(rel) == NULL) {
+        return 0;
+    }
+    return ptNumPartitions(tablePartitioning(rel));
+}
 
-    // Find out the target meta index and record number of the page.
-   while (true) {
-    memcpy(&r_current_num, h->data + offset + sizeof(int), sizeof(int));
-    offset += 2 * sizeof(int);
-    if (r_current_num != PAGE_SIZE / 256) {
-        break;
+/**
+ * Finds the partition holding the records with a value of the partition attribute, such as the partition to drop
+ * to get rid of the records of a period.
+ *
+ * @param rel The open partitioned table.
+ * @param value The value.
+ * @param partition Receives the partition.
+ * @return RC_OK, or RC_INVALID_ARGS for a table that is not partitioned or a value that does not fit the attribute.
+ */
+RC getPartitionOf(RM_TableData *rel, Value *value, int *partition) {
+    if (rel == NULL || value == NULL || partition == NULL) {
+        return RC_NULL_POINTER;
+    }
+    if (tablePartitioning(rel) == NULL) {
+        return RC_INVALID_ARGS;
     }
+    return ptPartitionOfValue(tablePartitioning(rel), value, partition);
 }
 
-    // If no page exist, add new page.
-    if(r_current_num == -1){       
-        // If page mata is full, add new matadata block.
-        if(offset == PAGE_SIZE){       
-            memcpy(h->data + PAGE_SIZE - sizeof(int), &rel->fh->totalNumPages, sizeof(int));   // Link into new meta data page. 
-            addPageMetadataBlock(rel->fh);
-            markDirty(rel->bm, h);
-            unpinPage(rel->bm, h);      // Unpin the last meta page.
-            pinPage(rel->bm, h, rel->fh->totalNumPages-1);  // Pin the new page.
-            offset = 2*sizeof(int);
-        }
-        memcpy(h->data + offset - 2*sizeof(int), &rel->fh->totalNumPages, sizeof(int));  // set page number.
-        appendEmptyBlock(rel->fh);
-        r_current_num = 0;                                  
-    } 
+// Empties the slotted pages of a heap table: drops the cached data and directory pages, cuts the file back to the
+// schema and starts a new page directory
+static RC truncateHeap (RM_TableData *rel) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+    BM_PageHandle page;
+    int metaPage = getFileMetaDataSize(rel->bm);
+    int numTuples = 0;
+    RC rc;
 
-    // Read record->id and set record number add 1 in meta data.
-    memcpy(&record->id.page, h->data + offset - 2*sizeof(int), sizeof(int));   // Set record->id page number.
-    record->id.slot = r_current_num * r_slotnum;                                // Set record->id slot.
-    r_current_num++;                                
-    memcpy(h->data + offset - sizeof(int), &r_current_num, sizeof(int));   // Set record number++ into meta data.
-    markDirty(rel->bm, h);
-    unpinPage(rel->bm, h);              // unpin meta page.
+    if (metaPage < 0) {
+        return RC_PIN_PAGE_FAILED;
+    }
+    if ((rc = discardPages(rel->bm, metaPage)) != RC_OK || (rc = truncatePageFile(metaPage, rel->fh)) != RC_OK
+            || (rc = addPageMetadataBlock(rel->fh)) != RC_OK) {
+        return rc;
+    }
 
-    // Insert record header and record data into page.
-    pinPage(rel->bm, h, record->id.page);
-    memcpy(h->data + 256*record->id.slot, &r_stat, sizeof(bool));   // Record header is a del_flag 
-    memcpy(h->data + 256*record->id.slot + sizeof(bool), record->data, r_size); // Record body is values.
-    markDirty(rel->bm, h);
-    unpinPage(rel->bm, h);
-    // Tuple number add 1.
-    pinPage(rel->bm, h, 0);
-    memcpy(&numTuples, h->data + 3 * sizeof(int), sizeof(int));
-    numTuples++;       
-    memcpy(h->data + 3 * sizeof(int), &numTuples, sizeof(int));
-    markDirty(rel->bm, h);
-    unpinPage(rel->bm, h);
+    if ((rc = pinPageWithHint(rel->bm, &page, 0, BM_HINT_HOT)) != RC_OK) {
+        return rc;
+    }
+    memcpy(page.data + 3 * sizeof(int), &numTuples, sizeof(int));
+    markDirty(rel->bm, &page);
+    unpinPage(rel->bm, &page);
 
-    free(h);
+    pthread_mutex_lock(&tableMgmt->scanLatch);
+    tableMgmt->syncPage = -1;
+    pthread_mutex_unlock(&tableMgmt->scanLatch);
     return RC_OK;
 }
 
-/**
- * Deletes a record from the specified table by its ID.
- * This function removes the record identified by the given ID from the table.
- *
- * @param table Pointer to the RM_TableData structure representing the table.
- * @param id The ID of the record to delete.
- * @return RC Result code indicating the success or failure of the deletion operation.
- */
+// Checks that truncateStorage can empty a table: no scan of it or of a partition is open, and none of the data
+// pages a heap table drops is pinned
+static RC canTruncate (RM_TableData *rel) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+    RC rc = RC_OK;
 
+    pthread_mutex_lock(&tableMgmt->scanLatch);
+    if (tableMgmt->activeScans > 0) {
+        rc = RC_INVALID_ARGS;
+    }
+    pthread_mutex_unlock(&tableMgmt->scanLatch);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    if (tableMgmt->partitioning != NULL) {
+        for (int i = 0; i < ptNumPartitions(tableMgmt->partitioning) && rc == RC_OK; i++) {
+            rc = canTruncate(&tableMgmt->partitions[i]);
+        }
+        return rc;
+    }
+    if (tableMgmt->lsm != NULL || tableMgmt->clustered != NULL || tableMgmt->timeseries != NULL) {
+        return RC_OK;  // their pages are only pinned by their scans
+    }
 
-RC deleteRecord(RM_TableData *table, RID id) {
-    // Allocate memory for a page handle
-    BM_PageHandle *pageHandle = MAKE_PAGE_HANDLE();
-    if (pageHandle == NULL) {
-        return RC_INSUFFICIENT_MEMORY;  // Memory allocation failed
+    int metaPage = getFileMetaDataSize(rel->bm);
+    PageNumber *pages = getFrameContents(rel->bm);
+    int *fixCounts = getFixCounts(rel->bm);
+    if (pages == NULL || fixCounts == NULL) {
+        rc = RC_MEM_ALLOC_FAILED;
+    }
+    for (int i = 0; rc == RC_OK && i < rel->bm->numPages; i++) {
+        if (pages[i] != NO_PAGE && pages[i] >= metaPage && fixCounts[i] > 0) {
+            rc = RC_PAGE_PINNED;
+        }
     }
+    free(pages);
+    free(fixCounts);
+    return rc;
+}
 
-    int recordSize = getRecordSize(table->schema);
-    int numTuples;
-    
+// Removes every record from the storage of a table, whatever its engine, without telling the indexes
+static RC truncateStorage (RM_TableData *rel) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+    RC rc = canTruncate(rel);
+
+    if (rc != RC_OK) {
+        return rc;
+    }
+    if (tableMgmt->partitioning != NULL) {
+        for (int i = 0; i < ptNumPartitions(tableMgmt->partitioning); i++) {
+            RC rc = truncateStorage(&tableMgmt->partitions[i]);
+            if (rc != RC_OK) {
+                return rc;
+            }
+        }
+        return RC_OK;
+    }
+    if (tableMgmt->lsm != NULL) {
+        return lsmTruncate(tableMgmt->lsm);
+    }
+    if (tableMgmt->clustered != NULL) {
+        return clTruncate(tableMgmt->clustered);
+    }
+    if (tableMgmt->timeseries != NULL) {
+        return tsTruncate(tableMgmt->timeseries);
+    }
+    return truncateHeap(rel);
+}
+
+/**
+ * Removes every record of a table at once.
+ * The cached pages of the table are dropped from the buffer pool without being written, and the file is cut back to
+ * its schema with ftruncate, so the cost does not depend on the number of records. An LSM table drops its memtable
+ * and deletes its sorted files, a clustered or time-series table is cut back to its first pages, and a partitioned
+ * table truncates every partition. Only if indexes are attached, the records are scanned first to take them out of the indexes.
+ * No scan of the table may be open, sample and index-driven scans included, and no data page may be pinned; both
+ * are checked before the indexes are touched, so a truncate that is refused leaves the indexes as they were.
+ *
+ * @param rel The open table.
+ * @return RC_OK, RC_INVALID_ARGS while a scan is open, RC_PAGE_PINNED while a page of the table is pinned, or an
+ *         error code.
+ */
+RC truncateTable(RM_TableData *rel) {
+    if (rel == NULL) {
+        return RC_NULL_POINTER;
+    }
+    if (rel->mgmtData == NULL) {
+        return RC_INVALID_HANDLE;
+    }
+    RM_IndexHooks **hooks;
+    void **indexes;
+    RC rc;
+
+    // The indexes are only emptied of a table that will be emptied too
+    if ((rc = canTruncate(rel)) != RC_OK) {
+        return rc;
+    }
+    if (tableIndexes(rel, &hooks, &indexes) > 0) {
+        RM_ScanHandle scan;
+        Record record;
+        record.data = NULL;
+        if ((rc = startScan(rel, &scan, NULL)) != RC_OK) {
+            return rc;
+        }
+        while ((rc = next(&scan, &record)) == RC_OK) {
+            if ((rc = notifyIndexes(rel, &record, false)) != RC_OK) {
+                break;
+            }
+        }
+        closeScan(&scan);
+        free(record.data);
+        if (rc != RC_RM_NO_MORE_TUPLES) {
+            return rc;
+        }
+    }
+    return truncateStorage(rel);
+}
+
+// Tells the indexes of a partitioned table about the records of a partition, the first limit of them or all for a
+// limit of -1, as inserted or about to be removed; done receives the number told
+static RC notifyPartition (RM_TableData *rel, int partition, bool inserted, int limit, int *done) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+    RM_ScanHandle scan;
+    Record record;
+    RC rc;
+
+    *done = 0;
+    record.data = NULL;
+    if ((rc = startScan(&tableMgmt->partitions[partition], &scan, NULL)) != RC_OK) {
+        return rc;
+    }
+    while ((limit < 0 || *done < limit) && (rc = next(&scan, &record)) == RC_OK) {
+        record.id.page = PARTITION_RID_PAGE(partition, record.id.page);
+        if ((rc = notifyIndexes(rel, &record, inserted)) != RC_OK) {
+            break;
+        }
+        (*done)++;
+    }
+    closeScan(&scan);
+    free(record.data);
+    return rc == RC_RM_NO_MORE_TUPLES ? RC_OK : rc;
+}
+
+/**
+ * Removes every record of a partition at once.
+ * The partition is emptied the way truncateTable empties a table, so the records are not visited one by one; only
+ * if indexes are attached to the table, the partition is scanned to take its records out of them. The partition
+ * stays in the table and takes new records as before. No scan of the table may be open, and no data page of the
+ * partition may be pinned; both are checked before the indexes are touched, and the records are put back into the
+ * indexes if the partition cannot be emptied after all.
+ *
+ * @param rel The open partitioned table.
+ * @param partition The partition, from 0 to getNumPartitions - 1.
+ * @return RC_OK, RC_INVALID_ARGS for a table that is not partitioned, a partition out of range or while a scan is
+ *         open, RC_PAGE_PINNED while a page of the partition is pinned, or an error code.
+ */
+RC dropPartition(RM_TableData *rel, int partition) {
+    if (rel == NULL) {
+        return RC_NULL_POINTER;
+    }
+    PT_Spec *spec = tablePartitioning(rel);
+    if (spec == NULL || partition < 0 || partition >= ptNumPartitions(spec)) {
+        return RC_INVALID_ARGS;
+    }
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+    RM_TableData *table = &tableMgmt->partitions[partition];
+    RM_IndexHooks **hooks;
+    void **indexes;
+    int removed = 0, restored;
+    RC rc = RC_OK;
+
+    // A scan of the table may be between two partitions, with none of its own open
+    pthread_mutex_lock(&tableMgmt->scanLatch);
+    if (tableMgmt->activeScans > 0) {
+        rc = RC_INVALID_ARGS;
+    }
+    pthread_mutex_unlock(&tableMgmt->scanLatch);
+    if (rc != RC_OK || (rc = canTruncate(table)) != RC_OK) {
+        return rc;
+    }
+    bool indexed = tableIndexes(rel, &hooks, &indexes) > 0;
+    if (indexed && (rc = notifyPartition(rel, partition, false, -1, &removed)) != RC_OK) {
+        notifyPartition(rel, partition, true, removed, &restored);
+        return rc;
+    }
+    if ((rc = truncateStorage(table)) != RC_OK && indexed) {
+        notifyPartition(rel, partition, true, -1, &restored);  // the records the partition still holds
+    }
+    return rc;
+}
+
+/**
+ * Closes a table and deletes it, without writing back the pages it has cached: they are dropped first, so closing
+ * the table writes next to nothing and the cost does not depend on the size of the table. Attached indexes are not
+ * told about the records; detach them first.
+ *
+ * @param rel The open table; it is closed even if deleting its files fails.
+ * @return RC_OK, RC_INVALID_ARGS while a scan is open, RC_PAGE_PINNED while a page of the table is pinned, or an
+ *         error code.
+ */
+RC dropTable(RM_TableData *rel) {
+    if (rel == NULL) {
+        return RC_NULL_POINTER;
+    }
+    if (rel->mgmtData == NULL) {
+        return RC_INVALID_HANDLE;
+    }
+    char *name = rel->name;
+    RC rc;
+
+    if ((rc = truncateStorage(rel)) != RC_OK || (rc = discardPages(rel->bm, 0)) != RC_OK
+            || (rc = closeTable(rel)) != RC_OK) {
+        return rc;
+    }
+    return deleteTable(name);
+}
+
+/**
+ * Sets the clock records expire by, for every table with a TTL.
+ *
+ * @param clock Returns the current time in the unit of the time attributes; NULL for the seconds since the epoch.
+ */
+void setExpiryClock(RM_Clock clock) {
+    expiryClock = clock;
+}
+
+/**
+ * Reclaims the pages of expired records of a table with a TTL, of every partition of a partitioned one: the
+ * oldest blocks whose records have all expired are removed, and their pages are dropped from the buffer pool
+ * without being written and kept for new records. Nothing is reclaimed while a scan of the table is open.
+ *
+ * @param rel The open table.
+ * @param pages Receives the number of pages freed.
+ * @return RC_OK, RC_INVALID_ARGS for a table that is neither a time-series table nor partitioned, or an error code.
+ */
+RC reclaimExpired(RM_TableData *rel, int *pages) {
+    if (rel == NULL || pages == NULL) {
+        return RC_NULL_POINTER;
+    }
+    *pages = 0;
+    if (tablePartitioning(rel) != NULL) {
+        RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+        for (int i = 0; i < ptNumPartitions(tableMgmt->partitioning); i++) {
+            int freed;
+            RC rc = reclaimExpired(&tableMgmt->partitions[i], &freed);
+            *pages += freed;
+            if (rc != RC_OK && rc != RC_INVALID_ARGS) {
+                return rc;
+            }
+        }
+        return RC_OK;
+    }
+    if (tableTimeseries(rel) == NULL) {
+        return RC_INVALID_ARGS;
+    }
+    return tsReclaim(tableTimeseries(rel), expiryNow(), pages);
+}
+
+// Whether the records of a table expire
+static bool tableExpires(RM_TableData *rel) {
+    if (tablePartitioning(rel) != NULL) {
+        RM_TableOptions options;
+        ptPartitionOptions(tablePartitioning(rel), &options);
+        return options.ttl > 0;
+    }
+    return tableTimeseries(rel) != NULL && tsTtl(tableTimeseries(rel)) > 0;
+}
+
+// Body of the thread started by startExpiry: reclaims expired records every interval until stopped
+static void *expiryLoop(void *arg) {
+    RM_TableData *rel = (RM_TableData *)arg;
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+    struct timespec wake;
+    int pages;
+
+    pthread_mutex_lock(&tableMgmt->scanLatch);
+    while (tableMgmt->expiryRunning) {
+        pthread_mutex_unlock(&tableMgmt->scanLatch);
+        reclaimExpired(rel, &pages);
+        pthread_mutex_lock(&tableMgmt->scanLatch);
+
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_sec += tableMgmt->expiryInterval / 1000;
+        wake.tv_nsec += (long) (tableMgmt->expiryInterval % 1000) * 1000000;
+        if (wake.tv_nsec >= 1000000000) {
+            wake.tv_sec++;
+            wake.tv_nsec -= 1000000000;
+        }
+        int waited = 0;
+        while (tableMgmt->expiryRunning && waited != ETIMEDOUT) {
+            waited = pthread_cond_timedwait(&tableMgmt->expiryWake, &tableMgmt->scanLatch, &wake);
+        }
+    }
+    pthread_mutex_unlock(&tableMgmt->scanLatch);
+    return NULL;
+}
+
+/**
+ * Starts a thread that reclaims the expired records of a table, as reclaimExpired does, every interval
+ * milliseconds, instead of deleting them in bulk: the pages of expired records are dropped unread and unwritten,
+ * so reclaiming them does not push other pages out of the buffer pool. The thread runs until stopExpiry or
+ * closeTable. The table and its RM_TableData must stay where they are while it runs.
+ *
+ * @param rel The open table.
+ * @param interval Milliseconds between two rounds.
+ * @return RC_OK, RC_INVALID_ARGS for a table without a TTL, an interval below 1 or a thread already running, or
+ *         an error code.
+ */
+RC startExpiry(RM_TableData *rel, int interval) {
+    if (rel == NULL) {
+        return RC_NULL_POINTER;
+    }
+    if (rel->mgmtData == NULL) {
+        return RC_INVALID_HANDLE;
+    }
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+
+    if (interval < 1 || tableMgmt->expiryRunning || !tableExpires(rel)) {
+        return RC_INVALID_ARGS;
+    }
+    tableMgmt->expiryInterval = interval;
+    tableMgmt->expiryRunning = true;
+    if (pthread_create(&tableMgmt->expiryThread, NULL, expiryLoop, rel) != 0) {
+        tableMgmt->expiryRunning = false;
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    return RC_OK;
+}
+
+/**
+ * Stops the thread startExpiry started, waiting for a round it is in to end.
+ *
+ * @param rel The open table.
+ * @return RC_OK, also if no thread runs.
+ */
+RC stopExpiry(RM_TableData *rel) {
+    if (rel == NULL) {
+        return RC_NULL_POINTER;
+    }
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+    if (tableMgmt == NULL || !tableMgmt->expiryRunning) {
+        return RC_OK;
+    }
+
+    pthread_mutex_lock(&tableMgmt->scanLatch);
+    tableMgmt->expiryRunning = false;
+    pthread_cond_signal(&tableMgmt->expiryWake);
+    pthread_mutex_unlock(&tableMgmt->scanLatch);
+    pthread_join(tableMgmt->expiryThread, NULL);
+    return RC_OK;
+}
+
+// Inserts a record into the slotted pages of a heap table
+static RC insertHeapRecord (RM_TableData *rel, Record *record) {
+
+   // Allocate memory for a page handle
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    if (h == NULL) {
+        return RC_INSUFFICIENT_MEMORY;  // Memory allocation failed
+    }
+    
+    // Get the size of a record based on the table's schema
+    int r_size = getRecordSize(rel->schema);
+    
+    // Get the size of metadata in a page
+    int p_meta_index = getFileMetaDataSize(rel->bm);
+    
+    // Calculate the number of slots needed for the record
+    int r_slotnum = (r_size + sizeof(bool)) / 256 + 1;
+    
+    // Initialize offset
+    int offset = 0;
+    
+    // Variables for record management
+    int r_current_num, numTuples;
+    bool r_stat = true;
+       
+    // Find out the target page and slot at the end.
+    bool continueLoop = true;
+while (continueLoop) {
+    pinPageWithHint(rel->bm, h, p_meta_index, BM_HINT_HOT);
+    memcpy(&p_meta_index, h->data + PAGE_SIZE - sizeof(int), sizeof(int));
+    if (p_meta_index != -1) {
+        unpinPage(rel->bm, h);
+    } else {
+        continueLoop = false;
+    }
+}
+
+
+    // Find out the target meta index and record number of the page.
+   while (true) {
+    memcpy(&r_current_num, h->data + offset + sizeof(int), sizeof(int));
+    offset += 2 * sizeof(int);
+    if (r_current_num != PAGE_SIZE / 256) {
+        break;
+    }
+}
+
+    // If no page exist, add new page.
+    if(r_current_num == -1){       
+        // If page mata is full, add new matadata block.
+        if(offset == PAGE_SIZE){       
+            memcpy(h->data + PAGE_SIZE - sizeof(int), &rel->fh->totalNumPages, sizeof(int));   // Link into new meta data page. 
+            addPageMetadataBlock(rel->fh);
+            markDirty(rel->bm, h);
+            unpinPage(rel->bm, h);      // Unpin the last meta page.
+            pinPageWithHint(rel->bm, h, rel->fh->totalNumPages-1, BM_HINT_HOT);  // Pin the new page.
+            offset = 2*sizeof(int);
+        }
+        memcpy(h->data + offset - 2*sizeof(int), &rel->fh->totalNumPages, sizeof(int));  // set page number.
+        appendEmptyBlock(rel->fh);
+        r_current_num = 0;                                  
+    } 
+
+    // Read record->id and set record number add 1 in meta data.
+    memcpy(&record->id.page, h->data + offset - 2*sizeof(int), sizeof(int));   // Set record->id page number.
+    record->id.slot = r_current_num * r_slotnum;                                // Set record->id slot.
+    r_current_num++;                                
+    memcpy(h->data + offset - sizeof(int), &r_current_num, sizeof(int));   // Set record number++ into meta data.
+    markDirty(rel->bm, h);
+    unpinPage(rel->bm, h);              // unpin meta page.
+
+    // Insert record header and record data into page.
+    pinPage(rel->bm, h, record->id.page);
+    memcpy(h->data + 256*record->id.slot, &r_stat, sizeof(bool));   // Record header is a del_flag 
+    memcpy(h->data + 256*record->id.slot + sizeof(bool), record->data, r_size); // Record body is values.
+    markDirty(rel->bm, h);
+    unpinPage(rel->bm, h);
+    noteHeapWrite(rel);
+    // Tuple number add 1.
+    pinPageWithHint(rel->bm, h, 0, BM_HINT_HOT);
+    memcpy(&numTuples, h->data + 3 * sizeof(int), sizeof(int));
+    numTuples++;       
+    memcpy(h->data + 3 * sizeof(int), &numTuples, sizeof(int));
+    markDirty(rel->bm, h);
+    unpinPage(rel->bm, h);
+
+    free(h);
+    return RC_OK;
+}
+
+// Inserts a record into the partition of a partitioned table it belongs to
+static RC insertPartitionedRecord (RM_TableData *rel, Record *record) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+    int partition;
+    RC rc = ptPartitionOf(tableMgmt->partitioning, record->data, &partition);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    if ((rc = insertRecord(&tableMgmt->partitions[partition], record)) != RC_OK) {
+        return rc;
+    }
+    record->id.page = PARTITION_RID_PAGE(partition, record->id.page);
+    return RC_OK;
+}
+
+// Updates a record of a partitioned table; a record whose new value belongs to another partition moves there and gets a new RID
+static RC updatePartitionedRecord (RM_TableData *rel, Record *record) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)rel->mgmtData;
+    RID inner;
+    RM_TableData *from = ridPartition(rel, record->id, &inner);
+    int partition;
+    if (from == NULL) {
+        return RC_RM_RECORD_NOT_EXIST;
+    }
+    RC rc = ptPartitionOf(tableMgmt->partitioning, record->data, &partition);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    if (&tableMgmt->partitions[partition] == from) {
+        Record stored = *record;
+        stored.id = inner;
+        return updateRecord(from, &stored);
+    }
+    if ((rc = deleteRecord(from, inner)) != RC_OK) {
+        return rc;
+    }
+    return insertPartitionedRecord(rel, record);
+}
+
+/**
+ * Inserts a record into the specified table.
+ * This function adds a new record to the table, incorporating it into the existing data set,
+ * and then adds it to the indexes attached to the table.
+ *
+ * @param rel Pointer to the RM_TableData structure representing the table.
+ * @param record Pointer to the Record structure containing the data to insert.
+ * @return RC Result code indicating the success or failure of the insertion operation.
+ */
+
+RC insertRecord (RM_TableData *rel, Record *record) {
+    RC rc;
+    if (tableLsm(rel) != NULL) {
+        rc = lsmInsert(tableLsm(rel), record->data, &record->id);
+    } else if (tableClustered(rel) != NULL) {
+        rc = clInsert(tableClustered(rel), record->data, &record->id);
+    } else if (tableTimeseries(rel) != NULL) {
+        rc = tsInsert(tableTimeseries(rel), record->data, &record->id);
+    } else if (tablePartitioning(rel) != NULL) {
+        rc = insertPartitionedRecord(rel, record);
+    } else {
+        rc = insertHeapRecord(rel, record);
+    }
+    if (rc != RC_OK) {
+        return rc;
+    }
+    return notifyIndexes(rel, record, true);
+}
+
+// Deletes a record from the storage of a table, whatever its engine, without telling the indexes
+static RC deleteStoredRecord(RM_TableData *table, RID id) {
+    if (tableLsm(table) != NULL) {
+        return lsmDelete(tableLsm(table), id);
+    }
+    if (tableClustered(table) != NULL) {
+        return clDelete(tableClustered(table), id);
+    }
+    if (tablePartitioning(table) != NULL) {
+        RID inner;
+        RM_TableData *partition = ridPartition(table, id, &inner);
+        return partition != NULL ? deleteRecord(partition, inner) : RC_RM_RECORD_NOT_EXIST;
+    }
+
+    // Allocate memory for a page handle
+    BM_PageHandle *pageHandle = MAKE_PAGE_HANDLE();
+    if (pageHandle == NULL) {
+        return RC_INSUFFICIENT_MEMORY;  // Memory allocation failed
+    }
+
+    int recordSize = getRecordSize(table->schema);
+    int numTuples;
+    
     // Mark record as deleted by setting its status to false.
     char deletedRecord[recordSize + sizeof(bool)]; // Deleted record buffer
     memset(deletedRecord, 0, sizeof(bool)); // Set status to false
@@ -565,12 +1545,13 @@ RC deleteRecord(RM_TableData *table, RID id) {
     
     // Delete record.
     pinPage(table->bm, pageHandle, id.page);
-    memcpy(pageHandle->data + PAGE_SIZE * id.slot, deletedRecord, sizeof(bool) + recordSize);
+    memcpy(pageHandle->data + 256 * id.slot, deletedRecord, sizeof(bool) + recordSize);
     markDirty(table->bm, pageHandle);
     unpinPage(table->bm, pageHandle);
+    noteHeapWrite(table);
     
     // Update total tuple count.
-    pinPage(table->bm, pageHandle, 0);
+    pinPageWithHint(table->bm, pageHandle, 0, BM_HINT_HOT);
     memcpy(&numTuples, pageHandle->data + 3 * sizeof(int), sizeof(int));
     numTuples--;       
     memcpy(pageHandle->data + 3 * sizeof(int), &numTuples, sizeof(int));
@@ -581,18 +1562,51 @@ RC deleteRecord(RM_TableData *table, RID id) {
     return RC_OK;
 }
 
-
 /**
- * Updates a record in the specified table based on its ID.
- * This function modifies the data of the record identified by its ID in the table.
+ * Deletes a record from the specified table by its ID.
+ * This function removes the record identified by the given ID from the table. The attached indexes drop the record
+ * only once it is gone from the table, so a delete that fails leaves them as they were.
  *
  * @param table Pointer to the RM_TableData structure representing the table.
- * @param newRecord Pointer to the Record structure containing the updated data.
- * @return RC Result code indicating the success or failure of the update operation.
+ * @param id The ID of the record to delete.
+ * @return RC Result code indicating the success or failure of the deletion operation.
  */
 
 
-RC updateRecord(RM_TableData *table, Record *newRecord) {
+RC deleteRecord(RM_TableData *table, RID id) {
+    if (tableTimeseries(table) != NULL) {
+        return RC_INVALID_ARGS;  // append-only: records go with truncateTable or dropTable
+    }
+    Record old;
+    bool indexed;
+    RC rc = readIndexedRecord(table, id, &old, &indexed);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    // The indexes only let go of the record once it is gone from the table
+    rc = deleteStoredRecord(table, id);
+    if (indexed) {
+        if (rc == RC_OK) {
+            rc = notifyIndexes(table, &old, false);
+        }
+        free(old.data);
+    }
+    return rc;
+}
+
+// Updates a record in the storage of a table, whatever its engine, without telling the indexes
+static RC updateStoredRecord(RM_TableData *table, Record *newRecord) {
+    if (tableLsm(table) != NULL) {
+        return lsmUpdate(tableLsm(table), newRecord->id, newRecord->data);
+    }
+    if (tableClustered(table) != NULL) {
+        return clUpdate(tableClustered(table), newRecord->id, newRecord->data);
+    }
+    if (tablePartitioning(table) != NULL) {
+        return updatePartitionedRecord(table, newRecord);
+    }
+
     // Calculate the size of a record based on the table's schema
     int recordSize = getRecordSize(table->schema);
     
@@ -618,14 +1632,51 @@ RC updateRecord(RM_TableData *table, Record *newRecord) {
     
     // Unpin the page after finishing the update
     unpinPage(table->bm, pageHandle);
+    noteHeapWrite(table);
     
     // Release the memory allocated for the page handle
     free(pageHandle);
     
-    return RC_OK;  // Return success
+    return RC_OK;
+}
+
+/**
+ * Updates a record in the specified table based on its ID.
+ * This function modifies the data of the record identified by its ID in the table. In a partitioned table a record
+ * whose new value of the partition attribute belongs to another partition moves there, and newRecord->id is set to
+ * its new RID. The attached indexes see the change only once the table has taken it, so an update that fails leaves
+ * them as they were.
+ *
+ * @param table Pointer to the RM_TableData structure representing the table.
+ * @param newRecord Pointer to the Record structure containing the updated data.
+ * @return RC Result code indicating the success or failure of the update operation.
+ */
+
+
+RC updateRecord(RM_TableData *table, Record *newRecord) {
+    if (tableTimeseries(table) != NULL) {
+        return RC_INVALID_ARGS;  // append-only
+    }
+    Record old;
+    bool indexed;
+    RC rc = readIndexedRecord(table, newRecord->id, &old, &indexed);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    // The indexes only see the change once the table has taken it
+    rc = updateStoredRecord(table, newRecord);
+    if (indexed) {
+        if (rc == RC_OK) {
+            rc = notifyIndexes(table, &old, false);
+        }
+        free(old.data);
+    }
+    return rc == RC_OK ? notifyIndexes(table, newRecord, true) : rc;
 }
 
 
+
 /**
  * Retrieves a record from the specified table based on its ID.
  * This function retrieves the record identified by the given ID from the table.
@@ -637,6 +1688,31 @@ RC updateRecord(RM_TableData *table, Record *newRecord) {
  */
 
 RC getRecord(RM_TableData *table, RID recordID, Record *outputRecord) {
+    if (tablePartitioning(table) != NULL) {
+        RID inner;
+        RM_TableData *partition = ridPartition(table, recordID, &inner);
+        if (partition == NULL) {
+            return RC_RM_RECORD_NOT_EXIST;
+        }
+        RC rc = getRecord(partition, inner, outputRecord);
+        outputRecord->id = recordID;
+        return rc;
+    }
+    if (tableLsm(table) != NULL || tableClustered(table) != NULL || tableTimeseries(table) != NULL) {
+        char *data = (char *)malloc(getRecordSize(table->schema));
+        if (data == NULL) {
+            return RC_INSUFFICIENT_MEMORY;
+        }
+        RC rc = getStoredRecord(table, recordID, data);
+        if (rc != RC_OK) {
+            free(data);
+            return rc;
+        }
+        outputRecord->id = recordID;
+        outputRecord->data = data;
+        return RC_OK;
+    }
+
     // Allocate memory for a page handle
     BM_PageHandle *pageHandle = MAKE_PAGE_HANDLE();
     if (pageHandle == NULL) {
@@ -658,6 +1734,7 @@ RC getRecord(RM_TableData *table, RID recordID, Record *outputRecord) {
     // Check if the record exists by reading the status flag
     recordExists = *(bool *)(pageHandle->data + 256 * recordID.slot);
     if (!recordExists) {
+        unpinPage(table->bm, pageHandle);
         free(pageHandle);
         return RC_RM_RECORD_NOT_EXIST;  // Record doesn't exist
     } else {
@@ -686,13 +1763,154 @@ RC getRecord(RM_TableData *table, RID recordID, Record *outputRecord) {
 }
 
 
+// Looks a key up in the clustered partitions of a partitioned table; only in the one it belongs to if the partition attribute is a key attribute
+static RC getPartitionedRecordByKey(RM_TableData *table, Value **keys, Record *outputRecord) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)table->mgmtData;
+    int first = 0, last = ptNumPartitions(tableMgmt->partitioning) - 1;
+    for (int k = 0; k < table->schema->keySize; k++) {
+        if (table->schema->keyAttrs[k] == ptPartitionAttr(tableMgmt->partitioning)) {
+            RC rc = ptPartitionOfValue(tableMgmt->partitioning, keys[k], &first);
+            if (rc != RC_OK) {
+                return rc;
+            }
+            last = first;
+            break;
+        }
+    }
+    for (int i = first; i <= last; i++) {
+        RC rc = getRecordByKey(&tableMgmt->partitions[i], keys, outputRecord);
+        if (rc == RC_OK) {
+            outputRecord->id.page = PARTITION_RID_PAGE(i, outputRecord->id.page);
+        }
+        if (rc != RC_IM_KEY_NOT_FOUND) {
+            return rc;
+        }
+    }
+    return RC_IM_KEY_NOT_FOUND;
+}
+
+/**
+ * Retrieves a record of a clustered table by its key.
+ * The lookup descends the tree of the table to the leaf holding the record and copies it from there. A partitioned
+ * table of clustered partitions looks in the partition the key belongs to.
+ *
+ * @param table Pointer to the RM_TableData structure representing the table.
+ * @param keys One value per key attribute of the schema, in the order of Schema.keyAttrs.
+ * @param outputRecord Pointer to the Record structure to populate with the retrieved record and its ID.
+ * @return RC_OK, RC_IM_KEY_NOT_FOUND, RC_INVALID_ARGS for a table that is not clustered or a value of the wrong
+ *         type, or an error code.
+ */
+
+RC getRecordByKey(RM_TableData *table, Value **keys, Record *outputRecord) {
+    if (table == NULL || keys == NULL || outputRecord == NULL) {
+        return RC_NULL_POINTER;
+    }
+    if (tablePartitioning(table) != NULL) {
+        return getPartitionedRecordByKey(table, keys, outputRecord);
+    }
+    if (tableClustered(table) == NULL) {
+        return RC_INVALID_ARGS;
+    }
+    char *data = (char *)malloc(getRecordSize(table->schema));
+    if (data == NULL) {
+        return RC_INSUFFICIENT_MEMORY;
+    }
+    RC rc = clGetByKey(tableClustered(table), keys, &outputRecord->id, data);
+    if (rc != RC_OK) {
+        free(data);
+        return rc;
+    }
+    outputRecord->data = data;
+    return RC_OK;
+}
+
+
+/**
+ * Collects the data pages of a table by walking the page metadata chain.
+ * Each metadata page holds (page number, record count) pairs, a count of -1 marks the first unused entry,
+ * and the last int of the page links to the next metadata page (-1 if none).
+ *
+ * @param table Pointer to the RM_TableData structure representing the table.
+ * @param pages Set to a malloc'ed array of data page numbers, in insertion order.
+ * @param numPages Set to the number of entries in pages.
+ * @return RC Result code indicating the success or failure of the operation.
+ */
+
+static RC collectDataPages(RM_TableData *table, int **pages, int *numPages) {
+    BM_PageHandle *pageHandle = MAKE_PAGE_HANDLE();
+    int entriesPerPage = PAGE_SIZE / (2 * sizeof(int)) - 1;  // last pair holds the link
+    int metaPage = getFileMetaDataSize(table->bm);
+    int capacity = 16, count = 0;
+    int *result = (int *)malloc(capacity * sizeof(int));
+
+    if (pageHandle == NULL || result == NULL) {
+        free(pageHandle);
+        free(result);
+        return RC_MEM_ERROR;
+    }
+
+    while (metaPage != -1) {
+        if (pinPageWithHint(table->bm, pageHandle, metaPage, BM_HINT_HOT) != RC_OK) {
+            free(pageHandle);
+            free(result);
+            return RC_PIN_PAGE_FAILED;
+        }
+
+        int *entries = (int *)pageHandle->data;
+        for (int i = 0; i < entriesPerPage && entries[2 * i + 1] != -1; i++) {
+            if (count == capacity) {
+                capacity *= 2;
+                result = (int *)realloc(result, capacity * sizeof(int));
+            }
+            result[count++] = entries[2 * i];
+        }
+        memcpy(&metaPage, pageHandle->data + PAGE_SIZE - sizeof(int), sizeof(int));
+        unpinPage(table->bm, pageHandle);
+    }
+
+    free(pageHandle);
+    *pages = result;
+    *numPages = count;
+    return RC_OK;
+}
+
+/**
+ * Returns the next 32 random bits of a sample scan's page selection (splitmix64).
+ *
+ * @param state Generator state, advanced by the call.
+ * @return A random number in [0, 2^32).
+ */
+
+static unsigned long long sampleRandom(unsigned long long *state) {
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (z ^ (z >> 31)) >> 32;
+}
+
+// Hands a started scan to its handle and counts it among the open scans of the table until closeScan
+static void openScan (RM_TableData *table, RM_ScanHandle *scan, Expr *condition, RM_ScanMgmt *scanMgmt) {
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)table->mgmtData;
+
+    pthread_mutex_lock(&tableMgmt->scanLatch);
+    tableMgmt->activeScans++;
+    pthread_mutex_unlock(&tableMgmt->scanLatch);
+    scan->rel = table;
+    scan->expr = condition;
+    scan->mgmtData = scanMgmt;
+    scan->currentPage = -1;
+}
+
 /**
  * Initializes a scan based on the specified parameters.
  * This function sets up a scan operation on the given table with the provided scan handle and optional condition.
+ * If other scans of the table are running, the new scan starts at the page they are currently reading and wraps
+ * around to the pages it skipped, so concurrent scans share the pages brought into the buffer pool.
+ * If an index attached to the table selects the records that can match the condition, the scan only reads those.
  *
  * @param table Pointer to the RM_TableData structure representing the table to scan.
  * @param scan Pointer to the RM_ScanHandle structure to initialize for the scan.
- * @param condition Pointer to the Expr structure representing the optional condition for the scan.
+ * @param condition Pointer to the Expr structure representing the optional condition for the scan (NULL matches every record).
  * @return RC Result code indicating the success or failure of the scan initialization.
  */
 
@@ -703,16 +1921,237 @@ RC startScan(RM_TableData *table, RM_ScanHandle *scan, Expr *condition) {
 
     memset(scan, 0, sizeof(RM_ScanHandle)); // Initialize scan handle to zero
 
-    scan->rel = table;
-    scan->expr = condition;
+    RM_ScanMgmt *scanMgmt = (RM_ScanMgmt *)calloc(1, sizeof(RM_ScanMgmt));
+    if (scanMgmt == NULL) {
+        return RC_MEM_ERROR;
+    }
+
+    // An index that narrows the condition down to a list of records spares reading the other pages
+    RM_IndexHooks **hooks;
+    void **indexes;
+    int numIndexes = condition != NULL ? tableIndexes(table, &hooks, &indexes) : 0;
+    for (int i = 0; i < numIndexes && scanMgmt->rids == NULL; i++) {
+        if (hooks[i]->candidates == NULL) {
+            continue;
+        }
+        RC rc = hooks[i]->candidates(indexes[i], condition, &scanMgmt->rids, &scanMgmt->numRids, &scanMgmt->exact);
+        if (rc != RC_OK) {
+            free(scanMgmt);
+            return rc;
+        }
+    }
+    if (scanMgmt->rids != NULL) {
+        openScan(table, scan, condition, scanMgmt);
+        return RC_OK;
+    }
+
+    // A partitioned table scans the partitions the condition leaves, one after the other
+    if (tablePartitioning(table) != NULL) {
+        int n = ptNumPartitions(tablePartitioning(table));
+        bool selected[n];
+        RC rc = ptPrune(tablePartitioning(table), condition, selected);
+        if (rc == RC_OK && (scanMgmt->parts = (int *)malloc(n * sizeof(int))) == NULL) {
+            rc = RC_MEM_ERROR;
+        }
+        if (rc != RC_OK) {
+            free(scanMgmt);
+            return rc;
+        }
+        for (int i = 0; i < n; i++) {
+            if (selected[i]) {
+                scanMgmt->parts[scanMgmt->numParts++] = i;
+            }
+        }
+        openScan(table, scan, condition, scanMgmt);
+        return RC_OK;
+    }
+
+    // A clustered table reads its leaves in key order, from the first key the condition lets through
+    if (tableClustered(table) != NULL) {
+        RC rc = clOpenScan(tableClustered(table), condition, &scanMgmt->clScan);
+        if (rc != RC_OK) {
+            free(scanMgmt);
+            return rc;
+        }
+        openScan(table, scan, condition, scanMgmt);
+        return RC_OK;
+    }
+
+    // A time-series table decodes the blocks that overlap the time range of the condition
+    if (tableTimeseries(table) != NULL) {
+        RC rc = tsOpenScan(tableTimeseries(table), condition, expiryNow(), &scanMgmt->tsScan);
+        if (rc != RC_OK) {
+            free(scanMgmt);
+            return rc;
+        }
+        openScan(table, scan, condition, scanMgmt);
+        return RC_OK;
+    }
+
+    // An LSM table merges its memtable and files in RID order
+    if (tableLsm(table) != NULL) {
+        RC rc = lsmOpenScan(tableLsm(table), &scanMgmt->lsmScan);
+        if (rc != RC_OK) {
+            free(scanMgmt);
+            return rc;
+        }
+        openScan(table, scan, condition, scanMgmt);
+        return RC_OK;
+    }
+
+    RC rc = collectDataPages(table, &scanMgmt->pages, &scanMgmt->numPages);
+    if (rc != RC_OK) {
+        free(scanMgmt);
+        return rc;
+    }
+    scanMgmt->recordsPerPage = (PAGE_SIZE / 256) / ((getRecordSize(table->schema) + sizeof(bool)) / 256 + 1);
+
+    // Join the scans already running at the page they report
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)table->mgmtData;
+    pthread_mutex_lock(&tableMgmt->scanLatch);
+    if (tableMgmt->sharedScans > 0) {
+        for (int i = 0; i < scanMgmt->numPages; i++) {
+            if (scanMgmt->pages[i] == tableMgmt->syncPage) {
+                scanMgmt->startPos = i;
+                break;
+            }
+        }
+    }
+    tableMgmt->sharedScans++;
+    pthread_mutex_unlock(&tableMgmt->scanLatch);
+    scanMgmt->shared = true;
+
+    openScan(table, scan, condition, scanMgmt);
+    scan->currentPage = scanMgmt->numPages > 0 ? scanMgmt->pages[scanMgmt->startPos] : -1;
+
+    return RC_OK;
+}
+
+/**
+ * Initializes a scan over a random sample of the table's data pages.
+ * Every data page is kept independently with probability fraction, so the scan reads about fraction of the pages
+ * and returns the tuples on them that satisfy the condition; aggregates over the sample are scaled by 1 / fraction.
+ * The same seed over the same table gives the same sample. Sample scans do not join the synchronized scans of the table.
+ *
+ * @param table Pointer to the RM_TableData structure representing the table to scan.
+ * @param scan Pointer to the RM_ScanHandle structure to initialize for the scan.
+ * @param condition Pointer to the Expr structure representing the optional condition for the scan (NULL matches every record).
+ * @param fraction Probability of a data page being part of the sample, in (0, 1].
+ * @param seed Seed of the page selection.
+ * @return RC Result code indicating the success or failure of the scan initialization.
+ */
+
+RC startSampleScan(RM_TableData *table, RM_ScanHandle *scan, Expr *condition, float fraction, unsigned int seed) {
+    if (table == NULL || scan == NULL) {
+        return RC_INVALID_HANDLE;
+    }
+    if (!(fraction > 0 && fraction <= 1) || tableLsm(table) != NULL || tableClustered(table) != NULL
+            || tableTimeseries(table) != NULL || tablePartitioning(table) != NULL) {
+        return RC_INVALID_ARGS;  // only heap tables have slotted data pages of their own to sample
+    }
+
+    memset(scan, 0, sizeof(RM_ScanHandle));
+
+    RM_ScanMgmt *scanMgmt = (RM_ScanMgmt *)calloc(1, sizeof(RM_ScanMgmt));
+    if (scanMgmt == NULL) {
+        return RC_MEM_ERROR;
+    }
+
+    RC rc = collectDataPages(table, &scanMgmt->pages, &scanMgmt->numPages);
+    if (rc != RC_OK) {
+        free(scanMgmt);
+        return rc;
+    }
+    scanMgmt->recordsPerPage = (PAGE_SIZE / 256) / ((getRecordSize(table->schema) + sizeof(bool)) / 256 + 1);
+
+    // Bernoulli selection of pages, compacted in place so next() only visits the sample
+    unsigned long long state = seed;
+    unsigned long long threshold = (unsigned long long)(fraction * 4294967296.0);
+    int kept = 0;
+    for (int i = 0; i < scanMgmt->numPages; i++) {
+        if (sampleRandom(&state) < threshold) {
+            scanMgmt->pages[kept++] = scanMgmt->pages[i];
+        }
+    }
+    scanMgmt->numPages = kept;
+
+    openScan(table, scan, condition, scanMgmt);
+    scan->currentPage = kept > 0 ? scanMgmt->pages[0] : -1;
+
+    return RC_OK;
+}
+
+
+/**
+ * Initializes a scan whose condition runs as native code.
+ * The condition is compiled into a filter over whole pages (see expr_codegen.h); conditions of the same shape
+ * reuse the filter compiled first. If the condition cannot be compiled the scan interprets it like startScan.
+ *
+ * @param table Pointer to the RM_TableData structure representing the table to scan.
+ * @param scan Pointer to the RM_ScanHandle structure to initialize for the scan.
+ * @param condition Pointer to the Expr structure representing the optional condition for the scan (NULL matches every record).
+ * @return RC Result code indicating the success or failure of the scan initialization.
+ */
+
+RC startCompiledScan(RM_TableData *table, RM_ScanHandle *scan, Expr *condition) {
+    RC rc = startScan(table, scan, condition);
+    if (rc != RC_OK || condition == NULL) {
+        return rc;
+    }
+
+    RM_ScanMgmt *scanMgmt = (RM_ScanMgmt *)scan->mgmtData;
+    ExprPageFilter filter;
+    if (scanMgmt->parts != NULL) {
+        scanMgmt->compiled = true;  // the scans of the partitions compile the condition
+        return RC_OK;
+    }
+    if (scanMgmt->lsmScan != NULL || scanMgmt->clScan != NULL || scanMgmt->tsScan != NULL || scanMgmt->rids != NULL) {
+        return RC_OK;  // the page filter needs slotted pages; other engines and index scans interpret the condition
+    }
+    if (getExprParams(condition, scanMgmt->params, EXPR_MAX_PARAMS) >= 0
+            && compileExprFilter(condition, table->schema, &filter) == RC_OK) {
+        scanMgmt->filter = filter;
+    }
+    return RC_OK;
+}
+
+
+/**
+ * Adds a test on the stored bytes of a record to a scan.
+ * The scan applies it to every record before the condition and before the record is copied out, so a cheap
+ * test that drops most records (such as the bloom filter of a semi-join, see join_filter.h) saves the rest of
+ * the work on them. Records the test rejects are not returned.
+ *
+ * @param scan The scan, started and not yet advanced.
+ * @param filter The test, or NULL to remove it; must stay valid until the scan is closed.
+ * @param arg Passed to the test with the bytes of each record.
+ * @return RC_OK, or RC_NULL_POINTER for a scan that is not open.
+ */
 
+RC setScanRowFilter(RM_ScanHandle *scan, RM_RowFilter filter, void *arg) {
+    if (scan == NULL || scan->mgmtData == NULL) {
+        return RC_NULL_POINTER;
+    }
+    RM_ScanMgmt *scanMgmt = (RM_ScanMgmt *)scan->mgmtData;
+    scanMgmt->rowFilter = filter;
+    scanMgmt->rowFilterArg = arg;
     return RC_OK;
 }
 
 
+// Evaluates the compiled condition of a scan for every record of its current page
+static void filterPage(RM_ScanMgmt *scanMgmt, RM_TableMgmt *tableMgmt, int tupleSize) {
+    scanMgmt->filter(scanMgmt->page.data, scanMgmt->recordsPerPage, 256 * tupleSize, scanMgmt->params,
+                     scanMgmt->matches);
+    scanMgmt->filterWrites = tableMgmt->heapWrites;
+}
+
 /**
  * Searches for the next tuple in the scan handle that satisfies the scan condition and returns it in the parameter "record".
  * This function advances the scan operation to the next tuple that meets the specified condition.
+ * The current data page stays pinned between calls until the scan moves past it. A compiled scan evaluates its
+ * condition for the whole page when it pins it, and again when the table was written to in the meantime, so records
+ * deleted or updated during the scan are seen as they are now.
  *
  * @param scan Pointer to the RM_ScanHandle structure representing the scan operation.
  * @param record Pointer to the Record structure to populate with the next tuple.
@@ -720,96 +2159,322 @@ RC startScan(RM_TableData *table, RM_ScanHandle *scan, Expr *condition) {
  */
 
 RC next(RM_ScanHandle *scan, Record *record) {
-    if (scan == NULL || record == NULL || scan->rel == NULL || scan->rel->bm == NULL || scan->expr == NULL) {
+    if (scan == NULL || record == NULL || scan->rel == NULL || scan->rel->bm == NULL || scan->mgmtData == NULL) {
         return RC_NULL_POINTER;
     }
 
+    RM_ScanMgmt *scanMgmt = (RM_ScanMgmt *)scan->mgmtData;
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)scan->rel->mgmtData;
     BM_BufferPool *bufferPool = scan->rel->bm;
-    int index = getFileMetaDataSize(bufferPool);
-    int tupleSize = (getRecordSize(scan->rel->schema) + sizeof(bool)) / 256 + 1;
+    int recordSize = getRecordSize(scan->rel->schema);
+    int tupleSize = (recordSize + sizeof(bool)) / 256 + 1;
+    Record current;
 
-    BM_PageHandle *pageHandle = (BM_PageHandle*)calloc(1, sizeof(BM_PageHandle));
-    if (pageHandle == NULL) {
-        return RC_MEM_ERROR;
+    // Records selected by an index, in RID order so that the records of a page follow each other
+    while (scanMgmt->rids != NULL) {
+        if (scanMgmt->ridPos == scanMgmt->numRids) {
+            return RC_RM_NO_MORE_TUPLES;
+        }
+        current.id = scanMgmt->rids[scanMgmt->ridPos++];
+
+        if (tablePartitioning(scan->rel) != NULL) {
+            Record stored;
+            RC rc = getRecord(scan->rel, current.id, &stored);
+            if (rc == RC_RM_RECORD_NOT_EXIST) {
+                continue;
+            }
+            if (rc != RC_OK) {
+                return rc;
+            }
+            free(scanMgmt->lsmRecord);
+            scanMgmt->lsmRecord = stored.data;
+            current.data = scanMgmt->lsmRecord;
+        } else if (tableLsm(scan->rel) != NULL || tableClustered(scan->rel) != NULL || tableTimeseries(scan->rel) != NULL) {
+            if (scanMgmt->lsmRecord == NULL && (scanMgmt->lsmRecord = (char *)malloc(recordSize)) == NULL) {
+                return RC_MEM_ERROR;
+            }
+            RC rc = getStoredRecord(scan->rel, current.id, scanMgmt->lsmRecord);
+            if (rc == RC_RM_RECORD_NOT_EXIST) {
+                continue;
+            }
+            if (rc != RC_OK) {
+                return rc;
+            }
+            current.data = scanMgmt->lsmRecord;
+        } else {
+            if (scanMgmt->pinned && scan->currentPage != current.id.page) {
+                unpinPage(bufferPool, &scanMgmt->page);
+                scanMgmt->pinned = false;
+            }
+            if (!scanMgmt->pinned) {
+                RC rc = pinPage(bufferPool, &scanMgmt->page, current.id.page);
+                if (rc != RC_OK) {
+                    return rc;
+                }
+                scanMgmt->pinned = true;
+                scan->currentPage = current.id.page;
+            }
+            char *slotData = scanMgmt->page.data + 256 * current.id.slot;
+            if (!*(bool *)slotData) {
+                continue;
+            }
+            current.data = slotData + sizeof(bool);
+        }
+
+        if (scanMgmt->rowFilter != NULL && !scanMgmt->rowFilter(scanMgmt->rowFilterArg, current.data)) {
+            continue;
+        }
+        if (scan->expr != NULL && !scanMgmt->exact) {
+            Value *result;
+            RC rc = evalExpr(&current, scan->rel->schema, scan->expr, &result);
+            if (rc != RC_OK) {
+                return rc;
+            }
+            bool match = result->v.boolV;
+            freeVal(result);
+            if (!match) {
+                continue;
+            }
+        }
+        if (record->data == NULL) {
+            record->data = (char *)malloc(recordSize);
+            if (record->data == NULL) {
+                return RC_MEM_ERROR;
+            }
+        }
+        memcpy(record->data, current.data, recordSize);
+        record->id = current.id;
+        scan->currentSlot = current.id.slot;
+        return RC_OK;
     }
 
-    pinPage(bufferPool, pageHandle, index);
+    // The partitions of a partitioned table, each read by a scan of its own
+    while (scanMgmt->parts != NULL) {
+        if (scanMgmt->partScan == NULL) {
+            if (scanMgmt->partPos == scanMgmt->numParts) {
+                return RC_RM_NO_MORE_TUPLES;
+            }
+            RM_TableData *partition = &tableMgmt->partitions[scanMgmt->parts[scanMgmt->partPos]];
+            RM_ScanHandle *partScan = (RM_ScanHandle *)malloc(sizeof(RM_ScanHandle));
+            if (partScan == NULL) {
+                return RC_MEM_ERROR;
+            }
+            RC rc = scanMgmt->compiled ? startCompiledScan(partition, partScan, scan->expr)
+                                       : startScan(partition, partScan, scan->expr);
+            if (rc != RC_OK) {
+                free(partScan);
+                return rc;
+            }
+            setScanRowFilter(partScan, scanMgmt->rowFilter, scanMgmt->rowFilterArg);
+            scanMgmt->partScan = partScan;
+        }
+        RC rc = next(scanMgmt->partScan, record);
+        if (rc == RC_OK) {
+            record->id.page = PARTITION_RID_PAGE(scanMgmt->parts[scanMgmt->partPos], record->id.page);
+            return RC_OK;
+        }
+        if (rc != RC_RM_NO_MORE_TUPLES) {
+            return rc;
+        }
+        closeScan(scanMgmt->partScan);
+        free(scanMgmt->partScan);
+        scanMgmt->partScan = NULL;
+        scanMgmt->partPos++;
+    }
+
+    while (scanMgmt->lsmScan != NULL || scanMgmt->clScan != NULL || scanMgmt->tsScan != NULL) {
+        RC rc = scanMgmt->lsmScan != NULL ? lsmNext(scanMgmt->lsmScan, &current.id, &current.data)
+              : scanMgmt->clScan != NULL ? clNext(scanMgmt->clScan, &current.id, &current.data)
+              : tsNext(scanMgmt->tsScan, &current.id, &current.data);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        if (scanMgmt->rowFilter != NULL && !scanMgmt->rowFilter(scanMgmt->rowFilterArg, current.data)) {
+            continue;
+        }
+        if (scan->expr != NULL) {
+            Value *result;
+            rc = evalExpr(&current, scan->rel->schema, scan->expr, &result);
+            if (rc != RC_OK) {
+                return rc;
+            }
+            bool match = result->v.boolV;
+            freeVal(result);
+            if (!match) {
+                continue;
+            }
+        }
+        if (record->data == NULL) {
+            record->data = (char *)malloc(recordSize);
+            if (record->data == NULL) {
+                return RC_MEM_ERROR;
+            }
+        }
+        memcpy(record->data, current.data, recordSize);
+        record->id = current.id;
+        return RC_OK;
+    }
 
-    while (scan->currentPage != index) {
-        int rPage, maxSlot;
-        memcpy(&rPage, pageHandle->data + (scan->currentPage) * 2 * sizeof(int), sizeof(int));
-        memcpy(&maxSlot, pageHandle->data + ((scan->currentPage) * 2 + 1) * sizeof(int), sizeof(int));
+    while (scanMgmt->visited < scanMgmt->numPages) {
+        int pos = (scanMgmt->startPos + scanMgmt->visited) % scanMgmt->numPages;
 
-        if (maxSlot != -1) {
-            for (int i = scan->currentSlot; i < maxSlot; i++) {
-                RID rid = { .page = rPage, .slot = i * tupleSize };
-                Record *tempRecord = (Record *)calloc(1, sizeof(Record));
-                if (tempRecord == NULL) {
-                    unpinPage(bufferPool, pageHandle);
-                    free(pageHandle);
-                    return RC_MEM_ERROR;
-                }
+        if (!scanMgmt->pinned) {
+            RC rc = pinPageWithHint(bufferPool, &scanMgmt->page, scanMgmt->pages[pos], BM_HINT_SCAN);
+            if (rc != RC_OK) {
+                return rc;
+            }
+            scanMgmt->pinned = true;
+            scan->currentPage = scanMgmt->pages[pos];
+
+            // Report the position so that scans starting now join here
+            if (scanMgmt->shared) {
+                pthread_mutex_lock(&tableMgmt->scanLatch);
+                tableMgmt->syncPage = scan->currentPage;
+                pthread_mutex_unlock(&tableMgmt->scanLatch);
+            }
 
-                RC rc = getRecord(scan->rel, rid, tempRecord);
-                if (rc == RC_OK) {
-                    Value *result = (Value *)calloc(1, sizeof(Value));
-                    if (result == NULL) {
-                        free(tempRecord);
-                        unpinPage(bufferPool, pageHandle);
-                        free(pageHandle);
-                        return RC_MEM_ERROR;
-                    }
+            // Evaluate a compiled condition for the whole page at once
+            if (scanMgmt->filter != NULL) {
+                filterPage(scanMgmt, tableMgmt, tupleSize);
+            }
+        } else if (scanMgmt->filter != NULL && scanMgmt->filterWrites != tableMgmt->heapWrites) {
+            // The table was written to since, so the records of the page may have changed
+            filterPage(scanMgmt, tableMgmt, tupleSize);
+        }
 
-                    evalExpr(tempRecord, scan->rel->schema, scan->expr, &result);
-                    if (result->v.boolV) {
-                        record->id.page = rid.page;
-                        record->id.slot = rid.slot;
-                        record->data = tempRecord->data;
-
-                        if (i == maxSlot - 1) {
-                            scan->currentPage++;
-                            scan->currentSlot = 0;
-                        } else {
-                            scan->currentSlot = i + 1;
-                        }
-
-                        free(result);
-                        free(tempRecord);
-                        unpinPage(bufferPool, pageHandle);
-                        free(pageHandle);
-                        return RC_OK;
-                    }
+        while (scanMgmt->slot < scanMgmt->recordsPerPage) {
+            int slot = scanMgmt->slot * tupleSize;
+            char *slotData = scanMgmt->page.data + 256 * slot;
+            scanMgmt->slot++;
 
-                    free(result);
+            if (!*(bool *)slotData) {
+                // Skip deleted and never written slots
+                continue;
+            }
+            if (scanMgmt->filter != NULL && !scanMgmt->matches[scanMgmt->slot - 1]) {
+                continue;
+            }
+
+            current.id.page = scan->currentPage;
+            current.id.slot = slot;
+            current.data = slotData + sizeof(bool);
+            if (scanMgmt->rowFilter != NULL && !scanMgmt->rowFilter(scanMgmt->rowFilterArg, current.data)) {
+                continue;
+            }
+
+            bool match = true;
+            if (scan->expr != NULL && scanMgmt->filter == NULL) {
+                Value *result;
+                RC rc = evalExpr(&current, scan->rel->schema, scan->expr, &result);
+                if (rc != RC_OK) {
+                    return rc;
                 }
+                match = result->v.boolV;
+                freeVal(result);
+            }
 
-                free(tempRecord);
+            if (match) {
+                if (record->data == NULL) {
+                    record->data = (char *)malloc(recordSize);
+                    if (record->data == NULL) {
+                        return RC_MEM_ERROR;
+                    }
+                }
+                memcpy(record->data, current.data, recordSize);
+                record->id = current.id;
+                scan->currentSlot = scanMgmt->slot;
+                return RC_OK;
             }
-        } else {
-            unpinPage(bufferPool, pageHandle);
-            free(pageHandle);
-            return RC_RM_NO_MORE_TUPLES;
         }
 
-        scan->currentPage++;
+        // Page done, move on to the next one
+        unpinPage(bufferPool, &scanMgmt->page);
+        scanMgmt->pinned = false;
+        scanMgmt->slot = 0;
+        scanMgmt->visited++;
+        scan->currentSlot = 0;
     }
 
-    unpinPage(bufferPool, pageHandle);
-    free(pageHandle);
     return RC_RM_NO_MORE_TUPLES;
 }
 
 /**
  * Function to close a scan handle.
+ * Releases the page the scan still holds and leaves the group of scans sharing the table.
  * @param scan The scan handle to be closed.
  * @return RC_OK on success, or an error code otherwise.
  */
 
 RC closeScan(RM_ScanHandle *scan) {
-    // No memory deallocation needed for scan since it was not dynamically allocated
+    if (scan == NULL || scan->mgmtData == NULL) {
+        return RC_OK;
+    }
+
+    RM_ScanMgmt *scanMgmt = (RM_ScanMgmt *)scan->mgmtData;
+    RM_TableMgmt *tableMgmt = (RM_TableMgmt *)scan->rel->mgmtData;
+
+    if (scanMgmt->pinned) {
+        unpinPage(scan->rel->bm, &scanMgmt->page);
+    }
+    if (scanMgmt->lsmScan != NULL) {
+        lsmCloseScan(scanMgmt->lsmScan);
+    }
+    if (scanMgmt->clScan != NULL) {
+        clCloseScan(scanMgmt->clScan);
+    }
+    if (scanMgmt->tsScan != NULL) {
+        tsCloseScan(scanMgmt->tsScan);
+    }
+    if (scanMgmt->partScan != NULL) {
+        closeScan(scanMgmt->partScan);
+        free(scanMgmt->partScan);
+    }
+    pthread_mutex_lock(&tableMgmt->scanLatch);
+    tableMgmt->activeScans--;
+    if (scanMgmt->shared) {
+        tableMgmt->sharedScans--;
+    }
+    pthread_mutex_unlock(&tableMgmt->scanLatch);
+
+    free(scanMgmt->pages);
+    free(scanMgmt->rids);
+    free(scanMgmt->lsmRecord);
+    free(scanMgmt->parts);
+    free(scanMgmt);
+    scan->mgmtData = NULL;
     return RC_OK;
 }
 
+/**
+ * Returns the number of partitions a scan of a partitioned table reads, after leaving out those its condition
+ * rules out.
+ *
+ * @param scan The scan.
+ * @return The number of partitions, 0 for a scan of a table that is not partitioned or one an index narrowed down.
+ */
+
+int getNumScanPartitions(RM_ScanHandle *scan) {
+    if (scan == NULL || scan->mgmtData == NULL) {
+        return 0;
+    }
+    return ((RM_ScanMgmt *)scan->mgmtData)->numParts;
+}
+
+/**
+ * Returns the number of compressed blocks a scan of a time-series table decodes, after leaving out those whose time
+ * range the condition rules out; the records of the tail page come on top.
+ *
+ * @param scan The scan.
+ * @return The number of blocks, 0 for a scan of another table or one an index narrowed down.
+ */
+
+int getNumScanBlocks(RM_ScanHandle *scan) {
+    if (scan == NULL || scan->mgmtData == NULL || ((RM_ScanMgmt *)scan->mgmtData)->tsScan == NULL) {
+        return 0;
+    }
+    return tsScanBlocks(((RM_ScanMgmt *)scan->mgmtData)->tsScan);
+}
+
 /**
  * Retrieves the size of a record described by the provided schema.
  * This function calculates the size of a record based on the layout defined by the schema.
@@ -1157,7 +2822,7 @@ int getFileMetaDataSize(BM_BufferPool *bufferPool) {
     BM_PageHandle *pageHandle = MAKE_PAGE_HANDLE();
 
     // Try to pin the first page
-    if (pinPage(bufferPool, pageHandle, 0) != RC_OK) {
+    if (pinPageWithHint(bufferPool, pageHandle, 0, BM_HINT_HOT) != RC_OK) {
         free(pageHandle);
         return -1; // Unable to pin the page
     }
@@ -1189,7 +2854,7 @@ int getRecordCostSlot(BM_BufferPool *bufferPool) {
     int costSlot = -1; // Initialize to -1 indicating failure
 
     // Try to pin the first page
-    if (pinPage(bufferPool, pageHandle, 0) != RC_OK) {
+    if (pinPageWithHint(bufferPool, pageHandle, 0, BM_HINT_HOT) != RC_OK) {
         free(pageHandle);
         return costSlot; // Return default value
     }
@@ -1219,7 +2884,7 @@ int getSlotSize(BM_BufferPool *bufferPool) {
     BM_PageHandle *pageHandle = MAKE_PAGE_HANDLE();
 
     // Try to pin the first page
-    if (pinPage(bufferPool, pageHandle, 0) != RC_OK) {
+    if (pinPageWithHint(bufferPool, pageHandle, 0, BM_HINT_HOT) != RC_OK) {
         free(pageHandle);
         return slotSize; // Return default value
     }
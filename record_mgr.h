@@ -15,25 +15,114 @@ typedef struct RM_ScanHandle
   void *mgmtData;
 } RM_ScanHandle;
 
+// Storage engines of a table
+typedef enum RM_Engine {
+  RM_ENGINE_HEAP = 0,   // slotted pages, updated in place
+  RM_ENGINE_LSM = 1,    // log-structured merge tree, see lsm_mgr.h
+  RM_ENGINE_CLUSTERED = 2,  // records in the leaves of a B+-tree on the key, see cluster_mgr.h
+  RM_ENGINE_TIMESERIES = 3  // append-only, time-ordered compressed blocks, see ts_mgr.h
+} RM_Engine;
+
+#define RM_LSM_DEFAULT_MEMTABLE (64 * 1024)
+#define RM_LSM_DEFAULT_FANOUT 4
+
+// Partitioning of a table, see part_mgr.h
+typedef enum RM_Partitioning {
+  RM_PARTITION_NONE = 0,
+  RM_PARTITION_RANGE = 1,   // by ranges of the partition attribute between bounds
+  RM_PARTITION_HASH = 2     // by a hash of the partition attribute
+} RM_Partitioning;
+
+#define RM_MAX_PARTITIONS 64
+
+// Options of createTableWithOptions; zero settings take the defaults
+typedef struct RM_TableOptions
+{
+  RM_Engine engine;
+  int memtableSize;     // LSM: bytes of records buffered in memory
+  int tierFanout;       // LSM: files of a tier merged into the next
+  int timeAttr;         // TIMESERIES: INT attribute holding the time of a record
+  int ttl;              // TIMESERIES: time a record lives, in the unit of timeAttr; 0 for ever
+  RM_Partitioning partitioning;
+  int partitionAttr;    // attribute the partitions are chosen by
+  int numPartitions;    // 1 .. RM_MAX_PARTITIONS
+  Value **partitionBounds;  // RANGE: numPartitions - 1 ascending bounds; partition i
+                            // holds the values below bound i and at or above bound i - 1
+} RM_TableOptions;
+
+// Secondary index kept in step with the records of an open table, see attachIndex
+typedef struct RM_IndexHooks
+{
+  // called after a record was inserted, and with the new data after an update
+  RC (*insert) (void *index, Record *record);
+  // called with the data a record had, once it was deleted or updated
+  RC (*remove) (void *index, Record *record);
+  // optional: sets rids to a malloc'ed list in RID order that holds every
+  // record matching cond, exact if it holds no others; NULL if the index
+  // cannot narrow the scan
+  RC (*candidates) (void *index, Expr *cond, RID **rids, int *numRids, rm_bool *exact);
+} RM_IndexHooks;
+
+#define RM_MAX_INDEXES 8
+
+// Current time records expire by, in the unit of the time attributes of the
+// tables with a TTL, see setExpiryClock
+typedef int (*RM_Clock) (void);
+
+// Test a scan applies to the stored bytes of a record before it evaluates
+// the condition or copies the record out, see setScanRowFilter; false drops
+// the record
+typedef rm_bool (*RM_RowFilter) (void *arg, char *data);
+
 // table and manager
 extern RC initRecordManager (void *mgmtData);
 extern RC shutdownRecordManager ();
 extern RC createTable (char *name, Schema *schema);
+extern RC createTableWithOptions (char *name, Schema *schema, RM_TableOptions *options);
 extern RC openTable (RM_TableData *rel, char *name);
 extern RC closeTable (RM_TableData *rel);
 extern RC deleteTable (char *name);
 extern int getNumTuples (RM_TableData *rel);
 
+// emptying and dropping an open table without writing its pages back
+extern RC truncateTable (RM_TableData *rel);
+extern RC dropTable (RM_TableData *rel);
+
+// partitioned tables; a dropped partition loses its records and stays in
+// the table, empty
+extern int getNumPartitions (RM_TableData *rel);
+extern RC getPartitionOf (RM_TableData *rel, Value *value, int *partition);
+extern RC dropPartition (RM_TableData *rel, int partition);
+
+// expiry of the records of tables with a TTL; NULL sets the clock back to
+// the seconds since the epoch. startExpiry reclaims the pages of expired
+// records every interval milliseconds in a thread of its own until
+// stopExpiry or closeTable
+extern void setExpiryClock (RM_Clock clock);
+extern RC reclaimExpired (RM_TableData *rel, int *pages);
+extern RC startExpiry (RM_TableData *rel, int interval);
+extern RC stopExpiry (RM_TableData *rel);
+
+// secondary indexes; detach them before closing the table
+extern RC attachIndex (RM_TableData *rel, RM_IndexHooks *hooks, void *index);
+extern RC detachIndex (RM_TableData *rel, void *index);
+
 // handling records in a table
 extern RC insertRecord (RM_TableData *rel, Record *record);
 extern RC deleteRecord (RM_TableData *rel, RID id);
 extern RC updateRecord (RM_TableData *rel, Record *record);
 extern RC getRecord (RM_TableData *rel, RID id, Record *record);
+extern RC getRecordByKey (RM_TableData *rel, Value **keys, Record *record);
 
 // scans
 extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond);
+extern RC startSampleScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, float fraction, unsigned int seed);
+extern RC startCompiledScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond);
+extern RC setScanRowFilter (RM_ScanHandle *scan, RM_RowFilter filter, void *arg);
 extern RC next (RM_ScanHandle *scan, Record *record);
 extern RC closeScan (RM_ScanHandle *scan);
+extern int getNumScanPartitions (RM_ScanHandle *scan);
+extern int getNumScanBlocks (RM_ScanHandle *scan);
 
 // dealing with schemas
 extern int getRecordSize (Schema *schema);
@@ -0,0 +1,167 @@
+#ifndef RECORD_MGR_TYPED_HPP
+#define RECORD_MGR_TYPED_HPP
+
+// Compile-time typed access to records for C++ callers of the record manager.
+//
+// A table's schema is written down as a type list, e.g.
+//
+//   typedef rm::Layout<int, rm::String<4>, float, rm::Bool> Orders;
+//
+// and the compiler works out every attribute offset, the record size and
+// the getters and setters, so reading an attribute is a single load at a
+// constant offset instead of getAttr's type switch and offset loop. The
+// layout is the one record_mgr.c writes: attributes packed in schema order
+// without padding, DT_INT and DT_FLOAT as 4 bytes, DT_BOOL as the rm_bool of
+// dt.h (a short) and DT_STRING as typeLength bytes.
+//
+// Nothing here replaces the C API. Tables are still created, opened and
+// scanned through record_mgr.h; a typed view only reinterprets the data of
+// a Record, after Layout::matches() has checked it against the table's
+// Schema once.
+//
+// The bools of the C API (Value.boolV, BM_PageHandle.dirty, getDirtyFlags,
+// row filters and index hooks) are rm_bool on both sides; C++ row filters
+// and hooks return and store rm_bool, not bool.
+
+extern "C" {
+#include "record_mgr.h"
+}
+
+#include <cstring>
+#include <string_view>
+#include <tuple>
+
+namespace rm {
+
+// DT_BOOL attribute, stored as an rm_bool; the typed accessors convert it
+// to and from C++'s own bool.
+struct Bool {};
+
+// DT_STRING attribute with typeLength N
+template <int N> struct String {};
+
+// Storage and conversion of one attribute type
+template <typename T> struct AttrTraits;
+
+template <> struct AttrTraits<int> {
+  typedef int value_type;
+  static constexpr DataType dataType = DT_INT;
+  static constexpr int typeLength = 0;
+  static constexpr int size = sizeof(int);
+
+  static int load (const char *p) { int v; std::memcpy(&v, p, size); return v; }
+  static void store (char *p, int v) { std::memcpy(p, &v, size); }
+};
+
+template <> struct AttrTraits<float> {
+  typedef float value_type;
+  static constexpr DataType dataType = DT_FLOAT;
+  static constexpr int typeLength = 0;
+  static constexpr int size = sizeof(float);
+
+  static float load (const char *p) { float v; std::memcpy(&v, p, size); return v; }
+  static void store (char *p, float v) { std::memcpy(p, &v, size); }
+};
+
+template <> struct AttrTraits<Bool> {
+  typedef bool value_type;
+  static constexpr DataType dataType = DT_BOOL;
+  static constexpr int typeLength = 0;
+  static constexpr int size = sizeof(rm_bool);
+
+  static bool load (const char *p) { rm_bool v; std::memcpy(&v, p, size); return v != 0; }
+  static void store (char *p, bool v) { rm_bool s = v ? 1 : 0; std::memcpy(p, &s, size); }
+};
+
+// Strings are returned as a view of the bytes in the record, up to the first
+// NUL; stores copy at most N bytes and zero-fill the rest of the attribute.
+template <int N> struct AttrTraits<String<N>> {
+  typedef std::string_view value_type;
+  static constexpr DataType dataType = DT_STRING;
+  static constexpr int typeLength = N;
+  static constexpr int size = N;
+
+  static std::string_view load (const char *p)
+  {
+    const void *end = std::memchr(p, '\0', N);
+    return std::string_view(p, end ? static_cast<const char *>(end) - p : N);
+  }
+  static void store (char *p, std::string_view v)
+  {
+    std::size_t n = v.size() < static_cast<std::size_t>(N) ? v.size() : N;
+    std::memcpy(p, v.data(), n);
+    std::memset(p + n, 0, N - n);
+  }
+};
+
+// A table schema as a compile-time list of attribute types
+template <typename... Attrs> struct Layout {
+  static constexpr int numAttr = sizeof...(Attrs);
+  static constexpr int recordSize = (0 + ... + AttrTraits<Attrs>::size);
+
+  template <int I> using Attr = std::tuple_element_t<I, std::tuple<Attrs...>>;
+  template <int I> using AttrValue = typename AttrTraits<Attr<I>>::value_type;
+
+  template <int I> static constexpr int offset ()
+  {
+    constexpr int sizes[] = { AttrTraits<Attrs>::size..., 0 };
+    int o = 0;
+    for (int i = 0; i < I; i++)
+      o += sizes[i];
+    return o;
+  }
+
+  template <int I> static AttrValue<I> get (const char *data)
+  {
+    return AttrTraits<Attr<I>>::load(data + offset<I>());
+  }
+
+  template <int I> static void set (char *data, AttrValue<I> v)
+  {
+    AttrTraits<Attr<I>>::store(data + offset<I>(), v);
+  }
+
+  // Whether a table's schema has exactly these attribute types
+  static bool matches (const Schema *schema)
+  {
+    static constexpr DataType types[] = { AttrTraits<Attrs>::dataType... };
+    static constexpr int lengths[] = { AttrTraits<Attrs>::typeLength... };
+
+    if (schema == nullptr || schema->numAttr != numAttr)
+      return false;
+    for (int i = 0; i < numAttr; i++)
+      {
+        if (schema->dataTypes[i] != types[i])
+          return false;
+        if (types[i] == DT_STRING && schema->typeLength[i] != lengths[i])
+          return false;
+      }
+    return true;
+  }
+};
+
+// Typed view of a Record of a table with layout L
+template <typename L> class TypedRecord {
+public:
+  explicit TypedRecord (Record *record) : record(record) {}
+
+  template <int I> typename L::template AttrValue<I> get () const
+  {
+    return L::template get<I>(record->data);
+  }
+
+  template <int I> void set (typename L::template AttrValue<I> v)
+  {
+    L::template set<I>(record->data, v);
+  }
+
+  RID id () const { return record->id; }
+  Record *raw () const { return record; }
+
+private:
+  Record *record;
+};
+
+} // namespace rm
+
+#endif // RECORD_MGR_TYPED_HPP
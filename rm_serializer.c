@@ -67,9 +67,6 @@ typedef struct VarString {
 			free(tmp);					\
 		} while(0)
 
-// prototypes
-static RC attrOffset (Schema *schema, int attrNum, int *result);
-
 // implementations
 char *
 serializeTableInfo(RM_TableData *rel)
@@ -89,7 +86,8 @@ serializeTableContent(RM_TableData *rel)
 	int i;
 	VarString *result;
 	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
-	Record *r = (Record *) malloc(sizeof(Record));
+	Record *r;
+	createRecord(&r, rel->schema);
 	MAKE_VARSTRING(result);
 
 	for(i = 0; i < rel->schema->numAttr; i++)
@@ -103,6 +101,8 @@ serializeTableContent(RM_TableData *rel)
 		APPEND_STRING(result,"\n");
 	}
 	closeScan(sc);
+	freeRecord(r);
+	free(sc);
 
 	RETURN_STRING(result);
 }
@@ -279,7 +279,7 @@ stringToValue(char *val)
 	return result;
 }
 
-
+// offset of an attribute in the record data; attrNum numAttr gives the record size
 RC
 attrOffset (Schema *schema, int attrNum, int *result)
 {
@@ -6,6 +6,7 @@
 #include <errno.h> 
 #include <string.h> 
 #include <limits.h> 
+#include <unistd.h> 
 #include "storage_mgr.h" 
 #include "time.h"
 
@@ -595,3 +596,45 @@ RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle) {
     fclose(filePointer); // Close the file.
     return returnCode;
 }
+
+/**
+ * Shrinks the file to the given number of pages.
+ * The pages past numberOfPages are cut off with ftruncate, so the space is given back without writing anything, whatever the size
+ * of the file. A file that is already short enough is left alone. Pages of the file cached in a buffer pool must be discarded first.
+ *
+ * @param numberOfPages The number of pages the file should keep.
+ * @param fHandle Pointer to the file handle structure for the file to be modified.
+ * @return A return code indicating the success of the operation or an error.
+ */
+
+
+RC truncatePageFile(int numberOfPages, SM_FileHandle *fHandle) {
+    if (!fHandle) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    else if (numberOfPages < 0) {
+        return RC_INVALID_ARGS;
+    }
+    else if (fHandle->totalNumPages <= numberOfPages) {
+        return RC_OK;
+    }
+
+    int fd = open(fHandle->fileName, O_WRONLY);
+    if (fd < 0) {
+        return RC_FILE_NOT_FOUND; // File not found.
+    }
+
+    RC returnCode;
+    if (ftruncate(fd, (off_t) numberOfPages * PAGE_SIZE) != 0) {
+        returnCode = RC_WRITE_FAILED; // Failed to cut the file.
+    }
+    else {
+        fHandle->totalNumPages = numberOfPages; // Update totalNumPages.
+        if (fHandle->curPagePos >= numberOfPages) {
+            fHandle->curPagePos = numberOfPages > 0 ? numberOfPages - 1 : 0;
+        }
+        returnCode = RC_OK; // Success.
+    }
+    close(fd);
+    return returnCode;
+}
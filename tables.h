@@ -19,7 +19,7 @@ typedef struct Value {
 		int intV;
 		char *stringV;
 		float floatV;
-		bool boolV;
+		rm_bool boolV;
 	} v;
 } Value;
 
@@ -91,5 +91,6 @@ extern char *serializeSchema(Schema *schema);
 extern char *serializeRecord(Record *record, Schema *schema);
 extern char *serializeAttr(Record *record, Schema *schema, int attrNum);
 extern char *serializeValue(Value *val);
+extern RC attrOffset (Schema *schema, int attrNum, int *result);
 
 #endif
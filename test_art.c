@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dberror.h"
+#include "expr.h"
+#include "art_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+#include "test_util.h"
+
+#define ASSERT_EQUALS_RID(_l,_r, message)				\
+  do {									\
+    ASSERT_TRUE((_l).page == (_r).page && (_l).slot == (_r).slot, message); \
+  } while(0)
+
+// test methods
+static void testRandomInserts (void);
+static void testStringKeys (void);
+static void testNodeLayouts (void);
+static void testSnapshot (void);
+static void testErrors (void);
+
+// helper methods
+static void stringKey (Value *key, char *buffer, int i);
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  testName = "";
+
+  testRandomInserts();
+  testStringKeys();
+  testNodeLayouts();
+  testSnapshot();
+  testErrors();
+
+  return 0;
+}
+
+// ************************************************************
+void
+testRandomInserts (void)
+{
+  AR_TreeHandle *tree = NULL;
+  AR_ScanHandle *sc = NULL;
+  int numInserts = 20000;
+  int *permute = createPermutation(numInserts);
+  int i, entries, rc;
+  Value key, low, high;
+  RID rid;
+
+  testName = "test random inserts into a radix tree";
+
+  TEST_CHECK(createArt("testidx", DT_INT, false));
+  TEST_CHECK(openArt(&tree, "testidx"));
+
+  // keys from -10000 to 9999: the sign flip keeps negative keys first
+  key.dt = DT_INT;
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = permute[i] - numInserts / 2;
+      TEST_CHECK(artInsertKey(tree, &key, ridFor(permute[i])));
+    }
+  TEST_CHECK(getArtNumEntries(tree, &entries));
+  ASSERT_EQUALS_INT(numInserts, entries, "every key counted");
+  key.v.intV = 7;
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, artInsertKey(tree, &key, ridFor(0)), "duplicate key");
+
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = i - numInserts / 2;
+      TEST_CHECK(artFindKey(tree, &key, &rid));
+      ASSERT_EQUALS_RID(ridFor(i), rid, "found the key");
+    }
+  key.v.intV = numInserts;
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, artFindKey(tree, &key, &rid), "missing key");
+
+  TEST_CHECK(openArtScan(tree, &sc));
+  for(i = 0; (rc = artNextEntry(sc, &rid)) == RC_OK; i++)
+    ASSERT_EQUALS_RID(ridFor(i), rid, "scan in key order");
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "scan ended");
+  ASSERT_EQUALS_INT(numInserts, i, "scan saw every key");
+  TEST_CHECK(closeArtScan(sc));
+
+  // delete the odd keys, then scan the range [-100, 100]
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = permute[i] - numInserts / 2;
+      if (permute[i] % 2 == 1)
+	TEST_CHECK(artDeleteKey(tree, &key));
+    }
+  key.v.intV = 1 - numInserts / 2;
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, artDeleteKey(tree, &key), "key already deleted");
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, artFindKey(tree, &key, &rid), "deleted key gone");
+  TEST_CHECK(getArtNumEntries(tree, &entries));
+  ASSERT_EQUALS_INT(numInserts / 2, entries, "half the keys left");
+
+  low.dt = high.dt = DT_INT;
+  low.v.intV = -100;
+  high.v.intV = 100;
+  TEST_CHECK(openArtRangeScan(tree, &low, &high, &sc));
+  for(i = numInserts / 2 - 100; (rc = artNextEntry(sc, &rid)) == RC_OK; i += 2)
+    ASSERT_EQUALS_RID(ridFor(i), rid, "range scan in key order");
+  ASSERT_EQUALS_INT(numInserts / 2 + 102, i, "range scan ends at the high bound");
+  TEST_CHECK(closeArtScan(sc));
+
+  TEST_CHECK(closeArt(tree));
+  TEST_CHECK(deleteArt("testidx"));
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testStringKeys (void)
+{
+  AR_TreeHandle *tree = NULL;
+  AR_ScanHandle *sc = NULL;
+  int numInserts = 5000;
+  int *permute = createPermutation(numInserts);
+  char buffer[64];
+  int i, nodes, rc;
+  Value key, low, high;
+  RID rid;
+
+  testName = "test string keys with long shared prefixes";
+
+  TEST_CHECK(createArt("testidx", DT_STRING, false));
+  TEST_CHECK(openArt(&tree, "testidx"));
+
+  for(i = 0; i < numInserts; i++)
+    {
+      stringKey(&key, buffer, permute[i]);
+      TEST_CHECK(artInsertKey(tree, &key, ridFor(permute[i])));
+    }
+  for(i = 0; i < numInserts; i++)
+    {
+      stringKey(&key, buffer, i);
+      TEST_CHECK(artFindKey(tree, &key, &rid));
+      ASSERT_EQUALS_RID(ridFor(i), rid, "found the string key");
+    }
+
+  // a key that matches the stored part of a prefix but not the rest
+  key.dt = DT_STRING;
+  key.v.stringV = "customer-records+1";
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, artFindKey(tree, &key, &rid), "key differing past the stored prefix");
+  TEST_CHECK(artInsertKey(tree, &key, ridFor(-1)));
+  TEST_CHECK(artFindKey(tree, &key, &rid));
+  ASSERT_EQUALS_RID(ridFor(-1), rid, "prefix split past the stored bytes");
+  TEST_CHECK(artDeleteKey(tree, &key));
+
+  // the bounds need not be keys of the index
+  low.dt = high.dt = DT_STRING;
+  low.v.stringV = "customer-records-01000/0";
+  high.v.stringV = "customer-records-01200";
+  TEST_CHECK(openArtRangeScan(tree, &low, &high, &sc));
+  for(i = 1001; (rc = artNextEntry(sc, &rid)) == RC_OK; i++)
+    ASSERT_EQUALS_RID(ridFor(i), rid, "string range in order");
+  ASSERT_EQUALS_INT(1201, i, "string range ends at the high bound");
+  TEST_CHECK(closeArtScan(sc));
+
+  // deleting every key frees every node
+  for(i = 0; i < numInserts; i++)
+    {
+      stringKey(&key, buffer, permute[i]);
+      TEST_CHECK(artDeleteKey(tree, &key));
+    }
+  TEST_CHECK(getArtNumNodes(tree, &nodes));
+  ASSERT_EQUALS_INT(0, nodes, "empty tree has no nodes");
+
+  TEST_CHECK(closeArt(tree));
+  TEST_CHECK(deleteArt("testidx"));
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testNodeLayouts (void)
+{
+  AR_TreeHandle *tree = NULL;
+  AR_ScanHandle *sc = NULL;
+  int *permute = createPermutation(256);
+  int i, nodes, count;
+  Value key;
+  RID rid;
+
+  testName = "test nodes growing and shrinking";
+
+  TEST_CHECK(createArt("testidx", DT_INT, false));
+  TEST_CHECK(openArt(&tree, "testidx"));
+
+  // keys 0 .. 255 differ in the last byte only: one node takes all of them
+  key.dt = DT_INT;
+  for(i = 0; i < 256; i++)
+    {
+      key.v.intV = permute[i];
+      TEST_CHECK(artInsertKey(tree, &key, ridFor(permute[i])));
+      TEST_CHECK(getArtNumNodes(tree, &nodes));
+      ASSERT_EQUALS_INT(i == 0 ? 0 : 1, nodes, "one node through every layout");
+    }
+  for(i = 0; i < 256; i++)
+    {
+      key.v.intV = i;
+      TEST_CHECK(artFindKey(tree, &key, &rid));
+      ASSERT_EQUALS_RID(ridFor(i), rid, "found the key");
+    }
+
+  // shrink back down, checking the order after every layout change
+  for(i = 0; i < 255; i++)
+    {
+      key.v.intV = permute[i];
+      TEST_CHECK(artDeleteKey(tree, &key));
+      if (i == 255 - 37 || i == 255 - 12 || i == 255 - 3)
+	{
+	  int last = -1, ok = 1;
+	  TEST_CHECK(openArtScan(tree, &sc));
+	  for(count = 0; artNextEntry(sc, &rid) == RC_OK; count++)
+	    {
+	      ok = ok && rid.page > last;
+	      last = rid.page;
+	    }
+	  TEST_CHECK(closeArtScan(sc));
+	  ASSERT_EQUALS_INT(255 - i, count, "smaller layout keeps every key");
+	  ASSERT_TRUE(ok, "smaller layout keeps the order");
+	}
+    }
+  TEST_CHECK(getArtNumNodes(tree, &nodes));
+  ASSERT_EQUALS_INT(0, nodes, "last key is a leaf at the root");
+  key.v.intV = permute[255];
+  TEST_CHECK(artFindKey(tree, &key, &rid));
+  ASSERT_EQUALS_RID(ridFor(permute[255]), rid, "last key found");
+
+  TEST_CHECK(closeArt(tree));
+  TEST_CHECK(deleteArt("testidx"));
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testSnapshot (void)
+{
+  AR_TreeHandle *tree = NULL;
+  int numInserts = 3000;
+  int i, entries;
+  Value key;
+  RID rid;
+
+  testName = "test radix tree snapshots";
+
+  TEST_CHECK(createArt("testidx", DT_FLOAT, true));
+  TEST_CHECK(openArt(&tree, "testidx"));
+  key.dt = DT_FLOAT;
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.floatV = i * 0.5f - 100;
+      TEST_CHECK(artInsertKey(tree, &key, ridFor(i)));
+    }
+  TEST_CHECK(closeArt(tree));
+
+  // a persistent index comes back with its entries
+  TEST_CHECK(openArt(&tree, "testidx"));
+  TEST_CHECK(getArtNumEntries(tree, &entries));
+  ASSERT_EQUALS_INT(numInserts, entries, "entries read back");
+  for(i = 0; i < numInserts; i += 3)
+    {
+      key.v.floatV = i * 0.5f - 100;
+      TEST_CHECK(artFindKey(tree, &key, &rid));
+      ASSERT_EQUALS_RID(ridFor(i), rid, "found the key after reopening");
+    }
+  TEST_CHECK(closeArt(tree));
+  TEST_CHECK(deleteArt("testidx"));
+
+  // another index is empty after reopening unless saved explicitly
+  TEST_CHECK(createArt("testidx", DT_FLOAT, false));
+  TEST_CHECK(openArt(&tree, "testidx"));
+  key.v.floatV = 1.5f;
+  TEST_CHECK(artInsertKey(tree, &key, ridFor(1)));
+  TEST_CHECK(closeArt(tree));
+  TEST_CHECK(openArt(&tree, "testidx"));
+  TEST_CHECK(getArtNumEntries(tree, &entries));
+  ASSERT_EQUALS_INT(0, entries, "entries of an in-memory index are gone");
+  TEST_CHECK(artInsertKey(tree, &key, ridFor(1)));
+  TEST_CHECK(artSaveSnapshot(tree));
+  TEST_CHECK(closeArt(tree));
+  TEST_CHECK(openArt(&tree, "testidx"));
+  TEST_CHECK(artFindKey(tree, &key, &rid));
+  ASSERT_EQUALS_RID(ridFor(1), rid, "saved snapshot read back");
+  TEST_CHECK(closeArt(tree));
+  TEST_CHECK(deleteArt("testidx"));
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testErrors (void)
+{
+  AR_TreeHandle *tree = NULL;
+  Value key;
+  RID rid;
+
+  testName = "test errors of the radix tree";
+
+  TEST_CHECK(createArt("testidx", DT_INT, false));
+  TEST_CHECK(openArt(&tree, "testidx"));
+  key.dt = DT_FLOAT;
+  key.v.floatV = 1.0;
+  ASSERT_ERROR(artInsertKey(tree, &key, ridFor(1)), "key of the wrong type");
+  ASSERT_ERROR(artFindKey(tree, &key, &rid), "key of the wrong type");
+  key.dt = DT_INT;
+  key.v.intV = 1;
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, artFindKey(tree, &key, &rid), "empty tree");
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, artDeleteKey(tree, &key), "empty tree");
+  TEST_CHECK(closeArt(tree));
+  TEST_CHECK(deleteArt("testidx"));
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+stringKey (Value *key, char *buffer, int i)
+{
+  sprintf(buffer, "customer-records-%05d", i);
+  key->dt = DT_STRING;
+  key->v.stringV = buffer;
+}
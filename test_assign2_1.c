@@ -0,0 +1,371 @@
+#include "storage_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// var to store the current test's name
+char *testName;
+
+// check whether two the content of a buffer pool is the same as an expected content
+// (given in the format produced by sprintPoolContent)
+#define ASSERT_EQUALS_POOL(expected,bm,message)			        \
+  do {									\
+    char *real;								\
+    char *_exp = (char *) (expected);                                   \
+    real = sprintPoolContent(bm);					\
+    if (strcmp((_exp),real) != 0)					\
+      {									\
+	printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+	free(real);							\
+	exit(1);							\
+      }									\
+    printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+    free(real);								\
+  } while(0)
+
+#define TEST_PAGE_FILE "testbuffer.bin"
+
+// test and helper methods
+static void createDummyPages(int num);
+static void pinAndRelease(BM_BufferPool *bm, PageNumber page);
+static void testFIFO (void);
+static void testLRU (void);
+static void testCLOCK (void);
+static void testLFU (void);
+static void testPinnedPagesStay (void);
+static void testCustomPolicy (void);
+static void testPriorityHints (void);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testFIFO();
+  testLRU();
+  testCLOCK();
+  testLFU();
+  testPinnedPagesStay();
+  testCustomPolicy();
+  testPriorityHints();
+
+  return 0;
+}
+
+// create n pages with content "Page X" and write them to the test page file
+void
+createDummyPages(int num)
+{
+  int i;
+  SM_FileHandle fh;
+  char *page = (char *) calloc(PAGE_SIZE, sizeof(char));
+
+  TEST_CHECK(createPageFile(TEST_PAGE_FILE));
+  TEST_CHECK(openPageFile(TEST_PAGE_FILE, &fh));
+  for (i = 0; i < num; i++)
+    {
+      sprintf(page, "Page-%i", i);
+      TEST_CHECK(writeBlock(i, &fh, page));
+    }
+  TEST_CHECK(closePageFile(&fh));
+  free(page);
+}
+
+void
+pinAndRelease(BM_BufferPool *bm, PageNumber page)
+{
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char expected[20];
+
+  TEST_CHECK(pinPage(bm, h, page));
+  sprintf(expected, "Page-%i", page);
+  ASSERT_EQUALS_STRING(expected, h->data, "reading back page content");
+  TEST_CHECK(unpinPage(bm, h));
+  free(h);
+}
+
+// ************************************************************
+void
+testFIFO (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  testName = "Testing FIFO page replacement";
+
+  createDummyPages(10);
+  TEST_CHECK(initBufferPool(bm, TEST_PAGE_FILE, 3, RS_FIFO, NULL));
+
+  pinAndRelease(bm, 0);
+  pinAndRelease(bm, 1);
+  pinAndRelease(bm, 2);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", bm, "pool filled in load order");
+  pinAndRelease(bm, 3);
+  ASSERT_EQUALS_POOL("[3 0],[1 0],[2 0]", bm, "oldest page 0 replaced");
+  pinAndRelease(bm, 1);
+  pinAndRelease(bm, 4);
+  ASSERT_EQUALS_POOL("[3 0],[4 0],[2 0]", bm, "hit on page 1 does not save it");
+
+  ASSERT_EQUALS_INT(5, getNumReadIO(bm), "check number of read I/Os");
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile(TEST_PAGE_FILE));
+  free(bm);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testLRU (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  testName = "Testing LRU page replacement";
+
+  createDummyPages(10);
+  TEST_CHECK(initBufferPool(bm, TEST_PAGE_FILE, 3, RS_LRU, NULL));
+
+  pinAndRelease(bm, 0);
+  pinAndRelease(bm, 1);
+  pinAndRelease(bm, 2);
+  pinAndRelease(bm, 0);
+  pinAndRelease(bm, 3);
+  ASSERT_EQUALS_POOL("[0 0],[3 0],[2 0]", bm, "least recently used page 1 replaced");
+  pinAndRelease(bm, 4);
+  ASSERT_EQUALS_POOL("[0 0],[3 0],[4 0]", bm, "least recently used page 2 replaced");
+
+  ASSERT_EQUALS_INT(5, getNumReadIO(bm), "check number of read I/Os");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile(TEST_PAGE_FILE));
+  free(bm);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testCLOCK (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  testName = "Testing CLOCK page replacement";
+
+  createDummyPages(10);
+  TEST_CHECK(initBufferPool(bm, TEST_PAGE_FILE, 3, RS_CLOCK, NULL));
+
+  pinAndRelease(bm, 0);
+  pinAndRelease(bm, 1);
+  pinAndRelease(bm, 2);
+  pinAndRelease(bm, 3);
+  ASSERT_EQUALS_POOL("[3 0],[1 0],[2 0]", bm, "full sweep clears all bits, frame 0 replaced");
+  pinAndRelease(bm, 1);
+  pinAndRelease(bm, 4);
+  ASSERT_EQUALS_POOL("[3 0],[1 0],[4 0]", bm, "referenced page 1 gets a second chance");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile(TEST_PAGE_FILE));
+  free(bm);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testLFU (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  testName = "Testing LFU page replacement";
+
+  createDummyPages(10);
+  TEST_CHECK(initBufferPool(bm, TEST_PAGE_FILE, 3, RS_LFU, NULL));
+
+  pinAndRelease(bm, 0);
+  pinAndRelease(bm, 0);
+  pinAndRelease(bm, 0);
+  pinAndRelease(bm, 1);
+  pinAndRelease(bm, 1);
+  pinAndRelease(bm, 2);
+  pinAndRelease(bm, 3);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[3 0]", bm, "least frequently used page 2 replaced");
+  pinAndRelease(bm, 3);
+  pinAndRelease(bm, 3);
+  pinAndRelease(bm, 4);
+  ASSERT_EQUALS_POOL("[0 0],[4 0],[3 0]", bm, "page 1 now least frequently used");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile(TEST_PAGE_FILE));
+  free(bm);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testPinnedPagesStay (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+  testName = "Testing that pinned pages are never replaced";
+
+  createDummyPages(10);
+  TEST_CHECK(initBufferPool(bm, TEST_PAGE_FILE, 2, RS_FIFO, NULL));
+
+  TEST_CHECK(pinPage(bm, h, 0));
+  sprintf(h->data, "%s", "Page-0-changed");
+  TEST_CHECK(markDirty(bm, h));
+  pinAndRelease(bm, 1);
+  pinAndRelease(bm, 2);
+  pinAndRelease(bm, 3);
+  ASSERT_EQUALS_POOL("[0x1],[3 0]", bm, "pinned page 0 skipped by FIFO");
+
+  TEST_CHECK(pinPage(bm, h2, 4));
+  ASSERT_ERROR(pinPage(bm, h2, 5), "every frame pinned, no victim left");
+
+  TEST_CHECK(unpinPage(bm, h2));
+  TEST_CHECK(unpinPage(bm, h));
+  pinAndRelease(bm, 5);
+  ASSERT_EQUALS_POOL("[5 0],[4 0]", bm, "page 0 replaced once unpinned");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "dirty page 0 written back on eviction");
+
+  TEST_CHECK(pinPage(bm, h, 0));
+  ASSERT_EQUALS_STRING("Page-0-changed", h->data, "change survived eviction");
+  TEST_CHECK(unpinPage(bm, h));
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile(TEST_PAGE_FILE));
+  free(bm);
+  free(h);
+  free(h2);
+  TEST_DONE();
+}
+
+// ************************************************************
+// A user policy evicting the most recently loaded frame (MRU by load time)
+typedef struct MruState {
+  int last;
+  int events;
+} MruState;
+
+static RC
+mruInit (int numFrames, void *stratData, void **state)
+{
+  MruState *s = (MruState *) stratData;
+  s->last = -1;
+  s->events = 0;
+  *state = s;
+  return RC_OK;
+}
+
+static void
+mruOnMiss (void *state, int frame, BM_PageHint hint)
+{
+  MruState *s = (MruState *) state;
+  s->last = frame;
+  s->events++;
+}
+
+static void
+mruOnEvict (void *state, int frame)
+{
+  ((MruState *) state)->events++;
+}
+
+static int
+mruPickVictim (void *state, BM_BufferPool *const bm)
+{
+  MruState *s = (MruState *) state;
+  return (s->last >= 0 && isFrameEvictable(bm, s->last)) ? s->last : -1;
+}
+
+static const BM_ReplacementPolicy mruPolicy = {
+  .name = "MRU",
+  .init = mruInit,
+  .shutdown = NULL,
+  .onHit = NULL,
+  .onMiss = mruOnMiss,
+  .onUnpin = NULL,
+  .pickVictim = mruPickVictim,
+  .onEvict = mruOnEvict
+};
+
+void
+testCustomPolicy (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  MruState state;
+  BM_CustomStrategy custom = { &mruPolicy, &state };
+  testName = "Testing a user-registered replacement policy";
+
+  createDummyPages(10);
+  ASSERT_ERROR(initBufferPool(bm, TEST_PAGE_FILE, 3, RS_CUSTOM, NULL), "RS_CUSTOM needs a policy");
+  TEST_CHECK(initBufferPool(bm, TEST_PAGE_FILE, 3, RS_CUSTOM, &custom));
+
+  pinAndRelease(bm, 0);
+  pinAndRelease(bm, 1);
+  pinAndRelease(bm, 2);
+  pinAndRelease(bm, 3);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[3 0]", bm, "most recently loaded page 2 replaced");
+  pinAndRelease(bm, 4);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[4 0]", bm, "most recently loaded page 3 replaced");
+  ASSERT_EQUALS_INT(7, state.events, "five loads and two evictions reported");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile(TEST_PAGE_FILE));
+  free(bm);
+  TEST_DONE();
+}
+
+// ************************************************************
+static void
+pinWithHint(BM_BufferPool *bm, PageNumber page, BM_PageHint hint)
+{
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+  TEST_CHECK(pinPageWithHint(bm, h, page, hint));
+  TEST_CHECK(unpinPage(bm, h));
+  free(h);
+}
+
+void
+testPriorityHints (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  testName = "Testing page priority hints";
+
+  createDummyPages(10);
+  TEST_CHECK(initBufferPool(bm, TEST_PAGE_FILE, 3, RS_LRU, NULL));
+
+  pinWithHint(bm, 0, BM_HINT_HOT);
+  pinAndRelease(bm, 1);
+  pinAndRelease(bm, 2);
+  pinAndRelease(bm, 3);
+  ASSERT_EQUALS_POOL("[0 0],[3 0],[2 0]", bm, "hot page 0 skipped, least recently used page 1 replaced");
+  pinAndRelease(bm, 4);
+  pinAndRelease(bm, 5);
+  ASSERT_EQUALS_POOL("[0 0],[5 0],[4 0]", bm, "hot page 0 survives a stream of normal pins");
+
+  pinWithHint(bm, 6, BM_HINT_SCAN);
+  pinAndRelease(bm, 5);
+  pinAndRelease(bm, 7);
+  ASSERT_EQUALS_POOL("[0 0],[5 0],[7 0]", bm, "scan page 6 replaced before page 5");
+
+  pinWithHint(bm, 8, BM_HINT_SCAN);
+  pinWithHint(bm, 8, BM_HINT_SCAN);
+  pinAndRelease(bm, 9);
+  ASSERT_EQUALS_POOL("[0 0],[9 0],[7 0]", bm, "scan hits do not promote page 8");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(initBufferPool(bm, TEST_PAGE_FILE, 2, RS_LRU, NULL));
+  pinWithHint(bm, 0, BM_HINT_HOT);
+  pinWithHint(bm, 1, BM_HINT_HOT);
+  pinAndRelease(bm, 2);
+  ASSERT_EQUALS_POOL("[2 0],[1 0]", bm, "hot pages replaced when nothing else is left");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile(TEST_PAGE_FILE));
+  free(bm);
+  TEST_DONE();
+}
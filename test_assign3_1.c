@@ -0,0 +1,1383 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "dberror.h"
+#include "expr.h"
+#include "expr_codegen.h"
+#include "record_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+
+#define TEST_TABLE "test_table_r"
+
+// test methods
+static void testInsertAndScan (void);
+static void testConditionalScan (void);
+static void testSharedScan (void);
+static void testSampleScan (void);
+static void testCompiledScan (void);
+static void testLsmTable (void);
+static void testClusteredTable (void);
+static void testPartitionedTable (void);
+static void testTruncateTable (void);
+static void testTimeSeriesTable (void);
+static void testRecordExpiry (void);
+
+// helper methods
+static Schema *testSchema (void);
+static Schema *metricSchema (void);
+static void insertMetrics (RM_TableData *table, int first, int num, RID *rids);
+static long fileSize (char *name);
+static int testClock (void);
+static void insertTuples (RM_TableData *table, int num);
+static int scanAll (RM_ScanHandle *sc, Record *r, char *seen);
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  testName = "";
+
+  initRecordManager(NULL);
+  testInsertAndScan();
+  testConditionalScan();
+  testSharedScan();
+  testSampleScan();
+  testCompiledScan();
+  testLsmTable();
+  testClusteredTable();
+  testPartitionedTable();
+  testTruncateTable();
+  testTimeSeriesTable();
+  testRecordExpiry();
+  shutdownRecordManager();
+
+  return 0;
+}
+
+// schema (a INT, b STRING(4), c INT) with key a
+Schema *
+testSchema (void)
+{
+  char *names[] = { "a", "b", "c" };
+  DataType dt[] = { DT_INT, DT_STRING, DT_INT };
+  int sizes[] = { 0, 4, 0 };
+  char **cpNames = (char **) malloc(sizeof(char*) * 3);
+  DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
+  int *cpSizes = (int *) malloc(sizeof(int) * 3);
+  int *cpKeys = (int *) malloc(sizeof(int));
+  int i;
+
+  for(i = 0; i < 3; i++)
+    cpNames[i] = strdup(names[i]);
+  memcpy(cpDt, dt, sizeof(DataType) * 3);
+  memcpy(cpSizes, sizes, sizeof(int) * 3);
+  cpKeys[0] = 0;
+
+  return createSchema(3, cpNames, cpDt, cpSizes, 1, cpKeys);
+}
+
+// schema (t INT, host STRING(4), v FLOAT) of a metric sampled over time
+Schema *
+metricSchema (void)
+{
+  char *names[] = { "t", "host", "v" };
+  DataType dt[] = { DT_INT, DT_STRING, DT_FLOAT };
+  int sizes[] = { 0, 4, 0 };
+  char **cpNames = (char **) malloc(sizeof(char*) * 3);
+  DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
+  int *cpSizes = (int *) malloc(sizeof(int) * 3);
+  int *cpKeys = (int *) malloc(sizeof(int));
+  int i;
+
+  for(i = 0; i < 3; i++)
+    cpNames[i] = strdup(names[i]);
+  memcpy(cpDt, dt, sizeof(DataType) * 3);
+  memcpy(cpSizes, sizes, sizeof(int) * 3);
+  cpKeys[0] = 0;
+
+  return createSchema(3, cpNames, cpDt, cpSizes, 1, cpKeys);
+}
+
+// ************************************************************
+void
+testClusteredTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Schema *schema = testSchema();
+  int numInserts = 3000;
+  char *seen = (char *) calloc(2 * numInserts, sizeof(char));
+  RID *rids = (RID *) malloc(numInserts * sizeof(RID));
+  RM_TableOptions options;
+  Expr *sel, *low, *high, *attr, *cons, *cmp;
+  Record *r, *out;
+  Value *v, *key;
+  FILE *file;
+  int i, a, last, count, tuples, ordered;
+  RC rc;
+
+  testName = "test table clustered on its key";
+
+  memset(&options, 0, sizeof(options));
+  options.engine = RM_ENGINE_CLUSTERED;
+  TEST_CHECK(createTableWithOptions(TEST_TABLE, schema, &options));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+
+  // insert (a, "abc", a % 10) with the keys out of order
+  TEST_CHECK(createRecord(&r, table->schema));
+  for(i = 0; i < numInserts; i++)
+    {
+      a = (i * 7919) % numInserts;
+      MAKE_VALUE(v, DT_INT, a);
+      TEST_CHECK(setAttr(r, table->schema, 0, v));
+      freeVal(v);
+      MAKE_STRING_VALUE(v, "abc");
+      TEST_CHECK(setAttr(r, table->schema, 1, v));
+      freeVal(v);
+      MAKE_VALUE(v, DT_INT, a % 10);
+      TEST_CHECK(setAttr(r, table->schema, 2, v));
+      freeVal(v);
+      TEST_CHECK(insertRecord(table, r));
+      rids[a] = r->id;
+    }
+  tuples = getNumTuples(table);
+  ASSERT_EQUALS_INT(numInserts, tuples, "all tuples counted");
+  rc = insertRecord(table, r);
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, rc, "keys are unique");
+
+  // a full scan reads the leaves in key order
+  TEST_CHECK(startScan(table, sc, NULL));
+  for(count = 0, ordered = 1, last = -1; (rc = next(sc, r)) == RC_OK; count++)
+    {
+      TEST_CHECK(getAttr(r, table->schema, 0, &v));
+      ordered = ordered && v->v.intV > last;
+      last = v->v.intV;
+      freeVal(v);
+    }
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ended");
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(numInserts, count, "every tuple scanned");
+  ASSERT_TRUE(ordered, "tuples come in key order");
+
+  // NOT (a < 1000) AND a < 1100
+  MAKE_ATTRREF(attr, 0);
+  MAKE_CONS(cons, stringToValue("i1000"));
+  MAKE_BINOP_EXPR(cmp, attr, cons, OP_COMP_SMALLER);
+  MAKE_UNOP_EXPR(low, cmp, OP_BOOL_NOT);
+  MAKE_ATTRREF(attr, 0);
+  MAKE_CONS(cons, stringToValue("i1100"));
+  MAKE_BINOP_EXPR(high, attr, cons, OP_COMP_SMALLER);
+  MAKE_BINOP_EXPR(sel, low, high, OP_BOOL_AND);
+  TEST_CHECK(startScan(table, sc, sel));
+  count = scanAll(sc, r, seen);
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(100, count, "key range scanned");
+  ASSERT_TRUE(seen[1000] == 1 && seen[1099] == 1 && seen[999] == 0 && seen[1100] == 0, "range bounds");
+
+  // lookups by key and by RID
+  key = stringToValue("i1234");
+  TEST_CHECK(getRecordByKey(table, &key, out = (Record *) malloc(sizeof(Record))));
+  TEST_CHECK(getAttr(out, table->schema, 2, &v));
+  ASSERT_EQUALS_INT(4, v->v.intV, "record found by key");
+  freeVal(v);
+  ASSERT_TRUE(out->id.page == rids[1234].page && out->id.slot == rids[1234].slot, "RID of the record");
+  free(out->data);
+  freeVal(key);
+  key = stringToValue("i5000");
+  rc = getRecordByKey(table, &key, out);
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, rc, "missing key");
+  freeVal(key);
+
+  // set c = 99 where a % 7 = 0, move a to a + numInserts where a % 11 = 0, delete where a % 5 = 0
+  for(a = 0; a < numInserts; a++)
+    {
+      if (a % 7 != 0 && a % 11 != 0)
+        continue;
+      TEST_CHECK(getRecord(table, rids[a], r));
+      if (a % 7 == 0)
+        {
+          MAKE_VALUE(v, DT_INT, 99);
+          TEST_CHECK(setAttr(r, table->schema, 2, v));
+          freeVal(v);
+        }
+      if (a % 11 == 0)
+        {
+          MAKE_VALUE(v, DT_INT, a + numInserts);
+          TEST_CHECK(setAttr(r, table->schema, 0, v));
+          freeVal(v);
+        }
+      TEST_CHECK(updateRecord(table, r));
+    }
+  for(a = 0; a < numInserts; a += 5)
+    TEST_CHECK(deleteRecord(table, rids[a]));
+  rc = deleteRecord(table, rids[0]);
+  ASSERT_EQUALS_INT(RC_RM_RECORD_NOT_EXIST, rc, "deleted twice");
+
+  // the changes survive reopening
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  tuples = getNumTuples(table);
+  ASSERT_EQUALS_INT(numInserts - numInserts / 5, tuples, "count survives reopening");
+  for(a = 0; a < numInserts; a++)
+    {
+      rc = getRecord(table, rids[a], out);
+      if (a % 5 == 0)
+        ASSERT_EQUALS_INT(RC_RM_RECORD_NOT_EXIST, rc, "deleted tuple is gone");
+      else
+        {
+          ASSERT_EQUALS_INT(RC_OK, rc, "tuple found by RID");
+          TEST_CHECK(getAttr(out, table->schema, 0, &v));
+          ASSERT_EQUALS_INT(a % 11 == 0 ? a + numInserts : a, v->v.intV, "moved key");
+          freeVal(v);
+          TEST_CHECK(getAttr(out, table->schema, 2, &v));
+          ASSERT_EQUALS_INT(a % 7 == 0 ? 99 : a % 10, v->v.intV, "updated value");
+          freeVal(v);
+          free(out->data);
+        }
+    }
+  memset(seen, 0, 2 * numInserts);
+  TEST_CHECK(startScan(table, sc, sel));
+  count = scanAll(sc, r, seen);
+  TEST_CHECK(closeScan(sc));
+  for(i = 0, a = 1000; a < 1100; a++)
+    i += a % 5 != 0 && a % 11 != 0;
+  ASSERT_EQUALS_INT(i, count, "key range after the changes");
+  memset(seen, 0, 2 * numInserts);
+  TEST_CHECK(startScan(table, sc, NULL));
+  count = scanAll(sc, r, seen);
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(tuples, count, "full scan after the changes");
+  ASSERT_TRUE(seen[11] == 0 && seen[12] == 1 && seen[11 + numInserts] == 1 && seen[55 + numInserts] == 0, "moved keys scanned");
+  ASSERT_ERROR(startSampleScan(table, sc, NULL, 0.5, 1), "no pages to sample");
+
+  free(out);
+  freeRecord(r);
+  freeExpr(sel);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  file = fopen(TEST_TABLE ".clu", "rb");
+  ASSERT_TRUE(file == NULL, "tree removed");
+  if (file != NULL)
+    fclose(file);
+  free(table);
+  free(sc);
+  free(seen);
+  free(rids);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testPartitionedTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Schema *schema = testSchema();
+  int numInserts = 4000;
+  char *seen = (char *) calloc(numInserts, sizeof(char));
+  Value *bounds[3];
+  RM_TableOptions options;
+  Expr *sel, *low, *high, *attr, *cons, *cmp;
+  Record *r, *out;
+  Value *v, *key;
+  RID moved;
+  FILE *file;
+  int count, parts, tuples, partition;
+  RC rc;
+
+  testName = "test range and hash partitioned tables";
+
+  memset(&options, 0, sizeof(options));
+  options.partitioning = RM_PARTITION_RANGE;
+  options.partitionAttr = 0;
+  options.numPartitions = 4;
+  options.partitionBounds = bounds;
+  bounds[0] = stringToValue("i2000");
+  bounds[1] = stringToValue("i1000");
+  bounds[2] = stringToValue("i3000");
+  rc = createTableWithOptions(TEST_TABLE, schema, &options);
+  ASSERT_EQUALS_INT(RC_INVALID_ARGS, rc, "bounds out of order");
+  freeVal(bounds[0]);
+  freeVal(bounds[1]);
+  bounds[0] = stringToValue("i1000");
+  bounds[1] = stringToValue("i2000");
+  TEST_CHECK(createTableWithOptions(TEST_TABLE, schema, &options));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  insertTuples(table, numInserts);
+  TEST_CHECK(createRecord(&r, table->schema));
+  tuples = getNumTuples(table);
+  ASSERT_EQUALS_INT(numInserts, tuples, "tuples of all partitions");
+  parts = getNumPartitions(table);
+  ASSERT_EQUALS_INT(4, parts, "partitions");
+
+  // a < 1000 only reads the first partition
+  MAKE_ATTRREF(attr, 0);
+  MAKE_CONS(cons, stringToValue("i1000"));
+  MAKE_BINOP_EXPR(sel, attr, cons, OP_COMP_SMALLER);
+  TEST_CHECK(startScan(table, sc, sel));
+  parts = getNumScanPartitions(sc);
+  count = scanAll(sc, r, seen);
+  TEST_CHECK(closeScan(sc));
+  freeExpr(sel);
+  ASSERT_EQUALS_INT(1, parts, "one partition read");
+  ASSERT_EQUALS_INT(1000, count, "records below the bound");
+  ASSERT_TRUE(seen[999] == 1 && seen[1000] == 0, "range of the scan");
+
+  // NOT (a < 1500) AND a < 2500 reads the second and the third
+  memset(seen, 0, numInserts);
+  MAKE_ATTRREF(attr, 0);
+  MAKE_CONS(cons, stringToValue("i1500"));
+  MAKE_BINOP_EXPR(cmp, attr, cons, OP_COMP_SMALLER);
+  MAKE_UNOP_EXPR(low, cmp, OP_BOOL_NOT);
+  MAKE_ATTRREF(attr, 0);
+  MAKE_CONS(cons, stringToValue("i2500"));
+  MAKE_BINOP_EXPR(high, attr, cons, OP_COMP_SMALLER);
+  MAKE_BINOP_EXPR(sel, low, high, OP_BOOL_AND);
+  TEST_CHECK(startCompiledScan(table, sc, sel));
+  parts = getNumScanPartitions(sc);
+  count = scanAll(sc, r, seen);
+  TEST_CHECK(closeScan(sc));
+  freeExpr(sel);
+  ASSERT_EQUALS_INT(2, parts, "two partitions read");
+  ASSERT_EQUALS_INT(1000, count, "records in the range");
+  ASSERT_TRUE(seen[1500] == 1 && seen[2499] == 1 && seen[1499] == 0 && seen[2500] == 0, "bounds of the range");
+
+  // c = 3 does not narrow the partitions
+  MAKE_ATTRREF(attr, 2);
+  MAKE_CONS(cons, stringToValue("i3"));
+  MAKE_BINOP_EXPR(sel, attr, cons, OP_COMP_EQUAL);
+  TEST_CHECK(startScan(table, sc, sel));
+  parts = getNumScanPartitions(sc);
+  memset(seen, 0, numInserts);
+  count = scanAll(sc, r, seen);
+  TEST_CHECK(closeScan(sc));
+  freeExpr(sel);
+  ASSERT_EQUALS_INT(4, parts, "every partition read");
+  ASSERT_EQUALS_INT(numInserts / 10, count, "records of other attributes");
+
+  // moving a = 5 to a = 3500 moves it to the last partition
+  MAKE_ATTRREF(attr, 0);
+  MAKE_CONS(cons, stringToValue("i5"));
+  MAKE_BINOP_EXPR(sel, attr, cons, OP_COMP_EQUAL);
+  TEST_CHECK(startScan(table, sc, sel));
+  TEST_CHECK(next(sc, r));
+  TEST_CHECK(closeScan(sc));
+  moved = r->id;
+  MAKE_VALUE(v, DT_INT, 3500);
+  TEST_CHECK(setAttr(r, table->schema, 0, v));
+  freeVal(v);
+  TEST_CHECK(updateRecord(table, r));
+  ASSERT_TRUE(r->id.page != moved.page, "moved record has a new RID");
+  out = (Record *) malloc(sizeof(Record));
+  rc = getRecord(table, moved, out);
+  ASSERT_EQUALS_INT(RC_RM_RECORD_NOT_EXIST, rc, "old RID is gone");
+  TEST_CHECK(getRecord(table, r->id, out));
+  TEST_CHECK(getAttr(out, table->schema, 0, &v));
+  ASSERT_EQUALS_INT(3500, v->v.intV, "record found by its new RID");
+  freeVal(v);
+  free(out->data);
+  key = stringToValue("i3500");
+  TEST_CHECK(getPartitionOf(table, key, &partition));
+  ASSERT_EQUALS_INT(3, partition, "partition of a value");
+  freeVal(key);
+
+  // dropping the first partition removes its records at once
+  TEST_CHECK(dropPartition(table, 0));
+  tuples = getNumTuples(table);
+  ASSERT_EQUALS_INT(numInserts - 999, tuples, "partition dropped");
+  ASSERT_ERROR(dropPartition(table, 4), "no such partition");
+  TEST_CHECK(startScan(table, sc, NULL));
+  ASSERT_ERROR(dropPartition(table, 1), "no partition dropped under an open scan");
+  TEST_CHECK(closeScan(sc));
+  tuples = getNumTuples(table);
+  ASSERT_EQUALS_INT(numInserts - 999, tuples, "refused drop keeps the records");
+  MAKE_VALUE(v, DT_INT, 5);
+  TEST_CHECK(setAttr(r, table->schema, 0, v));
+  freeVal(v);
+  TEST_CHECK(insertRecord(table, r));
+  ASSERT_ERROR(startSampleScan(table, sc, NULL, 0.5, 1), "no pages of its own to sample");
+
+  // the partitions survive reopening
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  tuples = getNumTuples(table);
+  ASSERT_EQUALS_INT(numInserts - 998, tuples, "count survives reopening");
+  TEST_CHECK(startScan(table, sc, sel));
+  parts = getNumScanPartitions(sc);
+  memset(seen, 0, numInserts);
+  count = scanAll(sc, r, seen);
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(1, parts, "one partition read after reopening");
+  ASSERT_EQUALS_INT(1, count, "record inserted after the drop");
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  file = fopen(TEST_TABLE ".p3", "rb");
+  ASSERT_TRUE(file == NULL, "partitions removed");
+  if (file != NULL)
+    fclose(file);
+
+  // hash partitions of clustered tables, found by key in one of them
+  memset(&options, 0, sizeof(options));
+  options.engine = RM_ENGINE_CLUSTERED;
+  options.partitioning = RM_PARTITION_HASH;
+  options.partitionAttr = 0;
+  options.numPartitions = 5;
+  TEST_CHECK(createTableWithOptions(TEST_TABLE, schema, &options));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  insertTuples(table, 1000);
+  TEST_CHECK(startScan(table, sc, sel));
+  parts = getNumScanPartitions(sc);
+  memset(seen, 0, numInserts);
+  count = scanAll(sc, r, seen);
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(1, parts, "equality reads one hash partition");
+  ASSERT_EQUALS_INT(1, count, "record of the key");
+  key = stringToValue("i777");
+  TEST_CHECK(getRecordByKey(table, &key, out));
+  TEST_CHECK(getAttr(out, table->schema, 2, &v));
+  ASSERT_EQUALS_INT(7, v->v.intV, "record found by key");
+  freeVal(v);
+  free(out->data);
+  TEST_CHECK(getRecord(table, out->id, out));
+  free(out->data);
+  freeVal(key);
+  freeExpr(sel);
+  MAKE_ATTRREF(attr, 0);
+  MAKE_CONS(cons, stringToValue("i100"));
+  MAKE_BINOP_EXPR(sel, attr, cons, OP_COMP_SMALLER);
+  TEST_CHECK(startScan(table, sc, sel));
+  parts = getNumScanPartitions(sc);
+  count = scanAll(sc, r, seen);
+  TEST_CHECK(closeScan(sc));
+  freeExpr(sel);
+  ASSERT_EQUALS_INT(5, parts, "range reads every hash partition");
+  ASSERT_EQUALS_INT(100, count, "records in the range");
+
+  freeRecord(r);
+  free(out);
+  freeVal(bounds[0]);
+  freeVal(bounds[1]);
+  freeVal(bounds[2]);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(table);
+  free(sc);
+  free(seen);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testTruncateTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Schema *schema = testSchema();
+  int numInserts = 1000;
+  char *seen = (char *) calloc(numInserts, sizeof(char));
+  RM_TableOptions options;
+  Record *r;
+  BM_PageHandle page;
+  FILE *file;
+  long size;
+  int engine, i, count, tuples, writes;
+  RC rc;
+
+  testName = "test truncating and dropping tables";
+
+  // heap, LSM, clustered and hash partitioned tables
+  for(engine = 0; engine < 4; engine++)
+    {
+      memset(&options, 0, sizeof(options));
+      if (engine == 1)
+	{
+	  options.engine = RM_ENGINE_LSM;
+	  options.memtableSize = 240;
+	  options.tierFanout = 3;
+	}
+      else if (engine == 2)
+	options.engine = RM_ENGINE_CLUSTERED;
+      else if (engine == 3)
+	{
+	  options.partitioning = RM_PARTITION_HASH;
+	  options.partitionAttr = 0;
+	  options.numPartitions = 4;
+	}
+      TEST_CHECK(createTableWithOptions(TEST_TABLE, schema, &options));
+      TEST_CHECK(openTable(table, TEST_TABLE));
+      TEST_CHECK(createRecord(&r, table->schema));
+      insertTuples(table, numInserts);
+
+      TEST_CHECK(startScan(table, sc, NULL));
+      ASSERT_ERROR(truncateTable(table), "no truncate while a scan is open");
+      TEST_CHECK(closeScan(sc));
+      if (engine == 0)
+	{
+	  TEST_CHECK(startSampleScan(table, sc, NULL, 0.5, 7));
+	  ASSERT_ERROR(truncateTable(table), "no truncate while a sample scan is open");
+	  TEST_CHECK(closeScan(sc));
+	  TEST_CHECK(pinPage(table->bm, &page, 2));
+	  rc = truncateTable(table);
+	  ASSERT_EQUALS_INT(RC_PAGE_PINNED, rc, "no truncate while a data page is pinned");
+	  TEST_CHECK(unpinPage(table->bm, &page));
+
+	  // the dirty pages are dropped, not written
+	  writes = getNumWriteIO(table->bm);
+	  TEST_CHECK(truncateTable(table));
+	  ASSERT_EQUALS_INT(writes, getNumWriteIO(table->bm), "nothing written back");
+	  file = fopen(TEST_TABLE, "rb");
+	  fseek(file, 0, SEEK_END);
+	  size = ftell(file);
+	  fclose(file);
+	  ASSERT_TRUE(size == 2 * PAGE_SIZE, "file cut back to the schema and the page directory");
+	}
+      else
+	TEST_CHECK(truncateTable(table));
+      tuples = getNumTuples(table);
+      ASSERT_EQUALS_INT(0, tuples, "no tuples after truncating");
+      TEST_CHECK(startScan(table, sc, NULL));
+      count = scanAll(sc, r, seen);
+      TEST_CHECK(closeScan(sc));
+      ASSERT_EQUALS_INT(0, count, "scan finds nothing");
+
+      // the same keys go in again and are still there after reopening
+      insertTuples(table, numInserts);
+      TEST_CHECK(closeTable(table));
+      TEST_CHECK(openTable(table, TEST_TABLE));
+      tuples = getNumTuples(table);
+      ASSERT_EQUALS_INT(numInserts, tuples, "tuples inserted after truncating");
+      memset(seen, 0, numInserts);
+      TEST_CHECK(startScan(table, sc, NULL));
+      count = scanAll(sc, r, seen);
+      TEST_CHECK(closeScan(sc));
+      ASSERT_EQUALS_INT(numInserts, count, "scan finds the new tuples");
+      for(i = 0; i < numInserts; i++)
+	ASSERT_TRUE(seen[i] == 1, "each tuple returned once");
+      memset(seen, 0, numInserts);
+
+      freeRecord(r);
+      TEST_CHECK(dropTable(table));
+      file = fopen(TEST_TABLE, "rb");
+      ASSERT_TRUE(file == NULL, "table file removed");
+    }
+
+  free(table);
+  free(sc);
+  free(seen);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testTimeSeriesTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Schema *schema = metricSchema();
+  int numInserts = 20000;
+  RID *rids = (RID *) malloc(sizeof(RID) * numInserts);
+  RM_TableOptions options;
+  Expr *sel, *low, *high, *attr, *cons, *cmp;
+  Record *r;
+  Value *v;
+  long size;
+  int i, count, tuples, blocks, ok;
+  RC rc;
+
+  testName = "test append-only time-series table";
+
+  memset(&options, 0, sizeof(options));
+  options.engine = RM_ENGINE_TIMESERIES;
+  options.timeAttr = 2;
+  rc = createTableWithOptions(TEST_TABLE, schema, &options);
+  ASSERT_EQUALS_INT(RC_INVALID_ARGS, rc, "time attribute must be an INT");
+  options.timeAttr = 0;
+  TEST_CHECK(createTableWithOptions(TEST_TABLE, schema, &options));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+
+  insertMetrics(table, 0, numInserts, rids);
+  TEST_CHECK(createRecord(&r, table->schema));
+  tuples = getNumTuples(table);
+  ASSERT_EQUALS_INT(numInserts, tuples, "all tuples counted");
+
+  // every record comes back in insert order, through the compressed blocks
+  TEST_CHECK(startScan(table, sc, NULL));
+  for(ok = 1, count = 0; (rc = next(sc, r)) == RC_OK; count++)
+    {
+      float f = (count % 50) * 0.5f;
+      int t = 1000 + 10 * count;
+      ok &= memcmp(r->data, &t, sizeof(int)) == 0 && memcmp(r->data + sizeof(int), "web1", 4) == 0
+	&& memcmp(r->data + sizeof(int) + 4, &f, sizeof(float)) == 0;
+    }
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ended");
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(numInserts, count, "all tuples scanned");
+  ASSERT_TRUE(ok, "records decoded as inserted");
+
+  // 100000 <= t AND t < 101000 decodes the blocks holding that range only
+  MAKE_ATTRREF(attr, 0);
+  MAKE_CONS(cons, stringToValue("i100000"));
+  MAKE_BINOP_EXPR(cmp, attr, cons, OP_COMP_SMALLER);
+  MAKE_UNOP_EXPR(low, cmp, OP_BOOL_NOT);
+  MAKE_ATTRREF(attr, 0);
+  MAKE_CONS(cons, stringToValue("i101000"));
+  MAKE_BINOP_EXPR(high, attr, cons, OP_COMP_SMALLER);
+  MAKE_BINOP_EXPR(sel, low, high, OP_BOOL_AND);
+  TEST_CHECK(startScan(table, sc, sel));
+  blocks = getNumScanBlocks(sc);
+  for(count = 0; (rc = next(sc, r)) == RC_OK; count++)
+    ;
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(100, count, "tuples in the time range");
+  ASSERT_TRUE(blocks >= 1 && blocks <= 2, "only overlapping blocks decoded");
+
+  // lookups by RID, in blocks and in the tail page
+  for(ok = 1, i = 0; i < numInserts; i += 997)
+    {
+      Record *out = (Record *) malloc(sizeof(Record));
+      int t = 1000 + 10 * i;
+      TEST_CHECK(getRecord(table, rids[i], out));
+      ok &= memcmp(out->data, &t, sizeof(int)) == 0;
+      free(out->data);
+      free(out);
+    }
+  TEST_CHECK(getRecord(table, rids[numInserts - 1], r));
+  ASSERT_TRUE(ok && memcmp(r->data, &(int){ 1000 + 10 * (numInserts - 1) }, sizeof(int)) == 0, "records found by RID");
+  ASSERT_ERROR(updateRecord(table, r), "no updates");
+  ASSERT_ERROR(deleteRecord(table, rids[0]), "no deletes");
+  ASSERT_ERROR(startSampleScan(table, sc, NULL, 0.5, 1), "no pages to sample");
+
+  // closed pages take less room than the records
+  TEST_CHECK(closeTable(table));
+  size = fileSize(TEST_TABLE ".ts");
+  ASSERT_TRUE(size < (long) numInserts * 12 * 3 / 4, "closed pages compressed");
+
+  // the tail page and the directory survive reopening, and appends go on
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  tuples = getNumTuples(table);
+  ASSERT_EQUALS_INT(numInserts, tuples, "count survives reopening");
+  MAKE_VALUE(v, DT_INT, 1000 + 10 * numInserts);
+  TEST_CHECK(setAttr(r, table->schema, 0, v));
+  freeVal(v);
+  TEST_CHECK(insertRecord(table, r));
+  ASSERT_EQUALS_INT(numInserts, r->id.page, "rows keep counting");
+  TEST_CHECK(startScan(table, sc, sel));
+  for(count = 0; (rc = next(sc, r)) == RC_OK; count++)
+    ;
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(100, count, "time range after reopening");
+  TEST_CHECK(getRecord(table, rids[numInserts - 1], r));
+  ASSERT_TRUE(memcmp(r->data, &(int){ 1000 + 10 * (numInserts - 1) }, sizeof(int)) == 0, "tail record after reopening");
+
+  TEST_CHECK(truncateTable(table));
+  tuples = getNumTuples(table);
+  ASSERT_EQUALS_INT(0, tuples, "no tuples after truncating");
+  freeExpr(sel);
+  freeRecord(r);
+  TEST_CHECK(dropTable(table));
+  size = fileSize(TEST_TABLE ".ts");
+  ASSERT_TRUE(size < 0, "storage removed");
+
+  free(rids);
+  free(table);
+  free(sc);
+  TEST_DONE();
+}
+
+// ************************************************************
+static atomic_int now;  // read by the thread of startExpiry
+
+// clock of testRecordExpiry
+int
+testClock (void)
+{
+  return now;
+}
+
+void
+testRecordExpiry (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Schema *schema = metricSchema();
+  int numInserts = 20000;
+  RID *rids = (RID *) malloc(sizeof(RID) * 2 * numInserts);
+  RM_TableOptions options;
+  Record *r;
+  long before, after;
+  int count, tuples, blocks, pages, i;
+  RC rc;
+
+  testName = "test records expiring after their TTL";
+
+  memset(&options, 0, sizeof(options));
+  options.ttl = 100000;
+  rc = createTableWithOptions(TEST_TABLE, schema, &options);
+  ASSERT_EQUALS_INT(RC_INVALID_ARGS, rc, "only time-series tables expire");
+  options.engine = RM_ENGINE_TIMESERIES;
+  options.timeAttr = 0;
+  TEST_CHECK(createTableWithOptions(TEST_TABLE, schema, &options));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  TEST_CHECK(createRecord(&r, table->schema));
+  setExpiryClock(testClock);
+
+  // times 1000 .. 200990; at 201000 the first half has expired
+  insertMetrics(table, 0, numInserts, rids);
+  now = 201000;
+  TEST_CHECK(startScan(table, sc, NULL));
+  blocks = getNumScanBlocks(sc);
+  for(count = 0; (rc = next(sc, r)) == RC_OK; count++)
+    ;
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(numInserts / 2, count, "expired records hidden from scans");
+  ASSERT_TRUE(blocks <= numInserts / 2 / 341 + 2, "expired blocks not read");
+  rc = getRecord(table, rids[0], r);
+  ASSERT_EQUALS_INT(RC_RM_RECORD_NOT_EXIST, rc, "expired block hidden from lookups");
+  rc = getRecord(table, rids[numInserts / 2 - 1], r);
+  ASSERT_EQUALS_INT(RC_RM_RECORD_NOT_EXIST, rc, "expired record hidden from lookups");
+  TEST_CHECK(getRecord(table, rids[numInserts / 2], r));
+
+  // nothing is reclaimed under an open scan
+  TEST_CHECK(startScan(table, sc, NULL));
+  TEST_CHECK(reclaimExpired(table, &pages));
+  ASSERT_EQUALS_INT(0, pages, "no pages reclaimed during a scan");
+  TEST_CHECK(closeScan(sc));
+
+  TEST_CHECK(reclaimExpired(table, &pages));
+  ASSERT_TRUE(pages > 10, "pages of expired blocks reclaimed");
+  tuples = getNumTuples(table);
+  ASSERT_TRUE(tuples >= numInserts / 2 && tuples < numInserts / 2 + 341, "reclaimed records no longer counted");
+  TEST_CHECK(startScan(table, sc, NULL));
+  for(count = 0; (rc = next(sc, r)) == RC_OK; count++)
+    ;
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(numInserts / 2, count, "records kept after reclaiming");
+  rc = getRecord(table, rids[0], r);
+  ASSERT_EQUALS_INT(RC_RM_RECORD_NOT_EXIST, rc, "reclaimed record gone");
+
+  // the free pages survive reopening and take the next blocks
+  TEST_CHECK(closeTable(table));
+  before = fileSize(TEST_TABLE ".ts");
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  insertMetrics(table, numInserts, numInserts / 2, rids);
+  TEST_CHECK(closeTable(table));
+  after = fileSize(TEST_TABLE ".ts");
+  ASSERT_TRUE(after < before + 4 * PAGE_SIZE, "freed pages reused");
+
+  // a background task reclaims the rest once it expires
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  rc = startExpiry(table, 0);
+  ASSERT_EQUALS_INT(RC_INVALID_ARGS, rc, "interval must be positive");
+  TEST_CHECK(startExpiry(table, 5));
+  rc = startExpiry(table, 5);
+  ASSERT_EQUALS_INT(RC_INVALID_ARGS, rc, "one task per table");
+  now = 1000000;
+  for(i = 0; i < 400 && getNumTuples(table) > 341; i++)
+    usleep(5000);
+  TEST_CHECK(stopExpiry(table));
+  tuples = getNumTuples(table);
+  ASSERT_TRUE(tuples <= 341, "every closed block reclaimed");
+  TEST_CHECK(startScan(table, sc, NULL));
+  rc = next(sc, r);
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "expired tail hidden");
+
+  // closing the table stops the task
+  TEST_CHECK(startExpiry(table, 5));
+  freeRecord(r);
+  TEST_CHECK(dropTable(table));
+  setExpiryClock(NULL);
+
+  free(rids);
+  free(table);
+  free(sc);
+  TEST_DONE();
+}
+
+// insert samples (1000 + 10 * i, "web1", (i % 50) * 0.5) for i = first .. first + num - 1
+void
+insertMetrics (RM_TableData *table, int first, int num, RID *rids)
+{
+  Record *r;
+  Value *v;
+  int i;
+
+  TEST_CHECK(createRecord(&r, table->schema));
+  for(i = first; i < first + num; i++)
+    {
+      MAKE_VALUE(v, DT_INT, 1000 + 10 * i);
+      TEST_CHECK(setAttr(r, table->schema, 0, v));
+      freeVal(v);
+      MAKE_STRING_VALUE(v, "web1");
+      TEST_CHECK(setAttr(r, table->schema, 1, v));
+      freeVal(v);
+      MAKE_VALUE(v, DT_FLOAT, (i % 50) * 0.5f);
+      TEST_CHECK(setAttr(r, table->schema, 2, v));
+      freeVal(v);
+      TEST_CHECK(insertRecord(table, r));
+      rids[i] = r->id;
+    }
+  freeRecord(r);
+}
+
+// size of a file, -1 if there is none
+long
+fileSize (char *name)
+{
+  FILE *file = fopen(name, "rb");
+  long size;
+
+  if (file == NULL)
+    return -1;
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  fclose(file);
+  return size;
+}
+
+// insert tuples (i, "abc", i % 10) for i = 0 .. num - 1
+void
+insertTuples (RM_TableData *table, int num)
+{
+  Record *r;
+  Value *v;
+  int i;
+
+  for(i = 0; i < num; i++)
+    {
+      TEST_CHECK(createRecord(&r, table->schema));
+      MAKE_VALUE(v, DT_INT, i);
+      TEST_CHECK(setAttr(r, table->schema, 0, v));
+      freeVal(v);
+      MAKE_STRING_VALUE(v, "abc");
+      TEST_CHECK(setAttr(r, table->schema, 1, v));
+      freeVal(v);
+      MAKE_VALUE(v, DT_INT, i % 10);
+      TEST_CHECK(setAttr(r, table->schema, 2, v));
+      freeVal(v);
+      TEST_CHECK(insertRecord(table, r));
+      freeRecord(r);
+    }
+}
+
+// run a scan to the end, marking the value of attribute a of every tuple in seen
+int
+scanAll (RM_ScanHandle *sc, Record *r, char *seen)
+{
+  Value *v;
+  int count = 0;
+  RC rc;
+
+  while((rc = next(sc, r)) == RC_OK)
+    {
+      TEST_CHECK(getAttr(r, sc->rel->schema, 0, &v));
+      seen[v->v.intV]++;
+      freeVal(v);
+      count++;
+    }
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ended");
+  return count;
+}
+
+// ************************************************************
+void
+testInsertAndScan (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Schema *schema = testSchema();
+  int numInserts = 500;
+  char *seen = (char *) calloc(numInserts, sizeof(char));
+  Record *r;
+  RID rid;
+  int i, count;
+
+  testName = "test scanning every data page";
+
+  TEST_CHECK(createTable(TEST_TABLE, schema));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  insertTuples(table, numInserts);
+  ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "all tuples counted");
+
+  TEST_CHECK(createRecord(&r, table->schema));
+  TEST_CHECK(startScan(table, sc, NULL));
+  count = scanAll(sc, r, seen);
+  ASSERT_EQUALS_INT(numInserts, count, "scan without condition returns every tuple");
+  TEST_CHECK(closeScan(sc));
+  for(i = 0; i < numInserts; i++)
+    ASSERT_TRUE(seen[i] == 1, "each tuple returned once");
+
+  // delete the first tuple and make sure the scan skips it
+  rid.page = 2;
+  rid.slot = 0;
+  TEST_CHECK(deleteRecord(table, rid));
+  ASSERT_ERROR(getRecord(table, rid, r), "deleted tuple is gone");
+  memset(seen, 0, numInserts);
+  TEST_CHECK(startScan(table, sc, NULL));
+  count = scanAll(sc, r, seen);
+  ASSERT_EQUALS_INT(numInserts - 1, count, "deleted tuple skipped");
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(0, seen[0], "tuple 0 not returned");
+
+  freeRecord(r);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(table);
+  free(sc);
+  free(seen);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testConditionalScan (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Schema *schema = testSchema();
+  int numInserts = 300;
+  char *seen = (char *) calloc(numInserts, sizeof(char));
+  Expr *sel, *left, *right;
+  Record *r;
+  int i, count;
+
+  testName = "test scan with a condition";
+
+  TEST_CHECK(createTable(TEST_TABLE, schema));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  insertTuples(table, numInserts);
+
+  // c = 3
+  MAKE_CONS(left, stringToValue("i3"));
+  MAKE_ATTRREF(right, 2);
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+
+  TEST_CHECK(createRecord(&r, table->schema));
+  TEST_CHECK(startScan(table, sc, sel));
+  count = scanAll(sc, r, seen);
+  ASSERT_EQUALS_INT(numInserts / 10, count, "one tuple in ten matches");
+  TEST_CHECK(closeScan(sc));
+  for(i = 0; i < numInserts; i++)
+    ASSERT_TRUE(seen[i] == (i % 10 == 3), "only matching tuples returned");
+
+  freeRecord(r);
+  freeExpr(sel);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(table);
+  free(sc);
+  free(seen);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testSharedScan (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *leader = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  RM_ScanHandle *follower = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Schema *schema = testSchema();
+  int numInserts = 400;
+  int numDataPages = numInserts / 16;
+  char *seenLeader = (char *) calloc(numInserts, sizeof(char));
+  char *seenFollower = (char *) calloc(numInserts, sizeof(char));
+  Record *r1, *r2;
+  Value *v;
+  RC rc1 = RC_OK, rc2 = RC_OK;
+  int i, reads, joinPage, followed = 0;
+
+  testName = "test a scan joining a running scan";
+
+  TEST_CHECK(createTable(TEST_TABLE, schema));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  insertTuples(table, numInserts);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  TEST_CHECK(createRecord(&r1, table->schema));
+  TEST_CHECK(createRecord(&r2, table->schema));
+  reads = getNumReadIO(table->bm);
+
+  // move the leader into the middle of the table
+  TEST_CHECK(startScan(table, leader, NULL));
+  for(i = 0; i < 100; i++)
+    {
+      TEST_CHECK(next(leader, r1));
+      TEST_CHECK(getAttr(r1, table->schema, 0, &v));
+      seenLeader[v->v.intV]++;
+      freeVal(v);
+    }
+  joinPage = r1->id.page;
+  ASSERT_TRUE(joinPage > 2, "leader left the first data page");
+
+  // the follower starts on the page the leader is reading, then both run
+  // in lock step; the follower wraps around for the pages it missed
+  TEST_CHECK(startScan(table, follower, NULL));
+  while(rc1 == RC_OK || rc2 == RC_OK)
+    {
+      if (rc1 == RC_OK && (rc1 = next(leader, r1)) == RC_OK)
+	{
+	  TEST_CHECK(getAttr(r1, table->schema, 0, &v));
+	  seenLeader[v->v.intV]++;
+	  freeVal(v);
+	}
+      if (rc2 == RC_OK && (rc2 = next(follower, r2)) == RC_OK)
+	{
+	  if (followed++ == 0)
+	    ASSERT_EQUALS_INT(joinPage, r2->id.page, "follower joined at the leader's page");
+	  TEST_CHECK(getAttr(r2, table->schema, 0, &v));
+	  seenFollower[v->v.intV]++;
+	  freeVal(v);
+	}
+    }
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc1, "leader finished");
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc2, "follower finished");
+
+  for(i = 0; i < numInserts; i++)
+    {
+      ASSERT_TRUE(seenLeader[i] == 1, "leader returned each tuple once");
+      ASSERT_TRUE(seenFollower[i] == 1, "follower returned each tuple once");
+    }
+  reads = getNumReadIO(table->bm) - reads;
+  ASSERT_TRUE(reads < 2 * numDataPages, "shared pages read once");
+
+  TEST_CHECK(closeScan(leader));
+  TEST_CHECK(closeScan(follower));
+  freeRecord(r1);
+  freeRecord(r2);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(table);
+  free(leader);
+  free(follower);
+  free(seenLeader);
+  free(seenFollower);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testSampleScan (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Schema *schema = testSchema();
+  int numInserts = 1600;
+  char *seen = (char *) calloc(numInserts, sizeof(char));
+  Record *r;
+  int i, count, again, reads;
+
+  testName = "test sampling scan";
+
+  TEST_CHECK(createTable(TEST_TABLE, schema));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  insertTuples(table, numInserts);
+  TEST_CHECK(createRecord(&r, table->schema));
+
+  ASSERT_ERROR(startSampleScan(table, sc, NULL, 0, 1), "fraction must be positive");
+  ASSERT_ERROR(startSampleScan(table, sc, NULL, 1.5, 1), "fraction must be at most 1");
+
+  // 10% of the pages, whole pages at a time
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  reads = getNumReadIO(table->bm);
+  TEST_CHECK(startSampleScan(table, sc, NULL, 0.1, 42));
+  count = scanAll(sc, r, seen);
+  TEST_CHECK(closeScan(sc));
+  reads = getNumReadIO(table->bm) - reads;
+  ASSERT_TRUE(count > numInserts / 20 && count < numInserts / 5, "sample close to 10% of the tuples");
+  ASSERT_EQUALS_INT(0, count % 16, "sample made of whole pages");
+  ASSERT_TRUE(reads <= count / 16 + 1, "only sampled pages read");
+  for(i = 0; i < numInserts; i++)
+    ASSERT_TRUE(seen[i] <= 1, "no tuple returned twice");
+
+  // same seed, same sample
+  memset(seen, 0, numInserts);
+  TEST_CHECK(startSampleScan(table, sc, NULL, 0.1, 42));
+  again = scanAll(sc, r, seen);
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(count, again, "sample repeatable with the same seed");
+
+  // fraction 1 is a full scan
+  memset(seen, 0, numInserts);
+  TEST_CHECK(startSampleScan(table, sc, NULL, 1, 7));
+  count = scanAll(sc, r, seen);
+  ASSERT_EQUALS_INT(numInserts, count, "fraction 1 returns every tuple");
+  TEST_CHECK(closeScan(sc));
+
+  freeRecord(r);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(table);
+  free(sc);
+  free(seen);
+  TEST_DONE();
+}
+
+// ************************************************************
+// (a < bound AND c = 3) OR NOT (c < 8) OR b = "zzz"
+static Expr *
+testCondition (int bound)
+{
+  Expr *a, *b, *c, *cons, *left, *right, *sel;
+
+  MAKE_ATTRREF(a, 0);
+  MAKE_CONS(cons, stringToValue(bound == 100 ? "i100" : "i200"));
+  MAKE_BINOP_EXPR(left, a, cons, OP_COMP_SMALLER);
+  MAKE_ATTRREF(c, 2);
+  MAKE_CONS(cons, stringToValue("i3"));
+  MAKE_BINOP_EXPR(right, c, cons, OP_COMP_EQUAL);
+  MAKE_BINOP_EXPR(sel, left, right, OP_BOOL_AND);
+
+  MAKE_ATTRREF(c, 2);
+  MAKE_CONS(cons, stringToValue("i8"));
+  MAKE_BINOP_EXPR(left, c, cons, OP_COMP_SMALLER);
+  MAKE_UNOP_EXPR(right, left, OP_BOOL_NOT);
+  MAKE_BINOP_EXPR(left, sel, right, OP_BOOL_OR);
+
+  MAKE_ATTRREF(b, 1);
+  MAKE_CONS(cons, stringToValue("szzz"));
+  MAKE_BINOP_EXPR(right, b, cons, OP_COMP_EQUAL);
+  MAKE_BINOP_EXPR(sel, left, right, OP_BOOL_OR);
+  return sel;
+}
+
+void
+testCompiledScan (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Schema *schema = testSchema();
+  int numInserts = 500;
+  char *seenInterpreted = (char *) calloc(numInserts, sizeof(char));
+  char *seenCompiled = (char *) calloc(numInserts, sizeof(char));
+  Expr *sel = testCondition(100);
+  Expr *other = testCondition(200);
+  ExprPageFilter f1, f2;
+  Expr *left, *right, *cmp;
+  char *cc;
+  Record *r;
+  Value *v;
+  RID rid;
+  int i, count, expected;
+
+  testName = "test scan with a compiled condition";
+
+  TEST_CHECK(createTable(TEST_TABLE, schema));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  insertTuples(table, numInserts);
+  rid.page = 2;
+  rid.slot = 3;
+  TEST_CHECK(deleteRecord(table, rid));
+  TEST_CHECK(createRecord(&r, table->schema));
+
+  TEST_CHECK(compileExprFilter(sel, table->schema, &f1));
+  TEST_CHECK(compileExprFilter(other, table->schema, &f2));
+  ASSERT_TRUE(f1 == f2, "conditions of the same shape share one filter");
+
+  TEST_CHECK(startScan(table, sc, sel));
+  expected = scanAll(sc, r, seenInterpreted);
+  TEST_CHECK(closeScan(sc));
+  TEST_CHECK(startCompiledScan(table, sc, sel));
+  count = scanAll(sc, r, seenCompiled);
+  ASSERT_EQUALS_INT(expected, count, "same number of matches as the interpreter");
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(0, memcmp(seenInterpreted, seenCompiled, numInserts), "same tuples as the interpreter");
+  ASSERT_EQUALS_INT(0, seenCompiled[3], "deleted tuple skipped");
+
+  // other constants, same filter
+  memset(seenCompiled, 0, numInserts);
+  TEST_CHECK(startCompiledScan(table, sc, other));
+  scanAll(sc, r, seenCompiled);
+  TEST_CHECK(closeScan(sc));
+  for(i = 0; i < numInserts; i++)
+    ASSERT_EQUALS_INT((i != 3) && ((i < 200 && i % 10 == 3) || i % 10 >= 8), seenCompiled[i], "bound passed at run time");
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+
+  // records deleted or updated on the current page while the scan runs, NOT (a < 0) matching every record
+  freeExpr(sel);
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i0"));
+  MAKE_BINOP_EXPR(cmp, left, right, OP_COMP_SMALLER);
+  MAKE_UNOP_EXPR(sel, cmp, OP_BOOL_NOT);
+  TEST_CHECK(createTable(TEST_TABLE, schema));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  insertTuples(table, 10);
+  TEST_CHECK(startCompiledScan(table, sc, sel));
+  TEST_CHECK(next(sc, r));
+  rid = r->id;
+  for(i = 5; i < 10; i++)
+    {
+      rid.slot = r->id.slot + i;
+      TEST_CHECK(deleteRecord(table, rid));
+    }
+  rid.slot = r->id.slot + 1;
+  TEST_CHECK(getRecord(table, rid, r));
+  MAKE_VALUE(v, DT_INT, -1);
+  TEST_CHECK(setAttr(r, table->schema, 0, v));
+  freeVal(v);
+  TEST_CHECK(updateRecord(table, r));
+  memset(seenCompiled, 0, numInserts);
+  count = scanAll(sc, r, seenCompiled);
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(3, count, "deleted and no longer matching records skipped");
+  ASSERT_TRUE(seenCompiled[2] && seenCompiled[3] && seenCompiled[4], "records still matching returned");
+
+  // a shape the compiler failed on is not compiled again until the cache is dropped
+  freeExpr(sel);
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i7"));
+  MAKE_BINOP_EXPR(cmp, left, right, OP_COMP_EQUAL);
+  MAKE_UNOP_EXPR(left, cmp, OP_BOOL_NOT);
+  MAKE_UNOP_EXPR(sel, left, OP_BOOL_NOT);
+  cc = (getenv("CC") != NULL) ? strdup(getenv("CC")) : NULL;
+  setenv("CC", "false", 1);
+  ASSERT_EQUALS_INT(RC_RM_CODEGEN_FAILED, compileExprFilter(sel, table->schema, &f1), "compiler failed");
+  if (cc == NULL)
+    unsetenv("CC");
+  else
+    setenv("CC", cc, 1);
+  free(cc);
+  ASSERT_EQUALS_INT(RC_RM_CODEGEN_FAILED, compileExprFilter(sel, table->schema, &f1), "failure remembered");
+  TEST_CHECK(shutdownExprCodegen());
+  TEST_CHECK(compileExprFilter(sel, table->schema, &f1));
+
+  freeRecord(r);
+  freeExpr(sel);
+  freeExpr(other);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(table);
+  free(sc);
+  free(seenInterpreted);
+  free(seenCompiled);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testLsmTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Schema *schema = testSchema();
+  int numInserts = 2000;
+  char *seen = (char *) calloc(numInserts, sizeof(char));
+  RID *rids = (RID *) malloc(numInserts * sizeof(RID));
+  RM_TableOptions options;
+  Expr *sel, *left, *right;
+  Record *r, *out;
+  Value *v;
+  FILE *file;
+  int i, count, expected, tuples;
+  RC rc;
+
+  testName = "test table with LSM storage";
+
+  // 20 records per memtable, tiers of 3 files
+  memset(&options, 0, sizeof(options));
+  options.engine = RM_ENGINE_LSM;
+  options.memtableSize = 240;
+  options.tierFanout = 3;
+  TEST_CHECK(createTableWithOptions(TEST_TABLE, schema, &options));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  insertTuples(table, numInserts);
+  tuples = getNumTuples(table);
+  ASSERT_EQUALS_INT(numInserts, tuples, "all tuples counted");
+
+  TEST_CHECK(createRecord(&r, table->schema));
+  TEST_CHECK(startScan(table, sc, NULL));
+  while((rc = next(sc, r)) == RC_OK)
+    {
+      TEST_CHECK(getAttr(r, table->schema, 0, &v));
+      rids[v->v.intV] = r->id;
+      seen[v->v.intV]++;
+      freeVal(v);
+    }
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ended");
+  TEST_CHECK(closeScan(sc));
+  for(i = 0; i < numInserts; i++)
+    ASSERT_TRUE(seen[i] == 1, "each tuple returned once");
+
+  // set c = 99 where a % 7 = 0, then delete where a % 5 = 0
+  for(i = 0; i < numInserts; i += 7)
+    {
+      TEST_CHECK(getRecord(table, rids[i], r));
+      MAKE_VALUE(v, DT_INT, 99);
+      TEST_CHECK(setAttr(r, table->schema, 2, v));
+      freeVal(v);
+      TEST_CHECK(updateRecord(table, r));
+    }
+  for(i = 0; i < numInserts; i += 5)
+    TEST_CHECK(deleteRecord(table, rids[i]));
+  tuples = getNumTuples(table);
+  ASSERT_EQUALS_INT(numInserts - numInserts / 5, tuples, "deletes counted");
+
+  for(i = 0; i < numInserts; i++)
+    {
+      rc = getRecord(table, rids[i], out = (Record *) malloc(sizeof(Record)));
+      if (i % 5 == 0)
+	ASSERT_EQUALS_INT(RC_RM_RECORD_NOT_EXIST, rc, "deleted tuple is gone");
+      else
+	{
+	  ASSERT_EQUALS_INT(RC_OK, rc, "tuple found");
+	  TEST_CHECK(getAttr(out, table->schema, 2, &v));
+	  ASSERT_EQUALS_INT(i % 7 == 0 ? 99 : i % 10, v->v.intV, "newest version returned");
+	  freeVal(v);
+	  free(out->data);
+	}
+      free(out);
+    }
+
+  // c = 3 over the memtable and the files
+  MAKE_CONS(left, stringToValue("i3"));
+  MAKE_ATTRREF(right, 2);
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  for(expected = 0, i = 0; i < numInserts; i++)
+    expected += i % 10 == 3 && i % 7 != 0;
+  memset(seen, 0, numInserts);
+  TEST_CHECK(startCompiledScan(table, sc, sel));
+  count = scanAll(sc, r, seen);
+  ASSERT_EQUALS_INT(expected, count, "matching tuples returned");
+  TEST_CHECK(closeScan(sc));
+  ASSERT_ERROR(startSampleScan(table, sc, NULL, 0.5, 1), "no pages to sample");
+
+  // records in memory are written out on close
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  tuples = getNumTuples(table);
+  ASSERT_EQUALS_INT(numInserts - numInserts / 5, tuples, "count survives reopening");
+  memset(seen, 0, numInserts);
+  TEST_CHECK(startScan(table, sc, sel));
+  count = scanAll(sc, r, seen);
+  ASSERT_EQUALS_INT(expected, count, "matching tuples after reopening");
+  TEST_CHECK(closeScan(sc));
+
+  // the first files were merged into larger ones
+  file = fopen(TEST_TABLE ".sst0", "rb");
+  ASSERT_TRUE(file == NULL, "first file compacted away");
+  if (file != NULL)
+    fclose(file);
+
+  freeRecord(r);
+  freeExpr(sel);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  file = fopen(TEST_TABLE ".lsm", "rb");
+  ASSERT_TRUE(file == NULL, "manifest removed");
+  if (file != NULL)
+    fclose(file);
+  free(table);
+  free(sc);
+  free(seen);
+  free(rids);
+  TEST_DONE();
+}
@@ -0,0 +1,195 @@
+#include "record_mgr_typed.hpp"
+
+extern "C" {
+#include "test_helper.h"
+}
+
+#define TEST_TABLE "test_table_t"
+
+// (a INT, b STRING(4), c FLOAT, d BOOL)
+typedef rm::Layout<int, rm::String<4>, float, rm::Bool> TestLayout;
+
+static_assert(TestLayout::numAttr == 4, "four attributes");
+static_assert(TestLayout::offset<1>() == 4, "b follows a");
+static_assert(TestLayout::offset<2>() == 8, "c follows b");
+static_assert(TestLayout::offset<3>() == 12, "d follows c");
+static_assert(TestLayout::recordSize == 14, "bool stored as a short");
+static_assert(sizeof(rm_bool) == sizeof(short), "C API bool is a short in C++ too");
+
+// test methods
+static void testTypedMatchesC (void);
+static void testTypedScan (void);
+
+// helper methods
+static Schema *testSchema (void);
+static rm_bool flaggedRow (void *arg, char *data);
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  testName = (char *) "";
+
+  initRecordManager(NULL);
+  testTypedMatchesC();
+  testTypedScan();
+  shutdownRecordManager();
+
+  return 0;
+}
+
+Schema *
+testSchema (void)
+{
+  const char *names[] = { "a", "b", "c", "d" };
+  DataType dt[] = { DT_INT, DT_STRING, DT_FLOAT, DT_BOOL };
+  int sizes[] = { 0, 4, 0, 0 };
+  char **cpNames = (char **) malloc(sizeof(char*) * 4);
+  DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 4);
+  int *cpSizes = (int *) malloc(sizeof(int) * 4);
+  int *cpKeys = (int *) malloc(sizeof(int));
+  int i;
+
+  for(i = 0; i < 4; i++)
+    cpNames[i] = strdup(names[i]);
+  memcpy(cpDt, dt, sizeof(DataType) * 4);
+  memcpy(cpSizes, sizes, sizeof(int) * 4);
+  cpKeys[0] = 0;
+
+  return createSchema(4, cpNames, cpDt, cpSizes, 1, cpKeys);
+}
+
+// ************************************************************
+void
+testTypedMatchesC (void)
+{
+  Schema *schema = testSchema();
+  Record *r;
+  Value *v;
+
+  testName = (char *) "test typed access uses the C record format";
+
+  ASSERT_TRUE(TestLayout::matches(schema), "layout matches schema");
+  ASSERT_TRUE(!(rm::Layout<int, rm::String<5>, float, rm::Bool>::matches(schema)), "string length checked");
+  ASSERT_TRUE(!(rm::Layout<int, rm::String<4>, float>::matches(schema)), "attribute count checked");
+  ASSERT_EQUALS_INT(getRecordSize(schema), TestLayout::recordSize, "same record size as getRecordSize");
+
+  // typed writes, C reads
+  TEST_CHECK(createRecord(&r, schema));
+  rm::TypedRecord<TestLayout> t(r);
+  t.set<0>(42);
+  t.set<1>("abcd");
+  t.set<2>(1.5f);
+  t.set<3>(true);
+
+  TEST_CHECK(getAttr(r, schema, 0, &v));
+  ASSERT_EQUALS_INT(42, v->v.intV, "int written by typed setter");
+  freeVal(v);
+  TEST_CHECK(getAttr(r, schema, 1, &v));
+  ASSERT_EQUALS_STRING("abcd", v->v.stringV, "string written by typed setter");
+  freeVal(v);
+  TEST_CHECK(getAttr(r, schema, 2, &v));
+  ASSERT_TRUE(v->v.floatV == 1.5f, "float written by typed setter");
+  freeVal(v);
+  TEST_CHECK(getAttr(r, schema, 3, &v));
+  ASSERT_TRUE(v->v.boolV == 1, "bool written as a short");
+  freeVal(v);
+
+  // C writes, typed reads
+  MAKE_VALUE(v, DT_INT, -7);
+  TEST_CHECK(setAttr(r, schema, 0, v));
+  freeVal(v);
+  MAKE_STRING_VALUE(v, "xy");
+  TEST_CHECK(setAttr(r, schema, 1, v));
+  freeVal(v);
+  ASSERT_EQUALS_INT(-7, t.get<0>(), "int read by typed getter");
+  ASSERT_TRUE(t.get<1>() == "xy", "string read by typed getter");
+  ASSERT_TRUE(t.get<2>() == 1.5f, "float untouched");
+  ASSERT_TRUE(t.get<3>(), "bool read by typed getter");
+
+  // strings longer than the attribute are cut, not spilled into the next one
+  t.set<1>("toolong");
+  ASSERT_TRUE(t.get<1>() == "tool", "string cut at typeLength");
+  ASSERT_TRUE(t.get<2>() == 1.5f, "next attribute intact");
+
+  freeRecord(r);
+  freeSchema(schema);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testTypedScan (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Schema *schema = testSchema();
+  int numInserts = 200;
+  long sum = 0;
+  int count = 0, flagged = 0;
+  Record *r;
+  int i;
+
+  testName = (char *) "test typed access during a scan";
+
+  TEST_CHECK(createTable((char *) TEST_TABLE, schema));
+  TEST_CHECK(openTable(table, (char *) TEST_TABLE));
+  ASSERT_TRUE(TestLayout::matches(table->schema), "layout matches the stored schema");
+
+  TEST_CHECK(createRecord(&r, table->schema));
+  rm::TypedRecord<TestLayout> t(r);
+  for(i = 0; i < numInserts; i++)
+    {
+      t.set<0>(i);
+      t.set<1>("row");
+      t.set<2>(i / 2.0f);
+      t.set<3>(i % 4 == 0);
+      TEST_CHECK(insertRecord(table, r));
+    }
+
+  TEST_CHECK(startScan(table, sc, NULL));
+  while(next(sc, r) == RC_OK)
+    {
+      sum += t.get<0>();
+      count++;
+      if (t.get<3>())
+        flagged++;
+      ASSERT_TRUE(t.get<1>() == "row", "string column");
+    }
+  TEST_CHECK(closeScan(sc));
+
+  ASSERT_EQUALS_INT(numInserts, count, "every row scanned");
+  ASSERT_EQUALS_INT(numInserts * (numInserts - 1) / 2, (int) sum, "sum over typed int column");
+  ASSERT_EQUALS_INT(numInserts / 4, flagged, "bool column");
+
+  // a C++ row filter hands its answer back to the C scan as an rm_bool
+  count = 0;
+  TEST_CHECK(startScan(table, sc, NULL));
+  TEST_CHECK(setScanRowFilter(sc, flaggedRow, NULL));
+  while(next(sc, r) == RC_OK)
+    {
+      if (!t.get<3>())
+        flagged = -1;
+      count++;
+    }
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(numInserts / 4, count, "row filter keeps the flagged rows");
+  ASSERT_EQUALS_INT(numInserts / 4, flagged, "row filter keeps no other rows");
+
+  freeRecord(r);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable((char *) TEST_TABLE));
+  free(table);
+  free(sc);
+  TEST_DONE();
+}
+
+// row filter keeping the rows whose d is set
+rm_bool
+flaggedRow (void *arg, char *data)
+{
+  return TestLayout::get<3>(data);
+}
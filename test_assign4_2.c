@@ -0,0 +1,851 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dberror.h"
+#include "expr.h"
+#include "btree_mgr.h"
+#include "record_mgr.h"
+#include "norm_key.h"
+#include "tables.h"
+#include "test_helper.h"
+#include "test_util.h"
+
+#define ASSERT_EQUALS_RID(_l,_r, message)				\
+  do {									\
+    ASSERT_TRUE((_l).page == (_r).page && (_l).slot == (_r).slot, message); \
+  } while(0)
+
+// test methods
+static void testLargeTree (void);
+static void testBatchedLookup (void);
+static void testFloatKeys (void);
+static void testPrintTree (void);
+static void testAppendInserts (void);
+static void testDuplicateKeys (void);
+static void testBoolKeys (void);
+static void testCompositeKeys (void);
+static void testNormalizedSort (void);
+static void testNormKeyRange (void);
+static void testBloomFilter (void);
+
+// helper methods
+static RID dupRid (int key, int j);
+static int countKey (BTreeHandle *tree, int key, int step);
+static Schema *compositeSchema (void);
+static int compareNormKeys (const void *a, const void *b);
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  testName = "";
+
+  initIndexManager(NULL);
+  testLargeTree();
+  testBatchedLookup();
+  testFloatKeys();
+  testPrintTree();
+  testAppendInserts();
+  testDuplicateKeys();
+  testBoolKeys();
+  testCompositeKeys();
+  testNormalizedSort();
+  testNormKeyRange();
+  testBloomFilter();
+  shutdownIndexManager();
+
+  return 0;
+}
+
+// ************************************************************
+void
+testLargeTree (void)
+{
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+  int numInserts = 5000;
+  int *permute = createPermutation(numInserts);
+  int i, testint, rc;
+  Value key;
+  RID rid;
+
+  testName = "test multi-level b-tree across many pages";
+
+  TEST_CHECK(createBtree("testidx", DT_INT, 8));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+
+  key.dt = DT_INT;
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = permute[i] * 2;
+      TEST_CHECK(insertKey(tree, &key, ridFor(key.v.intV)));
+    }
+  key.v.intV = 10;
+  ASSERT_ERROR(insertKey(tree, &key, ridFor(10)), "duplicate key rejected");
+
+  // reopen: the tree has to come back from its pages
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+  TEST_CHECK(getNumEntries(tree, &testint));
+  ASSERT_EQUALS_INT(numInserts, testint, "number of entries after reopen");
+
+  for(i = 0; i < numInserts; i += 7)
+    {
+      key.v.intV = i * 2;
+      TEST_CHECK(findKey(tree, &key, &rid));
+      ASSERT_EQUALS_RID(ridFor(i * 2), rid, "found after reopen");
+      key.v.intV = i * 2 + 1;
+      ASSERT_TRUE(findKey(tree, &key, &rid) == RC_IM_KEY_NOT_FOUND, "odd keys are not in the tree");
+    }
+
+  // delete every third key, the scan has to skip them and stay sorted
+  for(i = 0; i < numInserts; i += 3)
+    {
+      key.v.intV = i * 2;
+      TEST_CHECK(deleteKey(tree, &key));
+    }
+  key.v.intV = 0;
+  ASSERT_TRUE(deleteKey(tree, &key) == RC_IM_KEY_NOT_FOUND, "deleting twice fails");
+
+  TEST_CHECK(openTreeScan(tree, &sc));
+  i = 0;
+  while((rc = nextEntry(sc, &rid)) == RC_OK)
+    {
+      if (i % 3 == 0)
+	i++;
+      ASSERT_EQUALS_RID(ridFor(i * 2), rid, "scan in key order");
+      i++;
+    }
+  TEST_CHECK(closeTreeScan(sc));
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "scan ends cleanly");
+  ASSERT_EQUALS_INT(numInserts, i, "scan saw every remaining entry");
+
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testBatchedLookup (void)
+{
+  BTreeHandle *tree = NULL;
+  int numInserts = 3000, numLookups = 1000;
+  int *permute = createPermutation(numInserts);
+  Value *keys = (Value *) malloc(sizeof(Value) * numLookups);
+  RID *results = (RID *) malloc(sizeof(RID) * numLookups);
+  int i;
+  Value key;
+
+  testName = "test batched lookups agree with findKey";
+
+  TEST_CHECK(createBtree("testidx", DT_INT, 16));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+
+  key.dt = DT_INT;
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = permute[i];
+      TEST_CHECK(insertKey(tree, &key, ridFor(permute[i])));
+    }
+
+  // a mix of present and missing keys, not a multiple of the group size
+  for(i = 0; i < numLookups; i++)
+    {
+      keys[i].dt = DT_INT;
+      keys[i].v.intV = rand() % (numInserts + numInserts / 4);
+    }
+  TEST_CHECK(findKeys(tree, keys, numLookups, results));
+
+  for(i = 0; i < numLookups; i++)
+    {
+      if (keys[i].v.intV < numInserts)
+	ASSERT_EQUALS_RID(ridFor(keys[i].v.intV), results[i], "batched lookup found the key");
+      else
+	ASSERT_TRUE(results[i].page == -1 && results[i].slot == -1, "missing key marked");
+    }
+
+  // an empty batch and a batch of one
+  TEST_CHECK(findKeys(tree, keys, 0, results));
+  TEST_CHECK(findKeys(tree, keys + 5, 1, results));
+  ASSERT_TRUE(results[0].page == -1 || results[0].page == ridFor(keys[5].v.intV).page, "single lookup");
+
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+  free(permute);
+  free(keys);
+  free(results);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testFloatKeys (void)
+{
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+  float values[] = { 2.5f, -1.0f, 0.0f, -3.75f, 100.0f, 0.5f };
+  int order[] = { 3, 1, 2, 5, 0, 4 }; // positions of values in float order
+  int numInserts = 6;
+  DataType type;
+  Value key;
+  RID rid;
+  int i;
+
+  testName = "test float keys keep their order";
+
+  TEST_CHECK(createBtree("testidx", DT_FLOAT, 2));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+  TEST_CHECK(getKeyType(tree, &type));
+  ASSERT_EQUALS_INT(DT_FLOAT, type, "key type stored");
+
+  key.dt = DT_FLOAT;
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.floatV = values[i];
+      TEST_CHECK(insertKey(tree, &key, ridFor(i)));
+    }
+
+  key.dt = DT_INT;
+  key.v.intV = 1;
+  ASSERT_ERROR(findKey(tree, &key, &rid), "key of the wrong type rejected");
+
+  TEST_CHECK(openTreeScan(tree, &sc));
+  for(i = 0; i < numInserts; i++)
+    {
+      TEST_CHECK(nextEntry(sc, &rid));
+      ASSERT_EQUALS_RID(ridFor(order[i]), rid, "negative floats sort first");
+    }
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, nextEntry(sc, &rid), "end of scan");
+  TEST_CHECK(closeTreeScan(sc));
+
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testPrintTree (void)
+{
+  BTreeHandle *tree = NULL;
+  int keys[] = { 1, 11, 13, 17, 23, 52 };
+  char *printed;
+  Value key;
+  int i;
+
+  testName = "test printing the tree";
+
+  TEST_CHECK(createBtree("testidx", DT_INT, 2));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+
+  key.dt = DT_INT;
+  for(i = 0; i < 6; i++)
+    {
+      key.v.intV = keys[i];
+      TEST_CHECK(insertKey(tree, &key, ridFor(keys[i])));
+    }
+
+  // root page 3 over leaves 1, 2 and 4
+  printed = printTree(tree);
+  ASSERT_EQUALS_STRING("(3)[1,13,2,23,4]\n"
+		       "(1)[1.1,1,11.11,11,2]\n"
+		       "(2)[13.13,13,17.17,17,4]\n"
+		       "(4)[23.23,23,52.52,52,-1]\n", printed, "tree layout");
+  free(printed);
+
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testAppendInserts (void)
+{
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+  int numInserts = 2000;
+  int *permute = createPermutation(numInserts);
+  int appendNodes, randomNodes;
+  int i, rc;
+  Value key;
+  RID rid;
+
+  testName = "test ascending inserts fill their leaves";
+
+  // the same keys once ascending, once in random order
+  key.dt = DT_INT;
+  TEST_CHECK(createBtree("testidx", DT_INT, 20));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = i * 2;
+      TEST_CHECK(insertKey(tree, &key, ridFor(i * 2)));
+    }
+  TEST_CHECK(getNumNodes(tree, &appendNodes));
+
+  // 90/10 splits: all leaves but the last hold 19 of 20 keys
+  ASSERT_TRUE(appendNodes < numInserts / 19 + numInserts / 190 + 4, "appends leave nearly full leaves");
+
+  // keys between the appended ones, then appends again
+  for(i = 0; i < numInserts; i += 5)
+    {
+      key.v.intV = i * 2 + 1;
+      TEST_CHECK(insertKey(tree, &key, ridFor(i * 2 + 1)));
+    }
+  for(i = 0; i < 100; i++)
+    {
+      key.v.intV = numInserts * 2 + i;
+      TEST_CHECK(insertKey(tree, &key, ridFor(numInserts * 2 + i)));
+    }
+
+  TEST_CHECK(openTreeScan(tree, &sc));
+  i = 0;
+  while((rc = nextEntry(sc, &rid)) == RC_OK)
+    {
+      if (i < numInserts * 2 && i % 2 == 1 && (i / 2) % 5 != 0)
+	i++;
+      ASSERT_EQUALS_RID(ridFor(i), rid, "scan in key order after mixed inserts");
+      i++;
+    }
+  TEST_CHECK(closeTreeScan(sc));
+  ASSERT_EQUALS_INT(numInserts * 2 + 100, i, "scan reached the last append");
+
+  key.v.intV = numInserts * 2 + 99;
+  TEST_CHECK(findKey(tree, &key, &rid));
+  ASSERT_EQUALS_RID(ridFor(numInserts * 2 + 99), rid, "last append found by a descent");
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+
+  TEST_CHECK(createBtree("testidx", DT_INT, 20));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = permute[i] * 2;
+      TEST_CHECK(insertKey(tree, &key, ridFor(permute[i] * 2)));
+    }
+  TEST_CHECK(getNumNodes(tree, &randomNodes));
+  ASSERT_TRUE(appendNodes < randomNodes, "fewer nodes than random inserts");
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testDuplicateKeys (void)
+{
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+  int numKeys = 10, perKey = 200, bigKey = 7, perBigKey = 3000;
+  int total = (numKeys - 1) * perKey + perBigKey;
+  int *permute = createPermutation(total);
+  int i, testint, count, rc;
+  Value key;
+  RID rid;
+
+  testName = "test duplicate keys with RID lists";
+
+  TEST_CHECK(createBtree("testidx", DT_INT, 8));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+
+  // entry e < perBigKey is RID e of the big key, the rest spread over the others
+  key.dt = DT_INT;
+  for(i = 0; i < total; i++)
+    {
+      int e = permute[i];
+      if (e < perBigKey)
+	{
+	  key.v.intV = bigKey;
+	  rid = dupRid(bigKey, e);
+	}
+      else
+	{
+	  e -= perBigKey;
+	  key.v.intV = e / perKey < bigKey ? e / perKey : e / perKey + 1;
+	  rid = dupRid(key.v.intV, e % perKey);
+	}
+      TEST_CHECK(insertKey(tree, &key, rid));
+    }
+
+  TEST_CHECK(getNumEntries(tree, &testint));
+  ASSERT_EQUALS_INT(total, testint, "every RID counted");
+  TEST_CHECK(getNumNodes(tree, &testint));
+  ASSERT_TRUE(testint <= 3, "every key stored once");
+
+  key.v.intV = 3;
+  ASSERT_ERROR(insertKey(tree, &key, dupRid(3, 10)), "same key and RID rejected");
+  TEST_CHECK(findKey(tree, &key, &rid));
+  ASSERT_EQUALS_RID(dupRid(3, 0), rid, "findKey returns the smallest RID");
+  key.v.intV = bigKey;
+  TEST_CHECK(findKey(tree, &key, &rid));
+  ASSERT_EQUALS_RID(dupRid(bigKey, 0), rid, "also for a list on posting pages");
+
+  count = countKey(tree, 3, 1);
+  ASSERT_EQUALS_INT(perKey, count, "all RIDs of a key, in order");
+  count = countKey(tree, bigKey, 1);
+  ASSERT_EQUALS_INT(perBigKey, count, "all RIDs of a long list, in order");
+  count = countKey(tree, 42, 1);
+  ASSERT_EQUALS_INT(0, count, "missing key gives an empty scan");
+
+  // remove every third RID of a short and a long list
+  for(i = 0; i < perBigKey; i += 3)
+    {
+      key.v.intV = bigKey;
+      TEST_CHECK(deleteEntry(tree, &key, dupRid(bigKey, i)));
+      if (i < perKey)
+	{
+	  key.v.intV = 3;
+	  TEST_CHECK(deleteEntry(tree, &key, dupRid(3, i)));
+	}
+    }
+  key.v.intV = 3;
+  ASSERT_TRUE(deleteEntry(tree, &key, dupRid(3, 0)) == RC_IM_KEY_NOT_FOUND, "deleted RID is gone");
+  count = countKey(tree, 3, 3);
+  ASSERT_EQUALS_INT(perKey - (perKey + 2) / 3, count, "short list after deletes");
+  count = countKey(tree, bigKey, 3);
+  ASSERT_EQUALS_INT(perBigKey - perBigKey / 3, count, "long list after deletes");
+
+  // a whole key goes at once
+  key.v.intV = 5;
+  TEST_CHECK(deleteKey(tree, &key));
+  ASSERT_TRUE(findKey(tree, &key, &rid) == RC_IM_KEY_NOT_FOUND, "deleted key is gone");
+  total -= (perKey + 2) / 3 + perBigKey / 3 + perKey;
+
+  // reopen and scan everything
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+  TEST_CHECK(getNumEntries(tree, &testint));
+  ASSERT_EQUALS_INT(total, testint, "entry count after deletes");
+
+  TEST_CHECK(openTreeScan(tree, &sc));
+  count = 0;
+  while((rc = nextEntry(sc, &rid)) == RC_OK)
+    count++;
+  TEST_CHECK(closeTreeScan(sc));
+  ASSERT_EQUALS_INT(total, count, "tree scan returns every RID of every key");
+  count = countKey(tree, bigKey, 3);
+  ASSERT_EQUALS_INT(perBigKey - perBigKey / 3, count, "long list after reopen");
+
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testBoolKeys (void)
+{
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+  int numRows = 1000, flagged = 0;
+  Value key;
+  RID rid;
+  int i;
+
+  testName = "test an index on a two-valued column";
+
+  TEST_CHECK(createBtree("testidx", DT_BOOL, 4));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+
+  key.dt = DT_BOOL;
+  for(i = 0; i < numRows; i++)
+    {
+      key.v.boolV = (i % 4 == 0);
+      TEST_CHECK(insertKey(tree, &key, ridFor(i)));
+    }
+
+  key.v.boolV = TRUE;
+  TEST_CHECK(openKeyScan(tree, &key, &sc));
+  while(nextEntry(sc, &rid) == RC_OK)
+    {
+      ASSERT_TRUE(rid.page % 4 == 0, "only flagged rows");
+      flagged++;
+    }
+  TEST_CHECK(closeTreeScan(sc));
+  ASSERT_EQUALS_INT(numRows / 4, flagged, "all flagged rows");
+
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testCompositeKeys (void)
+{
+  // strings in key order: a prefix sorts before the longer string
+  char *strings[] = { "", "a", "ab", "abc", "abcdefgh", "b", "ba" };
+  int numStrings = 7, numInts = 60;
+  int numInserts = numInts * numStrings;
+  int *permute = createPermutation(numInserts);
+  int attrs[] = { 0, 1 };
+  Schema *schema = compositeSchema();
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+  Value key[2], batch[2 * 7];
+  RID rid, rids[7];
+  DataType keyType;
+  char *printed;
+  int i, rc;
+
+  testName = "test an index on (INT, STRING) keys";
+
+  TEST_CHECK(createBtreeOnAttrs("testidx", schema, 2, attrs, 4));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+  TEST_CHECK(getKeyType(tree, &keyType));
+  ASSERT_EQUALS_INT(DT_INT, keyType, "key type is the first attribute's");
+
+  // the first attribute decides before the second, also for negative ints
+  key[0].dt = DT_INT;
+  key[1].dt = DT_STRING;
+  key[0].v.intV = 1;
+  key[1].v.stringV = "x";
+  TEST_CHECK(insertKey(tree, key, ridFor(1)));
+  key[0].v.intV = -2;
+  key[1].v.stringV = "yz";
+  TEST_CHECK(insertKey(tree, key, ridFor(2)));
+  printed = printTree(tree);
+  ASSERT_EQUALS_STRING("(1)[2.2,-2|yz,1.1,1|x,-1]\n", printed, "composite keys printed");
+  free(printed);
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+
+  TEST_CHECK(createBtreeOnAttrs("testidx", schema, 2, attrs, 4));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+  for(i = 0; i < numInserts; i++)
+    {
+      int k = permute[i];
+      key[0].v.intV = k / numStrings - numInts / 2;
+      key[1].v.stringV = strings[k % numStrings];
+      TEST_CHECK(insertKey(tree, key, ridFor(k)));
+    }
+
+  for(i = 0; i < numInserts; i++)
+    {
+      key[0].v.intV = i / numStrings - numInts / 2;
+      key[1].v.stringV = strings[i % numStrings];
+      TEST_CHECK(findKey(tree, key, &rid));
+      ASSERT_EQUALS_RID(ridFor(i), rid, "found the composite key");
+    }
+
+  // a string longer than the attribute is cut to its length
+  key[0].v.intV = 0;
+  key[1].v.stringV = "abcdefghij";
+  TEST_CHECK(findKey(tree, key, &rid));
+  ASSERT_EQUALS_RID(ridFor(numInts / 2 * numStrings + 4), rid, "long string cut");
+  key[1].v.stringV = "abcd";
+  ASSERT_ERROR(findKey(tree, key, &rid), "only the whole string matches");
+
+  // batched lookups take the values of one key after the other
+  for(i = 0; i < numStrings; i++)
+    {
+      batch[2 * i].dt = DT_INT;
+      batch[2 * i].v.intV = 3;
+      batch[2 * i + 1].dt = DT_STRING;
+      batch[2 * i + 1].v.stringV = strings[numStrings - 1 - i];
+    }
+  TEST_CHECK(findKeys(tree, batch, numStrings, rids));
+  for(i = 0; i < numStrings; i++)
+    ASSERT_EQUALS_RID(ridFor((numInts / 2 + 3) * numStrings + numStrings - 1 - i), rids[i], "batched composite lookup");
+
+  // a scan returns the keys sorted by int, then by string
+  TEST_CHECK(openTreeScan(tree, &sc));
+  for(i = 0; (rc = nextEntry(sc, &rid)) == RC_OK; i++)
+    ASSERT_EQUALS_RID(ridFor(i), rid, "scan in composite key order");
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "scan ended");
+  ASSERT_EQUALS_INT(numInserts, i, "scan saw every key");
+  TEST_CHECK(closeTreeScan(sc));
+
+  key[1].dt = DT_INT;
+  ASSERT_ERROR(findKey(tree, key, &rid), "values must match the key attributes");
+
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+  freeSchema(schema);
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testNormalizedSort (void)
+{
+  float floats[] = { -3.5, 2.25, -0.0, 0.0, -100, 7, 2.25, -3.5 };
+  int numRecords = 8, keySize = 4 + 4;
+  int attrs[] = { 2, 0 };
+  Schema *schema = compositeSchema();
+  char *keys = (char *) malloc(numRecords * keySize);
+  Record *r;
+  Value *v, val;
+  int i;
+
+  testName = "test sorting records by normalized keys";
+
+  TEST_CHECK(createRecord(&r, schema));
+  val.dt = DT_STRING;
+  val.v.stringV = "s";
+  TEST_CHECK(setAttr(r, schema, 1, &val));
+  for(i = 0; i < numRecords; i++)
+    {
+      val.dt = DT_FLOAT;
+      val.v.floatV = floats[i];
+      TEST_CHECK(setAttr(r, schema, 2, &val));
+      val.dt = DT_INT;
+      val.v.intV = numRecords - i;
+      TEST_CHECK(setAttr(r, schema, 0, &val));
+      TEST_CHECK(normalizeRecordKey(schema, r, 2, attrs, keys + i * keySize));
+    }
+  ASSERT_EQUALS_INT(keySize, normKeyAttrSize(DT_FLOAT, 0) + normKeyAttrSize(DT_INT, 0), "key size");
+
+  // memcmp order is (c, a) order
+  qsort(keys, numRecords, keySize, compareNormKeys);
+  for(i = 1; i < numRecords; i++)
+    {
+      Value *prevC, *prevA, *a;
+      TEST_CHECK(denormalizeValue(keys + (i - 1) * keySize, DT_FLOAT, 0, &prevC));
+      TEST_CHECK(denormalizeValue(keys + (i - 1) * keySize + 4, DT_INT, 0, &prevA));
+      TEST_CHECK(denormalizeValue(keys + i * keySize, DT_FLOAT, 0, &v));
+      TEST_CHECK(denormalizeValue(keys + i * keySize + 4, DT_INT, 0, &a));
+      ASSERT_TRUE(prevC->v.floatV < v->v.floatV
+		  || (prevC->v.floatV == v->v.floatV && prevA->v.intV < a->v.intV),
+		  "sorted by c, then a");
+      freeVal(prevC);
+      freeVal(prevA);
+      freeVal(v);
+      freeVal(a);
+    }
+
+  // -0.0 and 0.0 have the same key
+  val.dt = DT_FLOAT;
+  val.v.floatV = -0.0;
+  TEST_CHECK(normalizeValue(&val, 0, keys));
+  val.v.floatV = 0.0;
+  TEST_CHECK(normalizeValue(&val, 0, keys + 4));
+  ASSERT_TRUE(memcmp(keys, keys + 4, 4) == 0, "signed zeros are equal");
+
+  freeRecord(r);
+  freeSchema(schema);
+  free(keys);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testNormKeyRange (void)
+{
+  Schema *schema = compositeSchema();
+  char low[4], high[4], key[4];
+  NK_Range range = { .low = low, .high = high };
+  Expr *cond;
+  Value val;
+
+  testName = "test ranges of an attribute from a condition";
+
+  // NOT (a < 3) AND (a < 10 AND NOT (12 < a)) is 3 <= a < 10
+  cond = combine(combine(compare(0, "i3", OP_COMP_SMALLER), NULL, OP_BOOL_NOT),
+		 combine(compare(0, "i10", OP_COMP_SMALLER),
+			 combine(compareConstant("i12", 0, OP_COMP_SMALLER), NULL, OP_BOOL_NOT), OP_BOOL_AND),
+		 OP_BOOL_AND);
+  TEST_CHECK(normKeyRange(schema, 0, cond, &range));
+  val.dt = DT_INT;
+  val.v.intV = 3;
+  TEST_CHECK(normalizeValue(&val, 0, key));
+  ASSERT_TRUE(range.hasLow && !range.lowStrict && memcmp(low, key, 4) == 0, "low bound 3, included");
+  val.v.intV = 10;
+  TEST_CHECK(normalizeValue(&val, 0, key));
+  ASSERT_TRUE(range.hasHigh && range.highStrict && memcmp(high, key, 4) == 0, "high bound 10, excluded");
+
+  // the range of another attribute is not bounded
+  TEST_CHECK(normKeyRange(schema, 2, cond, &range));
+  ASSERT_TRUE(!range.hasLow && !range.hasHigh, "other attribute unbounded");
+
+  // under OR the condition does not bound a; an equality bounds it on both sides
+  freeExpr(cond);
+  cond = combine(compare(0, "i3", OP_COMP_SMALLER), compareConstant("i10", 0, OP_COMP_SMALLER), OP_BOOL_OR);
+  TEST_CHECK(normKeyRange(schema, 0, cond, &range));
+  ASSERT_TRUE(!range.hasLow && !range.hasHigh, "OR unbounded");
+  freeExpr(cond);
+  cond = combine(compareConstant("i7", 0, OP_COMP_EQUAL), compareConstant("i5", 0, OP_COMP_SMALLER), OP_BOOL_AND);
+  TEST_CHECK(normKeyRange(schema, 0, cond, &range));
+  val.v.intV = 7;
+  TEST_CHECK(normalizeValue(&val, 0, key));
+  ASSERT_TRUE(range.hasLow && range.hasHigh && !range.lowStrict && !range.highStrict
+	      && memcmp(low, key, 4) == 0 && memcmp(high, key, 4) == 0, "7 = a AND 5 < a is a = 7");
+  freeExpr(cond);
+
+  freeSchema(schema);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testBloomFilter (void)
+{
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+  int numInserts = 20000, numLookups = 64;
+  int *permute = createPermutation(numInserts);
+  Value key, keys[64];
+  RID rid, rids[64];
+  int i, size, reopenedSize, rc;
+
+  testName = "test the bloom filter of absent keys";
+
+  TEST_CHECK(createBtree("testidx", DT_INT, 16));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+  TEST_CHECK(getFilterSize(tree, &size));
+  ASSERT_TRUE(size > 0, "an empty tree has a filter");
+
+  // the filter grows with the keys
+  key.dt = DT_INT;
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = permute[i] * 2;
+      TEST_CHECK(insertKey(tree, &key, ridFor(key.v.intV)));
+    }
+  TEST_CHECK(getFilterSize(tree, &size));
+  ASSERT_TRUE(size * 8 >= numInserts * 10, "ten bits per key");
+
+  // no key in the tree is ruled out
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = i * 2;
+      if (findKey(tree, &key, &rid) != RC_OK || rid.page != i * 2)
+        break;
+    }
+  ASSERT_EQUALS_INT(numInserts, i, "every key found");
+  for(i = 0; i < numInserts; i += 101)
+    {
+      key.v.intV = i * 2 + 1;
+      rc = findKey(tree, &key, &rid);
+      ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, rc, "absent key");
+    }
+  key.v.intV = -5;
+  TEST_CHECK(openKeyScan(tree, &key, &sc));
+  rc = nextEntry(sc, &rid);
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "scan of an absent key is empty");
+  TEST_CHECK(closeTreeScan(sc));
+  rc = deleteKey(tree, &key);
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, rc, "absent key not deleted");
+
+  // batched lookups mixing present and absent keys
+  for(i = 0; i < numLookups; i++)
+    {
+      keys[i].dt = DT_INT;
+      keys[i].v.intV = i * 3;
+    }
+  TEST_CHECK(findKeys(tree, keys, numLookups, rids));
+  for(i = 0; i < numLookups; i++)
+    if (i % 2 == 0)
+      ASSERT_EQUALS_RID(ridFor(i * 3), rids[i], "batched lookup of a key");
+    else
+      ASSERT_TRUE(rids[i].page == -1 && rids[i].slot == -1, "batched lookup of an absent key");
+
+  // the filter comes back from the index file
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+  TEST_CHECK(getFilterSize(tree, &reopenedSize));
+  ASSERT_EQUALS_INT(size, reopenedSize, "filter size after reopen");
+  for(i = 0; i < numInserts; i += 3)
+    {
+      key.v.intV = i * 2;
+      TEST_CHECK(deleteKey(tree, &key));
+    }
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = i * 2;
+      rc = findKey(tree, &key, &rid);
+      if (rc != (i % 3 == 0 ? RC_IM_KEY_NOT_FOUND : RC_OK))
+        break;
+    }
+  ASSERT_EQUALS_INT(numInserts, i, "deleted keys gone, the others found");
+
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+// schema (a INT, b STRING(8), c FLOAT)
+Schema *
+compositeSchema (void)
+{
+  char *names[] = { "a", "b", "c" };
+  DataType dt[] = { DT_INT, DT_STRING, DT_FLOAT };
+  int sizes[] = { 0, 8, 0 };
+  char **cpNames = (char **) malloc(sizeof(char*) * 3);
+  DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
+  int *cpSizes = (int *) malloc(sizeof(int) * 3);
+  int *cpKeys = (int *) malloc(sizeof(int));
+  int i;
+
+  for(i = 0; i < 3; i++)
+    cpNames[i] = strdup(names[i]);
+  memcpy(cpDt, dt, sizeof(DataType) * 3);
+  memcpy(cpSizes, sizes, sizeof(int) * 3);
+  cpKeys[0] = 0;
+
+  return createSchema(3, cpNames, cpDt, cpSizes, 1, cpKeys);
+}
+
+// ************************************************************
+int
+compareNormKeys (const void *a, const void *b)
+{
+  return memcmp(a, b, 4 + 4);
+}
+
+// ************************************************************
+int
+countKey (BTreeHandle *tree, int key, int step)
+{
+  BT_ScanHandle *sc = NULL;
+  Value k;
+  RID rid;
+  int j = 0, count = 0;
+
+  k.dt = DT_INT;
+  k.v.intV = key;
+  TEST_CHECK(openKeyScan(tree, &k, &sc));
+  while(nextEntry(sc, &rid) == RC_OK)
+    {
+      // with step 3, RIDs 0, 3, 6, ... were deleted
+      if (step == 3 && j % 3 == 0)
+	j++;
+      ASSERT_EQUALS_RID(dupRid(key, j), rid, "RIDs of a key in order");
+      j++;
+      count++;
+    }
+  TEST_CHECK(closeTreeScan(sc));
+  return count;
+}
+
+// ************************************************************
+RID
+dupRid (int key, int j)
+{
+  RID rid;
+
+  rid.page = key * 10000 + j / 5;
+  rid.slot = j % 5;
+  return rid;
+}
@@ -0,0 +1,237 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dberror.h"
+#include "expr.h"
+#include "betree_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+#include "test_util.h"
+
+#define ASSERT_EQUALS_RID(_l,_r, message)				\
+  do {									\
+    ASSERT_TRUE((_l).page == (_r).page && (_l).slot == (_r).slot, message); \
+  } while(0)
+
+// test methods
+static void testRandomInserts (void);
+static void testDeletesAndUpdates (void);
+static void testFloatKeys (void);
+static void testErrors (void);
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  testName = "";
+
+  testRandomInserts();
+  testDeletesAndUpdates();
+  testFloatKeys();
+  testErrors();
+
+  return 0;
+}
+
+// ************************************************************
+void
+testRandomInserts (void)
+{
+  BE_TreeHandle *tree = NULL;
+  BE_ScanHandle *sc = NULL;
+  int numInserts = 20000;
+  int *permute = createPermutation(numInserts);
+  int i, height, nodes, rc;
+  Value key;
+  RID rid;
+
+  testName = "test random inserts into a buffered tree";
+
+  TEST_CHECK(createBeTree("testidx", DT_INT, 8));
+  TEST_CHECK(openBeTree(&tree, "testidx"));
+
+  key.dt = DT_INT;
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = permute[i];
+      TEST_CHECK(beInsertKey(tree, &key, ridFor(permute[i])));
+    }
+  TEST_CHECK(getBeHeight(tree, &height));
+  ASSERT_TRUE(height >= 3, "buffers were flushed down more than one level");
+
+  // lookups see keys whether they are still buffered or in a leaf
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = i;
+      TEST_CHECK(beFindKey(tree, &key, &rid));
+      ASSERT_EQUALS_RID(ridFor(i), rid, "found the key");
+    }
+  key.v.intV = numInserts;
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, beFindKey(tree, &key, &rid), "missing key");
+
+  // buffers survive closing the tree
+  TEST_CHECK(closeBeTree(tree));
+  TEST_CHECK(openBeTree(&tree, "testidx"));
+  for(i = 0; i < numInserts; i += 7)
+    {
+      key.v.intV = i;
+      TEST_CHECK(beFindKey(tree, &key, &rid));
+      ASSERT_EQUALS_RID(ridFor(i), rid, "found the key after reopening");
+    }
+
+  TEST_CHECK(openBeTreeScan(tree, &sc));
+  for(i = 0; (rc = beNextEntry(sc, &rid)) == RC_OK; i++)
+    ASSERT_EQUALS_RID(ridFor(i), rid, "scan in key order");
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "scan ended");
+  ASSERT_EQUALS_INT(numInserts, i, "scan saw every key");
+  TEST_CHECK(closeBeTreeScan(sc));
+
+  // a flushed tree has every entry in a leaf: about 340 per leaf
+  TEST_CHECK(getBeNumNodes(tree, &nodes));
+  ASSERT_TRUE(nodes >= numInserts / 340 && nodes < numInserts / 100, "leaves are well filled");
+
+  TEST_CHECK(closeBeTree(tree));
+  TEST_CHECK(deleteBeTree("testidx"));
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testDeletesAndUpdates (void)
+{
+  BE_TreeHandle *tree = NULL;
+  BE_ScanHandle *sc = NULL;
+  int numInserts = 8000;
+  int *permute = createPermutation(numInserts);
+  int i, count, rc;
+  Value key;
+  RID rid, moved;
+
+  testName = "test deletes and updates in a buffered tree";
+
+  TEST_CHECK(createBeTree("testidx", DT_INT, 4));
+  TEST_CHECK(openBeTree(&tree, "testidx"));
+
+  key.dt = DT_INT;
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = permute[i];
+      TEST_CHECK(beInsertKey(tree, &key, ridFor(permute[i])));
+    }
+
+  // delete the even keys, give every key divisible by 3 a new RID
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = permute[i];
+      if (permute[i] % 2 == 0)
+	TEST_CHECK(beDeleteKey(tree, &key));
+    }
+  moved.page = -5;
+  for(i = 0; i < numInserts; i += 3)
+    {
+      key.v.intV = i;
+      moved.slot = i;
+      TEST_CHECK(beInsertKey(tree, &key, moved));
+    }
+  key.v.intV = numInserts + 1;
+  TEST_CHECK(beDeleteKey(tree, &key));
+
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = i;
+      rc = beFindKey(tree, &key, &rid);
+      if (i % 3 == 0)
+	{
+	  moved.slot = i;
+	  ASSERT_EQUALS_INT(RC_OK, rc, "updated key found");
+	  ASSERT_EQUALS_RID(moved, rid, "newest RID wins");
+	}
+      else if (i % 2 == 0)
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, rc, "deleted key gone");
+      else
+	{
+	  ASSERT_EQUALS_INT(RC_OK, rc, "kept key found");
+	  ASSERT_EQUALS_RID(ridFor(i), rid, "kept key has its RID");
+	}
+    }
+
+  TEST_CHECK(openBeTreeScan(tree, &sc));
+  for(count = 0; beNextEntry(sc, &rid) == RC_OK; count++);
+  TEST_CHECK(closeBeTreeScan(sc));
+  ASSERT_EQUALS_INT(numInserts / 2 + (numInserts + 5) / 6, count, "odd keys and multiples of 6 remain");
+
+  TEST_CHECK(closeBeTree(tree));
+  TEST_CHECK(deleteBeTree("testidx"));
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testFloatKeys (void)
+{
+  BE_TreeHandle *tree = NULL;
+  BE_ScanHandle *sc = NULL;
+  int numInserts = 3000;
+  int *permute = createPermutation(numInserts);
+  int i, rc;
+  Value key;
+  RID rid;
+
+  testName = "test float keys in a buffered tree";
+
+  TEST_CHECK(createBeTree("testidx", DT_FLOAT, 16));
+  TEST_CHECK(openBeTree(&tree, "testidx"));
+
+  // keys from -1500 to 1499.5: the scan order crosses zero
+  key.dt = DT_FLOAT;
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.floatV = (permute[i] - numInserts / 2) + 0.5f * (permute[i] % 2);
+      TEST_CHECK(beInsertKey(tree, &key, ridFor(permute[i])));
+    }
+
+  TEST_CHECK(openBeTreeScan(tree, &sc));
+  for(i = 0; (rc = beNextEntry(sc, &rid)) == RC_OK; i++)
+    ASSERT_EQUALS_RID(ridFor(i), rid, "floats in order");
+  ASSERT_EQUALS_INT(numInserts, i, "scan saw every key");
+  TEST_CHECK(closeBeTreeScan(sc));
+
+  TEST_CHECK(closeBeTree(tree));
+  TEST_CHECK(deleteBeTree("testidx"));
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testErrors (void)
+{
+  BE_TreeHandle *tree = NULL;
+  Value key;
+  RID rid;
+
+  testName = "test errors of the buffered tree";
+
+  ASSERT_ERROR(createBeTree("testidx", DT_INT, 2), "fanout too small");
+  ASSERT_ERROR(createBeTree("testidx", DT_INT, 500), "fanout too large for the buffer");
+  ASSERT_ERROR(createBeTree("testidx", DT_STRING, 8), "string keys");
+
+  TEST_CHECK(createBeTree("testidx", DT_INT, 8));
+  TEST_CHECK(openBeTree(&tree, "testidx"));
+  key.dt = DT_FLOAT;
+  key.v.floatV = 1.0;
+  ASSERT_ERROR(beInsertKey(tree, &key, ridFor(1)), "key of the wrong type");
+  ASSERT_ERROR(beFindKey(tree, &key, &rid), "key of the wrong type");
+  TEST_CHECK(closeBeTree(tree));
+  TEST_CHECK(deleteBeTree("testidx"));
+
+  TEST_DONE();
+}
@@ -0,0 +1,445 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dberror.h"
+#include "expr.h"
+#include "bitmap_mgr.h"
+#include "record_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+#include "test_util.h"
+
+#define TEST_TABLE "test_table_bi"
+#define NUM_COLORS 5
+
+// test methods
+static void testBitmapScans (void);
+static void testDenseBitmaps (void);
+static void testLsmTable (void);
+static void testErrors (void);
+
+// helper methods
+static Schema *testSchema (void);
+static void fillTable (RM_TableData *table, int n, RID *rids);
+static void nthRow (Record *r, Schema *schema, int id);
+static void setRow (Record *r, Schema *schema, int id, int color, int size);
+static void checkCount (RM_TableData *table, Expr *cond, int (*pred)(int id), int n, bool fromBitmaps);
+
+// state of the rows of the test table
+static char *colors[NUM_COLORS] = { "red", "green", "blue", "white", "black" };
+static int *rowColor;
+static int *rowSize;
+static bool *rowAlive;
+
+// conditions of the tests
+static int redAndSize3 (int id) { return rowColor[id] == 0 && rowSize[id] == 3; }
+static int blueOrNotSmall (int id) { return rowColor[id] == 2 || !(rowSize[id] < 5); }
+static int greenAndLowId (int id) { return rowColor[id] == 1 && id < 100; }
+static int largeAndNotWhite (int id) { return 4 < rowSize[id] && rowColor[id] != 3; }
+static int isRed (int id) { return rowColor[id] == 0; }
+static int notRed (int id) { return rowColor[id] != 0; }
+static int isSmall (int id) { return rowSize[id] == 0; }
+static int noRow (int id) { return 0; }
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  testName = "";
+
+  initRecordManager(NULL);
+  testBitmapScans();
+  testDenseBitmaps();
+  testLsmTable();
+  testErrors();
+  shutdownRecordManager();
+
+  return 0;
+}
+
+// ************************************************************
+void
+testBitmapScans (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  BI_IndexHandle *byColor = NULL, *bySize = NULL;
+  int numRows = 10000;
+  RID *rids = (RID *) malloc(numRows * sizeof(RID));
+  Record *r;
+  Expr *cond;
+  int i, values, count, rc;
+
+  testName = "test scans narrowed by bitmap indexes";
+
+  TEST_CHECK(createTable(TEST_TABLE, testSchema()));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, numRows, rids);
+  TEST_CHECK(createBitmapIndex("test_bi_color", table, 1));
+  TEST_CHECK(createBitmapIndex("test_bi_size", table, 2));
+  TEST_CHECK(openBitmapIndex(&byColor, "test_bi_color", table));
+  TEST_CHECK(openBitmapIndex(&bySize, "test_bi_size", table));
+  TEST_CHECK(getBINumValues(byColor, &values));
+  ASSERT_EQUALS_INT(NUM_COLORS, values, "one bitmap per color");
+  TEST_CHECK(getBINumValues(bySize, &values));
+  ASSERT_EQUALS_INT(7, values, "one bitmap per size");
+
+  // color = 'red' AND size = 3
+  cond = combine(compare(1, "sred", OP_COMP_EQUAL), compare(2, "i3", OP_COMP_EQUAL), OP_BOOL_AND);
+  checkCount(table, cond, redAndSize3, numRows, true);
+  freeExpr(cond);
+
+  // color = 'blue' OR NOT (size < 5)
+  cond = combine(compare(2, "i5", OP_COMP_SMALLER), NULL, OP_BOOL_NOT);
+  cond = combine(compare(1, "sblue", OP_COMP_EQUAL), cond, OP_BOOL_OR);
+  checkCount(table, cond, blueOrNotSmall, numRows, true);
+  freeExpr(cond);
+
+  // the id has no index, so the bitmaps only narrow the scan
+  cond = combine(compare(1, "sgreen", OP_COMP_EQUAL), compare(0, "i100", OP_COMP_SMALLER), OP_BOOL_AND);
+  checkCount(table, cond, greenAndLowId, numRows, false);
+  rc = biCountMatches(table, cond, &count);
+  ASSERT_EQUALS_INT(RC_INVALID_ARGS, rc, "unindexed attribute");
+  freeExpr(cond);
+
+  // no record has these colors; the second is longer than the attribute
+  cond = compare(1, "spurple", OP_COMP_EQUAL);
+  checkCount(table, cond, noRow, numRows, true);
+  freeExpr(cond);
+  cond = compare(1, "sgreenish", OP_COMP_EQUAL);
+  checkCount(table, cond, noRow, numRows, true);
+  freeExpr(cond);
+
+  // deletes and updates reach the bitmaps
+  for(i = 0; i < numRows; i += 3)
+    {
+      TEST_CHECK(deleteRecord(table, rids[i]));
+      rowAlive[i] = false;
+    }
+  TEST_CHECK(createRecord(&r, table->schema));
+  for(i = 1; i < numRows; i += 3)
+    if (rowColor[i] == 4)
+      {
+        setRow(r, table->schema, i, 0, 6 - rowSize[i]);
+        r->id = rids[i];
+        TEST_CHECK(updateRecord(table, r));
+      }
+  freeRecord(r);
+  cond = combine(compare(1, "sred", OP_COMP_EQUAL), compare(2, "i3", OP_COMP_EQUAL), OP_BOOL_AND);
+  checkCount(table, cond, redAndSize3, numRows, true);
+  freeExpr(cond);
+
+  // 4 < size AND NOT color = 'white'
+  cond = combine(compare(1, "swhite", OP_COMP_EQUAL), NULL, OP_BOOL_NOT);
+  cond = combine(compareConstant("i4", 2, OP_COMP_SMALLER), cond, OP_BOOL_AND);
+  checkCount(table, cond, largeAndNotWhite, numRows, true);
+  freeExpr(cond);
+
+  // the bitmaps survive closing the indexes
+  TEST_CHECK(closeBitmapIndex(byColor));
+  TEST_CHECK(closeBitmapIndex(bySize));
+  TEST_CHECK(openBitmapIndex(&byColor, "test_bi_color", table));
+  TEST_CHECK(openBitmapIndex(&bySize, "test_bi_size", table));
+  cond = combine(compare(1, "sred", OP_COMP_EQUAL), compare(2, "i3", OP_COMP_EQUAL), OP_BOOL_AND);
+  checkCount(table, cond, redAndSize3, numRows, true);
+  freeExpr(cond);
+
+  TEST_CHECK(closeBitmapIndex(byColor));
+  TEST_CHECK(closeBitmapIndex(bySize));
+  TEST_CHECK(deleteBitmapIndex("test_bi_color"));
+  TEST_CHECK(deleteBitmapIndex("test_bi_size"));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(rids);
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testDenseBitmaps (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  BI_IndexHandle *byColor = NULL;
+  int numRows = 20000;
+  RID *rids = (RID *) malloc(numRows * sizeof(RID));
+  Expr *cond;
+  int i, denseSize, sparseSize;
+
+  testName = "test bitmaps holding most of the records";
+
+  TEST_CHECK(createTable(TEST_TABLE, testSchema()));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, numRows, rids);
+  TEST_CHECK(createBitmapIndex("test_bi_color", table, 1));
+  TEST_CHECK(openBitmapIndex(&byColor, "test_bi_color", table));
+
+  // three quarters of the records turn red, more than an array holds
+  for(i = 0; i < numRows; i++)
+    if (i < 3 * numRows / 4 && rowColor[i] != 0)
+      {
+        Record *r;
+        TEST_CHECK(createRecord(&r, table->schema));
+        setRow(r, table->schema, i, 0, rowSize[i]);
+        r->id = rids[i];
+        TEST_CHECK(updateRecord(table, r));
+        freeRecord(r);
+      }
+  cond = compare(1, "sred", OP_COMP_EQUAL);
+  checkCount(table, cond, isRed, numRows, true);
+  TEST_CHECK(getBISize(byColor, &denseSize));
+  ASSERT_TRUE(denseSize < numRows * (int) sizeof(RID), "bit sets are smaller than a list of RIDs");
+
+  // deleting most of them goes back to arrays
+  for(i = 0; i < 3 * numRows / 4 - 1000; i++)
+    {
+      TEST_CHECK(deleteRecord(table, rids[i]));
+      rowAlive[i] = false;
+    }
+  checkCount(table, cond, isRed, numRows, true);
+  TEST_CHECK(getBISize(byColor, &sparseSize));
+  ASSERT_TRUE(sparseSize < denseSize, "fewer records take fewer bytes");
+  freeExpr(cond);
+
+  cond = combine(compare(1, "sred", OP_COMP_EQUAL), NULL, OP_BOOL_NOT);
+  checkCount(table, cond, notRed, numRows, true);
+  freeExpr(cond);
+
+  TEST_CHECK(closeBitmapIndex(byColor));
+  TEST_CHECK(deleteBitmapIndex("test_bi_color"));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(rids);
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testLsmTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  BI_IndexHandle *byColor = NULL;
+  RM_TableOptions options;
+  int numRows = 3000;
+  RID *rids = (RID *) malloc(numRows * sizeof(RID));
+  Record *r;
+  Expr *cond;
+  int i;
+
+  testName = "test a bitmap index on an LSM table";
+
+  memset(&options, 0, sizeof(options));
+  options.engine = RM_ENGINE_LSM;
+  options.memtableSize = 4096;
+  TEST_CHECK(createTableWithOptions(TEST_TABLE, testSchema(), &options));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, numRows, rids);
+  TEST_CHECK(createBitmapIndex("test_bi_color", table, 1));
+  TEST_CHECK(openBitmapIndex(&byColor, "test_bi_color", table));
+
+  cond = compare(1, "sred", OP_COMP_EQUAL);
+  checkCount(table, cond, isRed, numRows, true);
+  for(i = 0; i < numRows; i += 4)
+    {
+      TEST_CHECK(deleteRecord(table, rids[i]));
+      rowAlive[i] = false;
+    }
+  TEST_CHECK(createRecord(&r, table->schema));
+  for(i = 1; i < numRows; i += 4)
+    {
+      setRow(r, table->schema, i, 0, rowSize[i]);
+      r->id = rids[i];
+      TEST_CHECK(updateRecord(table, r));
+    }
+  freeRecord(r);
+  checkCount(table, cond, isRed, numRows, true);
+  freeExpr(cond);
+
+  // without an index on the size the scan reads every record
+  cond = compare(2, "i0", OP_COMP_EQUAL);
+  checkCount(table, cond, isSmall, numRows, false);
+  freeExpr(cond);
+
+  TEST_CHECK(closeBitmapIndex(byColor));
+  TEST_CHECK(deleteBitmapIndex("test_bi_color"));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(rids);
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testErrors (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  BI_IndexHandle *index = NULL;
+  RM_TableOptions options;
+  RM_ScanHandle scan;
+  RID rids[10];
+  Record *r;
+  Expr *cond;
+  int count, rc;
+
+  testName = "test errors of the bitmap index";
+
+  TEST_CHECK(createTable(TEST_TABLE, testSchema()));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, 10, rids);
+
+  rc = createBitmapIndex("test_bi_score", table, 3);
+  ASSERT_EQUALS_INT(RC_RM_UNKNOWN_DATATYPE, rc, "FLOAT attribute");
+  rc = createBitmapIndex("test_bi_none", table, 4);
+  ASSERT_EQUALS_INT(RC_INVALID_ATTR_NUM, rc, "attribute out of the schema");
+  ASSERT_ERROR(openBitmapIndex(&index, "test_bi_none", table), "index never created");
+
+  cond = compare(1, "sred", OP_COMP_EQUAL);
+  rc = biCountMatches(table, cond, &count);
+  ASSERT_EQUALS_INT(RC_INVALID_ARGS, rc, "no bitmap index open on the table");
+  freeExpr(cond);
+
+  // an empty table makes an empty index
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  TEST_CHECK(createTable(TEST_TABLE, testSchema()));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, 0, rids);
+  TEST_CHECK(createBitmapIndex("test_bi_color", table, 1));
+  TEST_CHECK(openBitmapIndex(&index, "test_bi_color", table));
+  cond = combine(compare(1, "sred", OP_COMP_EQUAL), NULL, OP_BOOL_NOT);
+  checkCount(table, cond, noRow, 0, true);
+  freeExpr(cond);
+  TEST_CHECK(closeBitmapIndex(index));
+  TEST_CHECK(deleteBitmapIndex("test_bi_color"));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+
+  // an update the table refuses, a duplicate key of a clustered table,
+  // leaves the index as it was
+  memset(&options, 0, sizeof(options));
+  options.engine = RM_ENGINE_CLUSTERED;
+  TEST_CHECK(createTableWithOptions(TEST_TABLE, testSchema(), &options));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, 10, rids);
+  TEST_CHECK(createBitmapIndex("test_bi_color", table, 1));
+  TEST_CHECK(openBitmapIndex(&index, "test_bi_color", table));
+  TEST_CHECK(createRecord(&r, table->schema));
+  setRow(r, table->schema, 2, 2, 2);
+  r->id = rids[1];
+  ASSERT_ERROR(updateRecord(table, r), "duplicate key");
+  freeRecord(r);
+  cond = compare(1, "sgreen", OP_COMP_EQUAL);
+  checkCount(table, cond, greenAndLowId, 10, true);
+
+  // a truncate refused while a scan driven by the index is open leaves
+  // the index as it was too
+  TEST_CHECK(startScan(table, &scan, cond));
+  ASSERT_ERROR(truncateTable(table), "no truncate while a scan is open");
+  TEST_CHECK(closeScan(&scan));
+  checkCount(table, cond, greenAndLowId, 10, true);
+  freeExpr(cond);
+  TEST_CHECK(closeBitmapIndex(index));
+  TEST_CHECK(deleteBitmapIndex("test_bi_color"));
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+// id INT, color STRING(8), size INT, score FLOAT
+Schema *
+testSchema (void)
+{
+  char *names[] = { "id", "color", "size", "score" };
+  DataType dt[] = { DT_INT, DT_STRING, DT_INT, DT_FLOAT };
+  int sizes[] = { 0, 8, 0, 0 };
+
+  return makeTestSchema(4, names, dt, sizes);
+}
+
+// ************************************************************
+// insert records 0 .. n-1, with color id % 5 and size id % 7
+void
+fillTable (RM_TableData *table, int n, RID *rids)
+{
+  int i;
+
+  free(rowColor);
+  free(rowSize);
+  free(rowAlive);
+  rowColor = (int *) malloc((n + 1) * sizeof(int));
+  rowSize = (int *) malloc((n + 1) * sizeof(int));
+  rowAlive = (bool *) malloc((n + 1) * sizeof(bool));
+
+  insertRows(table, n, rids, nthRow);
+  for(i = 0; i < n; i++)
+    rowAlive[i] = true;
+}
+
+// ************************************************************
+// row id of a filled table
+void
+nthRow (Record *r, Schema *schema, int id)
+{
+  setRow(r, schema, id, id % NUM_COLORS, id % 7);
+}
+
+// ************************************************************
+void
+setRow (Record *r, Schema *schema, int id, int color, int size)
+{
+  setIntAttr(r, schema, 0, id);
+  setStringAttr(r, schema, 1, colors[color]);
+  setIntAttr(r, schema, 2, size);
+  setFloatAttr(r, schema, 3, id / 2.0);
+  rowColor[id] = color;
+  rowSize[id] = size;
+}
+
+// ************************************************************
+// a scan with cond, and the bitmaps alone if fromBitmaps is set, find the
+// live records 0 .. n-1 that satisfy pred
+void
+checkCount (RM_TableData *table, Expr *cond, int (*pred)(int id), int n, bool fromBitmaps)
+{
+  RM_ScanHandle scan;
+  Record *r;
+  Value *v;
+  int i, rc, expected = 0, found = 0, wrong = 0, count;
+
+  for(i = 0; i < n; i++)
+    if (rowAlive[i] && pred(i))
+      expected++;
+
+  TEST_CHECK(createRecord(&r, table->schema));
+  TEST_CHECK(startScan(table, &scan, cond));
+  while((rc = next(&scan, r)) == RC_OK)
+    {
+      TEST_CHECK(getAttr(r, table->schema, 0, &v));
+      if (!rowAlive[v->v.intV] || !pred(v->v.intV))
+        wrong++;
+      found++;
+      freeVal(v);
+    }
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ended");
+  TEST_CHECK(closeScan(&scan));
+  freeRecord(r);
+  ASSERT_EQUALS_INT(expected, found, "scan finds the matching records");
+  ASSERT_EQUALS_INT(0, wrong, "scan finds no other records");
+
+  if (fromBitmaps)
+    {
+      TEST_CHECK(biCountMatches(table, cond, &count));
+      ASSERT_EQUALS_INT(expected, count, "bitmaps count the matching records");
+    }
+}
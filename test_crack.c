@@ -0,0 +1,453 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dberror.h"
+#include "expr.h"
+#include "crack_mgr.h"
+#include "record_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+#include "test_util.h"
+
+#define TEST_TABLE "test_table_ck"
+#define MAX_VALUE 100000
+
+// test methods
+static void testConvergence (void);
+static void testUpdates (void);
+static void testFloatLsmTable (void);
+static void testErrors (void);
+
+// helper methods
+static Schema *testSchema (void);
+static void fillTable (RM_TableData *table, int n, RID *rids);
+static void randomRow (Record *r, Schema *schema, int id);
+static void setRow (Record *r, Schema *schema, int id, int value);
+static int nextRandom (void);
+static Expr *rangeQuery (int form, int low, int high);
+static void checkScan (RM_TableData *table, Expr *cond, int (*pred)(int id), int n);
+
+// state of the rows of the test table
+static int *rowValue;
+static bool *rowAlive;
+static unsigned int seed;
+
+// bounds of the query being checked
+static int qLow, qHigh;
+
+// conditions of the tests
+static int inRange (int id) { return qLow <= rowValue[id] && rowValue[id] < qHigh; }
+static int aboveLow (int id) { return qLow < rowValue[id]; }
+static int equalsLow (int id) { return rowValue[id] == qLow; }
+static int scoreInRange (int id) { return qLow <= id / 2.0 && id / 2.0 <= qHigh; }
+static int scoreAndLowId (int id) { return qLow < id / 2.0 && id < qHigh; }
+static int outsideRange (int id) { return rowValue[id] < qLow || qHigh <= rowValue[id]; }
+static int notEqualsLow (int id) { return rowValue[id] != qLow; }
+static int lowId (int id) { return id < 5; }
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  testName = "";
+
+  initRecordManager(NULL);
+  testConvergence();
+  testUpdates();
+  testFloatLsmTable();
+  testErrors();
+  shutdownRecordManager();
+
+  return 0;
+}
+
+// ************************************************************
+void
+testConvergence (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  CK_IndexHandle *index = NULL;
+  int numRows = 20000, numQueries = 200;
+  RID *rids = (RID *) malloc(numRows * sizeof(RID));
+  Expr *cond;
+  int i, pieces, touched, firstTouched, midTouched;
+
+  testName = "test range queries converging on an index";
+
+  TEST_CHECK(createTable(TEST_TABLE, testSchema()));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, numRows, rids);
+  TEST_CHECK(openCrackerIndex(&index, table, 1));
+  TEST_CHECK(getCKNumPieces(index, &pieces));
+  ASSERT_EQUALS_INT(0, pieces, "nothing built before the first query");
+
+  for(i = 0; i < numQueries; i++)
+    {
+      qLow = nextRandom() % MAX_VALUE;
+      qHigh = qLow + nextRandom() % (MAX_VALUE / 20);
+      cond = rangeQuery(i % 3, qLow, qHigh);
+      checkScan(table, cond, inRange, numRows);
+      freeExpr(cond);
+      if (i == 0)
+        TEST_CHECK(getCKNumTouched(index, &firstTouched));
+      if (i == numQueries / 2)
+        TEST_CHECK(getCKNumTouched(index, &midTouched));
+    }
+  ASSERT_TRUE(firstTouched >= numRows && firstTouched <= 2 * numRows, "the first query partitions the whole column");
+  TEST_CHECK(getCKNumTouched(index, &touched));
+  ASSERT_TRUE(touched - midTouched < numRows * (numQueries / 2) / 20, "later queries partition small pieces");
+  TEST_CHECK(getCKNumPieces(index, &pieces));
+  ASSERT_TRUE(pieces > numQueries, "every query leaves its bounds as cracks");
+
+  // bounds that are cracks already partition nothing
+  TEST_CHECK(getCKNumTouched(index, &midTouched));
+  cond = rangeQuery(0, qLow, qHigh);
+  checkScan(table, cond, inRange, numRows);
+  freeExpr(cond);
+  TEST_CHECK(getCKNumTouched(index, &touched));
+  ASSERT_EQUALS_INT(midTouched, touched, "repeated range");
+
+  // c < value, and value = c
+  qLow = rowValue[17];
+  cond = compareConstant("i0", 1, OP_COMP_SMALLER);
+  cond->expr.op->args[0]->expr.cons->v.intV = qLow;
+  checkScan(table, cond, aboveLow, numRows);
+  freeExpr(cond);
+  cond = compare(1, "i0", OP_COMP_EQUAL);
+  cond->expr.op->args[1]->expr.cons->v.intV = qLow;
+  checkScan(table, cond, equalsLow, numRows);
+  freeExpr(cond);
+
+  // an empty range, and NOT of a range the index cannot answer
+  qLow = 500;
+  qHigh = 400;
+  cond = rangeQuery(0, qLow, qHigh);
+  checkScan(table, cond, inRange, numRows);
+  freeExpr(cond);
+  qHigh = 600;
+  cond = combine(rangeQuery(0, qLow, qHigh), NULL, OP_BOOL_NOT);
+  checkScan(table, cond, outsideRange, numRows);
+  freeExpr(cond);
+
+  TEST_CHECK(closeCrackerIndex(index));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(rids);
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testUpdates (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  CK_IndexHandle *index = NULL;
+  int numRows = 5000;
+  RID *rids = (RID *) malloc((numRows + 1000) * sizeof(RID));
+  Record *r;
+  Expr *cond;
+  int i, round;
+
+  testName = "test inserts, deletes and updates on a cracked column";
+
+  TEST_CHECK(createTable(TEST_TABLE, testSchema()));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, numRows, rids);
+  TEST_CHECK(openCrackerIndex(&index, table, 1));
+
+  // crack the column into many pieces first
+  for(i = 0; i < 50; i++)
+    {
+      qLow = nextRandom() % MAX_VALUE;
+      qHigh = qLow + nextRandom() % (MAX_VALUE / 10);
+      cond = rangeQuery(i % 3, qLow, qHigh);
+      checkScan(table, cond, inRange, numRows);
+      freeExpr(cond);
+    }
+
+  TEST_CHECK(createRecord(&r, table->schema));
+  for(round = 0; round < 3; round++)
+    {
+      for(i = round; i < numRows; i += 7)
+        if (rowAlive[i])
+          {
+            TEST_CHECK(deleteRecord(table, rids[i]));
+            rowAlive[i] = false;
+          }
+      for(i = round + 3; i < numRows; i += 11)
+        if (rowAlive[i])
+          {
+            setRow(r, table->schema, i, nextRandom() % MAX_VALUE);
+            r->id = rids[i];
+            TEST_CHECK(updateRecord(table, r));
+          }
+      for(i = 0; i < 10; i++)
+        {
+          qLow = nextRandom() % MAX_VALUE;
+          qHigh = qLow + nextRandom() % (MAX_VALUE / 10);
+          cond = rangeQuery(i % 3, qLow, qHigh);
+          checkScan(table, cond, inRange, numRows);
+          freeExpr(cond);
+        }
+    }
+
+  // new records land in the pieces of their values
+  rowValue = (int *) realloc(rowValue, (numRows + 1000) * sizeof(int));
+  rowAlive = (bool *) realloc(rowAlive, (numRows + 1000) * sizeof(bool));
+  for(i = numRows; i < numRows + 1000; i++)
+    {
+      setRow(r, table->schema, i, nextRandom() % MAX_VALUE);
+      TEST_CHECK(insertRecord(table, r));
+      rids[i] = r->id;
+      rowAlive[i] = true;
+    }
+  freeRecord(r);
+  numRows += 1000;
+  for(i = 0; i < 20; i++)
+    {
+      qLow = nextRandom() % MAX_VALUE;
+      qHigh = qLow + nextRandom() % (MAX_VALUE / 10);
+      cond = rangeQuery(i % 3, qLow, qHigh);
+      checkScan(table, cond, inRange, numRows);
+      freeExpr(cond);
+    }
+  qLow = 0;
+  qHigh = MAX_VALUE;
+  cond = rangeQuery(0, qLow, qHigh);
+  checkScan(table, cond, inRange, numRows);
+  freeExpr(cond);
+
+  TEST_CHECK(closeCrackerIndex(index));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(rids);
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testFloatLsmTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  CK_IndexHandle *byScore = NULL;
+  RM_TableOptions options;
+  int numRows = 3000;
+  RID *rids = (RID *) malloc(numRows * sizeof(RID));
+  Expr *cond;
+  Value *v;
+  int i, pieces;
+
+  testName = "test a cracker index over a FLOAT attribute of an LSM table";
+
+  memset(&options, 0, sizeof(options));
+  options.engine = RM_ENGINE_LSM;
+  options.memtableSize = 4096;
+  TEST_CHECK(createTableWithOptions(TEST_TABLE, testSchema(), &options));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, numRows, rids);
+  TEST_CHECK(openCrackerIndex(&byScore, table, 2));
+
+  // NOT (score < low) AND NOT (high < score)
+  for(i = 0; i < 20; i++)
+    {
+      qLow = nextRandom() % (numRows / 2);
+      qHigh = qLow + nextRandom() % 100;
+      MAKE_VALUE(v, DT_FLOAT, (float) qLow);
+      cond = combine(compareValue(2, v, OP_COMP_SMALLER), NULL, OP_BOOL_NOT);
+      MAKE_VALUE(v, DT_FLOAT, (float) qHigh);
+      cond = combine(cond, combine(compareValueFirst(v, 2, OP_COMP_SMALLER), NULL, OP_BOOL_NOT), OP_BOOL_AND);
+      checkScan(table, cond, scoreInRange, numRows);
+      freeExpr(cond);
+    }
+
+  // low < score AND id < high: the id has no index, so the scan checks it
+  for(i = 0; i < numRows; i += 4)
+    {
+      TEST_CHECK(deleteRecord(table, rids[i]));
+      rowAlive[i] = false;
+    }
+  qLow = numRows / 8;
+  qHigh = numRows / 2;
+  MAKE_VALUE(v, DT_FLOAT, (float) qLow);
+  cond = compareValueFirst(v, 2, OP_COMP_SMALLER);
+  MAKE_VALUE(v, DT_INT, qHigh);
+  cond = combine(cond, compareValue(0, v, OP_COMP_SMALLER), OP_BOOL_AND);
+  checkScan(table, cond, scoreAndLowId, numRows);
+  freeExpr(cond);
+  TEST_CHECK(getCKNumPieces(byScore, &pieces));
+  ASSERT_TRUE(pieces > 20, "the float column is cracked");
+
+  TEST_CHECK(closeCrackerIndex(byScore));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(rids);
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testErrors (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  CK_IndexHandle *index = NULL;
+  RID rids[10];
+  Expr *cond;
+  int pieces, rc;
+
+  testName = "test errors of the cracker index";
+
+  TEST_CHECK(createTable(TEST_TABLE, testSchema()));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, 10, rids);
+
+  rc = openCrackerIndex(&index, table, 3);
+  ASSERT_EQUALS_INT(RC_RM_UNKNOWN_DATATYPE, rc, "STRING attribute");
+  rc = openCrackerIndex(&index, table, 5);
+  ASSERT_EQUALS_INT(RC_INVALID_ATTR_NUM, rc, "attribute out of the schema");
+
+  // conditions that put no range on the attribute leave it alone
+  TEST_CHECK(openCrackerIndex(&index, table, 1));
+  qLow = rowValue[3];
+  cond = compare(1, "i0", OP_COMP_EQUAL);
+  cond->expr.op->args[1]->expr.cons->v.intV = qLow;
+  cond = combine(cond, NULL, OP_BOOL_NOT);
+  checkScan(table, cond, notEqualsLow, 10);
+  freeExpr(cond);
+  cond = compare(0, "i5", OP_COMP_SMALLER);
+  cond = combine(compare(1, "i0", OP_COMP_SMALLER), cond, OP_BOOL_OR);
+  checkScan(table, cond, lowId, 10);
+  TEST_CHECK(getCKNumPieces(index, &pieces));
+  ASSERT_EQUALS_INT(0, pieces, "no range, no array");
+  freeExpr(cond);
+  TEST_CHECK(closeCrackerIndex(index));
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+// id INT, value INT, score FLOAT, name STRING(8), weight INT
+Schema *
+testSchema (void)
+{
+  char *names[] = { "id", "value", "score", "name", "weight" };
+  DataType dt[] = { DT_INT, DT_INT, DT_FLOAT, DT_STRING, DT_INT };
+  int sizes[] = { 0, 0, 0, 8, 0 };
+
+  return makeTestSchema(5, names, dt, sizes);
+}
+
+// ************************************************************
+// insert records 0 .. n-1 with random values
+void
+fillTable (RM_TableData *table, int n, RID *rids)
+{
+  int i;
+
+  free(rowValue);
+  free(rowAlive);
+  rowValue = (int *) malloc((n + 1) * sizeof(int));
+  rowAlive = (bool *) malloc((n + 1) * sizeof(bool));
+
+  insertRows(table, n, rids, randomRow);
+  for(i = 0; i < n; i++)
+    rowAlive[i] = true;
+}
+
+// ************************************************************
+// row id of a filled table, with a random value
+void
+randomRow (Record *r, Schema *schema, int id)
+{
+  setRow(r, schema, id, nextRandom() % MAX_VALUE);
+}
+
+// ************************************************************
+void
+setRow (Record *r, Schema *schema, int id, int value)
+{
+  setIntAttr(r, schema, 0, id);
+  setIntAttr(r, schema, 1, value);
+  setFloatAttr(r, schema, 2, id / 2.0);
+  setStringAttr(r, schema, 3, "row");
+  setIntAttr(r, schema, 4, id % 3);
+  rowValue[id] = value;
+}
+
+// ************************************************************
+// deterministic pseudo-random numbers in 0 .. 2^24-1
+int
+nextRandom (void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 8) & 0xffffff;
+}
+
+// ************************************************************
+// low <= value < high on attribute 1, written in one of three ways:
+// NOT (value < low) AND value < high,
+// value < high AND low - 1 < value,
+// NOT (NOT (value < high) OR value < low)
+Expr *
+rangeQuery (int form, int low, int high)
+{
+  Value *l, *h;
+
+  MAKE_VALUE(l, DT_INT, form == 1 ? low - 1 : low);
+  MAKE_VALUE(h, DT_INT, high);
+  switch (form)
+    {
+    case 0:
+      return combine(combine(compareValue(1, l, OP_COMP_SMALLER), NULL, OP_BOOL_NOT),
+                     compareValue(1, h, OP_COMP_SMALLER), OP_BOOL_AND);
+    case 1:
+      return combine(compareValue(1, h, OP_COMP_SMALLER),
+                     compareValueFirst(l, 1, OP_COMP_SMALLER), OP_BOOL_AND);
+    default:
+      return combine(combine(combine(compareValue(1, h, OP_COMP_SMALLER), NULL, OP_BOOL_NOT),
+                             compareValue(1, l, OP_COMP_SMALLER), OP_BOOL_OR), NULL, OP_BOOL_NOT);
+    }
+}
+
+// ************************************************************
+// a scan with cond finds the live records 0 .. n-1 that satisfy pred
+void
+checkScan (RM_TableData *table, Expr *cond, int (*pred)(int id), int n)
+{
+  RM_ScanHandle scan;
+  Record *r;
+  Value *v;
+  int i, rc, expected = 0, found = 0, wrong = 0;
+
+  for(i = 0; i < n; i++)
+    if (rowAlive[i] && pred(i))
+      expected++;
+
+  TEST_CHECK(createRecord(&r, table->schema));
+  TEST_CHECK(startScan(table, &scan, cond));
+  while((rc = next(&scan, r)) == RC_OK)
+    {
+      TEST_CHECK(getAttr(r, table->schema, 0, &v));
+      if (!rowAlive[v->v.intV] || !pred(v->v.intV))
+        wrong++;
+      found++;
+      freeVal(v);
+    }
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ended");
+  TEST_CHECK(closeScan(&scan));
+  freeRecord(r);
+  ASSERT_EQUALS_INT(expected, found, "scan finds the matching records");
+  ASSERT_EQUALS_INT(0, wrong, "scan finds no other records");
+}
@@ -0,0 +1,325 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dberror.h"
+#include "expr.h"
+#include "inverted_mgr.h"
+#include "record_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+#include "test_util.h"
+
+#define TEST_TABLE "test_table_ii"
+#define NUM_WORDS 12
+#define MSG_LEN 40
+
+// test methods
+static void testTokenQueries (void);
+static void testLsmTable (void);
+static void testErrors (void);
+
+// helper methods
+static Schema *testSchema (void);
+static void fillTable (RM_TableData *table, int n, RID *rids);
+static void nthRow (Record *r, Schema *schema, int id);
+static void setRow (Record *r, Schema *schema, int id, int a, int b, int c);
+static bool hasToken (char *msg, char *token);
+static void checkQuery (II_IndexHandle *index, char *query, int n, RID *rids);
+static void checkPostings (II_IndexHandle *index, int n);
+
+// state of the rows of the test table
+static char *words[NUM_WORDS] = { "disk", "network", "timeout", "error", "warning", "user",
+                                  "login", "failed", "retry", "cache", "miss", "db42" };
+static char (*rowMsg)[MSG_LEN + 1];
+static bool *rowAlive;
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  testName = "";
+
+  initRecordManager(NULL);
+  testTokenQueries();
+  testLsmTable();
+  testErrors();
+  shutdownRecordManager();
+
+  return 0;
+}
+
+// ************************************************************
+void
+testTokenQueries (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  II_IndexHandle *index = NULL;
+  int numRows = 5000;
+  RID *rids = (RID *) malloc(numRows * sizeof(RID));
+  Record *r;
+  int i, tokens, postings, size;
+
+  testName = "test token queries of the inverted index";
+
+  TEST_CHECK(createTable(TEST_TABLE, testSchema()));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, numRows, rids);
+  TEST_CHECK(createInvertedIndex("test_ii_msg", table, 1));
+  TEST_CHECK(openInvertedIndex(&index, "test_ii_msg", table));
+  TEST_CHECK(getIINumTokens(index, &tokens));
+  ASSERT_EQUALS_INT(NUM_WORDS, tokens, "one posting list per word");
+  checkPostings(index, numRows);
+
+  checkQuery(index, "disk", numRows, rids);
+  checkQuery(index, "DISK error", numRows, rids);
+  checkQuery(index, "login, FAILED!", numRows, rids);
+  checkQuery(index, "db42 timeout cache", numRows, rids);
+  checkQuery(index, "retry retry", numRows, rids);
+  checkQuery(index, "nosuchword", numRows, rids);
+  checkQuery(index, "disk nosuchword", numRows, rids);
+
+  // gaps of a few records take a byte each
+  TEST_CHECK(getIINumPostings(index, &postings));
+  TEST_CHECK(getIIPostingSize(index, &size));
+  ASSERT_TRUE(size < 2 * postings, "postings take less than two bytes each");
+
+  // deletes and updates reach the posting lists
+  for(i = 0; i < numRows; i += 4)
+    {
+      TEST_CHECK(deleteRecord(table, rids[i]));
+      rowAlive[i] = false;
+    }
+  TEST_CHECK(createRecord(&r, table->schema));
+  for(i = 1; i < numRows; i += 3)
+    if (rowAlive[i])
+      {
+        setRow(r, table->schema, i, 10, 11, i % NUM_WORDS);
+        r->id = rids[i];
+        TEST_CHECK(updateRecord(table, r));
+      }
+  freeRecord(r);
+  checkPostings(index, numRows);
+  checkQuery(index, "disk", numRows, rids);
+  checkQuery(index, "cache miss", numRows, rids);
+  checkQuery(index, "miss network", numRows, rids);
+
+  // the posting lists survive closing the index
+  TEST_CHECK(closeInvertedIndex(index));
+  TEST_CHECK(openInvertedIndex(&index, "test_ii_msg", table));
+  checkPostings(index, numRows);
+  checkQuery(index, "cache miss", numRows, rids);
+  checkQuery(index, "DB42 warning", numRows, rids);
+
+  TEST_CHECK(closeInvertedIndex(index));
+  TEST_CHECK(deleteInvertedIndex("test_ii_msg"));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(rids);
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testLsmTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  II_IndexHandle *index = NULL;
+  RM_TableOptions options;
+  int numRows = 2000;
+  RID *rids = (RID *) malloc(numRows * sizeof(RID));
+  int i;
+
+  testName = "test an inverted index on an LSM table";
+
+  memset(&options, 0, sizeof(options));
+  options.engine = RM_ENGINE_LSM;
+  options.memtableSize = 4096;
+  TEST_CHECK(createTableWithOptions(TEST_TABLE, testSchema(), &options));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, numRows, rids);
+  TEST_CHECK(createInvertedIndex("test_ii_msg", table, 1));
+  TEST_CHECK(openInvertedIndex(&index, "test_ii_msg", table));
+
+  checkQuery(index, "user login", numRows, rids);
+  for(i = 0; i < numRows; i += 5)
+    {
+      TEST_CHECK(deleteRecord(table, rids[i]));
+      rowAlive[i] = false;
+    }
+  checkPostings(index, numRows);
+  checkQuery(index, "user login", numRows, rids);
+
+  TEST_CHECK(closeInvertedIndex(index));
+  TEST_CHECK(deleteInvertedIndex("test_ii_msg"));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(rids);
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testErrors (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  II_IndexHandle *index = NULL;
+  II_ScanHandle *query;
+  RID rids[10], rid;
+  int tokens, rc;
+
+  testName = "test errors of the inverted index";
+
+  TEST_CHECK(createTable(TEST_TABLE, testSchema()));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  fillTable(table, 0, rids);
+
+  rc = createInvertedIndex("test_ii_level", table, 2);
+  ASSERT_EQUALS_INT(RC_RM_UNKNOWN_DATATYPE, rc, "INT attribute");
+  rc = createInvertedIndex("test_ii_none", table, 3);
+  ASSERT_EQUALS_INT(RC_INVALID_ATTR_NUM, rc, "attribute out of the schema");
+  ASSERT_ERROR(openInvertedIndex(&index, "test_ii_none", table), "index never created");
+
+  // an empty table makes an empty index
+  TEST_CHECK(createInvertedIndex("test_ii_msg", table, 1));
+  TEST_CHECK(openInvertedIndex(&index, "test_ii_msg", table));
+  TEST_CHECK(getIINumTokens(index, &tokens));
+  ASSERT_EQUALS_INT(0, tokens, "no tokens");
+  TEST_CHECK(openIIQuery(index, "disk", &query));
+  rc = iiNextEntry(query, &rid);
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "no records");
+  TEST_CHECK(closeIIQuery(query));
+  rc = openIIQuery(index, " -,! ", &query);
+  ASSERT_EQUALS_INT(RC_INVALID_ARGS, rc, "query without tokens");
+  TEST_CHECK(closeInvertedIndex(index));
+  TEST_CHECK(deleteInvertedIndex("test_ii_msg"));
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+// id INT, msg STRING(40), level INT
+Schema *
+testSchema (void)
+{
+  char *names[] = { "id", "msg", "level" };
+  DataType dt[] = { DT_INT, DT_STRING, DT_INT };
+  int sizes[] = { 0, MSG_LEN, 0 };
+
+  return makeTestSchema(3, names, dt, sizes);
+}
+
+// ************************************************************
+// insert records 0 .. n-1, with messages of three words picked from the id
+void
+fillTable (RM_TableData *table, int n, RID *rids)
+{
+  int i;
+
+  free(rowMsg);
+  free(rowAlive);
+  rowMsg = malloc((n + 1) * sizeof(*rowMsg));
+  rowAlive = (bool *) malloc((n + 1) * sizeof(bool));
+
+  insertRows(table, n, rids, nthRow);
+  for(i = 0; i < n; i++)
+    rowAlive[i] = true;
+}
+
+// ************************************************************
+// row id of a filled table
+void
+nthRow (Record *r, Schema *schema, int id)
+{
+  setRow(r, schema, id, id % NUM_WORDS, (id / NUM_WORDS) % NUM_WORDS, (id * 7 + 3) % NUM_WORDS);
+}
+
+// ************************************************************
+// the message is "A: b-c." with words a, b and c; every third starts upper case
+void
+setRow (Record *r, Schema *schema, int id, int a, int b, int c)
+{
+  char *msg = rowMsg[id];
+  int i;
+
+  sprintf(msg, "%s: %s-%s.", words[a], words[b], words[c]);
+  if (id % 3 == 0)
+    for(i = 0; msg[i] != ':'; i++)
+      msg[i] = toupper(msg[i]);
+
+  setIntAttr(r, schema, 0, id);
+  setStringAttr(r, schema, 1, msg);
+  setIntAttr(r, schema, 2, id % 4);
+}
+
+// ************************************************************
+// whether a message contains a lower-case token as a whole word
+bool
+hasToken (char *msg, char *token)
+{
+  int len = strlen(token), i;
+
+  for(i = 0; msg[i] != '\0'; i++)
+    if ((i == 0 || !isalnum(msg[i - 1])) && strncasecmp(msg + i, token, len) == 0
+        && !isalnum(msg[i + len]))
+      return true;
+  return false;
+}
+
+// ************************************************************
+// a query finds, in order, the live records 0 .. n-1 that contain all of
+// its words
+void
+checkQuery (II_IndexHandle *index, char *query, int n, RID *rids)
+{
+  II_ScanHandle *handle;
+  char *copy = strdup(query), *word;
+  char *tokens[8];
+  int numTokens = 0, i, k, rc, wrong = 0;
+  RID rid;
+
+  for(word = strtok(copy, " ,!"); word != NULL; word = strtok(NULL, " ,!"))
+    tokens[numTokens++] = word;
+
+  TEST_CHECK(openIIQuery(index, query, &handle));
+  for(i = 0; i < n; i++)
+    {
+      for(k = 0; k < numTokens && hasToken(rowMsg[i], tokens[k]); k++);
+      if (!rowAlive[i] || k < numTokens)
+        continue;
+      if (iiNextEntry(handle, &rid) != RC_OK || rid.page != rids[i].page || rid.slot != rids[i].slot)
+        wrong++;
+    }
+  rc = iiNextEntry(handle, &rid);
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "query finds no other records");
+  ASSERT_EQUALS_INT(0, wrong, "query finds the matching records in order");
+  TEST_CHECK(closeIIQuery(handle));
+  free(copy);
+}
+
+// ************************************************************
+// every live record has a posting for each distinct word of its message
+void
+checkPostings (II_IndexHandle *index, int n)
+{
+  int i, k, expected = 0, postings;
+
+  for(i = 0; i < n; i++)
+    for(k = 0; k < NUM_WORDS; k++)
+      if (rowAlive[i] && hasToken(rowMsg[i], words[k]))
+        expected++;
+  TEST_CHECK(getIINumPostings(index, &postings));
+  ASSERT_EQUALS_INT(expected, postings, "postings of the live records");
+}
@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dberror.h"
+#include "expr.h"
+#include "join_filter.h"
+#include "record_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+#include "test_util.h"
+
+#define DIM_TABLE "test_table_jf_dim"
+#define FACT_TABLE "test_table_jf_fact"
+#define NUM_DIMS 200
+#define NUM_REGIONS 8
+
+// test methods
+static void testStarJoin (void);
+static void testStringKeys (void);
+static void testLsmProbe (void);
+static void testErrors (void);
+
+// helper methods
+static Schema *dimSchema (void);
+static Schema *factSchema (void);
+static void fillDims (RM_TableData *table);
+static void fillFacts (RM_TableData *table, int n);
+static void checkProbe (RM_TableData *fact, JF_FilterHandle *filter, int *attrs, Expr *cond,
+                        bool compiled, int (*match)(int dim, int amount), int n);
+
+// rows: dimension d is in region d % NUM_REGIONS and named "dim<d>"; fact
+// row i refers to dimension i % NUM_DIMS and has amount i % 100
+static int inRegion3 (int dim, int amount) { return dim % NUM_REGIONS == 3; }
+static int inRegion3Small (int dim, int amount) { return dim % NUM_REGIONS == 3 && amount < 50; }
+static int lowDim (int dim, int amount) { return dim < 10; }
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  testName = "";
+
+  initRecordManager(NULL);
+  testStarJoin();
+  testStringKeys();
+  testLsmProbe();
+  testErrors();
+  shutdownRecordManager();
+
+  return 0;
+}
+
+// ************************************************************
+void
+testStarJoin (void)
+{
+  RM_TableData *dim = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableData *fact = (RM_TableData *) malloc(sizeof(RM_TableData));
+  JF_FilterHandle *filter = NULL;
+  int numFacts = 20000;
+  int dimKey[] = { 0 }, factKey[] = { 0 };
+  Expr *cond, *factCond;
+
+  testName = "test a semi-join filter from a dimension into a fact scan";
+
+  TEST_CHECK(createTable(DIM_TABLE, dimSchema()));
+  TEST_CHECK(openTable(dim, DIM_TABLE));
+  fillDims(dim);
+  TEST_CHECK(createTable(FACT_TABLE, factSchema()));
+  TEST_CHECK(openTable(fact, FACT_TABLE));
+  fillFacts(fact, numFacts);
+
+  // region = 3 keeps 25 of the 200 dimensions
+  cond = compare(2, "i3", OP_COMP_EQUAL);
+  TEST_CHECK(createJoinFilter(&filter, dim, cond, 1, dimKey));
+  ASSERT_EQUALS_INT(NUM_DIMS / NUM_REGIONS, filter->numKeys, "build records");
+
+  checkProbe(fact, filter, factKey, NULL, false, inRegion3, numFacts);
+
+  // with a condition of its own, interpreted and compiled
+  factCond = compare(2, "i50", OP_COMP_SMALLER);
+  checkProbe(fact, filter, factKey, factCond, false, inRegion3Small, numFacts);
+  checkProbe(fact, filter, factKey, factCond, true, inRegion3Small, numFacts);
+  freeExpr(factCond);
+
+  TEST_CHECK(freeJoinFilter(filter));
+  freeExpr(cond);
+  TEST_CHECK(closeTable(dim));
+  TEST_CHECK(deleteTable(DIM_TABLE));
+  TEST_CHECK(closeTable(fact));
+  TEST_CHECK(deleteTable(FACT_TABLE));
+  free(dim);
+  free(fact);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testStringKeys (void)
+{
+  RM_TableData *dim = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableData *fact = (RM_TableData *) malloc(sizeof(RM_TableData));
+  JF_FilterHandle *filter = NULL;
+  int numFacts = 5000;
+  int dimName[] = { 1 }, factName[] = { 1 };
+  int dimPair[] = { 1, 0 }, factPair[] = { 1, 0 };
+  Expr *cond;
+
+  testName = "test semi-join filters on STRING and composite keys";
+
+  TEST_CHECK(createTable(DIM_TABLE, dimSchema()));
+  TEST_CHECK(openTable(dim, DIM_TABLE));
+  fillDims(dim);
+  TEST_CHECK(createTable(FACT_TABLE, factSchema()));
+  TEST_CHECK(openTable(fact, FACT_TABLE));
+  fillFacts(fact, numFacts);
+
+  // the names are STRING(8) in one table and STRING(12) in the other
+  cond = compare(0, "i10", OP_COMP_SMALLER);
+  TEST_CHECK(createJoinFilter(&filter, dim, cond, 1, dimName));
+  checkProbe(fact, filter, factName, NULL, false, lowDim, numFacts);
+  TEST_CHECK(freeJoinFilter(filter));
+
+  // (name, id)
+  TEST_CHECK(createJoinFilter(&filter, dim, cond, 2, dimPair));
+  checkProbe(fact, filter, factPair, NULL, false, lowDim, numFacts);
+  TEST_CHECK(freeJoinFilter(filter));
+  freeExpr(cond);
+
+  TEST_CHECK(closeTable(dim));
+  TEST_CHECK(deleteTable(DIM_TABLE));
+  TEST_CHECK(closeTable(fact));
+  TEST_CHECK(deleteTable(FACT_TABLE));
+  free(dim);
+  free(fact);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testLsmProbe (void)
+{
+  RM_TableData *dim = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableData *fact = (RM_TableData *) malloc(sizeof(RM_TableData));
+  JF_FilterHandle *filter = NULL;
+  RM_TableOptions options;
+  int numFacts = 3000;
+  int dimKey[] = { 0 }, factKey[] = { 0 };
+  Expr *cond;
+
+  testName = "test a semi-join filter pushed into an LSM scan";
+
+  TEST_CHECK(createTable(DIM_TABLE, dimSchema()));
+  TEST_CHECK(openTable(dim, DIM_TABLE));
+  fillDims(dim);
+  memset(&options, 0, sizeof(options));
+  options.engine = RM_ENGINE_LSM;
+  options.memtableSize = 4096;
+  TEST_CHECK(createTableWithOptions(FACT_TABLE, factSchema(), &options));
+  TEST_CHECK(openTable(fact, FACT_TABLE));
+  fillFacts(fact, numFacts);
+
+  cond = compare(2, "i3", OP_COMP_EQUAL);
+  TEST_CHECK(createJoinFilter(&filter, dim, cond, 1, dimKey));
+  checkProbe(fact, filter, factKey, NULL, false, inRegion3, numFacts);
+  TEST_CHECK(freeJoinFilter(filter));
+  freeExpr(cond);
+
+  TEST_CHECK(closeTable(dim));
+  TEST_CHECK(deleteTable(DIM_TABLE));
+  TEST_CHECK(closeTable(fact));
+  TEST_CHECK(deleteTable(FACT_TABLE));
+  free(dim);
+  free(fact);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testErrors (void)
+{
+  RM_TableData *dim = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableData *fact = (RM_TableData *) malloc(sizeof(RM_TableData));
+  JF_FilterHandle *filter = NULL;
+  RM_ScanHandle scan;
+  Record *r;
+  int dimKey[] = { 0 }, factName[] = { 1 }, outside[] = { 3 };
+  int rc;
+
+  testName = "test errors of semi-join filters";
+
+  TEST_CHECK(createTable(DIM_TABLE, dimSchema()));
+  TEST_CHECK(openTable(dim, DIM_TABLE));
+  TEST_CHECK(createTable(FACT_TABLE, factSchema()));
+  TEST_CHECK(openTable(fact, FACT_TABLE));
+  fillFacts(fact, 10);
+
+  rc = createJoinFilter(&filter, dim, NULL, 0, dimKey);
+  ASSERT_EQUALS_INT(RC_INVALID_ARGS, rc, "no key attributes");
+  rc = createJoinFilter(&filter, dim, NULL, 1, outside);
+  ASSERT_EQUALS_INT(RC_INVALID_ATTR_NUM, rc, "attribute out of the schema");
+
+  // an empty build side drops every probe record
+  TEST_CHECK(createJoinFilter(&filter, dim, NULL, 1, dimKey));
+  ASSERT_EQUALS_INT(0, filter->numKeys, "no build records");
+  TEST_CHECK(startScan(fact, &scan, NULL));
+  rc = pushJoinFilter(filter, &scan, factName);
+  ASSERT_EQUALS_INT(RC_INVALID_ARGS, rc, "INT key against a STRING attribute");
+  rc = pushJoinFilter(filter, &scan, outside);
+  ASSERT_EQUALS_INT(RC_INVALID_ATTR_NUM, rc, "probe attribute out of the schema");
+  TEST_CHECK(pushJoinFilter(filter, &scan, dimKey));
+  TEST_CHECK(createRecord(&r, fact->schema));
+  rc = next(&scan, r);
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "every record dropped");
+  ASSERT_EQUALS_INT(10, filter->numDropped, "dropped records");
+  freeRecord(r);
+  TEST_CHECK(closeScan(&scan));
+  TEST_CHECK(freeJoinFilter(filter));
+
+  TEST_CHECK(closeTable(dim));
+  TEST_CHECK(deleteTable(DIM_TABLE));
+  TEST_CHECK(closeTable(fact));
+  TEST_CHECK(deleteTable(FACT_TABLE));
+  free(dim);
+  free(fact);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+// id INT, name STRING(8), region INT
+Schema *
+dimSchema (void)
+{
+  char *names[] = { "id", "name", "region" };
+  DataType dt[] = { DT_INT, DT_STRING, DT_INT };
+  int sizes[] = { 0, 8, 0 };
+
+  return makeTestSchema(3, names, dt, sizes);
+}
+
+// ************************************************************
+// dimId INT, name STRING(12), amount INT
+Schema *
+factSchema (void)
+{
+  char *names[] = { "dimId", "name", "amount" };
+  DataType dt[] = { DT_INT, DT_STRING, DT_INT };
+  int sizes[] = { 0, 12, 0 };
+
+  return makeTestSchema(3, names, dt, sizes);
+}
+
+// ************************************************************
+void
+fillDims (RM_TableData *table)
+{
+  char name[16];
+  Record *r;
+  int i;
+
+  TEST_CHECK(createRecord(&r, table->schema));
+  for(i = 0; i < NUM_DIMS; i++)
+    {
+      sprintf(name, "dim%d", i);
+      setIntAttr(r, table->schema, 0, i);
+      setStringAttr(r, table->schema, 1, name);
+      setIntAttr(r, table->schema, 2, i % NUM_REGIONS);
+      TEST_CHECK(insertRecord(table, r));
+    }
+  freeRecord(r);
+}
+
+// ************************************************************
+void
+fillFacts (RM_TableData *table, int n)
+{
+  char name[16];
+  Record *r;
+  int i;
+
+  TEST_CHECK(createRecord(&r, table->schema));
+  for(i = 0; i < n; i++)
+    {
+      sprintf(name, "dim%d", i % NUM_DIMS);
+      setIntAttr(r, table->schema, 0, i % NUM_DIMS);
+      setStringAttr(r, table->schema, 1, name);
+      setIntAttr(r, table->schema, 2, i % 100);
+      TEST_CHECK(insertRecord(table, r));
+    }
+  freeRecord(r);
+}
+
+// ************************************************************
+// a fact scan with cond and the filter returns every record that joins and
+// satisfies cond, few others, and counts what the filter dropped
+void
+checkProbe (RM_TableData *fact, JF_FilterHandle *filter, int *attrs, Expr *cond,
+            bool compiled, int (*match)(int dim, int amount), int n)
+{
+  RM_ScanHandle scan;
+  Record *r;
+  Value *dimId, *amount;
+  int i, rc, expected = 0, found = 0, extra = 0, tested, dropped;
+
+  for(i = 0; i < n; i++)
+    if (match(i % NUM_DIMS, i % 100))
+      expected++;
+
+  tested = filter->numTested;
+  dropped = filter->numDropped;
+  TEST_CHECK(createRecord(&r, fact->schema));
+  if (compiled)
+    rc = startCompiledScan(fact, &scan, cond);
+  else
+    rc = startScan(fact, &scan, cond);
+  TEST_CHECK(rc);
+  TEST_CHECK(pushJoinFilter(filter, &scan, attrs));
+  while((rc = next(&scan, r)) == RC_OK)
+    {
+      TEST_CHECK(getAttr(r, fact->schema, 0, &dimId));
+      TEST_CHECK(getAttr(r, fact->schema, 2, &amount));
+      if (match(dimId->v.intV, amount->v.intV))
+        found++;
+      else
+        extra++;
+      freeVal(dimId);
+      freeVal(amount);
+    }
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ended");
+  TEST_CHECK(closeScan(&scan));
+  freeRecord(r);
+
+  ASSERT_EQUALS_INT(expected, found, "every joining record returned");
+  ASSERT_TRUE(extra * 20 < n - expected, "few records pass the filter without joining");
+  tested = filter->numTested - tested;
+  dropped = filter->numDropped - dropped;
+  ASSERT_TRUE(tested > 0 && dropped * 10 > tested * 8, "the filter drops most records");
+}
@@ -0,0 +1,313 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dberror.h"
+#include "expr.h"
+#include "btree_mgr.h"
+#include "learned_mgr.h"
+#include "record_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+#include "test_util.h"
+
+#define ASSERT_EQUALS_RID(_l,_r, message)				\
+  do {									\
+    ASSERT_TRUE((_l).page == (_r).page && (_l).slot == (_r).slot, message); \
+  } while(0)
+
+#define TEST_TABLE "test_table_li"
+
+// test methods
+static void testLookups (void);
+static void testSkewedKeys (void);
+static void testBuildFromTable (void);
+static void testErrors (void);
+
+// helper methods
+static void buildIndex (int *keys, int n, int maxError);
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  testName = "";
+
+  initIndexManager(NULL);
+  testLookups();
+  testSkewedKeys();
+  testBuildFromTable();
+  testErrors();
+  shutdownIndexManager();
+
+  return 0;
+}
+
+// ************************************************************
+void
+testLookups (void)
+{
+  LI_IndexHandle *index = NULL;
+  LI_ScanHandle *sc = NULL;
+  BTreeHandle *btree = NULL;
+  int numKeys = 50000;
+  int *keys = (int *) malloc(numKeys * sizeof(int));
+  int i, segments, modelSize, nodes, entries, rc;
+  Value key, low, high;
+  RID rid;
+
+  testName = "test lookups in a learned index";
+
+  // nearly evenly spaced keys 10 * i + (0 .. 4)
+  for(i = 0; i < numKeys; i++)
+    keys[i] = 10 * i + (i * 7) % 5;
+  buildIndex(keys, numKeys, 32);
+  TEST_CHECK(openLearnedIndex(&index, "testidx"));
+  TEST_CHECK(getLINumEntries(index, &entries));
+  ASSERT_EQUALS_INT(numKeys, entries, "every key loaded");
+
+  key.dt = DT_INT;
+  for(i = 0; i < numKeys; i++)
+    {
+      key.v.intV = keys[i];
+      TEST_CHECK(liFindKey(index, &key, &rid));
+      ASSERT_EQUALS_RID(ridFor(keys[i]), rid, "found the key");
+      key.v.intV = keys[i] + 5;
+      ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, liFindKey(index, &key, &rid), "key between two keys");
+    }
+  key.v.intV = -1;
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, liFindKey(index, &key, &rid), "key below every key");
+  key.v.intV = 10 * numKeys;
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, liFindKey(index, &key, &rid), "key above every key");
+
+  // the scan starts at the first key >= low
+  low.dt = high.dt = DT_INT;
+  low.v.intV = 1005;
+  high.v.intV = 2000;
+  TEST_CHECK(openLIScan(index, &low, &high, &sc));
+  for(i = 101; (rc = liNextEntry(sc, &rid)) == RC_OK; i++)
+    ASSERT_EQUALS_RID(ridFor(keys[i]), rid, "range scan in key order");
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "range scan ended");
+  ASSERT_EQUALS_INT(201, i, "range scan ends at the high bound");
+  TEST_CHECK(closeLIScan(sc));
+  TEST_CHECK(openLIScan(index, NULL, NULL, &sc));
+  for(i = 0; liNextEntry(sc, &rid) == RC_OK; i++);
+  ASSERT_EQUALS_INT(numKeys, i, "open scan returns every key");
+  TEST_CHECK(closeLIScan(sc));
+
+  // a B+-tree over the same keys needs a separator per leaf
+  TEST_CHECK(getLINumSegments(index, &segments));
+  TEST_CHECK(getLIModelSize(index, &modelSize));
+  ASSERT_TRUE(segments <= 4, "evenly spaced keys fit few segments");
+  TEST_CHECK(createBtree("testbtree", DT_INT, 64));
+  TEST_CHECK(openBtree(&btree, "testbtree"));
+  for(i = 0; i < numKeys; i++)
+    {
+      key.v.intV = keys[i];
+      TEST_CHECK(insertKey(btree, &key, ridFor(keys[i])));
+    }
+  TEST_CHECK(getNumNodes(btree, &nodes));
+  ASSERT_TRUE(100 * modelSize < nodes * PAGE_SIZE, "model far smaller than a B+-tree");
+  TEST_CHECK(closeBtree(btree));
+  TEST_CHECK(deleteBtree("testbtree"));
+
+  TEST_CHECK(closeLearnedIndex(index));
+  TEST_CHECK(deleteLearnedIndex("testidx"));
+  free(keys);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testSkewedKeys (void)
+{
+  LI_IndexHandle *index = NULL;
+  LI_ScanHandle *sc = NULL;
+  int numKeys = 20000;
+  int *keys = (int *) malloc(numKeys * sizeof(int));
+  int i, segments, rc;
+  Value key, low;
+  RID rid;
+
+  testName = "test skewed keys in a learned index";
+
+  // quadratic growth, then a dense cluster and negative keys
+  for(i = 0; i < numKeys / 2; i++)
+    keys[i] = i * i;
+  for(; i < numKeys - 1000; i++)
+    keys[i] = 200000000 + (i - numKeys / 2);
+  for(; i < numKeys; i++)
+    keys[i] = -5 * (numKeys - i);
+  buildIndex(keys, numKeys, 4);
+  TEST_CHECK(openLearnedIndex(&index, "testidx"));
+  TEST_CHECK(getLINumSegments(index, &segments));
+  ASSERT_TRUE(segments > 10, "curved keys need more segments");
+
+  key.dt = DT_INT;
+  for(i = 0; i < numKeys; i++)
+    {
+      key.v.intV = keys[i];
+      TEST_CHECK(liFindKey(index, &key, &rid));
+      ASSERT_EQUALS_RID(ridFor(keys[i]), rid, "found the skewed key");
+    }
+  key.v.intV = 2;
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, liFindKey(index, &key, &rid), "gap between squares");
+
+  // from the negative keys through the squares
+  low.dt = DT_INT;
+  low.v.intV = -12;
+  TEST_CHECK(openLIScan(index, &low, NULL, &sc));
+  TEST_CHECK(liNextEntry(sc, &rid));
+  ASSERT_EQUALS_RID(ridFor(-10), rid, "first key >= low");
+  TEST_CHECK(liNextEntry(sc, &rid));
+  ASSERT_EQUALS_RID(ridFor(-5), rid, "second key");
+  for(i = 0; (rc = liNextEntry(sc, &rid)) == RC_OK; i++)
+    if (i < numKeys / 2)
+      ASSERT_EQUALS_RID(ridFor(i * i), rid, "squares in order");
+  ASSERT_EQUALS_INT(numKeys - 1000, i, "scan to the end");
+  TEST_CHECK(closeLIScan(sc));
+
+  TEST_CHECK(closeLearnedIndex(index));
+  TEST_CHECK(deleteLearnedIndex("testidx"));
+  free(keys);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testBuildFromTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  LI_IndexHandle *index = NULL;
+  char *names[] = { "a", "b", "c" };
+  DataType dt[] = { DT_INT, DT_STRING, DT_INT };
+  int sizes[] = { 0, 4, 0 };
+  char **cpNames = (char **) malloc(sizeof(char*) * 3);
+  DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
+  int *cpSizes = (int *) malloc(sizeof(int) * 3);
+  int *cpKeys = (int *) malloc(sizeof(int));
+  int numInserts = 1000;
+  int *permute = createPermutation(numInserts);
+  Schema *schema;
+  Record *r, *out;
+  Value *v, key;
+  RID rid;
+  int i;
+
+  testName = "test building a learned index from a table";
+
+  for(i = 0; i < 3; i++)
+    cpNames[i] = strdup(names[i]);
+  memcpy(cpDt, dt, sizeof(DataType) * 3);
+  memcpy(cpSizes, sizes, sizeof(int) * 3);
+  cpKeys[0] = 0;
+  schema = createSchema(3, cpNames, cpDt, cpSizes, 1, cpKeys);
+
+  TEST_CHECK(createTable(TEST_TABLE, schema));
+  TEST_CHECK(openTable(table, TEST_TABLE));
+  for(i = 0; i < numInserts; i++)
+    {
+      TEST_CHECK(createRecord(&r, table->schema));
+      MAKE_VALUE(v, DT_INT, 3 * permute[i]);
+      TEST_CHECK(setAttr(r, table->schema, 0, v));
+      freeVal(v);
+      MAKE_STRING_VALUE(v, "abc");
+      TEST_CHECK(setAttr(r, table->schema, 1, v));
+      freeVal(v);
+      MAKE_VALUE(v, DT_INT, i);
+      TEST_CHECK(setAttr(r, table->schema, 2, v));
+      freeVal(v);
+      TEST_CHECK(insertRecord(table, r));
+      freeRecord(r);
+    }
+
+  ASSERT_ERROR(buildLearnedIndex("testidx", table, 1, 16), "string key attribute");
+  TEST_CHECK(buildLearnedIndex("testidx", table, 0, 16));
+  TEST_CHECK(openLearnedIndex(&index, "testidx"));
+
+  // the RID leads back to the record with the key
+  key.dt = DT_INT;
+  out = (Record *) malloc(sizeof(Record));
+  for(i = 0; i < numInserts; i++)
+    {
+      key.v.intV = 3 * i;
+      TEST_CHECK(liFindKey(index, &key, &rid));
+      TEST_CHECK(getRecord(table, rid, out));
+      TEST_CHECK(getAttr(out, table->schema, 0, &v));
+      ASSERT_EQUALS_INT(3 * i, v->v.intV, "RID of the record with the key");
+      freeVal(v);
+      free(out->data);
+    }
+  free(out);
+
+  TEST_CHECK(closeLearnedIndex(index));
+  TEST_CHECK(deleteLearnedIndex("testidx"));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable(TEST_TABLE));
+  free(table);
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testErrors (void)
+{
+  LI_IndexHandle *index = NULL;
+  LI_ScanHandle *sc = NULL;
+  int keys[] = { 5, 3, 5 };
+  RID rids[3];
+  Value key;
+  RID rid;
+
+  testName = "test errors of the learned index";
+
+  rids[0] = ridFor(5);
+  rids[1] = ridFor(3);
+  rids[2] = ridFor(6);
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, createLearnedIndex("testidx", keys, rids, 3, 8), "repeated key");
+  ASSERT_ERROR(createLearnedIndex("testidx", keys, rids, 2, 0), "error bound too small");
+
+  // an empty index has nothing to find
+  TEST_CHECK(createLearnedIndex("testidx", keys, rids, 0, 8));
+  TEST_CHECK(openLearnedIndex(&index, "testidx"));
+  key.dt = DT_INT;
+  key.v.intV = 5;
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, liFindKey(index, &key, &rid), "empty index");
+  TEST_CHECK(openLIScan(index, &key, NULL, &sc));
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, liNextEntry(sc, &rid), "empty scan");
+  TEST_CHECK(closeLIScan(sc));
+  key.dt = DT_FLOAT;
+  key.v.floatV = 5;
+  ASSERT_ERROR(liFindKey(index, &key, &rid), "key of the wrong type");
+  TEST_CHECK(closeLearnedIndex(index));
+  TEST_CHECK(deleteLearnedIndex("testidx"));
+
+  TEST_DONE();
+}
+
+// ************************************************************
+// bulk load "testidx" from the keys in random order, each with ridFor(key)
+void
+buildIndex (int *keys, int n, int maxError)
+{
+  int *permute = createPermutation(n);
+  int *shuffled = (int *) malloc(n * sizeof(int));
+  RID *rids = (RID *) malloc(n * sizeof(RID));
+  int i;
+
+  for(i = 0; i < n; i++)
+    {
+      shuffled[i] = keys[permute[i]];
+      rids[i] = ridFor(shuffled[i]);
+    }
+  TEST_CHECK(createLearnedIndex("testidx", shuffled, rids, n, maxError));
+  free(permute);
+  free(shuffled);
+  free(rids);
+}
@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dberror.h"
+#include "expr.h"
+#include "record_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+#include "test_util.h"
+
+// ************************************************************
+Schema *
+makeTestSchema (int numAttr, char **names, DataType *dt, int *sizes)
+{
+  char **cpNames = (char **) malloc(sizeof(char*) * numAttr);
+  DataType *cpDt = (DataType *) malloc(sizeof(DataType) * numAttr);
+  int *cpSizes = (int *) malloc(sizeof(int) * numAttr);
+  int *cpKeys = (int *) malloc(sizeof(int));
+  int i;
+
+  for(i = 0; i < numAttr; i++)
+    cpNames[i] = strdup(names[i]);
+  memcpy(cpDt, dt, sizeof(DataType) * numAttr);
+  memcpy(cpSizes, sizes, sizeof(int) * numAttr);
+  cpKeys[0] = 0;
+  return createSchema(numAttr, cpNames, cpDt, cpSizes, 1, cpKeys);
+}
+
+// ************************************************************
+void
+setIntAttr (Record *r, Schema *schema, int attr, int value)
+{
+  Value *v;
+
+  MAKE_VALUE(v, DT_INT, value);
+  TEST_CHECK(setAttr(r, schema, attr, v));
+  freeVal(v);
+}
+
+void
+setFloatAttr (Record *r, Schema *schema, int attr, float value)
+{
+  Value *v;
+
+  MAKE_VALUE(v, DT_FLOAT, value);
+  TEST_CHECK(setAttr(r, schema, attr, v));
+  freeVal(v);
+}
+
+void
+setStringAttr (Record *r, Schema *schema, int attr, char *value)
+{
+  Value *v;
+
+  MAKE_STRING_VALUE(v, value);
+  TEST_CHECK(setAttr(r, schema, attr, v));
+  freeVal(v);
+}
+
+// ************************************************************
+void
+insertRows (RM_TableData *table, int n, RID *rids, void (*setRow) (Record *r, Schema *schema, int id))
+{
+  Record *r;
+  int i;
+
+  TEST_CHECK(createRecord(&r, table->schema));
+  for(i = 0; i < n; i++)
+    {
+      setRow(r, table->schema, i);
+      TEST_CHECK(insertRecord(table, r));
+      rids[i] = r->id;
+    }
+  freeRecord(r);
+}
+
+// ************************************************************
+Expr *
+compare (int attr, char *value, OpType op)
+{
+  return compareValue(attr, stringToValue(value), op);
+}
+
+Expr *
+compareConstant (char *value, int attr, OpType op)
+{
+  return compareValueFirst(stringToValue(value), attr, op);
+}
+
+Expr *
+compareValue (int attr, Value *value, OpType op)
+{
+  Expr *left, *right, *result;
+
+  MAKE_ATTRREF(left, attr);
+  MAKE_CONS(right, value);
+  MAKE_BINOP_EXPR(result, left, right, op);
+  return result;
+}
+
+Expr *
+compareValueFirst (Value *value, int attr, OpType op)
+{
+  Expr *left, *right, *result;
+
+  MAKE_CONS(left, value);
+  MAKE_ATTRREF(right, attr);
+  MAKE_BINOP_EXPR(result, left, right, op);
+  return result;
+}
+
+Expr *
+combine (Expr *left, Expr *right, OpType op)
+{
+  Expr *result;
+
+  if (op == OP_BOOL_NOT)
+    MAKE_UNOP_EXPR(result, left, op);
+  else
+    MAKE_BINOP_EXPR(result, left, right, op);
+  return result;
+}
+
+// ************************************************************
+RID
+ridFor (int key)
+{
+  RID rid;
+
+  rid.page = key;
+  rid.slot = key;
+  return rid;
+}
+
+int *
+createPermutation (int size)
+{
+  int *result = (int *) malloc(size * sizeof(int));
+  int i;
+
+  for(i = 0; i < size; result[i] = i, i++);
+
+  for(i = size - 1; i > 0; i--)
+    {
+      int r, temp;
+      r = rand() % (i + 1);
+      temp = result[i];
+      result[i] = result[r];
+      result[r] = temp;
+    }
+
+  return result;
+}
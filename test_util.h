@@ -0,0 +1,38 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include "dberror.h"
+#include "expr.h"
+#include "tables.h"
+
+// Fixtures shared by the tests of the record manager and the indexes
+
+// schema of numAttr attributes copied from the arrays, with key attribute 0
+extern Schema *makeTestSchema (int numAttr, char **names, DataType *dt, int *sizes);
+
+// set one attribute of a record
+extern void setIntAttr (Record *r, Schema *schema, int attr, int value);
+extern void setFloatAttr (Record *r, Schema *schema, int attr, float value);
+extern void setStringAttr (Record *r, Schema *schema, int attr, char *value);
+
+// insert records 0 .. n - 1, each filled by setRow, and keep their RIDs
+extern void insertRows (RM_TableData *table, int n, RID *rids,
+			void (*setRow) (Record *r, Schema *schema, int id));
+
+// attr op value and value op attr, with value written as for stringToValue
+extern Expr *compare (int attr, char *value, OpType op);
+extern Expr *compareConstant (char *value, int attr, OpType op);
+
+// the same with a value the expression takes over
+extern Expr *compareValue (int attr, Value *value, OpType op);
+extern Expr *compareValueFirst (Value *value, int attr, OpType op);
+
+// left op right, or NOT left
+extern Expr *combine (Expr *left, Expr *right, OpType op);
+
+// RID stored for a key by the index tests, and the keys 0 .. size - 1 in
+// random order
+extern RID ridFor (int key);
+extern int *createPermutation (int size);
+
+#endif // TEST_UTIL_H
@@ -0,0 +1,1128 @@
+#include "ts_mgr.h"
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+#include "norm_key.h"
+#include "record_mgr.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Time-series storage of a table
+//
+// Page 0 is a TS_Header and page 1 the tail page, which holds the newest
+// records as they were inserted. Closed blocks are packed one after the
+// other into pack pages. A block that does not fit the rest of the current
+// pack page goes on in the page after it if that is free or new, and else
+// starts on a free or new page of its own. The block directory, one
+// TS_Block per block in insert order, is kept in memory and written after
+// the pack pages when the table is closed, in whole pages reused as long
+// as the directory fits into them; the numbers of the free pages follow
+// the blocks.
+//
+// A block holds its records column by column. An INT column starts with
+// the first value, then the first delta, then the difference between each
+// delta and the one before, all as zigzag varints, so a regular interval
+// costs a byte per record. A FLOAT column holds the XOR of each value with
+// the one before, as a control byte (leading and trailing zero bytes) and
+// the bytes in between: a value that does not change costs a byte. STRING
+// and BOOL columns are stored as they are. This is the delta-of-delta and
+// XOR scheme of in-memory time-series stores, at byte instead of bit
+// granularity. A block whose encoding would not be smaller than its
+// records is stored as the records.
+//
+// With a TTL, records whose time is below the current time minus the TTL
+// have expired. A block whose maximum time has expired is skipped by scans
+// and lookups without being read, and only the records of a block that
+// straddles the expiry time are compared one by one. tsReclaim removes the
+// expired blocks at the start of the directory and puts the pages they
+// alone held on a free list, dropping them from the buffer pool unwritten;
+// the next blocks are packed into those pages before the file grows.
+
+#define TS_POOL_SIZE 16
+#define TS_TAIL_PAGE 1
+
+// Storage header, stored at the start of page 0
+typedef struct TS_Header {
+    int recordSize;
+    int timeAttr;
+    int numPages;
+    int numTuples;      // records, those in the tail page included
+    int numBlocks;
+    int packPage;       // page the next block is packed into, -1 before the first block
+    int packUsed;       // bytes of it in use
+    int tailCount;      // records in the tail page
+    int dirPage;        // first page of the block directory, -1 for none
+    int dirPages;
+    int ttl;            // time a record lives, 0 for ever
+    int firstRow;       // row of the oldest record not reclaimed
+    int numFree;        // pages freed by reclaimed blocks
+} TS_Header;
+
+// Directory entry of a closed block
+typedef struct TS_Block {
+    int page;
+    int offset;
+    int bytes;
+    int count;
+    int firstRow;       // row of its first record
+    int minTime;        // range of the time attribute
+    int maxTime;
+    int encoded;        // false if it holds the records as they are
+} TS_Block;
+
+struct TS_Table {
+    Schema *schema;
+    char *file;         // name of the page file, kept by the buffer pool
+    TS_Header header;
+    SM_FileHandle fh;
+    BM_BufferPool pool;
+    BM_PageHandle tail; // tail page, pinned while the table is open
+    bool tailDirty;     // tail page marked dirty since it was pinned
+    int tailMin;        // range of the time attribute in the tail page
+    int tailMax;
+    int rowsPerTail;
+    int *offsets;       // of the attributes in a record, and the record size
+    TS_Block *blocks;
+    int blockCapacity;
+    int *freePages;     // pages to pack blocks into before the file grows
+    int freeCapacity;
+    unsigned char *buffer;  // encoding of the block being closed
+    int cachedBlock;    // block decoded into rows for tsGet, -1 for none
+    char *rows;
+    int activeScans;
+    pthread_mutex_t latch;  // orders tsReclaim, run by a background task, with the other calls
+};
+
+struct TS_Scan {
+    TS_Table *table;
+    bool bounded;       // only records with the time attribute in [low, high]
+    long long low;
+    long long high;
+    int numBlocks;      // blocks when the scan started
+    int block;          // next block to look at
+    int selected;       // blocks overlapping the range
+    bool checkRows;     // compare the time of every record of the current block
+    char *rows;         // decoded records of the current block
+    char *tail;         // the tail page when the scan started
+    int tailCount;
+    int tailFirst;      // row of its first record
+    bool tailCheck;     // checkRows for the tail page
+    bool tailDone;
+    char *current;      // rows or tail
+    int count;
+    int pos;
+    int firstRow;
+};
+
+/* ---------------------------------------------------------------------- */
+/* Helpers                                                                 */
+/* ---------------------------------------------------------------------- */
+
+static char *fileName(char *name) {
+    int len = strlen(name) + 8;
+    char *result = (char *) malloc(len);
+
+    if (result != NULL)
+        snprintf(result, len, "%s.ts", name);
+    return result;
+}
+
+static int timeOf(TS_Table *t, const char *record) {
+    int time;
+
+    memcpy(&time, record + t->offsets[t->header.timeAttr], sizeof(int));
+    return time;
+}
+
+// Lowest time of a record that has not expired at now
+static long long expiryOf(TS_Table *t, int now) {
+    return t->header.ttl > 0 ? (long long) now - t->header.ttl : LLONG_MIN;
+}
+
+static int putVarint(unsigned char *out, unsigned long long v) {
+    int n = 0;
+    while (v >= 0x80) {
+        out[n++] = (unsigned char) (v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char) v;
+    return n;
+}
+
+static int getVarint(const unsigned char *in, unsigned long long *v) {
+    int n = 0, shift = 0;
+    *v = 0;
+    do {
+        *v |= (unsigned long long) (in[n] & 0x7f) << shift;
+        shift += 7;
+    } while (in[n++] & 0x80);
+    return n;
+}
+
+static unsigned long long zigzag(long long v) {
+    return ((unsigned long long) v << 1) ^ (unsigned long long) (v >> 63);
+}
+
+static long long unzigzag(unsigned long long v) {
+    return (long long) (v >> 1) ^ -(long long) (v & 1);
+}
+
+// encodeBlock
+/**
+ * Encodes records column by column.
+ *
+ * @param t The table.
+ * @param rows The records.
+ * @param count Number of records.
+ * @param out Receives the encoding.
+ * @param limit Bytes of out that may be used.
+ * @return The bytes of the encoding, or -1 if it needs more than limit.
+ */
+static int encodeBlock(TS_Table *t, const char *rows, int count, unsigned char *out, int limit) {
+    Schema *schema = t->schema;
+    int recordSize = t->header.recordSize, n = 0, attr, i;
+
+    for (attr = 0; attr < schema->numAttr; attr++) {
+        const char *column = rows + t->offsets[attr];
+        int size = t->offsets[attr + 1] - t->offsets[attr];
+
+        if (schema->dataTypes[attr] == DT_INT) {
+            long long prev = 0, prevDelta = 0;
+            for (i = 0; i < count; i++) {
+                int v;
+                memcpy(&v, column + i * recordSize, sizeof(int));
+                long long delta = (long long) v - prev;
+                if (n + 10 > limit)
+                    return -1;
+                n += putVarint(out + n, zigzag(delta - prevDelta));
+                prev = v;
+                prevDelta = i == 0 ? 0 : delta;
+            }
+        } else if (schema->dataTypes[attr] == DT_FLOAT) {
+            unsigned int prev = 0;
+            for (i = 0; i < count; i++) {
+                unsigned int bits, x;
+                int lead, trail, b;
+                memcpy(&bits, column + i * recordSize, sizeof(unsigned int));
+                x = bits ^ prev;
+                prev = bits;
+                if (n + 5 > limit)
+                    return -1;
+                if (x == 0) {
+                    out[n++] = 4 << 4;
+                    continue;
+                }
+                for (lead = 0; lead < 3 && ((x >> (24 - 8 * lead)) & 0xff) == 0; lead++)
+                    ;
+                for (trail = 0; trail < 3 && ((x >> (8 * trail)) & 0xff) == 0; trail++)
+                    ;
+                out[n++] = (unsigned char) (lead << 4 | trail);
+                for (b = 3 - lead; b >= trail; b--)
+                    out[n++] = (unsigned char) (x >> (8 * b));
+            }
+        } else {
+            for (i = 0; i < count; i++) {
+                if (n + size > limit)
+                    return -1;
+                memcpy(out + n, column + i * recordSize, size);
+                n += size;
+            }
+        }
+    }
+    return n;
+}
+
+// Decode the records of a block encoded by encodeBlock
+static void decodeBlock(TS_Table *t, const unsigned char *in, int count, char *rows) {
+    Schema *schema = t->schema;
+    int recordSize = t->header.recordSize, n = 0, attr, i;
+
+    for (attr = 0; attr < schema->numAttr; attr++) {
+        char *column = rows + t->offsets[attr];
+        int size = t->offsets[attr + 1] - t->offsets[attr];
+
+        if (schema->dataTypes[attr] == DT_INT) {
+            long long prev = 0, prevDelta = 0;
+            for (i = 0; i < count; i++) {
+                unsigned long long x;
+                n += getVarint(in + n, &x);
+                long long delta = unzigzag(x) + prevDelta;
+                int v = (int) (prev + delta);
+                memcpy(column + i * recordSize, &v, sizeof(int));
+                prev = v;
+                prevDelta = i == 0 ? 0 : delta;
+            }
+        } else if (schema->dataTypes[attr] == DT_FLOAT) {
+            unsigned int prev = 0;
+            for (i = 0; i < count; i++) {
+                int lead = in[n] >> 4, trail = in[n] & 0xf, b;
+                unsigned int x = 0;
+                n++;
+                for (b = 3 - lead; lead < 4 && b >= trail; b--)
+                    x |= (unsigned int) in[n++] << (8 * b);
+                prev ^= x;
+                memcpy(column + i * recordSize, &prev, sizeof(unsigned int));
+            }
+        } else {
+            for (i = 0; i < count; i++) {
+                memcpy(column + i * recordSize, in + n, size);
+                n += size;
+            }
+        }
+    }
+}
+
+// Last page a block is stored on, the page after its first if it goes on there
+static int lastPage(TS_Block *block) {
+    return block->page + (block->offset + block->bytes - 1) / PAGE_SIZE;
+}
+
+// Read the records of a block into rows
+static RC loadBlock(TS_Table *t, TS_Block *block, char *rows, BM_PageHint hint) {
+    unsigned char *in = t->buffer;
+    BM_PageHandle page;
+    int done = 0, offset = block->offset, i;
+    RC rc;
+
+    for (i = 0; done < block->bytes; i++, offset = 0) {
+        int len = block->bytes - done < PAGE_SIZE - offset ? block->bytes - done : PAGE_SIZE - offset;
+        if ((rc = pinPageWithHint(&t->pool, &page, block->page + i, hint)) != RC_OK)
+            return rc;
+        memcpy(in + done, page.data + offset, len);
+        unpinPage(&t->pool, &page);
+        done += len;
+    }
+    if (block->encoded)
+        decodeBlock(t, in, block->count, rows);
+    else
+        memcpy(rows, in, block->bytes);
+    return RC_OK;
+}
+
+// Index of a page in the free list, -1 if it is not free
+static int freeIndex(TS_Table *t, int page) {
+    int i;
+
+    for (i = 0; i < t->header.numFree; i++) {
+        if (t->freePages[i] == page)
+            return i;
+    }
+    return -1;
+}
+
+// Take entry i off the free list and return its page
+static int takeFree(TS_Table *t, int i) {
+    int page = t->freePages[i];
+
+    t->freePages[i] = t->freePages[--t->header.numFree];
+    return page;
+}
+
+// Make the directory hold one more block
+static RC reserveBlock(TS_Table *t) {
+    int capacity = t->blockCapacity > 0 ? t->blockCapacity * 2 : 64;
+    TS_Block *grown;
+
+    if (t->header.numBlocks < t->blockCapacity)
+        return RC_OK;
+    grown = (TS_Block *) realloc(t->blocks, capacity * sizeof(TS_Block));
+    if (grown == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    t->blocks = grown;
+    t->blockCapacity = capacity;
+    return RC_OK;
+}
+
+// closeTail
+/**
+ * Encodes the records of the full tail page into a block, packs it behind
+ * the blocks before it and empties the tail page.
+ *
+ * @param t The table.
+ * @return RC_OK, or an error code.
+ */
+static RC closeTail(TS_Table *t) {
+    int count = t->header.tailCount, raw = count * t->header.recordSize;
+    int bytes = encodeBlock(t, t->tail.data, count, t->buffer, raw);
+    bool encoded = bytes >= 0;
+    int offset, done, next, lowest, i;
+    BM_PageHandle page;
+    TS_Block *block;
+    RC rc;
+
+    if ((rc = reserveBlock(t)) != RC_OK)
+        return rc;
+    if (!encoded) {
+        memcpy(t->buffer, t->tail.data, raw);
+        bytes = raw;
+    }
+    // a block goes on in the next page if that is free or a new page at the
+    // end of the file, and else starts the lowest free page or a new one
+    next = t->header.packPage + 1;
+    if (t->header.packPage < 0 || (t->header.packUsed + bytes > PAGE_SIZE
+            && next != t->header.numPages && freeIndex(t, next) < 0)) {
+        for (i = 0, lowest = -1; i < t->header.numFree; i++) {
+            if (lowest < 0 || t->freePages[i] < t->freePages[lowest])
+                lowest = i;
+        }
+        t->header.packPage = lowest >= 0 ? takeFree(t, lowest) : t->header.numPages++;
+        t->header.packUsed = 0;
+    } else if (t->header.packUsed + bytes > PAGE_SIZE) {
+        if (next == t->header.numPages)
+            t->header.numPages++;
+        else
+            takeFree(t, freeIndex(t, next));
+    }
+    if ((rc = ensureCapacity(t->header.numPages, &t->fh)) != RC_OK)
+        return rc;
+    for (offset = t->header.packUsed, done = 0, i = 0; done < bytes; i++, offset = 0) {
+        int len = bytes - done < PAGE_SIZE - offset ? bytes - done : PAGE_SIZE - offset;
+        if ((rc = pinPage(&t->pool, &page, t->header.packPage + i)) != RC_OK)
+            return rc;
+        memcpy(page.data + offset, t->buffer + done, len);
+        markDirty(&t->pool, &page);
+        unpinPage(&t->pool, &page);
+        done += len;
+    }
+
+    block = &t->blocks[t->header.numBlocks++];
+    block->page = t->header.packPage;
+    block->offset = t->header.packUsed;
+    block->bytes = bytes;
+    block->count = count;
+    block->firstRow = t->header.numTuples - count;
+    block->minTime = t->tailMin;
+    block->maxTime = t->tailMax;
+    block->encoded = encoded;
+    t->header.packPage = lastPage(block);
+    t->header.packUsed = (block->offset + bytes - 1) % PAGE_SIZE + 1;
+    t->header.tailCount = 0;
+    return RC_OK;
+}
+
+// Read the block directory and the free pages written by writeDirectory
+static RC readDirectory(TS_Table *t) {
+    int blockBytes = t->header.numBlocks * sizeof(TS_Block);
+    int bytes = blockBytes + t->header.numFree * sizeof(int), done = 0, i;
+    BM_PageHandle page;
+    char *dir;
+    RC rc = RC_OK;
+
+    t->blockCapacity = t->header.numBlocks > 0 ? t->header.numBlocks : 64;
+    t->freeCapacity = t->header.numFree > 0 ? t->header.numFree : 16;
+    t->blocks = (TS_Block *) malloc(t->blockCapacity * sizeof(TS_Block));
+    t->freePages = (int *) malloc(t->freeCapacity * sizeof(int));
+    dir = (char *) malloc(bytes > 0 ? bytes : 1);
+    if (t->blocks == NULL || t->freePages == NULL || dir == NULL) {
+        free(dir);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    for (i = 0; done < bytes; i++) {
+        int len = bytes - done < PAGE_SIZE ? bytes - done : PAGE_SIZE;
+        if ((rc = pinPage(&t->pool, &page, t->header.dirPage + i)) != RC_OK)
+            break;
+        memcpy(dir + done, page.data, len);
+        unpinPage(&t->pool, &page);
+        done += len;
+    }
+    memcpy(t->blocks, dir, blockBytes);
+    memcpy(t->freePages, dir + blockBytes, bytes - blockBytes);
+    free(dir);
+    return rc;
+}
+
+// Write the block directory and the free pages, to new pages at the end of the file if they outgrew their pages
+static RC writeDirectory(TS_Table *t) {
+    int blockBytes = t->header.numBlocks * sizeof(TS_Block);
+    int bytes = blockBytes + t->header.numFree * sizeof(int), done = 0, i;
+    int pages = (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    BM_PageHandle page;
+    char *dir;
+    RC rc = RC_OK;
+
+    if (pages > t->header.dirPages) {
+        t->header.dirPage = t->header.numPages;
+        t->header.dirPages = pages;
+        t->header.numPages += pages;
+        if ((rc = ensureCapacity(t->header.numPages, &t->fh)) != RC_OK)
+            return rc;
+    }
+    dir = (char *) malloc(bytes > 0 ? bytes : 1);
+    if (dir == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    memcpy(dir, t->blocks, blockBytes);
+    memcpy(dir + blockBytes, t->freePages, bytes - blockBytes);
+    for (i = 0; done < bytes; i++) {
+        int len = bytes - done < PAGE_SIZE ? bytes - done : PAGE_SIZE;
+        if ((rc = pinPage(&t->pool, &page, t->header.dirPage + i)) != RC_OK)
+            break;
+        memcpy(page.data, dir + done, len);
+        markDirty(&t->pool, &page);
+        unpinPage(&t->pool, &page);
+        done += len;
+    }
+    free(dir);
+    return rc;
+}
+
+// Write the header to page 0
+static RC writeHeader(TS_Table *t) {
+    BM_PageHandle page;
+    RC rc;
+
+    if ((rc = pinPageWithHint(&t->pool, &page, 0, BM_HINT_HOT)) != RC_OK)
+        return rc;
+    memcpy(page.data, &t->header, sizeof(TS_Header));
+    markDirty(&t->pool, &page);
+    unpinPage(&t->pool, &page);
+    return RC_OK;
+}
+
+// Pin the tail page and find the range of the time attribute in it
+static RC pinTail(TS_Table *t) {
+    RC rc;
+    int i;
+
+    if ((rc = pinPageWithHint(&t->pool, &t->tail, TS_TAIL_PAGE, BM_HINT_HOT)) != RC_OK)
+        return rc;
+    t->tailDirty = false;
+    for (i = 0; i < t->header.tailCount; i++) {
+        int time = timeOf(t, t->tail.data + i * t->header.recordSize);
+        if (i == 0 || time < t->tailMin)
+            t->tailMin = time;
+        if (i == 0 || time > t->tailMax)
+            t->tailMax = time;
+    }
+    return RC_OK;
+}
+
+static void freeTable(TS_Table *t) {
+    free(t->offsets);
+    free(t->blocks);
+    free(t->freePages);
+    free(t->buffer);
+    free(t->rows);
+    free(t->file);
+    pthread_mutex_destroy(&t->latch);
+    free(t);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Storage                                                                 */
+/* ---------------------------------------------------------------------- */
+
+// tsCreate
+/**
+ * Creates the storage of a table: the header and an empty tail page.
+ *
+ * @param name Name of the table.
+ * @param schema Its schema.
+ * @param timeAttr The time attribute.
+ * @param ttl Time a record lives, in the unit of the time attribute; 0
+ *        keeps records for ever.
+ * @return RC_OK, RC_INVALID_ARGS if timeAttr is not an INT attribute, ttl
+ *         is negative or a tail page cannot hold two records, or an error
+ *         code.
+ */
+RC tsCreate(char *name, Schema *schema, int timeAttr, int ttl) {
+    char *file;
+    TS_Header header;
+    SM_FileHandle fh;
+    char *page;
+    RC rc;
+
+    if (timeAttr < 0 || timeAttr >= schema->numAttr || schema->dataTypes[timeAttr] != DT_INT
+            || ttl < 0 || 2 * getRecordSize(schema) > PAGE_SIZE)
+        return RC_INVALID_ARGS;
+    memset(&header, 0, sizeof(header));
+    header.recordSize = getRecordSize(schema);
+    header.timeAttr = timeAttr;
+    header.ttl = ttl;
+    header.numPages = 2;
+    header.packPage = -1;
+    header.dirPage = -1;
+
+    file = fileName(name);
+    page = (char *) calloc(PAGE_SIZE, sizeof(char));
+    if (file == NULL || page == NULL) {
+        free(file);
+        free(page);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    rc = createPageFile(file);
+    if (rc == RC_OK)
+        rc = openPageFile(file, &fh);
+    free(file);
+    if (rc == RC_OK) {
+        if ((rc = ensureCapacity(2, &fh)) == RC_OK) {
+            memcpy(page, &header, sizeof(header));
+            rc = writeBlock(0, &fh, page);
+        }
+        closePageFile(&fh);
+    }
+    free(page);
+    return rc;
+}
+
+// Check whether a table keeps its records in time-series storage
+bool tsExists(char *name) {
+    char *file = fileName(name);
+    FILE *f;
+
+    if (file == NULL)
+        return false;
+    f = fopen(file, "rb");
+    free(file);
+    if (f == NULL)
+        return false;
+    fclose(f);
+    return true;
+}
+
+// tsOpen
+/**
+ * Opens the storage of a table, reads its block directory and pins the
+ * tail page.
+ *
+ * @param name Name of the table.
+ * @param schema Its schema, which must outlive the open storage.
+ * @param table Receives the open storage; release it with tsClose.
+ * @return RC_OK, RC_INVALID_ARGS if the schema does not fit the file, or an
+ *         error code.
+ */
+RC tsOpen(char *name, Schema *schema, TS_Table **table) {
+    char *file = fileName(name);
+    BM_PageHandle page;
+    TS_Table *t;
+    RC rc;
+    int i;
+
+    *table = NULL;
+    t = (TS_Table *) calloc(1, sizeof(TS_Table));
+    if (file == NULL || t == NULL) {
+        free(file);
+        free(t);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    pthread_mutex_init(&t->latch, NULL);
+    t->file = file;
+    t->schema = schema;
+    t->cachedBlock = -1;
+    t->offsets = (int *) malloc((schema->numAttr + 1) * sizeof(int));
+    t->buffer = (unsigned char *) malloc(PAGE_SIZE);
+    t->rows = (char *) malloc(PAGE_SIZE);
+    if (t->offsets == NULL || t->buffer == NULL || t->rows == NULL) {
+        freeTable(t);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    for (i = 0; i <= schema->numAttr; i++)
+        attrOffset(schema, i, &t->offsets[i]);
+    if ((rc = openPageFile(file, &t->fh)) != RC_OK) {
+        freeTable(t);
+        return rc;
+    }
+    if ((rc = initBufferPool(&t->pool, file, TS_POOL_SIZE, RS_LRU, NULL)) != RC_OK) {
+        closePageFile(&t->fh);
+        freeTable(t);
+        return rc;
+    }
+
+    if ((rc = pinPageWithHint(&t->pool, &page, 0, BM_HINT_HOT)) == RC_OK) {
+        memcpy(&t->header, page.data, sizeof(TS_Header));
+        unpinPage(&t->pool, &page);
+        if (t->header.recordSize != getRecordSize(schema) || t->header.timeAttr >= schema->numAttr
+                || schema->dataTypes[t->header.timeAttr] != DT_INT)
+            rc = RC_INVALID_ARGS;
+    }
+    if (rc == RC_OK) {
+        t->rowsPerTail = PAGE_SIZE / t->header.recordSize;
+        rc = readDirectory(t);
+    }
+    if (rc == RC_OK)
+        rc = pinTail(t);
+    if (rc != RC_OK) {
+        shutdownBufferPool(&t->pool);
+        closePageFile(&t->fh);
+        freeTable(t);
+        return rc;
+    }
+    *table = t;
+    return RC_OK;
+}
+
+// tsClose
+/**
+ * Writes the block directory, the header and the dirty pages, the tail
+ * page included, and releases the storage.
+ *
+ * @param table The storage.
+ * @return RC_OK, or the error of the storage or buffer manager.
+ */
+RC tsClose(TS_Table *table) {
+    RC rc;
+
+    if ((rc = writeDirectory(table)) != RC_OK || (rc = writeHeader(table)) != RC_OK)
+        return rc;
+    unpinPage(&table->pool, &table->tail);
+    if ((rc = shutdownBufferPool(&table->pool)) != RC_OK)
+        return rc;
+    closePageFile(&table->fh);
+    freeTable(table);
+    return RC_OK;
+}
+
+// Remove the file of the storage of a table
+RC tsDestroy(char *name) {
+    char *file = fileName(name);
+    RC rc;
+
+    if (file == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    rc = destroyPageFile(file);
+    free(file);
+    return rc;
+}
+
+// tsTruncate
+/**
+ * Removes every record: the cached pages are dropped without being
+ * written, the file is cut back to the header and the tail page, and the
+ * directory is emptied.
+ *
+ * @param table The storage.
+ * @return RC_OK, RC_INVALID_ARGS while a scan is open, or an error code.
+ */
+RC tsTruncate(TS_Table *table) {
+    RC rc;
+
+    pthread_mutex_lock(&table->latch);
+    if (table->activeScans > 0) {
+        pthread_mutex_unlock(&table->latch);
+        return RC_INVALID_ARGS;
+    }
+    unpinPage(&table->pool, &table->tail);
+    if ((rc = discardPages(&table->pool, 0)) != RC_OK || (rc = truncatePageFile(2, &table->fh)) != RC_OK) {
+        pthread_mutex_unlock(&table->latch);
+        return rc;
+    }
+
+    table->header.numPages = 2;
+    table->header.numTuples = 0;
+    table->header.numBlocks = 0;
+    table->header.packPage = -1;
+    table->header.packUsed = 0;
+    table->header.tailCount = 0;
+    table->header.dirPage = -1;
+    table->header.dirPages = 0;
+    table->header.firstRow = 0;
+    table->header.numFree = 0;
+    table->cachedBlock = -1;
+    if ((rc = writeHeader(table)) == RC_OK)
+        rc = pinTail(table);
+    pthread_mutex_unlock(&table->latch);
+    return rc;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Records                                                                 */
+/* ---------------------------------------------------------------------- */
+
+// tsInsert
+/**
+ * Appends a record to the tail page, closing the tail page first if it is
+ * full.
+ *
+ * @param table The storage.
+ * @param data The record.
+ * @param rid Receives its RID.
+ * @return RC_OK, or an error code.
+ */
+RC tsInsert(TS_Table *table, char *data, RID *rid) {
+    int recordSize = table->header.recordSize, time;
+    RC rc;
+
+    pthread_mutex_lock(&table->latch);
+    if (table->header.tailCount == table->rowsPerTail && (rc = closeTail(table)) != RC_OK) {
+        pthread_mutex_unlock(&table->latch);
+        return rc;
+    }
+    memcpy(table->tail.data + table->header.tailCount * recordSize, data, recordSize);
+    if (!table->tailDirty) {
+        markDirty(&table->pool, &table->tail);
+        table->tailDirty = true;
+    }
+
+    time = timeOf(table, data);
+    if (table->header.tailCount == 0 || time < table->tailMin)
+        table->tailMin = time;
+    if (table->header.tailCount == 0 || time > table->tailMax)
+        table->tailMax = time;
+    rid->page = table->header.numTuples;
+    rid->slot = 0;
+    table->header.tailCount++;
+    table->header.numTuples++;
+    pthread_mutex_unlock(&table->latch);
+    return RC_OK;
+}
+
+// tsGet
+/**
+ * Copies the record with a RID into data. Reading the records of one block
+ * one after the other decodes the block once; a block whose records have
+ * all expired is not read.
+ *
+ * @param table The storage.
+ * @param rid The RID.
+ * @param now The current time, in the unit of the time attribute.
+ * @param data Receives the record.
+ * @return RC_OK, RC_RM_RECORD_NOT_EXIST if there is no such record or it
+ *         has expired, or an error code.
+ */
+RC tsGet(TS_Table *table, RID rid, int now, char *data) {
+    int recordSize = table->header.recordSize, row = rid.page;
+    int tailFirst, lo = 0, hi;
+    long long expiry;
+    TS_Block *block;
+    RC rc = RC_OK;
+
+    pthread_mutex_lock(&table->latch);
+    tailFirst = table->header.numTuples - table->header.tailCount;
+    expiry = expiryOf(table, now);
+    if (rid.slot != 0 || row < 0 || row >= table->header.numTuples) {
+        pthread_mutex_unlock(&table->latch);
+        return RC_RM_RECORD_NOT_EXIST;
+    }
+    if (row >= tailFirst) {
+        memcpy(data, table->tail.data + (row - tailFirst) * recordSize, recordSize);
+        pthread_mutex_unlock(&table->latch);
+        return timeOf(table, data) < expiry ? RC_RM_RECORD_NOT_EXIST : RC_OK;
+    }
+
+    // the last block starting at or before the row; reclaimed rows have none
+    hi = table->header.numBlocks;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (table->blocks[mid].firstRow <= row)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    block = lo > 0 ? &table->blocks[lo - 1] : NULL;
+    if (block == NULL || row >= block->firstRow + block->count || block->maxTime < expiry)
+        rc = RC_RM_RECORD_NOT_EXIST;
+    if (rc == RC_OK && table->cachedBlock != lo - 1) {
+        table->cachedBlock = -1;
+        if ((rc = loadBlock(table, block, table->rows, BM_HINT_NORMAL)) == RC_OK)
+            table->cachedBlock = lo - 1;
+    }
+    if (rc == RC_OK) {
+        memcpy(data, table->rows + (row - block->firstRow) * recordSize, recordSize);
+        if (timeOf(table, data) < expiry)
+            rc = RC_RM_RECORD_NOT_EXIST;
+    }
+    pthread_mutex_unlock(&table->latch);
+    return rc;
+}
+
+// Number of records of a table, expired ones included until they are reclaimed
+int tsNumTuples(TS_Table *table) {
+    int numTuples;
+
+    pthread_mutex_lock(&table->latch);
+    numTuples = table->header.numTuples - table->header.firstRow;
+    pthread_mutex_unlock(&table->latch);
+    return numTuples;
+}
+
+// Number of closed blocks of a table
+int tsNumBlocks(TS_Table *table) {
+    int numBlocks;
+
+    pthread_mutex_lock(&table->latch);
+    numBlocks = table->header.numBlocks;
+    pthread_mutex_unlock(&table->latch);
+    return numBlocks;
+}
+
+// Time a record of a table lives, 0 for ever
+int tsTtl(TS_Table *table) {
+    int ttl;
+
+    pthread_mutex_lock(&table->latch);
+    ttl = table->header.ttl;
+    pthread_mutex_unlock(&table->latch);
+    return ttl;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Expiry                                                                  */
+/* ---------------------------------------------------------------------- */
+
+// tsReclaim
+/**
+ * Removes the blocks at the start of the directory whose records have all
+ * expired by now. The pages no other block uses are dropped from the
+ * buffer pool without being written and go to the free list. Nothing is
+ * removed while a scan is open, as the scan may still be reading the
+ * blocks.
+ *
+ * @param table The storage.
+ * @param now The current time, in the unit of the time attribute.
+ * @param pages Receives the number of pages freed.
+ * @return RC_OK, or an error code.
+ */
+RC tsReclaim(TS_Table *table, int now, int *pages) {
+    long long expiry;
+    int numBlocks, expired = 0, page, i;
+    char *used;
+    RC rc = RC_OK;
+
+    // tsInsert closes blocks concurrently; the directory is read under the latch
+    *pages = 0;
+    pthread_mutex_lock(&table->latch);
+    expiry = expiryOf(table, now);
+    numBlocks = table->header.numBlocks;
+    while (expired < numBlocks && table->blocks[expired].maxTime < expiry)
+        expired++;
+    if (expired == 0 || table->activeScans > 0) {
+        pthread_mutex_unlock(&table->latch);
+        return RC_OK;
+    }
+    used = (char *) calloc(table->header.numPages, sizeof(char));
+    if (used == NULL) {
+        pthread_mutex_unlock(&table->latch);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+
+    // pages still holding blocks, or free already
+    for (i = expired; i < numBlocks; i++) {
+        for (page = table->blocks[i].page; page <= lastPage(&table->blocks[i]); page++)
+            used[page] = true;
+    }
+    if (table->header.packPage >= 0)
+        used[table->header.packPage] = true;
+    for (i = 0; i < table->header.numFree; i++)
+        used[table->freePages[i]] = true;
+
+    for (i = 0; i < expired && rc == RC_OK; i++) {
+        TS_Block *block = &table->blocks[i];
+        for (page = block->page; page <= lastPage(block) && rc == RC_OK; page++) {
+            if (used[page])
+                continue;
+            if (table->header.numFree == table->freeCapacity) {
+                int *grown = (int *) realloc(table->freePages, 2 * table->freeCapacity * sizeof(int));
+                if (grown == NULL) {
+                    rc = RC_MEM_ALLOCATION_FAIL;
+                    break;
+                }
+                table->freePages = grown;
+                table->freeCapacity *= 2;
+            }
+            if ((rc = discardPage(&table->pool, page)) != RC_OK)
+                break;
+            used[page] = true;
+            table->freePages[table->header.numFree++] = page;
+            (*pages)++;
+        }
+    }
+    free(used);
+
+    // the blocks go even if freeing their pages failed; those pages are lost
+    table->header.firstRow = expired < numBlocks ? table->blocks[expired].firstRow
+                                                 : table->header.numTuples - table->header.tailCount;
+    memmove(table->blocks, table->blocks + expired, (numBlocks - expired) * sizeof(TS_Block));
+    table->header.numBlocks -= expired;
+    table->cachedBlock = -1;
+    pthread_mutex_unlock(&table->latch);
+    return rc;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Scans                                                                   */
+/* ---------------------------------------------------------------------- */
+
+// boundsOf
+/**
+ * Narrows [low, high] to the range of the time attribute a condition lets
+ * through, see normKeyRange.
+ *
+ * @param t The table.
+ * @param cond The condition.
+ * @param low Lowest time to return, raised by the condition.
+ * @param high Highest time to return, lowered by the condition.
+ * @param bounded Set if the condition bounds the range.
+ * @return RC_OK, or an error code.
+ */
+static RC boundsOf(TS_Table *t, Expr *cond, long long *low, long long *high, bool *bounded) {
+    char lowKey[sizeof(int)], highKey[sizeof(int)];
+    NK_Range range = { .low = lowKey, .high = highKey };
+    Value *v;
+    RC rc;
+
+    if ((rc = normKeyRange(t->schema, t->header.timeAttr, cond, &range)) != RC_OK)
+        return rc;
+    if (range.hasLow) {
+        if ((rc = denormalizeValue(lowKey, DT_INT, 0, &v)) != RC_OK)
+            return rc;
+        *low = (long long) v->v.intV + (range.lowStrict ? 1 : 0);
+        freeVal(v);
+    }
+    if (range.hasHigh) {
+        if ((rc = denormalizeValue(highKey, DT_INT, 0, &v)) != RC_OK)
+            return rc;
+        *high = (long long) v->v.intV - (range.highStrict ? 1 : 0);
+        freeVal(v);
+    }
+    *bounded = range.hasLow || range.hasHigh;
+    return RC_OK;
+}
+
+static bool overlaps(TS_Scan *scan, int minTime, int maxTime) {
+    return !scan->bounded || (maxTime >= scan->low && minTime <= scan->high);
+}
+
+// Whether some records with times in [minTime, maxTime] may fall outside the range of a scan
+static bool straddles(TS_Scan *scan, int minTime, int maxTime) {
+    return scan->bounded && (minTime < scan->low || maxTime > scan->high);
+}
+
+// tsOpenScan
+/**
+ * Starts a scan of the blocks closed so far and of a copy of the tail
+ * page; records inserted later are not returned, nor are records that
+ * have expired by now.
+ *
+ * @param table The storage.
+ * @param cond Condition of the scan, NULL for every record.
+ * @param now The current time, in the unit of the time attribute.
+ * @param scan Receives the scan; release it with tsCloseScan.
+ * @return RC_OK, or an error code.
+ */
+RC tsOpenScan(TS_Table *table, Expr *cond, int now, TS_Scan **scan) {
+    long long expiry;
+    TS_Scan *s;
+    int i;
+    RC rc;
+
+    *scan = NULL;
+    s = (TS_Scan *) calloc(1, sizeof(TS_Scan));
+    if (s == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    s->table = table;
+    s->rows = (char *) malloc(PAGE_SIZE);
+    s->tail = (char *) malloc(PAGE_SIZE);
+    if (s->rows == NULL || s->tail == NULL) {
+        free(s->rows);
+        free(s->tail);
+        free(s);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    s->low = -2147483648LL;
+    s->high = 2147483647LL;
+    if (cond != NULL && (rc = boundsOf(table, cond, &s->low, &s->high, &s->bounded)) != RC_OK) {
+        free(s->rows);
+        free(s->tail);
+        free(s);
+        return rc;
+    }
+
+    pthread_mutex_lock(&table->latch);
+    expiry = expiryOf(table, now);
+    if (expiry > s->low) {
+        s->low = expiry;
+        s->bounded = true;
+    }
+    s->numBlocks = table->header.numBlocks;
+    for (i = 0; i < s->numBlocks; i++) {
+        if (overlaps(s, table->blocks[i].minTime, table->blocks[i].maxTime))
+            s->selected++;
+    }
+    memcpy(s->tail, table->tail.data, table->header.tailCount * table->header.recordSize);
+    s->tailCount = table->header.tailCount;
+    s->tailFirst = table->header.numTuples - table->header.tailCount;
+    s->tailDone = s->tailCount == 0 || !overlaps(s, table->tailMin, table->tailMax);
+    s->tailCheck = straddles(s, table->tailMin, table->tailMax);
+    table->activeScans++;
+    pthread_mutex_unlock(&table->latch);
+    *scan = s;
+    return RC_OK;
+}
+
+// tsNext
+/**
+ * Returns the next record of a scan within the time range of its
+ * condition.
+ *
+ * @param scan The scan.
+ * @param rid Receives the RID of the record.
+ * @param data Receives the record, valid until the next call.
+ * @return RC_OK, RC_RM_NO_MORE_TUPLES, or an error code.
+ */
+RC tsNext(TS_Scan *scan, RID *rid, char **data) {
+    TS_Table *t = scan->table;
+    int recordSize = t->header.recordSize;
+    RC rc;
+
+    while (true) {
+        while (scan->pos < scan->count) {
+            char *record = scan->current + scan->pos * recordSize;
+            int row = scan->firstRow + scan->pos++;
+            if (scan->checkRows) {
+                int time = timeOf(t, record);
+                if (time < scan->low || time > scan->high)
+                    continue;
+            }
+            rid->page = row;
+            rid->slot = 0;
+            *data = record;
+            return RC_OK;
+        }
+
+        if (scan->block < scan->numBlocks) {
+            // a copy, an insert closing the tail may move the directory
+            TS_Block block;
+            pthread_mutex_lock(&t->latch);
+            block = t->blocks[scan->block++];
+            if (!overlaps(scan, block.minTime, block.maxTime)) {
+                pthread_mutex_unlock(&t->latch);
+                continue;
+            }
+            rc = loadBlock(t, &block, scan->rows, BM_HINT_SCAN);
+            pthread_mutex_unlock(&t->latch);
+            if (rc != RC_OK)
+                return rc;
+            scan->checkRows = straddles(scan, block.minTime, block.maxTime);
+            scan->current = scan->rows;
+            scan->count = block.count;
+            scan->firstRow = block.firstRow;
+            scan->pos = 0;
+            continue;
+        }
+        if (scan->tailDone)
+            return RC_RM_NO_MORE_TUPLES;
+        scan->tailDone = true;
+        scan->checkRows = scan->tailCheck;
+        scan->current = scan->tail;
+        scan->count = scan->tailCount;
+        scan->firstRow = scan->tailFirst;
+        scan->pos = 0;
+    }
+}
+
+// End a scan
+RC tsCloseScan(TS_Scan *scan) {
+    pthread_mutex_lock(&scan->table->latch);
+    scan->table->activeScans--;
+    pthread_mutex_unlock(&scan->table->latch);
+    free(scan->rows);
+    free(scan->tail);
+    free(scan);
+    return RC_OK;
+}
+
+// Number of closed blocks a scan decodes, those overlapping its time range
+int tsScanBlocks(TS_Scan *scan) {
+    return scan->selected;
+}
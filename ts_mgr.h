@@ -0,0 +1,68 @@
+#ifndef TS_MGR_H
+#define TS_MGR_H
+
+#include "dberror.h"
+#include "expr.h"
+#include "tables.h"
+
+// Append-only storage of the records of an RM_ENGINE_TIMESERIES table
+//
+// Records are kept in the order they arrive, which for metrics is the order
+// of their time attribute (an INT, RM_TableOptions.timeAttr), and are never
+// updated or deleted one by one. An insert copies the record to the end of
+// the tail page, which stays pinned while the table is open, so it neither
+// looks for free space nor pins a page. A full tail page is closed: its
+// records are encoded column by column, INT attributes such as the time by
+// the difference of successive deltas and FLOAT attributes by the XOR with
+// the value before, and the block is packed behind the blocks closed before.
+// Every block records the range of the time attribute it holds, so a scan
+// whose condition bounds the time attribute decodes only the blocks that
+// overlap the range.
+//
+// A table may give its records a TTL (RM_TableOptions.ttl), in the unit of
+// the time attribute: a record expires when the current time passes its
+// time plus the TTL. Scans and lookups hide expired records, skipping
+// whole blocks by their maximum time, and tsReclaim frees the pages of
+// blocks that expired as a whole, for new blocks to reuse.
+//
+// RIDs count the records in insert order: a record's RID is (row, 0).
+//
+// File of table <name>: <name>.ts.
+
+typedef struct TS_Table TS_Table;
+typedef struct TS_Scan TS_Scan;
+
+// create, open, close, and destroy the storage of a table; timeAttr must
+// be an INT attribute of the schema, and a ttl of 0 keeps records for ever
+extern RC tsCreate (char *name, Schema *schema, int timeAttr, int ttl);
+extern rm_bool tsExists (char *name);
+extern RC tsOpen (char *name, Schema *schema, TS_Table **table);
+extern RC tsClose (TS_Table *table);
+extern RC tsDestroy (char *name);
+
+// remove every record at once; no scan may be open
+extern RC tsTruncate (TS_Table *table);
+
+// records; tsGet copies the record into data unless it has expired at
+// now. The count includes expired records until they are reclaimed
+extern RC tsInsert (TS_Table *table, char *data, RID *rid);
+extern RC tsGet (TS_Table *table, RID rid, int now, char *data);
+extern int tsNumTuples (TS_Table *table);
+extern int tsNumBlocks (TS_Table *table);
+extern int tsTtl (TS_Table *table);
+
+// free the pages of the oldest blocks, if every record in them has expired
+// at now; may run in a thread of its own, and does nothing while a scan is
+// open
+extern RC tsReclaim (TS_Table *table, int now, int *pages);
+
+// scans return the records in insert order, only decoding the blocks that
+// overlap the range cond puts on the time attribute (NULL for every
+// record) and that have not expired at now; the records returned may
+// still fail cond. data stays valid until the next call
+extern RC tsOpenScan (TS_Table *table, Expr *cond, int now, TS_Scan **scan);
+extern RC tsNext (TS_Scan *scan, RID *rid, char **data);
+extern RC tsCloseScan (TS_Scan *scan);
+extern int tsScanBlocks (TS_Scan *scan);
+
+#endif // TS_MGR_H